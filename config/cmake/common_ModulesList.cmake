@@ -13,6 +13,7 @@ set (Module_SDL2_Version        "2.0.3"     CACHE STRING    "SDL2 version .")
 option  (COMPONENT_player                   "Enable player component."          ON)
 option  (COMPONENT_message                  "Enable message component"          ON)
 option  (COMPONENT_thread                   "Enable thread component"           ON)
+option  (COMPONENT_threadpool               "Enable threadpool component"       ON)
 option  (COMPONENT_mediainfo                "Enable media info component"       ON)
 
 option  (COMPONENT_log                      "Enable log component."             ON)
@@ -29,6 +30,9 @@ option  (COMPONENT_views                    "Enable views component."
 ########################################################################################
 ##################               配置所包含的功能模块                 ##################
 ########################################################################################
+## player
+option  (MODULE_libmad                 "Enable libmad mp3 decoder module"          ON)
+
 ## log
 option  (MODULE_debug_heap              "Enable debug heap module"                  ON)
 option  (MODULE_stackinfo               "Enable function stackinfo module"          ON)
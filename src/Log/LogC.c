@@ -52,6 +52,10 @@ static int g_moduleCount = 0;
 /** g_version 使用——Version结构记录全局的版本号 **/
 struct _Version g_version;
 
+/** 日志行过滤函数，由 logLineFilterRegister 设置 **/
+static LogLineFilter_Type g_logLineFilter = NULL;
+static void* g_logLineFilterData = NULL;
+
 
 /**
 * 获取当前时间：年-月-日-星期几   时-分-秒-毫秒
@@ -333,6 +337,24 @@ static void logLineSanitize(uint8_t *str)
 
 
 
+/***
+* 注册日志行过滤函数，只保留最后一次注册的过滤函数
+**/
+void logLineFilterRegister(LogLineFilter_Type filter, void* userData)
+{
+    /* 注册时先设置参数，取消时先清除函数；两次写入之间正在输出的线程可能读到不一致的一对 */
+    if (filter != NULL) {
+        g_logLineFilterData = userData;
+        g_logLineFilter = filter;
+    } else {
+        g_logLineFilter = NULL;
+        g_logLineFilterData = userData;
+    }
+
+    return ;
+}
+
+
 /***
 输出格式:
     [month-day-year, weekday][hour:min:sec.msec] [HostMac][HostIP] [Major.Minor.BuildVersion:ModuleVersion][ModuleName] [ErrorCode][file:line][function:LogLevel] : logBuffer_info.
@@ -347,6 +369,7 @@ void logVerboseCStyle(const char *file, int line, const char *function, int modu
     char errorCode[16] = {0};
     static char sLogBuffer[512] = { 0 };
     static char str[1024] = {0};
+    LogLineFilter_Type lineFilter;
 
     // date & time
     get_CurrentTime((char *)&currTime, OUTPUTFlag_DateTime);
@@ -366,6 +389,9 @@ void logVerboseCStyle(const char *file, int line, const char *function, int modu
     va_start(args, fmt);
     vsnprintf(sLogBuffer, 512, fmt, args);
     va_end(args);
+    lineFilter = g_logLineFilter;
+    if (lineFilter)
+        lineFilter(sLogBuffer, 512, g_logLineFilterData);
 
     snprintf(str, strlen(currTime) + 1, "%s", currTime);
     snprintf(str + strlen(str), strlen(machineInfo) + 1, "%s", machineInfo);
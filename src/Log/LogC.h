@@ -193,6 +193,15 @@ int registerModule(char* name, char* version, int logtype);
 void logVerboseCStyle(const char* file, int line, const char* function, int module, int level, const char* fmt, ...);
 
 
+/***
+* 日志行过滤：格式化日志内容之后、输出之前调用，可在 buf 中原地修改(如屏蔽密码)；
+*       buf 为 '\0' 结尾的日志内容，size 为 buf 大小；filter 为 NULL 时取消过滤
+*       filter 中不能再输出日志；注册、取消的同时有线程输出日志时 userData 可能为 NULL，filter 需检查
+**/
+typedef void (*LogLineFilter_Type)(char* buf, int size, void* userData);
+void logLineFilterRegister(LogLineFilter_Type filter, void* userData);
+
+
 
 #ifdef __cplusplus
 }
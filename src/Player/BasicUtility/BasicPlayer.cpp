@@ -116,28 +116,40 @@ int BasicPlayer :: Resume()
 }
 
 
-int BasicPlayer :: FastForward(int)
+int BasicPlayer :: FastForward(int scale)
 {
-    playerLogDebug("BasicPlayer :: FastForward\n");
-    StreamPlayerUtilityCtrlFastForward(0);
+    playerLogDebug("BasicPlayer :: FastForward [%d]\n", scale);
+    StreamPlayerUtilityCtrlFastForward(0, scale > 0 ? scale * 100 : 100);     //0 恢复正常速度
 
     return 0;
 }
 
 
-int BasicPlayer :: FastRewind(int)
+int BasicPlayer :: FastRewind(int scale)
 {
-    playerLogDebug("BasicPlayer :: FastRewind\n");
-    StreamPlayerUtilityCtrlFastRewind(0);
+    playerLogDebug("BasicPlayer :: FastRewind [%d]\n", scale);
+    StreamPlayerUtilityCtrlFastRewind(0, (scale > 2 ? scale : 2) * 100);      //后退最低 2 倍
 
     return 0;
 }
 
 
-int BasicPlayer :: SeekTo()
+int BasicPlayer :: SetPlayRate(int percent)
 {
-    playerLogDebug("BasicPlayer :: SeekTo\n");
-    StreamPlayerUtilityCtrlSeekto(0);
+    playerLogDebug("BasicPlayer :: SetPlayRate [%d%%]\n", percent);
+    if (percent < 0)
+        StreamPlayerUtilityCtrlFastRewind(0, -percent);
+    else
+        StreamPlayerUtilityCtrlFastForward(0, percent);
+
+    return 0;
+}
+
+
+int BasicPlayer :: SeekTo(unsigned int timeMs, bool accurate)
+{
+    playerLogDebug("BasicPlayer :: SeekTo [%u]ms\n", timeMs);
+    StreamPlayerUtilityCtrlSeekto(0, (int)timeMs, accurate ? 1 : 0);
 
     return 0;
 }
@@ -331,8 +343,8 @@ int BasicPlayer :: GetCurrentSubtitleInfo(string &strValue)
 
 void BasicPlayer :: SelectSubtitle(int subtitlePid)
 {
-    playerLogDebug("BasicPlayer :: SelectSubtitle\n");
-    StreamPlayerSelectSubtitle(0);
+    playerLogDebug("BasicPlayer :: SelectSubtitle [%d]\n", subtitlePid);
+    StreamPlayerSelectSubtitle(0, subtitlePid);
 
     return ;
 }
@@ -496,8 +508,8 @@ int BasicPlayer :: GetCurrentAudioTrackInfo(char *pTrackInfo)
 
 void BasicPlayer :: SelectAudioTrack(int audioTrackPid)
 {
-    playerLogDebug("BasicPlayer :: SelectAudioTrack\n");
-    StreamPlayerSelectAudioTrack(0);
+    playerLogDebug("BasicPlayer :: SelectAudioTrack [%d]\n", audioTrackPid);
+    StreamPlayerSelectAudioTrack(0, audioTrackPid);
 
     return ;
 }
@@ -26,10 +26,11 @@ public:
     virtual int Pause();
     virtual int Resume();
     
-    virtual int FastForward(int);
+    virtual int FastForward(int);       //倍数，0 恢复正常速度
     virtual int FastRewind(int);
+    virtual int SetPlayRate(int);       //百分比，50~200 慢放/快放带声音，更快和负数只显示关键帧
 
-    virtual int SeekTo();    
+    virtual int SeekTo(unsigned int timeMs, bool accurate = true);     //accurate 为 false 时从之前的关键帧开始
 	virtual int SeekToStart(void);
     virtual int SeekEnd();
     
@@ -100,15 +100,15 @@ int testCommonPlayer(void *args)
         printf("===========================66666======iii[%d]======================\n", i++);
 
         TimeDelay( TIME_DELAY_MODE_SELECT, 4, 100 * 1000);
-        player->FastForward(0);
+        player->FastForward(4);
         printf("===========================77777======iii[%d]======================\n", i++);
 
         TimeDelay( TIME_DELAY_MODE_SELECT, 2, 100 * 1000);
-        player->FastRewind(0);
+        player->FastRewind(2);
         printf("===========================88888=======iii[%d]======================\n", i++);
 
         TimeDelay( TIME_DELAY_MODE_SELECT, 3, 100 * 1000);
-        player->SeekTo();
+        player->SeekTo(30 * 1000);
         printf("===========================99999======iii[%d]======================\n", i++);
 
         TimeDelay( TIME_DELAY_MODE_SELECT, 1, 100 * 1000);
@@ -0,0 +1,424 @@
+/**
+ *  Demuxer.cpp文件
+ *  解复用公共部分；
+ *  主要有以下部分：
+ *          DemuxPacketPool：packet 头和数据一次分配，按 2 的幂分级缓存，引用计数用原子操作
+ *          Demuxer：流式格式共用的读取缓冲、packet 队列、seek 后等待关键帧
+ *          格式注册表：按文件开头打分选择格式
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "MP4Parser.h"
+#include "Demuxer.h"
+
+
+#define     DEMUX_PACKET_HEADER_SIZE    ((sizeof(DemuxPacket) + 63) & ~63)      //数据按 64 字节对齐
+
+
+int DemuxSourceOpenFile(DemuxSource* source, const char* path)
+{
+    MP4ByteSource file;
+
+    if (MP4ByteSourceOpenFile(&file, path) < 0)
+        return -1;
+    source->read = file.read;
+    source->size = file.size;
+    source->opaque = file.opaque;
+    return 0;
+}
+
+void DemuxSourceCloseFile(DemuxSource* source)
+{
+    MP4ByteSource file;
+
+    file.read = source->read;
+    file.size = source->size;
+    file.opaque = source->opaque;
+    MP4ByteSourceCloseFile(&file);
+    memset(source, 0, sizeof(*source));
+}
+
+
+/* DemuxPacketPool */
+DemuxPacket* DemuxPacketRef(DemuxPacket* packet)
+{
+    if (packet)
+        __sync_add_and_fetch(&packet->refCount, 1);
+    return packet;
+}
+
+void DemuxPacketUnref(DemuxPacket* packet)
+{
+    if (packet && __sync_sub_and_fetch(&packet->refCount, 1) == 0)
+        packet->pool->release(packet);
+}
+
+DemuxPacketPool::DemuxPacketPool()
+{
+    m_mutex = ThreadMutexCreate();
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+DemuxPacketPool::~DemuxPacketPool()
+{
+    if (m_statistics.live > 0)
+        playerLogWarning("demux packet pool destroyed with [%d] packets in use.\n", m_statistics.live);
+    trim();
+    ThreadMutexDestroy(m_mutex);
+}
+
+DemuxPacketPool* DemuxPacketPool::getDefault()
+{
+    static DemuxPacketPool* s_pool = new DemuxPacketPool();     //不释放，退出时可能还有 packet 在使用
+    return s_pool;
+}
+
+DemuxPacket* DemuxPacketPool::alloc(int size)
+{
+    DemuxPacket* packet = NULL;
+    int sizeClass = 0, capacity;
+
+    if (size < 0)
+        return NULL;
+    while (sizeClass < DEMUX_PACKET_CLASSES && (DEMUX_PACKET_CLASS_MIN << sizeClass) < size)
+        sizeClass++;
+    if (sizeClass < DEMUX_PACKET_CLASSES) {
+        capacity = DEMUX_PACKET_CLASS_MIN << sizeClass;
+    } else {
+        sizeClass = -1;
+        capacity = size;
+    }
+
+    ThreadMutexLock(m_mutex);
+    m_statistics.allocs++;
+    m_statistics.live++;
+    if (sizeClass >= 0 && !m_free[sizeClass].empty()) {
+        packet = m_free[sizeClass].back();
+        m_free[sizeClass].pop_back();
+        m_statistics.reuses++;
+        m_statistics.cachedBytes -= capacity;
+    } else {
+        m_statistics.mallocs++;
+    }
+    ThreadMutexUnLock(m_mutex);
+
+    if (packet == NULL) {
+        packet = (DemuxPacket*)malloc(DEMUX_PACKET_HEADER_SIZE + capacity + DEMUX_PACKET_PADDING);
+        if (packet == NULL) {
+            playerLogError("demux packet malloc [%d] error.\n", size);
+            ThreadMutexLock(m_mutex);
+            m_statistics.live--;
+            ThreadMutexUnLock(m_mutex);
+            return NULL;
+        }
+        packet->data = (uint8_t*)packet + DEMUX_PACKET_HEADER_SIZE;
+        packet->capacity = capacity;
+        packet->pool = this;
+        packet->sizeClass = sizeClass;
+    }
+    packet->size = size;
+    packet->streamIndex = -1;
+    packet->ptsUs = DEMUX_TIMESTAMP_NONE;
+    packet->dtsUs = DEMUX_TIMESTAMP_NONE;
+    packet->fileOffset = -1;
+    packet->flags = 0;
+    packet->refCount = 1;
+    memset(packet->data + size, 0, DEMUX_PACKET_PADDING);
+    return packet;
+}
+
+void DemuxPacketPool::release(DemuxPacket* packet)
+{
+    bool cached = false;
+
+    ThreadMutexLock(m_mutex);
+    m_statistics.live--;
+    if (packet->sizeClass >= 0 && m_statistics.cachedBytes + packet->capacity <= DEMUX_PACKET_CACHE_BYTES) {
+        m_free[packet->sizeClass].push_back(packet);
+        m_statistics.cachedBytes += packet->capacity;
+        cached = true;
+    }
+    ThreadMutexUnLock(m_mutex);
+    if (!cached)
+        free(packet);
+}
+
+void DemuxPacketPool::trim()
+{
+    std::vector<DemuxPacket*> packets;
+    int i;
+
+    ThreadMutexLock(m_mutex);
+    for (i = 0; i < DEMUX_PACKET_CLASSES; i++) {
+        packets.insert(packets.end(), m_free[i].begin(), m_free[i].end());
+        m_free[i].clear();
+    }
+    m_statistics.cachedBytes = 0;
+    ThreadMutexUnLock(m_mutex);
+    for (i = 0; i < (int)packets.size(); i++)
+        free(packets[i]);
+}
+
+DemuxPacketPoolStatistics DemuxPacketPool::getStatistics()
+{
+    DemuxPacketPoolStatistics statistics;
+
+    ThreadMutexLock(m_mutex);
+    statistics = m_statistics;
+    ThreadMutexUnLock(m_mutex);
+    return statistics;
+}
+
+
+/* Demuxer */
+Demuxer::Demuxer()
+    : m_durationUs(0)
+    , m_pool(DemuxPacketPool::getDefault())
+    , m_readOffset(0)
+    , m_eof(false)
+    , m_waitKeyframe(false)
+{
+    memset(&m_source, 0, sizeof(m_source));
+}
+
+Demuxer::~Demuxer()
+{
+    clearQueue();
+}
+
+void Demuxer::close()
+{
+    clearQueue();
+    m_streams.clear();
+    m_durationUs = 0;
+    m_readOffset = 0;
+    m_eof = false;
+    m_waitKeyframe = false;
+    std::vector<uint8_t>().swap(m_readBuffer);
+}
+
+const DemuxStreamInfo* Demuxer::getStream(int index)
+{
+    if (index < 0 || index >= (int)m_streams.size())
+        return NULL;
+    return &m_streams[index];
+}
+
+int Demuxer::setStreamEnabled(int index, bool enabled)
+{
+    if (index < 0 || index >= (int)m_streams.size())
+        return -1;
+    m_streams[index].enabled = enabled;
+    return 0;
+}
+
+int Demuxer::readPacket(DemuxPacket** packet)
+{
+    int result;
+
+    if (packet == NULL)
+        return -1;
+    result = fillQueue();
+    if (result != 0)
+        return result;
+    *packet = m_queue.front();
+    m_queue.pop_front();
+    return 0;
+}
+
+int Demuxer::feed(const uint8_t* /*data*/, int /*size*/)
+{
+    return -1;
+}
+
+int Demuxer::addStream(DemuxStreamInfo& info)
+{
+    info.index = m_streams.size();
+    info.enabled = 1;
+    m_streams.push_back(info);
+    return info.index;
+}
+
+DemuxPacket* Demuxer::allocPacket(int streamIndex, int size)
+{
+    DemuxPacket* packet = m_pool->alloc(size);
+
+    if (packet)
+        packet->streamIndex = streamIndex;
+    return packet;
+}
+
+void Demuxer::queuePacket(DemuxPacket* packet)
+{
+    const DemuxStreamInfo* stream = getStream(packet->streamIndex);
+
+    if (stream == NULL || !stream->enabled) {
+        DemuxPacketUnref(packet);
+        return;
+    }
+    if (m_waitKeyframe) {
+        //seek 到估计位置之后，视频关键帧之前的数据都丢弃，音频也一起丢弃以免不同步
+        if (stream->type != DemuxStream_Video || !(packet->flags & DemuxPacket_Keyframe)) {
+            DemuxPacketUnref(packet);
+            return;
+        }
+        m_waitKeyframe = false;
+    }
+    m_queue.push_back(packet);
+}
+
+void Demuxer::clearQueue()
+{
+    while (!m_queue.empty()) {
+        DemuxPacketUnref(m_queue.front());
+        m_queue.pop_front();
+    }
+}
+
+int Demuxer::readSource(int64_t offset, uint8_t* buffer, int size)
+{
+    if (m_source.read == NULL)
+        return -1;
+    if (m_source.size >= 0 && offset + size > m_source.size)
+        size = (offset < m_source.size) ? (int)(m_source.size - offset) : 0;
+    if (size == 0)
+        return 0;
+    return m_source.read(m_source.opaque, offset, buffer, size);
+}
+
+int Demuxer::feedChunk()
+{
+    int size;
+
+    if (m_eof)
+        return 0;
+    if (m_readBuffer.empty())
+        m_readBuffer.resize(DEMUX_READ_SIZE);
+    size = readSource(m_readOffset, &m_readBuffer[0], DEMUX_READ_SIZE);
+    if (size < 0) {
+        playerLogError("%s read error at offset [%lld].\n", getName(), (long long)m_readOffset);
+        return -1;
+    }
+    if (size == 0) {
+        m_eof = true;
+        feedEnd();
+        return 0;
+    }
+    m_readOffset += size;
+    if (feed(&m_readBuffer[0], size) < 0)
+        return -1;
+    return size;
+}
+
+int Demuxer::fillQueue()
+{
+    while (m_queue.empty()) {
+        int size;
+        if (m_eof)
+            return 1;
+        size = feedChunk();
+        if (size < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void Demuxer::restartAt(int64_t offset)
+{
+    size_t i;
+
+    clearQueue();
+    m_readOffset = offset;
+    m_eof = false;
+    m_waitKeyframe = false;
+    for (i = 0; i < m_streams.size(); i++) {
+        if (m_streams[i].type == DemuxStream_Video && m_streams[i].enabled)
+            m_waitKeyframe = true;
+    }
+}
+
+
+/* 格式注册表 */
+static const DemuxerDescriptor* s_demuxers[DEMUX_REGISTRY_MAX] = {
+    &g_TSDemuxerDescriptor,
+    &g_FLVDemuxerDescriptor,
+    &g_MP4DemuxerDescriptor,
+    &g_MP3DemuxerDescriptor,
+    &g_ESDemuxerDescriptor
+};
+static int s_demuxerCount = 5;
+
+int DemuxerRegister(const DemuxerDescriptor* descriptor)
+{
+    int i;
+
+    if (descriptor == NULL || descriptor->name == NULL || descriptor->probe == NULL || descriptor->create == NULL)
+        return -1;
+    for (i = 0; i < s_demuxerCount; i++) {
+        if (strcmp(s_demuxers[i]->name, descriptor->name) == 0) {
+            s_demuxers[i] = descriptor;
+            return 0;
+        }
+    }
+    if (s_demuxerCount >= DEMUX_REGISTRY_MAX)
+        return -1;
+    s_demuxers[s_demuxerCount++] = descriptor;
+    return 0;
+}
+
+const DemuxerDescriptor* DemuxerProbe(const uint8_t* data, int size, int* score)
+{
+    const DemuxerDescriptor* best = NULL;
+    int bestScore = 0, i;
+
+    for (i = 0; i < s_demuxerCount; i++) {
+        int value = s_demuxers[i]->probe(data, size);
+        if (value > bestScore) {
+            bestScore = value;
+            best = s_demuxers[i];
+        }
+    }
+    if (score)
+        *score = bestScore;
+    return best;
+}
+
+Demuxer* DemuxerOpen(const DemuxSource& source, DemuxPacketPool* pool)
+{
+    std::vector<uint8_t> probe(DEMUX_PROBE_SIZE);
+    const DemuxerDescriptor* descriptor;
+    Demuxer* demuxer;
+    int size = 0, count, score;
+
+    if (source.read == NULL)
+        return NULL;
+    while (size < DEMUX_PROBE_SIZE && (source.size < 0 || size < source.size)) {
+        count = source.read(source.opaque, size, &probe[size], (source.size >= 0) ?
+                            (int)std::min<int64_t>(DEMUX_PROBE_SIZE - size, source.size - size) : DEMUX_PROBE_SIZE - size);
+        if (count <= 0)
+            break;
+        size += count;
+    }
+
+    descriptor = DemuxerProbe(&probe[0], size, &score);
+    if (descriptor == NULL) {
+        playerLogError("unknown media format.\n");
+        return NULL;
+    }
+    playerLogInfo("demuxer [%s], probe score [%d].\n", descriptor->name, score);
+
+    demuxer = descriptor->create();
+    demuxer->setPacketPool(pool);
+    if (demuxer->open(source) < 0) {
+        delete demuxer;
+        return NULL;
+    }
+    return demuxer;
+}
@@ -0,0 +1,225 @@
+#ifndef __DEMUXER_H__
+#define __DEMUXER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "ThreadMutex.h"
+
+
+#define     DEMUX_PROBE_SIZE            (64 * 1024)     //探测格式时读取的文件开头
+#define     DEMUX_READ_SIZE             (64 * 1024)     //流式格式每次读取的大小
+#define     DEMUX_OPEN_SCAN_MAX         (4 * 1024 * 1024)   //open() 时为了找到所有流最多读取的数据
+#define     DEMUX_PACKET_PADDING        64              //数据之后补 0，满足 ffmpeg 解码器的 padding 要求
+#define     DEMUX_PACKET_CLASS_MIN      256             //packet 按 2 的幂分级缓存，最小 256 字节
+#define     DEMUX_PACKET_CLASSES        15              //最大一级为 4MB，更大的直接 malloc
+#define     DEMUX_PACKET_CACHE_BYTES    (16 * 1024 * 1024)  //每个 pool 缓存的空闲 packet 的总大小上限
+#define     DEMUX_REGISTRY_MAX          16
+#define     DEMUX_TIMESTAMP_NONE        ((int64_t)0x8000000000000000LL)
+
+
+typedef enum {
+    DemuxStream_Video = 0,
+    DemuxStream_Audio,
+    DemuxStream_Subtitle,
+    DemuxStream_Data
+} DemuxStreamType;
+
+typedef enum {
+    DemuxCodec_Unknown = 0,
+    DemuxCodec_H264,
+    DemuxCodec_H265,
+    DemuxCodec_MPEG2Video,
+    DemuxCodec_AAC,
+    DemuxCodec_MP3,                     //MPEG audio layer I/II/III
+    DemuxCodec_AC3,
+    DemuxCodec_EAC3,
+    DemuxCodec_Opus,
+    DemuxCodec_DVBSubtitle,
+    DemuxCodec_Text                     //tx3g / WebVTT
+} DemuxCodec;
+
+typedef enum {
+    DemuxPacket_Keyframe        = 1,
+    DemuxPacket_Discontinuity   = 1 << 1,   //之前有数据丢失
+    DemuxPacket_Corrupt         = 1 << 2,   //数据不完整
+    DemuxPacket_DecodeOnly      = 1 << 3    //精确 seek 时目标之前的帧，解码但不显示，由 TrickPlay 设置
+} DemuxPacketFlag;
+
+
+typedef struct _DemuxSource {
+    int     (*read)(void* opaque, int64_t offset, uint8_t* buffer, int size);     //返回读到的字节数，结束返回 0，出错返回 -1
+    int64_t size;           //未知时为 -1
+    void*   opaque;
+} DemuxSource;
+
+int DemuxSourceOpenFile(DemuxSource* source, const char* path);
+void DemuxSourceCloseFile(DemuxSource* source);
+
+
+typedef struct _DemuxStreamInfo {
+    int             index;
+    int             type;               //DemuxStreamType
+    int             codec;              //DemuxCodec
+    int             id;                 //TS 的 PID，MP4 的 track ID，其他格式为 0
+    int64_t         durationUs;
+    int             width;
+    int             height;
+    int             sampleRate;
+    int             channels;
+    char            language[4];
+    int             nalLengthSize;      //H.264/H.265：0 为 Annex-B，否则为 AVCC/HVCC 长度字段的字节数
+    int             adts;               //AAC：1 为带 ADTS 头，0 为裸数据(extradata 为 AudioSpecificConfig)
+    int             enabled;
+    std::vector<uint8_t>    extradata;  //avcC / hvcC / AudioSpecificConfig
+} DemuxStreamInfo;
+
+class DemuxPacketPool;
+
+typedef struct _DemuxPacket {
+    uint8_t*        data;               //之后有 DEMUX_PACKET_PADDING 字节 0
+    int             size;
+    int             capacity;
+    int             streamIndex;
+    int64_t         ptsUs;              //DEMUX_TIMESTAMP_NONE 表示没有
+    int64_t         dtsUs;
+    int64_t         fileOffset;
+    int             flags;              //DemuxPacketFlag
+
+    /* 以下由 pool 使用 */
+    DemuxPacketPool*    pool;
+    int                 sizeClass;      //-1 表示不缓存
+    volatile int        refCount;
+} DemuxPacket;
+
+/* 引用计数，可以在不同线程中 ref/unref；计数为 0 时回到分配它的 pool */
+DemuxPacket* DemuxPacketRef(DemuxPacket* packet);
+void DemuxPacketUnref(DemuxPacket* packet);
+
+typedef struct _DemuxPacketPoolStatistics {
+    int64_t         allocs;
+    int64_t         reuses;             //从缓存中取到的次数
+    int64_t         mallocs;
+    int             live;               //还没有释放的 packet
+    int             cachedBytes;
+} DemuxPacketPoolStatistics;
+
+
+class DemuxPacketPool { /* packet 缓存：头和数据一次分配，按大小分级复用，避免每帧 malloc/free */
+    public:
+        DemuxPacketPool();
+        ~DemuxPacketPool();                 //要求所有 packet 都已经释放
+
+        DemuxPacket* alloc(int size);       //refCount 为 1，时间戳为 DEMUX_TIMESTAMP_NONE
+        void trim();                        //释放所有缓存
+        DemuxPacketPoolStatistics getStatistics();
+
+        static DemuxPacketPool* getDefault();
+
+    private:
+        friend void DemuxPacketUnref(DemuxPacket* packet);
+        void release(DemuxPacket* packet);
+
+        ThreadMutex_Type                m_mutex;
+        std::vector<DemuxPacket*>       m_free[DEMUX_PACKET_CLASSES];
+        DemuxPacketPoolStatistics       m_statistics;
+};
+
+
+class Demuxer { /* 各种格式解复用的公共接口：流信息，按时间顺序读取 packet，seek */
+    public:
+        Demuxer();
+        virtual ~Demuxer();
+
+        virtual const char* getName() = 0;
+        virtual int open(const DemuxSource& source) = 0;
+        virtual void close();
+
+        /**
+         *  @Func: readPacket
+         *         ps. :流式格式(TS/FLV/ES/MP3)按 DEMUX_READ_SIZE 读取数据交给 feed()，解析出的 packet 在队列中排队
+         *  @Param: packet, type:: DemuxPacket**, 使用完后 DemuxPacketUnref()
+         *  @Return: int, 0 成功，结束返回 1，出错返回 -1
+         *
+         **/
+        virtual int readPacket(DemuxPacket** packet);
+        virtual int seek(int64_t timeUs) = 0;       //定位到 timeUs 之前的关键帧；不支持时返回 -1
+
+        int getStreamCount() { return m_streams.size(); }
+        const DemuxStreamInfo* getStream(int index);
+        int setStreamEnabled(int index, bool enabled);
+        int64_t getDurationUs() { return m_durationUs; }
+        void setPacketPool(DemuxPacketPool* pool) { m_pool = pool ? pool : DemuxPacketPool::getDefault(); }
+
+    protected:
+        virtual int feed(const uint8_t* data, int size);    //流式格式实现
+        virtual void feedEnd() {}
+
+        int addStream(DemuxStreamInfo& info);
+        DemuxPacket* allocPacket(int streamIndex, int size);
+        void queuePacket(DemuxPacket* packet);
+        void clearQueue();
+        int readSource(int64_t offset, uint8_t* buffer, int size);
+        int feedChunk();                                    //读取一块交给 feed()，返回读到的字节数，结束时调用 feedEnd() 并返回 0
+        int fillQueue();                                    //读取数据直到队列不空，结束返回 1
+        void restartAt(int64_t offset);                     //seek 之后从 offset 开始读取，丢弃视频关键帧之前的 packet
+
+        DemuxSource                     m_source;
+        std::vector<DemuxStreamInfo>    m_streams;
+        int64_t                         m_durationUs;
+        DemuxPacketPool*                m_pool;
+
+        /* 流式格式共用的读取缓冲和 packet 队列 */
+        std::vector<uint8_t>            m_readBuffer;
+        std::deque<DemuxPacket*>        m_queue;
+        int64_t                         m_readOffset;
+        bool                            m_eof;
+        bool                            m_waitKeyframe;
+};
+
+
+typedef struct _DemuxerDescriptor {
+    const char*     name;
+    int             (*probe)(const uint8_t* data, int size);    //0~100，data 为文件开头最多 DEMUX_PROBE_SIZE 字节
+    Demuxer*        (*create)();
+} DemuxerDescriptor;
+
+/* 内置格式，在 DemuxerFormats.cpp 中实现 */
+extern const DemuxerDescriptor g_TSDemuxerDescriptor;
+extern const DemuxerDescriptor g_FLVDemuxerDescriptor;
+extern const DemuxerDescriptor g_MP4DemuxerDescriptor;
+extern const DemuxerDescriptor g_MP3DemuxerDescriptor;
+extern const DemuxerDescriptor g_ESDemuxerDescriptor;
+
+/**
+ *  @Func: DemuxerRegister
+ *         ps. :增加新的格式，名字相同时替换；初始化时调用，不加锁
+ *  @Param: descriptor, type:: const DemuxerDescriptor*, 需要一直有效
+ *  @Return: int, 注册表已满返回 -1
+ *
+ **/
+int DemuxerRegister(const DemuxerDescriptor* descriptor);
+
+/* 对所有格式打分，返回分数最高的，都为 0 时返回 NULL */
+const DemuxerDescriptor* DemuxerProbe(const uint8_t* data, int size, int* score);
+
+/**
+ *  @Func: DemuxerOpen
+ *         ps. :读取开头 DEMUX_PROBE_SIZE 字节探测格式，创建并打开对应的 Demuxer
+ *  @Param: source, type:: const DemuxSource&
+ *  @Param: pool, type:: DemuxPacketPool*, NULL 为默认 pool
+ *  @Return: Demuxer*, 失败返回 NULL，用完后 delete
+ *
+ **/
+Demuxer* DemuxerOpen(const DemuxSource& source, DemuxPacketPool* pool);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__DEMUXER_H__
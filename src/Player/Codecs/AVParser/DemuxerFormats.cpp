@@ -0,0 +1,992 @@
+/**
+ *  DemuxerFormats.cpp文件
+ *  内置格式：把各个 Parser 适配为 Demuxer 接口；
+ *  主要有以下部分：
+ *          TS：TSParser，PTS 回绕处理，按字节比例 seek
+ *          FLV：FLVParser，sequence header 作为 extradata，关键帧索引 seek
+ *          MP4：MP4Parser，直接按 sample 读取
+ *          MP3：MP3Parser，VBR 头 / 采样 seek 表
+ *          ES：H.264/H.265 裸码流，H264Parser 分帧，按平均帧大小 seek
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+#include "LogPlayer.h"
+#include "TSParser.h"
+#include "FLVParser.h"
+#include "MP4Parser.h"
+#include "MP3Parser.h"
+#include "H264Parser.h"
+#include "Demuxer.h"
+
+
+#define     TS_PTS_WRAP                 ((int64_t)1 << 33)
+#define     TS_PTS_BACKWARD             ((int64_t)10 * 90000)       //比起始 PTS 早 10 秒以内的认为不是回绕(B 帧的 DTS 等)
+#define     TS_TAIL_SCAN_SIZE           (1024 * 1024)               //从文件末尾读取这么多数据找最后的 PTS
+#define     TS_SEEK_BACKOFF_US          1000000                     //按字节比例估计的位置提前一点，尽量落在目标之前
+#define     ES_FRAME_DURATION_US        40000                       //裸码流没有时间戳，按 25fps
+#define     PROBE_CHAIN_MAX             5
+
+
+static const int s_aacSampleRates[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+
+static inline uint32_t DemuxReadU32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* 新的流信息，其他字段清零 */
+static void DemuxInitStream(DemuxStreamInfo* info, int type, int codec)
+{
+    info->index = info->id = 0;
+    info->type = type;
+    info->codec = codec;
+    info->durationUs = 0;
+    info->width = info->height = info->sampleRate = info->channels = 0;
+    memset(info->language, 0, sizeof(info->language));
+    info->nalLengthSize = info->adts = info->enabled = 0;
+    info->extradata.clear();
+}
+
+/* AudioSpecificConfig 中的采样率和声道数 */
+static void DemuxParseAudioSpecificConfig(const uint8_t* config, int size, DemuxStreamInfo* info)
+{
+    int index;
+
+    if (size < 2)
+        return;
+    index = ((config[0] & 0x07) << 1) | (config[1] >> 7);
+    if (index < (int)(sizeof(s_aacSampleRates) / sizeof(s_aacSampleRates[0])))
+        info->sampleRate = s_aacSampleRates[index];
+    info->channels = (config[1] >> 3) & 0x0F;
+}
+
+/* avcC / hvcC：长度字段字节数、宽高 */
+static void DemuxParseVideoConfig(const uint8_t* config, int size, DemuxStreamInfo* info)
+{
+    H264Parser parser(info->codec == DemuxCodec_H265 ? H26xCodec_H265 : H26xCodec_H264);
+    int lengthSize = parser.setDecoderConfig(config, size);
+
+    if (lengthSize > 0)
+        info->nalLengthSize = lengthSize;
+    if (parser.getVideoInfo()) {
+        info->width = parser.getVideoInfo()->width;
+        info->height = parser.getVideoInfo()->height;
+    }
+}
+
+
+/* TS */
+static int TSDemuxerProbe(const uint8_t* data, int size)
+{
+    static const int packetSizes[] = { TS_PACKET_SIZE, TS_PACKET_SIZE_M2TS, TS_PACKET_SIZE_FEC };
+    int start = TSFindSyncByte(data, std::min(size, TS_PACKET_SIZE_FEC));
+    int best = 0, i, count;
+
+    if (start < 0)
+        return 0;
+    for (i = 0; i < 3; i++) {
+        for (count = 0; count < 10 && start + (count + 1) * packetSizes[i] < size; count++) {
+            if (data[start + (count + 1) * packetSizes[i]] != TS_SYNC_BYTE)
+                break;
+        }
+        best = std::max(best, count);
+    }
+    return (best >= 3) ? best * 10 : 0;
+}
+
+class TSDemuxer : public Demuxer {
+    public:
+        TSDemuxer();
+        ~TSDemuxer();
+
+        const char* getName() { return "mpegts"; }
+        int open(const DemuxSource& source);
+        void close();
+        int seek(int64_t timeUs);
+
+    protected:
+        int feed(const uint8_t* data, int size);
+        void feedEnd() { m_parser.flush(); }
+
+    private:
+        static void onProgram(const TSProgramInfo* program, void* userData);
+        static void onAccessUnit(const TSAccessUnit* au, void* userData);
+        static void onTailAccessUnit(const TSAccessUnit* au, void* userData);
+        int64_t toUs(int64_t timestamp);
+        bool isReady();
+        void scanDuration();
+
+        TSParser                    m_parser;
+        std::map<int, int>          m_pidStreams;           //PID -> 流下标，不支持的类型为 -1
+        std::map<int, H264Parser*>  m_videoParsers;         //流下标 -> 判断关键帧和宽高
+        int64_t                     m_startPts;             //90kHz，第一个 PTS
+        int64_t                     m_tailPts;
+        bool                        m_programSeen;
+};
+
+TSDemuxer::TSDemuxer()
+    : m_startPts(TS_TIMESTAMP_NONE)
+    , m_tailPts(TS_TIMESTAMP_NONE)
+    , m_programSeen(false)
+{
+}
+
+TSDemuxer::~TSDemuxer()
+{
+    close();
+}
+
+void TSDemuxer::close()
+{
+    std::map<int, H264Parser*>::iterator it;
+
+    Demuxer::close();
+    for (it = m_videoParsers.begin(); it != m_videoParsers.end(); ++it)
+        delete it->second;
+    m_videoParsers.clear();
+    m_pidStreams.clear();
+    m_parser.reset();
+    m_startPts = TS_TIMESTAMP_NONE;
+    m_programSeen = false;
+}
+
+int TSDemuxer::open(const DemuxSource& source)
+{
+    TSParserCallbacks callbacks;
+
+    close();
+    m_source = source;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onProgram = onProgram;
+    callbacks.onAccessUnit = onAccessUnit;
+    callbacks.userData = this;
+    m_parser.setCallbacks(callbacks);
+
+    //读到 PMT 和视频的 SPS 为止，期间得到的 packet 留在队列中
+    while (!isReady() && m_readOffset < DEMUX_OPEN_SCAN_MAX) {
+        int size = feedChunk();
+        if (size < 0)
+            return -1;
+        if (size == 0)
+            break;
+    }
+    if (m_streams.empty()) {
+        playerLogError("mpegts: no supported stream found.\n");
+        return -1;
+    }
+    scanDuration();
+    return 0;
+}
+
+bool TSDemuxer::isReady()
+{
+    size_t i;
+
+    if (!m_programSeen)
+        return false;
+    for (i = 0; i < m_streams.size(); i++) {
+        if (m_streams[i].type == DemuxStream_Video && m_streams[i].width == 0
+            && (m_streams[i].codec == DemuxCodec_H264 || m_streams[i].codec == DemuxCodec_H265))
+            return false;
+    }
+    return true;
+}
+
+int TSDemuxer::feed(const uint8_t* data, int size)
+{
+    return m_parser.parse(data, size);
+}
+
+int64_t TSDemuxer::toUs(int64_t timestamp)
+{
+    int64_t delta;
+
+    if (timestamp == TS_TIMESTAMP_NONE || m_startPts == TS_TIMESTAMP_NONE)
+        return DEMUX_TIMESTAMP_NONE;
+    delta = (timestamp - m_startPts) & (TS_PTS_WRAP - 1);
+    if (delta > TS_PTS_WRAP - TS_PTS_BACKWARD)
+        delta -= TS_PTS_WRAP;
+    return delta * 100 / 9;
+}
+
+void TSDemuxer::onProgram(const TSProgramInfo* program, void* userData)
+{
+    TSDemuxer* self = (TSDemuxer*)userData;
+    int i;
+
+    self->m_programSeen = true;
+    for (i = 0; i < program->streamCount; i++) {
+        const TSStreamInfo* stream = &program->streams[i];
+        DemuxStreamInfo info;
+
+        if (self->m_pidStreams.find(stream->pid) != self->m_pidStreams.end())
+            continue;
+        DemuxInitStream(&info, DemuxStream_Video, DemuxCodec_Unknown);
+        info.id = stream->pid;
+        memcpy(info.language, stream->language, sizeof(info.language));
+        switch (stream->streamType) {
+            case TSStreamType_H264:         info.codec = DemuxCodec_H264; break;
+            case TSStreamType_H265:         info.codec = DemuxCodec_H265; break;
+            case TSStreamType_MPEG1Video:
+            case TSStreamType_MPEG2Video:   info.codec = DemuxCodec_MPEG2Video; break;
+            case TSStreamType_MPEG1Audio:
+            case TSStreamType_MPEG2Audio:   info.type = DemuxStream_Audio; info.codec = DemuxCodec_MP3; break;
+            case TSStreamType_AAC:          info.type = DemuxStream_Audio; info.codec = DemuxCodec_AAC; info.adts = 1; break;
+            case TSStreamType_AC3:          info.type = DemuxStream_Audio; info.codec = DemuxCodec_AC3; break;
+            case TSStreamType_EAC3:         info.type = DemuxStream_Audio; info.codec = DemuxCodec_EAC3; break;
+            case TSStreamType_DVBSubtitle:  info.type = DemuxStream_Subtitle; info.codec = DemuxCodec_DVBSubtitle; break;
+            default:                        break;
+        }
+        if (info.codec == DemuxCodec_Unknown) {
+            self->m_pidStreams[stream->pid] = -1;
+            continue;
+        }
+        self->m_pidStreams[stream->pid] = self->addStream(info);
+        if (info.codec == DemuxCodec_H264 || info.codec == DemuxCodec_H265)
+            self->m_videoParsers[info.index] = new H264Parser(info.codec == DemuxCodec_H265 ? H26xCodec_H265 : H26xCodec_H264);
+    }
+}
+
+void TSDemuxer::onAccessUnit(const TSAccessUnit* au, void* userData)
+{
+    TSDemuxer* self = (TSDemuxer*)userData;
+    std::map<int, int>::iterator it = self->m_pidStreams.find(au->pid);
+    std::map<int, H264Parser*>::iterator parser;
+    DemuxStreamInfo* stream;
+    DemuxPacket* packet;
+
+    if (it == self->m_pidStreams.end() || it->second < 0)
+        return;
+    stream = &self->m_streams[it->second];
+    if (!stream->enabled)
+        return;
+    packet = self->allocPacket(it->second, au->size);
+    if (packet == NULL)
+        return;
+    TSAccessUnitCopy(au, packet->data, packet->size);
+
+    if (self->m_startPts == TS_TIMESTAMP_NONE && au->pts != TS_TIMESTAMP_NONE)
+        self->m_startPts = au->pts;
+    packet->ptsUs = self->toUs(au->pts);
+    packet->dtsUs = (au->dts != TS_TIMESTAMP_NONE) ? self->toUs(au->dts) : packet->ptsUs;
+    if (au->flags & TSAccessUnit_Discontinuity)
+        packet->flags |= DemuxPacket_Discontinuity;
+    if (au->flags & TSAccessUnit_Truncated)
+        packet->flags |= DemuxPacket_Corrupt;
+
+    parser = self->m_videoParsers.find(it->second);
+    if (parser != self->m_videoParsers.end()) {
+        H26xAccessUnit info;
+        if (parser->second->inspect(packet->data, packet->size, 0, &info) == 0 && info.isKeyframe)
+            packet->flags |= DemuxPacket_Keyframe;
+        if (stream->width == 0 && parser->second->getVideoInfo()) {
+            stream->width = parser->second->getVideoInfo()->width;
+            stream->height = parser->second->getVideoInfo()->height;
+        }
+    } else if (stream->type != DemuxStream_Video || (au->flags & TSAccessUnit_RandomAccess)) {
+        packet->flags |= DemuxPacket_Keyframe;
+    }
+    self->queuePacket(packet);
+}
+
+void TSDemuxer::onTailAccessUnit(const TSAccessUnit* au, void* userData)
+{
+    TSDemuxer* self = (TSDemuxer*)userData;
+    int64_t us = self->toUs(au->pts);
+
+    if (us != DEMUX_TIMESTAMP_NONE && (self->m_tailPts == TS_TIMESTAMP_NONE || us > self->m_tailPts))
+        self->m_tailPts = us;
+}
+
+/* 读取文件最后一段，最大的 PTS 作为时长 */
+void TSDemuxer::scanDuration()
+{
+    TSParserCallbacks callbacks;
+    TSParser tail;
+    std::vector<uint8_t> buffer(DEMUX_READ_SIZE);
+    int64_t offset;
+    int size;
+    size_t i;
+
+    if (m_source.size <= 0 || m_startPts == TS_TIMESTAMP_NONE)
+        return;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onAccessUnit = onTailAccessUnit;
+    callbacks.userData = this;
+    tail.setCallbacks(callbacks);
+    m_tailPts = TS_TIMESTAMP_NONE;
+    for (offset = std::max<int64_t>(0, m_source.size - TS_TAIL_SCAN_SIZE); offset < m_source.size; offset += size) {
+        size = readSource(offset, &buffer[0], DEMUX_READ_SIZE);
+        if (size <= 0)
+            break;
+        tail.parse(&buffer[0], size);
+    }
+    tail.flush();
+    if (m_tailPts == TS_TIMESTAMP_NONE)
+        return;
+    m_durationUs = m_tailPts;
+    for (i = 0; i < m_streams.size(); i++)
+        m_streams[i].durationUs = m_durationUs;
+}
+
+int TSDemuxer::seek(int64_t timeUs)
+{
+    int packetSize = m_parser.getPacketSize() > 0 ? m_parser.getPacketSize() : TS_PACKET_SIZE;
+    int64_t offset;
+
+    if (m_durationUs <= 0 || m_source.size <= 0)
+        return -1;
+    timeUs = std::max<int64_t>(0, std::min(timeUs, m_durationUs) - TS_SEEK_BACKOFF_US);
+    offset = (int64_t)((double)m_source.size * timeUs / m_durationUs);
+    offset -= offset % packetSize;
+    m_parser.reset();
+    restartAt(offset);
+    return 0;
+}
+
+static Demuxer* TSDemuxerCreate()
+{
+    return new TSDemuxer();
+}
+
+const DemuxerDescriptor g_TSDemuxerDescriptor = { "mpegts", TSDemuxerProbe, TSDemuxerCreate };
+
+
+/* FLV */
+static int FLVDemuxerProbe(const uint8_t* data, int size)
+{
+    if (size >= FLV_HEADER_SIZE && memcmp(data, "FLV", 3) == 0 && data[3] == 1 && DemuxReadU32(data + 5) >= FLV_HEADER_SIZE)
+        return 100;
+    return 0;
+}
+
+class FLVDemuxer : public Demuxer {
+    public:
+        FLVDemuxer();
+        ~FLVDemuxer() {}
+
+        const char* getName() { return "flv"; }
+        int open(const DemuxSource& source);
+        void close();
+        int seek(int64_t timeUs);
+
+    protected:
+        int feed(const uint8_t* data, int size) { return m_parser.parse(data, size); }
+
+    private:
+        static void onTag(const FLVTag* tag, void* userData);
+        int createStream(const FLVTag* tag);
+        bool isReady();
+
+        FLVParser                   m_parser;
+        int                         m_headerFlags;      //FLV 头中的 0x04 音频 / 0x01 视频
+        int                         m_videoStream;
+        int                         m_audioStream;
+};
+
+FLVDemuxer::FLVDemuxer()
+    : m_headerFlags(0)
+    , m_videoStream(-1)
+    , m_audioStream(-1)
+{
+}
+
+void FLVDemuxer::close()
+{
+    Demuxer::close();
+    m_parser.reset();
+    m_headerFlags = 0;
+    m_videoStream = m_audioStream = -1;
+}
+
+int FLVDemuxer::open(const DemuxSource& source)
+{
+    FLVParserCallbacks callbacks;
+    uint8_t header[FLV_HEADER_SIZE];
+
+    close();
+    m_source = source;
+    if (readSource(0, header, FLV_HEADER_SIZE) != FLV_HEADER_SIZE || FLVDemuxerProbe(header, FLV_HEADER_SIZE) == 0) {
+        playerLogError("flv: invalid header.\n");
+        return -1;
+    }
+    m_headerFlags = header[4];
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onTag = onTag;
+    callbacks.userData = this;
+    m_parser.setCallbacks(callbacks);
+    while (!isReady() && m_readOffset < DEMUX_OPEN_SCAN_MAX) {
+        int size = feedChunk();
+        if (size < 0)
+            return -1;
+        if (size == 0)
+            break;
+    }
+    if (m_streams.empty()) {
+        playerLogError("flv: no stream found.\n");
+        return -1;
+    }
+    m_durationUs = (int64_t)(m_parser.getMetaData().duration * 1000000);
+    return 0;
+}
+
+/* 头中声明的流都出现了，AVC/HEVC/AAC 还要等到 sequence header */
+bool FLVDemuxer::isReady()
+{
+    const DemuxStreamInfo* stream;
+
+    if (m_headerFlags & 0x01) {
+        stream = getStream(m_videoStream);
+        if (stream == NULL || ((stream->codec == DemuxCodec_H264 || stream->codec == DemuxCodec_H265) && stream->extradata.empty()))
+            return false;
+    }
+    if (m_headerFlags & 0x04) {
+        stream = getStream(m_audioStream);
+        if (stream == NULL || (stream->codec == DemuxCodec_AAC && stream->extradata.empty()))
+            return false;
+    }
+    return true;
+}
+
+int FLVDemuxer::createStream(const FLVTag* tag)
+{
+    static const int soundRates[] = { 5512, 11025, 22050, 44100 };
+    DemuxStreamInfo info;
+
+    if (tag->type == FLVTag_Video) {
+        DemuxInitStream(&info, DemuxStream_Video, DemuxCodec_Unknown);
+        if (tag->codecId == FLVVideoCodec_AVC)
+            info.codec = DemuxCodec_H264;
+        else if (tag->codecId == FLVVideoCodec_HEVC)
+            info.codec = DemuxCodec_H265;
+        info.width = (int)m_parser.getMetaData().width;
+        info.height = (int)m_parser.getMetaData().height;
+        m_videoStream = addStream(info);
+        return m_videoStream;
+    }
+    DemuxInitStream(&info, DemuxStream_Audio, DemuxCodec_Unknown);
+    if (tag->codecId == FLVAudioCodec_AAC)
+        info.codec = DemuxCodec_AAC;
+    else if (tag->codecId == FLVAudioCodec_MP3 || tag->codecId == FLVAudioCodec_MP3_8K)
+        info.codec = DemuxCodec_MP3;
+    info.sampleRate = (tag->codecId == FLVAudioCodec_MP3_8K) ? 8000 : soundRates[tag->soundRate & 3];
+    info.channels = tag->soundType ? 2 : 1;
+    m_audioStream = addStream(info);
+    return m_audioStream;
+}
+
+void FLVDemuxer::onTag(const FLVTag* tag, void* userData)
+{
+    FLVDemuxer* self = (FLVDemuxer*)userData;
+    DemuxStreamInfo* stream;
+    DemuxPacket* packet;
+    int index;
+
+    if (tag->type == FLVTag_Video)
+        index = (self->m_videoStream >= 0) ? self->m_videoStream : self->createStream(tag);
+    else if (tag->type == FLVTag_Audio)
+        index = (self->m_audioStream >= 0) ? self->m_audioStream : self->createStream(tag);
+    else
+        return;
+    stream = &self->m_streams[index];
+
+    if (tag->isSequenceHeader) {
+        stream->extradata.assign(tag->data, tag->data + tag->size);
+        if (stream->codec == DemuxCodec_H264 || stream->codec == DemuxCodec_H265)
+            DemuxParseVideoConfig(tag->data, tag->size, stream);
+        else if (stream->codec == DemuxCodec_AAC)
+            DemuxParseAudioSpecificConfig(tag->data, tag->size, stream);
+        return;
+    }
+    if (!stream->enabled || tag->size <= 0)
+        return;
+
+    packet = self->allocPacket(index, tag->size);
+    if (packet == NULL)
+        return;
+    memcpy(packet->data, tag->data, tag->size);
+    packet->dtsUs = tag->timestamp * 1000;
+    packet->ptsUs = (tag->timestamp + tag->compositionTime) * 1000;
+    packet->fileOffset = tag->fileOffset;
+    if (tag->type == FLVTag_Audio || tag->isKeyframe)
+        packet->flags |= DemuxPacket_Keyframe;
+    self->queuePacket(packet);
+}
+
+int FLVDemuxer::seek(int64_t timeUs)
+{
+    int64_t offset;
+
+    if (m_parser.seekTo(timeUs / 1000, &offset, NULL) < 0)
+        return -1;
+    if (m_parser.resume(offset) < 0)
+        return -1;
+    restartAt(offset);
+    return 0;
+}
+
+static Demuxer* FLVDemuxerCreate()
+{
+    return new FLVDemuxer();
+}
+
+const DemuxerDescriptor g_FLVDemuxerDescriptor = { "flv", FLVDemuxerProbe, FLVDemuxerCreate };
+
+
+/* MP4 */
+static int MP4DemuxerProbe(const uint8_t* data, int size)
+{
+    uint32_t boxSize, type;
+
+    if (size < 8)
+        return 0;
+    boxSize = DemuxReadU32(data);
+    type = DemuxReadU32(data + 4);
+    if (boxSize != 0 && boxSize != 1 && boxSize < 8)
+        return 0;
+    if (type == MP4_FOURCC('f', 't', 'y', 'p') || type == MP4_FOURCC('s', 't', 'y', 'p'))
+        return 100;
+    if (type == MP4_FOURCC('m', 'o', 'o', 'v') || type == MP4_FOURCC('m', 'o', 'o', 'f') || type == MP4_FOURCC('m', 'd', 'a', 't')
+        || type == MP4_FOURCC('f', 'r', 'e', 'e') || type == MP4_FOURCC('s', 'k', 'i', 'p') || type == MP4_FOURCC('w', 'i', 'd', 'e'))
+        return 80;
+    return 0;
+}
+
+class MP4Demuxer : public Demuxer {
+    public:
+        MP4Demuxer() {}
+        ~MP4Demuxer() {}
+
+        const char* getName() { return "mp4"; }
+        int open(const DemuxSource& source);
+        void close();
+        int readPacket(DemuxPacket** packet);
+        int seek(int64_t timeUs) { return m_parser.seek(timeUs); }
+
+    private:
+        MP4Parser                   m_parser;
+};
+
+void MP4Demuxer::close()
+{
+    Demuxer::close();
+    m_parser.close();
+}
+
+int MP4Demuxer::open(const DemuxSource& source)
+{
+    MP4ByteSource byteSource;
+    int i;
+
+    close();
+    m_source = source;
+    byteSource.read = source.read;
+    byteSource.size = source.size;
+    byteSource.opaque = source.opaque;
+    if (m_parser.open(byteSource) < 0)
+        return -1;
+
+    //流下标与 track 下标相同，不支持的 track 也保留
+    for (i = 0; i < m_parser.getTrackCount(); i++) {
+        const MP4TrackInfo* track = m_parser.getTrack(i);
+        DemuxStreamInfo info;
+
+        DemuxInitStream(&info, DemuxStream_Data, DemuxCodec_Unknown);
+        info.id = track->trackId;
+        info.type = (track->type == MP4Track_Audio) ? DemuxStream_Audio :
+                    (track->type == MP4Track_Subtitle) ? DemuxStream_Subtitle :
+                    (track->type == MP4Track_Video) ? DemuxStream_Video : DemuxStream_Data;
+        info.durationUs = track->timescale ? track->duration * 1000000 / track->timescale : 0;
+        info.width = track->width;
+        info.height = track->height;
+        info.sampleRate = track->sampleRate;
+        info.channels = track->channels;
+        memcpy(info.language, track->language, sizeof(info.language));
+        if (track->codecConfig && track->codecConfigSize > 0)
+            info.extradata.assign(track->codecConfig, track->codecConfig + track->codecConfigSize);
+
+        switch (track->codec) {
+            case MP4_FOURCC('a', 'v', 'c', '1'):
+            case MP4_FOURCC('a', 'v', 'c', '3'):    info.codec = DemuxCodec_H264; break;
+            case MP4_FOURCC('h', 'v', 'c', '1'):
+            case MP4_FOURCC('h', 'e', 'v', '1'):    info.codec = DemuxCodec_H265; break;
+            case MP4_FOURCC('m', 'p', '4', 'a'):    info.codec = DemuxCodec_AAC; break;
+            case MP4_FOURCC('.', 'm', 'p', '3'):
+            case MP4_FOURCC('m', 'p', '3', ' '):    info.codec = DemuxCodec_MP3; break;
+            case MP4_FOURCC('a', 'c', '-', '3'):    info.codec = DemuxCodec_AC3; break;
+            case MP4_FOURCC('e', 'c', '-', '3'):    info.codec = DemuxCodec_EAC3; break;
+            case MP4_FOURCC('O', 'p', 'u', 's'):    info.codec = DemuxCodec_Opus; break;
+            case MP4_FOURCC('t', 'x', '3', 'g'):
+            case MP4_FOURCC('w', 'v', 't', 't'):    info.codec = DemuxCodec_Text; break;
+            default:                                break;
+        }
+        if ((info.codec == DemuxCodec_H264 || info.codec == DemuxCodec_H265) && !info.extradata.empty()) {
+            int lengthSize = 0;
+            NALUnit units[H26X_PARAMETER_SET_MAX];
+            if (H26xParseDecoderConfig(&info.extradata[0], info.extradata.size(),
+                                       info.codec == DemuxCodec_H265 ? H26xCodec_H265 : H26xCodec_H264,
+                                       units, H26X_PARAMETER_SET_MAX, &lengthSize) >= 0)
+                info.nalLengthSize = lengthSize;
+        }
+        addStream(info);
+    }
+    m_durationUs = m_parser.getDurationUs();
+    return 0;
+}
+
+int MP4Demuxer::readPacket(DemuxPacket** packet)
+{
+    MP4Sample sample;
+    DemuxPacket* result;
+    int ret;
+
+    if (packet == NULL)
+        return -1;
+    for (;;) {
+        ret = m_parser.readSample(&sample);
+        if (ret != 0)
+            return ret;
+        if (getStream(sample.track) && m_streams[sample.track].enabled)
+            break;
+    }
+    result = allocPacket(sample.track, sample.size);
+    if (result == NULL)
+        return -1;
+    if (m_parser.readSampleData(&sample, result->data, result->size) < 0) {
+        DemuxPacketUnref(result);
+        return -1;
+    }
+    result->ptsUs = sample.ptsUs;
+    result->dtsUs = sample.dtsUs;
+    result->fileOffset = sample.offset;
+    if (sample.isKeyframe)
+        result->flags |= DemuxPacket_Keyframe;
+    *packet = result;
+    return 0;
+}
+
+static Demuxer* MP4DemuxerCreate()
+{
+    return new MP4Demuxer();
+}
+
+const DemuxerDescriptor g_MP4DemuxerDescriptor = { "mp4", MP4DemuxerProbe, MP4DemuxerCreate };
+
+
+/* MP3 */
+static int MP3DemuxerProbe(const uint8_t* data, int size)
+{
+    MP3FrameHeader header;
+    int64_t start = 0;
+    int offset, count = 0, limit;
+
+    if (size >= MP3_ID3V2_HEADER_SIZE)
+        start = MP3ID3v2Size(data, size);
+    if (start >= size)
+        return (start > 0) ? 50 : 0;        //ID3v2 比探测的数据还大
+
+    //只在开头 4KB 内找第一帧，避免在其他格式中误判
+    limit = std::min<int64_t>(size - MP3_FRAME_HEADER_SIZE, start + 4096);
+    for (offset = (int)start; offset < limit; offset++) {
+        if (data[offset] == 0xFF && MP3ParseFrameHeader(data + offset, &header) == 0)
+            break;
+    }
+    while (offset + MP3_FRAME_HEADER_SIZE <= size && count < PROBE_CHAIN_MAX
+           && MP3ParseFrameHeader(data + offset, &header) == 0) {
+        count++;
+        offset += header.frameSize;
+    }
+    if (count >= 3)
+        return count * 20;
+    return (start > 0) ? 50 : 0;
+}
+
+class MP3Demuxer : public Demuxer {
+    public:
+        MP3Demuxer() : m_seekUs(-1) {}
+        ~MP3Demuxer() {}
+
+        const char* getName() { return "mp3"; }
+        int open(const DemuxSource& source);
+        void close();
+        int seek(int64_t timeUs);
+
+    protected:
+        int feed(const uint8_t* data, int size) { return m_parser.parse(data, size); }
+        void feedEnd() { m_parser.flush(); }
+
+    private:
+        static void onInfo(const MP3Info* info, void* userData);
+        static void onFrame(const MP3Frame* frame, void* userData);
+
+        MP3Parser                   m_parser;
+        int64_t                     m_seekUs;           //seek 表只精确到 MP3_SEEK_INDEX_INTERVAL 帧，之前的帧丢弃
+};
+
+void MP3Demuxer::close()
+{
+    Demuxer::close();
+    m_parser.reset();
+    m_seekUs = -1;
+}
+
+int MP3Demuxer::open(const DemuxSource& source)
+{
+    MP3ParserCallbacks callbacks;
+
+    close();
+    m_source = source;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onInfo = onInfo;
+    callbacks.onFrame = onFrame;
+    callbacks.userData = this;
+    m_parser.setCallbacks(callbacks);
+
+    if (source.size > 0) {
+        std::vector<uint8_t> tail(std::min<int64_t>(source.size, MP3_TAIL_SIZE));
+        if (readSource(source.size - tail.size(), &tail[0], tail.size()) == (int)tail.size())
+            m_parser.parseTail(&tail[0], tail.size(), source.size);
+    }
+    while (m_parser.getInfo() == NULL && m_readOffset < DEMUX_OPEN_SCAN_MAX) {
+        int size = feedChunk();
+        if (size < 0)
+            return -1;
+        if (size == 0)
+            break;
+    }
+    if (m_parser.getInfo() == NULL || m_streams.empty()) {
+        playerLogError("mp3: no audio frame found.\n");
+        return -1;
+    }
+    m_durationUs = m_streams[0].durationUs = m_parser.getInfo()->durationUs;
+    return 0;
+}
+
+void MP3Demuxer::onInfo(const MP3Info* info, void* userData)
+{
+    MP3Demuxer* self = (MP3Demuxer*)userData;
+    DemuxStreamInfo stream;
+
+    if (!self->m_streams.empty())
+        return;
+    DemuxInitStream(&stream, DemuxStream_Audio, DemuxCodec_MP3);
+    stream.durationUs = info->durationUs;
+    stream.sampleRate = info->sampleRate;
+    stream.channels = info->channels;
+    self->addStream(stream);
+}
+
+void MP3Demuxer::onFrame(const MP3Frame* frame, void* userData)
+{
+    MP3Demuxer* self = (MP3Demuxer*)userData;
+    DemuxPacket* packet;
+
+    if (self->m_streams.empty() || !self->m_streams[0].enabled)
+        return;
+    if (self->m_seekUs >= 0) {
+        if (frame->ptsUs + frame->durationUs <= self->m_seekUs)
+            return;
+        self->m_seekUs = -1;
+    }
+    packet = self->allocPacket(0, frame->size);
+    if (packet == NULL)
+        return;
+    memcpy(packet->data, frame->data, frame->size);
+    packet->ptsUs = packet->dtsUs = frame->ptsUs;
+    packet->fileOffset = frame->fileOffset;
+    packet->flags |= DemuxPacket_Keyframe;
+    self->queuePacket(packet);
+}
+
+int MP3Demuxer::seek(int64_t timeUs)
+{
+    int64_t offset, frameTimeUs;
+
+    if (m_parser.seekTo(timeUs, &offset, &frameTimeUs) < 0)
+        return -1;
+    m_parser.resume(offset, frameTimeUs);
+    restartAt(offset);
+    m_seekUs = timeUs;
+    return 0;
+}
+
+static Demuxer* MP3DemuxerCreate()
+{
+    return new MP3Demuxer();
+}
+
+const DemuxerDescriptor g_MP3DemuxerDescriptor = { "mp3", MP3DemuxerProbe, MP3DemuxerCreate };
+
+
+/* H.264/H.265 裸码流 */
+static int ESDemuxerDetect(const uint8_t* data, int size, int* codec)
+{
+    const uint8_t* start = H26xFindStartCode(data, data + std::min(size, 64));
+    const uint8_t* nal;
+    int i;
+
+    //开头只能是起始码前面的 0
+    if (start >= data + std::min(size, 64) || start + 5 > data + size)
+        return 0;
+    for (i = 0; data + i < start; i++) {
+        if (data[i] != 0)
+            return 0;
+    }
+    nal = start + 3;
+    if ((nal[0] & 0x81) == 0 && nal[1] == 0x01) {
+        int type = (nal[0] >> 1) & 0x3F;
+        if (type == H265Nal_VPS || type == H265Nal_AUD || type == H265Nal_PrefixSEI) {
+            *codec = DemuxCodec_H265;
+            return 60;
+        }
+    }
+    if ((nal[0] & 0x80) == 0) {
+        int type = nal[0] & 0x1F;
+        if ((type == H264Nal_SPS && (nal[0] & 0x60)) || (type == H264Nal_AUD && (nal[0] & 0x60) == 0)
+            || (type == H264Nal_SEI && (nal[0] & 0x60) == 0)) {
+            *codec = DemuxCodec_H264;
+            return 60;
+        }
+    }
+    return 0;
+}
+
+static int ESDemuxerProbe(const uint8_t* data, int size)
+{
+    int codec;
+
+    return ESDemuxerDetect(data, size, &codec);
+}
+
+class ESDemuxer : public Demuxer {
+    public:
+        ESDemuxer() : m_frameIndex(0), m_frameSize(0) {}
+        ~ESDemuxer() {}
+
+        const char* getName() { return "h26x"; }
+        int open(const DemuxSource& source);
+        void close();
+        int seek(int64_t timeUs);
+
+    protected:
+        int feed(const uint8_t* data, int size) { return m_parser.parse(data, size, -1, -1); }
+        void feedEnd() { m_parser.flush(); }
+
+    private:
+        static void onAccessUnit(const H26xAccessUnit* au, void* userData);
+
+        H264Parser                  m_parser;
+        int64_t                     m_frameIndex;       //下一帧的序号，作为时间戳
+        double                      m_frameSize;        //open() 时统计的平均帧大小，seek 使用
+};
+
+void ESDemuxer::close()
+{
+    Demuxer::close();
+    m_parser.reset();
+    m_frameIndex = 0;
+    m_frameSize = 0;
+}
+
+int ESDemuxer::open(const DemuxSource& source)
+{
+    H264ParserCallbacks callbacks;
+    DemuxStreamInfo info;
+    uint8_t probe[64];
+    int size, codec = DemuxCodec_Unknown;
+
+    close();
+    m_source = source;
+    size = readSource(0, probe, sizeof(probe));
+    if (size <= 0 || ESDemuxerDetect(probe, size, &codec) == 0)
+        return -1;
+
+    DemuxInitStream(&info, DemuxStream_Video, codec);
+    addStream(info);
+
+    m_parser.setCodec(codec == DemuxCodec_H265 ? H26xCodec_H265 : H26xCodec_H264);
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onAccessUnit = onAccessUnit;
+    callbacks.userData = this;
+    m_parser.setCallbacks(callbacks);
+    while ((m_parser.getVideoInfo() == NULL || m_queue.empty()) && m_readOffset < DEMUX_OPEN_SCAN_MAX) {
+        size = feedChunk();
+        if (size < 0)
+            return -1;
+        if (size == 0)
+            break;
+    }
+    if (m_parser.getVideoInfo() == NULL) {
+        playerLogError("h26x: no sequence parameter set found.\n");
+        return -1;
+    }
+    m_streams[0].width = m_parser.getVideoInfo()->width;
+    m_streams[0].height = m_parser.getVideoInfo()->height;
+
+    //没有时间戳，按已读数据的平均帧大小估计时长
+    if (m_frameIndex > 0)
+        m_frameSize = (double)m_readOffset / m_frameIndex;
+    if (m_eof)
+        m_durationUs = m_frameIndex * ES_FRAME_DURATION_US;
+    else if (m_frameSize > 0 && source.size > 0)
+        m_durationUs = (int64_t)(source.size / m_frameSize) * ES_FRAME_DURATION_US;
+    m_streams[0].durationUs = m_durationUs;
+    return 0;
+}
+
+void ESDemuxer::onAccessUnit(const H26xAccessUnit* au, void* userData)
+{
+    ESDemuxer* self = (ESDemuxer*)userData;
+    DemuxPacket* packet;
+
+    if (!self->m_streams[0].enabled) {
+        self->m_frameIndex++;
+        return;
+    }
+    packet = self->allocPacket(0, au->size);
+    if (packet == NULL)
+        return;
+    memcpy(packet->data, au->data, au->size);
+    packet->ptsUs = packet->dtsUs = self->m_frameIndex * ES_FRAME_DURATION_US;
+    if (au->isKeyframe)
+        packet->flags |= DemuxPacket_Keyframe;
+    self->m_frameIndex++;
+    self->queuePacket(packet);
+}
+
+int ESDemuxer::seek(int64_t timeUs)
+{
+    int64_t frame = timeUs / ES_FRAME_DURATION_US, offset;
+
+    if (m_frameSize <= 0)
+        return -1;
+    if (frame == 0) {
+        offset = 0;
+    } else {
+        //平均帧大小只是估计，没有精确的索引
+        offset = (int64_t)(m_frameSize * frame);
+        if (m_source.size > 0 && offset >= m_source.size)
+            return -1;
+    }
+    m_parser.reset();
+    restartAt(offset);
+    m_frameIndex = frame;
+    return 0;
+}
+
+static Demuxer* ESDemuxerCreate()
+{
+    return new ESDemuxer();
+}
+
+const DemuxerDescriptor g_ESDemuxerDescriptor = { "h26x", ESDemuxerProbe, ESDemuxerCreate };
@@ -0,0 +1,443 @@
+/**
+ *  FLVParser.cpp文件
+ *  增量 FLV 解析，用于 HTTP 渐进下载播放；
+ *  主要有以下部分：
+ *          FLV 头和 audio/video/script tag 解析
+ *          AVC/HEVC/AAC sequence header
+ *          onMetaData (AMF0) 和其中的 keyframes 表
+ *          关键帧索引，seek 时二分查找
+ *
+ *  完整落在本次输入中的 tag 直接在调用者的缓冲区上解析，只有跨越两次 parse() 的 tag 才拷贝到 m_pending。
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "FLVParser.h"
+
+
+static inline uint32_t FLVReadU16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static inline uint32_t FLVReadU24(const uint8_t* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+static inline uint32_t FLVReadU32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+static double FLVReadDouble(const uint8_t* p)
+{
+    uint64_t bits = ((uint64_t)FLVReadU32(p) << 32) | FLVReadU32(p + 4);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool FLVKeyIs(const char* key, int keyLength, const char* name)
+{
+    return key != NULL && (int)strlen(name) == keyLength && memcmp(key, name, keyLength) == 0;
+}
+
+static bool FLVKeyframeTimeLess(const FLVKeyframe& a, const FLVKeyframe& b)
+{
+    return a.timeMs < b.timeMs;
+}
+
+static bool FLVKeyframeTimeEqual(const FLVKeyframe& a, const FLVKeyframe& b)
+{
+    return a.timeMs == b.timeMs;
+}
+
+
+FLVParser::FLVParser()
+{
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    reset();
+}
+
+
+void FLVParser::setCallbacks(const FLVParserCallbacks& callbacks)
+{
+    m_callbacks = callbacks;
+}
+
+
+void FLVParser::reset()
+{
+    memset(&m_metaData, 0, sizeof(m_metaData));
+    m_index.clear();
+    m_indexFromMetaData = false;
+    m_videoSequenceHeader.clear();
+    m_audioSequenceHeader.clear();
+    m_pending.clear();
+    m_fileOffset = 0;
+    m_skip = 0;
+    m_state = StateHeader;
+}
+
+
+int FLVParser::resume(int64_t fileOffset)
+{
+    if (fileOffset < 0)
+        return -1;
+    m_pending.clear();
+    m_skip = 0;
+    m_fileOffset = fileOffset;
+    m_state = (fileOffset == 0) ? StateHeader : StateTag;
+    return 0;
+}
+
+
+int FLVParser::seekTo(int64_t timeMs, int64_t* fileOffset, int64_t* keyframeTimeMs)
+{
+    std::vector<FLVKeyframe>::iterator it;
+    FLVKeyframe target;
+
+    if (m_index.empty() || fileOffset == NULL)
+        return -1;
+
+    target.timeMs = timeMs;
+    target.fileOffset = 0;
+    it = std::upper_bound(m_index.begin(), m_index.end(), target, FLVKeyframeTimeLess);
+    if (it != m_index.begin())
+        --it;
+    *fileOffset = it->fileOffset;
+    if (keyframeTimeMs != NULL)
+        *keyframeTimeMs = it->timeMs;
+    return 0;
+}
+
+
+//当前状态下一个完整单元的大小，数据不足以判断时返回需要的最小字节数，格式错误时返回 -1
+int FLVParser::unitSize(const uint8_t* data, int length)
+{
+    uint32_t dataSize;
+
+    if (m_state == StateHeader)
+        return FLV_HEADER_SIZE;
+    if (length < FLV_TAG_HEADER_SIZE)
+        return FLV_TAG_HEADER_SIZE;
+
+    dataSize = FLVReadU24(data + 1);
+    //保留位和 StreamID 必须为 0
+    if ((data[0] & 0xC0) || FLVReadU24(data + 8) != 0 || dataSize > FLV_TAG_DATA_SIZE_MAX)
+        return -1;
+    return FLV_TAG_HEADER_SIZE + dataSize + FLV_PREVIOUS_TAG_SIZE;
+}
+
+
+int FLVParser::parse(const uint8_t* data, int length)
+{
+    int pos = 0;
+
+    if (data == NULL || length < 0 || m_state == StateError)
+        return -1;
+
+    while (pos < length || !m_pending.empty()) {
+        int size;
+
+        if (m_skip > 0) {
+            int count = (m_skip < length - pos) ? m_skip : length - pos;
+            if (count == 0)
+                break;
+            pos += count;
+            m_skip -= count;
+            m_fileOffset += count;
+            continue;
+        }
+
+        if (!m_pending.empty()) {
+            //补全上次剩下的单元
+            size = unitSize(&m_pending[0], m_pending.size());
+            while (size > 0 && (int)m_pending.size() < size && pos < length) {
+                int count = size - m_pending.size();
+                if (count > length - pos)
+                    count = length - pos;
+                m_pending.insert(m_pending.end(), data + pos, data + pos + count);
+                pos += count;
+                size = unitSize(&m_pending[0], m_pending.size());
+            }
+            if (size < 0)
+                break;
+            if ((int)m_pending.size() < size)
+                return length;
+            if (processUnit(&m_pending[0], size) < 0)
+                break;
+            m_fileOffset += size;
+            m_pending.clear();
+            continue;
+        }
+
+        size = unitSize(data + pos, length - pos);
+        if (size < 0)
+            break;
+        if (length - pos < size) {
+            m_pending.assign(data + pos, data + length);
+            return length;
+        }
+        if (processUnit(data + pos, size) < 0)
+            break;
+        pos += size;
+        m_fileOffset += size;
+    }
+
+    if (pos < length || !m_pending.empty()) {
+        playerLogError("invalid flv data at offset [%lld].\n", (long long)m_fileOffset);
+        m_pending.clear();
+        m_state = StateError;
+        return -1;
+    }
+    return length;
+}
+
+
+int FLVParser::processUnit(const uint8_t* data, int length)
+{
+    if (m_state == StateHeader)
+        return processHeader(data);
+    return processTag(data, length);
+}
+
+
+int FLVParser::processHeader(const uint8_t* data)
+{
+    uint32_t dataOffset;
+
+    if (data[0] != 'F' || data[1] != 'L' || data[2] != 'V') {
+        playerLogError("not a flv file.\n");
+        return -1;
+    }
+    dataOffset = FLVReadU32(data + 5);
+    if (dataOffset < FLV_HEADER_SIZE || dataOffset > 1024)
+        return -1;
+    playerLogDebug("flv version [%d], audio [%d], video [%d].\n", data[3], (data[4] >> 2) & 1, data[4] & 1);
+
+    m_skip = dataOffset - FLV_HEADER_SIZE + FLV_PREVIOUS_TAG_SIZE;     //PreviousTagSize0
+    m_state = StateTag;
+    return 0;
+}
+
+
+int FLVParser::processTag(const uint8_t* data, int length)
+{
+    int dataSize = FLVReadU24(data + 1);
+    const uint8_t* body = data + FLV_TAG_HEADER_SIZE;
+    FLVTag tag;
+
+    if (FLVReadU32(body + dataSize) != (uint32_t)(FLV_TAG_HEADER_SIZE + dataSize))
+        playerLogDebug("PreviousTagSize mismatch at offset [%lld].\n", (long long)m_fileOffset);
+    if ((data[0] & 0x20) || dataSize == 0)      //加密的 tag 不处理
+        return 0;
+
+    memset(&tag, 0, sizeof(tag));
+    tag.type = data[0] & 0x1F;
+    tag.fileOffset = m_fileOffset;
+    tag.timestamp = FLVReadU24(data + 4) | ((uint32_t)data[7] << 24);
+
+    switch (tag.type) {
+    case FLVTag_Video: {
+        int frameType = body[0] >> 4;
+        tag.codecId = body[0] & 0x0F;
+        tag.isKeyframe = (frameType == 1);
+        if (frameType == 5)             //video info/command frame
+            return 0;
+        if (tag.codecId == FLVVideoCodec_AVC || tag.codecId == FLVVideoCodec_HEVC) {
+            int32_t compositionTime;
+            if (dataSize < 5)
+                return 0;
+            compositionTime = FLVReadU24(body + 2);
+            if (compositionTime & 0x800000)
+                compositionTime |= 0xFF000000;
+            tag.compositionTime = compositionTime;
+            if (body[1] == 2)           //end of sequence
+                return 0;
+            tag.isSequenceHeader = (body[1] == 0);
+            tag.data = body + 5;
+            tag.size = dataSize - 5;
+            if (tag.isSequenceHeader)
+                m_videoSequenceHeader.assign(tag.data, tag.data + tag.size);
+        } else {
+            //VP6 有 1 字节的宽高调整，VP6 alpha 有 4 字节的 alpha 偏移
+            int skip = 1 + ((tag.codecId == FLVVideoCodec_VP6) ? 1 : (tag.codecId == FLVVideoCodec_VP6Alpha) ? 4 : 0);
+            if (dataSize < skip)
+                return 0;
+            tag.data = body + skip;
+            tag.size = dataSize - skip;
+        }
+        //sequence header 与其后的关键帧时间相同，索引指向 sequence header，resume 后解码器先拿到配置
+        if (tag.isKeyframe && !m_indexFromMetaData)
+            addKeyframe(tag.timestamp, tag.fileOffset);
+        break;
+    }
+    case FLVTag_Audio:
+        tag.codecId = body[0] >> 4;
+        tag.soundRate = (body[0] >> 2) & 0x03;
+        tag.soundSize = (body[0] >> 1) & 0x01;
+        tag.soundType = body[0] & 0x01;
+        if (tag.codecId == FLVAudioCodec_AAC) {
+            if (dataSize < 2)
+                return 0;
+            tag.isSequenceHeader = (body[1] == 0);
+            tag.data = body + 2;
+            tag.size = dataSize - 2;
+            if (tag.isSequenceHeader)
+                m_audioSequenceHeader.assign(tag.data, tag.data + tag.size);
+        } else {
+            tag.data = body + 1;
+            tag.size = dataSize - 1;
+        }
+        break;
+    case FLVTag_Script:
+        processScript(body, dataSize);
+        return 0;
+    default:
+        return 0;
+    }
+
+    if (m_callbacks.onTag)
+        m_callbacks.onTag(&tag, m_callbacks.userData);
+    return 0;
+}
+
+
+void FLVParser::processScript(const uint8_t* data, int length)
+{
+    int consumed;
+    size_t i;
+
+    //第一个值为名称，只处理 onMetaData
+    if (length < 13 || data[0] != 2 || FLVReadU16(data + 1) != 10 || memcmp(data + 3, "onMetaData", 10) != 0)
+        return;
+
+    m_metaPositions.clear();
+    m_metaTimes.clear();
+    consumed = parseAmfValue(data + 13, length - 13, 0, NULL, 0);
+    if (consumed < 0)
+        playerLogWarning("invalid onMetaData, parsed fields are kept.\n");
+
+    if (!m_metaPositions.empty() && m_metaPositions.size() == m_metaTimes.size()) {
+        m_index.clear();
+        for (i = 0; i < m_metaPositions.size(); i++) {
+            FLVKeyframe keyframe;
+            keyframe.timeMs = (int64_t)(m_metaTimes[i] * 1000 + 0.5);
+            keyframe.fileOffset = (int64_t)m_metaPositions[i];
+            m_index.push_back(keyframe);
+        }
+        //sequence header 和关键帧常常以相同的时间出现在表中，保留位置靠前的一个
+        std::stable_sort(m_index.begin(), m_index.end(), FLVKeyframeTimeLess);
+        m_index.erase(std::unique(m_index.begin(), m_index.end(), FLVKeyframeTimeEqual), m_index.end());
+        m_indexFromMetaData = true;
+        m_metaData.keyframeCount = m_index.size();
+    }
+    m_metaPositions.clear();
+    m_metaTimes.clear();
+
+    playerLogDebug("onMetaData duration [%f], keyframes [%d].\n", m_metaData.duration, m_metaData.keyframeCount);
+    if (m_callbacks.onMetaData)
+        m_callbacks.onMetaData(&m_metaData, m_callbacks.userData);
+}
+
+
+//解析一个 AMF0 值，key 为所属的属性名(数组元素为数组的属性名)，返回使用的字节数
+int FLVParser::parseAmfValue(const uint8_t* data, int length, int depth, const char* key, int keyLength)
+{
+    int pos = 1;
+    uint32_t count, i;
+
+    if (length < 1 || depth > FLV_AMF_DEPTH_MAX)
+        return -1;
+
+    switch (data[0]) {
+    case 0: {   //number
+        double value;
+        if (length < 9)
+            return -1;
+        value = FLVReadDouble(data + 1);
+        if (FLVKeyIs(key, keyLength, "duration"))               m_metaData.duration = value;
+        else if (FLVKeyIs(key, keyLength, "width"))             m_metaData.width = value;
+        else if (FLVKeyIs(key, keyLength, "height"))            m_metaData.height = value;
+        else if (FLVKeyIs(key, keyLength, "framerate"))         m_metaData.frameRate = value;
+        else if (FLVKeyIs(key, keyLength, "videodatarate"))     m_metaData.videoDataRate = value;
+        else if (FLVKeyIs(key, keyLength, "audiodatarate"))     m_metaData.audioDataRate = value;
+        else if (FLVKeyIs(key, keyLength, "audiosamplerate"))   m_metaData.audioSampleRate = value;
+        else if (FLVKeyIs(key, keyLength, "videocodecid"))      m_metaData.videoCodecId = (int)value;
+        else if (FLVKeyIs(key, keyLength, "audiocodecid"))      m_metaData.audioCodecId = (int)value;
+        else if (FLVKeyIs(key, keyLength, "filesize"))          m_metaData.fileSize = (int64_t)value;
+        else if (FLVKeyIs(key, keyLength, "filepositions"))     m_metaPositions.push_back(value);
+        else if (FLVKeyIs(key, keyLength, "times"))             m_metaTimes.push_back(value);
+        return 9;
+    }
+    case 1:     //boolean
+        if (length < 2)
+            return -1;
+        if (FLVKeyIs(key, keyLength, "stereo"))
+            m_metaData.stereo = data[1];
+        return 2;
+    case 2:     //string
+        if (length < 3 || (int)(3 + FLVReadU16(data + 1)) > length)
+            return -1;
+        return 3 + FLVReadU16(data + 1);
+    case 12:    //long string
+        if (length < 5 || (int64_t)5 + FLVReadU32(data + 1) > length)
+            return -1;
+        return 5 + FLVReadU32(data + 1);
+    case 8:     //ECMA array，4 字节个数之后与 object 相同
+        pos += 4;
+        //no break
+    case 3:     //object
+        for (;;) {
+            int nameLength, consumed;
+            if (pos + 3 > length)
+                return (data[0] == 8 && pos == length) ? pos : -1;      //有的文件 ECMA array 没有结束标记
+            nameLength = FLVReadU16(data + pos);
+            if (nameLength == 0 && data[pos + 2] == 9)
+                return pos + 3;
+            if (pos + 2 + nameLength > length)
+                return -1;
+            consumed = parseAmfValue(data + pos + 2 + nameLength, length - pos - 2 - nameLength, depth + 1,
+                                    (const char*)data + pos + 2, nameLength);
+            if (consumed < 0)
+                return -1;
+            pos += 2 + nameLength + consumed;
+        }
+    case 10:    //strict array
+        if (length < 5)
+            return -1;
+        count = FLVReadU32(data + 1);
+        pos = 5;
+        for (i = 0; i < count; i++) {
+            int consumed = parseAmfValue(data + pos, length - pos, depth + 1, key, keyLength);
+            if (consumed < 0)
+                return -1;
+            pos += consumed;
+        }
+        return pos;
+    case 11:    //date
+        return (length < 11) ? -1 : 11;
+    case 5:     //null
+    case 6:     //undefined
+    case 9:     //object end
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+
+//没有 onMetaData 索引时，在第一次顺序读取的过程中建立
+void FLVParser::addKeyframe(int64_t timeMs, int64_t fileOffset)
+{
+    FLVKeyframe keyframe;
+    std::vector<FLVKeyframe>::iterator it;
+
+    keyframe.timeMs = timeMs;
+    keyframe.fileOffset = fileOffset;
+    if (m_index.empty() || timeMs > m_index.back().timeMs) {
+        m_index.push_back(keyframe);
+        return;
+    }
+    //seek 之后重复读到的部分
+    it = std::lower_bound(m_index.begin(), m_index.end(), keyframe, FLVKeyframeTimeLess);
+    if (it != m_index.end() && it->timeMs == timeMs)
+        return;
+    m_index.insert(it, keyframe);
+}
@@ -1 +1,148 @@
- 
\ No newline at end of file
+#ifndef __FLV_PARSER_H__
+#define __FLV_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     FLV_HEADER_SIZE             9
+#define     FLV_TAG_HEADER_SIZE         11
+#define     FLV_PREVIOUS_TAG_SIZE       4
+#define     FLV_TAG_DATA_SIZE_MAX       (16 * 1024 * 1024)
+#define     FLV_AMF_DEPTH_MAX           8
+
+
+typedef enum {
+    FLVTag_Audio    = 8,
+    FLVTag_Video    = 9,
+    FLVTag_Script   = 18
+} FLVTagType;
+
+typedef enum {
+    FLVVideoCodec_H263          = 2,
+    FLVVideoCodec_ScreenVideo   = 3,
+    FLVVideoCodec_VP6           = 4,
+    FLVVideoCodec_VP6Alpha      = 5,
+    FLVVideoCodec_ScreenVideo2  = 6,
+    FLVVideoCodec_AVC           = 7,
+    FLVVideoCodec_HEVC          = 12        //非标准扩展，国内 CDN 常用
+} FLVVideoCodec;
+
+typedef enum {
+    FLVAudioCodec_PCM           = 0,
+    FLVAudioCodec_ADPCM         = 1,
+    FLVAudioCodec_MP3           = 2,
+    FLVAudioCodec_PCMLE         = 3,
+    FLVAudioCodec_Nellymoser    = 6,
+    FLVAudioCodec_G711A         = 7,
+    FLVAudioCodec_G711U         = 8,
+    FLVAudioCodec_AAC           = 10,
+    FLVAudioCodec_Speex         = 11,
+    FLVAudioCodec_MP3_8K        = 14
+} FLVAudioCodec;
+
+
+typedef struct _FLVTag {
+    int             type;               //FLVTagType
+    int64_t         fileOffset;         //tag 头在文件中的位置
+    int64_t         timestamp;          //ms，即 DTS
+    int             compositionTime;    //AVC/HEVC 的 CTS，PTS = timestamp + compositionTime
+    int             codecId;            //FLVVideoCodec / FLVAudioCodec
+    int             isKeyframe;
+    int             isSequenceHeader;   //AVCDecoderConfigurationRecord / AudioSpecificConfig
+    int             soundRate;          //音频: 0:5.5k 1:11k 2:22k 3:44k
+    int             soundSize;          //音频: 0:8bit 1:16bit
+    int             soundType;          //音频: 0:mono 1:stereo
+    const uint8_t*  data;               //去掉编码头之后的数据，只在回调中有效
+    int             size;
+} FLVTag;
+
+typedef struct _FLVKeyframe {
+    int64_t         timeMs;
+    int64_t         fileOffset;         //关键帧 tag 头的位置
+} FLVKeyframe;
+
+typedef struct _FLVMetaData {
+    double          duration;           //秒
+    double          width;
+    double          height;
+    double          frameRate;
+    double          videoDataRate;      //kbps
+    double          audioDataRate;
+    double          audioSampleRate;
+    int             videoCodecId;
+    int             audioCodecId;
+    int             stereo;
+    int64_t         fileSize;
+    int             keyframeCount;      //onMetaData 中 keyframes 表的大小
+} FLVMetaData;
+
+typedef struct _FLVParserCallbacks {
+    void (*onTag)(const FLVTag* tag, void* userData);
+    void (*onMetaData)(const FLVMetaData* metaData, void* userData);
+    void*   userData;
+} FLVParserCallbacks;
+
+
+class FLVParser { /* 增量 FLV 解析：数据可以按任意大小分块输入(HTTP 渐进下载)，同时建立关键帧索引用于 seek */
+    public:
+        FLVParser();
+        ~FLVParser(){}
+
+        void setCallbacks(const FLVParserCallbacks& callbacks);
+        int parse(const uint8_t* data, int length);     //出错时返回 -1，需要 resume() 或 reset()
+        int resume(int64_t fileOffset);                 //之后的数据从 fileOffset 开始，fileOffset 为 0 或 tag 头位置(seekTo 的结果)
+        void reset();
+
+        /**
+         *  @Func: seekTo
+         *         ps. :二分查找 timeMs 之前最近的关键帧；没有 onMetaData 索引时只能找到已解析过的部分
+         *  @Param: timeMs, type:: int64_t
+         *  @Param: fileOffset, type:: int64_t*, 关键帧 tag 的位置，用于 resume() 和 HTTP Range 请求
+         *  @Param: keyframeTimeMs, type:: int64_t*, 可为 NULL
+         *  @Return: int, 没有索引时返回 -1
+         *
+         **/
+        int seekTo(int64_t timeMs, int64_t* fileOffset, int64_t* keyframeTimeMs);
+
+        const FLVMetaData& getMetaData() { return m_metaData; }
+        const std::vector<FLVKeyframe>& getKeyframeIndex() { return m_index; }
+        bool isIndexFromMetaData() { return m_indexFromMetaData; }
+        const std::vector<uint8_t>& getVideoSequenceHeader() { return m_videoSequenceHeader; }
+        const std::vector<uint8_t>& getAudioSequenceHeader() { return m_audioSequenceHeader; }
+        int64_t getFileOffset() { return m_fileOffset; }
+
+    private:
+        int unitSize(const uint8_t* data, int length);
+        int processUnit(const uint8_t* data, int length);
+        int processHeader(const uint8_t* data);
+        int processTag(const uint8_t* data, int length);
+        void processScript(const uint8_t* data, int length);
+        int parseAmfValue(const uint8_t* data, int length, int depth, const char* key, int keyLength);
+        void addKeyframe(int64_t timeMs, int64_t fileOffset);
+
+        enum { StateHeader = 0, StateTag, StateError };
+
+        FLVParserCallbacks          m_callbacks;
+        FLVMetaData                 m_metaData;
+        std::vector<FLVKeyframe>    m_index;                //按时间排序
+        std::vector<double>         m_metaPositions;        //解析 onMetaData 的 keyframes 时暂存
+        std::vector<double>         m_metaTimes;
+        bool                        m_indexFromMetaData;
+        std::vector<uint8_t>        m_videoSequenceHeader;
+        std::vector<uint8_t>        m_audioSequenceHeader;
+        std::vector<uint8_t>        m_pending;              //跨 parse() 的不完整的 tag
+        int64_t                     m_fileOffset;           //下一个未处理字节在文件中的位置
+        int                         m_skip;
+        int                         m_state;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__FLV_PARSER_H__
@@ -0,0 +1,646 @@
+/**
+ *  FastChannelChange.cpp文件
+ *  快速换台；
+ *  主要有以下部分：
+ *      1. FCCChannel：每个频道一个读取线程。预取时遇到视频关键帧就丢弃之前的缓存，
+ *         所以缓存总是从最近的关键帧开始；播放时按顺序交给解码，领先太多时等待
+ *      2. 内存上限按预取频道平分，一个 GOP 超过上限时丢弃，等下一个关键帧；带宽上限按 packet 字节限速
+ *      3. FastChannelChange：换台时交出已经预取的频道，再按新的位置调整前后 N 个预取频道；
+ *         不再需要的频道先通知停止，线程结束后才回收，换台不会等待网络读取
+ *      4. 换台时间直方图：zapTo() 到播放器报告第一帧显示
+ *
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "SettingsRegistry.h"
+#include "RTPReceiver.h"
+#include "HLSClient.h"
+#include "FastChannelChange.h"
+
+
+const int FCCHistogramBounds[FCC_HISTOGRAM_BUCKETS] = { 50, 100, 200, 350, 500, 1000, 2000, 0x7FFFFFFF };
+
+
+static int64_t FCCNowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* pthread_cond_timedwait 使用 CLOCK_REALTIME */
+static void FCCDeadline(struct timespec* deadline, int64_t waitUs)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    deadline->tv_sec = now.tv_sec + waitUs / 1000000;
+    deadline->tv_nsec = (now.tv_usec + waitUs % 1000000) * 1000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/* 默认的数据源：rtp:// 组播/单播，http:// 的 m3u8，其他按本地文件 */
+static int FCCOpenFile(void* userData, const char* url, DemuxSource* source)
+{
+    (void)userData;
+    if (strncmp(url, "rtp://", 6) == 0)
+        return DemuxSourceOpenRTP(source, url);
+    if (HLSIsPlaylistUrl(url))
+        return DemuxSourceOpenHLS(source, url);
+    return DemuxSourceOpenFile(source, url);
+}
+
+static void FCCCloseFile(void* userData, DemuxSource* source)
+{
+    (void)userData;
+    if (DemuxSourceIsRTP(source))
+        DemuxSourceCloseRTP(source);
+    else if (DemuxSourceIsHLS(source))
+        DemuxSourceCloseHLS(source);
+    else
+        DemuxSourceCloseFile(source);
+}
+
+static int64_t FCCPacketTime(const DemuxPacket* packet)
+{
+    return packet->dtsUs != DEMUX_TIMESTAMP_NONE ? packet->dtsUs : packet->ptsUs;
+}
+
+
+void FCCConfigDefault(FCCConfig* config)
+{
+    config->neighbours = std::min(SETTINGS_GET_INT(FccNeighbours), FCC_NEIGHBOURS_MAX);
+    config->memoryBytes = (int64_t)SETTINGS_GET_INT(FccMemoryKB) * 1024;
+    config->bandwidthKbps = SETTINGS_GET_INT(FccBandwidthKbps);
+    config->maxBufferUs = FCC_BUFFER_US_DEFAULT;
+    config->realtime = true;
+}
+
+void FCCConfigFromPlayerArgs(FCCConfig* config, const PlayerArgs_Type* args)
+{
+    FCCConfigDefault(config);
+    config->neighbours = std::min(std::max(args->fccNeighbours, 0), FCC_NEIGHBOURS_MAX);
+    if (args->fccMemoryKB > 0)
+        config->memoryBytes = (int64_t)args->fccMemoryKB * 1024;
+    config->bandwidthKbps = std::max(args->fccBandwidthKbps, 0);
+}
+
+
+FCCChannel::FCCChannel(FastChannelChange* owner, int index, const char* url)
+    : m_owner(owner)
+    , m_index(index)
+    , m_url(url)
+    , m_sourceOpened(false)
+    , m_demuxer(NULL)
+    , m_videoStream(-1)
+    , m_threadStarted(false)
+    , m_stopped(false)
+    , m_active(false)
+    , m_result(0)
+    , m_bytes(0)
+    , m_haveKeyframe(false)
+    , m_firstKeyUs(DEMUX_TIMESTAMP_NONE)
+    , m_paceStartUs(0)
+    , m_paceFirstTs(DEMUX_TIMESTAMP_NONE)
+    , m_rateStartUs(0)
+    , m_rateBytes(0)
+{
+    memset(&m_source, 0, sizeof(m_source));
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+FCCChannel::~FCCChannel()
+{
+    stop();
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int FCCChannel::start(bool active)
+{
+    m_active = active;
+    if (pthread_create(&m_thread, NULL, readThread, this) != 0) {
+        playerLogError("fcc: create read thread for channel [%d] failed.\n", m_index);
+        return -1;
+    }
+    m_threadStarted = true;
+    return 0;
+}
+
+void FCCChannel::stop()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_stopped = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (m_threadStarted) {
+        pthread_join(m_thread, NULL);
+        m_threadStarted = false;
+    }
+    if (m_demuxer) {
+        delete m_demuxer;
+        m_demuxer = NULL;
+    }
+    if (m_sourceOpened) {
+        m_owner->m_ops.close(m_owner->m_ops.userData, &m_source);
+        m_sourceOpened = false;
+    }
+    pthread_mutex_lock(&m_mutex);
+    clearLocked();
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void FCCChannel::setActive(bool active)
+{
+    pthread_mutex_lock(&m_mutex);
+    if (!active && m_active)
+        trimToKeyframeLocked();
+    m_active = active;
+    m_paceFirstTs = DEMUX_TIMESTAMP_NONE;   //重新开始按时间戳限速
+    m_rateBytes = 0;
+    m_rateStartUs = FCCNowUs();
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool FCCChannel::hasKeyframe()
+{
+    bool result;
+
+    pthread_mutex_lock(&m_mutex);
+    result = m_haveKeyframe && !m_packets.empty();
+    pthread_mutex_unlock(&m_mutex);
+    return result;
+}
+
+int64_t FCCChannel::bufferedBytes()
+{
+    int64_t bytes;
+
+    pthread_mutex_lock(&m_mutex);
+    bytes = m_bytes;
+    pthread_mutex_unlock(&m_mutex);
+    return bytes;
+}
+
+void FCCChannel::clearLocked()
+{
+    while (!m_packets.empty()) {
+        DemuxPacketUnref(m_packets.front());
+        m_packets.pop_front();
+    }
+    m_bytes = 0;
+    m_haveKeyframe = false;
+    m_firstKeyUs = DEMUX_TIMESTAMP_NONE;
+}
+
+/* 播放的频道变回预取时，只保留最后一个关键帧开始的部分 */
+void FCCChannel::trimToKeyframeLocked()
+{
+    int i, last = -1;
+
+    if (m_videoStream < 0)
+        return;
+    for (i = (int)m_packets.size() - 1; i >= 0; i--) {
+        if (m_packets[i]->streamIndex == m_videoStream && (m_packets[i]->flags & DemuxPacket_Keyframe)) {
+            last = i;
+            break;
+        }
+    }
+    if (last < 0) {
+        clearLocked();
+        return;
+    }
+    for (i = 0; i < last; i++) {
+        m_bytes -= m_packets.front()->size;
+        DemuxPacketUnref(m_packets.front());
+        m_packets.pop_front();
+    }
+    m_haveKeyframe = true;
+    m_firstKeyUs = FCCPacketTime(m_packets.front());
+}
+
+/* 调用者持有 m_mutex */
+void FCCChannel::pushPrefetch(DemuxPacket* packet)
+{
+    const FCCConfig& config = m_owner->m_config;
+    int64_t budget = config.memoryBytes / std::max(m_owner->prefetchCount(), 1);
+    int64_t time = FCCPacketTime(packet);
+    bool overflow;
+
+    if (m_videoStream < 0) {
+        /* 只有音频：每个 packet 都可以作为起点，超过上限时从前面丢弃 */
+        m_packets.push_back(packet);
+        m_bytes += packet->size;
+        m_haveKeyframe = true;
+        while (m_packets.size() > 1 && (m_bytes > budget || (time != DEMUX_TIMESTAMP_NONE
+                && FCCPacketTime(m_packets.front()) != DEMUX_TIMESTAMP_NONE
+                && time - FCCPacketTime(m_packets.front()) > config.maxBufferUs))) {
+            m_bytes -= m_packets.front()->size;
+            DemuxPacketUnref(m_packets.front());
+            m_packets.pop_front();
+        }
+        return;
+    }
+
+    if (packet->streamIndex == m_videoStream && (packet->flags & DemuxPacket_Keyframe)) {
+        clearLocked();
+        m_haveKeyframe = true;
+        m_firstKeyUs = time;
+    }
+    if (!m_haveKeyframe) {
+        DemuxPacketUnref(packet);
+        return;
+    }
+    m_packets.push_back(packet);
+    m_bytes += packet->size;
+
+    overflow = m_bytes > budget;
+    if (time != DEMUX_TIMESTAMP_NONE && m_firstKeyUs != DEMUX_TIMESTAMP_NONE && time - m_firstKeyUs > config.maxBufferUs)
+        overflow = true;
+    if (overflow) {
+        playerLogVerbose("fcc: channel [%d] gop exceeds %lld bytes, wait next keyframe.\n", m_index, (long long)budget);
+        clearLocked();
+        ThreadMutexLock(m_owner->m_statMutex);
+        m_owner->m_statistics.overflows++;
+        ThreadMutexUnLock(m_owner->m_statMutex);
+    }
+}
+
+/* 在 deadlineUs(FCCNowUs) 之前等待，停止或者变为播放时提前返回 */
+void FCCChannel::waitUntil(int64_t deadlineUs)
+{
+    struct timespec deadline;
+    int64_t now;
+
+    pthread_mutex_lock(&m_mutex);
+    while (!m_stopped && !m_active && (now = FCCNowUs()) < deadlineUs) {
+        FCCDeadline(&deadline, std::min(deadlineUs - now, (int64_t)50000));
+        pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* FCCChannel::readThread(void* arg)
+{
+    ((FCCChannel*)arg)->runRead();
+    return NULL;
+}
+
+void FCCChannel::runRead()
+{
+    const FCCConfig& config = m_owner->m_config;
+    struct timespec deadline;
+    DemuxPacket* packet;
+    Demuxer* demuxer;
+    int64_t now, time, rate;
+    int i, ret = 0;
+
+    if (m_owner->m_ops.open(m_owner->m_ops.userData, m_url.c_str(), &m_source) != 0) {
+        playerLogWarning("fcc: open channel [%d] %s failed.\n", m_index, m_url.c_str());
+        ret = -1;
+        goto end;
+    }
+    m_sourceOpened = true;
+    demuxer = DemuxerOpen(m_source, NULL);
+    if (demuxer == NULL) {
+        playerLogWarning("fcc: no demuxer for channel [%d] %s.\n", m_index, m_url.c_str());
+        ret = -1;
+        goto end;
+    }
+    pthread_mutex_lock(&m_mutex);
+    m_demuxer = demuxer;
+    for (i = 0; i < demuxer->getStreamCount(); i++) {
+        if (demuxer->getStream(i)->type == DemuxStream_Video && demuxer->getStream(i)->enabled) {
+            m_videoStream = i;
+            break;
+        }
+    }
+    m_rateStartUs = FCCNowUs();
+    pthread_mutex_unlock(&m_mutex);
+
+    while (!m_stopped) {
+        ret = demuxer->readPacket(&packet);
+        if (ret != 0)
+            break;
+
+        pthread_mutex_lock(&m_mutex);
+        if (m_active) {
+            /* 从关键帧开始交给解码；领先太多时等播放取走 */
+            if (!m_haveKeyframe) {
+                if (m_videoStream >= 0 && !(packet->streamIndex == m_videoStream && (packet->flags & DemuxPacket_Keyframe))) {
+                    pthread_mutex_unlock(&m_mutex);
+                    DemuxPacketUnref(packet);
+                    continue;
+                }
+                m_haveKeyframe = true;
+            }
+            while (!m_stopped && m_active && m_bytes > FCC_ACTIVE_BUFFER_BYTES) {
+                FCCDeadline(&deadline, 100000);
+                pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+            }
+            m_packets.push_back(packet);
+            m_bytes += packet->size;
+            pthread_cond_broadcast(&m_cond);
+            pthread_mutex_unlock(&m_mutex);
+            continue;
+        }
+
+        time = FCCPacketTime(packet);
+        m_rateBytes += packet->size;
+        pushPrefetch(packet);
+        pthread_mutex_unlock(&m_mutex);
+
+        ThreadMutexLock(m_owner->m_statMutex);
+        m_owner->m_statistics.prefetchBytes += packet->size;
+        ThreadMutexUnLock(m_owner->m_statMutex);
+
+        /* 按时间戳的速度读取；时间戳跳变超过缓存时长时重新开始计时。RTP 已经按播放时间取出，不再限速 */
+        if (config.realtime && time != DEMUX_TIMESTAMP_NONE && !DemuxSourceIsRTP(&m_source)) {
+            now = FCCNowUs();
+            if (m_paceFirstTs == DEMUX_TIMESTAMP_NONE || time < m_paceFirstTs
+                || time - m_paceFirstTs > now - m_paceStartUs + config.maxBufferUs) {
+                m_paceFirstTs = time;
+                m_paceStartUs = now;
+            } else if (time - m_paceFirstTs > now - m_paceStartUs) {
+                waitUntil(m_paceStartUs + time - m_paceFirstTs);
+            }
+        }
+
+        /* 带宽上限：按预取频道平分 */
+        if (config.bandwidthKbps > 0) {
+            rate = (int64_t)config.bandwidthKbps * 1000 / 8 / std::max(m_owner->prefetchCount(), 1);
+            now = FCCNowUs();
+            time = m_rateStartUs + m_rateBytes * 1000000 / std::max(rate, (int64_t)1);
+            if (time > now) {
+                waitUntil(time);
+                ThreadMutexLock(m_owner->m_statMutex);
+                m_owner->m_statistics.throttleMs += (FCCNowUs() - now) / 1000;
+                ThreadMutexUnLock(m_owner->m_statMutex);
+            }
+        }
+    }
+
+end:
+    pthread_mutex_lock(&m_mutex);
+    m_result = (ret == 0) ? -1 : ret;       //ret 为 0 表示被停止
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int FCCChannel::readPacket(DemuxPacket** packet, int timeoutMs)
+{
+    struct timespec deadline;
+    int ret;
+
+    pthread_mutex_lock(&m_mutex);
+    if (timeoutMs >= 0)
+        FCCDeadline(&deadline, (int64_t)timeoutMs * 1000);
+    while (m_packets.empty() && m_result == 0 && !m_stopped) {
+        if (timeoutMs < 0) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        } else if (pthread_cond_timedwait(&m_cond, &m_mutex, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&m_mutex);
+            return -2;
+        }
+    }
+    if (!m_packets.empty()) {
+        *packet = m_packets.front();
+        m_packets.pop_front();
+        m_bytes -= (*packet)->size;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+        return 0;
+    }
+    ret = m_stopped ? -1 : m_result;
+    pthread_mutex_unlock(&m_mutex);
+    return ret;
+}
+
+
+FastChannelChange::FastChannelChange(const FCCConfig* config, const FCCSourceOps* ops)
+    : m_current(NULL)
+    , m_zapStartUs(-1)
+    , m_zapHit(false)
+{
+    if (config) {
+        m_config = *config;
+        m_config.neighbours = std::min(std::max(m_config.neighbours, 0), FCC_NEIGHBOURS_MAX);
+    } else {
+        FCCConfigDefault(&m_config);
+    }
+    if (ops) {
+        m_ops = *ops;
+    } else {
+        m_ops.open = FCCOpenFile;
+        m_ops.close = FCCCloseFile;
+        m_ops.userData = NULL;
+    }
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_statMutex = ThreadMutexCreate();
+}
+
+FastChannelChange::~FastChannelChange()
+{
+    close();
+    ThreadMutexDestroy(m_statMutex);
+}
+
+void FastChannelChange::setPlaylist(const char* const* urls, int count)
+{
+    int i;
+
+    close();
+    m_urls.clear();
+    for (i = 0; i < count; i++)
+        m_urls.push_back(urls[i] ? urls[i] : "");
+}
+
+void FastChannelChange::close()
+{
+    size_t i;
+
+    /* 先全部通知停止，再逐个等待，网络读取可以同时结束 */
+    for (i = 0; i < m_channels.size(); i++) {
+        pthread_mutex_lock(&m_channels[i]->m_mutex);
+        m_channels[i]->m_stopped = true;
+        pthread_cond_broadcast(&m_channels[i]->m_cond);
+        pthread_mutex_unlock(&m_channels[i]->m_mutex);
+    }
+    for (i = 0; i < m_channels.size(); i++)
+        delete m_channels[i];
+    m_channels.clear();
+    m_current = NULL;
+    m_zapStartUs = -1;
+}
+
+FCCChannel* FastChannelChange::findChannel(int index)
+{
+    size_t i;
+
+    for (i = 0; i < m_channels.size(); i++) {
+        if (m_channels[i]->m_index == index && !m_channels[i]->m_stopped)
+            return m_channels[i];
+    }
+    return NULL;
+}
+
+/* 播放列表首尾相连，换台一般是上一个/下一个 */
+bool FastChannelChange::inWindow(int index, int center)
+{
+    int count = m_urls.size(), distance = abs(index - center);
+
+    distance = std::min(distance, count - distance);
+    return index != center && distance <= m_config.neighbours;
+}
+
+int FastChannelChange::prefetchCount()
+{
+    return std::min(m_config.neighbours * 2, std::max((int)m_urls.size() - 1, 0));
+}
+
+FCCChannel* FastChannelChange::zapTo(int index)
+{
+    FCCChannel* target;
+    FCCChannel* channel;
+    int64_t now = FCCNowUs();
+    int count = m_urls.size(), distance, sign, neighbour;
+    bool hit;
+    size_t i;
+
+    if (index < 0 || index >= count)
+        return NULL;
+    if (m_current && m_current->m_index == index)
+        return m_current;
+
+    target = findChannel(index);
+    hit = (target != NULL && target->hasKeyframe());
+    if (target) {
+        target->setActive(true);
+    } else {
+        target = new FCCChannel(this, index, m_urls[index].c_str());
+        if (target->start(true) != 0) {
+            delete target;
+            return NULL;
+        }
+        m_channels.push_back(target);
+    }
+
+    /* 之前播放的频道在新的预取范围内时变回预取，其余不在范围内的停止 */
+    if (m_current)
+        m_current->setActive(false);
+    m_current = target;
+    for (i = 0; i < m_channels.size(); i++) {
+        channel = m_channels[i];
+        if (channel != target && !inWindow(channel->m_index, index)) {
+            pthread_mutex_lock(&channel->m_mutex);
+            channel->m_stopped = true;
+            pthread_cond_broadcast(&channel->m_cond);
+            pthread_mutex_unlock(&channel->m_mutex);
+        }
+    }
+    for (distance = 1; distance <= m_config.neighbours; distance++) {
+        for (sign = -1; sign <= 1; sign += 2) {
+            neighbour = ((index + sign * distance) % count + count) % count;
+            if (neighbour == index || findChannel(neighbour))
+                continue;
+            channel = new FCCChannel(this, neighbour, m_urls[neighbour].c_str());
+            if (channel->start(false) != 0) {
+                delete channel;
+                continue;
+            }
+            m_channels.push_back(channel);
+        }
+    }
+
+    /* 回收已经结束的线程，还在读的下次再回收 */
+    for (i = 0; i < m_channels.size(); ) {
+        channel = m_channels[i];
+        if (channel->m_stopped && channel->m_result != 0) {
+            delete channel;
+            m_channels.erase(m_channels.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    ThreadMutexLock(m_statMutex);
+    m_statistics.zaps++;
+    if (hit)
+        m_statistics.hits++;
+    else
+        m_statistics.misses++;
+    ThreadMutexUnLock(m_statMutex);
+    m_zapStartUs = now;
+    m_zapHit = hit;
+    playerLogInfo("fcc: zap to channel [%d], %s.\n", index, hit ? "from prefetch buffer" : "cold start");
+    return target;
+}
+
+void FastChannelChange::onFirstFrame()
+{
+    int64_t ms;
+    int bucket;
+
+    if (m_zapStartUs < 0)
+        return;
+    ms = (FCCNowUs() - m_zapStartUs) / 1000;
+    m_zapStartUs = -1;
+    for (bucket = 0; bucket < FCC_HISTOGRAM_BUCKETS - 1 && ms > FCCHistogramBounds[bucket]; bucket++);
+
+    ThreadMutexLock(m_statMutex);
+    m_statistics.histogram[bucket]++;
+    if (m_zapHit)
+        m_statistics.hitHistogram[bucket]++;
+    ThreadMutexUnLock(m_statMutex);
+}
+
+FCCStatistics FastChannelChange::getStatistics()
+{
+    FCCStatistics statistics;
+    int64_t buffered = 0;
+    size_t i;
+
+    for (i = 0; i < m_channels.size(); i++) {
+        if (m_channels[i] != m_current)
+            buffered += m_channels[i]->bufferedBytes();
+    }
+    ThreadMutexLock(m_statMutex);
+    statistics = m_statistics;
+    ThreadMutexUnLock(m_statMutex);
+    statistics.bufferedBytes = buffered;
+    return statistics;
+}
+
+void FastChannelChange::logStatistics()
+{
+    FCCStatistics statistics = getStatistics();
+    int i;
+
+    playerLogInfo("fcc: zaps[%lld] hits[%lld] misses[%lld] overflows[%lld] buffered[%lld] prefetch[%lld] throttle[%lld]ms\n",
+                  (long long)statistics.zaps, (long long)statistics.hits, (long long)statistics.misses,
+                  (long long)statistics.overflows, (long long)statistics.bufferedBytes,
+                  (long long)statistics.prefetchBytes, (long long)statistics.throttleMs);
+    for (i = 0; i < FCC_HISTOGRAM_BUCKETS; i++) {
+        if (i < FCC_HISTOGRAM_BUCKETS - 1)
+            playerLogInfo("fcc:   <= %5d ms : %d (prefetched %d)\n", FCCHistogramBounds[i],
+                          statistics.histogram[i], statistics.hitHistogram[i]);
+        else
+            playerLogInfo("fcc:    > %5d ms : %d (prefetched %d)\n", FCCHistogramBounds[i - 1],
+                          statistics.histogram[i], statistics.hitHistogram[i]);
+    }
+}
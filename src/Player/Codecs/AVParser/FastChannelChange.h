@@ -0,0 +1,171 @@
+#ifndef __FAST_CHANNEL_CHANGE_H__
+#define __FAST_CHANNEL_CHANGE_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Demuxer.h"
+#include "PlayUtilityDataStructures.h"
+
+
+#define     FCC_NEIGHBOURS_DEFAULT      1                   //预取前后各一个频道，设置项 fcc.neighbours 的默认值
+#define     FCC_NEIGHBOURS_MAX          4
+#define     FCC_MEMORY_DEFAULT          (16 * 1024 * 1024)  //所有预取频道缓冲的总和，设置项 fcc.memoryKB 的默认值
+#define     FCC_BUFFER_US_DEFAULT       10000000            //一个 GOP 超过这么长就不再缓存
+#define     FCC_ACTIVE_BUFFER_BYTES     (4 * 1024 * 1024)   //正在播放的频道，读取线程领先播放的上限
+#define     FCC_HISTOGRAM_BUCKETS       8
+
+
+typedef struct _FCCConfig {
+    int             neighbours;         //0 关闭预取，只在换台时打开
+    int64_t         memoryBytes;        //所有预取频道平分
+    int             bandwidthKbps;      //所有预取频道平分，0 不限
+    int64_t         maxBufferUs;
+    bool            realtime;           //按时间戳的速度读取，本地文件不会一次读完；直播源自己限速，应关闭
+} FCCConfig;
+
+void FCCConfigDefault(FCCConfig* config);
+void FCCConfigFromPlayerArgs(FCCConfig* config, const PlayerArgs_Type* args);
+
+typedef struct _FCCSourceOps {
+    int             (*open)(void* userData, const char* url, DemuxSource* source);     //0 成功
+    void            (*close)(void* userData, DemuxSource* source);
+    void*           userData;
+} FCCSourceOps;
+
+typedef struct _FCCStatistics {
+    int64_t         zaps;
+    int64_t         hits;               //换台时预取缓冲中已经有关键帧
+    int64_t         misses;
+    int             histogram[FCC_HISTOGRAM_BUCKETS];  //换台到第一帧显示的时间，上限见 FCCHistogramBounds
+    int             hitHistogram[FCC_HISTOGRAM_BUCKETS];
+    int64_t         prefetchBytes;      //预取读取的 packet 字节数
+    int64_t         bufferedBytes;      //当前所有预取缓冲的大小
+    int64_t         overflows;          //GOP 超过内存或时长上限而丢弃
+    int64_t         throttleMs;         //因带宽上限等待的时间
+} FCCStatistics;
+
+/* 直方图每个桶的上限(毫秒)，最后一个桶没有上限 */
+extern const int FCCHistogramBounds[FCC_HISTOGRAM_BUCKETS];
+
+
+class FastChannelChange;
+
+class FCCChannel { /* 一个频道的读取线程：预取时只保留最后一个关键帧开始的 packet，播放时按顺序交给解码 */
+    public:
+        int getIndex() { return m_index; }
+        const char* getUrl() { return m_url.c_str(); }
+        Demuxer* getDemuxer() { return m_demuxer; }     //流信息，不要在读取线程之外调用 readPacket
+
+        /**
+         *  @Func: readPacket
+         *         ps. :先取出换台前缓存的 GOP，之后是读取线程新读到的 packet
+         *  @Param: packet, type:: DemuxPacket**, 使用完后 DemuxPacketUnref()
+         *  @Param: timeoutMs, type:: int, -1 一直等待
+         *  @Return: int, 0 成功，结束返回 1，超时返回 -2，出错或停止返回 -1
+         *
+         **/
+        int readPacket(DemuxPacket** packet, int timeoutMs);
+
+    private:
+        friend class FastChannelChange;
+
+        FCCChannel(FastChannelChange* owner, int index, const char* url);
+        ~FCCChannel();
+
+        int start(bool active);
+        void stop();
+        void setActive(bool active);
+        bool hasKeyframe();
+        int64_t bufferedBytes();
+
+        static void* readThread(void* arg);
+        void runRead();
+        void pushPrefetch(DemuxPacket* packet);
+        void clearLocked();
+        void trimToKeyframeLocked();
+        void waitUntil(int64_t deadlineUs);
+
+        FastChannelChange*              m_owner;
+        int                             m_index;
+        std::string                     m_url;
+        DemuxSource                     m_source;
+        bool                            m_sourceOpened;
+        Demuxer*                        m_demuxer;
+        int                             m_videoStream;      //-1 时每个 packet 都可以作为起点
+
+        pthread_t                       m_thread;
+        bool                            m_threadStarted;
+        pthread_mutex_t                 m_mutex;
+        pthread_cond_t                  m_cond;
+        volatile bool                   m_stopped;
+        bool                            m_active;
+        int                             m_result;           //读取线程结束时的 readPacket 返回值，0 为还在读
+        std::deque<DemuxPacket*>        m_packets;
+        int64_t                         m_bytes;
+        bool                            m_haveKeyframe;     //m_packets 以关键帧开始
+        int64_t                         m_firstKeyUs;
+
+        /* 限速 */
+        int64_t                         m_paceStartUs;
+        int64_t                         m_paceFirstTs;
+        int64_t                         m_rateStartUs;
+        int64_t                         m_rateBytes;
+};
+
+
+class FastChannelChange { /* 快速换台：播放频道的前后 N 个频道一直在读，换台时直接从内存中的关键帧开始解码 */
+    public:
+        FastChannelChange(const FCCConfig* config, const FCCSourceOps* ops);  //ops 为 NULL 时打开 rtp:// 或本地文件
+        ~FastChannelChange();
+
+        void setPlaylist(const char* const* urls, int count);
+
+        /**
+         *  @Func: zapTo
+         *         ps. :切换到第 index 个频道；已经预取时直接交出，否则冷启动；之后调整预取的频道
+         *  @Param: index, type:: int
+         *  @Return: FCCChannel*, 由 FastChannelChange 所有，下一次 zapTo/close 之前有效；失败返回 NULL
+         *
+         **/
+        FCCChannel* zapTo(int index);
+
+        void onFirstFrame();                //播放器显示换台后第一帧时调用，记录换台时间
+        void close();
+        FCCStatistics getStatistics();
+        void logStatistics();
+
+    private:
+        friend class FCCChannel;
+
+        FastChannelChange(const FastChannelChange&);
+        FastChannelChange& operator=(const FastChannelChange&);
+
+        FCCChannel* findChannel(int index);
+        bool inWindow(int index, int center);
+        int prefetchCount();
+
+        FCCConfig                       m_config;
+        FCCSourceOps                    m_ops;
+        std::vector<std::string>        m_urls;
+        std::vector<FCCChannel*>        m_channels;         //正在读取的频道，包括播放中的
+        FCCChannel*                     m_current;
+        int64_t                         m_zapStartUs;       //-1 表示已经记录过
+        bool                            m_zapHit;
+
+        ThreadMutex_Type                m_statMutex;
+        FCCStatistics                   m_statistics;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__FAST_CHANNEL_CHANGE_H__
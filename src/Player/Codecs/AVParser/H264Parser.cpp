@@ -0,0 +1,1178 @@
+/**
+ *  H264Parser.cpp文件
+ *  H.264/H.265 基本码流解析，供 TS/FLV/MP4 解复用和 RTSP 组帧、快速换台使用；
+ *  主要有以下部分：
+ *          起始码查找(SSE2/NEON，其他平台逐字节跳跃查找)
+ *          Annex-B 与 AVCC/HVCC 之间的拆分和转换
+ *          VPS/SPS/PPS 解析，avcC/hvcC 的生成和导入
+ *          slice header 解析：IDR/IRAP、recovery point、access unit 边界
+ *
+ *  NALUnit 都指向调用者的缓冲区；流式解析时只有跨越两次 parse() 的 access unit 才拷贝到 m_buffer。
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "LogPlayer.h"
+#include "H264Parser.h"
+
+
+/* 去掉防竞争字节之后的 RBSP 上按位读取，越界时读到 0 */
+typedef struct {
+    const uint8_t*  data;
+    int             size;
+    int             bit;
+} H26xBitReader;
+
+static int H26xUnescape(const uint8_t* src, int size, uint8_t* dst, int max)
+{
+    int zeros = 0;
+    int length = 0;
+    int i;
+
+    for (i = 0; i < size && length < max; i++) {
+        if (zeros >= 2 && src[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = (src[i] == 0) ? zeros + 1 : 0;
+        dst[length++] = src[i];
+    }
+    return length;
+}
+
+static uint32_t H26xReadBits(H26xBitReader* reader, int count)
+{
+    uint32_t value = 0;
+
+    while (count-- > 0) {
+        int byte = reader->bit >> 3;
+        value <<= 1;
+        if (byte < reader->size)
+            value |= (reader->data[byte] >> (7 - (reader->bit & 7))) & 1;
+        reader->bit++;
+    }
+    return value;
+}
+
+static uint32_t H26xReadUE(H26xBitReader* reader)
+{
+    int zeros = 0;
+
+    while (H26xReadBits(reader, 1) == 0) {
+        if (++zeros > 31 || reader->bit > reader->size * 8)
+            return 0;
+    }
+    return ((1u << zeros) - 1) + H26xReadBits(reader, zeros);
+}
+
+static int32_t H26xReadSE(H26xBitReader* reader)
+{
+    uint32_t value = H26xReadUE(reader);
+    return (value & 1) ? (int32_t)((value + 1) >> 1) : -(int32_t)(value >> 1);
+}
+
+static bool H26xOverflow(H26xBitReader* reader)
+{
+    return reader->bit > reader->size * 8;
+}
+
+static void H264SkipScalingList(H26xBitReader* reader, int size)
+{
+    int last = 8, next = 8;
+
+    for (int j = 0; j < size; j++) {
+        if (next != 0)
+            next = (last + H26xReadSE(reader) + 256) % 256;
+        if (next != 0)
+            last = next;
+    }
+}
+
+static inline int H26xNalType(const uint8_t* nal, int codec)
+{
+    return (codec == H26xCodec_H265) ? (nal[0] >> 1) & 0x3F : nal[0] & 0x1F;
+}
+
+
+const uint8_t* H26xFindStartCode(const uint8_t* data, const uint8_t* end)
+{
+    const uint8_t* p = data;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    for (; p + 18 <= end; p += 16) {
+        __m128i first = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero);
+        __m128i second = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), zero);
+        __m128i third = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), one);
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(first, second), third));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    for (; p + 18 <= end; p += 16) {
+        uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), zero), vceqq_u8(vld1q_u8(p + 1), zero)),
+                vceqq_u8(vld1q_u8(p + 2), one));
+        uint64x2_t lanes = vreinterpretq_u64_u8(match);
+        uint64_t low = vgetq_lane_u64(lanes, 0);
+        uint64_t high = vgetq_lane_u64(lanes, 1);
+        if (low)
+            return p + (__builtin_ctzll(low) >> 3);
+        if (high)
+            return p + 8 + (__builtin_ctzll(high) >> 3);
+    }
+#endif
+    //p[2] > 1 时 p、p+1、p+2 都不可能是起始码
+    while (p + 2 < end) {
+        if (p[2] > 1)
+            p += 3;
+        else if (p[1])
+            p += 2;
+        else if (p[0] || p[2] != 1)
+            p++;
+        else
+            return p;
+    }
+    return end;
+}
+
+
+int H26xSplitAnnexB(const uint8_t* data, int size, int codec, NALUnit* units, int maxUnits)
+{
+    const uint8_t* end = data + size;
+    const uint8_t* p = H26xFindStartCode(data, end);
+    int count = 0;
+
+    while (p < end) {
+        const uint8_t* nal = p + 3;
+        const uint8_t* next = H26xFindStartCode(nal, end);
+        const uint8_t* nalEnd = next;
+
+        while (nalEnd > nal && nalEnd[-1] == 0)   //4 字节起始码的第一个 0 和 trailing_zero_8bits
+            nalEnd--;
+        if (nalEnd > nal) {
+            if (count < maxUnits) {
+                units[count].data = nal;
+                units[count].size = nalEnd - nal;
+                units[count].type = H26xNalType(nal, codec);
+                units[count].prefixSize = (p > data && p[-1] == 0) ? 4 : 3;
+            }
+            count++;
+        }
+        p = next;
+    }
+    return count;
+}
+
+
+int H26xSplitLengthPrefixed(const uint8_t* data, int size, int lengthSize, int codec, NALUnit* units, int maxUnits)
+{
+    int offset = 0;
+    int count = 0;
+
+    if (lengthSize < 1 || lengthSize > 4)
+        return -1;
+    while (offset + lengthSize <= size) {
+        uint32_t length = 0;
+        for (int i = 0; i < lengthSize; i++)
+            length = (length << 8) | data[offset + i];
+        offset += lengthSize;
+        if (length > (uint32_t)(size - offset))
+            return -1;
+        if (length > 0) {
+            if (count < maxUnits) {
+                units[count].data = data + offset;
+                units[count].size = length;
+                units[count].type = H26xNalType(data + offset, codec);
+                units[count].prefixSize = lengthSize;
+            }
+            count++;
+        }
+        offset += length;
+    }
+    return (offset == size) ? count : -1;
+}
+
+
+int H26xLengthPrefixedToAnnexB(uint8_t* data, int size, int lengthSize)
+{
+    int offset = 0;
+
+    if (lengthSize != 4)
+        return -1;
+    //先检查再改写，格式错误时不破坏数据
+    while (offset + 4 <= size) {
+        uint32_t length = ((uint32_t)data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+        if (length > (uint32_t)(size - offset - 4))
+            return -1;
+        offset += 4 + length;
+    }
+    if (offset != size)
+        return -1;
+    for (offset = 0; offset < size; ) {
+        uint32_t length = ((uint32_t)data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+        data[offset] = 0;
+        data[offset + 1] = 0;
+        data[offset + 2] = 0;
+        data[offset + 3] = 1;
+        offset += 4 + length;
+    }
+    return 0;
+}
+
+
+int H26xAnnexBToLengthPrefixed(uint8_t* data, int size)
+{
+    const uint8_t* end = data + size;
+    const uint8_t* p;
+    uint8_t* start;
+
+    if (size < 4 || data[0] || data[1] || data[2] || data[3] != 1)
+        return -1;
+    for (p = data + 1; (p = H26xFindStartCode(p, end)) < end; p += 3) {
+        if (p[-1] != 0)
+            return -1;      //3 字节的起始码需要扩展，不能原地转换
+    }
+    start = data;
+    while (start < end) {
+        const uint8_t* payload = start + 4;
+        const uint8_t* next = H26xFindStartCode(payload, end);
+        uint8_t* nextStart = (next < end) ? (uint8_t*)next - 1 : (uint8_t*)end;
+        uint32_t length = nextStart - payload;
+        start[0] = length >> 24;
+        start[1] = length >> 16;
+        start[2] = length >> 8;
+        start[3] = length;
+        start = nextStart;
+    }
+    return 0;
+}
+
+
+int H26xWriteAnnexB(const NALUnit* units, int count, uint8_t* buffer, int size)
+{
+    int total = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+        total += 4 + units[i].size;
+    if (buffer == NULL)
+        return total;
+    if (total > size)
+        return -1;
+    for (i = 0; i < count; i++) {
+        buffer[0] = 0;
+        buffer[1] = 0;
+        buffer[2] = 0;
+        buffer[3] = 1;
+        memcpy(buffer + 4, units[i].data, units[i].size);
+        buffer += 4 + units[i].size;
+    }
+    return total;
+}
+
+
+int H26xWriteLengthPrefixed(const NALUnit* units, int count, int lengthSize, uint8_t* buffer, int size)
+{
+    int total = 0;
+    int i, k;
+
+    if (lengthSize < 1 || lengthSize > 4)
+        return -1;
+    for (i = 0; i < count; i++) {
+        if (lengthSize < 4 && units[i].size >= (1 << (lengthSize * 8)))
+            return -1;
+        total += lengthSize + units[i].size;
+    }
+    if (buffer == NULL)
+        return total;
+    if (total > size)
+        return -1;
+    for (i = 0; i < count; i++) {
+        for (k = 0; k < lengthSize; k++)
+            buffer[k] = units[i].size >> ((lengthSize - 1 - k) * 8);
+        memcpy(buffer + lengthSize, units[i].data, units[i].size);
+        buffer += lengthSize + units[i].size;
+    }
+    return total;
+}
+
+
+int H26xParseDecoderConfig(const uint8_t* config, int size, int codec, NALUnit* units, int maxUnits, int* lengthSize)
+{
+    int count = 0;
+    int offset, arrays, i, k;
+
+    if (size >= 4 && config[0] == 0 && config[1] == 0 && (config[2] == 1 || (config[2] == 0 && config[3] == 1))) {
+        if (lengthSize)
+            *lengthSize = 0;    //已经是 Annex-B
+        return H26xSplitAnnexB(config, size, codec, units, maxUnits);
+    }
+
+    if (codec == H26xCodec_H264) {
+        if (size < 7 || config[0] != 1)
+            return -1;
+        if (lengthSize)
+            *lengthSize = (config[4] & 3) + 1;
+        offset = 5;
+        for (arrays = 0; arrays < 2; arrays++) { //SPS，然后 PPS
+            int number = (arrays == 0) ? config[offset] & 0x1F : config[offset];
+            offset++;
+            for (i = 0; i < number; i++) {
+                int length;
+                if (offset + 2 > size)
+                    return -1;
+                length = (config[offset] << 8) | config[offset + 1];
+                offset += 2;
+                if (offset + length > size)
+                    return -1;
+                if (count < maxUnits && length > 0) {
+                    units[count].data = config + offset;
+                    units[count].size = length;
+                    units[count].type = H26xNalType(config + offset, codec);
+                    units[count].prefixSize = 2;
+                    count++;
+                }
+                offset += length;
+            }
+            if (offset >= size)
+                break;
+        }
+        return count;
+    }
+
+    if (size < 23 || config[0] != 1)
+        return -1;
+    if (lengthSize)
+        *lengthSize = (config[21] & 3) + 1;
+    arrays = config[22];
+    offset = 23;
+    for (k = 0; k < arrays; k++) {
+        int number;
+        if (offset + 3 > size)
+            return -1;
+        number = (config[offset + 1] << 8) | config[offset + 2];
+        offset += 3;
+        for (i = 0; i < number; i++) {
+            int length;
+            if (offset + 2 > size)
+                return -1;
+            length = (config[offset] << 8) | config[offset + 1];
+            offset += 2;
+            if (offset + length > size)
+                return -1;
+            if (count < maxUnits && length > 0) {
+                units[count].data = config + offset;
+                units[count].size = length;
+                units[count].type = H26xNalType(config + offset, codec);
+                units[count].prefixSize = 2;
+                count++;
+            }
+            offset += length;
+        }
+    }
+    return count;
+}
+
+
+H264Parser::H264Parser(int codec)
+{
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    m_units.resize(64);
+    setCodec(codec);
+}
+
+
+void H264Parser::setCallbacks(const H264ParserCallbacks& callbacks)
+{
+    m_callbacks = callbacks;
+}
+
+
+void H264Parser::setCodec(int codec)
+{
+    m_codec = codec;
+    m_vps.clear();
+    m_sps.clear();
+    m_pps.clear();
+    memset(m_spsFields, 0, sizeof(m_spsFields));
+    memset(m_ppsFields, 0, sizeof(m_ppsFields));
+    memset(m_profileTierLevel, 0, sizeof(m_profileTierLevel));
+    memset(&m_videoInfo, 0, sizeof(m_videoInfo));
+    m_videoInfo.codec = codec;
+    m_activeSps = -1;
+    reset();
+}
+
+
+/* 只清除流式解析的状态，保留参数集 */
+void H264Parser::reset()
+{
+    m_buffer.clear();
+    m_nals.clear();
+    m_marks.clear();
+    m_auStart = -1;
+    m_nalStart = -1;
+    m_nalPrefix = 0;
+    m_scan = 0;
+    m_auPts = -1;
+    m_auDts = -1;
+    m_auHasVcl = false;
+    memset(&m_au, 0, sizeof(m_au));
+    memset(&m_lastSlice, 0, sizeof(m_lastSlice));
+    memset(&m_slice, 0, sizeof(m_slice));
+}
+
+
+bool H264Parser::isVcl(int type)
+{
+    if (m_codec == H26xCodec_H265)
+        return type < 32;
+    return type >= H264Nal_Slice && type <= H264Nal_IDR;
+}
+
+
+void H264Parser::storeParameterSet(std::vector<std::vector<uint8_t> >& sets, int id, const uint8_t* nal, int size)
+{
+    if (id < 0 || id >= H26X_PARAMETER_SET_MAX || size > H26X_PARAMETER_SET_SIZE_MAX)
+        return;
+    if ((int)sets.size() <= id)
+        sets.resize(id + 1);
+    sets[id].assign(nal, nal + size);
+}
+
+
+int H264Parser::parseH264SPS(const uint8_t* nal, int size)
+{
+    std::vector<uint8_t> rbsp(size);
+    H26xBitReader reader;
+    SpsFields fields;
+    int profile, level, id, chroma = 1, bitDepth = 8;
+    int widthMbs, heightMaps, cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+    int cropUnitX, cropUnitY;
+
+    memset(&fields, 0, sizeof(fields));
+    reader.data = &rbsp[0];
+    reader.size = H26xUnescape(nal + 1, size - 1, &rbsp[0], size);
+    reader.bit = 0;
+
+    profile = H26xReadBits(&reader, 8);
+    H26xReadBits(&reader, 8);
+    level = H26xReadBits(&reader, 8);
+    id = H26xReadUE(&reader);
+    if (id >= H26X_PARAMETER_SET_MAX)
+        return -1;
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 || profile == 83
+            || profile == 86 || profile == 118 || profile == 128 || profile == 138 || profile == 139 || profile == 134 || profile == 135) {
+        chroma = H26xReadUE(&reader);
+        if (chroma == 3)
+            fields.separateColourPlane = H26xReadBits(&reader, 1);
+        bitDepth = H26xReadUE(&reader) + 8;
+        H26xReadUE(&reader);
+        H26xReadBits(&reader, 1);
+        if (H26xReadBits(&reader, 1)) { //seq_scaling_matrix_present_flag
+            for (int i = 0; i < ((chroma != 3) ? 8 : 12); i++) {
+                if (H26xReadBits(&reader, 1))
+                    H264SkipScalingList(&reader, (i < 6) ? 16 : 64);
+            }
+        }
+    }
+    fields.log2MaxFrameNum = H26xReadUE(&reader) + 4;
+    fields.pocType = H26xReadUE(&reader);
+    if (fields.pocType == 0) {
+        fields.log2MaxPocLsb = H26xReadUE(&reader) + 4;
+    } else if (fields.pocType == 1) {
+        int cycle;
+        fields.deltaPicOrderAlwaysZero = H26xReadBits(&reader, 1);
+        H26xReadSE(&reader);
+        H26xReadSE(&reader);
+        cycle = H26xReadUE(&reader);
+        for (int i = 0; i < cycle && i < 256; i++)
+            H26xReadSE(&reader);
+    }
+    H26xReadUE(&reader);            //max_num_ref_frames
+    H26xReadBits(&reader, 1);
+    widthMbs = H26xReadUE(&reader) + 1;
+    heightMaps = H26xReadUE(&reader) + 1;
+    fields.frameMbsOnly = H26xReadBits(&reader, 1);
+    if (!fields.frameMbsOnly)
+        H26xReadBits(&reader, 1);
+    H26xReadBits(&reader, 1);
+    if (H26xReadBits(&reader, 1)) { //frame_cropping_flag
+        cropLeft = H26xReadUE(&reader);
+        cropRight = H26xReadUE(&reader);
+        cropTop = H26xReadUE(&reader);
+        cropBottom = H26xReadUE(&reader);
+    }
+    if (H26xOverflow(&reader) || fields.log2MaxFrameNum > 16 || fields.log2MaxPocLsb > 16) {
+        playerLogWarning("invalid h264 sps.\n");
+        return -1;
+    }
+
+    if (chroma == 0 || fields.separateColourPlane) {
+        cropUnitX = 1;
+        cropUnitY = 2 - fields.frameMbsOnly;
+    } else {
+        cropUnitX = (chroma == 3) ? 1 : 2;
+        cropUnitY = ((chroma == 1) ? 2 : 1) * (2 - fields.frameMbsOnly);
+    }
+    fields.valid = true;
+    m_spsFields[id] = fields;
+    m_activeSps = id;
+    m_videoInfo.profile = profile;
+    m_videoInfo.level = level;
+    m_videoInfo.chromaFormat = chroma;
+    m_videoInfo.bitDepth = bitDepth;
+    m_videoInfo.width = widthMbs * 16 - cropUnitX * (cropLeft + cropRight);
+    m_videoInfo.height = (2 - fields.frameMbsOnly) * heightMaps * 16 - cropUnitY * (cropTop + cropBottom);
+    return id;
+}
+
+
+int H264Parser::parseH264PPS(const uint8_t* nal, int size)
+{
+    uint8_t rbsp[H26X_HEADER_BYTES_MAX];
+    H26xBitReader reader;
+    PpsFields fields;
+    int id;
+
+    memset(&fields, 0, sizeof(fields));
+    reader.data = rbsp;
+    reader.size = H26xUnescape(nal + 1, size - 1, rbsp, sizeof(rbsp));
+    reader.bit = 0;
+    id = H26xReadUE(&reader);
+    fields.spsId = H26xReadUE(&reader);
+    H26xReadBits(&reader, 1);       //entropy_coding_mode_flag
+    fields.bottomFieldPicOrderPresent = H26xReadBits(&reader, 1);
+    if (H26xOverflow(&reader) || id >= H26X_PARAMETER_SET_MAX || fields.spsId >= H26X_PARAMETER_SET_MAX)
+        return -1;
+    fields.valid = true;
+    m_ppsFields[id] = fields;
+    return id;
+}
+
+
+int H264Parser::parseH265SPS(const uint8_t* nal, int size)
+{
+    std::vector<uint8_t> rbsp(size);
+    H26xBitReader reader;
+    SpsFields fields;
+    int maxSubLayers, id, chroma, width, height, bitDepth;
+    int left = 0, right = 0, top = 0, bottom = 0;
+    bool subProfile[8], subLevel[8];
+    int i;
+
+    memset(&fields, 0, sizeof(fields));
+    reader.data = &rbsp[0];
+    reader.size = H26xUnescape(nal + 2, size - 2, &rbsp[0], size);
+    reader.bit = 0;
+    if (reader.size < 13)
+        return -1;
+
+    H26xReadBits(&reader, 4);       //sps_video_parameter_set_id
+    maxSubLayers = H26xReadBits(&reader, 3) + 1;
+    H26xReadBits(&reader, 1);
+    memcpy(m_profileTierLevel, reader.data + 1, sizeof(m_profileTierLevel));
+    reader.bit += 96;               //general_profile_tier_level
+    for (i = 0; i < maxSubLayers - 1; i++) {
+        subProfile[i] = H26xReadBits(&reader, 1);
+        subLevel[i] = H26xReadBits(&reader, 1);
+    }
+    if (maxSubLayers > 1)
+        reader.bit += 2 * (8 - (maxSubLayers - 1));
+    for (i = 0; i < maxSubLayers - 1; i++) {
+        if (subProfile[i])
+            reader.bit += 88;
+        if (subLevel[i])
+            reader.bit += 8;
+    }
+    id = H26xReadUE(&reader);
+    chroma = H26xReadUE(&reader);
+    if (chroma == 3)
+        fields.separateColourPlane = H26xReadBits(&reader, 1);
+    width = H26xReadUE(&reader);
+    height = H26xReadUE(&reader);
+    if (H26xReadBits(&reader, 1)) { //conformance_window_flag
+        left = H26xReadUE(&reader);
+        right = H26xReadUE(&reader);
+        top = H26xReadUE(&reader);
+        bottom = H26xReadUE(&reader);
+    }
+    bitDepth = H26xReadUE(&reader) + 8;
+    H26xReadUE(&reader);
+    fields.log2MaxPocLsb = H26xReadUE(&reader) + 4;
+    if (H26xOverflow(&reader) || id >= H26X_PARAMETER_SET_MAX) {
+        playerLogWarning("invalid h265 sps.\n");
+        return -1;
+    }
+
+    fields.valid = true;
+    fields.frameMbsOnly = 1;
+    m_spsFields[id] = fields;
+    m_activeSps = id;
+    m_videoInfo.profile = m_profileTierLevel[0] & 0x1F;
+    m_videoInfo.level = m_profileTierLevel[11];
+    m_videoInfo.chromaFormat = chroma;
+    m_videoInfo.bitDepth = bitDepth;
+    m_videoInfo.width = width - ((chroma == 1 || chroma == 2) ? 2 : 1) * (left + right);
+    m_videoInfo.height = height - ((chroma == 1) ? 2 : 1) * (top + bottom);
+    return id;
+}
+
+
+int H264Parser::parseH265PPS(const uint8_t* nal, int size)
+{
+    uint8_t rbsp[H26X_HEADER_BYTES_MAX];
+    H26xBitReader reader;
+    PpsFields fields;
+    int id;
+
+    memset(&fields, 0, sizeof(fields));
+    reader.data = rbsp;
+    reader.size = H26xUnescape(nal + 2, size - 2, rbsp, sizeof(rbsp));
+    reader.bit = 0;
+    id = H26xReadUE(&reader);
+    fields.spsId = H26xReadUE(&reader);
+    fields.dependentSliceSegments = H26xReadBits(&reader, 1);
+    H26xReadBits(&reader, 1);       //output_flag_present_flag
+    fields.numExtraSliceHeaderBits = H26xReadBits(&reader, 3);
+    if (H26xOverflow(&reader) || id >= H26X_PARAMETER_SET_MAX || fields.spsId >= H26X_PARAMETER_SET_MAX)
+        return -1;
+    fields.valid = true;
+    m_ppsFields[id] = fields;
+    return id;
+}
+
+
+/* 结果在 m_slice 中；参数集未知时 valid 为 false */
+int H264Parser::parseSliceHeader(const uint8_t* nal, int size, int type)
+{
+    static const int h264Types[5] = { H26xPicture_P, H26xPicture_B, H26xPicture_I, H26xPicture_P, H26xPicture_I };
+    static const int h265Types[3] = { H26xPicture_B, H26xPicture_P, H26xPicture_I };
+    uint8_t rbsp[H26X_HEADER_BYTES_MAX];
+    H26xBitReader reader;
+    SliceState& slice = m_slice;
+    int header = (m_codec == H26xCodec_H265) ? 2 : 1;
+    uint32_t value;
+
+    memset(&slice, 0, sizeof(slice));
+    slice.sliceType = H26xPicture_Unknown;
+    if (size <= header)
+        return -1;
+    reader.data = rbsp;
+    reader.size = H26xUnescape(nal + header, size - header, rbsp, sizeof(rbsp));
+    reader.bit = 0;
+
+    if (m_codec == H26xCodec_H265) {
+        slice.firstSlice = H26xReadBits(&reader, 1);
+        if (type >= H265Nal_BlaWLp && type <= H265Nal_IrapMax)
+            H26xReadBits(&reader, 1);
+        slice.ppsId = H26xReadUE(&reader);
+        if (slice.ppsId >= H26X_PARAMETER_SET_MAX || !m_ppsFields[slice.ppsId].valid)
+            return -1;
+        if (slice.firstSlice) { //其他 slice 需要 SPS 中的 CTB 大小才能解析到 slice_type
+            H26xReadBits(&reader, m_ppsFields[slice.ppsId].numExtraSliceHeaderBits);
+            value = H26xReadUE(&reader);
+            slice.sliceType = (value < 3) ? h265Types[value] : H26xPicture_Unknown;
+        }
+        slice.valid = !H26xOverflow(&reader);
+        return slice.valid ? 0 : -1;
+    }
+
+    slice.firstSlice = (H26xReadUE(&reader) == 0);
+    value = H26xReadUE(&reader);
+    slice.sliceType = h264Types[value % 5];
+    slice.ppsId = H26xReadUE(&reader);
+    if (slice.ppsId >= H26X_PARAMETER_SET_MAX || !m_ppsFields[slice.ppsId].valid)
+        return -1;
+    const PpsFields& pps = m_ppsFields[slice.ppsId];
+    const SpsFields& sps = m_spsFields[pps.spsId];
+    if (!sps.valid)
+        return -1;
+    if (sps.separateColourPlane)
+        H26xReadBits(&reader, 2);
+    slice.frameNum = H26xReadBits(&reader, sps.log2MaxFrameNum);
+    if (!sps.frameMbsOnly) {
+        slice.fieldPic = H26xReadBits(&reader, 1);
+        if (slice.fieldPic)
+            slice.bottomField = H26xReadBits(&reader, 1);
+    }
+    slice.nalRefIdc = (nal[0] >> 5) & 3;
+    slice.idr = (type == H264Nal_IDR);
+    if (slice.idr)
+        slice.idrPicId = H26xReadUE(&reader);
+    if (sps.pocType == 0) {
+        slice.pocLsb = H26xReadBits(&reader, sps.log2MaxPocLsb);
+        if (pps.bottomFieldPicOrderPresent && !slice.fieldPic)
+            slice.deltaPocBottom = H26xReadSE(&reader);
+    } else if (sps.pocType == 1 && !sps.deltaPicOrderAlwaysZero) {
+        slice.deltaPoc0 = H26xReadSE(&reader);
+        if (pps.bottomFieldPicOrderPresent && !slice.fieldPic)
+            slice.deltaPoc1 = H26xReadSE(&reader);
+    }
+    slice.valid = !H26xOverflow(&reader);
+    return slice.valid ? 0 : -1;
+}
+
+
+/* SEI 中是否有 recovery_point(payloadType 6) */
+bool H264Parser::hasRecoveryPoint(const uint8_t* nal, int size)
+{
+    uint8_t rbsp[H26X_HEADER_BYTES_MAX];
+    int header = (m_codec == H26xCodec_H265) ? 2 : 1;
+    int length, offset = 0;
+
+    if (size <= header)
+        return false;
+    length = H26xUnescape(nal + header, size - header, rbsp, sizeof(rbsp));
+    while (offset < length && rbsp[offset] != 0x80) {
+        int type = 0, payload = 0;
+        while (offset < length && rbsp[offset] == 0xFF)
+            type += rbsp[offset++];
+        if (offset >= length)
+            break;
+        type += rbsp[offset++];
+        while (offset < length && rbsp[offset] == 0xFF)
+            payload += rbsp[offset++];
+        if (offset >= length)
+            break;
+        payload += rbsp[offset++];
+        if (type == 6)
+            return true;
+        offset += payload;
+    }
+    return false;
+}
+
+
+/* 新的 access unit 从该 NAL 开始(只在当前 access unit 已有 VCL 时有意义)；VCL 的 slice header 结果在 m_slice */
+bool H264Parser::beginsAccessUnit(const uint8_t* nal, int size, int type, bool* firstSlice)
+{
+    const SliceState& last = m_lastSlice;
+    const SliceState& slice = m_slice;
+
+    *firstSlice = false;
+    if (m_codec == H26xCodec_H265) {
+        if (type < 32) {
+            parseSliceHeader(nal, size, type);
+            *firstSlice = size > 2 && (nal[2] & 0x80);
+            return *firstSlice;
+        }
+        return (type >= H265Nal_VPS && type <= H265Nal_AUD) || type == H265Nal_PrefixSEI
+                || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+    }
+
+    if (type < H264Nal_Slice || type > H264Nal_IDR)
+        return type == H264Nal_SEI || type == H264Nal_SPS || type == H264Nal_PPS || type == H264Nal_AUD
+                || (type >= 14 && type <= 18);
+    if (parseSliceHeader(nal, size, type) < 0)
+        return false;
+    *firstSlice = slice.firstSlice;
+    if (!last.valid || slice.firstSlice)
+        return true;
+    //H.264 7.4.1.2.4 first VCL NAL unit of a primary coded picture
+    if (slice.frameNum != last.frameNum || slice.ppsId != last.ppsId || slice.fieldPic != last.fieldPic
+            || slice.bottomField != last.bottomField || (slice.nalRefIdc == 0) != (last.nalRefIdc == 0)
+            || slice.idr != last.idr || (slice.idr && slice.idrPicId != last.idrPicId))
+        return true;
+    return slice.pocLsb != last.pocLsb || slice.deltaPocBottom != last.deltaPocBottom
+            || slice.deltaPoc0 != last.deltaPoc0 || slice.deltaPoc1 != last.deltaPoc1;
+}
+
+
+/* 更新参数集和 access unit 的标志；VCL 的 slice header 已经在 m_slice 中 */
+void H264Parser::processNal(const uint8_t* nal, int size, int type, H26xAccessUnit* info)
+{
+    int id;
+
+    if (m_codec == H26xCodec_H265) {
+        if (size < 3)
+            return;
+        switch (type) {
+            case H265Nal_VPS:
+                storeParameterSet(m_vps, nal[2] >> 4, nal, size);
+                info->hasParameterSets = 1;
+                return;
+            case H265Nal_SPS:
+                if ((id = parseH265SPS(nal, size)) >= 0)
+                    storeParameterSet(m_sps, id, nal, size);
+                info->hasParameterSets = 1;
+                return;
+            case H265Nal_PPS:
+                if ((id = parseH265PPS(nal, size)) >= 0)
+                    storeParameterSet(m_pps, id, nal, size);
+                info->hasParameterSets = 1;
+                return;
+            case H265Nal_PrefixSEI:
+                if (hasRecoveryPoint(nal, size))
+                    info->isRandomAccess = 1;
+                return;
+            default:
+                break;
+        }
+        if (type < 32) {
+            if (type >= H265Nal_BlaWLp && type <= H265Nal_IrapMax)
+                info->isKeyframe = info->isRandomAccess = 1;
+            if (info->pictureType == H26xPicture_Unknown && m_slice.valid)
+                info->pictureType = m_slice.sliceType;
+        }
+        return;
+    }
+
+    if (size < 2)
+        return;
+    switch (type) {
+        case H264Nal_SPS:
+            if ((id = parseH264SPS(nal, size)) >= 0)
+                storeParameterSet(m_sps, id, nal, size);
+            info->hasParameterSets = 1;
+            break;
+        case H264Nal_PPS:
+            if ((id = parseH264PPS(nal, size)) >= 0)
+                storeParameterSet(m_pps, id, nal, size);
+            info->hasParameterSets = 1;
+            break;
+        case H264Nal_SEI:
+            if (hasRecoveryPoint(nal, size))
+                info->isRandomAccess = 1;
+            break;
+        case H264Nal_IDR:
+            info->isKeyframe = info->isRandomAccess = 1;
+            //fall through
+        case H264Nal_Slice:
+            if (info->pictureType == H26xPicture_Unknown && m_slice.valid)
+                info->pictureType = m_slice.sliceType;
+            break;
+        default:
+            break;
+    }
+}
+
+
+int H264Parser::inspect(const uint8_t* data, int size, int lengthSize, H26xAccessUnit* info)
+{
+    bool vcl = false;
+    int count, i;
+
+    memset(info, 0, sizeof(*info));
+    for (;;) {
+        if (lengthSize > 0)
+            count = H26xSplitLengthPrefixed(data, size, lengthSize, m_codec, &m_units[0], m_units.size());
+        else
+            count = H26xSplitAnnexB(data, size, m_codec, &m_units[0], m_units.size());
+        if (count <= (int)m_units.size())
+            break;
+        m_units.resize(count);
+    }
+    if (count < 0)
+        return -1;
+    for (i = 0; i < count; i++) {
+        const NALUnit& unit = m_units[i];
+        if (isVcl(unit.type) && !vcl) {
+            vcl = true;
+            parseSliceHeader(unit.data, unit.size, unit.type);
+        }
+        processNal(unit.data, unit.size, unit.type, info);
+    }
+    info->nalCount = count;
+    return 0;
+}
+
+
+int H264Parser::setDecoderConfig(const uint8_t* config, int size)
+{
+    NALUnit units[H26X_PARAMETER_SET_MAX];
+    H26xAccessUnit info;
+    int lengthSize = 4;
+    int count;
+
+    memset(&info, 0, sizeof(info));
+    count = H26xParseDecoderConfig(config, size, m_codec, units, H26X_PARAMETER_SET_MAX, &lengthSize);
+    if (count < 0) {
+        playerLogWarning("invalid decoder config, size %d.\n", size);
+        return -1;
+    }
+    for (int i = 0; i < count && i < H26X_PARAMETER_SET_MAX; i++)
+        processNal(units[i].data, units[i].size, units[i].type, &info);
+    return lengthSize;
+}
+
+
+int H264Parser::getDecoderConfig(std::vector<uint8_t>& config)
+{
+    const std::vector<std::vector<uint8_t> >* arrays[3] = { &m_vps, &m_sps, &m_pps };
+    static const int h265Types[3] = { H265Nal_VPS, H265Nal_SPS, H265Nal_PPS };
+    size_t i;
+    int k;
+
+    config.clear();
+    if (m_activeSps < 0 || m_activeSps >= (int)m_sps.size() || m_sps[m_activeSps].size() < 4 || m_pps.empty())
+        return -1;
+
+    if (m_codec == H26xCodec_H264) {
+        const std::vector<uint8_t>& sps = m_sps[m_activeSps];
+        int count = 0;
+        config.push_back(1);
+        config.push_back(sps[1]);
+        config.push_back(sps[2]);
+        config.push_back(sps[3]);
+        config.push_back(0xFF);         //lengthSizeMinusOne = 3
+        for (k = 1; k <= 2; k++) {
+            const std::vector<std::vector<uint8_t> >& sets = *arrays[k];
+            size_t countPos = config.size();
+            config.push_back(0);
+            count = 0;
+            for (i = 0; i < sets.size(); i++) {
+                if (sets[i].empty())
+                    continue;
+                config.push_back(sets[i].size() >> 8);
+                config.push_back(sets[i].size());
+                config.insert(config.end(), sets[i].begin(), sets[i].end());
+                count++;
+            }
+            config[countPos] = (k == 1) ? (0xE0 | count) : count;
+        }
+        if (sps[1] == 100 || sps[1] == 110 || sps[1] == 122 || sps[1] == 244) {
+            config.push_back(0xFC | m_videoInfo.chromaFormat);
+            config.push_back(0xF8 | (m_videoInfo.bitDepth - 8));
+            config.push_back(0xF8 | (m_videoInfo.bitDepth - 8));
+            config.push_back(0);
+        }
+        return 0;
+    }
+
+    config.push_back(1);
+    config.insert(config.end(), m_profileTierLevel, m_profileTierLevel + sizeof(m_profileTierLevel));
+    config.push_back(0xF0);             //min_spatial_segmentation_idc
+    config.push_back(0x00);
+    config.push_back(0xFC);             //parallelismType
+    config.push_back(0xFC | m_videoInfo.chromaFormat);
+    config.push_back(0xF8 | (m_videoInfo.bitDepth - 8));
+    config.push_back(0xF8 | (m_videoInfo.bitDepth - 8));
+    config.push_back(0);                //avgFrameRate
+    config.push_back(0);
+    config.push_back((1 << 3) | (1 << 2) | 3);      //numTemporalLayers 1, temporalIdNested, lengthSizeMinusOne 3
+    config.push_back(3);
+    for (k = 0; k < 3; k++) {
+        const std::vector<std::vector<uint8_t> >& sets = *arrays[k];
+        size_t countPos;
+        int count = 0;
+        config.push_back(0x80 | h265Types[k]);     //array_completeness
+        countPos = config.size();
+        config.push_back(0);
+        config.push_back(0);
+        for (i = 0; i < sets.size(); i++) {
+            if (sets[i].empty())
+                continue;
+            config.push_back(sets[i].size() >> 8);
+            config.push_back(sets[i].size());
+            config.insert(config.end(), sets[i].begin(), sets[i].end());
+            count++;
+        }
+        config[countPos] = count >> 8;
+        config[countPos + 1] = count;
+    }
+    return 0;
+}
+
+
+int H264Parser::getParameterSetsAnnexB(std::vector<uint8_t>& data)
+{
+    const std::vector<std::vector<uint8_t> >* arrays[3] = { &m_vps, &m_sps, &m_pps };
+    static const uint8_t startCode[4] = { 0, 0, 0, 1 };
+
+    data.clear();
+    for (int k = (m_codec == H26xCodec_H265) ? 0 : 1; k < 3; k++) {
+        for (size_t i = 0; i < arrays[k]->size(); i++) {
+            const std::vector<uint8_t>& set = (*arrays[k])[i];
+            if (set.empty())
+                continue;
+            data.insert(data.end(), startCode, startCode + 4);
+            data.insert(data.end(), set.begin(), set.end());
+        }
+    }
+    return data.empty() ? -1 : 0;
+}
+
+
+void H264Parser::emitAccessUnit(const uint8_t* view, int end)
+{
+    size_t i;
+
+    if (m_auStart < 0)
+        return;
+    if (!m_nals.empty() && m_callbacks.onAccessUnit) {
+        if (m_units.size() < m_nals.size())
+            m_units.resize(m_nals.size());
+        for (i = 0; i < m_nals.size(); i++) {
+            m_units[i].data = view + m_auStart + m_nals[i].offset;
+            m_units[i].size = m_nals[i].size;
+            m_units[i].type = m_nals[i].type;
+            m_units[i].prefixSize = m_nals[i].prefixSize;
+        }
+        m_au.data = view + m_auStart;
+        m_au.size = end - m_auStart;
+        m_au.nals = &m_units[0];
+        m_au.nalCount = m_nals.size();
+        m_au.pts = m_auPts;
+        m_au.dts = m_auDts;
+        m_callbacks.onAccessUnit(&m_au, m_callbacks.userData);
+    }
+    m_nals.clear();
+    memset(&m_au, 0, sizeof(m_au));
+    m_auHasVcl = false;
+    m_auStart = -1;
+}
+
+
+/* 处理视图中完整的 NAL，last 时最后一个 NAL 到视图末尾为止 */
+int H264Parser::processView(const uint8_t* view, int length, bool last)
+{
+    const uint8_t* end = view + length;
+    int pos = m_scan;
+
+    for (;;) {
+        const uint8_t* found = H26xFindStartCode(view + pos, end);
+        int start, nalEnd, nal;
+
+        if (found == end && !(last && m_nalStart >= 0))
+            break;
+        if (found < end) {
+            start = found - view;
+            //前一个字节为 0 时是 4 字节起始码，但不能越过上一个 NAL 的开始
+            if (start > 0 && view[start - 1] == 0 && (m_nalStart < 0 || start - 1 >= m_nalStart + m_nalPrefix))
+                start--;
+            nalEnd = start;
+        } else {
+            start = length;
+            nalEnd = length;
+        }
+
+        if (m_nalStart >= 0) {
+            nal = m_nalStart + m_nalPrefix;
+            while (nalEnd > nal && view[nalEnd - 1] == 0)
+                nalEnd--;
+            if (nalEnd > nal) {
+                int type = H26xNalType(view + nal, m_codec);
+                bool firstSlice;
+                bool begins = beginsAccessUnit(view + nal, nalEnd - nal, type, &firstSlice);
+                NalInfo info;
+
+                if (begins && m_auHasVcl)
+                    emitAccessUnit(view, m_nalStart);
+                if (m_auStart < 0) {
+                    m_auStart = m_nalStart;
+                    m_auPts = m_auDts = -1;
+                    for (size_t i = 0; i < m_marks.size() && m_marks[i].offset <= m_auStart; i++) {
+                        m_auPts = m_marks[i].pts;
+                        m_auDts = m_marks[i].dts;
+                    }
+                }
+                info.offset = nal - m_auStart;
+                info.size = nalEnd - nal;
+                info.type = type;
+                info.prefixSize = m_nalPrefix;
+                m_nals.push_back(info);
+                processNal(view + nal, nalEnd - nal, type, &m_au);
+                if (isVcl(type)) {
+                    m_auHasVcl = true;
+                    if (m_slice.valid)
+                        m_lastSlice = m_slice;
+                }
+            }
+        }
+        if (found == end)
+            break;
+        m_nalStart = start;
+        m_nalPrefix = (found - view) + 3 - start;
+        pos = (found - view) + 3;
+    }
+
+    if (last) {
+        emitAccessUnit(view, length);
+        m_nalStart = -1;
+        m_scan = 0;
+        return 0;
+    }
+    m_scan = (pos > length - 3) ? pos : length - 3;
+    return 0;
+}
+
+
+int H264Parser::parse(const uint8_t* data, int length, int64_t pts, int64_t dts)
+{
+    ChunkMark mark;
+    const uint8_t* view;
+    int viewLength, keep, i;
+
+    if (data == NULL || length <= 0)
+        return 0;
+    mark.pts = pts;
+    mark.dts = dts;
+    if (m_buffer.empty()) { //直接在调用者的缓冲区上解析
+        mark.offset = 0;
+        m_marks.clear();
+        m_marks.push_back(mark);
+        view = data;
+        viewLength = length;
+    } else {
+        mark.offset = m_buffer.size();
+        m_marks.push_back(mark);
+        m_buffer.insert(m_buffer.end(), data, data + length);
+        view = &m_buffer[0];
+        viewLength = m_buffer.size();
+    }
+    processView(view, viewLength, false);
+
+    //保留当前 access unit(或未完成的 NAL)之后的数据，多保留一个字节用于判断 4 字节起始码
+    if (m_auStart >= 0)
+        keep = m_auStart;
+    else if (m_nalStart >= 0)
+        keep = m_nalStart;
+    else
+        keep = (m_scan > 0) ? m_scan - 1 : 0;
+    if (view == data)
+        m_buffer.assign(data + keep, data + length);
+    else
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + keep);
+    if (m_auStart >= 0)
+        m_auStart -= keep;
+    if (m_nalStart >= 0)
+        m_nalStart -= keep;
+    m_scan -= keep;
+    for (i = m_marks.size() - 1; i >= 0; i--) {
+        m_marks[i].offset -= keep;
+        if (m_marks[i].offset <= 0) { //之前的已经不需要
+            m_marks[i].offset = 0;
+            m_marks.erase(m_marks.begin(), m_marks.begin() + i);
+            break;
+        }
+    }
+    return 0;
+}
+
+
+void H264Parser::flush()
+{
+    if (!m_buffer.empty())
+        processView(&m_buffer[0], m_buffer.size(), true);
+    m_buffer.clear();
+    m_marks.clear();
+    m_nals.clear();
+    m_auStart = -1;
+    m_nalStart = -1;
+    m_scan = 0;
+    m_auHasVcl = false;
+    memset(&m_au, 0, sizeof(m_au));
+    memset(&m_lastSlice, 0, sizeof(m_lastSlice));
+}
@@ -1 +1,245 @@
- 
\ No newline at end of file
+#ifndef __H264_PARSER_H__
+#define __H264_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     H26X_PARAMETER_SET_MAX      32          //每种参数集按 id 保存的个数上限
+#define     H26X_PARAMETER_SET_SIZE_MAX 4096
+#define     H26X_HEADER_BYTES_MAX       64          //解析 slice header 时去掉防竞争字节的最大长度
+
+
+typedef enum {
+    H26xCodec_H264 = 0,
+    H26xCodec_H265
+} H26xCodec;
+
+typedef enum {
+    H264Nal_Slice       = 1,
+    H264Nal_IDR         = 5,
+    H264Nal_SEI         = 6,
+    H264Nal_SPS         = 7,
+    H264Nal_PPS         = 8,
+    H264Nal_AUD         = 9,
+    H264Nal_EndOfSeq    = 10,
+    H264Nal_EndOfStream = 11,
+    H264Nal_Filler      = 12
+} H264NalType;
+
+typedef enum {
+    H265Nal_TrailN      = 0,
+    H265Nal_RaslR       = 9,
+    H265Nal_BlaWLp      = 16,
+    H265Nal_IdrWRadl    = 19,
+    H265Nal_IdrNLp      = 20,
+    H265Nal_Cra         = 21,
+    H265Nal_IrapMax     = 23,
+    H265Nal_VPS         = 32,
+    H265Nal_SPS         = 33,
+    H265Nal_PPS         = 34,
+    H265Nal_AUD         = 35,
+    H265Nal_EndOfSeq    = 36,
+    H265Nal_EndOfStream = 37,
+    H265Nal_Filler      = 38,
+    H265Nal_PrefixSEI   = 39,
+    H265Nal_SuffixSEI   = 40
+} H265NalType;
+
+typedef enum {
+    H26xPicture_Unknown = 0,
+    H26xPicture_I,
+    H26xPicture_P,
+    H26xPicture_B
+} H26xPictureType;
+
+
+typedef struct _NALUnit {
+    const uint8_t*  data;               //从 NAL 头开始，不含起始码/长度字段
+    int             size;
+    int             type;               //H264NalType / H265NalType
+    int             prefixSize;         //起始码或长度字段的字节数
+} NALUnit;
+
+typedef struct _H26xVideoInfo {
+    int             codec;              //H26xCodec
+    int             profile;
+    int             level;
+    int             width;              //已去掉裁剪区域
+    int             height;
+    int             chromaFormat;
+    int             bitDepth;
+} H26xVideoInfo;
+
+typedef struct _H26xAccessUnit {
+    const uint8_t*  data;               //Annex-B，只在回调中有效
+    int             size;
+    const NALUnit*  nals;
+    int             nalCount;
+    int64_t         pts;                //该 access unit 开始时 parse() 传入的时间，未知为 -1
+    int64_t         dts;
+    int             isKeyframe;         //H.264 IDR / H.265 IRAP
+    int             isRandomAccess;     //关键帧或带 recovery point SEI
+    int             hasParameterSets;
+    int             pictureType;        //H26xPictureType，第一个 slice 的类型
+} H26xAccessUnit;
+
+typedef struct _H264ParserCallbacks {
+    void (*onAccessUnit)(const H26xAccessUnit* au, void* userData);
+    void*   userData;
+} H264ParserCallbacks;
+
+
+/**
+ *  @Func: H26xFindStartCode
+ *         ps. :SSE2/NEON 每次比较 16 字节，没有时逐字节跳跃查找
+ *  @Param: data, type:: const uint8_t*
+ *  @Param: end, type:: const uint8_t*
+ *  @Return: const uint8_t*, 00 00 01 的位置，没有时返回 end；前一个字节为 0 时是 4 字节的起始码
+ *
+ **/
+const uint8_t* H26xFindStartCode(const uint8_t* data, const uint8_t* end);
+
+/* 拆分 NAL：Annex-B 或 AVCC/HVCC 的长度前缀格式，NALUnit 指向输入的缓冲区，返回个数，格式错误返回 -1 */
+int H26xSplitAnnexB(const uint8_t* data, int size, int codec, NALUnit* units, int maxUnits);
+int H26xSplitLengthPrefixed(const uint8_t* data, int size, int lengthSize, int codec, NALUnit* units, int maxUnits);
+
+/* 原地转换：长度前缀为 4 字节/起始码都为 4 字节时不需要拷贝，否则返回 -1，用 H26xWrite* 一次拷贝 */
+int H26xLengthPrefixedToAnnexB(uint8_t* data, int size, int lengthSize);
+int H26xAnnexBToLengthPrefixed(uint8_t* data, int size);
+int H26xWriteAnnexB(const NALUnit* units, int count, uint8_t* buffer, int size);
+int H26xWriteLengthPrefixed(const NALUnit* units, int count, int lengthSize, uint8_t* buffer, int size);
+
+/* avcC / hvcC 中的参数集，NALUnit 指向 config，返回个数；lengthSize 可为 NULL */
+int H26xParseDecoderConfig(const uint8_t* config, int size, int codec, NALUnit* units, int maxUnits, int* lengthSize);
+
+
+class H264Parser { /* H.264/H.265 Annex-B 解析：参数集、slice header、access unit 边界 */
+    public:
+        H264Parser(int codec = H26xCodec_H264);
+        ~H264Parser(){}
+
+        void setCallbacks(const H264ParserCallbacks& callbacks);
+        void setCodec(int codec);
+        int getCodec() { return m_codec; }
+
+        int parse(const uint8_t* data, int length, int64_t pts, int64_t dts);  //Annex-B 码流，可以任意分块
+        void flush();                                                           //输出最后一个 access unit
+        void reset();
+
+        /**
+         *  @Func: inspect
+         *         ps. :分析解复用得到的完整 access unit，更新参数集；TS/FLV/MP4 使用
+         *  @Param: data, type:: const uint8_t*
+         *  @Param: size, type:: int
+         *  @Param: lengthSize, type:: int, 0 为 Annex-B，否则为 AVCC/HVCC 的长度字段字节数
+         *  @Param: info, type:: H26xAccessUnit*, data/nals 不填写
+         *  @Return: int, 格式错误返回 -1
+         *
+         **/
+        int inspect(const uint8_t* data, int size, int lengthSize, H26xAccessUnit* info);
+
+        int setDecoderConfig(const uint8_t* config, int size);                  //导入 avcC/hvcC，返回长度字段字节数
+        int getDecoderConfig(std::vector<uint8_t>& config);                     //由已有的参数集生成 avcC/hvcC
+        int getParameterSetsAnnexB(std::vector<uint8_t>& data);                 //快速换台时放在第一个关键帧之前
+        const H26xVideoInfo* getVideoInfo() { return m_videoInfo.width > 0 ? &m_videoInfo : NULL; }
+
+    private:
+        struct NalInfo {
+            int         offset;             //相对 access unit 开始
+            int         size;
+            int         type;
+            int         prefixSize;
+        };
+        struct ChunkMark {
+            int         offset;             //在当前视图中的位置
+            int64_t     pts;
+            int64_t     dts;
+        };
+
+        bool isVcl(int type);
+        bool beginsAccessUnit(const uint8_t* nal, int size, int type, bool* firstSlice);
+        void processNal(const uint8_t* nal, int size, int type, H26xAccessUnit* info);
+        void storeParameterSet(std::vector<std::vector<uint8_t> >& sets, int id, const uint8_t* nal, int size);
+        int parseH264SPS(const uint8_t* nal, int size);
+        int parseH264PPS(const uint8_t* nal, int size);
+        int parseH265SPS(const uint8_t* nal, int size);
+        int parseH265PPS(const uint8_t* nal, int size);
+        int parseSliceHeader(const uint8_t* nal, int size, int type);
+        bool hasRecoveryPoint(const uint8_t* nal, int size);
+        int processView(const uint8_t* view, int length, bool last);
+        void emitAccessUnit(const uint8_t* view, int end);
+
+        /* 判断新的 primary picture 用到的 slice header 字段(H.264 7.4.1.2.4) */
+        struct SliceState {
+            bool        valid;
+            int         frameNum;
+            int         ppsId;
+            int         fieldPic;
+            int         bottomField;
+            int         nalRefIdc;
+            int         idr;
+            int         idrPicId;
+            int         pocLsb;
+            int         deltaPocBottom;
+            int         deltaPoc0;
+            int         deltaPoc1;
+            int         firstSlice;         //H.265 first_slice_segment_in_pic_flag / H.264 first_mb_in_slice == 0
+            int         sliceType;
+        };
+
+        int                             m_codec;
+        H264ParserCallbacks             m_callbacks;
+        H26xVideoInfo                   m_videoInfo;
+
+        /* 参数集：原始 NAL 和解析出的字段，按 id 保存 */
+        std::vector<std::vector<uint8_t> >  m_vps;
+        std::vector<std::vector<uint8_t> >  m_sps;
+        std::vector<std::vector<uint8_t> >  m_pps;
+        struct SpsFields {
+            bool        valid;
+            int         log2MaxFrameNum;
+            int         pocType;
+            int         log2MaxPocLsb;
+            int         deltaPicOrderAlwaysZero;
+            int         frameMbsOnly;
+            int         separateColourPlane;
+        };
+        struct PpsFields {
+            bool        valid;
+            int         spsId;
+            int         bottomFieldPicOrderPresent;
+            int         numExtraSliceHeaderBits;    //H.265
+            int         dependentSliceSegments;     //H.265
+        };
+        SpsFields                       m_spsFields[H26X_PARAMETER_SET_MAX];
+        PpsFields                       m_ppsFields[H26X_PARAMETER_SET_MAX];
+        int                             m_activeSps;
+        uint8_t                         m_profileTierLevel[12];     //H.265 general_profile_tier_level，生成 hvcC 使用
+
+        /* 流式解析：跨 parse() 的数据保存在 m_buffer，视图为 m_buffer 或调用者的缓冲区 */
+        std::vector<uint8_t>            m_buffer;
+        std::vector<NalInfo>            m_nals;             //当前 access unit 中已完整的 NAL
+        std::vector<NALUnit>            m_units;            //回调时使用
+        std::vector<ChunkMark>          m_marks;
+        int                             m_auStart;          //当前 access unit 在视图中的位置，-1 表示还没有
+        int                             m_nalStart;         //当前未完成的 NAL 的起始码位置，-1 表示还没有
+        int                             m_nalPrefix;
+        int                             m_scan;             //下一次查找起始码的位置
+        int64_t                         m_auPts;
+        int64_t                         m_auDts;
+        H26xAccessUnit                  m_au;               //当前 access unit 的标志
+        bool                            m_auHasVcl;
+        SliceState                      m_lastSlice;
+        SliceState                      m_slice;            //最近一次 parseSliceHeader 的结果
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__H264_PARSER_H__
@@ -0,0 +1,725 @@
+/**
+ *  HLSClient.cpp文件
+ *  HTTP Live Streaming 客户端 (APP_PLAYTYPE_HLS, CODEC_ID_HTTP_LIVE)；
+ *  主要有以下部分：
+ *      1. 码率选择：每个分片下载的吞吐量进入快慢两个 EWMA，按缓冲水位选择 variant，在分片边界切换
+ *      2. 预取线程：用一个 keep-alive 连接依次下载列表和分片，放入内存队列，超过时长或字节上限时等待读取
+ *      3. 直播：从倒数第 HLS_LIVE_EDGE_SEGMENTS 个分片开始，按 target duration 重新下载列表，落后窗口时跳过
+ *      4. read()：分片(fMP4 时先是初始化段)按顺序拼成连续的字节流，保留最近读过的数据供 DemuxerOpen 重读
+ *      5. DemuxSource：m3u8 地址作为 Demuxer 的数据源，分片不写到磁盘
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "SettingsRegistry.h"
+#include "HLSClient.h"
+
+
+static int64_t HLSNowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* pthread_cond_timedwait 使用 CLOCK_REALTIME */
+static void HLSDeadline(struct timespec* deadline, int64_t waitUs)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    deadline->tv_sec = now.tv_sec + waitUs / 1000000;
+    deadline->tv_nsec = (now.tv_usec + waitUs % 1000000) * 1000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+
+void HLSConfigDefault(HLSConfig* config)
+{
+    config->maxBufferUs = HLS_BUFFER_US_DEFAULT;
+    config->maxBufferBytes = HLS_BUFFER_BYTES_DEFAULT;
+    config->lowBufferUs = HLS_LOW_BUFFER_US_DEFAULT;
+    config->switchUpBufferUs = HLS_SWITCH_UP_US_DEFAULT;
+    config->startBandwidth = SETTINGS_GET_INT(HlsStartBandwidth);
+    config->maxBandwidth = SETTINGS_GET_INT(HlsMaxBandwidth);
+    config->fixedVariant = -1;
+}
+
+
+HLSAdaptation::HLSAdaptation()
+{
+    reset();
+}
+
+void HLSAdaptation::reset()
+{
+    m_fast = 0;
+    m_slow = 0;
+    m_samples = 0;
+}
+
+void HLSAdaptation::addSample(int64_t bytes, int64_t elapsedUs)
+{
+    double sample;
+
+    if (bytes < HLS_SAMPLE_BYTES_MIN || elapsedUs <= 0)
+        return;
+    sample = (double)bytes * 8 * 1000000 / elapsedUs;
+    if (m_samples++ == 0) {
+        m_fast = m_slow = sample;
+        return;
+    }
+    m_fast += (sample - m_fast) * HLS_FAST_WEIGHT / 100;
+    m_slow += (sample - m_slow) * HLS_SLOW_WEIGHT / 100;
+}
+
+int64_t HLSAdaptation::getBandwidth()
+{
+    return (int64_t)std::min(m_fast, m_slow);
+}
+
+int HLSAdaptation::select(const std::vector<int64_t>& bandwidths, int current, int64_t bufferedUs, const HLSConfig& config)
+{
+    int64_t bandwidth = getBandwidth();
+    int64_t usable;
+    int candidate = 0, count = (int)bandwidths.size();
+    bool low = bufferedUs < config.lowBufferUs;
+
+    if (count == 0)
+        return 0;
+    current = std::max(0, std::min(current, count - 1));
+    if (m_samples == 0)
+        return current;
+
+    usable = bandwidth * (low ? HLS_SAFETY_LOW : HLS_SAFETY_NORMAL) / 100;
+    while (candidate + 1 < count && bandwidths[candidate + 1] <= usable)
+        candidate++;
+
+    if (candidate > current)
+        return (bufferedUs >= config.switchUpBufferUs) ? current + 1 : current;
+    if (candidate < current && (low || bandwidths[current] > bandwidth))
+        return candidate;
+    return current;
+}
+
+
+HLSClient::HLSClient()
+    : m_variant(0)
+    , m_locked(true)
+    , m_nextSequence(0)
+    , m_nextStartUs(0)
+    , m_reloadUs(0)
+    , m_threadStarted(false)
+    , m_closing(false)
+    , m_historyBase(0)
+    , m_writeOffset(0)
+    , m_readOffset(0)
+    , m_generation(0)
+    , m_seekUs(-1)
+    , m_ended(false)
+    , m_live(false)
+    , m_durationUs(0)
+{
+    HLSConfigDefault(&m_config);
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+HLSClient::~HLSClient()
+{
+    close();
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int HLSClient::open(const char* url, const HLSConfig* config)
+{
+    std::vector<uint8_t> data;
+    HLSPlaylist playlist;
+    int start, i;
+
+    close();
+    if (config)
+        m_config = *config;
+    m_closing = false;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_adaptation.reset();
+
+    if (fetch(url, 0, -1, data, false) < 0)
+        return -1;
+    if (playlist.parse(data.empty() ? "" : (const char*)&data[0], data.size(), m_http.getEffectiveUrl().c_str()) < 0)
+        return -1;
+
+    if (playlist.isMaster()) {
+        m_master = playlist;
+        if (m_config.fixedVariant >= 0) {
+            start = std::min(m_config.fixedVariant, m_master.getVariantCount() - 1);
+        } else {
+            for (start = 0, i = 1; i < m_master.getVariantCount(); i++) {
+                int64_t bandwidth = m_master.getVariant(i)->bandwidth;
+                if (bandwidth <= m_config.startBandwidth && (m_config.maxBandwidth <= 0 || bandwidth <= m_config.maxBandwidth))
+                    start = i;
+            }
+        }
+        if (loadMedia(start, false) < 0)
+            return -1;
+    } else {
+        m_master.clear();
+        m_media = playlist;
+        m_mediaUrl = m_media.getUrl();
+        m_variant = 0;
+    }
+    if (m_media.getSegmentCount() == 0 && m_media.isEnded()) {
+        playerLogError("hls: [%s] has no segment.\n", url);
+        return -1;
+    }
+
+    m_live = !m_media.isEnded();
+    m_durationUs = m_live ? 0 : m_media.getDurationUs();
+    m_nextSequence = m_media.getFirstSequence();
+    if (m_live && m_media.getSegmentCount() > HLS_LIVE_EDGE_SEGMENTS)
+        m_nextSequence += m_media.getSegmentCount() - HLS_LIVE_EDGE_SEGMENTS;
+    m_nextStartUs = m_media.getSegmentCount() > 0 ? m_media.getSegment(m_media.findSequence(m_nextSequence))->startUs : 0;
+    m_reloadUs = HLSNowUs() + m_media.getTargetDurationUs();
+    m_locked = m_config.fixedVariant >= 0 || m_master.getVariantCount() <= 1;
+    if (!m_locked && m_media.getSegmentCount() > 0 && m_media.getSegment(0)->mapIndex >= 0) {
+        playerLogInfo("hls: fmp4 segments, variant switching disabled.\n");
+        m_locked = true;
+    }
+    m_mapKey.clear();
+    m_historyBase = m_writeOffset = m_readOffset = 0;
+    m_seekUs = -1;
+    m_ended = false;
+    m_statistics.variant = m_variant;
+
+    if (pthread_create(&m_thread, NULL, prefetchThread, this) != 0) {
+        playerLogError("hls: create prefetch thread failed.\n");
+        close();
+        return -1;
+    }
+    m_threadStarted = true;
+    playerLogInfo("hls: [%s] %s, %d variants, start with [%d] %d segments.\n", url, m_live ? "live" : "vod",
+                  m_master.getVariantCount(), m_variant, m_media.getSegmentCount());
+    return 0;
+}
+
+void HLSClient::close()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_closing = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (m_threadStarted) {
+        pthread_join(m_thread, NULL);
+        m_threadStarted = false;
+    }
+    m_http.close();
+    while (!m_chunks.empty()) {
+        delete m_chunks.front();
+        m_chunks.pop_front();
+    }
+    m_master.clear();
+    m_media.clear();
+}
+
+/* 下载到 data，sample 时计入带宽估计；返回 0 成功 */
+int HLSClient::fetch(const std::string& url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& data, bool sample)
+{
+    int64_t start = HLSNowUs(), elapsed;
+    int status = m_http.get(url.c_str(), rangeOffset, rangeLength, data, &m_closing);
+
+    elapsed = HLSNowUs() - start;
+    //服务器不支持 Range 时返回整个文件
+    if (status == 200 && (rangeOffset > 0 || rangeLength >= 0)) {
+        if (rangeOffset >= (int64_t)data.size()) {
+            data.clear();
+        } else {
+            data.erase(data.begin(), data.begin() + rangeOffset);
+            if (rangeLength >= 0 && rangeLength < (int64_t)data.size())
+                data.resize(rangeLength);
+        }
+    }
+    if (sample && (status == 200 || status == 206))
+        m_adaptation.addSample(data.size(), elapsed);
+
+    pthread_mutex_lock(&m_mutex);
+    m_statistics.http = m_http.getStatistics();
+    m_statistics.bandwidth = m_adaptation.getBandwidth();
+    if (status != 200 && status != 206)
+        m_statistics.failures++;
+    pthread_mutex_unlock(&m_mutex);
+
+    if (status != 200 && status != 206) {
+        if (status > 0)
+            playerLogWarning("hls: get [%s] status [%d].\n", url.c_str(), status);
+        return -1;
+    }
+    return 0;
+}
+
+int HLSClient::loadMedia(int variant, bool reload)
+{
+    std::vector<uint8_t> data;
+    HLSPlaylist playlist;
+    std::string url = m_master.isMaster() ? m_master.getVariant(variant)->url : m_mediaUrl;
+
+    if (fetch(url, 0, -1, data, false) < 0)
+        return -1;
+    if (playlist.parse(data.empty() ? "" : (const char*)&data[0], data.size(), m_http.getEffectiveUrl().c_str()) < 0)
+        return -1;
+    if (playlist.isMaster()) {
+        playerLogError("hls: variant [%s] is a master playlist.\n", url.c_str());
+        return -1;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_media = playlist;
+    m_variant = variant;
+    m_statistics.variant = variant;
+    if (reload)
+        m_statistics.reloads++;
+    if (m_media.isEnded() && m_live) {
+        m_live = false;
+        m_durationUs = m_media.getDurationUs();
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (!m_master.isMaster())
+        m_mediaUrl = m_media.getUrl();
+    return 0;
+}
+
+int64_t HLSClient::bufferedUs()
+{
+    int64_t duration = 0;
+    size_t i;
+
+    for (i = 0; i < m_chunks.size(); i++) {
+        if (m_chunks[i]->offset + (int64_t)m_chunks[i]->data.size() > m_readOffset)
+            duration += m_chunks[i]->durationUs;
+    }
+    return duration;
+}
+
+/* 缓冲满时等待读取；返回 false 为关闭或有 seek 请求 */
+bool HLSClient::waitSpace()
+{
+    struct timespec deadline;
+
+    pthread_mutex_lock(&m_mutex);
+    while (!m_closing && m_seekUs < 0) {
+        int64_t bytes = m_writeOffset - std::max(m_readOffset, m_historyBase);
+        if (bufferedUs() < m_config.maxBufferUs && bytes < m_config.maxBufferBytes)
+            break;
+        HLSDeadline(&deadline, 100000);
+        pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+    }
+    bool ready = !m_closing && m_seekUs < 0;
+    pthread_mutex_unlock(&m_mutex);
+    return ready;
+}
+
+bool HLSClient::waitMs(int64_t ms)
+{
+    struct timespec deadline;
+
+    pthread_mutex_lock(&m_mutex);
+    if (!m_closing && m_seekUs < 0 && ms > 0) {
+        HLSDeadline(&deadline, ms * 1000);
+        pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+    }
+    bool ready = !m_closing && m_seekUs < 0;
+    pthread_mutex_unlock(&m_mutex);
+    return ready;
+}
+
+int HLSClient::chooseVariant()
+{
+    std::vector<int64_t> bandwidths;
+    HLSConfig config;
+    int64_t buffered;
+    int i;
+
+    pthread_mutex_lock(&m_mutex);
+    config = m_config;
+    buffered = bufferedUs();
+    pthread_mutex_unlock(&m_mutex);
+
+    //最低的 variant 总是可以选择
+    for (i = 0; i < m_master.getVariantCount(); i++) {
+        int64_t bandwidth = m_master.getVariant(i)->bandwidth;
+        if (i > 0 && config.maxBandwidth > 0 && bandwidth > config.maxBandwidth)
+            break;
+        bandwidths.push_back(bandwidth);
+    }
+    return m_adaptation.select(bandwidths, m_variant, buffered, config);
+}
+
+/* 在分片边界切换：直播按序号对齐，点播按时间对齐 */
+int HLSClient::switchVariant(int variant)
+{
+    int previous = m_variant;
+    int index;
+
+    if (loadMedia(variant, false) < 0)
+        return -1;
+    if (!m_live) {
+        index = m_media.findTime(m_nextStartUs + HLS_ALIGN_US);
+        if (index >= 0 && m_media.getSegment(index)->startUs + HLS_ALIGN_US < m_nextStartUs)
+            index++;    //超过结尾
+        m_nextSequence = m_media.getFirstSequence() + std::max(index, 0);
+    }
+    m_reloadUs = HLSNowUs() + m_media.getTargetDurationUs();
+
+    pthread_mutex_lock(&m_mutex);
+    if (variant > previous)
+        m_statistics.switchesUp++;
+    else
+        m_statistics.switchesDown++;
+    pthread_mutex_unlock(&m_mutex);
+    playerLogInfo("hls: switch variant [%d] -> [%d], bandwidth [%lld] estimate [%lld].\n", previous, variant,
+                  (long long)m_master.getVariant(variant)->bandwidth, (long long)m_adaptation.getBandwidth());
+    return 0;
+}
+
+void HLSClient::pushChunk(Chunk* chunk, int generation)
+{
+    pthread_mutex_lock(&m_mutex);
+    if (generation != m_generation || m_closing) {
+        pthread_mutex_unlock(&m_mutex);
+        delete chunk;
+        return;
+    }
+    chunk->offset = m_writeOffset;
+    m_writeOffset += chunk->data.size();
+    if (chunk->durationUs > 0) {
+        m_statistics.segments++;
+        m_statistics.segmentBytes += chunk->data.size();
+    }
+    m_chunks.push_back(chunk);
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* HLSClient::prefetchThread(void* arg)
+{
+    ((HLSClient*)arg)->runPrefetch();
+    return NULL;
+}
+
+void HLSClient::runPrefetch()
+{
+    HLSSegment segment;
+    const HLSMap* map;
+    Chunk* chunk;
+    int64_t seekUs, lastSequence;
+    int generation, index, retry, variant;
+    char key[64];
+
+    while (!m_closing) {
+        pthread_mutex_lock(&m_mutex);
+        seekUs = m_seekUs;
+        m_seekUs = -1;
+        generation = m_generation;
+        pthread_mutex_unlock(&m_mutex);
+        if (seekUs >= 0) {
+            index = std::max(m_media.findTime(seekUs), 0);
+            m_nextSequence = m_media.getFirstSequence() + index;
+            m_nextStartUs = m_media.getSegmentCount() > 0 ? m_media.getSegment(index)->startUs : 0;
+            m_mapKey.clear();
+        }
+
+        //直播：到时间重新下载列表，没有新分片时半个 target duration 之后再试
+        if (m_live && HLSNowUs() >= m_reloadUs) {
+            lastSequence = m_media.getFirstSequence() + m_media.getSegmentCount();
+            if (loadMedia(m_variant, true) == 0 && m_media.getFirstSequence() + m_media.getSegmentCount() == lastSequence)
+                m_reloadUs = HLSNowUs() + m_media.getTargetDurationUs() / 2;
+            else
+                m_reloadUs = HLSNowUs() + m_media.getTargetDurationUs();
+        }
+
+        index = m_media.findSequence(m_nextSequence);
+        if (index < 0) {
+            if (m_live && m_media.getSegmentCount() > 0 && m_nextSequence < m_media.getFirstSequence()) {
+                pthread_mutex_lock(&m_mutex);
+                m_statistics.skipped += m_media.getFirstSequence() - m_nextSequence;
+                pthread_mutex_unlock(&m_mutex);
+                playerLogWarning("hls: fell behind live window, skip to [%lld].\n", (long long)m_media.getFirstSequence());
+                m_nextSequence = m_media.getFirstSequence();
+                continue;
+            }
+            if (m_live) {
+                waitMs((m_reloadUs - HLSNowUs()) / 1000);
+                continue;
+            }
+            pthread_mutex_lock(&m_mutex);
+            m_ended = true;
+            pthread_cond_broadcast(&m_cond);
+            while (!m_closing && m_seekUs < 0)
+                pthread_cond_wait(&m_cond, &m_mutex);
+            pthread_mutex_unlock(&m_mutex);
+            continue;
+        }
+        if (!waitSpace())
+            continue;
+
+        if (!m_locked) {
+            variant = chooseVariant();
+            if (variant != m_variant && switchVariant(variant) == 0)
+                continue;
+        }
+        segment = *m_media.getSegment(index);
+
+        //fMP4：初始化段变化时先放入字节流
+        map = m_media.getMap(segment.mapIndex);
+        if (map) {
+            snprintf(key, sizeof(key), "@%lld+%lld", (long long)map->rangeOffset, (long long)map->rangeLength);
+            if (m_mapKey != map->url + key) {
+                chunk = new Chunk;
+                if (fetch(map->url, map->rangeOffset, map->rangeLength, chunk->data, false) < 0) {
+                    delete chunk;
+                    waitMs(HLS_RETRY_WAIT_MS);
+                    continue;
+                }
+                chunk->durationUs = 0;
+                chunk->sequence = segment.sequence;
+                chunk->variant = m_variant;
+                m_mapKey = map->url + key;
+                pushChunk(chunk, generation);
+            }
+        }
+
+        chunk = new Chunk;
+        for (retry = 0; retry <= HLS_RETRY_MAX && !m_closing; retry++) {
+            if (fetch(segment.url, segment.rangeOffset, segment.rangeLength, chunk->data, true) == 0)
+                break;
+            waitMs(HLS_RETRY_WAIT_MS);
+        }
+        if (retry > HLS_RETRY_MAX || m_closing) {
+            if (!m_closing) {
+                playerLogWarning("hls: skip segment [%s].\n", segment.url.c_str());
+                pthread_mutex_lock(&m_mutex);
+                m_statistics.skipped++;
+                pthread_mutex_unlock(&m_mutex);
+            }
+            delete chunk;
+        } else {
+            chunk->durationUs = std::max(segment.durationUs, (int64_t)1);
+            chunk->sequence = segment.sequence;
+            chunk->variant = m_variant;
+            pushChunk(chunk, generation);
+        }
+        m_nextSequence = segment.sequence + 1;
+        m_nextStartUs = segment.startUs + segment.durationUs;
+    }
+}
+
+/* 读过的数据只保留最近 HLS_HISTORY_BYTES */
+void HLSClient::trimHistory()
+{
+    while (!m_chunks.empty()) {
+        Chunk* front = m_chunks.front();
+        int64_t end = front->offset + front->data.size();
+        if (end > m_readOffset - HLS_HISTORY_BYTES)
+            break;
+        m_historyBase = end;
+        m_chunks.pop_front();
+        delete front;
+    }
+}
+
+int HLSClient::read(int64_t offset, uint8_t* buffer, int size, int timeoutMs)
+{
+    struct timespec deadline;
+    int64_t now, endUs = (timeoutMs >= 0) ? HLSNowUs() + (int64_t)timeoutMs * 1000 : -1;
+    size_t i;
+
+    pthread_mutex_lock(&m_mutex);
+    for (;;) {
+        if (offset < m_historyBase) {
+            pthread_mutex_unlock(&m_mutex);
+            return -1;
+        }
+        if (offset < m_writeOffset) {
+            for (i = 0; i < m_chunks.size(); i++) {
+                Chunk* chunk = m_chunks[i];
+                if (offset < chunk->offset + (int64_t)chunk->data.size())
+                    break;
+            }
+            Chunk* chunk = m_chunks[i];
+            size = (int)std::min((int64_t)size, chunk->offset + (int64_t)chunk->data.size() - offset);
+            memcpy(buffer, &chunk->data[offset - chunk->offset], size);
+            if (offset + size > m_readOffset) {
+                m_readOffset = offset + size;
+                trimHistory();
+                pthread_cond_broadcast(&m_cond);
+            }
+            pthread_mutex_unlock(&m_mutex);
+            return size;
+        }
+        if (m_closing || m_ended) {
+            pthread_mutex_unlock(&m_mutex);
+            return 0;
+        }
+
+        now = HLSNowUs();
+        if (endUs >= 0 && now >= endUs) {
+            pthread_mutex_unlock(&m_mutex);
+            return -2;
+        }
+        HLSDeadline(&deadline, (endUs >= 0) ? std::min(endUs - now, (int64_t)100000) : 100000);
+        pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+    }
+}
+
+int64_t HLSClient::seek(int64_t timeUs)
+{
+    int64_t startUs;
+    int index;
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_live || !m_threadStarted || m_media.getSegmentCount() == 0) {
+        pthread_mutex_unlock(&m_mutex);
+        return -1;
+    }
+    index = std::max(m_media.findTime(timeUs), 0);
+    startUs = m_media.getSegment(index)->startUs;
+    m_seekUs = std::max(timeUs, (int64_t)0);
+    m_generation++;
+    while (!m_chunks.empty()) {
+        delete m_chunks.front();
+        m_chunks.pop_front();
+    }
+    m_historyBase = m_writeOffset = m_readOffset = 0;
+    m_ended = false;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    return startUs;
+}
+
+bool HLSClient::isLive()
+{
+    bool live;
+
+    pthread_mutex_lock(&m_mutex);
+    live = m_live;
+    pthread_mutex_unlock(&m_mutex);
+    return live;
+}
+
+int64_t HLSClient::getDurationUs()
+{
+    int64_t duration;
+
+    pthread_mutex_lock(&m_mutex);
+    duration = m_durationUs;
+    pthread_mutex_unlock(&m_mutex);
+    return duration;
+}
+
+int HLSClient::getVariant()
+{
+    int variant;
+
+    pthread_mutex_lock(&m_mutex);
+    variant = m_variant;
+    pthread_mutex_unlock(&m_mutex);
+    return variant;
+}
+
+void HLSClient::setMaxBandwidth(int64_t bandwidth)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_config.maxBandwidth = bandwidth;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+HLSStatistics HLSClient::getStatistics()
+{
+    HLSStatistics statistics;
+
+    pthread_mutex_lock(&m_mutex);
+    statistics = m_statistics;
+    statistics.bufferedUs = bufferedUs();
+    statistics.bufferedBytes = m_writeOffset - std::max(m_readOffset, m_historyBase);
+    pthread_mutex_unlock(&m_mutex);
+    return statistics;
+}
+
+void HLSClient::logStatistics()
+{
+    HLSStatistics statistics = getStatistics();
+
+    playerLogInfo("hls: segments[%lld] bytes[%lld] failures[%lld] skipped[%lld] reloads[%lld] up[%lld] down[%lld] variant[%d]\n",
+                  (long long)statistics.segments, (long long)statistics.segmentBytes, (long long)statistics.failures,
+                  (long long)statistics.skipped, (long long)statistics.reloads, (long long)statistics.switchesUp,
+                  (long long)statistics.switchesDown, statistics.variant);
+    playerLogInfo("hls: bandwidth[%lld]bps buffered[%lld]us [%lld]bytes connects[%lld] requests[%lld] reuses[%lld] retries[%lld]\n",
+                  (long long)statistics.bandwidth, (long long)statistics.bufferedUs, (long long)statistics.bufferedBytes,
+                  (long long)statistics.http.connects, (long long)statistics.http.requests, (long long)statistics.http.reuses,
+                  (long long)statistics.http.retries);
+}
+
+
+static int HLSSourceRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    int ret = ((HLSClient*)opaque)->read(offset, buffer, size, HLS_SOURCE_TIMEOUT_MS);
+
+    if (ret == -2) {
+        playerLogWarning("hls: no data for %d ms.\n", HLS_SOURCE_TIMEOUT_MS);
+        return -1;
+    }
+    return ret;
+}
+
+int DemuxSourceOpenHLS(DemuxSource* source, const char* url)
+{
+    HLSClient* client = new HLSClient();
+
+    if (client->open(url, NULL) < 0) {
+        delete client;
+        return -1;
+    }
+    source->read = HLSSourceRead;
+    source->size = -1;
+    source->opaque = client;
+    return 0;
+}
+
+void DemuxSourceCloseHLS(DemuxSource* source)
+{
+    if (DemuxSourceIsHLS(source)) {
+        ((HLSClient*)source->opaque)->logStatistics();
+        delete (HLSClient*)source->opaque;
+    }
+    memset(source, 0, sizeof(*source));
+}
+
+bool DemuxSourceIsHLS(const DemuxSource* source)
+{
+    return source->read == HLSSourceRead;
+}
+
+bool HLSIsPlaylistUrl(const char* url)
+{
+    const char* end;
+
+    if (strncmp(url, "http://", 7) != 0)
+        return false;
+    end = url + strcspn(url, "?#");
+    return end - url >= 5 + 7 && strncasecmp(end - 5, ".m3u8", 5) == 0;
+}
@@ -0,0 +1,203 @@
+#ifndef __HLS_CLIENT_H__
+#define __HLS_CLIENT_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Demuxer.h"
+#include "HLSPlaylist.h"
+#include "HTTPConnection.h"
+
+
+#define     HLS_BUFFER_US_DEFAULT       30000000        //预取领先读取位置的时长上限
+#define     HLS_BUFFER_BYTES_DEFAULT    (32 * 1024 * 1024)
+#define     HLS_LOW_BUFFER_US_DEFAULT   8000000         //低于这个水位时按更保守的带宽选择，并允许立即降码率
+#define     HLS_SWITCH_UP_US_DEFAULT    12000000        //高于这个水位才升码率
+#define     HLS_LIVE_EDGE_SEGMENTS      3               //直播从倒数第几个分片开始
+#define     HLS_HISTORY_BYTES           DEMUX_OPEN_SCAN_MAX     //保留已经读过的数据，DemuxerOpen 探测之后会从头重读
+#define     HLS_SAMPLE_BYTES_MIN        (16 * 1024)     //太小的下载受延时影响大，不计入带宽估计
+#define     HLS_FAST_WEIGHT             50              //带宽 EWMA 的权重(百分比)：快速的跟随下降，慢速的避免抖动
+#define     HLS_SLOW_WEIGHT             10
+#define     HLS_SAFETY_LOW              70              //缓冲低于低水位时可用的带宽比例
+#define     HLS_SAFETY_NORMAL           85
+#define     HLS_RETRY_MAX               3               //分片下载失败的重试次数，之后跳过
+#define     HLS_RETRY_WAIT_MS           500
+#define     HLS_SOURCE_TIMEOUT_MS       20000           //作为 DemuxSource 时这么久没有数据按出错返回
+#define     HLS_ALIGN_US                200000          //点播切换 variant 时按时间找下一个分片，允许分片边界的误差
+
+
+typedef struct _HLSConfig {
+    int64_t             maxBufferUs;
+    int64_t             maxBufferBytes;
+    int64_t             lowBufferUs;
+    int64_t             switchUpBufferUs;
+    int64_t             startBandwidth;     //bit/s，选择第一个 variant；0 时从最低码率开始
+    int64_t             maxBandwidth;       //bit/s，0 不限
+    int                 fixedVariant;       //-1 自动切换，否则固定为按带宽排序的第几个
+} HLSConfig;
+
+void HLSConfigDefault(HLSConfig* config);
+
+typedef struct _HLSStatistics {
+    int64_t             segments;           //下载完成的分片
+    int64_t             segmentBytes;
+    int64_t             failures;           //下载失败(包括重试)
+    int64_t             skipped;            //重试之后仍然失败而跳过的分片，直播落后窗口时跳过的分片
+    int64_t             reloads;            //直播时重新下载 media 列表
+    int64_t             switchesUp;
+    int64_t             switchesDown;
+    int64_t             bandwidth;          //当前的带宽估计，bit/s
+    int64_t             bufferedUs;         //已经下载还没有读取的时长
+    int64_t             bufferedBytes;
+    int                 variant;            //正在下载的 variant
+    HTTPStatistics      http;
+} HLSStatistics;
+
+
+class HLSAdaptation { /* 码率选择：吞吐量的快慢两个 EWMA 取较小值，按缓冲水位决定可用的比例和是否允许切换 */
+    public:
+        HLSAdaptation();
+
+        void reset();
+        void addSample(int64_t bytes, int64_t elapsedUs);   //一次下载，太小的忽略
+        int64_t getBandwidth();                             //bit/s，还没有样本时为 0
+
+        /**
+         *  @Func: select
+         *         ps. :低于低水位时可以立即降；高于升级水位才升，每次最多升一级；
+         *               两者之间只在当前 variant 超过估计带宽时降
+         *  @Param: bandwidths, type:: const std::vector<int64_t>&, 从低到高
+         *  @Param: current, type:: int
+         *  @Param: bufferedUs, type:: int64_t
+         *  @Param: config, type:: const HLSConfig&
+         *  @Return: int, 选择的下标
+         *
+         **/
+        int select(const std::vector<int64_t>& bandwidths, int current, int64_t bufferedUs, const HLSConfig& config);
+
+    private:
+        double                  m_fast;
+        double                  m_slow;
+        int                     m_samples;
+};
+
+
+class HLSClient { /* HLS：预取线程用 keep-alive 连接下载分片到内存队列，按带宽和缓冲切换码率，分片按顺序拼接成 TS/fMP4 的字节流 */
+    public:
+        HLSClient();
+        ~HLSClient();
+
+        /**
+         *  @Func: open
+         *         ps. :下载 master/media 列表，启动预取线程；fMP4 的 variant 之间初始化段不同，
+         *               字节流中途不能换 moov，此时固定在打开时选择的 variant
+         *  @Param: url, type:: const char*
+         *  @Param: config, type:: const HLSConfig*, NULL 为默认
+         *  @Return: int, 0 成功，-1 失败
+         *
+         **/
+        int open(const char* url, const HLSConfig* config);
+        void close();
+
+        /**
+         *  @Func: read
+         *         ps. :offset 为从打开(或 seek)开始的字节位置；可以重读最近 HLS_HISTORY_BYTES 字节
+         *  @Param: offset, type:: int64_t
+         *  @Param: buffer, type:: uint8_t*
+         *  @Param: size, type:: int
+         *  @Param: timeoutMs, type:: int, -1 一直等待
+         *  @Return: int, 读到的字节数，结束或关闭返回 0，超时返回 -2，offset 已经丢弃时返回 -1
+         *
+         **/
+        int read(int64_t offset, uint8_t* buffer, int size, int timeoutMs);
+
+        /**
+         *  @Func: seek
+         *         ps. :点播时丢弃队列，从包含 timeUs 的分片开始下载，字节流从 0 重新开始，调用者需要重新打开 Demuxer
+         *  @Param: timeUs, type:: int64_t
+         *  @Return: int64_t, 分片的开始时间，直播或失败返回 -1
+         *
+         **/
+        int64_t seek(int64_t timeUs);
+
+        bool isLive();
+        int64_t getDurationUs();
+        int getVariantCount() { return m_master.getVariantCount(); }
+        int getVariant();
+        void setMaxBandwidth(int64_t bandwidth);
+        HLSStatistics getStatistics();
+        void logStatistics();
+
+    private:
+        typedef struct _Chunk {
+            std::vector<uint8_t>    data;
+            int64_t                 offset;         //在字节流中的位置
+            int64_t                 durationUs;     //初始化段为 0
+            int64_t                 sequence;
+            int                     variant;
+        } Chunk;
+
+        HLSClient(const HLSClient&);
+        HLSClient& operator=(const HLSClient&);
+
+        static void* prefetchThread(void* arg);
+        void runPrefetch();
+        int loadMedia(int variant, bool reload);
+        int fetch(const std::string& url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& data, bool sample);
+        bool waitSpace();
+        bool waitMs(int64_t ms);
+        int chooseVariant();
+        int switchVariant(int variant);
+        void pushChunk(Chunk* chunk, int generation);
+        void trimHistory();
+        int64_t bufferedUs();
+
+        HLSConfig                   m_config;
+        HTTPConnection              m_http;             //只在预取线程和 open() 中使用
+        HLSPlaylist                 m_master;           //不是 master 时为空
+        HLSPlaylist                 m_media;            //m_variant 的 media 列表，预取线程持有 m_mutex 替换
+        std::string                 m_mediaUrl;
+        HLSAdaptation               m_adaptation;
+        int                         m_variant;          //预取线程持有 m_mutex 修改
+        bool                        m_locked;           //fMP4 或者固定 variant，不切换
+        int64_t                     m_nextSequence;     //下一个要下载的分片
+        int64_t                     m_nextStartUs;      //下一个分片的开始时间，点播切换 variant 时按时间对齐
+        std::string                 m_mapKey;           //字节流中最近的初始化段，地址和范围
+        int64_t                     m_reloadUs;         //直播下次重新下载列表的时间
+
+        pthread_t                   m_thread;
+        bool                        m_threadStarted;
+        volatile bool               m_closing;
+        pthread_mutex_t             m_mutex;            //保护以下成员
+        pthread_cond_t              m_cond;
+        std::deque<Chunk*>          m_chunks;           //从 m_historyBase 开始连续
+        int64_t                     m_historyBase;
+        int64_t                     m_writeOffset;      //下一个分片在字节流中的位置
+        int64_t                     m_readOffset;       //读到的最远位置
+        int                         m_generation;       //seek 之后增加，丢弃正在下载的旧分片
+        int64_t                     m_seekUs;           //-1 为没有请求
+        bool                        m_ended;            //点播已经下载到结尾
+        bool                        m_live;
+        int64_t                     m_durationUs;
+        HLSStatistics               m_statistics;
+};
+
+
+/* Demuxer 的数据源：http:// 开头的 m3u8 地址 */
+int DemuxSourceOpenHLS(DemuxSource* source, const char* url);
+void DemuxSourceCloseHLS(DemuxSource* source);
+bool DemuxSourceIsHLS(const DemuxSource* source);
+bool HLSIsPlaylistUrl(const char* url);        //http:// 并且路径以 .m3u8 结尾
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__HLS_CLIENT_H__
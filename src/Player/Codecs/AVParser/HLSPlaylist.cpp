@@ -0,0 +1,322 @@
+/**
+ *  HLSPlaylist.cpp文件
+ *  HTTP Live Streaming 的 m3u8 解析；
+ *  主要有以下部分：
+ *      1. 属性列表：KEY=VALUE 以逗号分隔，带引号的值中可以有逗号
+ *      2. master 列表：EXT-X-STREAM-INF 和之后的地址为一个 variant，EXT-X-MEDIA 的独立音轨暂不支持
+ *      3. media 列表：EXTINF、EXT-X-BYTERANGE、EXT-X-MAP(fMP4 初始化段)、EXT-X-DISCONTINUITY、EXT-X-ENDLIST
+ *      4. 相对地址的解析
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "HLSPlaylist.h"
+
+
+typedef std::vector<std::pair<std::string, std::string> > HLSAttributes;
+
+static bool HLSStartsWith(const std::string& line, const char* prefix)
+{
+    return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static void HLSParseAttributes(const std::string& text, HLSAttributes& attributes)
+{
+    size_t i = 0, equal;
+    std::string value;
+
+    attributes.clear();
+    while (i < text.size()) {
+        while (i < text.size() && (text[i] == ' ' || text[i] == ','))
+            i++;
+        equal = text.find('=', i);
+        if (equal == std::string::npos)
+            break;
+        std::string key = text.substr(i, equal - i);
+        i = equal + 1;
+        value.clear();
+        if (i < text.size() && text[i] == '"') {
+            size_t quote = text.find('"', i + 1);
+            if (quote == std::string::npos)
+                quote = text.size();
+            value = text.substr(i + 1, quote - i - 1);
+            i = quote + 1;
+        } else {
+            size_t comma = text.find(',', i);
+            if (comma == std::string::npos)
+                comma = text.size();
+            value = text.substr(i, comma - i);
+            i = comma;
+        }
+        attributes.push_back(std::make_pair(key, value));
+    }
+}
+
+static const std::string* HLSFindAttribute(const HLSAttributes& attributes, const char* key)
+{
+    for (size_t i = 0; i < attributes.size(); i++) {
+        if (attributes[i].first == key)
+            return &attributes[i].second;
+    }
+    return NULL;
+}
+
+/* 秒，可以有小数 */
+static int64_t HLSParseSeconds(const char* text)
+{
+    return (int64_t)(strtod(text, NULL) * 1000000 + 0.5);
+}
+
+/* n[@o]，没有 o 时接着同一个文件的上一段 */
+static void HLSParseRange(const char* text, int64_t previousEnd, int64_t* offset, int64_t* length)
+{
+    const char* at = strchr(text, '@');
+
+    *length = strtoll(text, NULL, 10);
+    *offset = at ? strtoll(at + 1, NULL, 10) : previousEnd;
+}
+
+static bool HLSCompareVariant(const HLSVariant& a, const HLSVariant& b)
+{
+    return a.bandwidth < b.bandwidth;
+}
+
+
+HLSPlaylist::HLSPlaylist()
+{
+    clear();
+}
+
+void HLSPlaylist::clear()
+{
+    m_url.clear();
+    m_variants.clear();
+    m_segments.clear();
+    m_maps.clear();
+    m_targetDurationUs = 0;
+    m_mediaSequence = 0;
+    m_durationUs = 0;
+    m_ended = false;
+}
+
+int HLSPlaylist::parse(const char* text, int size, const char* url)
+{
+    const char* end = text + size;
+    const char* next;
+    std::string line;
+    HLSAttributes attributes;
+    HLSVariant variant;
+    HLSSegment segment;
+    bool streamInf = false, first = true;
+    int64_t rangeEnd = 0;
+
+    clear();
+    m_url = url;
+    segment.durationUs = 0;
+    segment.rangeOffset = 0;
+    segment.rangeLength = -1;
+    segment.discontinuity = false;
+
+    if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+        text += 3;
+    for (; text < end; text = next) {
+        next = (const char*)memchr(text, '\n', end - text);
+        next = next ? next + 1 : end;
+        line.assign(text, next - text);
+        while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r'
+                    || line[line.size() - 1] == ' ' || line[line.size() - 1] == '\t'))
+            line.erase(line.size() - 1);
+        if (line.empty())
+            continue;
+        if (first) {
+            if (!HLSStartsWith(line, "#EXTM3U")) {
+                playerLogError("hls: [%s] is not a m3u8 playlist.\n", url);
+                return -1;
+            }
+            first = false;
+            continue;
+        }
+
+        if (line[0] != '#') {
+            if (streamInf) {
+                variant.url = HLSResolveUrl(m_url, line);
+                m_variants.push_back(variant);
+                streamInf = false;
+                continue;
+            }
+            segment.url = HLSResolveUrl(m_url, line);
+            segment.sequence = m_mediaSequence + m_segments.size();
+            segment.startUs = m_durationUs;
+            segment.mapIndex = (int)m_maps.size() - 1;
+            m_segments.push_back(segment);
+            m_durationUs += segment.durationUs;
+            rangeEnd = (segment.rangeLength >= 0) ? segment.rangeOffset + segment.rangeLength : 0;
+            segment.durationUs = 0;
+            segment.rangeOffset = 0;
+            segment.rangeLength = -1;
+            segment.discontinuity = false;
+        } else if (HLSStartsWith(line, "#EXT-X-STREAM-INF:")) {
+            const std::string* value;
+            HLSParseAttributes(line.substr(18), attributes);
+            variant.bandwidth = (value = HLSFindAttribute(attributes, "BANDWIDTH")) ? strtoll(value->c_str(), NULL, 10) : 0;
+            variant.averageBandwidth = (value = HLSFindAttribute(attributes, "AVERAGE-BANDWIDTH")) ? strtoll(value->c_str(), NULL, 10) : 0;
+            variant.width = variant.height = 0;
+            if ((value = HLSFindAttribute(attributes, "RESOLUTION")) != NULL)
+                sscanf(value->c_str(), "%dx%d", &variant.width, &variant.height);
+            variant.codecs = (value = HLSFindAttribute(attributes, "CODECS")) ? *value : std::string();
+            streamInf = true;
+        } else if (HLSStartsWith(line, "#EXTINF:")) {
+            segment.durationUs = HLSParseSeconds(line.c_str() + 8);
+        } else if (HLSStartsWith(line, "#EXT-X-BYTERANGE:")) {
+            //没有 @o 时接着上一个分片，要求是同一个文件
+            HLSParseRange(line.c_str() + 17, rangeEnd, &segment.rangeOffset, &segment.rangeLength);
+        } else if (HLSStartsWith(line, "#EXT-X-TARGETDURATION:")) {
+            m_targetDurationUs = HLSParseSeconds(line.c_str() + 22);
+        } else if (HLSStartsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            m_mediaSequence = strtoll(line.c_str() + 22, NULL, 10);
+        } else if (HLSStartsWith(line, "#EXT-X-DISCONTINUITY")
+                && !HLSStartsWith(line, "#EXT-X-DISCONTINUITY-SEQUENCE")) {
+            segment.discontinuity = true;
+        } else if (HLSStartsWith(line, "#EXT-X-ENDLIST")) {
+            m_ended = true;
+        } else if (HLSStartsWith(line, "#EXT-X-PLAYLIST-TYPE:")) {
+            if (line.compare(21, std::string::npos, "VOD") == 0)
+                m_ended = true;
+        } else if (HLSStartsWith(line, "#EXT-X-MAP:")) {
+            const std::string* value;
+            HLSMap map;
+            HLSParseAttributes(line.substr(11), attributes);
+            if ((value = HLSFindAttribute(attributes, "URI")) == NULL)
+                continue;
+            map.url = HLSResolveUrl(m_url, *value);
+            map.rangeOffset = 0;
+            map.rangeLength = -1;
+            if ((value = HLSFindAttribute(attributes, "BYTERANGE")) != NULL)
+                HLSParseRange(value->c_str(), 0, &map.rangeOffset, &map.rangeLength);
+            m_maps.push_back(map);
+        } else if (HLSStartsWith(line, "#EXT-X-KEY:")) {
+            const std::string* method;
+            HLSParseAttributes(line.substr(11), attributes);
+            method = HLSFindAttribute(attributes, "METHOD");
+            if (method && *method != "NONE") {
+                playerLogError("hls: [%s] encryption [%s] not supported.\n", url, method->c_str());
+                return -1;
+            }
+        }
+    }
+    if (first) {
+        playerLogError("hls: [%s] is empty.\n", url);
+        return -1;
+    }
+    std::stable_sort(m_variants.begin(), m_variants.end(), HLSCompareVariant);
+    return 0;
+}
+
+const HLSVariant* HLSPlaylist::getVariant(int index)
+{
+    if (index < 0 || index >= (int)m_variants.size())
+        return NULL;
+    return &m_variants[index];
+}
+
+const HLSSegment* HLSPlaylist::getSegment(int index)
+{
+    if (index < 0 || index >= (int)m_segments.size())
+        return NULL;
+    return &m_segments[index];
+}
+
+const HLSMap* HLSPlaylist::getMap(int index)
+{
+    if (index < 0 || index >= (int)m_maps.size())
+        return NULL;
+    return &m_maps[index];
+}
+
+int HLSPlaylist::findSequence(int64_t sequence)
+{
+    if (m_segments.empty() || sequence < m_segments.front().sequence || sequence > m_segments.back().sequence)
+        return -1;
+    return (int)(sequence - m_segments.front().sequence);
+}
+
+int HLSPlaylist::findTime(int64_t timeUs)
+{
+    int low = 0, high = (int)m_segments.size() - 1, found = 0;
+
+    if (m_segments.empty())
+        return -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (m_segments[middle].startUs <= timeUs) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+
+std::string HLSResolveUrl(const std::string& base, const std::string& reference)
+{
+    std::string path, result, segment;
+    size_t scheme, authority, query, slash, i;
+    std::vector<std::string> segments;
+
+    if (reference.find("://") != std::string::npos)
+        return reference;
+    scheme = base.find("://");
+    if (scheme == std::string::npos)
+        return reference;
+    if (reference.compare(0, 2, "//") == 0)
+        return base.substr(0, scheme + 1) + reference;
+    authority = base.find('/', scheme + 3);
+    if (authority == std::string::npos)
+        authority = base.size();
+
+    if (!reference.empty() && reference[0] == '/') {
+        path = reference;
+    } else {
+        query = base.find_first_of("?#", authority);
+        path = base.substr(authority, (query == std::string::npos ? base.size() : query) - authority);
+        slash = path.rfind('/');
+        path = (slash == std::string::npos) ? std::string("/") : path.substr(0, slash + 1);
+        path += reference;
+    }
+
+    //去掉 . 和 ..，查询参数中的 / 不处理
+    query = path.find_first_of("?#");
+    std::string tail = (query == std::string::npos) ? std::string() : path.substr(query);
+    if (query != std::string::npos)
+        path.erase(query);
+    for (i = 1; i <= path.size(); i++) {
+        if (i < path.size() && path[i] != '/') {
+            segment += path[i];
+            continue;
+        }
+        if (segment == "..") {
+            if (!segments.empty())
+                segments.pop_back();
+        } else if (segment != ".") {
+            segments.push_back(segment);
+        }
+        //最后一段为 . 或 .. 时保留目录结尾的 /
+        if (i == path.size() && (segment == "." || segment == ".."))
+            segments.push_back(std::string());
+        segment.clear();
+    }
+    result = base.substr(0, authority);
+    for (i = 0; i < segments.size(); i++)
+        result += "/" + segments[i];
+    if (segments.empty())
+        result += "/";
+    return result + tail;
+}
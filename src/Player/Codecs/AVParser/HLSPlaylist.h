@@ -0,0 +1,94 @@
+#ifndef __HLS_PLAYLIST_H__
+#define __HLS_PLAYLIST_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define     HLS_PLAYLIST_SIZE_MAX       (4 * 1024 * 1024)   //m3u8 文件的上限
+
+
+typedef struct _HLSVariant {
+    int64_t         bandwidth;          //EXT-X-STREAM-INF 的 BANDWIDTH，bit/s
+    int64_t         averageBandwidth;   //AVERAGE-BANDWIDTH，没有时为 0
+    int             width;              //RESOLUTION，没有时为 0
+    int             height;
+    std::string     codecs;
+    std::string     url;                //已经按 master 的地址解析为绝对地址
+} HLSVariant;
+
+typedef struct _HLSMap {
+    std::string     url;
+    int64_t         rangeOffset;
+    int64_t         rangeLength;        //-1 为整个文件
+} HLSMap;
+
+typedef struct _HLSSegment {
+    std::string     url;
+    int64_t         sequence;           //EXT-X-MEDIA-SEQUENCE 开始递增
+    int64_t         startUs;            //在本播放列表中的开始时间，直播时从窗口开头算起
+    int64_t         durationUs;
+    int64_t         rangeOffset;        //EXT-X-BYTERANGE
+    int64_t         rangeLength;        //-1 为整个文件
+    int             mapIndex;           //EXT-X-MAP 的初始化段，-1 为没有(TS)
+    bool            discontinuity;
+} HLSSegment;
+
+
+class HLSPlaylist { /* m3u8 解析：master 列表得到各码率的 variant，media 列表得到分片，不下载数据 */
+    public:
+        HLSPlaylist();
+
+        /**
+         *  @Func: parse
+         *         ps. :相对地址按 url 解析；variant 按带宽从低到高排列；加密(EXT-X-KEY 不为 NONE)的列表不支持
+         *  @Param: text, type:: const char*, 不要求以 0 结尾
+         *  @Param: size, type:: int
+         *  @Param: url, type:: const char*, 列表自己的地址(重定向之后)
+         *  @Return: int, 0 成功，不是 m3u8 或者不支持返回 -1
+         *
+         **/
+        int parse(const char* text, int size, const char* url);
+        void clear();
+
+        bool isMaster() { return !m_variants.empty(); }
+        bool isEnded() { return m_ended; }          //EXT-X-ENDLIST 或者 PLAYLIST-TYPE:VOD
+        const std::string& getUrl() { return m_url; }
+        int64_t getTargetDurationUs() { return m_targetDurationUs; }
+        int64_t getDurationUs() { return m_durationUs; }
+
+        int getVariantCount() { return m_variants.size(); }
+        const HLSVariant* getVariant(int index);
+        int getSegmentCount() { return m_segments.size(); }
+        const HLSSegment* getSegment(int index);
+        const HLSMap* getMap(int index);
+        int64_t getFirstSequence() { return m_segments.empty() ? m_mediaSequence : m_segments.front().sequence; }
+
+        int findSequence(int64_t sequence);     //分片的下标，不在列表中返回 -1
+        int findTime(int64_t timeUs);           //包含 timeUs 的分片，超过结尾时为最后一个，空列表返回 -1
+
+    private:
+        std::string                 m_url;
+        std::vector<HLSVariant>     m_variants;
+        std::vector<HLSSegment>     m_segments;
+        std::vector<HLSMap>         m_maps;
+        int64_t                     m_targetDurationUs;
+        int64_t                     m_mediaSequence;
+        int64_t                     m_durationUs;
+        bool                        m_ended;
+};
+
+
+/* 按 RFC 3986 把 reference 解析为相对于 base 的绝对地址，去掉 . 和 .. */
+std::string HLSResolveUrl(const std::string& base, const std::string& reference);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__HLS_PLAYLIST_H__
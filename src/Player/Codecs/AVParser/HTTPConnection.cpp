@@ -0,0 +1,396 @@
+/**
+ *  HTTPConnection.cpp文件
+ *  HTTP/1.1 客户端，供 HLS 下载播放列表和分片；
+ *  主要有以下部分：
+ *      1. 连接：非阻塞 connect + poll 超时，TCP_NODELAY；同一个服务器的请求复用连接，省去每个分片的握手
+ *      2. 请求：GET，需要时带 Range；复用的连接被服务器关闭时重新连接后重发一次
+ *      3. 响应：状态行和头部按行解析，body 按 Content-Length、chunked 或者读到连接关闭
+ *      4. 重定向：301/302/303/307/308 按 Location 重新请求，记录最终地址
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "HLSPlaylist.h"
+#include "HTTPConnection.h"
+
+
+#define     HTTP_RECEIVE_SIZE           (64 * 1024)
+
+
+int HTTPParseUrl(const std::string& url, std::string* host, int* port, std::string* path)
+{
+    size_t start, slash, colon;
+
+    if (url.compare(0, 7, "http://") != 0) {
+        if (url.compare(0, 8, "https://") == 0)
+            playerLogError("http: https not supported [%s].\n", url.c_str());
+        return -1;
+    }
+    start = 7;
+    slash = url.find_first_of("/?#", start);
+    if (slash == std::string::npos)
+        slash = url.size();
+    *host = url.substr(start, slash - start);
+    *port = 80;
+    colon = host->rfind(':');
+    if (colon != std::string::npos && host->find(']') == std::string::npos) {
+        *port = atoi(host->c_str() + colon + 1);
+        host->erase(colon);
+    }
+    if (host->empty() || *port <= 0 || *port > 65535)
+        return -1;
+    *path = (slash < url.size() && url[slash] == '/') ? url.substr(slash) : "/" + url.substr(slash);
+    path->erase(std::min(path->find('#'), path->size()));
+    return 0;
+}
+
+static bool HTTPCancelled(volatile bool* cancel)
+{
+    return cancel && *cancel;
+}
+
+/* 等待 socket 可读或可写，每 HTTP_POLL_MS 检查一次取消；返回 1 就绪，0 超时，-1 出错或取消 */
+static int HTTPWait(int socket, short events, volatile bool* cancel)
+{
+    struct pollfd fd;
+    int waited = 0, ret;
+
+    fd.fd = socket;
+    fd.events = events;
+    while (waited < HTTP_TIMEOUT_MS) {
+        if (HTTPCancelled(cancel))
+            return -1;
+        ret = poll(&fd, 1, HTTP_POLL_MS);
+        if (ret > 0)
+            return 1;
+        if (ret < 0 && errno != EINTR)
+            return -1;
+        waited += HTTP_POLL_MS;
+    }
+    return 0;
+}
+
+
+HTTPConnection::HTTPConnection()
+    : m_socket(-1)
+    , m_port(0)
+    , m_bufferStart(0)
+{
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+HTTPConnection::~HTTPConnection()
+{
+    close();
+}
+
+void HTTPConnection::close()
+{
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    m_buffer.clear();
+    m_bufferStart = 0;
+}
+
+int HTTPConnection::connect(const std::string& host, int port, volatile bool* cancel)
+{
+    struct addrinfo hints, *result, *address;
+    char service[16];
+    int error, on = 1;
+    socklen_t length = sizeof(error);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host.c_str(), service, &hints, &result) != 0) {
+        playerLogError("http: resolve [%s] failed.\n", host.c_str());
+        return -1;
+    }
+
+    for (address = result; address; address = address->ai_next) {
+        m_socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (m_socket < 0)
+            continue;
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK);
+        setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (::connect(m_socket, address->ai_addr, address->ai_addrlen) == 0
+                || (errno == EINPROGRESS && HTTPWait(m_socket, POLLOUT, cancel) > 0
+                    && getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0))
+            break;
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    freeaddrinfo(result);
+    if (m_socket < 0) {
+        if (!HTTPCancelled(cancel))
+            playerLogError("http: connect [%s:%d] failed.\n", host.c_str(), port);
+        return -1;
+    }
+    m_host = host;
+    m_port = port;
+    m_buffer.clear();
+    m_bufferStart = 0;
+    m_statistics.connects++;
+    return 0;
+}
+
+int HTTPConnection::sendAll(const char* data, int size, volatile bool* cancel)
+{
+    int sent;
+
+    while (size > 0) {
+        sent = send(m_socket, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return -1;
+            if (HTTPWait(m_socket, POLLOUT, cancel) <= 0)
+                return -1;
+            continue;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return 0;
+}
+
+/* 接收一块数据放到 m_buffer 之后，返回收到的字节数，连接关闭返回 0，出错、超时或取消返回 -1 */
+int HTTPConnection::fill(volatile bool* cancel)
+{
+    size_t used;
+    int size;
+
+    if (m_bufferStart > 0 && m_bufferStart * 2 >= m_buffer.size()) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_bufferStart);
+        m_bufferStart = 0;
+    }
+    for (;;) {
+        used = m_buffer.size();
+        m_buffer.resize(used + HTTP_RECEIVE_SIZE);
+        size = recv(m_socket, &m_buffer[used], HTTP_RECEIVE_SIZE, 0);
+        m_buffer.resize(used + std::max(size, 0));
+        if (size >= 0)
+            return size;
+        if (errno == EINTR)
+            continue;
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || HTTPWait(m_socket, POLLIN, cancel) <= 0)
+            return -1;
+    }
+}
+
+int HTTPConnection::readLine(std::string& line, volatile bool* cancel)
+{
+    size_t searched = m_bufferStart;
+    uint8_t* newline;
+
+    for (;;) {
+        newline = (m_buffer.size() > searched) ? (uint8_t*)memchr(&m_buffer[searched], '\n', m_buffer.size() - searched) : NULL;
+        if (newline) {
+            size_t end = newline - &m_buffer[0];
+            line.assign((const char*)&m_buffer[m_bufferStart], end - m_bufferStart);
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+            m_bufferStart = end + 1;
+            return 0;
+        }
+        if (m_buffer.size() - m_bufferStart > HTTP_HEADER_SIZE_MAX)
+            return -1;
+        searched = m_buffer.size() - m_bufferStart;
+        if (fill(cancel) <= 0)
+            return -1;
+        searched += m_bufferStart;
+    }
+}
+
+/* length 为 -1 时读到连接关闭 */
+int HTTPConnection::readBody(int64_t length, std::vector<uint8_t>& body, volatile bool* cancel)
+{
+    size_t available;
+    int size;
+
+    for (;;) {
+        available = m_buffer.size() - m_bufferStart;
+        if (length >= 0 && (int64_t)available > length)
+            available = (size_t)length;
+        body.insert(body.end(), m_buffer.begin() + m_bufferStart, m_buffer.begin() + m_bufferStart + available);
+        m_bufferStart += available;
+        m_statistics.bytes += available;
+        if (length >= 0) {
+            length -= available;
+            if (length == 0)
+                return 0;
+        }
+        if (m_bufferStart == m_buffer.size()) {
+            m_buffer.clear();
+            m_bufferStart = 0;
+        }
+        size = fill(cancel);
+        if (size < 0 || (size == 0 && length >= 0))
+            return -1;
+        if (size == 0)
+            return 0;
+    }
+}
+
+int HTTPConnection::request(const std::string& url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& body,
+                            std::string& location, volatile bool* cancel)
+{
+    std::string host, path, line, message;
+    char range[64];
+    int port, status = -1, attempt;
+    int64_t contentLength = -1;
+    bool chunked = false, keepAlive = true, reused = false;
+
+    if (HTTPParseUrl(url, &host, &port, &path) < 0) {
+        playerLogError("http: invalid url [%s].\n", url.c_str());
+        return -1;
+    }
+    if (m_socket >= 0 && (host != m_host || port != m_port))
+        close();
+
+    message = "GET " + path + " HTTP/1.1\r\nHost: " + host;
+    if (port != 80) {
+        snprintf(range, sizeof(range), ":%d", port);
+        message += range;
+    }
+    message += "\r\nUser-Agent: CPlayer\r\nAccept: */*\r\nConnection: keep-alive\r\n";
+    if (rangeOffset > 0 || rangeLength >= 0) {
+        if (rangeLength >= 0)
+            snprintf(range, sizeof(range), "Range: bytes=%lld-%lld\r\n", (long long)rangeOffset, (long long)(rangeOffset + rangeLength - 1));
+        else
+            snprintf(range, sizeof(range), "Range: bytes=%lld-\r\n", (long long)rangeOffset);
+        message += range;
+    }
+    message += "\r\n";
+
+    //复用的连接可能已经被服务器因空闲关闭，发送成功也要等到读状态行才知道
+    for (attempt = 0; attempt < 2; attempt++) {
+        reused = (m_socket >= 0);
+        if (!reused && connect(host, port, cancel) < 0)
+            return -1;
+        if (sendAll(message.data(), message.size(), cancel) == 0 && readLine(line, cancel) == 0)
+            break;
+        close();
+        if (!reused || HTTPCancelled(cancel))
+            return -1;
+        m_statistics.retries++;
+    }
+    if (attempt == 2)
+        return -1;
+    m_statistics.requests++;
+    if (reused)
+        m_statistics.reuses++;
+
+    if (line.compare(0, 5, "HTTP/") != 0 || sscanf(line.c_str(), "%*s %d", &status) != 1) {
+        playerLogError("http: invalid status line [%s].\n", line.c_str());
+        close();
+        return -1;
+    }
+    if (line.compare(0, 8, "HTTP/1.0") == 0)
+        keepAlive = false;
+    for (;;) {
+        size_t colon;
+        const char* value;
+        if (readLine(line, cancel) < 0) {
+            close();
+            return -1;
+        }
+        if (line.empty())
+            break;
+        colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        value = line.c_str() + colon + 1;
+        while (*value == ' ' || *value == '\t')
+            value++;
+        line.erase(colon);
+        if (strcasecmp(line.c_str(), "Content-Length") == 0)
+            contentLength = strtoll(value, NULL, 10);
+        else if (strcasecmp(line.c_str(), "Transfer-Encoding") == 0)
+            chunked = (strcasestr(value, "chunked") != NULL);
+        else if (strcasecmp(line.c_str(), "Connection") == 0)
+            keepAlive = (strcasestr(value, "close") == NULL) && (keepAlive || strcasestr(value, "keep-alive") != NULL);
+        else if (strcasecmp(line.c_str(), "Location") == 0)
+            location = value;
+    }
+
+    //错误和重定向的 body 也要读完，连接才能继续使用
+    body.clear();
+    if (status == 204 || status == 304 || (status >= 100 && status < 200)) {
+        //没有 body
+    } else if (chunked) {
+        for (;;) {
+            int64_t size;
+            if (readLine(line, cancel) < 0) {
+                close();
+                return -1;
+            }
+            size = strtoll(line.c_str(), NULL, 16);
+            if (size <= 0)
+                break;
+            if (readBody(size, body, cancel) < 0 || readLine(line, cancel) < 0) {
+                close();
+                return -1;
+            }
+        }
+        do {
+            if (readLine(line, cancel) < 0) {
+                close();
+                return -1;
+            }
+        } while (!line.empty());
+    } else if (contentLength >= 0) {
+        if (readBody(contentLength, body, cancel) < 0) {
+            close();
+            return -1;
+        }
+    } else {
+        if (readBody(-1, body, cancel) < 0) {
+            close();
+            return -1;
+        }
+        keepAlive = false;
+    }
+    if (!keepAlive)
+        close();
+    return status;
+}
+
+int HTTPConnection::get(const char* url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& body, volatile bool* cancel)
+{
+    std::string location;
+    int status = -1, redirects;
+
+    m_effectiveUrl = url;
+    for (redirects = 0; redirects <= HTTP_REDIRECT_MAX; redirects++) {
+        location.clear();
+        status = request(m_effectiveUrl, rangeOffset, rangeLength, body, location, cancel);
+        if (status != 301 && status != 302 && status != 303 && status != 307 && status != 308)
+            return status;
+        if (location.empty())
+            return status;
+        m_effectiveUrl = HLSResolveUrl(m_effectiveUrl, location);
+    }
+    playerLogError("http: too many redirects [%s].\n", url);
+    body.clear();
+    return -1;
+}
@@ -0,0 +1,79 @@
+#ifndef __HTTP_CONNECTION_H__
+#define __HTTP_CONNECTION_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define     HTTP_TIMEOUT_MS             10000       //连接和每次接收的超时
+#define     HTTP_POLL_MS                100         //等待数据时检查取消的间隔
+#define     HTTP_REDIRECT_MAX           5
+#define     HTTP_HEADER_SIZE_MAX        (16 * 1024)
+
+
+typedef struct _HTTPStatistics {
+    int64_t         connects;           //新建的 TCP 连接
+    int64_t         requests;
+    int64_t         reuses;             //在已有连接上发出的请求
+    int64_t         retries;            //复用的连接已经被服务器关闭，重新连接后重发
+    int64_t         bytes;              //收到的 body 字节数
+} HTTPStatistics;
+
+
+class HTTPConnection { /* HTTP/1.1 GET：同一个服务器的请求复用一个 keep-alive 连接，支持 Range、chunked 和重定向；不支持 https */
+    public:
+        HTTPConnection();
+        ~HTTPConnection();
+
+        /**
+         *  @Func: get
+         *         ps. :body 先清空；服务器不同时关闭旧连接重新连接；复用的连接在发出请求后立即断开时重连一次
+         *  @Param: url, type:: const char*, http://host[:port]/path
+         *  @Param: rangeOffset, type:: int64_t
+         *  @Param: rangeLength, type:: int64_t, -1 时不发送 Range(rangeOffset 为 0) 或者读到结尾
+         *  @Param: body, type:: std::vector<uint8_t>&
+         *  @Param: cancel, type:: volatile bool*, 为 true 时尽快返回 -1，可以为 NULL
+         *  @Return: int, HTTP 状态码，网络错误或取消返回 -1
+         *
+         **/
+        int get(const char* url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& body, volatile bool* cancel);
+        void close();
+
+        const std::string& getEffectiveUrl() { return m_effectiveUrl; }     //重定向之后的地址，解析相对地址时使用
+        const HTTPStatistics& getStatistics() { return m_statistics; }
+
+    private:
+        HTTPConnection(const HTTPConnection&);
+        HTTPConnection& operator=(const HTTPConnection&);
+
+        int connect(const std::string& host, int port, volatile bool* cancel);
+        int request(const std::string& url, int64_t rangeOffset, int64_t rangeLength, std::vector<uint8_t>& body,
+                    std::string& location, volatile bool* cancel);
+        int sendAll(const char* data, int size, volatile bool* cancel);
+        int fill(volatile bool* cancel);
+        int readLine(std::string& line, volatile bool* cancel);
+        int readBody(int64_t length, std::vector<uint8_t>& body, volatile bool* cancel);
+
+        int                     m_socket;
+        std::string             m_host;             //m_socket 连接的服务器
+        int                     m_port;
+        std::string             m_effectiveUrl;
+        std::vector<uint8_t>    m_buffer;           //已经收到还没有解析的数据
+        size_t                  m_bufferStart;
+        HTTPStatistics          m_statistics;
+};
+
+
+/* http://host[:port]/path，返回 0 成功 */
+int HTTPParseUrl(const std::string& url, std::string* host, int* port, std::string* path);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__HTTP_CONNECTION_H__
@@ -0,0 +1,154 @@
+/**
+ *  MP3Decoder.cpp文件
+ *  libmad 解码，输入为 MP3Parser 输出的帧；
+ *  主要有以下部分：
+ *          帧缓存：上一帧和新的一帧连续存放，libmad 从新的一帧读取 main_data_begin
+ *          定点数转换为 16 位交织 PCM
+ *          LAME 无缝播放：去掉 encoder delay 和 padding
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "mad.h"
+
+#include "LogPlayer.h"
+#include "MP3Decoder.h"
+
+
+struct MP3Decoder::MadState {
+    struct mad_stream   stream;
+    struct mad_frame    frame;
+    struct mad_synth    synth;
+};
+
+
+static inline int16_t MP3DecoderScale(mad_fixed_t sample)
+{
+    sample += (1L << (MAD_F_FRACBITS - 16));
+    if (sample >= MAD_F_ONE)
+        sample = MAD_F_ONE - 1;
+    else if (sample < -MAD_F_ONE)
+        sample = -MAD_F_ONE;
+    return (int16_t)(sample >> (MAD_F_FRACBITS + 1 - 16));
+}
+
+
+MP3Decoder::MP3Decoder()
+{
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    memset(&m_pending, 0, sizeof(m_pending));
+    m_skipSamples = 0;
+    m_totalSamples = 0;
+    m_mad = new MadState;
+    mad_stream_init(&m_mad->stream);
+    mad_frame_init(&m_mad->frame);
+    mad_synth_init(&m_mad->synth);
+}
+
+MP3Decoder::~MP3Decoder()
+{
+    mad_synth_finish(&m_mad->synth);
+    mad_frame_finish(&m_mad->frame);
+    mad_stream_finish(&m_mad->stream);
+    delete m_mad;
+}
+
+void MP3Decoder::setCallbacks(const MP3DecoderCallbacks& callbacks)
+{
+    m_callbacks = callbacks;
+}
+
+void MP3Decoder::setGapless(int skipSamples, int64_t totalSamples)
+{
+    m_skipSamples = skipSamples;
+    m_totalSamples = totalSamples;
+}
+
+void MP3Decoder::reset()
+{
+    mad_synth_finish(&m_mad->synth);
+    mad_frame_finish(&m_mad->frame);
+    mad_stream_finish(&m_mad->stream);
+    mad_stream_init(&m_mad->stream);
+    mad_frame_init(&m_mad->frame);
+    mad_synth_init(&m_mad->synth);
+    memset(&m_pending, 0, sizeof(m_pending));
+    m_buffer.clear();
+}
+
+int MP3Decoder::decode(const MP3Frame* frame)
+{
+    int result = 0;
+
+    if (frame == NULL || frame->size <= 0)
+        return -1;
+
+    m_buffer.resize(m_pending.size + frame->size + MAD_BUFFER_GUARD);
+    memcpy(&m_buffer[m_pending.size], frame->data, frame->size);
+    memset(&m_buffer[m_pending.size + frame->size], 0, MAD_BUFFER_GUARD);
+    if (m_pending.size > 0) {
+        result = decodePending(m_pending.size + frame->size);
+        memmove(&m_buffer[0], &m_buffer[m_pending.size], frame->size);
+    }
+    m_pending.size = frame->size;
+    m_pending.frameNumber = frame->frameNumber;
+    m_pending.ptsUs = frame->ptsUs;
+    return result;
+}
+
+int MP3Decoder::flush()
+{
+    int result = 0;
+
+    if (m_pending.size > 0) {
+        memset(&m_buffer[m_pending.size], 0, MAD_BUFFER_GUARD);
+        result = decodePending(m_pending.size);
+        m_pending.size = 0;
+    }
+    return result;
+}
+
+int MP3Decoder::decodePending(int available)
+{
+    struct mad_pcm* pcm = &m_mad->synth.pcm;
+    int64_t position, end;
+    int start, count, channels, i, c;
+
+    mad_stream_buffer(&m_mad->stream, &m_buffer[0], available + MAD_BUFFER_GUARD);
+    if (mad_frame_decode(&m_mad->frame, &m_mad->stream) < 0) {
+        //seek 之后的前几帧 bit reservoir 不完整 (MAD_ERROR_BADDATAPTR)，丢弃即可
+        if (!MAD_RECOVERABLE(m_mad->stream.error))
+            playerLogWarning("mp3 decode error [%s].\n", mad_stream_errorstr(&m_mad->stream));
+        return MAD_RECOVERABLE(m_mad->stream.error) ? 0 : -1;
+    }
+    mad_synth_frame(&m_mad->synth, &m_mad->frame);
+
+    //按帧序号截掉 encoder delay 和 padding
+    start = 0;
+    count = pcm->length;
+    if (m_pending.frameNumber >= 0 && (m_skipSamples > 0 || m_totalSamples > 0)) {
+        position = m_pending.frameNumber * pcm->length;
+        if (position < m_skipSamples)
+            start = (int)std::min<int64_t>(m_skipSamples - position, count);
+        end = m_skipSamples + m_totalSamples;
+        if (m_totalSamples > 0 && position + count > end)
+            count = (int)std::max<int64_t>(end - position, start);
+    }
+    if (count <= start)
+        return 0;
+
+    channels = pcm->channels;
+    m_pcm.resize((count - start) * channels);
+    for (i = start; i < count; i++) {
+        for (c = 0; c < channels; c++)
+            m_pcm[(i - start) * channels + c] = MP3DecoderScale(pcm->samples[c][i]);
+    }
+    if (m_callbacks.onPcm)
+        m_callbacks.onPcm(&m_pcm[0], count - start, channels, pcm->samplerate,
+                        m_pending.ptsUs + (int64_t)start * 1000000 / pcm->samplerate, m_callbacks.userData);
+    return count - start;
+}
@@ -0,0 +1,74 @@
+#ifndef __MP3_DECODER_H__
+#define __MP3_DECODER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+#include "MP3Parser.h"
+
+
+#define     MP3_DECODER_DELAY           529         //libmad 等解码器的固有延迟，和 LAME encoder delay 一起去掉
+
+
+typedef struct _MP3DecoderCallbacks {
+    void (*onPcm)(const int16_t* pcm, int samples, int channels, int sampleRate, int64_t ptsUs, void* userData);   //交织，samples 为每个声道的采样数
+    void*   userData;
+} MP3DecoderCallbacks;
+
+
+class MP3Decoder { /* 用 libmad 解码 MP3Parser 输出的帧 */
+    public:
+        MP3Decoder();
+        ~MP3Decoder();
+
+        void setCallbacks(const MP3DecoderCallbacks& callbacks);
+
+        /**
+         *  @Func: setGapless
+         *         ps. :按 MP3Frame.frameNumber 去掉开头和结尾的采样，seek 到估计位置(frameNumber 为 -1)时不处理
+         *  @Param: skipSamples, type:: int, 一般为 encoderDelay + MP3_DECODER_DELAY
+         *  @Param: totalSamples, type:: int64_t, 有效采样数，frames * samplesPerFrame - encoderDelay - encoderPadding，0 为不截断
+         *  @Return: void
+         *
+         **/
+        void setGapless(int skipSamples, int64_t totalSamples);
+
+        /**
+         *  @Func: decode
+         *         ps. :libmad 需要下一帧的 main_data_begin 才能确定 bit reservoir，所以输入一帧时解码的是上一帧
+         *  @Param: frame, type:: const MP3Frame*
+         *  @Return: int, 输出的采样数，解码出错返回 -1，不影响之后的帧
+         *
+         **/
+        int decode(const MP3Frame* frame);
+        int flush();                        //文件结束，解码最后一帧
+        void reset();                       //seek 之后调用，清除 bit reservoir
+
+    private:
+        struct MadState;
+        struct PendingFrame {
+            int             size;
+            int64_t         frameNumber;
+            int64_t         ptsUs;
+        };
+
+        int decodePending(int available);
+
+        MP3DecoderCallbacks         m_callbacks;
+        MadState*                   m_mad;
+        std::vector<uint8_t>        m_buffer;           //上一帧 + 新的一帧 + MAD_BUFFER_GUARD
+        PendingFrame                m_pending;          //m_buffer 开头等待解码的帧，size 为 0 表示没有
+        std::vector<int16_t>        m_pcm;
+        int                         m_skipSamples;
+        int64_t                     m_totalSamples;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__MP3_DECODER_H__
@@ -1,116 +1,526 @@
-//ȡMp3ļͷβϢ
-//MP3ļͷ10Byte,ҪID3,ID3汾͸汾Ϣ,ԼFlag֡Ϣ
-//β128ֽڱHeader(βͷ,3Byte),Title(,30Byte),Artilst(,30Byte),Album(ר,30Byte),Year(,4Byte),Comment(,30Byte),Cenre(?,1Byte)
-//3+30+30+30+4+30+1=128
+/**
+ *  MP3Parser.cpp文件
+ *  流式 MPEG audio (MP3/MP2/MP1) 帧解析，输出的帧直接交给 MP3Decoder (libmad)；
+ *  主要有以下部分：
+ *          帧头解析，同步：第一次要求下一帧的帧头一致，之后版本/层/采样率不变
+ *          ID3v2 跳过，文件末尾的 ID3v1/APEv2
+ *          Xing/Info/VBRI 头和 LAME 标签(encoder delay/padding)，时长和平均码率
+ *          seek：已解析部分的采样 seek 表，Xing TOC，VBRI 表，CBR 计算
+ *
+ *  完整落在本次输入中的帧直接在调用者的缓冲区上输出，只有跨越两次 parse() 的帧才拷贝到 m_pending。
+ *
+ **/
 
 #include <stdio.h>
-#include <iostream>
-#include <assert.h>
 #include <string.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
 #include "MP3Parser.h"
 
-FILE *fp;
 
-//Tag_header_Start
-struct Tag_header{
- char Header[3]; //it must be ID3
- char ver;            //the version of ID3
- char ReVer;      //the subversion of ID3
- char Flag;
- char Size[4];
-};
-//Tag_header_End
-
-//Tag_Trailer_Start
-struct Tag_Trailer{
- char Header[3];
- char Title[30];
- char Artist[30];
- char Album[30];
- char Year[4];
- char Comment[30];
- char Cenre[1];
+/* kbps，[MPEG1/MPEG2][layer - 1][index] */
+static const int s_MP3Bitrates[2][3][15] = {
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320 }
+    },
+    {
+        { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 },
+        { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 }
+    }
 };
-//Tag_Trailer_End
 
+static const int s_MP3SampleRates[3] = { 44100, 48000, 32000 };
 
-//ṹ,ļͷļβ
-struct Tag_Header Mp3Header;
-struct Tag_Trailer Mp3Trailer;
 
+static inline uint32_t MP3ReadU16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static inline uint32_t MP3ReadU32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static inline uint32_t MP3ReadU32LE(const uint8_t* p) { return ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0]; }
 
-int main(int argc,char **argv)
+static void MP3CopyTagText(char* dest, const uint8_t* src, int size)
 {
-    fp=fopen("test.mp3","r+");
-    if(fp==NULL){
-        printf("Can't open file\n");
-    }else{
-        Tag_GetHeader();
-        Tag_GetTrailer();
+    memcpy(dest, src, size);
+    dest[size] = '\0';
+    while (size > 0 && (dest[size - 1] == ' ' || dest[size - 1] == '\0'))
+        dest[--size] = '\0';
+}
+
+
+int MP3ParseFrameHeader(const uint8_t* data, MP3FrameHeader* header)
+{
+    int version, layer, bitrateIndex, rateIndex, padding;
+
+    if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0)
+        return -1;
+    version = (data[1] >> 3) & 3;
+    layer = 4 - ((data[1] >> 1) & 3);
+    bitrateIndex = data[2] >> 4;
+    rateIndex = (data[2] >> 2) & 3;
+    padding = (data[2] >> 1) & 1;
+    if (version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3 || (data[3] & 3) == 2)
+        return -1;
+
+    header->version = version;
+    header->layer = layer;
+    header->bitrate = s_MP3Bitrates[version == MP3Version_1 ? 0 : 1][layer - 1][bitrateIndex] * 1000;
+    header->sampleRate = s_MP3SampleRates[rateIndex] >> (version == MP3Version_1 ? 0 : (version == MP3Version_2 ? 1 : 2));
+    header->channelMode = data[3] >> 6;
+    header->channels = (header->channelMode == 3) ? 1 : 2;
+    header->hasCrc = !(data[1] & 1);
+    if (layer == 1) {
+        header->samplesPerFrame = 384;
+        header->frameSize = (12 * header->bitrate / header->sampleRate + padding) * 4;
+    } else if (layer == 2 || version == MP3Version_1) {
+        header->samplesPerFrame = 1152;
+        header->frameSize = 144 * header->bitrate / header->sampleRate + padding;
+    } else {
+        header->samplesPerFrame = 576;
+        header->frameSize = 72 * header->bitrate / header->sampleRate + padding;
     }
+    return 0;
+}
+
+int64_t MP3ID3v2Size(const uint8_t* data, int size)
+{
+    if (size < MP3_ID3V2_HEADER_SIZE || memcmp(data, "ID3", 3) != 0 || data[3] == 0xFF || data[4] == 0xFF
+            || ((data[6] | data[7] | data[8] | data[9]) & 0x80))
+        return 0;
+    return MP3_ID3V2_HEADER_SIZE + (((int64_t)data[6] << 21) | (data[7] << 14) | (data[8] << 7) | data[9])
+            + ((data[5] & 0x10) ? MP3_ID3V2_HEADER_SIZE : 0);
+}
+
+
+MP3Parser::MP3Parser()
+{
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    reset();
+}
+
+void MP3Parser::setCallbacks(const MP3ParserCallbacks& callbacks)
+{
+    m_callbacks = callbacks;
+}
 
-    printf("\n%s\n",Mp3Trailer.Title);
-    printf("%s\n",Mp3Trailer.Artist);
-    printf("%s\n",Mp3Trailer.Album);
-    printf("%s\n",Mp3Trailer.Year);
-    printf("%s\n",Mp3Trailer.Comment);
-    fclose(fp);
-    
+void MP3Parser::reset()
+{
+    memset(&m_info, 0, sizeof(m_info));
+    m_info.audioEnd = -1;
+    m_infoReady = false;
+    memset(&m_tag, 0, sizeof(m_tag));
+    m_hasTag = false;
+
+    memset(m_xingToc, 0, sizeof(m_xingToc));
+    m_hasXingToc = false;
+    m_vbriOffsets.clear();
+    m_vbriFramesPerEntry = 0;
+    m_vbrHeaderOffset = -1;
+
+    m_index.clear();
+    m_frameNumber = 0;
+    m_parsedBytes = 0;
+    m_parsedFrames = 0;
+
+    m_pending.clear();
+    m_fileOffset = 0;
+    m_skip = 0;
+    m_locked = false;
+    memset(&m_lock, 0, sizeof(m_lock));
+    m_baseUs = 0;
+    m_samples = 0;
+}
+
+int MP3Parser::resume(int64_t fileOffset, int64_t timeUs)
+{
+    std::vector<int64_t>::iterator it;
+
+    m_pending.clear();
+    m_fileOffset = fileOffset;
+    m_skip = 0;
+    m_locked = false;
+    m_baseUs = timeUs;
+    m_samples = 0;
+    m_frameNumber = -1;
+
+    if (!m_infoReady || fileOffset <= m_info.audioStart) {
+        m_frameNumber = 0;
+        m_baseUs = 0;
+    } else {
+        //落在采样 seek 表上时帧序号是准确的，之后还可以继续扩展 seek 表
+        it = std::lower_bound(m_index.begin(), m_index.end(), fileOffset);
+        if (it != m_index.end() && *it == fileOffset) {
+            m_frameNumber = (int64_t)(it - m_index.begin()) * MP3_SEEK_INDEX_INTERVAL;
+            m_baseUs = m_frameNumber * m_info.samplesPerFrame * 1000000 / m_info.sampleRate;
+        }
+    }
     return 0;
 }
 
-void Tag_GetTrailer(void){
-    //get header
-    fseek(fp,-128L,SEEK_END);
-    fread(Mp3Trailer.Header,3,1,fp);
 
-    //get title
-    fseek(fp,-125L,SEEK_END);
-    fread(Mp3Trailer.Title,30,1,fp);
+int MP3Parser::parse(const uint8_t* data, int length)
+{
+    int pos = 0;
+
+    if (data == NULL || length < 0)
+        return -1;
+
+    while (pos < length) {
+        int consumed;
+
+        if (!m_pending.empty()) {
+            //补全上次剩下的数据，m_pending 中原有的部分处理完后回到调用者的缓冲区
+            int old = m_pending.size();
+            int count = std::min(length - pos, MP3_PENDING_MAX - old);
+            m_pending.insert(m_pending.end(), data + pos, data + pos + count);
+            pos += count;
+            consumed = processView(&m_pending[0], m_pending.size(), false);
+            m_fileOffset += consumed;
+            if (consumed >= old) {
+                pos -= m_pending.size() - consumed;
+                m_pending.clear();
+            } else {
+                m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+            }
+            continue;
+        }
+
+        consumed = processView(data + pos, length - pos, false);
+        m_fileOffset += consumed;
+        m_pending.assign(data + pos + consumed, data + length);
+        pos = length;
+    }
+    return 0;
+}
+
+void MP3Parser::flush()
+{
+    if (!m_pending.empty()) {
+        processView(&m_pending[0], m_pending.size(), true);
+        m_fileOffset += m_pending.size();
+        m_pending.clear();
+    }
+}
+
+bool MP3Parser::matchesLock(const MP3FrameHeader& header)
+{
+    return header.version == m_lock.version && header.layer == m_lock.layer && header.sampleRate == m_lock.sampleRate;
+}
+
+int MP3Parser::processView(const uint8_t* view, int length, bool last)
+{
+    int pos = 0;
+
+    while (pos < length) {
+        int64_t offset = m_fileOffset + pos;
+        const uint8_t* p = view + pos;
+        int remaining = length - pos;
+        MP3FrameHeader header, next;
+
+        if (m_skip > 0) {
+            int count = (m_skip < remaining) ? (int)m_skip : remaining;
+            pos += count;
+            m_skip -= count;
+            continue;
+        }
+        if (m_info.audioEnd >= 0 && offset >= m_info.audioEnd)
+            return length;
+
+        if (p[0] != 0xFF) {
+            if (p[0] == 'I' && remaining < MP3_ID3V2_HEADER_SIZE && !last)
+                return pos;
+            m_skip = MP3ID3v2Size(p, remaining);
+            if (m_skip > 0) {
+                if (!m_infoReady)
+                    m_info.id3v2Size += m_skip;
+                m_locked = false;
+                continue;
+            }
+            if (m_locked) {
+                playerLogWarning("mp3 lost sync at offset [%lld].\n", (long long)offset);
+                m_locked = false;
+            }
+            p = (const uint8_t*)memchr(p + 1, 0xFF, remaining - 1);
+            pos = (p != NULL) ? p - view : length;
+            continue;
+        }
+
+        if (remaining < MP3_FRAME_HEADER_SIZE)
+            return last ? length : pos;
+        if (MP3ParseFrameHeader(p, &header) < 0 || (m_locked && !matchesLock(header))) {
+            if (m_locked) {
+                playerLogWarning("mp3 lost sync at offset [%lld].\n", (long long)offset);
+                m_locked = false;
+            }
+            pos++;
+            continue;
+        }
+
+        if (!m_locked) {
+            //还没有同步时要求下一帧的帧头一致，文件结尾只接受正好结束的一帧
+            if (remaining < header.frameSize + MP3_FRAME_HEADER_SIZE) {
+                if (!last)
+                    return pos;
+                if (remaining != header.frameSize) {
+                    pos++;
+                    continue;
+                }
+            } else if (MP3ParseFrameHeader(p + header.frameSize, &next) < 0 || next.version != header.version
+                    || next.layer != header.layer || next.sampleRate != header.sampleRate) {
+                pos++;
+                continue;
+            }
+            if (m_lock.sampleRate != 0 && (m_lock.sampleRate != header.sampleRate || m_lock.samplesPerFrame != header.samplesPerFrame)) {
+                //格式改变(拼接的文件)，时间戳从当前位置重新累计，帧序号不再准确
+                m_baseUs += m_samples * 1000000 / m_lock.sampleRate;
+                m_samples = 0;
+                m_frameNumber = -1;
+            }
+            m_lock = header;
+            m_locked = true;
+        } else if (remaining < header.frameSize) {
+            return last ? length : pos;
+        }
 
-    //get artist
-    fseek(fp,-95L,SEEK_END);
-    fread(Mp3Trailer.Artist,30,1,fp);
+        processFrame(p, header, offset);
+        pos += header.frameSize;
+    }
+    return pos;
+}
 
-    //get album
-    fseek(fp,-65L,SEEK_END);
-    fread(Mp3Trailer.Album,30,1,fp);
+void MP3Parser::processFrame(const uint8_t* data, const MP3FrameHeader& header, int64_t fileOffset)
+{
+    MP3Frame frame;
 
-    //get year
-    fseek(fp,-35L,SEEK_END);
-    fread(Mp3Trailer.Year,4,1,fp);
+    if (fileOffset == m_vbrHeaderOffset)
+        return;
+    if (!m_infoReady) {
+        m_info.version = header.version;
+        m_info.layer = header.layer;
+        m_info.sampleRate = header.sampleRate;
+        m_info.channels = header.channels;
+        m_info.samplesPerFrame = header.samplesPerFrame;
+        m_info.bitrate = header.bitrate;
+        m_info.audioStart = fileOffset;
+        m_infoReady = true;
+        if (parseVbrHeader(data, header))
+            m_vbrHeaderOffset = fileOffset;
+        updateDuration();
+        if (m_callbacks.onInfo)
+            m_callbacks.onInfo(&m_info, m_callbacks.userData);
+        if (m_vbrHeaderOffset == fileOffset)
+            return;
+    }
 
-    //get comment
-    fseek(fp,-31L,SEEK_END);
-    fread(Mp3Trailer.Comment,30,1,fp);
+    if (m_frameNumber >= 0) {
+        if (m_frameNumber % MP3_SEEK_INDEX_INTERVAL == 0 && m_frameNumber / MP3_SEEK_INDEX_INTERVAL == (int64_t)m_index.size())
+            m_index.push_back(fileOffset);
+        if (m_frameNumber == m_parsedFrames && m_info.vbrHeader == MP3VbrHeader_None) {
+            //没有 VBR 头时用从头开始连续解析的部分计算平均码率
+            m_parsedFrames++;
+            m_parsedBytes += header.frameSize;
+            if (header.bitrate != m_info.bitrate && !m_info.isVBR)
+                m_info.isVBR = 1;
+            if (m_info.isVBR && header.samplesPerFrame == m_info.samplesPerFrame && header.sampleRate == m_info.sampleRate) {
+                m_info.bitrate = (int)(m_parsedBytes * 8 * m_info.sampleRate / (m_parsedFrames * m_info.samplesPerFrame));
+                updateDuration();
+            }
+        }
+    }
 
-    //get Cenre
-    fseek(fp,-1L,SEEK_END);
-    fread(Mp3Trailer.Cenre,1,1,fp);
-    
-    return ;
+    frame.data = data;
+    frame.size = header.frameSize;
+    frame.fileOffset = fileOffset;
+    frame.frameNumber = m_frameNumber;
+    frame.ptsUs = m_baseUs + m_samples * 1000000 / header.sampleRate;
+    frame.durationUs = (int64_t)header.samplesPerFrame * 1000000 / header.sampleRate;
+    frame.header = header;
+    m_samples += header.samplesPerFrame;
+    if (m_frameNumber >= 0)
+        m_frameNumber++;
+    if (m_callbacks.onFrame)
+        m_callbacks.onFrame(&frame, m_callbacks.userData);
 }
 
-void Tag_GetHeader(void){
-    //get ID3 Tag
-    fseek(fp,0,SEEK_SET);
-    fread(Mp3Header.Header,sizeof(Mp3Header.Header),1,fp);
+bool MP3Parser::parseVbrHeader(const uint8_t* data, const MP3FrameHeader& header)
+{
+    const uint8_t* p;
+    const uint8_t* end = data + header.frameSize;
+    uint32_t flags;
+    int i;
 
-    //get ID3 version
-    fseek(fp,3,SEEK_CUR);
-    fread(Mp3Header.ver,sizeof(Mp3Header.ver),1,fp);
+    //Xing/Info 在 side information 之后
+    if (header.version == MP3Version_1)
+        p = data + MP3_FRAME_HEADER_SIZE + (header.channels == 1 ? 17 : 32);
+    else
+        p = data + MP3_FRAME_HEADER_SIZE + (header.channels == 1 ? 9 : 17);
 
-    //get ID3 Reversion
-    fseek(fp,4,SEEK_CUR);
-    fread(Mp3Header.Rever,sizeof(Mp3Header.Rever),1,fp);
+    if (p + 8 <= end && (memcmp(p, "Xing", 4) == 0 || memcmp(p, "Info", 4) == 0)) {
+        m_info.vbrHeader = (p[0] == 'X') ? MP3VbrHeader_Xing : MP3VbrHeader_Info;
+        m_info.isVBR = (m_info.vbrHeader == MP3VbrHeader_Xing);
+        flags = MP3ReadU32(p + 4);
+        p += 8;
+        if ((flags & 1) && p + 4 <= end) {
+            m_info.frames = MP3ReadU32(p);
+            p += 4;
+        }
+        if ((flags & 2) && p + 4 <= end) {
+            m_info.bytes = MP3ReadU32(p);
+            p += 4;
+        }
+        if ((flags & 4) && p + MP3_XING_TOC_SIZE <= end) {
+            memcpy(m_xingToc, p, MP3_XING_TOC_SIZE);
+            m_hasXingToc = (m_info.frames > 0 && m_info.bytes > 0);
+            p += MP3_XING_TOC_SIZE;
+        }
+        if (flags & 8)
+            p += 4;
+        //LAME 标签：9 字节编码器版本，第 21 字节开始 12 位 delay 和 12 位 padding
+        if (p + 24 <= end && (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavf", 4) == 0 || memcmp(p, "Lavc", 4) == 0)) {
+            m_info.encoderDelay = (p[21] << 4) | (p[22] >> 4);
+            m_info.encoderPadding = ((p[22] & 0x0F) << 8) | p[23];
+        }
+        return true;
+    }
 
-    //get ID3 flag
-    fseek(fp,5,SEEK_CUR);
-    fread(Mp3Header.Flag,sizeof(Mp3Header.Flag),1,fp);
+    p = data + MP3_FRAME_HEADER_SIZE + 32;
+    if (p + 26 <= end && memcmp(p, "VBRI", 4) == 0) {
+        int entries = MP3ReadU16(p + 18);
+        int scale = MP3ReadU16(p + 20);
+        int entrySize = MP3ReadU16(p + 22);
+        int64_t offset = 0;
 
-    //get ID3 size
-    fseek(fp,6,SEEK_CUR);
-    fread(Mp3Header.Size,sizeof(Mp3Header.Size),1,fp);
-    
-    return ;
-}
\ No newline at end of file
+        m_info.vbrHeader = MP3VbrHeader_VBRI;
+        m_info.isVBR = 1;
+        m_info.encoderDelay = MP3ReadU16(p + 6);
+        m_info.bytes = MP3ReadU32(p + 10);
+        m_info.frames = MP3ReadU32(p + 14);
+        m_vbriFramesPerEntry = MP3ReadU16(p + 24);
+        p += 26;
+        if (entrySize >= 1 && entrySize <= 4 && m_vbriFramesPerEntry > 0 && p + entries * entrySize <= end) {
+            m_vbriOffsets.reserve(entries + 1);
+            m_vbriOffsets.push_back(0);
+            for (i = 0; i < entries; i++, p += entrySize) {
+                uint32_t value = 0;
+                for (int k = 0; k < entrySize; k++)
+                    value = (value << 8) | p[k];
+                offset += (int64_t)value * scale;
+                m_vbriOffsets.push_back(offset);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void MP3Parser::updateDuration()
+{
+    int64_t end = (m_info.audioEnd >= 0) ? m_info.audioEnd : m_info.fileSize;
+
+    if (!m_infoReady)
+        return;
+    if (m_info.vbrHeader != MP3VbrHeader_None && m_info.frames > 0) {
+        m_info.durationUs = m_info.frames * m_info.samplesPerFrame * 1000000 / m_info.sampleRate;
+        if (m_info.bytes == 0 && end > m_info.audioStart)
+            m_info.bytes = end - m_info.audioStart;
+        if (m_info.bytes > 0)
+            m_info.bitrate = (int)((double)m_info.bytes * 8 * 1000000 / m_info.durationUs);
+    } else if (end > m_info.audioStart && m_info.bitrate > 0) {
+        m_info.bytes = end - m_info.audioStart;
+        m_info.durationUs = (int64_t)((double)m_info.bytes * 8 * 1000000 / m_info.bitrate);
+    }
+}
+
+
+int MP3Parser::parseTail(const uint8_t* data, int size, int64_t fileSize)
+{
+    int64_t end = fileSize;
+    int result = 0;
+    const uint8_t* p;
+
+    if (data == NULL || size < 0 || fileSize < size)
+        return -1;
+
+    if (size >= MP3_ID3V1_SIZE && memcmp(data + size - MP3_ID3V1_SIZE, "TAG", 3) == 0) {
+        p = data + size - MP3_ID3V1_SIZE;
+        MP3CopyTagText(m_tag.title, p + 3, 30);
+        MP3CopyTagText(m_tag.artist, p + 33, 30);
+        MP3CopyTagText(m_tag.album, p + 63, 30);
+        MP3CopyTagText(m_tag.year, p + 93, 4);
+        MP3CopyTagText(m_tag.comment, p + 97, 30);
+        m_tag.track = (p[125] == 0 && p[126] != 0) ? p[126] : 0;
+        m_tag.genre = p[127];
+        m_hasTag = true;
+        end -= MP3_ID3V1_SIZE;
+        result = 1;
+    }
+
+    //APEv2 在 ID3v1 之前，footer 中的大小不包括 header
+    p = data + size - (fileSize - end);
+    if (p - data >= MP3_APE_FOOTER_SIZE && memcmp(p - MP3_APE_FOOTER_SIZE, "APETAGEX", 8) == 0) {
+        int64_t tagSize = MP3ReadU32LE(p - MP3_APE_FOOTER_SIZE + 12);
+        if (MP3ReadU32LE(p - MP3_APE_FOOTER_SIZE + 20) & 0x80000000)
+            tagSize += MP3_APE_FOOTER_SIZE;
+        if (tagSize <= end)
+            end -= tagSize;
+    }
+
+    m_info.audioEnd = end;
+    m_info.fileSize = fileSize;
+    updateDuration();
+    return result;
+}
+
+
+int MP3Parser::seekTo(int64_t timeUs, int64_t* fileOffset, int64_t* frameTimeUs)
+{
+    int64_t frame, offset, time;
+    int64_t end;
+    size_t entry;
+    int result = 0;
+
+    if (!m_infoReady || fileOffset == NULL)
+        return -1;
+    if (timeUs < 0)
+        timeUs = 0;
+    if (m_info.durationUs > 0 && timeUs > m_info.durationUs)
+        timeUs = m_info.durationUs;
+    frame = timeUs * m_info.sampleRate / ((int64_t)m_info.samplesPerFrame * 1000000);
+    entry = frame / MP3_SEEK_INDEX_INTERVAL;
+    end = (m_info.audioEnd >= 0) ? m_info.audioEnd : m_info.fileSize;
+    time = timeUs;
+
+    if (entry < m_index.size()) {
+        offset = m_index[entry];
+        time = (int64_t)entry * MP3_SEEK_INDEX_INTERVAL * m_info.samplesPerFrame * 1000000 / m_info.sampleRate;
+        result = 1;
+    } else if (m_hasXingToc && m_info.durationUs > 0) {
+        //TOC 为 100 个百分比位置上的字节位置 (/256)，中间线性插值
+        double percent = (double)timeUs * 100 / m_info.durationUs;
+        int index = std::min((int)percent, MP3_XING_TOC_SIZE - 1);
+        double a = m_xingToc[index];
+        double b = (index + 1 < MP3_XING_TOC_SIZE) ? m_xingToc[index + 1] : 256;
+        offset = m_info.audioStart + (int64_t)((a + (b - a) * (percent - index)) / 256 * m_info.bytes);
+    } else if (m_vbriOffsets.size() > 1) {
+        int64_t entryUs = (int64_t)m_vbriFramesPerEntry * m_info.samplesPerFrame * 1000000 / m_info.sampleRate;
+        size_t index = std::min((size_t)(timeUs / entryUs), m_vbriOffsets.size() - 2);
+        double fraction = std::min(1.0, (double)(timeUs - (int64_t)index * entryUs) / entryUs);
+        offset = m_info.audioStart + m_vbriOffsets[index] + (int64_t)((m_vbriOffsets[index + 1] - m_vbriOffsets[index]) * fraction);
+    } else if (!m_info.isVBR) {
+        //CBR：按帧对齐，帧长可能因 padding 差一个字节，resume() 之后会重新同步
+        offset = m_info.audioStart + (m_vbrHeaderOffset >= 0 ? m_lock.frameSize : 0)
+                + (int64_t)((double)frame * m_info.samplesPerFrame * m_info.bitrate / 8 / m_info.sampleRate);
+        time = frame * m_info.samplesPerFrame * 1000000 / m_info.sampleRate;
+    } else {
+        offset = m_info.audioStart + (int64_t)((double)timeUs * m_info.bitrate / 8 / 1000000);
+    }
+
+    if (end > m_info.audioStart && offset >= end)
+        offset = end - 1;
+    *fileOffset = offset;
+    if (frameTimeUs)
+        *frameTimeUs = time;
+    return result;
+}
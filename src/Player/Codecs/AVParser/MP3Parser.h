@@ -1 +1,187 @@
- 
\ No newline at end of file
+#ifndef __MP3_PARSER_H__
+#define __MP3_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     MP3_FRAME_HEADER_SIZE       4
+#define     MP3_FRAME_SIZE_MAX          2881        //MPEG2 Layer II 160kbps 8kHz 的帧最大
+#define     MP3_ID3V2_HEADER_SIZE       10
+#define     MP3_ID3V1_SIZE              128
+#define     MP3_APE_FOOTER_SIZE         32
+#define     MP3_TAIL_SIZE               (MP3_ID3V1_SIZE + 4096)     //parseTail() 需要的文件末尾长度，包含 ID3v1 和一般大小的 APEv2
+#define     MP3_PENDING_MAX             8192        //跨 parse() 保存的数据上限，大于一帧加下一帧的头
+#define     MP3_SEEK_INDEX_INTERVAL     32          //采样 seek 表每隔多少帧记录一次位置
+#define     MP3_XING_TOC_SIZE           100
+
+
+typedef enum {
+    MP3Version_2_5  = 0,
+    MP3Version_2    = 2,
+    MP3Version_1    = 3
+} MP3Version;
+
+typedef enum {
+    MP3VbrHeader_None = 0,
+    MP3VbrHeader_Xing,                  //VBR 的 Xing 头
+    MP3VbrHeader_Info,                  //LAME 给 CBR 写的 Info 头，格式与 Xing 相同
+    MP3VbrHeader_VBRI                   //Fraunhofer
+} MP3VbrHeader;
+
+
+typedef struct _MP3FrameHeader {
+    int             version;            //MP3Version
+    int             layer;              //1~3
+    int             bitrate;            //bps
+    int             sampleRate;
+    int             channels;
+    int             channelMode;        //0:stereo 1:joint stereo 2:dual channel 3:mono
+    int             samplesPerFrame;
+    int             frameSize;          //包含 4 字节帧头
+    int             hasCrc;
+} MP3FrameHeader;
+
+typedef struct _MP3Frame {
+    const uint8_t*  data;               //从帧头开始，只在回调中有效
+    int             size;
+    int64_t         fileOffset;
+    int64_t         frameNumber;        //从第一帧音频开始的序号，seek 到估计位置后为 -1
+    int64_t         ptsUs;
+    int64_t         durationUs;
+    MP3FrameHeader  header;
+} MP3Frame;
+
+typedef struct _MP3Info {
+    int             version;
+    int             layer;
+    int             sampleRate;
+    int             channels;
+    int             samplesPerFrame;
+    int             bitrate;            //平均码率 bps
+    int             isVBR;
+    int             vbrHeader;          //MP3VbrHeader
+    int64_t         frames;             //Xing/VBRI 中的帧数，没有时为 0
+    int64_t         bytes;              //音频数据的字节数
+    int64_t         durationUs;         //没有 VBR 头和文件大小时为 0
+    int             encoderDelay;       //LAME 标签中的 encoder delay/padding，解码时去掉可以实现无缝播放
+    int             encoderPadding;
+    int64_t         id3v2Size;
+    int64_t         audioStart;         //第一帧(包括 Xing/VBRI 帧)的位置
+    int64_t         audioEnd;           //音频数据结束，即 ID3v1/APEv2 的位置，未知为 -1
+    int64_t         fileSize;
+} MP3Info;
+
+typedef struct _MP3ID3v1Tag {
+    char            title[31];
+    char            artist[31];
+    char            album[31];
+    char            year[5];
+    char            comment[31];
+    int             track;              //ID3v1.1，没有为 0
+    int             genre;
+} MP3ID3v1Tag;
+
+typedef struct _MP3ParserCallbacks {
+    void (*onInfo)(const MP3Info* info, void* userData);        //找到第一帧后调用一次，parseTail() 之后 duration 会更新
+    void (*onFrame)(const MP3Frame* frame, void* userData);
+    void*   userData;
+} MP3ParserCallbacks;
+
+
+/**
+ *  @Func: MP3ParseFrameHeader
+ *         ps. :不支持 free format (码率索引为 0)
+ *  @Param: data, type:: const uint8_t*, 至少 4 字节
+ *  @Param: header, type:: MP3FrameHeader*
+ *  @Return: int, 不是合法的帧头返回 -1
+ *
+ **/
+int MP3ParseFrameHeader(const uint8_t* data, MP3FrameHeader* header);
+
+/* ID3v2 标签的总长度，包括头和 footer；不是 ID3v2 返回 0，需要 10 字节 */
+int64_t MP3ID3v2Size(const uint8_t* data, int size);
+
+
+class MP3Parser { /* 流式 MPEG audio 帧解析：ID3v2 跳过，Xing/Info/VBRI/LAME 头，时长和码率，seek 表 */
+    public:
+        MP3Parser();
+        ~MP3Parser(){}
+
+        void setCallbacks(const MP3ParserCallbacks& callbacks);
+        int parse(const uint8_t* data, int length);     //数据可以按任意大小分块输入，返回 0
+        void flush();                                   //文件结束，输出最后一帧
+        int resume(int64_t fileOffset, int64_t timeUs); //seekTo() 之后从 fileOffset 重新输入数据
+        void reset();
+
+        /**
+         *  @Func: parseTail
+         *         ps. :读取文件末尾的 ID3v1/APEv2，确定音频数据的结束位置；没有 VBR 头的 CBR 文件由此计算时长
+         *  @Param: data, type:: const uint8_t*, 文件最后 size 字节，建议 MP3_TAIL_SIZE
+         *  @Param: size, type:: int
+         *  @Param: fileSize, type:: int64_t
+         *  @Return: int, 有 ID3v1 返回 1，否则返回 0
+         *
+         **/
+        int parseTail(const uint8_t* data, int size, int64_t fileSize);
+
+        /**
+         *  @Func: seekTo
+         *         ps. :O(1) 查找：已解析部分用采样 seek 表(精确到帧)，否则依次使用 Xing TOC、VBRI 表、CBR 计算、平均码率估计
+         *  @Param: timeUs, type:: int64_t
+         *  @Param: fileOffset, type:: int64_t*, 用于 resume() 和 HTTP Range 请求
+         *  @Param: frameTimeUs, type:: int64_t*, 该位置对应的时间，可为 NULL
+         *  @Return: int, 精确位置返回 1，估计位置返回 0，还没有找到第一帧返回 -1
+         *
+         **/
+        int seekTo(int64_t timeUs, int64_t* fileOffset, int64_t* frameTimeUs);
+
+        const MP3Info* getInfo() { return m_infoReady ? &m_info : NULL; }
+        const MP3ID3v1Tag* getTag() { return m_hasTag ? &m_tag : NULL; }
+        int64_t getFileOffset() { return m_fileOffset + m_pending.size(); }
+
+    private:
+        int processView(const uint8_t* view, int length, bool last);
+        bool matchesLock(const MP3FrameHeader& header);
+        void processFrame(const uint8_t* data, const MP3FrameHeader& header, int64_t fileOffset);
+        bool parseVbrHeader(const uint8_t* data, const MP3FrameHeader& header);
+        void updateDuration();
+
+        MP3ParserCallbacks          m_callbacks;
+        MP3Info                     m_info;
+        bool                        m_infoReady;
+        MP3ID3v1Tag                 m_tag;
+        bool                        m_hasTag;
+
+        /* VBR 头中的 seek 表 */
+        uint8_t                     m_xingToc[MP3_XING_TOC_SIZE];
+        bool                        m_hasXingToc;
+        std::vector<int64_t>        m_vbriOffsets;      //每段开始相对 audioStart 的位置，最后一个为结束
+        int                         m_vbriFramesPerEntry;
+        int64_t                     m_vbrHeaderOffset;  //Xing/VBRI 帧的位置，seek 回来时不当作音频输出
+
+        /* 采样 seek 表：第 i 项为第 i * MP3_SEEK_INDEX_INTERVAL 帧的位置 */
+        std::vector<int64_t>        m_index;
+        int64_t                     m_frameNumber;      //下一帧的序号，-1 为未知
+        int64_t                     m_parsedBytes;      //没有 VBR 头时计算平均码率
+        int64_t                     m_parsedFrames;
+
+        /* 流式解析状态 */
+        std::vector<uint8_t>        m_pending;
+        int64_t                     m_fileOffset;       //m_pending (为空时为下一次输入) 开始处在文件中的位置
+        int64_t                     m_skip;             //ID3v2 标签中还需要跳过的字节
+        bool                        m_locked;
+        MP3FrameHeader              m_lock;             //同步后的帧头，版本/层/采样率必须相同
+        int64_t                     m_baseUs;
+        int64_t                     m_samples;          //m_baseUs 之后输出的采样数
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__MP3_PARSER_H__
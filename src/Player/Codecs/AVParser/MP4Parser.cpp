@@ -0,0 +1,1408 @@
+/**
+ *  MP4Parser.cpp文件
+ *  ISO-BMFF (MP4/MOV) 解复用；
+ *  主要有以下部分：
+ *          数据来源和 sample table 页缓存
+ *          moov 解析：mvhd/tkhd/mdhd/hdlr/stsd/elst/trex
+ *          sample table 游标：stts/ctts/stsc/stsz/stco/co64/stss
+ *          fragment：moof/traf/tfhd/tfdt/trun
+ *
+ *  open() 时 sample table 只记录在文件中的位置和 entry 数，不读入内存也不展开；
+ *  顺序读取时每个 track 维护一组游标，每个 sample 只读取几个 entry，都经过固定大小的页缓存。
+ *  seek 时第一次扫描 stts/ctts 建立稀疏检查点(每 MP4_CHECKPOINT_INTERVAL 个 run 一个)，之后二分查找。
+ *  moov 在文件末尾时 open() 只读取顶层 box 的头，不读 mdat，数据来源可以是 HTTP Range 请求。
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <deque>
+
+#include "LogPlayer.h"
+#include "MP4Parser.h"
+
+
+static inline uint32_t MP4ReadU16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static inline uint32_t MP4ReadU32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static inline uint64_t MP4ReadU64(const uint8_t* p) { return ((uint64_t)MP4ReadU32(p) << 32) | MP4ReadU32(p + 4); }
+
+static inline int64_t MP4Rescale(int64_t value, int64_t from, int64_t to)
+{
+    if (from <= 0)
+        return 0;
+    return (value / from) * to + (value % from) * to / from;
+}
+
+
+/* sample table 在文件中的位置 */
+struct MP4Table {
+    int64_t     offset;             //第一个 entry 的位置
+    uint32_t    count;
+    int         entrySize;
+};
+
+struct MP4Checkpoint {
+    uint32_t    run;
+    uint32_t    sample;
+    int64_t     time;               //stts: 该 run 第一个 sample 的 DTS；ctts 不使用
+};
+
+struct MP4FragmentSample {
+    int64_t     offset;
+    int         size;
+    int         isKeyframe;
+    int64_t     dts;
+    int32_t     ctsOffset;
+};
+
+struct MP4TrackContext {
+    MP4TrackInfo                info;
+    std::vector<uint8_t>        codecConfig;
+    bool                        enabled;
+    bool                        hasStsd;
+    int64_t                     editOffset;         //elst 第一个有效 edit 的 media_time
+
+    MP4Table                    stts;
+    MP4Table                    ctts;
+    MP4Table                    stsc;
+    MP4Table                    stsz;
+    MP4Table                    stco;               //stco 或 co64
+    MP4Table                    stss;
+    uint32_t                    constantSize;       //stsz 的 sample_size，非 0 时没有 entry
+
+    /* 顺序读取的游标，sample 从 0 开始 */
+    uint32_t                    sample;
+    uint32_t                    chunk;
+    uint32_t                    sampleInChunk;
+    uint32_t                    samplesPerChunk;
+    int64_t                     offsetInChunk;
+    uint32_t                    stscIndex;
+    uint32_t                    sttsIndex;
+    uint32_t                    sttsRemaining;
+    uint32_t                    sttsDelta;
+    int64_t                     dts;
+    uint32_t                    cttsIndex;
+    uint32_t                    cttsRemaining;
+    int32_t                     cttsOffset;
+    uint32_t                    stssIndex;
+
+    bool                        checkpointsBuilt;
+    std::vector<MP4Checkpoint>  sttsCheckpoints;
+    std::vector<MP4Checkpoint>  cttsCheckpoints;
+
+    /* fragment */
+    uint32_t                    trexDuration;
+    uint32_t                    trexSize;
+    uint32_t                    trexFlags;
+    bool                        fragmentSeen;       //在某个 traf 中出现过
+    int64_t                     fragmentDts;        //没有 tfdt 时接着上一个 fragment
+    std::deque<MP4FragmentSample>   fragmentSamples;
+};
+
+
+static int MP4FileRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    int fd = (int)(intptr_t)opaque;
+    int total = 0;
+
+    while (total < size) {
+        ssize_t ret = pread(fd, buffer + total, size - total, (off_t)(offset + total));
+        if (ret < 0)
+            return -1;
+        if (ret == 0)
+            break;
+        total += ret;
+    }
+    return total;
+}
+
+int MP4ByteSourceOpenFile(MP4ByteSource* source, const char* path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        playerLogError("open %s error.\n", path);
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    source->read = MP4FileRead;
+    source->size = st.st_size;
+    source->opaque = (void*)(intptr_t)fd;
+    return 0;
+}
+
+void MP4ByteSourceCloseFile(MP4ByteSource* source)
+{
+    if (source->read == MP4FileRead)
+        ::close((int)(intptr_t)source->opaque);
+    memset(source, 0, sizeof(*source));
+}
+
+
+MP4Parser::MP4Parser()
+    : m_durationUs(0)
+    , m_movieTimescale(0)
+    , m_fragmented(false)
+    , m_nextFragment(-1)
+    , m_lastPage(-1)
+    , m_useClock(0)
+{
+    memset(&m_source, 0, sizeof(m_source));
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+MP4Parser::~MP4Parser()
+{
+    close();
+}
+
+
+void MP4Parser::close()
+{
+    for (size_t i = 0; i < m_tracks.size(); i++)
+        delete m_tracks[i];
+    m_tracks.clear();
+    m_trex.clear();
+    m_fragmentIndex.clear();
+    m_pages.clear();
+    m_pageMap.clear();
+    m_lastPage = -1;
+    m_durationUs = 0;
+    m_movieTimescale = 0;
+    m_fragmented = false;
+    m_nextFragment = -1;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+
+int MP4Parser::readSource(int64_t offset, uint8_t* buffer, int size)
+{
+    int ret;
+
+    if (m_source.size >= 0) {
+        if (offset >= m_source.size)
+            return 0;
+        if (offset + size > m_source.size)
+            size = (int)(m_source.size - offset);
+    }
+    ret = m_source.read(m_source.opaque, offset, buffer, size);
+    m_statistics.readCalls++;
+    if (ret > 0)
+        m_statistics.readBytes += ret;
+    return ret;
+}
+
+
+int MP4Parser::getPage(int64_t base)
+{
+    std::map<int64_t, int>::iterator it;
+    int index;
+
+    if (m_lastPage >= 0 && m_pages[m_lastPage].base == base) {
+        m_pages[m_lastPage].lastUse = ++m_useClock;
+        return m_lastPage;
+    }
+    it = m_pageMap.find(base);
+    if (it != m_pageMap.end()) {
+        index = it->second;
+    } else {
+        if (m_pages.size() < MP4_PAGE_CACHE_COUNT) {
+            m_pages.push_back(Page());
+            index = m_pages.size() - 1;
+            m_pages[index].data.resize(MP4_PAGE_SIZE);
+        } else { //淘汰最久未使用的页
+            index = 0;
+            for (size_t i = 1; i < m_pages.size(); i++) {
+                if (m_pages[i].lastUse < m_pages[index].lastUse)
+                    index = i;
+            }
+            m_pageMap.erase(m_pages[index].base);
+        }
+        Page& page = m_pages[index];
+        page.base = base;
+        page.size = readSource(base, &page.data[0], MP4_PAGE_SIZE);
+        if (page.size < 0)
+            page.size = 0;
+        m_pageMap[base] = index;
+    }
+    m_pages[index].lastUse = ++m_useClock;
+    m_lastPage = index;
+    return index;
+}
+
+
+/* 返回的指针在下一次读取之前有效 */
+const uint8_t* MP4Parser::readCached(int64_t offset, int size)
+{
+    int64_t base = offset & ~(int64_t)(MP4_PAGE_SIZE - 1);
+    int inPage = (int)(offset - base);
+
+    if (inPage + size <= MP4_PAGE_SIZE) {
+        Page& page = m_pages[getPage(base)];
+        if (inPage + size > page.size)
+            return NULL;
+        return &page.data[inPage];
+    }
+    if (size > (int)sizeof(m_scratch) || readCachedRange(offset, m_scratch, size) != size)
+        return NULL;
+    return m_scratch;
+}
+
+
+int MP4Parser::readCachedRange(int64_t offset, uint8_t* buffer, int size)
+{
+    int total = 0;
+
+    while (total < size) {
+        int64_t base = (offset + total) & ~(int64_t)(MP4_PAGE_SIZE - 1);
+        int inPage = (int)(offset + total - base);
+        Page& page = m_pages[getPage(base)];
+        int length = page.size - inPage;
+
+        if (length <= 0)
+            break;
+        if (length > size - total)
+            length = size - total;
+        memcpy(buffer + total, &page.data[inPage], length);
+        total += length;
+    }
+    return total;
+}
+
+
+uint32_t MP4Parser::readU32(int64_t offset)
+{
+    const uint8_t* p = readCached(offset, 4);
+    return p ? MP4ReadU32(p) : 0;
+}
+
+
+int MP4Parser::open(const MP4ByteSource& source)
+{
+    int64_t offset = 0;
+    int64_t moovEnd = -1;
+    int64_t firstMoof = -1;
+    uint8_t header[16];
+    size_t i;
+
+    close();
+    m_source = source;
+
+    //顶层 box：只读头，跳过 mdat，直到找到 moov
+    for (;;) {
+        int length = readCachedRange(offset, header, 16);
+        uint64_t size;
+        uint32_t type;
+        int headerSize = 8;
+
+        if (length < 8)
+            break;
+        size = MP4ReadU32(header);
+        type = MP4ReadU32(header + 4);
+        if (size == 1) {
+            if (length < 16)
+                break;
+            size = MP4ReadU64(header + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            if (m_source.size < 0)
+                break;
+            size = m_source.size - offset;
+        }
+        if (size < (uint64_t)headerSize) {
+            playerLogWarning("invalid box size %llu at %lld.\n", (unsigned long long)size, (long long)offset);
+            break;
+        }
+        if (type == MP4_FOURCC('m', 'o', 'o', 'f') && firstMoof < 0)
+            firstMoof = offset;
+        if (type == MP4_FOURCC('m', 'o', 'o', 'v')) {
+            if (parseBoxes(offset + headerSize, offset + size, 1, NULL) < 0)
+                return -1;
+            moovEnd = offset + size;
+            break;
+        }
+        offset += size;
+    }
+    if (moovEnd < 0) {
+        playerLogError("moov not found.\n");
+        return -1;
+    }
+
+    for (i = 0; i + 3 < m_trex.size(); i += 4) {
+        for (size_t j = 0; j < m_tracks.size(); j++) {
+            if (m_tracks[j]->info.trackId == (int)m_trex[i]) {
+                m_tracks[j]->trexDuration = m_trex[i + 1];
+                m_tracks[j]->trexSize = m_trex[i + 2];
+                m_tracks[j]->trexFlags = m_trex[i + 3];
+            }
+        }
+    }
+    if (m_fragmented)
+        m_nextFragment = (firstMoof >= 0) ? firstMoof : moovEnd;
+
+    for (i = 0; i < m_tracks.size(); i++) {
+        MP4TrackContext* track = m_tracks[i];
+        int64_t durationUs = MP4Rescale(track->info.duration, track->info.timescale, 1000000);
+        if (durationUs > m_durationUs)
+            m_durationUs = durationUs;
+        positionCursor(track, 0);
+    }
+    if (m_tracks.empty()) {
+        playerLogError("no playable track.\n");
+        return -1;
+    }
+    m_statistics.openBytes = m_statistics.readBytes;
+    m_statistics.openReads = m_statistics.readCalls;
+    playerLogInfo("mp4 open: %d tracks, duration %lld ms, %s, read %lld bytes in %d requests.\n", (int)m_tracks.size(),
+            (long long)(m_durationUs / 1000), m_fragmented ? "fragmented" : "progressive",
+            (long long)m_statistics.openBytes, m_statistics.openReads);
+    return 0;
+}
+
+
+int MP4Parser::parseBoxes(int64_t offset, int64_t end, int depth, MP4TrackContext* track)
+{
+    uint8_t header[16];
+
+    if (depth > MP4_BOX_DEPTH_MAX)
+        return 0;
+    while (offset + 8 <= end) {
+        uint64_t size;
+        uint32_t type;
+        int headerSize = 8;
+
+        if (readCachedRange(offset, header, 16) < 8)
+            return -1;
+        size = MP4ReadU32(header);
+        type = MP4ReadU32(header + 4);
+        if (size == 1) {
+            size = MP4ReadU64(header + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - offset;
+        }
+        if (size < (uint64_t)headerSize || (int64_t)(offset + size) > end) {
+            playerLogWarning("truncated box '%.4s' at %lld.\n", (char*)header + 4, (long long)offset);
+            break;
+        }
+
+        switch (type) {
+            case MP4_FOURCC('t', 'r', 'a', 'k'): {
+                MP4TrackContext* context;
+                if (m_tracks.size() >= MP4_TRACK_MAX)
+                    break;
+                context = new MP4TrackContext();
+                context->enabled = true;
+                if (parseBoxes(offset + headerSize, offset + size, depth + 1, context) < 0 || !finishTrack(context))
+                    delete context;
+                else
+                    m_tracks.push_back(context);
+                break;
+            }
+            case MP4_FOURCC('m', 'v', 'e', 'x'):
+                m_fragmented = true;
+                //fall through
+            case MP4_FOURCC('m', 'd', 'i', 'a'):
+            case MP4_FOURCC('m', 'i', 'n', 'f'):
+            case MP4_FOURCC('s', 't', 'b', 'l'):
+            case MP4_FOURCC('e', 'd', 't', 's'):
+                if (parseBoxes(offset + headerSize, offset + size, depth + 1, track) < 0)
+                    return -1;
+                break;
+            default:
+                if (parseLeaf(type, offset + headerSize, size - headerSize, track) < 0)
+                    return -1;
+                break;
+        }
+        offset += size;
+    }
+    return 0;
+}
+
+
+int MP4Parser::parseLeaf(uint32_t type, int64_t offset, int64_t size, MP4TrackContext* track)
+{
+    std::vector<uint8_t> box;
+    MP4Table* table = NULL;
+    const uint8_t* p;
+    int entrySize = 4;
+    int version;
+
+    //sample table 只读 box 头
+    switch (type) {
+        case MP4_FOURCC('s', 't', 't', 's'): table = track ? &track->stts : NULL; entrySize = 8; break;
+        case MP4_FOURCC('c', 't', 't', 's'): table = track ? &track->ctts : NULL; entrySize = 8; break;
+        case MP4_FOURCC('s', 't', 's', 'c'): table = track ? &track->stsc : NULL; entrySize = 12; break;
+        case MP4_FOURCC('s', 't', 'c', 'o'): table = track ? &track->stco : NULL; entrySize = 4; break;
+        case MP4_FOURCC('c', 'o', '6', '4'): table = track ? &track->stco : NULL; entrySize = 8; break;
+        case MP4_FOURCC('s', 't', 's', 's'): table = track ? &track->stss : NULL; entrySize = 4; break;
+        case MP4_FOURCC('s', 't', 's', 'z'): {
+            if (track == NULL || size < 12 || (p = readCached(offset, 12)) == NULL)
+                return 0;
+            track->constantSize = MP4ReadU32(p + 4);
+            track->info.sampleCount = MP4ReadU32(p + 8);
+            track->stsz.offset = offset + 12;
+            track->stsz.entrySize = 4;
+            track->stsz.count = track->constantSize ? 0 : track->info.sampleCount;
+            if (track->stsz.count > (size - 12) / 4)
+                track->info.sampleCount = track->stsz.count = (size - 12) / 4;
+            return 0;
+        }
+        case MP4_FOURCC('s', 't', 'z', '2'):
+            playerLogWarning("stz2 is not supported.\n");
+            return 0;
+        case MP4_FOURCC('m', 'v', 'h', 'd'):
+        case MP4_FOURCC('m', 'e', 'h', 'd'):
+        case MP4_FOURCC('t', 'k', 'h', 'd'):
+        case MP4_FOURCC('m', 'd', 'h', 'd'):
+        case MP4_FOURCC('h', 'd', 'l', 'r'):
+        case MP4_FOURCC('s', 't', 's', 'd'):
+        case MP4_FOURCC('e', 'l', 's', 't'):
+        case MP4_FOURCC('t', 'r', 'e', 'x'):
+            break;
+        default:
+            return 0;
+    }
+    if (table) {
+        if (size < 8 || (p = readCached(offset, 8)) == NULL)
+            return 0;
+        table->offset = offset + 8;
+        table->entrySize = entrySize;
+        table->count = MP4ReadU32(p + 4);
+        if (table->count > (size - 8) / entrySize)
+            table->count = (size - 8) / entrySize;
+        return 0;
+    }
+
+    if (size < 4 || size > MP4_LEAF_BOX_SIZE_MAX)
+        return 0;
+    box.resize(size);
+    if (readCachedRange(offset, &box[0], size) != size)
+        return -1;
+    p = &box[0];
+    version = p[0];
+
+    switch (type) {
+        case MP4_FOURCC('m', 'v', 'h', 'd'):
+            if (size >= (version == 1 ? 32 : 20)) {
+                uint64_t duration;
+                m_movieTimescale = MP4ReadU32(p + (version == 1 ? 20 : 12));
+                duration = (version == 1) ? MP4ReadU64(p + 24) : MP4ReadU32(p + 16);
+                if (duration != 0xFFFFFFFF && duration != (uint64_t)-1)
+                    m_durationUs = MP4Rescale(duration, m_movieTimescale, 1000000);
+            }
+            break;
+        case MP4_FOURCC('m', 'e', 'h', 'd'):
+            if (size >= (version == 1 ? 12 : 8))
+                m_durationUs = MP4Rescale((version == 1) ? MP4ReadU64(p + 4) : MP4ReadU32(p + 4), m_movieTimescale, 1000000);
+            break;
+        case MP4_FOURCC('t', 'k', 'h', 'd'):
+            if (track && size >= (version == 1 ? 96 : 84)) {
+                int base = (version == 1) ? 36 : 24;
+                track->info.trackId = MP4ReadU32(p + (version == 1 ? 20 : 12));
+                track->info.width = MP4ReadU32(p + base + 52) >> 16;
+                track->info.height = MP4ReadU32(p + base + 56) >> 16;
+            }
+            break;
+        case MP4_FOURCC('m', 'd', 'h', 'd'):
+            if (track && size >= (version == 1 ? 34 : 22)) {
+                int base = (version == 1) ? 20 : 12;
+                uint32_t language;
+                track->info.timescale = MP4ReadU32(p + base);
+                track->info.duration = (version == 1) ? (int64_t)MP4ReadU64(p + base + 4) : MP4ReadU32(p + base + 4);
+                language = MP4ReadU16(p + base + (version == 1 ? 12 : 8));
+                track->info.language[0] = ((language >> 10) & 0x1F) + 0x60;
+                track->info.language[1] = ((language >> 5) & 0x1F) + 0x60;
+                track->info.language[2] = (language & 0x1F) + 0x60;
+                track->info.language[3] = 0;
+            }
+            break;
+        case MP4_FOURCC('h', 'd', 'l', 'r'):
+            if (track && size >= 12) {
+                switch (MP4ReadU32(p + 8)) {
+                    case MP4_FOURCC('v', 'i', 'd', 'e'): track->info.type = MP4Track_Video; break;
+                    case MP4_FOURCC('s', 'o', 'u', 'n'): track->info.type = MP4Track_Audio; break;
+                    case MP4_FOURCC('s', 'u', 'b', 't'):
+                    case MP4_FOURCC('s', 'b', 't', 'l'):
+                    case MP4_FOURCC('t', 'e', 'x', 't'): track->info.type = MP4Track_Subtitle; break;
+                    default: break;     //QuickTime 的 minf/hdlr 为 'alis' 等，不覆盖 mdia/hdlr 的结果
+                }
+            }
+            break;
+        case MP4_FOURCC('s', 't', 's', 'd'):
+            if (track && size >= 16 && !track->hasStsd) { //只使用第一个 sample entry
+                uint32_t entrySize = MP4ReadU32(p + 8);
+                if (entrySize >= 8 && entrySize <= size - 8)
+                    return parseSampleDescription(track, p + 8, entrySize);
+            }
+            break;
+        case MP4_FOURCC('e', 'l', 's', 't'):
+            if (track && size >= 8) {
+                uint32_t count = MP4ReadU32(p + 4);
+                int entry = (version == 1) ? 20 : 12;
+                for (uint32_t i = 0; i < count && 8 + (int64_t)(i + 1) * entry <= size; i++) {
+                    const uint8_t* e = p + 8 + i * entry;
+                    int64_t mediaTime = (version == 1) ? (int64_t)MP4ReadU64(e + 8) : (int32_t)MP4ReadU32(e + 4);
+                    if (mediaTime >= 0) { //-1 为空 edit，使用下一个
+                        track->editOffset = mediaTime;
+                        break;
+                    }
+                }
+            }
+            break;
+        case MP4_FOURCC('t', 'r', 'e', 'x'):
+            if (size >= 24) {
+                m_trex.push_back(MP4ReadU32(p + 4));
+                m_trex.push_back(MP4ReadU32(p + 12));
+                m_trex.push_back(MP4ReadU32(p + 16));
+                m_trex.push_back(MP4ReadU32(p + 20));
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+
+int MP4Parser::parseSampleDescription(MP4TrackContext* track, const uint8_t* data, int size)
+{
+    int childOffset = 0;
+
+    track->hasStsd = true;
+    track->info.codec = MP4ReadU32(data + 4);
+    data += 8;      //sample entry 头
+    size -= 8;
+    if (track->info.type == MP4Track_Video && size >= 78) {
+        track->info.width = MP4ReadU16(data + 24);
+        track->info.height = MP4ReadU16(data + 26);
+        childOffset = 78;
+    } else if (track->info.type == MP4Track_Audio && size >= 28) {
+        int version = MP4ReadU16(data + 8);   //QuickTime sound description 版本
+        track->info.channels = MP4ReadU16(data + 16);
+        track->info.sampleRate = MP4ReadU32(data + 24) >> 16;
+        childOffset = 28;
+        if (version == 1)
+            childOffset += 16;
+        else if (version == 2 && size >= 64) {
+            uint64_t bits = MP4ReadU64(data + 32);
+            double rate;
+            memcpy(&rate, &bits, sizeof(rate));
+            track->info.sampleRate = (int)rate;
+            track->info.channels = MP4ReadU32(data + 40);
+            childOffset += 36;
+        }
+    }
+    if (childOffset > 0 && childOffset < size)
+        parseCodecBoxes(track, data + childOffset, size - childOffset, 0);
+    return 0;
+}
+
+
+void MP4Parser::parseCodecBoxes(MP4TrackContext* track, const uint8_t* data, int size, int depth)
+{
+    while (size >= 8 && depth < 2) {
+        uint32_t boxSize = MP4ReadU32(data);
+        uint32_t type = MP4ReadU32(data + 4);
+
+        if (boxSize < 8 || boxSize > (uint32_t)size)
+            break;
+        switch (type) {
+            case MP4_FOURCC('a', 'v', 'c', 'C'):
+            case MP4_FOURCC('h', 'v', 'c', 'C'):
+            case MP4_FOURCC('d', 'a', 'c', '3'):
+            case MP4_FOURCC('d', 'e', 'c', '3'):
+            case MP4_FOURCC('d', 'O', 'p', 's'):
+                track->codecConfig.assign(data + 8, data + boxSize);
+                break;
+            case MP4_FOURCC('e', 's', 'd', 's'):
+                if (boxSize > 12)
+                    parseEsds(track, data + 12, boxSize - 12);
+                break;
+            case MP4_FOURCC('w', 'a', 'v', 'e'):   //QuickTime 把 esds 放在 wave 中
+                parseCodecBoxes(track, data + 8, boxSize - 8, depth + 1);
+                break;
+            default:
+                break;
+        }
+        data += boxSize;
+        size -= boxSize;
+    }
+}
+
+
+/* ES_Descriptor(3) -> DecoderConfigDescriptor(4) -> DecoderSpecificInfo(5) */
+void MP4Parser::parseEsds(MP4TrackContext* track, const uint8_t* data, int size)
+{
+    while (size >= 2) {
+        int tag = data[0];
+        int length = 0;
+        int i = 1;
+
+        do {
+            length = (length << 7) | (data[i] & 0x7F);
+        } while ((data[i++] & 0x80) && i < 5 && i < size);
+        data += i;
+        size -= i;
+        if (length > size)
+            length = size;
+
+        if (tag == 3) {
+            int skip = 3;
+            if (length < 3)
+                return;
+            if (data[2] & 0x80)
+                skip += 2;
+            if (data[2] & 0x40)
+                skip += (length > skip) ? 1 + data[skip] : 0;
+            if (data[2] & 0x20)
+                skip += 2;
+            if (skip > length)
+                return;
+            data += skip;
+            size = length - skip;
+        } else if (tag == 4) {
+            if (length < 13)
+                return;
+            data += 13;
+            size = length - 13;
+        } else if (tag == 5) {
+            track->codecConfig.assign(data, data + length);
+            return;
+        } else {
+            data += length;
+            size -= length;
+        }
+    }
+}
+
+
+bool MP4Parser::finishTrack(MP4TrackContext* track)
+{
+    if (track->info.type == MP4Track_Unknown || track->info.timescale == 0 || !track->hasStsd)
+        return false;
+    if (track->info.sampleCount > 0 && (track->stts.count == 0 || track->stsc.count == 0 || track->stco.count == 0)) {
+        playerLogWarning("track %d: incomplete sample table.\n", track->info.trackId);
+        return false;
+    }
+    track->info.codecConfig = track->codecConfig.empty() ? NULL : &track->codecConfig[0];
+    track->info.codecConfigSize = track->codecConfig.size();
+    return true;
+}
+
+
+const MP4TrackInfo* MP4Parser::getTrack(int track)
+{
+    if (track < 0 || track >= (int)m_tracks.size())
+        return NULL;
+    return &m_tracks[track]->info;
+}
+
+
+int MP4Parser::setTrackEnabled(int track, bool enabled)
+{
+    if (track < 0 || track >= (int)m_tracks.size())
+        return -1;
+    m_tracks[track]->enabled = enabled;
+    return 0;
+}
+
+
+uint32_t MP4Parser::sampleSize(MP4TrackContext* track, uint32_t sample)
+{
+    if (track->constantSize)
+        return track->constantSize;
+    return readU32(track->stsz.offset + (int64_t)sample * 4);
+}
+
+
+uint64_t MP4Parser::chunkOffset(MP4TrackContext* track, uint32_t chunk)
+{
+    const uint8_t* p;
+
+    if (chunk >= track->stco.count)
+        return 0;
+    if (track->stco.entrySize == 4)
+        return readU32(track->stco.offset + (int64_t)chunk * 4);
+    p = readCached(track->stco.offset + (int64_t)chunk * 8, 8);
+    return p ? MP4ReadU64(p) : 0;
+}
+
+
+void MP4Parser::loadSttsRun(MP4TrackContext* track)
+{
+    while (track->sttsIndex < track->stts.count) {
+        int64_t entry = track->stts.offset + (int64_t)track->sttsIndex * 8;
+        track->sttsRemaining = readU32(entry);
+        track->sttsDelta = readU32(entry + 4);
+        if (track->sttsRemaining > 0)
+            return;
+        track->sttsIndex++;
+    }
+    track->sttsRemaining = 0xFFFFFFFF;  //stts 比 stsz 短时沿用最后的 delta
+}
+
+
+void MP4Parser::loadCttsRun(MP4TrackContext* track)
+{
+    while (track->cttsIndex < track->ctts.count) {
+        int64_t entry = track->ctts.offset + (int64_t)track->cttsIndex * 8;
+        track->cttsRemaining = readU32(entry);
+        track->cttsOffset = (int32_t)readU32(entry + 4);    //version 0 也按有符号处理
+        if (track->cttsRemaining > 0)
+            return;
+        track->cttsIndex++;
+    }
+    track->cttsRemaining = 0xFFFFFFFF;
+    track->cttsOffset = 0;
+}
+
+
+/* 第一次 seek 时扫描一遍 stts/ctts，之后定位只需二分查找加最多 MP4_CHECKPOINT_INTERVAL 个 run */
+void MP4Parser::buildCheckpoints(MP4TrackContext* track)
+{
+    MP4Checkpoint checkpoint;
+    uint32_t run;
+
+    if (track->checkpointsBuilt)
+        return;
+    track->checkpointsBuilt = true;
+
+    checkpoint.sample = 0;
+    checkpoint.time = 0;
+    for (run = 0; run < track->stts.count; run++) {
+        int64_t entry = track->stts.offset + (int64_t)run * 8;
+        uint32_t count = readU32(entry);
+        if (run % MP4_CHECKPOINT_INTERVAL == 0) {
+            checkpoint.run = run;
+            track->sttsCheckpoints.push_back(checkpoint);
+        }
+        checkpoint.sample += count;
+        checkpoint.time += (int64_t)count * readU32(entry + 4);
+    }
+
+    checkpoint.sample = 0;
+    checkpoint.time = 0;
+    for (run = 0; run < track->ctts.count; run++) {
+        if (run % MP4_CHECKPOINT_INTERVAL == 0) {
+            checkpoint.run = run;
+            track->cttsCheckpoints.push_back(checkpoint);
+        }
+        checkpoint.sample += readU32(track->ctts.offset + (int64_t)run * 8);
+    }
+}
+
+
+/* 把游标移动到 sample，sample 大于 0 时需要检查点 */
+void MP4Parser::positionCursor(MP4TrackContext* track, uint32_t sample)
+{
+    uint32_t run, runSample, index, chunkBase;
+    int64_t runTime;
+    uint64_t sampleBase;
+    int low, high;
+
+    if (sample > 0)
+        buildCheckpoints(track);
+    track->sample = sample;
+    if (sample >= track->info.sampleCount)
+        return;
+
+    //stts
+    run = runSample = 0;
+    runTime = 0;
+    low = 0;
+    high = (int)track->sttsCheckpoints.size() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (track->sttsCheckpoints[middle].sample <= sample) {
+            run = track->sttsCheckpoints[middle].run;
+            runSample = track->sttsCheckpoints[middle].sample;
+            runTime = track->sttsCheckpoints[middle].time;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    track->sttsIndex = run;
+    for (;;) {
+        loadSttsRun(track);
+        if (track->sttsIndex >= track->stts.count || sample - runSample < track->sttsRemaining)
+            break;
+        runSample += track->sttsRemaining;
+        runTime += (int64_t)track->sttsRemaining * track->sttsDelta;
+        track->sttsIndex++;
+    }
+    track->sttsRemaining -= sample - runSample;
+    track->dts = runTime + (int64_t)(sample - runSample) * track->sttsDelta;
+
+    //ctts
+    run = runSample = 0;
+    low = 0;
+    high = (int)track->cttsCheckpoints.size() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (track->cttsCheckpoints[middle].sample <= sample) {
+            run = track->cttsCheckpoints[middle].run;
+            runSample = track->cttsCheckpoints[middle].sample;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    track->cttsIndex = run;
+    for (;;) {
+        loadCttsRun(track);
+        if (track->cttsIndex >= track->ctts.count || sample - runSample < track->cttsRemaining)
+            break;
+        runSample += track->cttsRemaining;
+        track->cttsIndex++;
+    }
+    track->cttsRemaining -= sample - runSample;
+
+    //stsc：entry 数通常很少，直接顺序查找
+    sampleBase = 0;
+    track->samplesPerChunk = 1;
+    track->chunk = 0;
+    track->sampleInChunk = 0;
+    for (index = 0; index < track->stsc.count; index++) {
+        int64_t entry = track->stsc.offset + (int64_t)index * 12;
+        uint32_t nextChunk = (index + 1 < track->stsc.count) ? readU32(entry + 12) - 1 : track->stco.count;
+        uint64_t samples;
+
+        chunkBase = readU32(entry) - 1;
+        track->samplesPerChunk = readU32(entry + 4);
+        if (track->samplesPerChunk == 0 || nextChunk < chunkBase)
+            continue;
+        samples = (uint64_t)(nextChunk - chunkBase) * track->samplesPerChunk;
+        if (sample < sampleBase + samples || index + 1 == track->stsc.count) {
+            track->chunk = chunkBase + (uint32_t)((sample - sampleBase) / track->samplesPerChunk);
+            track->sampleInChunk = (uint32_t)((sample - sampleBase) % track->samplesPerChunk);
+            break;
+        }
+        sampleBase += samples;
+    }
+    track->stscIndex = (index < track->stsc.count) ? index : track->stsc.count - 1;
+    track->offsetInChunk = 0;
+    if (track->constantSize) {
+        track->offsetInChunk = (int64_t)track->sampleInChunk * track->constantSize;
+    } else {
+        for (uint32_t i = sample - track->sampleInChunk; i < sample; i++)
+            track->offsetInChunk += readU32(track->stsz.offset + (int64_t)i * 4);
+    }
+
+    //stss：第一个不小于 sample + 1 的 entry
+    low = 0;
+    high = track->stss.count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (readU32(track->stss.offset + (int64_t)middle * 4) < sample + 1)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    track->stssIndex = low;
+}
+
+
+int MP4Parser::peekTableSample(MP4TrackContext* track, MP4Sample* sample)
+{
+    uint32_t index = track->sample;
+
+    if (index >= track->info.sampleCount)
+        return 1;
+    sample->offset = chunkOffset(track, track->chunk) + track->offsetInChunk;
+    sample->size = sampleSize(track, index);
+    sample->dts = track->dts - track->editOffset;
+    sample->pts = sample->dts + track->cttsOffset;
+    if (track->stss.count == 0)
+        sample->isKeyframe = 1;
+    else
+        sample->isKeyframe = track->stssIndex < track->stss.count
+                && readU32(track->stss.offset + (int64_t)track->stssIndex * 4) == index + 1;
+    return 0;
+}
+
+
+void MP4Parser::advanceTableSample(MP4TrackContext* track)
+{
+    track->offsetInChunk += sampleSize(track, track->sample);
+    track->sample++;
+
+    if (++track->sampleInChunk >= track->samplesPerChunk) {
+        track->chunk++;
+        track->sampleInChunk = 0;
+        track->offsetInChunk = 0;
+        while (track->stscIndex + 1 < track->stsc.count) {
+            int64_t next = track->stsc.offset + (int64_t)(track->stscIndex + 1) * 12;
+            if (track->chunk + 1 < readU32(next))
+                break;
+            track->stscIndex++;
+            track->samplesPerChunk = readU32(next + 4);
+        }
+    }
+
+    track->dts += track->sttsDelta;
+    if (--track->sttsRemaining == 0) {
+        track->sttsIndex++;
+        loadSttsRun(track);
+    }
+    if (track->ctts.count > 0 && --track->cttsRemaining == 0) {
+        track->cttsIndex++;
+        loadCttsRun(track);
+    }
+    while (track->stssIndex < track->stss.count
+            && readU32(track->stss.offset + (int64_t)track->stssIndex * 4) < track->sample + 1)
+        track->stssIndex++;
+}
+
+
+int MP4Parser::peekSample(MP4TrackContext* track, MP4Sample* sample)
+{
+    if (peekTableSample(track, sample) != 0) {
+        if (track->fragmentSamples.empty())
+            return 1;
+        const MP4FragmentSample& fragment = track->fragmentSamples.front();
+        sample->offset = fragment.offset;
+        sample->size = fragment.size;
+        sample->isKeyframe = fragment.isKeyframe;
+        sample->dts = fragment.dts - track->editOffset;
+        sample->pts = sample->dts + fragment.ctsOffset;
+    }
+    sample->dtsUs = MP4Rescale(sample->dts, track->info.timescale, 1000000);
+    sample->ptsUs = MP4Rescale(sample->pts, track->info.timescale, 1000000);
+    return 0;
+}
+
+
+void MP4Parser::advanceSample(MP4TrackContext* track)
+{
+    if (track->sample < track->info.sampleCount)
+        advanceTableSample(track);
+    else if (!track->fragmentSamples.empty())
+        track->fragmentSamples.pop_front();
+}
+
+
+int MP4Parser::readSample(MP4Sample* sample)
+{
+    if (m_tracks.empty())
+        return -1;
+
+    for (;;) {
+        MP4Sample candidate;
+        int best = -1;
+        bool needFragment = false;
+        size_t buffered = 0;
+        size_t i;
+
+        for (i = 0; i < m_tracks.size(); i++)
+            buffered += m_tracks[i]->fragmentSamples.size();
+        for (i = 0; i < m_tracks.size(); i++) {
+            MP4TrackContext* track = m_tracks[i];
+            if (!track->enabled)
+                continue;
+            if (peekSample(track, &candidate) == 0) {
+                if (best < 0 || candidate.dtsUs < sample->dtsUs) {
+                    *sample = candidate;
+                    best = i;
+                }
+            } else if (track->fragmentSeen && buffered < MP4_FRAGMENT_SAMPLES_MAX) {
+                needFragment = true;    //该 track 的下一个 sample 可能在下一个 fragment 中
+            }
+        }
+        if ((best < 0 || needFragment) && m_nextFragment >= 0) {
+            if (loadFragment() < 0)
+                return -1;
+            continue;
+        }
+        if (best < 0)
+            return 1;
+        sample->track = best;
+        advanceSample(m_tracks[best]);
+        return 0;
+    }
+}
+
+
+int MP4Parser::readSampleData(const MP4Sample* sample, uint8_t* buffer, int size)
+{
+    if (size > sample->size)
+        size = sample->size;
+    return readSource(sample->offset, buffer, size);
+}
+
+
+uint32_t MP4Parser::sampleAtTime(MP4TrackContext* track, int64_t time)
+{
+    uint32_t run = 0;
+    uint32_t runSample = 0;
+    int64_t runTime = 0;
+    int low = 0;
+    int high = (int)track->sttsCheckpoints.size() - 1;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (track->sttsCheckpoints[middle].time <= time) {
+            run = track->sttsCheckpoints[middle].run;
+            runSample = track->sttsCheckpoints[middle].sample;
+            runTime = track->sttsCheckpoints[middle].time;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    for (; run < track->stts.count; run++) {
+        int64_t entry = track->stts.offset + (int64_t)run * 8;
+        uint32_t count = readU32(entry);
+        uint32_t delta = readU32(entry + 4);
+        if (count > 0 && time < runTime + (int64_t)count * delta) {
+            runSample += (delta > 0) ? (uint32_t)((time - runTime) / delta) : 0;
+            break;
+        }
+        runSample += count;
+        runTime += (int64_t)count * delta;
+    }
+    if (runSample >= track->info.sampleCount)
+        runSample = track->info.sampleCount - 1;
+    return runSample;
+}
+
+
+/* 返回定位到的 sample 的 DTS(us)，没有 sample 时返回 -1 */
+int64_t MP4Parser::seekTrackTable(MP4TrackContext* track, int64_t timeUs, bool keyframe)
+{
+    MP4Sample sample;
+    uint32_t index;
+
+    if (track->info.sampleCount == 0)
+        return -1;
+    buildCheckpoints(track);
+    index = sampleAtTime(track, MP4Rescale(timeUs > 0 ? timeUs : 0, 1000000, track->info.timescale) + track->editOffset);
+
+    if (keyframe && track->stss.count > 0) { //最后一个不大于 index + 1 的同步 sample
+        int low = 0;
+        int high = track->stss.count - 1;
+        uint32_t sync = readU32(track->stss.offset);
+        while (low <= high) {
+            int middle = (low + high) / 2;
+            uint32_t value = readU32(track->stss.offset + (int64_t)middle * 4);
+            if (value <= index + 1) {
+                sync = value;
+                low = middle + 1;
+            } else {
+                high = middle - 1;
+            }
+        }
+        if (sync > 0 && sync <= track->info.sampleCount)
+            index = sync - 1;
+    }
+    positionCursor(track, index);
+    track->fragmentSamples.clear();
+    peekTableSample(track, &sample);
+    return MP4Rescale(sample.dts, track->info.timescale, 1000000);
+}
+
+
+int MP4Parser::seek(int64_t timeUs)
+{
+    MP4TrackContext* reference = NULL;
+    int64_t keyUs = timeUs;
+    bool tables = false;
+    size_t i;
+
+    for (i = 0; i < m_tracks.size(); i++) {
+        if (m_tracks[i]->info.sampleCount > 0)
+            tables = true;
+        if (reference == NULL && m_tracks[i]->enabled && m_tracks[i]->info.type == MP4Track_Video)
+            reference = m_tracks[i];
+    }
+    if (!tables)
+        return seekFragments(timeUs);
+
+    if (reference && reference->info.sampleCount > 0)
+        keyUs = seekTrackTable(reference, timeUs, true);    //有 edit list 时可能为负
+    for (i = 0; i < m_tracks.size(); i++) {
+        if (m_tracks[i] != reference)
+            seekTrackTable(m_tracks[i], keyUs, m_tracks[i]->info.type == MP4Track_Video);
+    }
+    return 0;
+}
+
+
+/* 从 offset 开始查找下一个 moof，跳过 mdat 等，没有时返回 1 */
+int MP4Parser::findNextFragment(int64_t offset, int64_t* moofOffset, int64_t* moofSize)
+{
+    uint8_t header[16];
+
+    for (;;) {
+        int length = readCachedRange(offset, header, 16);
+        uint64_t size;
+
+        if (length < 8)
+            return 1;
+        size = MP4ReadU32(header);
+        if (size == 1) {
+            if (length < 16)
+                return 1;
+            size = MP4ReadU64(header + 8);
+        } else if (size == 0) {
+            return 1;
+        }
+        if (size < 8)
+            return -1;
+        if (MP4ReadU32(header + 4) == MP4_FOURCC('m', 'o', 'o', 'f')) {
+            *moofOffset = offset;
+            *moofSize = size;
+            return 0;
+        }
+        offset += size;
+    }
+}
+
+
+int MP4Parser::loadFragment()
+{
+    std::vector<uint8_t> moof;
+    int64_t moofOffset, moofSize;
+    int64_t firstDtsUs = -1;
+    const uint8_t* p;
+    int size, ret;
+
+    ret = findNextFragment(m_nextFragment, &moofOffset, &moofSize);
+    if (ret != 0) {
+        m_nextFragment = -1;
+        return (ret < 0) ? -1 : 0;
+    }
+    m_nextFragment = moofOffset + moofSize;
+    if (moofSize > MP4_LEAF_BOX_SIZE_MAX * 16) {
+        playerLogError("moof too large: %lld.\n", (long long)moofSize);
+        return -1;
+    }
+    moof.resize(moofSize);
+    if (readSource(moofOffset, &moof[0], moofSize) != moofSize)
+        return -1;
+
+    p = &moof[8];
+    size = moofSize - 8;
+    while (size >= 8) {
+        uint32_t boxSize = MP4ReadU32(p);
+        if (boxSize < 8 || boxSize > (uint32_t)size)
+            break;
+        if (MP4ReadU32(p + 4) == MP4_FOURCC('t', 'r', 'a', 'f'))
+            parseTraf(p + 8, boxSize - 8, moofOffset, &firstDtsUs);
+        p += boxSize;
+        size -= boxSize;
+    }
+    if (firstDtsUs >= 0 && (m_fragmentIndex.empty() || m_fragmentIndex.back().moofOffset < moofOffset)) {
+        FragmentIndex index;
+        index.moofOffset = moofOffset;
+        index.moofSize = moofSize;
+        index.dtsUs = firstDtsUs;
+        m_fragmentIndex.push_back(index);
+    }
+    return 0;
+}
+
+
+int MP4Parser::parseTraf(const uint8_t* data, int size, int64_t moofOffset, int64_t* firstDtsUs)
+{
+    MP4TrackContext* track = NULL;
+    uint32_t defaultDuration = 0, defaultSize = 0, defaultFlags = 0;
+    int64_t base = moofOffset;
+    int64_t dataEnd = -1;
+    const uint8_t* p;
+    int left;
+
+    //tfhd 在 traf 的第一个，tfdt 在 trun 之前
+    for (p = data, left = size; left >= 8; ) {
+        uint32_t boxSize = MP4ReadU32(p);
+        uint32_t type = MP4ReadU32(p + 4);
+        const uint8_t* box = p + 8;
+        int boxLength = boxSize - 8;
+
+        if (boxSize < 8 || boxSize > (uint32_t)left)
+            break;
+        if (type == MP4_FOURCC('t', 'f', 'h', 'd') && boxLength >= 8) {
+            uint32_t flags = MP4ReadU32(box) & 0xFFFFFF;
+            int trackId = MP4ReadU32(box + 4);
+            int offset = 8;
+            for (size_t i = 0; i < m_tracks.size(); i++) {
+                if (m_tracks[i]->info.trackId == trackId)
+                    track = m_tracks[i];
+            }
+            if (track == NULL)
+                return -1;
+            defaultDuration = track->trexDuration;
+            defaultSize = track->trexSize;
+            defaultFlags = track->trexFlags;
+            if ((flags & 0x01) && boxLength >= offset + 8) {
+                base = MP4ReadU64(box + offset);
+                offset += 8;
+            }
+            if (flags & 0x02)
+                offset += 4;
+            if ((flags & 0x08) && boxLength >= offset + 4) {
+                defaultDuration = MP4ReadU32(box + offset);
+                offset += 4;
+            }
+            if ((flags & 0x10) && boxLength >= offset + 4) {
+                defaultSize = MP4ReadU32(box + offset);
+                offset += 4;
+            }
+            if ((flags & 0x20) && boxLength >= offset + 4)
+                defaultFlags = MP4ReadU32(box + offset);
+            track->fragmentSeen = true;
+        } else if (type == MP4_FOURCC('t', 'f', 'd', 't') && track && boxLength >= 8) {
+            track->fragmentDts = (box[0] == 1 && boxLength >= 12) ? (int64_t)MP4ReadU64(box + 4) : MP4ReadU32(box + 4);
+        } else if (type == MP4_FOURCC('t', 'r', 'u', 'n') && track && boxLength >= 8) {
+            uint32_t flags = MP4ReadU32(box) & 0xFFFFFF;
+            uint32_t count = MP4ReadU32(box + 4);
+            uint32_t firstFlags = defaultFlags;
+            int64_t offset;
+            int entry = 8;
+            int entrySize = ((flags & 0x100) ? 4 : 0) + ((flags & 0x200) ? 4 : 0) + ((flags & 0x400) ? 4 : 0) + ((flags & 0x800) ? 4 : 0);
+
+            offset = (dataEnd >= 0) ? dataEnd : base;
+            if ((flags & 0x01) && boxLength >= entry + 4) {
+                offset = base + (int32_t)MP4ReadU32(box + entry);
+                entry += 4;
+            }
+            if ((flags & 0x04) && boxLength >= entry + 4) {
+                firstFlags = MP4ReadU32(box + entry);
+                entry += 4;
+            }
+            if (entrySize > 0 && count > (uint32_t)(boxLength - entry) / entrySize)
+                count = (boxLength - entry) / entrySize;
+            for (uint32_t i = 0; i < count; i++) {
+                MP4FragmentSample sample;
+                uint32_t duration = defaultDuration;
+                uint32_t sampleFlags = (i == 0) ? firstFlags : defaultFlags;
+                const uint8_t* e = box + entry + i * entrySize;
+
+                sample.size = defaultSize;
+                sample.ctsOffset = 0;
+                if (flags & 0x100) { duration = MP4ReadU32(e); e += 4; }
+                if (flags & 0x200) { sample.size = MP4ReadU32(e); e += 4; }
+                if (flags & 0x400) { sampleFlags = MP4ReadU32(e); e += 4; }
+                if (flags & 0x800) sample.ctsOffset = (int32_t)MP4ReadU32(e);     //version 0 也按有符号处理
+                sample.offset = offset;
+                sample.dts = track->fragmentDts;
+                sample.isKeyframe = (track->info.type != MP4Track_Video) || !(sampleFlags & 0x10000);  //sample_is_non_sync_sample
+                offset += sample.size;
+                track->fragmentDts += duration;
+                track->fragmentSamples.push_back(sample);
+
+                if (i == 0) {
+                    int64_t dtsUs = MP4Rescale(sample.dts - track->editOffset, track->info.timescale, 1000000);
+                    if (*firstDtsUs < 0 || dtsUs < *firstDtsUs)
+                        *firstDtsUs = dtsUs;
+                }
+            }
+            dataEnd = offset;
+        }
+        p += boxSize;
+        left -= boxSize;
+    }
+    return 0;
+}
+
+
+/* fragment 的索引在顺序加载时建立，seek 到还没加载过的位置时向后扫描 moof(不读 mdat) */
+int MP4Parser::seekFragments(int64_t timeUs)
+{
+    MP4TrackContext* reference = NULL;
+    int64_t keyUs = timeUs;
+    size_t i;
+    int low, high, found;
+
+    if (m_fragmentIndex.empty() && m_nextFragment >= 0 && loadFragment() < 0)
+        return -1;
+    while (!m_fragmentIndex.empty() && m_fragmentIndex.back().dtsUs < timeUs) {
+        size_t count = m_fragmentIndex.size();
+        for (i = 0; i < m_tracks.size(); i++)
+            m_tracks[i]->fragmentSamples.clear();
+        m_nextFragment = m_fragmentIndex.back().moofOffset + m_fragmentIndex.back().moofSize;
+        if (loadFragment() < 0)
+            return -1;
+        if (m_fragmentIndex.size() == count)
+            break;
+    }
+    if (m_fragmentIndex.empty())
+        return -1;
+
+    found = 0;
+    low = 0;
+    high = (int)m_fragmentIndex.size() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (m_fragmentIndex[middle].dtsUs <= timeUs) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    //同时加载前一个 fragment：edit list 或交织方式不同时，其他 track 对齐的 sample 可能在前一个 fragment 中
+    if (found > 0)
+        found--;
+    for (i = 0; i < m_tracks.size(); i++) {
+        MP4TrackContext* track = m_tracks[i];
+        track->fragmentSamples.clear();
+        track->fragmentDts = MP4Rescale(m_fragmentIndex[found].dtsUs, 1000000, track->info.timescale) + track->editOffset;
+        if (reference == NULL && track->enabled && track->info.type == MP4Track_Video)
+            reference = track;
+    }
+    m_nextFragment = m_fragmentIndex[found].moofOffset;
+    if (loadFragment() < 0 || (m_nextFragment >= 0 && loadFragment() < 0))
+        return -1;
+
+    //参考 track 丢弃 timeUs 之前最近的关键帧之前的 sample，其他 track 对齐到该关键帧
+    if (reference) {
+        std::deque<MP4FragmentSample>& samples = reference->fragmentSamples;
+        size_t key = samples.size();
+        for (i = 0; i < samples.size(); i++) {
+            int64_t dtsUs = MP4Rescale(samples[i].dts - reference->editOffset, reference->info.timescale, 1000000);
+            if (samples[i].isKeyframe && (dtsUs <= timeUs || key == samples.size()))
+                key = i;
+            if (dtsUs > timeUs)
+                break;
+        }
+        if (key < samples.size()) {
+            samples.erase(samples.begin(), samples.begin() + key);
+            keyUs = MP4Rescale(samples[0].dts - reference->editOffset, reference->info.timescale, 1000000);
+        }
+    }
+    for (i = 0; i < m_tracks.size(); i++) {
+        MP4TrackContext* track = m_tracks[i];
+        if (track == reference)
+            continue;
+        while (track->fragmentSamples.size() > 1
+                && MP4Rescale(track->fragmentSamples[1].dts - track->editOffset, track->info.timescale, 1000000) <= keyUs)
+            track->fragmentSamples.pop_front();
+    }
+    return 0;
+}
+
+
+const MP4ParserStatistics& MP4Parser::getStatistics()
+{
+    size_t memory = m_pages.size() * (sizeof(Page) + MP4_PAGE_SIZE) + m_fragmentIndex.size() * sizeof(FragmentIndex);
+
+    for (size_t i = 0; i < m_tracks.size(); i++) {
+        MP4TrackContext* track = m_tracks[i];
+        memory += sizeof(MP4TrackContext) + track->codecConfig.size();
+        memory += (track->sttsCheckpoints.size() + track->cttsCheckpoints.size()) * sizeof(MP4Checkpoint);
+        memory += track->fragmentSamples.size() * sizeof(MP4FragmentSample);
+    }
+    m_statistics.tableMemory = memory;
+    return m_statistics;
+}
@@ -1 +1,166 @@
- 
\ No newline at end of file
+#ifndef __MP4_PARSER_H__
+#define __MP4_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+
+#define     MP4_FOURCC(a, b, c, d)      (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+#define     MP4_PAGE_SIZE               4096
+#define     MP4_PAGE_CACHE_COUNT        64          //sample table 的页缓存，共 256KB
+#define     MP4_CHECKPOINT_INTERVAL     64          //stts/ctts 每 64 个 run 记录一个检查点
+#define     MP4_BOX_DEPTH_MAX           16
+#define     MP4_TRACK_MAX               16
+#define     MP4_FRAGMENT_SAMPLES_MAX    8192        //预读 fragment 时缓存的 sample 上限
+#define     MP4_LEAF_BOX_SIZE_MAX       (1024 * 1024)
+
+
+typedef enum {
+    MP4Track_Unknown = 0,
+    MP4Track_Video,
+    MP4Track_Audio,
+    MP4Track_Subtitle
+} MP4TrackType;
+
+
+/* 数据来源：本地文件或 HTTP Range 请求，所有读取都经过 read */
+typedef struct _MP4ByteSource {
+    int     (*read)(void* opaque, int64_t offset, uint8_t* buffer, int size);     //返回读到的字节数，出错返回 -1
+    int64_t size;           //文件大小，未知时为 -1
+    void*   opaque;
+} MP4ByteSource;
+
+int MP4ByteSourceOpenFile(MP4ByteSource* source, const char* path);
+void MP4ByteSourceCloseFile(MP4ByteSource* source);
+
+
+typedef struct _MP4TrackInfo {
+    int             trackId;
+    int             type;               //MP4TrackType
+    uint32_t        codec;              //stsd 中的格式，如 'avc1' 'hvc1' 'mp4a'
+    uint32_t        timescale;
+    int64_t         duration;           //timescale 为单位
+    uint32_t        sampleCount;        //moov 中的 sample 数，不含 fragment
+    int             width;
+    int             height;
+    int             channels;
+    int             sampleRate;
+    char            language[4];
+    const uint8_t*  codecConfig;        //avcC / hvcC / esds 中的 DecoderSpecificInfo
+    int             codecConfigSize;
+} MP4TrackInfo;
+
+typedef struct _MP4Sample {
+    int             track;              //track 下标
+    int64_t         offset;             //数据在文件中的位置
+    int             size;
+    int64_t         dts;                //track timescale
+    int64_t         pts;
+    int64_t         dtsUs;
+    int64_t         ptsUs;
+    int             isKeyframe;
+} MP4Sample;
+
+typedef struct _MP4ParserStatistics {
+    int64_t         openBytes;          //open() 读取的字节数
+    int             openReads;          //open() 调用 read 的次数
+    int64_t         readBytes;
+    int             readCalls;
+    int             tableMemory;        //页缓存 + 检查点 + fragment 中的 sample 占用的内存
+} MP4ParserStatistics;
+
+
+struct MP4TrackContext;
+
+class MP4Parser { /* ISO-BMFF / MOV 解复用，sample table 不展开，按需分页读取 */
+    public:
+        MP4Parser();
+        ~MP4Parser();
+
+        int open(const MP4ByteSource& source);          //moov 在文件末尾时只读取各个顶层 box 的头
+        void close();
+
+        int getTrackCount() { return m_tracks.size(); }
+        const MP4TrackInfo* getTrack(int track);
+        int setTrackEnabled(int track, bool enabled);
+        int64_t getDurationUs() { return m_durationUs; }
+        bool isFragmented() { return m_fragmented; }
+
+        int readSample(MP4Sample* sample);              //按 DTS 顺序返回下一个 sample 的信息，结束时返回 1
+        int readSampleData(const MP4Sample* sample, uint8_t* buffer, int size);
+        int seek(int64_t timeUs);                       //视频定位到 timeUs 之前最近的关键帧，其他 track 对齐到该时间
+
+        const MP4ParserStatistics& getStatistics();
+
+    private:
+        int readSource(int64_t offset, uint8_t* buffer, int size);
+        int getPage(int64_t base);
+        const uint8_t* readCached(int64_t offset, int size);
+        int readCachedRange(int64_t offset, uint8_t* buffer, int size);
+        uint32_t readU32(int64_t offset);
+
+        int parseBoxes(int64_t offset, int64_t end, int depth, MP4TrackContext* track);
+        int parseLeaf(uint32_t type, int64_t offset, int64_t size, MP4TrackContext* track);
+        int parseSampleDescription(MP4TrackContext* track, const uint8_t* data, int size);
+        void parseCodecBoxes(MP4TrackContext* track, const uint8_t* data, int size, int depth);
+        void parseEsds(MP4TrackContext* track, const uint8_t* data, int size);
+        bool finishTrack(MP4TrackContext* track);
+
+        int peekSample(MP4TrackContext* track, MP4Sample* sample);
+        void advanceSample(MP4TrackContext* track);
+        int peekTableSample(MP4TrackContext* track, MP4Sample* sample);
+        void advanceTableSample(MP4TrackContext* track);
+        void loadSttsRun(MP4TrackContext* track);
+        void loadCttsRun(MP4TrackContext* track);
+        void buildCheckpoints(MP4TrackContext* track);
+        void positionCursor(MP4TrackContext* track, uint32_t sample);
+        uint32_t sampleAtTime(MP4TrackContext* track, int64_t time);
+        int64_t seekTrackTable(MP4TrackContext* track, int64_t timeUs, bool keyframe);
+        uint32_t sampleSize(MP4TrackContext* track, uint32_t sample);
+        uint64_t chunkOffset(MP4TrackContext* track, uint32_t chunk);
+
+        int findNextFragment(int64_t offset, int64_t* moofOffset, int64_t* moofSize);
+        int loadFragment();
+        int parseTraf(const uint8_t* data, int size, int64_t moofOffset, int64_t* firstDtsUs);
+        int seekFragments(int64_t timeUs);
+
+        struct FragmentIndex {
+            int64_t     moofOffset;
+            int64_t     moofSize;
+            int64_t     dtsUs;                  //该 fragment 中最早的 sample
+        };
+
+        MP4ByteSource                   m_source;
+        std::vector<MP4TrackContext*>   m_tracks;
+        std::vector<uint32_t>           m_trex;                 //mvex/trex：trackId, duration, size, flags
+        int64_t                         m_durationUs;
+        uint32_t                        m_movieTimescale;
+        bool                            m_fragmented;
+        int64_t                         m_nextFragment;         //下一个待查找的 moof 的位置，-1 表示结束
+        std::vector<FragmentIndex>      m_fragmentIndex;        //顺序加载时建立，seek 时二分查找
+
+        /* 页缓存 */
+        struct Page {
+            int64_t                 base;
+            int                     size;
+            uint32_t                lastUse;
+            std::vector<uint8_t>    data;
+        };
+        std::vector<Page>               m_pages;
+        std::map<int64_t, int>          m_pageMap;              //base -> m_pages 下标
+        int                             m_lastPage;
+        uint32_t                        m_useClock;
+        uint8_t                         m_scratch[64];          //跨页的读取
+        MP4ParserStatistics             m_statistics;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__MP4_PARSER_H__
@@ -0,0 +1,331 @@
+/**
+ *  RTPJitterBuffer.cpp文件
+ *  RTP 抖动缓冲；
+ *  主要有以下部分：
+ *      1. RTP 头解析：CSRC、扩展头、padding
+ *      2. 按展开回绕后的序号放入环形数组，重复、迟到的丢弃，SSRC 变化或序号跳变时重新开始
+ *      3. 播放时间：时间戳 + 最小传输延时 + 缓冲延时；最小传输延时按窗口重新统计以跟随时钟漂移，
+ *         缓冲延时为 RFC 3550 抖动估计的倍数，抖动变大时立即增加，变小时慢慢减少
+ *      4. 取出时到了后面 packet 的播放时间还缺的序号按丢包报告，由调用者隐藏
+ *
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "SettingsRegistry.h"
+#include "RTPJitterBuffer.h"
+
+
+#define     RTP_JITTER_DECAY            64          //抖动变小时延时每个 packet 减少差值的 1/64
+
+
+const int RTPJitterHistogramBounds[RTP_JITTER_HISTOGRAM_BUCKETS] = { 2, 5, 10, 20, 50, 100, 200, 0x7FFFFFFF };
+
+
+int RTPParseHeader(const uint8_t* data, int size, RTPHeader* header)
+{
+    int offset, padding = 0;
+
+    if (size < RTP_HEADER_SIZE || (data[0] >> 6) != 2)
+        return -1;
+    header->marker = data[1] >> 7;
+    header->payloadType = data[1] & 0x7F;
+    header->sequence = (data[2] << 8) | data[3];
+    header->timestamp = ((uint32_t)data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+    header->ssrc = ((uint32_t)data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+    offset = RTP_HEADER_SIZE + (data[0] & 0x0F) * 4;
+    if (data[0] & 0x10) {           //扩展头：16 位 profile，16 位长度(32 位字)
+        if (offset + 4 > size)
+            return -1;
+        offset += 4 + ((data[offset + 2] << 8) | data[offset + 3]) * 4;
+    }
+    if (data[0] & 0x20)
+        padding = data[size - 1];
+    if (offset + padding > size)
+        return -1;
+    header->headerSize = offset;
+    header->payloadSize = size - offset - padding;
+    return 0;
+}
+
+void RTPJitterConfigDefault(RTPJitterConfig* config)
+{
+    config->clockRate = RTP_CLOCK_RATE_DEFAULT;
+    config->minDelayUs = (int64_t)SETTINGS_GET_INT(RtpJitterMinDelayMs) * 1000;
+    config->maxDelayUs = (int64_t)SETTINGS_GET_INT(RtpJitterMaxDelayMs) * 1000;     //小于 minDelayUs 时在构造时调整
+    config->multiplier = RTP_JITTER_MULTIPLIER;
+    config->maxPackets = RTP_JITTER_PACKETS_MAX;
+}
+
+
+RTPJitterBuffer::RTPJitterBuffer(const RTPJitterConfig* config)
+    : m_started(false)
+    , m_buffered(0)
+{
+    if (config)
+        m_config = *config;
+    else
+        RTPJitterConfigDefault(&m_config);
+    //序号跨度要比重新开始的跳变大，否则正常的跳变会被当作溢出
+    while (m_config.maxPackets & (m_config.maxPackets - 1))
+        m_config.maxPackets &= m_config.maxPackets - 1;
+    m_config.maxPackets = std::max(m_config.maxPackets, 64);
+    if (m_config.clockRate <= 0)
+        m_config.clockRate = RTP_CLOCK_RATE_DEFAULT;
+    m_config.maxDelayUs = std::max(m_config.maxDelayUs, m_config.minDelayUs);
+
+    m_slots.resize(m_config.maxPackets, NULL);
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    reset();
+}
+
+RTPJitterBuffer::~RTPJitterBuffer()
+{
+    size_t i;
+
+    flush();
+    for (i = 0; i < m_free.size(); i++)
+        delete m_free[i];
+}
+
+void RTPJitterBuffer::reset()
+{
+    flush();
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+/* 丢弃缓冲中的 packet(重新开始时旧流还没有播放的部分也丢弃)，下一个 packet 重新开始计算序号和时间 */
+void RTPJitterBuffer::flush()
+{
+    size_t i;
+
+    for (i = 0; i < m_slots.size(); i++) {
+        if (m_slots[i]) {
+            release(m_slots[i]);
+            m_slots[i] = NULL;
+        }
+    }
+    m_buffered = 0;
+    m_started = false;
+    m_ssrc = 0;
+    m_nextSequence = m_highestSequence = 0;
+    m_lastTimestamp = 0;
+    m_timestampExt = 0;
+    m_baseTransitUs = m_windowMinUs = m_lastTransitUs = 0;
+    m_windowStartUs = 0;
+    m_lastPlayoutUs = 0;
+    m_jitterUs = 0;
+    m_delayUs = m_config.minDelayUs;
+}
+
+RTPPacket* RTPJitterBuffer::allocPacket()
+{
+    RTPPacket* packet;
+
+    if (m_free.empty())
+        return new RTPPacket;
+    packet = m_free.back();
+    m_free.pop_back();
+    return packet;
+}
+
+void RTPJitterBuffer::release(RTPPacket* packet)
+{
+    if (packet)
+        m_free.push_back(packet);
+}
+
+void RTPJitterBuffer::dropHead()
+{
+    RTPPacket*& head = m_slots[m_nextSequence & (m_config.maxPackets - 1)];
+
+    if (head && head->extSequence == m_nextSequence) {
+        release(head);
+        head = NULL;
+        m_buffered--;
+    }
+    m_nextSequence++;
+    m_statistics.overflows++;
+}
+
+int RTPJitterBuffer::histogramBucket(int64_t us)
+{
+    int bucket;
+
+    for (bucket = 0; bucket < RTP_JITTER_HISTOGRAM_BUCKETS - 1 && us > (int64_t)RTPJitterHistogramBounds[bucket] * 1000; bucket++);
+    return bucket;
+}
+
+/* 到达统计和播放时间；packet 的序号已经确定 */
+void RTPJitterBuffer::updateTiming(RTPPacket* packet)
+{
+    int64_t timestampExt, timestampUs, transit, target;
+    int32_t delta;
+
+    delta = (int32_t)(packet->header.timestamp - m_lastTimestamp);
+    timestampExt = m_timestampExt + delta;
+    timestampUs = timestampExt * 1000000 / m_config.clockRate;
+    transit = packet->arrivalUs - timestampUs;
+
+    if (m_windowStartUs == 0) {
+        m_baseTransitUs = m_windowMinUs = m_lastTransitUs = transit;
+        m_windowStartUs = packet->arrivalUs;
+    } else {
+        //RFC 3550 6.4.1
+        m_jitterUs += (llabs(transit - m_lastTransitUs) - m_jitterUs) / 16;
+        m_lastTransitUs = transit;
+        m_windowMinUs = std::min(m_windowMinUs, transit);
+        if (transit < m_baseTransitUs)
+            m_baseTransitUs = transit;
+        if (packet->arrivalUs - m_windowStartUs >= RTP_JITTER_TRANSIT_WINDOW_US) {
+            m_baseTransitUs = m_windowMinUs;
+            m_windowMinUs = transit;
+            m_windowStartUs = packet->arrivalUs;
+        }
+    }
+    if (delta > 0) {
+        m_lastTimestamp = packet->header.timestamp;
+        m_timestampExt = timestampExt;
+    }
+
+    target = std::min(std::max((int64_t)(m_jitterUs * m_config.multiplier), m_config.minDelayUs), m_config.maxDelayUs);
+    if (target > m_delayUs)
+        m_delayUs = target;
+    else
+        m_delayUs += (target - m_delayUs) / RTP_JITTER_DECAY;
+
+    packet->playoutUs = timestampUs + m_baseTransitUs + (int64_t)m_delayUs;
+    if (packet->extSequence >= m_highestSequence) {
+        packet->playoutUs = std::max(packet->playoutUs, m_lastPlayoutUs);
+        m_lastPlayoutUs = packet->playoutUs;
+    }
+
+    m_statistics.jitterUs = (int64_t)m_jitterUs;
+    m_statistics.maxJitterUs = std::max(m_statistics.maxJitterUs, m_statistics.jitterUs);
+    m_statistics.arrivalHistogram[histogramBucket(transit - m_baseTransitUs)]++;
+}
+
+int RTPJitterBuffer::insert(const uint8_t* data, int size, int64_t arrivalUs)
+{
+    RTPHeader header;
+    RTPPacket* packet;
+    int64_t sequence = 0;
+    int16_t delta;
+
+    if (size > RTP_PACKET_SIZE_MAX || RTPParseHeader(data, size, &header) < 0) {
+        m_statistics.invalid++;
+        return -1;
+    }
+    m_statistics.received++;
+
+    if (m_started && header.ssrc == m_ssrc) {
+        delta = (int16_t)(header.sequence - (uint16_t)m_highestSequence);
+        sequence = m_highestSequence + delta;
+        if (abs(delta) > RTP_JITTER_RESYNC_GAP) {
+            playerLogWarning("rtp: sequence jumps from [%u] to [%u], resync.\n",
+                             (unsigned)(uint16_t)m_highestSequence, (unsigned)header.sequence);
+            m_statistics.resyncs++;
+            flush();
+        }
+    } else if (m_started) {
+        playerLogWarning("rtp: ssrc changes from [%08x] to [%08x], resync.\n", m_ssrc, header.ssrc);
+        m_statistics.resyncs++;
+        flush();
+    }
+    if (!m_started) {
+        m_started = true;
+        m_ssrc = header.ssrc;
+        m_nextSequence = m_highestSequence = sequence = header.sequence;
+        m_lastTimestamp = header.timestamp;
+        m_timestampExt = header.timestamp;
+    }
+
+    if (sequence < m_nextSequence) {
+        m_statistics.late++;
+        return 1;
+    }
+    RTPPacket*& slot = m_slots[sequence & (m_config.maxPackets - 1)];
+    if (slot && slot->extSequence == sequence) {
+        m_statistics.duplicates++;
+        return 1;
+    }
+    while (sequence - m_nextSequence >= m_config.maxPackets)
+        dropHead();
+    if (sequence < m_highestSequence)
+        m_statistics.reordered++;
+
+    packet = allocPacket();
+    memcpy(packet->data, data, size);
+    packet->size = size;
+    packet->header = header;
+    packet->payload = packet->data + header.headerSize;
+    packet->extSequence = sequence;
+    packet->arrivalUs = arrivalUs;
+    updateTiming(packet);
+    if (sequence > m_highestSequence)
+        m_highestSequence = sequence;
+
+    slot = packet;
+    m_buffered++;
+    return 0;
+}
+
+int RTPJitterBuffer::pop(int64_t nowUs, RTPPacket** packet, int64_t* waitUs)
+{
+    const int64_t mask = m_config.maxPackets - 1;
+    RTPPacket* head;
+    RTPPacket* next = NULL;
+    int64_t sequence;
+    int count;
+
+    *packet = NULL;
+    while (m_buffered > 0) {
+        head = m_slots[m_nextSequence & mask];
+        if (head && head->extSequence == m_nextSequence) {
+            if (nowUs < head->playoutUs) {
+                *waitUs = head->playoutUs - nowUs;
+                return 1;
+            }
+            m_slots[m_nextSequence & mask] = NULL;
+            m_buffered--;
+            m_nextSequence++;
+            m_statistics.played++;
+            m_statistics.playoutHistogram[histogramBucket(nowUs - head->arrivalUs)]++;
+            if (m_callbacks.onPlayout)
+                m_callbacks.onPlayout(head, nowUs, m_callbacks.userData);
+            *packet = head;
+            return 0;
+        }
+
+        //缺少的序号等到后面第一个 packet 的播放时间
+        for (sequence = m_nextSequence + 1; sequence <= m_highestSequence; sequence++) {
+            next = m_slots[sequence & mask];
+            if (next && next->extSequence == sequence)
+                break;
+        }
+        if (nowUs < next->playoutUs) {
+            *waitUs = next->playoutUs - nowUs;
+            return 1;
+        }
+        count = (int)(next->extSequence - m_nextSequence);
+        m_statistics.lost += count;
+        if (m_callbacks.onLoss)
+            m_callbacks.onLoss(m_nextSequence, count, m_callbacks.userData);
+        m_nextSequence = next->extSequence;
+    }
+    *waitUs = -1;
+    return 1;
+}
+
+RTPJitterStatistics RTPJitterBuffer::getStatistics()
+{
+    RTPJitterStatistics statistics = m_statistics;
+
+    statistics.delayUs = (int64_t)m_delayUs;
+    statistics.buffered = m_buffered;
+    return statistics;
+}
@@ -0,0 +1,160 @@
+#ifndef __RTP_JITTER_BUFFER_H__
+#define __RTP_JITTER_BUFFER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     RTP_HEADER_SIZE             12
+#define     RTP_PACKET_SIZE_MAX         2048        //MP2T 一般为 7 * 188 + 12
+#define     RTP_PAYLOAD_MP2T            33
+#define     RTP_CLOCK_RATE_DEFAULT      90000
+#define     RTP_JITTER_MIN_DELAY_US     20000       //设置项 rtp.jitterMinDelayMs 的默认值
+#define     RTP_JITTER_MAX_DELAY_US     1000000     //设置项 rtp.jitterMaxDelayMs 的默认值
+#define     RTP_JITTER_MULTIPLIER       4           //目标延时为抖动估计的倍数
+#define     RTP_JITTER_PACKETS_MAX      4096        //2 的幂，缓冲中序号跨度的上限
+#define     RTP_JITTER_RESYNC_GAP       3000        //序号跳变超过这么多时认为是新的流
+#define     RTP_JITTER_TRANSIT_WINDOW_US    2000000 //传输延时的最小值按这个窗口重新统计，跟随时钟漂移
+#define     RTP_JITTER_HISTOGRAM_BUCKETS    8
+
+
+typedef struct _RTPHeader {
+    int             payloadType;
+    int             marker;
+    uint16_t        sequence;
+    uint32_t        timestamp;
+    uint32_t        ssrc;
+    int             headerSize;         //包括 CSRC 和扩展头
+    int             payloadSize;        //去掉 padding
+} RTPHeader;
+
+/* 0 成功，-1 不是 RTP 版本 2 或者长度不对 */
+int RTPParseHeader(const uint8_t* data, int size, RTPHeader* header);
+
+
+typedef struct _RTPJitterConfig {
+    int             clockRate;
+    int64_t         minDelayUs;
+    int64_t         maxDelayUs;
+    int             multiplier;
+    int             maxPackets;         //2 的幂
+} RTPJitterConfig;
+
+void RTPJitterConfigDefault(RTPJitterConfig* config);
+
+typedef struct _RTPPacket {
+    uint8_t         data[RTP_PACKET_SIZE_MAX];
+    int             size;
+    RTPHeader       header;
+    const uint8_t*  payload;
+    int64_t         extSequence;        //展开回绕后的序号
+    int64_t         arrivalUs;
+    int64_t         playoutUs;
+} RTPPacket;
+
+typedef struct _RTPJitterCallbacks {
+    /* 隐藏丢包的接口：序号 [first, first + count) 到了播放时间还没有收到，之后再收到也会丢弃 */
+    void (*onLoss)(int64_t firstSequence, int count, void* userData);
+    /* 统计用：每个 packet 离开缓冲时 */
+    void (*onPlayout)(const RTPPacket* packet, int64_t nowUs, void* userData);
+    void*           userData;
+} RTPJitterCallbacks;
+
+typedef struct _RTPJitterStatistics {
+    int64_t         received;
+    int64_t         played;
+    int64_t         lost;               //到播放时间还没有收到
+    int64_t         late;               //播放时间之后才收到，丢弃
+    int64_t         duplicates;
+    int64_t         reordered;          //比已收到的最大序号小
+    int64_t         overflows;          //序号跨度超过 maxPackets，提前丢弃最旧的
+    int64_t         invalid;
+    int64_t         resyncs;            //SSRC 变化或者序号跳变
+    int64_t         jitterUs;           //RFC 3550 到达间隔抖动
+    int64_t         maxJitterUs;
+    int64_t         delayUs;            //当前的缓冲延时
+    int             buffered;
+    int             arrivalHistogram[RTP_JITTER_HISTOGRAM_BUCKETS];    //传输延时比最小值多出的时间，上限见 RTPJitterHistogramBounds
+    int             playoutHistogram[RTP_JITTER_HISTOGRAM_BUCKETS];    //在缓冲中停留的时间
+} RTPJitterStatistics;
+
+/* 直方图每个桶的上限(毫秒)，最后一个桶没有上限 */
+extern const int RTPJitterHistogramBounds[RTP_JITTER_HISTOGRAM_BUCKETS];
+
+
+class RTPJitterBuffer { /* 按序号排序的抖动缓冲：播放时间 = 时间戳 + 最小传输延时 + 随抖动调整的延时，到时间还缺的序号按丢包处理 */
+    public:
+        RTPJitterBuffer(const RTPJitterConfig* config);
+        ~RTPJitterBuffer();
+
+        void setCallbacks(const RTPJitterCallbacks& callbacks) { m_callbacks = callbacks; }
+
+        /**
+         *  @Func: insert
+         *         ps. :不是线程安全的；数据拷贝到缓冲中
+         *  @Param: data, type:: const uint8_t*, 整个 RTP packet
+         *  @Param: size, type:: int
+         *  @Param: arrivalUs, type:: int64_t, 单调时钟
+         *  @Return: int, 0 放入缓冲，1 重复或者迟到丢弃，-1 无效
+         *
+         **/
+        int insert(const uint8_t* data, int size, int64_t arrivalUs);
+
+        /**
+         *  @Func: pop
+         *         ps. :按序号取出到了播放时间的 packet；中间缺的序号到了后面 packet 的播放时间时报告丢包并跳过
+         *  @Param: nowUs, type:: int64_t
+         *  @Param: packet, type:: RTPPacket**, 使用完后 release()
+         *  @Param: waitUs, type:: int64_t*, 返回 1 时下一个 packet 到期的时间，-1 表示缓冲为空
+         *  @Return: int, 0 取出，1 还没有到期
+         *
+         **/
+        int pop(int64_t nowUs, RTPPacket** packet, int64_t* waitUs);
+        void release(RTPPacket* packet);
+
+        void reset();
+        RTPJitterStatistics getStatistics();
+
+    private:
+        RTPJitterBuffer(const RTPJitterBuffer&);
+        RTPJitterBuffer& operator=(const RTPJitterBuffer&);
+
+        RTPPacket* allocPacket();
+        void flush();
+        void dropHead();
+        void updateTiming(RTPPacket* packet);
+        static int histogramBucket(int64_t us);
+
+        RTPJitterConfig                 m_config;
+        RTPJitterCallbacks              m_callbacks;
+        std::vector<RTPPacket*>         m_slots;            //按 extSequence & (maxPackets - 1)
+        std::vector<RTPPacket*>         m_free;
+        bool                            m_started;
+        uint32_t                        m_ssrc;
+        int64_t                         m_nextSequence;     //下一个要播放的序号
+        int64_t                         m_highestSequence;
+        int                             m_buffered;
+
+        /* 时间：时间戳展开为 64 位微秒，传输延时 = 到达时间 - 时间戳 */
+        uint32_t                        m_lastTimestamp;
+        int64_t                         m_timestampExt;     //m_lastTimestamp 展开回绕后的值
+        int64_t                         m_baseTransitUs;    //当前使用的最小传输延时
+        int64_t                         m_windowMinUs;
+        int64_t                         m_windowStartUs;
+        int64_t                         m_lastTransitUs;
+        int64_t                         m_lastPlayoutUs;    //播放时间不后退
+        double                          m_jitterUs;
+        double                          m_delayUs;
+
+        RTPJitterStatistics             m_statistics;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__RTP_JITTER_BUFFER_H__
@@ -0,0 +1,372 @@
+/**
+ *  RTPReceiver.cpp文件
+ *  RTP 接收，用于 IPTV 组播/单播 (CODEC_ID_RTP2TS)；
+ *  主要有以下部分：
+ *      1. UDP socket：单播绑定本机地址，组播地址时加入组播组
+ *      2. 接收线程：收到的 packet 记录到达时间放入 RTPJitterBuffer
+ *      3. read()：按播放时间取出负载，保留最近的负载供 DemuxerOpen 探测之后重读
+ *      4. DemuxSource：rtp:// 地址作为 Demuxer 的数据源
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <string>
+
+#include "LogPlayer.h"
+#include "RTPReceiver.h"
+
+
+static int64_t RTPNowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* pthread_cond_timedwait 使用 CLOCK_REALTIME */
+static void RTPDeadline(struct timespec* deadline, int64_t waitUs)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    deadline->tv_sec = now.tv_sec + waitUs / 1000000;
+    deadline->tv_nsec = (now.tv_usec + waitUs % 1000000) * 1000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/* rtp://[@]host:port */
+static int RTPParseUrl(const char* url, struct in_addr* address, int* port)
+{
+    std::string host;
+    const char* colon;
+
+    if (strncmp(url, "rtp://", 6) != 0)
+        return -1;
+    url += 6;
+    if (*url == '@')
+        url++;
+    colon = strrchr(url, ':');
+    if (colon == NULL)
+        return -1;
+    host.assign(url, colon - url);
+    *port = atoi(colon + 1);
+    if (*port < 0 || *port > 65535)
+        return -1;
+    if (host.empty()) {
+        address->s_addr = htonl(INADDR_ANY);
+        return 0;
+    }
+    return inet_aton(host.c_str(), address) ? 0 : -1;
+}
+
+
+void RTPReceiverConfigDefault(RTPReceiverConfig* config)
+{
+    RTPJitterConfigDefault(&config->jitter);
+    config->socketBufferBytes = RTP_SOCKET_BUFFER_DEFAULT;
+    config->payloadType = -1;
+}
+
+
+RTPReceiver::RTPReceiver()
+    : m_jitter(NULL)
+    , m_socket(-1)
+    , m_port(0)
+    , m_threadStarted(false)
+    , m_closing(false)
+    , m_historyBase(0)
+    , m_lossCallback(NULL)
+    , m_lossUserData(NULL)
+{
+    RTPReceiverConfigDefault(&m_config);
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+RTPReceiver::~RTPReceiver()
+{
+    close();
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int RTPReceiver::open(const char* url, const RTPReceiverConfig* config)
+{
+    RTPJitterCallbacks callbacks;
+    struct sockaddr_in local;
+    struct ip_mreq group;
+    struct in_addr address;
+    socklen_t length = sizeof(local);
+    int port, on = 1;
+
+    close();
+    if (config)
+        m_config = *config;
+    if (RTPParseUrl(url, &address, &port) < 0) {
+        playerLogError("rtp: invalid url [%s].\n", url);
+        return -1;
+    }
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+        playerLogError("rtp: socket error [%s].\n", strerror(errno));
+        return -1;
+    }
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (m_config.socketBufferBytes > 0)
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &m_config.socketBufferBytes, sizeof(m_config.socketBufferBytes));
+
+    //组播时绑定组地址，只收这个组的数据
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr = address;
+    if (bind(m_socket, (struct sockaddr*)&local, sizeof(local)) < 0) {
+        playerLogError("rtp: bind [%s] error [%s].\n", url, strerror(errno));
+        close();
+        return -1;
+    }
+    if (IN_MULTICAST(ntohl(address.s_addr))) {
+        group.imr_multiaddr = address;
+        group.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(m_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) < 0) {
+            playerLogError("rtp: join group [%s] error [%s].\n", url, strerror(errno));
+            close();
+            return -1;
+        }
+    }
+    getsockname(m_socket, (struct sockaddr*)&local, &length);
+    m_port = ntohs(local.sin_port);
+
+    m_jitter = new RTPJitterBuffer(&m_config.jitter);
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onLoss = onLoss;
+    callbacks.userData = this;
+    m_jitter->setCallbacks(callbacks);
+    m_history.clear();
+    m_historyBase = 0;
+    m_closing = false;
+
+    if (pthread_create(&m_thread, NULL, receiveThread, this) != 0) {
+        playerLogError("rtp: create receive thread failed.\n");
+        close();
+        return -1;
+    }
+    m_threadStarted = true;
+    playerLogInfo("rtp: receiving [%s] on port [%d].\n", url, m_port);
+    return 0;
+}
+
+void RTPReceiver::close()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_closing = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (m_threadStarted) {
+        pthread_join(m_thread, NULL);
+        m_threadStarted = false;
+    }
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    if (m_jitter) {
+        delete m_jitter;
+        m_jitter = NULL;
+    }
+    m_history.clear();
+}
+
+void RTPReceiver::setLossCallback(void (*onLoss)(int64_t firstSequence, int count, void* userData), void* userData)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_lossCallback = onLoss;
+    m_lossUserData = userData;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/* 在持有 m_mutex 的 pop() 中调用 */
+void RTPReceiver::onLoss(int64_t firstSequence, int count, void* userData)
+{
+    RTPReceiver* self = (RTPReceiver*)userData;
+
+    playerLogVerbose("rtp: lost [%d] packets from sequence [%lld].\n", count, (long long)firstSequence);
+    if (self->m_lossCallback)
+        self->m_lossCallback(firstSequence, count, self->m_lossUserData);
+}
+
+void* RTPReceiver::receiveThread(void* arg)
+{
+    ((RTPReceiver*)arg)->runReceive();
+    return NULL;
+}
+
+void RTPReceiver::runReceive()
+{
+    uint8_t buffer[RTP_PACKET_SIZE_MAX];
+    struct pollfd fd;
+    RTPHeader header;
+    int size;
+
+    fd.fd = m_socket;
+    fd.events = POLLIN;
+    while (!m_closing) {
+        if (poll(&fd, 1, RTP_RECEIVE_POLL_MS) <= 0)
+            continue;
+        size = recv(m_socket, buffer, sizeof(buffer), 0);
+        if (size < 0) {
+            if (errno != EINTR && errno != EAGAIN)
+                playerLogWarning("rtp: recv error [%s].\n", strerror(errno));
+            continue;
+        }
+        if (m_config.payloadType >= 0 && RTPParseHeader(buffer, size, &header) == 0
+                && header.payloadType != m_config.payloadType)
+            continue;
+
+        pthread_mutex_lock(&m_mutex);
+        m_jitter->insert(buffer, size, RTPNowUs());
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+int RTPReceiver::read(int64_t offset, uint8_t* buffer, int size, int timeoutMs)
+{
+    struct timespec deadline;
+    RTPPacket* packet;
+    int64_t now, waitUs, endUs = (timeoutMs >= 0) ? RTPNowUs() + (int64_t)timeoutMs * 1000 : -1;
+    size_t trim;
+    int ret;
+
+    pthread_mutex_lock(&m_mutex);
+    for (;;) {
+        if (offset < m_historyBase) {
+            pthread_mutex_unlock(&m_mutex);
+            return -1;
+        }
+        if (offset < m_historyBase + (int64_t)m_history.size()) {
+            size = (int)std::min((int64_t)size, m_historyBase + (int64_t)m_history.size() - offset);
+            memcpy(buffer, &m_history[offset - m_historyBase], size);
+            pthread_mutex_unlock(&m_mutex);
+            return size;
+        }
+        if (m_closing || m_jitter == NULL) {
+            pthread_mutex_unlock(&m_mutex);
+            return 0;
+        }
+
+        now = RTPNowUs();
+        ret = m_jitter->pop(now, &packet, &waitUs);
+        if (ret == 0) {
+            m_history.insert(m_history.end(), packet->payload, packet->payload + packet->header.payloadSize);
+            m_jitter->release(packet);
+            if (m_history.size() > 2 * RTP_HISTORY_BYTES) {
+                trim = m_history.size() - RTP_HISTORY_BYTES;
+                m_history.erase(m_history.begin(), m_history.begin() + trim);
+                m_historyBase += trim;
+            }
+            continue;
+        }
+
+        //等到下一个 packet 到期，或者有新的 packet 到达
+        if (endUs >= 0 && now >= endUs) {
+            pthread_mutex_unlock(&m_mutex);
+            return -2;
+        }
+        if (waitUs < 0 || waitUs > RTP_RECEIVE_POLL_MS * 1000)
+            waitUs = RTP_RECEIVE_POLL_MS * 1000;
+        if (endUs >= 0)
+            waitUs = std::min(waitUs, endUs - now);
+        RTPDeadline(&deadline, waitUs);
+        pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+    }
+}
+
+RTPJitterStatistics RTPReceiver::getStatistics()
+{
+    RTPJitterStatistics statistics;
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_jitter)
+        statistics = m_jitter->getStatistics();
+    else
+        memset(&statistics, 0, sizeof(statistics));
+    pthread_mutex_unlock(&m_mutex);
+    return statistics;
+}
+
+void RTPReceiver::logStatistics()
+{
+    RTPJitterStatistics statistics = getStatistics();
+    int i;
+
+    playerLogInfo("rtp: received[%lld] played[%lld] lost[%lld] late[%lld] duplicates[%lld] reordered[%lld] overflows[%lld] resyncs[%lld]\n",
+                  (long long)statistics.received, (long long)statistics.played, (long long)statistics.lost,
+                  (long long)statistics.late, (long long)statistics.duplicates, (long long)statistics.reordered,
+                  (long long)statistics.overflows, (long long)statistics.resyncs);
+    playerLogInfo("rtp: jitter[%lld]us max[%lld]us delay[%lld]us buffered[%d]\n", (long long)statistics.jitterUs,
+                  (long long)statistics.maxJitterUs, (long long)statistics.delayUs, statistics.buffered);
+    for (i = 0; i < RTP_JITTER_HISTOGRAM_BUCKETS; i++) {
+        playerLogInfo("rtp:   %s %4d ms : arrival %d, playout %d\n", (i < RTP_JITTER_HISTOGRAM_BUCKETS - 1) ? "<=" : " >",
+                      RTPJitterHistogramBounds[(i < RTP_JITTER_HISTOGRAM_BUCKETS - 1) ? i : i - 1],
+                      statistics.arrivalHistogram[i], statistics.playoutHistogram[i]);
+    }
+}
+
+
+static int RTPSourceRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    int ret = ((RTPReceiver*)opaque)->read(offset, buffer, size, RTP_SOURCE_TIMEOUT_MS);
+
+    if (ret == -2) {
+        playerLogWarning("rtp: no data for %d ms.\n", RTP_SOURCE_TIMEOUT_MS);
+        return -1;
+    }
+    return ret;
+}
+
+int DemuxSourceOpenRTP(DemuxSource* source, const char* url)
+{
+    RTPReceiver* receiver = new RTPReceiver();
+
+    if (receiver->open(url, NULL) < 0) {
+        delete receiver;
+        return -1;
+    }
+    source->read = RTPSourceRead;
+    source->size = -1;
+    source->opaque = receiver;
+    return 0;
+}
+
+void DemuxSourceCloseRTP(DemuxSource* source)
+{
+    if (DemuxSourceIsRTP(source)) {
+        ((RTPReceiver*)source->opaque)->logStatistics();
+        delete (RTPReceiver*)source->opaque;
+    }
+    memset(source, 0, sizeof(*source));
+}
+
+bool DemuxSourceIsRTP(const DemuxSource* source)
+{
+    return source->read == RTPSourceRead;
+}
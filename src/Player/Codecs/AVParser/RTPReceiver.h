@@ -0,0 +1,98 @@
+#ifndef __RTP_RECEIVER_H__
+#define __RTP_RECEIVER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+
+#include "Demuxer.h"
+#include "RTPJitterBuffer.h"
+
+
+#define     RTP_SOCKET_BUFFER_DEFAULT   (2 * 1024 * 1024)
+#define     RTP_RECEIVE_POLL_MS         100         //接收线程检查关闭的间隔
+#define     RTP_HISTORY_BYTES           DEMUX_OPEN_SCAN_MAX     //保留已经读过的负载，DemuxerOpen 探测之后会从头重读
+#define     RTP_SOURCE_TIMEOUT_MS       3000        //作为 DemuxSource 时这么久没有数据按出错返回
+
+
+typedef struct _RTPReceiverConfig {
+    RTPJitterConfig     jitter;
+    int                 socketBufferBytes;
+    int                 payloadType;        //-1 不检查
+} RTPReceiverConfig;
+
+void RTPReceiverConfigDefault(RTPReceiverConfig* config);
+
+
+class RTPReceiver { /* UDP 接收 RTP：接收线程放入抖动缓冲，读取时按播放时间取出负载 */
+    public:
+        RTPReceiver();
+        ~RTPReceiver();
+
+        /**
+         *  @Func: open
+         *         ps. :rtp://[@]host:port，host 为组播地址时加入组播，为空时接收本机所有地址；port 为 0 时由系统分配
+         *  @Param: url, type:: const char*
+         *  @Param: config, type:: const RTPReceiverConfig*, NULL 为默认
+         *  @Return: int, 0 成功，-1 失败
+         *
+         **/
+        int open(const char* url, const RTPReceiverConfig* config);
+        void close();
+
+        /**
+         *  @Func: read
+         *         ps. :按顺序读取负载，offset 为从打开开始的字节位置；可以重读最近 RTP_HISTORY_BYTES 字节
+         *  @Param: offset, type:: int64_t
+         *  @Param: buffer, type:: uint8_t*
+         *  @Param: size, type:: int
+         *  @Param: timeoutMs, type:: int, -1 一直等待
+         *  @Return: int, 读到的字节数，超时返回 -2，关闭后返回 0，offset 已经丢弃时返回 -1
+         *
+         **/
+        int read(int64_t offset, uint8_t* buffer, int size, int timeoutMs);
+
+        void setLossCallback(void (*onLoss)(int64_t firstSequence, int count, void* userData), void* userData);
+        int getPort() { return m_port; }
+        RTPJitterStatistics getStatistics();
+        void logStatistics();
+
+    private:
+        RTPReceiver(const RTPReceiver&);
+        RTPReceiver& operator=(const RTPReceiver&);
+
+        static void* receiveThread(void* arg);
+        void runReceive();
+        static void onLoss(int64_t firstSequence, int count, void* userData);
+
+        RTPReceiverConfig               m_config;
+        RTPJitterBuffer*                m_jitter;
+        int                             m_socket;
+        int                             m_port;
+        pthread_t                       m_thread;
+        bool                            m_threadStarted;
+        volatile bool                   m_closing;
+        pthread_mutex_t                 m_mutex;
+        pthread_cond_t                  m_cond;
+
+        std::vector<uint8_t>            m_history;          //已经取出的负载，从 m_historyBase 开始
+        int64_t                         m_historyBase;
+        void                            (*m_lossCallback)(int64_t firstSequence, int count, void* userData);
+        void*                           m_lossUserData;
+};
+
+
+/* Demuxer 的数据源：rtp:// 地址，负载一般为 MP2T */
+int DemuxSourceOpenRTP(DemuxSource* source, const char* url);
+void DemuxSourceCloseRTP(DemuxSource* source);
+bool DemuxSourceIsRTP(const DemuxSource* source);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__RTP_RECEIVER_H__
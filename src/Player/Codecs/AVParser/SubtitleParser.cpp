@@ -0,0 +1,338 @@
+/**
+ *  SubtitleParser.cpp文件
+ *  外挂字幕文件的解析；
+ *  主要有以下部分：
+ *      1. 时间：SRT 的 00:01:02,345 和 ASS 的 0:01:02.34，小数按位数换算
+ *      2. SRT：序号行可以没有，时间行 "-->" 之后到空行为文字，去掉 <i> <font> 等标签
+ *      3. ASS/SSA：[Events] 中按 Format 行找 Start、End、Text 的位置，Text 为最后一列可以有逗号，去掉 {\...} 样式
+ *      4. 文件：一次读入，插入到字幕轨道的 SubtitleQueue
+ *
+ **/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "LogPlayer.h"
+#include "SubtitleParser.h"
+
+
+static bool SubtitleStartsWith(const std::string& line, const char* prefix)
+{
+    return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static std::string SubtitleTrim(const std::string& text)
+{
+    size_t begin = 0, end = text.size();
+
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t' || text[begin] == '\r'))
+        begin++;
+    while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t' || text[end - 1] == '\r'))
+        end--;
+    return text.substr(begin, end - begin);
+}
+
+/* 按行切分，去掉行尾的 \r */
+static void SubtitleSplitLines(const std::string& text, std::vector<std::string>& lines)
+{
+    size_t begin = 0, end;
+
+    lines.clear();
+    while (begin <= text.size()) {
+        end = text.find('\n', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        lines.push_back(text.substr(begin, end - begin));
+        if (!lines.back().empty() && lines.back()[lines.back().size() - 1] == '\r')
+            lines.back().erase(lines.back().size() - 1);
+        begin = end + 1;
+    }
+}
+
+/* 每行去掉首尾空白，去掉空行 */
+static std::string SubtitleCleanLines(const std::string& text)
+{
+    std::vector<std::string> lines;
+    std::string result, line;
+    unsigned int i;
+
+    SubtitleSplitLines(text, lines);
+    for (i = 0; i < lines.size(); i++) {
+        line = SubtitleTrim(lines[i]);
+        if (line.empty())
+            continue;
+        if (!result.empty())
+            result += '\n';
+        result += line;
+    }
+    return result;
+}
+
+static bool SubtitleIsNumber(const std::string& text)
+{
+    unsigned int i;
+
+    for (i = 0; i < text.size(); i++) {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+    }
+    return !text.empty();
+}
+
+static bool SubtitleIsTimeLine(const std::string& line)
+{
+    return line.find("-->") != std::string::npos && SubtitleParser::parseTime(line.c_str(), NULL) >= 0;
+}
+
+
+int64_t SubtitleParser::parseTime(const char* text, const char** end)
+{
+    int64_t fields[3] = {0, 0, 0}, value, fraction = 0, scale = 1000000;
+    int count = 0, digits;
+    const char* p = text;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    for (;;) {
+        for (value = 0, digits = 0; *p >= '0' && *p <= '9'; p++, digits++)
+            value = value * 10 + (*p - '0');
+        if (digits == 0 || count >= 3)
+            return -1;
+        fields[count++] = value;
+        if (*p != ':')
+            break;
+        p++;
+    }
+    if (count < 2)
+        return -1;
+    if (*p == ',' || *p == '.') {
+        for (p++, digits = 0; *p >= '0' && *p <= '9'; p++, digits++) {
+            if (digits < 6) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+        }
+    }
+    if (end)
+        *end = p;
+    /* MM:SS 或 H:MM:SS */
+    if (count == 2)
+        return (fields[0] * 60 + fields[1]) * 1000000 + fraction;
+    return ((fields[0] * 60 + fields[1]) * 60 + fields[2]) * 1000000 + fraction;
+}
+
+std::string SubtitleParser::stripAssTags(const std::string& text)
+{
+    std::string result;
+    size_t i = 0, close;
+
+    while (i < text.size()) {
+        if (text[i] == '{' && (close = text.find('}', i)) != std::string::npos) {
+            i = close + 1;
+            continue;
+        }
+        if (text[i] == '\\' && i + 1 < text.size() && (text[i + 1] == 'N' || text[i + 1] == 'n' || text[i + 1] == 'h')) {
+            result += text[i + 1] == 'h' ? ' ' : '\n';
+            i += 2;
+            continue;
+        }
+        result += text[i++];
+    }
+    return SubtitleCleanLines(result);
+}
+
+std::string SubtitleParser::stripHtmlTags(const std::string& text)
+{
+    std::string result;
+    size_t i = 0, close;
+
+    while (i < text.size()) {
+        /* 只去掉像标签的 <...>，"a < b" 这样的文字保留 */
+        if (text[i] == '<' && i + 1 < text.size() && (isalpha((unsigned char)text[i + 1]) || text[i + 1] == '/')
+            && (close = text.find('>', i)) != std::string::npos && text.find('\n', i) > close) {
+            i = close + 1;
+            continue;
+        }
+        result += text[i++];
+    }
+    return stripAssTags(result);
+}
+
+int SubtitleParser::parseSRT(const std::string& text, std::vector<SubtitleCue>& cues)
+{
+    std::vector<std::string> lines;
+    SubtitleCue cue;
+    std::string body;
+    const char* p;
+    int64_t startUs, endUs;
+    unsigned int i;
+    int count = 0;
+
+    SubtitleSplitLines(text, lines);
+    for (i = 0; i < lines.size(); i++) {
+        size_t arrow = lines[i].find("-->");
+
+        if (arrow == std::string::npos)
+            continue;
+        startUs = parseTime(lines[i].c_str(), &p);
+        endUs = parseTime(lines[i].c_str() + arrow + 3, NULL);
+        if (startUs < 0 || endUs < 0 || p > lines[i].c_str() + arrow) {
+            playerLogWarning("srt line [%u] bad time [%s], skipped.\n", i + 1, lines[i].c_str());
+            continue;
+        }
+
+        /* 文字到空行为止；没有空行时遇到下一条的序号行或时间行也结束 */
+        body.clear();
+        while (i + 1 < lines.size() && !SubtitleTrim(lines[i + 1]).empty()) {
+            if (SubtitleIsTimeLine(lines[i + 1]))
+                break;
+            if (i + 2 < lines.size() && SubtitleIsTimeLine(lines[i + 2]) && SubtitleIsNumber(SubtitleTrim(lines[i + 1])))
+                break;
+            if (!body.empty())
+                body += '\n';
+            body += lines[++i];
+        }
+        SubtitleCueInit(&cue, startUs, endUs);
+        cue.text = stripHtmlTags(body);
+        if (!cue.text.empty()) {
+            cues.push_back(cue);
+            count++;
+        }
+    }
+    return count;
+}
+
+int SubtitleParser::parseASS(const std::string& text, std::vector<SubtitleCue>& cues)
+{
+    std::vector<std::string> lines, fields;
+    std::string line, value;
+    SubtitleCue cue;
+    int startField = 1, endField = 2, textField = 9, fieldCount = 10;
+    int64_t startUs, endUs;
+    bool events = false;
+    unsigned int i;
+    size_t begin, comma;
+    int count = 0, field;
+
+    SubtitleSplitLines(text, lines);
+    for (i = 0; i < lines.size(); i++) {
+        line = SubtitleTrim(lines[i]);
+        if (!line.empty() && line[0] == '[') {
+            events = strcasecmp(line.c_str(), "[Events]") == 0;
+            continue;
+        }
+        if (!events)
+            continue;
+
+        /* Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text */
+        if (SubtitleStartsWith(line, "Format:")) {
+            startField = endField = textField = -1;
+            fieldCount = 0;
+            for (begin = 7; begin <= line.size(); begin = comma + 1, fieldCount++) {
+                comma = line.find(',', begin);
+                if (comma == std::string::npos)
+                    comma = line.size();
+                value = SubtitleTrim(line.substr(begin, comma - begin));
+                if (strcasecmp(value.c_str(), "Start") == 0)
+                    startField = fieldCount;
+                else if (strcasecmp(value.c_str(), "End") == 0)
+                    endField = fieldCount;
+                else if (strcasecmp(value.c_str(), "Text") == 0)
+                    textField = fieldCount;
+            }
+            if (startField < 0 || endField < 0 || textField != fieldCount - 1) {
+                playerLogWarning("ass bad format line [%s].\n", line.c_str());
+                return count;
+            }
+            continue;
+        }
+        if (!SubtitleStartsWith(line, "Dialogue:"))
+            continue;
+
+        /* 最后一列(Text)中的逗号不分隔 */
+        fields.clear();
+        for (begin = 9, field = 0; field < fieldCount - 1; field++, begin = comma + 1) {
+            comma = line.find(',', begin);
+            if (comma == std::string::npos)
+                break;
+            fields.push_back(SubtitleTrim(line.substr(begin, comma - begin)));
+        }
+        if (field < fieldCount - 1)
+            continue;
+        fields.push_back(line.substr(begin));
+        startUs = parseTime(fields[startField].c_str(), NULL);
+        endUs = parseTime(fields[endField].c_str(), NULL);
+        if (startUs < 0 || endUs < 0)
+            continue;
+        SubtitleCueInit(&cue, startUs, endUs);
+        cue.text = stripAssTags(fields[textField]);
+        if (!cue.text.empty()) {
+            cues.push_back(cue);
+            count++;
+        }
+    }
+    return count;
+}
+
+int SubtitleParser::parse(const char* text, int size, std::vector<SubtitleCue>& cues)
+{
+    std::string content;
+
+    if (size >= 2 && (((uint8_t)text[0] == 0xFF && (uint8_t)text[1] == 0xFE) || ((uint8_t)text[0] == 0xFE && (uint8_t)text[1] == 0xFF))) {
+        playerLogWarning("UTF-16 subtitle not supported.\n");
+        return SubtitleFormat_Unknown;
+    }
+    if (size >= 3 && (uint8_t)text[0] == 0xEF && (uint8_t)text[1] == 0xBB && (uint8_t)text[2] == 0xBF) {
+        text += 3;
+        size -= 3;
+    }
+    content.assign(text, size);
+
+    if (content.find("[Script Info]") != std::string::npos || content.find("[Events]") != std::string::npos) {
+        parseASS(content, cues);
+        return SubtitleFormat_ASS;
+    }
+    if (content.find("-->") != std::string::npos) {
+        parseSRT(content, cues);
+        return SubtitleFormat_SRT;
+    }
+    return SubtitleFormat_Unknown;
+}
+
+int SubtitleParser::load(const char* path, SubtitleQueue* queue)
+{
+    std::vector<SubtitleCue> cues;
+    std::vector<char> data;
+    FILE* file = fopen(path, "rb");
+    long size;
+    unsigned int i;
+    int count = 0;
+
+    if (file == NULL) {
+        playerLogError("Couldn't open subtitle [%s].\n", path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0 || size > SUBTITLE_FILE_SIZE_MAX) {
+        playerLogError("subtitle [%s] size [%ld] not supported.\n", path, size);
+        fclose(file);
+        return -1;
+    }
+    data.resize(size);
+    size = fread(&data[0], 1, size, file);
+    fclose(file);
+
+    if (size <= 0 || parse(&data[0], size, cues) == SubtitleFormat_Unknown) {
+        playerLogError("subtitle [%s] unknown format.\n", path);
+        return -1;
+    }
+    for (i = 0; i < cues.size(); i++)
+        count += queue->insert(cues[i]) ? 1 : 0;
+    playerLogInfo("subtitle [%s], [%d] cues\n", path, count);
+    return count;
+}
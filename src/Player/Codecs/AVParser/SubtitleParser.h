@@ -0,0 +1,60 @@
+#ifndef __SUBTITLE_PARSER_H__
+#define __SUBTITLE_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SubtitleQueue.h"
+
+
+#define     SUBTITLE_FILE_SIZE_MAX      (16 * 1024 * 1024)  //外挂字幕文件的上限
+
+
+typedef enum {
+    SubtitleFormat_Unknown = 0,
+    SubtitleFormat_SRT,
+    SubtitleFormat_ASS,             //包括 SSA
+} SubtitleFormat;
+
+
+class SubtitleParser { /* 外挂字幕文件：SRT、ASS/SSA 解析为 SubtitleCue，文字按 UTF-8，去掉样式只保留文字和换行 */
+    public:
+        /**
+         *  @Func: parse
+         *         ps. :按内容识别格式([Script Info]/[Events] 为 ASS，否则找 SRT 的时间行)；去掉 UTF-8 BOM，UTF-16 不支持；
+         *               格式错误的条目跳过，不影响其他条目
+         *  @Param: text, type:: const char*, 不要求以 0 结尾
+         *  @Param: size, type:: int
+         *  @Param: cues, type:: std::vector<SubtitleCue>&, 追加，按文件中的顺序
+         *  @Return: int, SubtitleFormat，不能识别时为 SubtitleFormat_Unknown
+         *
+         **/
+        static int parse(const char* text, int size, std::vector<SubtitleCue>& cues);
+        static int parseSRT(const std::string& text, std::vector<SubtitleCue>& cues);   //返回条数
+        static int parseASS(const std::string& text, std::vector<SubtitleCue>& cues);
+
+        /**
+         *  @Func: load
+         *         ps. :读文件、解析，插入到 queue
+         *  @Param: path, type:: const char*
+         *  @Param: queue, type:: SubtitleQueue*
+         *  @Return: int, 插入的条数，打不开、太大或者不能识别时返回 -1
+         *
+         **/
+        static int load(const char* path, SubtitleQueue* queue);
+
+        static int64_t parseTime(const char* text, const char** end);  //[H:]MM:SS[,.]fff，小数按位数换算，错误返回 -1
+        static std::string stripAssTags(const std::string& text);       //去掉 {\...}，\N \n 为换行，\h 为空格
+        static std::string stripHtmlTags(const std::string& text);      //SRT 中的 <i> <font ...> 等
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__SUBTITLE_PARSER_H__
@@ -0,0 +1,829 @@
+/**
+ *  TSParser.cpp文件
+ *  MPEG-TS 流式解复用，用于 IPTV 组播/单播 (APP_PLAYTYPE_IPTV, CODEC_ID_RTP2TS)；
+ *  主要有以下部分：
+ *          188/192/204 字节包同步
+ *          PAT/PMT 解析
+ *          PES 组装为 access unit，输出 PTS/DTS
+ *
+ *  负载不逐包拷贝：access unit 以分片列表的形式指向调用者的缓冲区，
+ *  只有跨越两次 parse() 调用的 PES 才把之前的分片拷贝到内部缓冲区，每个字节最多拷贝一次。
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "LogPlayer.h"
+#include "TSParser.h"
+
+
+typedef enum {
+    TSPidType_PSI = 0,
+    TSPidType_PES
+} TSPidType;
+
+struct TSPidContext {
+    int         pid;
+    int         type;               //TSPidType
+    int         continuity;         //上一个包的 continuity_counter，-1 表示未知
+    bool        lost;               //上一个 access unit 输出后发生过丢包
+    int         programNumber;
+
+    /* PSI */
+    std::vector<uint8_t>    section;
+    int         version;            //PMT 版本，-1 表示未收到
+
+    /* PES */
+    int         streamType;
+    int         streamId;
+    bool        started;            //已收到 payload_unit_start，正在组装
+    bool        headerDone;
+    uint8_t     header[TS_PES_HEADER_SIZE_MAX];     //PES 头跨包时暂存
+    int         headerSize;
+    int         pesRemaining;       //PES_packet_length 剩余字节，-1 表示长度不定
+    int64_t     pts;
+    int64_t     dts;
+    int         flags;
+    int         size;
+    std::vector<TSFragment> fragments;  //本次 parse() 中的分片
+    std::vector<uint8_t>    spill;      //之前 parse() 中的分片
+};
+
+
+/* 静态初始化时生成，多个频道线程同时创建 TSParser 时不需要加锁 */
+class TSCrc32Table {
+    public:
+        TSCrc32Table()
+        {
+            uint32_t i, j, crc;
+
+            for (i = 0; i < 256; i++) {
+                crc = i << 24;
+                for (j = 0; j < 8; j++)
+                    crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+                m_table[i] = crc;
+            }
+        }
+
+        uint32_t m_table[256];
+};
+
+static const TSCrc32Table sCrc32Table;
+
+//MPEG-2 CRC32，对包含 CRC 字段的整个 section 计算结果为 0
+static uint32_t TSCrc32(const uint8_t* data, int length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int i;
+
+    for (i = 0; i < length; i++)
+        crc = (crc << 8) ^ sCrc32Table.m_table[((crc >> 24) ^ data[i]) & 0xFF];
+    return crc;
+}
+
+static int64_t TSReadTimestamp(const uint8_t* p)
+{
+    return ((int64_t)(p[0] & 0x0E) << 29) | ((int64_t)p[1] << 22) | ((int64_t)(p[2] & 0xFE) << 14)
+            | ((int64_t)p[3] << 7) | ((int64_t)p[4] >> 1);
+}
+
+static bool TSStreamIdHasHeader(int streamId)
+{
+    //program_stream_map, padding_stream, private_stream_2, ECM, EMM, DSMCC, H.222.1 type E, program_stream_directory
+    return streamId != 0xBC && streamId != 0xBE && streamId != 0xBF && streamId != 0xF0
+        && streamId != 0xF1 && streamId != 0xF2 && streamId != 0xF8 && streamId != 0xFF;
+}
+
+
+int TSFindSyncByte(const uint8_t* data, int length)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i sync = _mm_set1_epi8(TS_SYNC_BYTE);
+    for (; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), sync));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const uint8x16_t sync = vdupq_n_u8(TS_SYNC_BYTE);
+    for (; i + 16 <= length; i += 16) {
+        uint64x2_t equal = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(data + i), sync));
+        uint64_t low = vgetq_lane_u64(equal, 0);
+        uint64_t high = vgetq_lane_u64(equal, 1);
+        if (low)
+            return i + (__builtin_ctzll(low) >> 3);
+        if (high)
+            return i + 8 + (__builtin_ctzll(high) >> 3);
+    }
+#endif
+    for (; i < length; i++) {
+        if (data[i] == TS_SYNC_BYTE)
+            return i;
+    }
+    return -1;
+}
+
+
+int TSAccessUnitCopy(const TSAccessUnit* au, uint8_t* buffer, int size)
+{
+    int offset = 0;
+    int i;
+
+    if (au == NULL || buffer == NULL || size < au->size)
+        return -1;
+    for (i = 0; i < au->fragmentCount; i++) {
+        memcpy(buffer + offset, au->fragments[i].data, au->fragments[i].size);
+        offset += au->fragments[i].size;
+    }
+    return offset;
+}
+
+
+TSParser::TSParser()
+    : m_selectedProgram(-1)
+    , m_packetSize(0)
+    , m_fixedPacketSize(0)
+    , m_patVersion(-1)
+    , m_carrySize(0)
+    , m_skip(0)
+{
+    memset(m_pids, 0, sizeof(m_pids));
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    createContext(TS_PID_PAT, TSPidType_PSI);
+}
+
+
+TSParser::~TSParser()
+{
+    int pid;
+
+    for (pid = 0; pid < TS_PID_MAX; pid++)
+        delete m_pids[pid];
+}
+
+
+void TSParser::setCallbacks(const TSParserCallbacks& callbacks)
+{
+    m_callbacks = callbacks;
+}
+
+
+int TSParser::selectProgram(int programNumber)
+{
+    m_selectedProgram = programNumber;
+    m_patVersion = -1;      //下一个 PAT 重新建立 PMT/PES
+    return 0;
+}
+
+
+int TSParser::setPacketSize(int packetSize)
+{
+    if (packetSize != 0 && packetSize != TS_PACKET_SIZE && packetSize != TS_PACKET_SIZE_M2TS && packetSize != TS_PACKET_SIZE_FEC) {
+        playerLogError("unsupported ts packet size [%d].\n", packetSize);
+        return -1;
+    }
+    m_fixedPacketSize = packetSize;
+    m_packetSize = packetSize;
+    return 0;
+}
+
+
+void TSParser::reset()
+{
+    int pid;
+
+    for (pid = 0; pid < TS_PID_MAX; pid++) {
+        delete m_pids[pid];
+        m_pids[pid] = NULL;
+    }
+    m_pesPids.clear();
+    m_programs.clear();
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_packetSize = m_fixedPacketSize;
+    m_patVersion = -1;
+    m_carrySize = 0;
+    m_skip = 0;
+    createContext(TS_PID_PAT, TSPidType_PSI);
+}
+
+
+TSPidContext* TSParser::createContext(int pid, int type)
+{
+    TSPidContext* context = m_pids[pid];
+
+    if (context != NULL)
+        return context;
+
+    context = new TSPidContext;
+    context->pid = pid;
+    context->type = type;
+    context->continuity = -1;
+    context->lost = false;
+    context->programNumber = -1;
+    context->version = -1;
+    context->streamType = 0;
+    context->streamId = 0;
+    context->started = false;
+    context->headerDone = false;
+    context->headerSize = 0;
+    context->pesRemaining = -1;
+    context->pts = TS_TIMESTAMP_NONE;
+    context->dts = TS_TIMESTAMP_NONE;
+    context->flags = 0;
+    context->size = 0;
+    m_pids[pid] = context;
+    if (type == TSPidType_PES)
+        m_pesPids.push_back(pid);
+    return context;
+}
+
+
+void TSParser::releaseContext(int pid)
+{
+    TSPidContext* context = m_pids[pid];
+    size_t i;
+
+    if (context == NULL || pid == TS_PID_PAT)
+        return;
+    if (context->type == TSPidType_PES) {
+        for (i = 0; i < m_pesPids.size(); i++) {
+            if (m_pesPids[i] == pid) {
+                m_pesPids.erase(m_pesPids.begin() + i);
+                break;
+            }
+        }
+    }
+    delete context;
+    m_pids[pid] = NULL;
+}
+
+
+int TSParser::detectPacketSize(const uint8_t* data, int length)
+{
+    static const int sizes[3] = { TS_PACKET_SIZE, TS_PACKET_SIZE_M2TS, TS_PACKET_SIZE_FEC };
+    int offset = 0;
+    int found, i, k;
+
+    while ((found = TSFindSyncByte(data + offset, length - offset)) >= 0) {
+        offset += found;
+        for (i = 0; i < 3; i++) {
+            int checked = 0;
+            for (k = 1; k <= 4 && offset + k * sizes[i] < length; k++) {
+                if (data[offset + k * sizes[i]] != TS_SYNC_BYTE)
+                    break;
+                checked++;
+            }
+            //数据不足一包时只能假定为 188
+            if (checked == 4 || (checked > 0 && offset + (checked + 1) * sizes[i] >= length) || (i == 0 && offset + sizes[i] >= length)) {
+                m_packetSize = sizes[i];
+                playerLogInfo("ts packet size [%d], first sync at [%d].\n", m_packetSize, offset);
+                return offset;
+            }
+        }
+        offset++;
+    }
+    return -1;
+}
+
+
+//从 data 中找下一个同步位置，后面一包的位置也是 0x47 时才认为同步
+int TSParser::resync(const uint8_t* data, int length)
+{
+    int offset = 0;
+    int found;
+
+    while ((found = TSFindSyncByte(data + offset, length - offset)) >= 0) {
+        offset += found;
+        if (offset + m_packetSize >= length || data[offset + m_packetSize] == TS_SYNC_BYTE)
+            return offset;
+        offset++;
+    }
+    return -1;
+}
+
+
+int TSParser::parse(const uint8_t* data, int length)
+{
+    int pos = 0;
+
+    if (data == NULL || length < 0)
+        return -1;
+    m_statistics.bytes += length;
+
+    if (m_skip > 0) {
+        pos = (m_skip < length) ? m_skip : length;
+        m_skip -= pos;
+    }
+
+    if (m_carrySize > 0 && pos < length) {
+        int need = TS_PACKET_SIZE - m_carrySize;
+        int count = (need < length - pos) ? need : length - pos;
+        memcpy(m_carry + m_carrySize, data + pos, count);
+        m_carrySize += count;
+        pos += count;
+        if (m_carrySize < TS_PACKET_SIZE)
+            return length;
+        processPacket(m_carry);
+        m_carrySize = 0;
+        pos += m_packetSize - TS_PACKET_SIZE;
+        //m_carry 会被下一个不完整的包覆盖，其中的分片需要先转存
+        spillPendingFragments();
+    }
+
+    if (m_packetSize == 0 && pos < length) {
+        int offset = detectPacketSize(data + pos, length - pos);
+        if (offset < 0)
+            return length;
+        pos += offset;
+    }
+
+    while (pos + TS_PACKET_SIZE <= length) {
+        if (data[pos] != TS_SYNC_BYTE) {
+            int offset;
+            m_statistics.syncLoss++;
+            offset = resync(data + pos, length - pos);
+            if (offset < 0) {
+                pos = length;
+                break;
+            }
+            pos += offset;
+            continue;
+        }
+        processPacket(data + pos);
+        pos += m_packetSize;
+    }
+
+    if (pos < length) {
+        int offset = (data[pos] == TS_SYNC_BYTE) ? 0 : TSFindSyncByte(data + pos, length - pos);
+        if (offset >= 0) {
+            m_carrySize = length - pos - offset;
+            memcpy(m_carry, data + pos + offset, m_carrySize);
+        }
+    } else {
+        m_skip = pos - length;
+    }
+
+    spillPendingFragments();
+    return length;
+}
+
+
+int TSParser::flush()
+{
+    size_t i;
+
+    for (i = 0; i < m_pesPids.size(); i++) {
+        TSPidContext* context = m_pids[m_pesPids[i]];
+        if (context->started && context->headerDone) {
+            if (context->pesRemaining > 0)
+                context->flags |= TSAccessUnit_Truncated;
+            emitAccessUnit(context);
+        }
+        context->started = false;
+    }
+    m_carrySize = 0;
+    m_skip = 0;
+    return 0;
+}
+
+
+void TSParser::processPacket(const uint8_t* packet)
+{
+    int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    TSPidContext* context = m_pids[pid];
+    int control = (packet[3] >> 4) & 0x03;
+    int continuity = packet[3] & 0x0F;
+    int offset = 4;
+    bool discontinuity = false;
+    bool randomAccess = false;
+
+    m_statistics.packets++;
+    if (context == NULL)
+        return;
+
+    if (packet[1] & 0x80) {     //transport_error_indicator
+        m_statistics.transportErrors++;
+        context->lost = true;
+        return;
+    }
+
+    if (control & 0x02) {       //adaptation_field
+        int fieldLength = packet[4];
+        if (fieldLength > 183) {
+            m_statistics.transportErrors++;
+            return;
+        }
+        if (fieldLength > 0) {
+            const uint8_t* field = packet + 5;
+            discontinuity = (field[0] & 0x80) != 0;
+            randomAccess = (field[0] & 0x40) != 0;
+            if ((field[0] & 0x10) && fieldLength >= 7 && m_callbacks.onPCR) {
+                int64_t base = ((int64_t)field[1] << 25) | ((int64_t)field[2] << 17) | ((int64_t)field[3] << 9)
+                                | ((int64_t)field[4] << 1) | ((int64_t)field[5] >> 7);
+                int extension = ((field[5] & 0x01) << 8) | field[6];
+                m_callbacks.onPCR(pid, base * 300 + extension, m_callbacks.userData);
+            }
+        }
+        offset = 5 + fieldLength;
+    }
+    if (!(control & 0x01) || offset >= TS_PACKET_SIZE)     //没有负载时 continuity_counter 不增加
+        return;
+
+    if (context->continuity >= 0 && !discontinuity) {
+        if (continuity == context->continuity)          //重复包
+            return;
+        if (continuity != ((context->continuity + 1) & 0x0F)) {
+            m_statistics.continuityErrors++;
+            context->lost = true;
+        }
+    }
+    context->continuity = continuity;
+
+    if (context->type == TSPidType_PSI)
+        processPsi(context, (packet[1] & 0x40) != 0, packet + offset, TS_PACKET_SIZE - offset);
+    else
+        processPes(context, (packet[1] & 0x40) != 0, randomAccess, packet + offset, TS_PACKET_SIZE - offset);
+}
+
+
+void TSParser::processPsi(TSPidContext* context, bool unitStart, const uint8_t* payload, int length)
+{
+    int pos;
+
+    if (!unitStart) {
+        if (!context->section.empty()) {
+            if (context->lost) {
+                context->section.clear();
+                context->lost = false;
+                return;
+            }
+            appendSection(context, payload, length);
+        }
+        return;
+    }
+
+    pos = 1 + payload[0];       //pointer_field 之前是上一个 section 的结尾
+    if (pos > length)
+        return;
+    if (!context->section.empty() && !context->lost)
+        appendSection(context, payload + 1, pos - 1);
+    context->section.clear();
+    context->lost = false;
+
+    while (pos < length && payload[pos] != 0xFF) {
+        pos += appendSection(context, payload + pos, length - pos);
+        if (!context->section.empty())      //section 未完整，在后续的包中
+            break;
+    }
+}
+
+
+//追加到 context->section，完整时处理并清空，返回使用的字节数
+int TSParser::appendSection(TSPidContext* context, const uint8_t* data, int length)
+{
+    std::vector<uint8_t>& section = context->section;
+    int consumed = 0;
+
+    while (consumed < length) {
+        int total = (section.size() >= 3) ? 3 + (((section[1] & 0x0F) << 8) | section[2]) : 3;
+        int count = total - (int)section.size();
+        if (count > length - consumed)
+            count = length - consumed;
+        section.insert(section.end(), data + consumed, data + consumed + count);
+        consumed += count;
+
+        if (section.size() < 3)
+            break;
+        total = 3 + (((section[1] & 0x0F) << 8) | section[2]);
+        if (total > 1024) {
+            section.clear();
+            return length;
+        }
+        if ((int)section.size() == total) {
+            processSection(context);
+            section.clear();
+            break;
+        }
+    }
+    return consumed;
+}
+
+
+void TSParser::processSection(TSPidContext* context)
+{
+    const uint8_t* section = &context->section[0];
+    int length = context->section.size();
+
+    if (length < 12 || !(section[1] & 0x80))        //PAT/PMT 都有 section_syntax_indicator
+        return;
+    if (TSCrc32(section, length) != 0) {
+        m_statistics.crcErrors++;
+        return;
+    }
+    if (!(section[5] & 0x01))                       //current_next_indicator
+        return;
+
+    if (section[0] == 0x00 && context->pid == TS_PID_PAT)
+        processPat(section, length);
+    else if (section[0] == 0x02)
+        processPmt(context, section, length);
+}
+
+
+void TSParser::processPat(const uint8_t* section, int length)
+{
+    int version = (section[5] >> 1) & 0x1F;
+    int i;
+    size_t j;
+
+    if (version == m_patVersion)
+        return;
+    m_patVersion = version;
+
+    //节目列表变化后重新建立所有 PMT/PES
+    m_programs.clear();
+    for (i = 0; i < TS_PID_MAX; i++) {
+        if (i != TS_PID_PAT && m_pids[i] != NULL)
+            releaseContext(i);
+    }
+
+    for (i = 8; i + 4 <= length - 4; i += 4) {
+        int programNumber = (section[i] << 8) | section[i + 1];
+        int pmtPid = ((section[i + 2] & 0x1F) << 8) | section[i + 3];
+        TSPidContext* context;
+        TSProgramInfo program;
+
+        if (programNumber == 0)             //network_PID
+            continue;
+        if (m_selectedProgram >= 0 && programNumber != m_selectedProgram)
+            continue;
+        context = createContext(pmtPid, TSPidType_PSI);
+        if (context->type != TSPidType_PSI)
+            continue;
+        context->programNumber = programNumber;
+
+        memset(&program, 0, sizeof(program));
+        program.programNumber = programNumber;
+        program.pmtPid = pmtPid;
+        program.pcrPid = TS_PID_NULL;
+        program.version = -1;
+        for (j = 0; j < m_programs.size() && m_programs[j].programNumber != programNumber; j++)
+            ;
+        if (j == m_programs.size())
+            m_programs.push_back(program);
+    }
+    playerLogDebug("PAT version [%d], programs [%d].\n", version, (int)m_programs.size());
+}
+
+
+void TSParser::processPmt(TSPidContext* context, const uint8_t* section, int length)
+{
+    int programNumber = (section[3] << 8) | section[4];
+    int version = (section[5] >> 1) & 0x1F;
+    int infoLength = ((section[10] & 0x0F) << 8) | section[11];
+    TSProgramInfo* program = NULL;
+    TSProgramInfo previous;
+    int i, j;
+    size_t k;
+
+    for (k = 0; k < m_programs.size(); k++) {
+        if (m_programs[k].programNumber == programNumber && m_programs[k].pmtPid == context->pid)
+            program = &m_programs[k];
+    }
+    if (program == NULL || program->version == version)
+        return;
+
+    previous = *program;
+    program->version = version;
+    program->pcrPid = ((section[8] & 0x1F) << 8) | section[9];
+    program->streamCount = 0;
+
+    for (i = 12 + infoLength; i + 5 <= length - 4; ) {
+        int streamType = section[i];
+        int pid = ((section[i + 1] & 0x1F) << 8) | section[i + 2];
+        int esInfoLength = ((section[i + 3] & 0x0F) << 8) | section[i + 4];
+        TSStreamInfo* stream;
+        int end = i + 5 + esInfoLength;
+
+        if (end > length - 4 || program->streamCount >= TS_STREAMS_OF_PROGRAM_MAX)
+            break;
+        stream = &program->streams[program->streamCount++];
+        memset(stream, 0, sizeof(TSStreamInfo));
+        stream->pid = pid;
+        stream->streamType = streamType;
+        for (j = i + 5; j + 2 <= end; j += 2 + section[j + 1]) {
+            int tag = section[j];
+            int descriptorLength = section[j + 1];
+            if (j + 2 + descriptorLength > end)
+                break;
+            if (tag == 0x0A && descriptorLength >= 3)           //ISO_639_language_descriptor
+                memcpy(stream->language, section + j + 2, 3);
+            else if (tag == 0x6A && streamType == TSStreamType_PrivatePES)
+                stream->streamType = TSStreamType_AC3;
+            else if (tag == 0x7A && streamType == TSStreamType_PrivatePES)
+                stream->streamType = TSStreamType_EAC3;
+            else if (tag == 0x59 && streamType == TSStreamType_PrivatePES) {
+                stream->streamType = TSStreamType_DVBSubtitle;
+                if (descriptorLength >= 3)
+                    memcpy(stream->language, section + j + 2, 3);
+            }
+        }
+        i = end;
+    }
+
+    //释放新 PMT 中已不存在的 PES
+    for (i = 0; i < previous.streamCount; i++) {
+        int pid = previous.streams[i].pid;
+        for (j = 0; j < program->streamCount && program->streams[j].pid != pid; j++)
+            ;
+        if (j == program->streamCount && m_pids[pid] && m_pids[pid]->type == TSPidType_PES && m_pids[pid]->programNumber == programNumber)
+            releaseContext(pid);
+    }
+    for (i = 0; i < program->streamCount; i++) {
+        TSPidContext* stream = createContext(program->streams[i].pid, TSPidType_PES);
+        if (stream->type != TSPidType_PES)
+            continue;
+        stream->programNumber = programNumber;
+        stream->streamType = program->streams[i].streamType;
+    }
+
+    playerLogDebug("PMT program [%d] version [%d], streams [%d].\n", programNumber, version, program->streamCount);
+    if (m_callbacks.onProgram)
+        m_callbacks.onProgram(program, m_callbacks.userData);
+}
+
+
+//解析完整的 PES 头，返回头长度，出错时返回 -1
+int TSParser::parsePesHeader(TSPidContext* context, const uint8_t* header, int length)
+{
+    int pesLength;
+    int headerLength = 6;
+
+    if (header[0] != 0x00 || header[1] != 0x00 || header[2] != 0x01)
+        return -1;
+    context->streamId = header[3];
+    pesLength = (header[4] << 8) | header[5];
+
+    if (TSStreamIdHasHeader(context->streamId)) {
+        int ptsDtsFlags = header[7] >> 6;
+        headerLength = 9 + header[8];
+        if (headerLength > length)
+            return -1;
+        if ((ptsDtsFlags & 0x02) && headerLength >= 14)
+            context->pts = TSReadTimestamp(header + 9);
+        if (ptsDtsFlags == 0x03 && headerLength >= 19)
+            context->dts = TSReadTimestamp(header + 14);
+        else
+            context->dts = context->pts;
+    }
+
+    context->pesRemaining = pesLength ? pesLength - (headerLength - 6) : -1;
+    if (pesLength && context->pesRemaining < 0)
+        return -1;
+    return headerLength;
+}
+
+
+void TSParser::processPes(TSPidContext* context, bool unitStart, bool randomAccess, const uint8_t* payload, int length)
+{
+    if (unitStart) {
+        if (context->started && context->headerDone) {
+            if (context->pesRemaining > 0)
+                context->flags |= TSAccessUnit_Truncated;
+            emitAccessUnit(context);
+        }
+        context->started = true;
+        context->headerDone = false;
+        context->headerSize = 0;
+        context->pesRemaining = -1;
+        context->pts = TS_TIMESTAMP_NONE;
+        context->dts = TS_TIMESTAMP_NONE;
+        context->flags = randomAccess ? TSAccessUnit_RandomAccess : 0;
+        context->size = 0;
+        context->fragments.clear();
+        context->spill.clear();
+        if (context->lost)
+            context->lost = false;      //丢包发生在上一个 access unit
+    } else if (!context->started) {
+        return;
+    }
+    if (context->lost) {
+        context->flags |= TSAccessUnit_Discontinuity;
+        context->lost = false;
+    }
+
+    if (!context->headerDone) {
+        int headerLength;
+        if (context->headerSize == 0 && length >= 9 && length >= 9 + payload[8]) {
+            //常见情况：PES 头在第一个包内，直接解析
+            headerLength = parsePesHeader(context, payload, length);
+        } else {
+            //PES 头跨包，先拷贝到 context->header
+            int need = 6;
+            int count;
+            for (;;) {
+                if (context->headerSize >= 6 && TSStreamIdHasHeader(context->header[3]))
+                    need = (context->headerSize >= 9) ? 9 + context->header[8] : 9;
+                if (context->headerSize >= need)
+                    break;
+                if (length == 0)
+                    return;
+                count = need - context->headerSize;
+                if (count > length)
+                    count = length;
+                memcpy(context->header + context->headerSize, payload, count);
+                context->headerSize += count;
+                payload += count;
+                length -= count;
+            }
+            headerLength = parsePesHeader(context, context->header, context->headerSize);
+            if (headerLength >= 0)
+                headerLength = 0;       //payload 已经跳过了头
+        }
+        if (headerLength < 0) {
+            playerLogWarning("invalid PES header on pid [%d].\n", context->pid);
+            context->started = false;
+            return;
+        }
+        payload += headerLength;
+        length -= headerLength;
+        context->headerDone = true;
+    }
+
+    if (context->pesRemaining >= 0 && length > context->pesRemaining)
+        length = context->pesRemaining;
+    if (length > 0) {
+        TSFragment fragment;
+        fragment.data = payload;
+        fragment.size = length;
+        context->fragments.push_back(fragment);
+        context->size += length;
+        if (context->pesRemaining >= 0)
+            context->pesRemaining -= length;
+    }
+    if (context->pesRemaining == 0)
+        emitAccessUnit(context);
+}
+
+
+void TSParser::emitAccessUnit(TSPidContext* context)
+{
+    TSAccessUnit au;
+
+    m_emitFragments.clear();
+    if (!context->spill.empty()) {
+        TSFragment fragment;
+        fragment.data = &context->spill[0];
+        fragment.size = context->spill.size();
+        m_emitFragments.push_back(fragment);
+    }
+    m_emitFragments.insert(m_emitFragments.end(), context->fragments.begin(), context->fragments.end());
+
+    au.pid = context->pid;
+    au.programNumber = context->programNumber;
+    au.streamType = context->streamType;
+    au.streamId = context->streamId;
+    au.pts = context->pts;
+    au.dts = context->dts;
+    au.flags = context->flags;
+    au.size = context->size;
+    au.fragments = m_emitFragments.empty() ? NULL : &m_emitFragments[0];
+    au.fragmentCount = m_emitFragments.size();
+
+    m_statistics.accessUnits++;
+    if (m_callbacks.onAccessUnit)
+        m_callbacks.onAccessUnit(&au, m_callbacks.userData);
+
+    context->started = false;
+    context->headerDone = false;
+    context->size = 0;
+    context->fragments.clear();
+    context->spill.clear();     //保留容量，下一个 access unit 复用
+}
+
+
+//分片指向调用者的缓冲区，parse() 返回前拷贝到 spill
+void TSParser::spillPendingFragments()
+{
+    size_t i, j;
+
+    for (i = 0; i < m_pesPids.size(); i++) {
+        TSPidContext* context = m_pids[m_pesPids[i]];
+        for (j = 0; j < context->fragments.size(); j++) {
+            const TSFragment& fragment = context->fragments[j];
+            context->spill.insert(context->spill.end(), fragment.data, fragment.data + fragment.size);
+            m_statistics.spilledBytes += fragment.size;
+        }
+        context->fragments.clear();
+    }
+}
@@ -1 +1,173 @@
- 
\ No newline at end of file
+#ifndef __TS_PARSER_H__
+#define __TS_PARSER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     TS_PACKET_SIZE              188
+#define     TS_PACKET_SIZE_M2TS         192     //4 字节 TP_extra_header + 188，同步字节在第 4 字节
+#define     TS_PACKET_SIZE_FEC          204     //188 + 16 字节 RS 校验
+#define     TS_SYNC_BYTE                0x47
+#define     TS_PID_MAX                  8192
+#define     TS_PID_PAT                  0x0000
+#define     TS_PID_NULL                 0x1FFF
+#define     TS_TIMESTAMP_NONE           ((int64_t)-1)
+#define     TS_STREAMS_OF_PROGRAM_MAX   16
+#define     TS_PES_HEADER_SIZE_MAX      (9 + 255)
+
+
+typedef enum {
+    TSStreamType_MPEG1Video     = 0x01,
+    TSStreamType_MPEG2Video     = 0x02,
+    TSStreamType_MPEG1Audio     = 0x03,
+    TSStreamType_MPEG2Audio     = 0x04,
+    TSStreamType_PrivatePES     = 0x06,
+    TSStreamType_AAC            = 0x0F,     //ADTS
+    TSStreamType_AACLatm        = 0x11,
+    TSStreamType_H264           = 0x1B,
+    TSStreamType_H265           = 0x24,
+    TSStreamType_AC3            = 0x81,
+    TSStreamType_EAC3           = 0x87,
+    TSStreamType_DVBSubtitle    = 0x100     //0x06 + subtitling_descriptor，不是标准值
+} TSStreamType;
+
+typedef enum {
+    TSAccessUnit_RandomAccess   = 1,        //适配域中 random_access_indicator 置位
+    TSAccessUnit_Discontinuity  = 1 << 1,   //组装过程中有丢包(continuity_counter 不连续或 transport_error)
+    TSAccessUnit_Truncated      = 1 << 2    //PES_packet_length 指定的数据没有收全
+} TSAccessUnitFlag;
+
+
+typedef struct _TSFragment {
+    const uint8_t*  data;
+    int             size;
+} TSFragment;
+
+typedef struct _TSAccessUnit {  /* 一个完整的 PES 负载 */
+    int             pid;
+    int             programNumber;
+    int             streamType;     //TSStreamType
+    int             streamId;       //PES stream_id
+    int64_t         pts;            //90kHz，TS_TIMESTAMP_NONE 表示没有
+    int64_t         dts;
+    int             flags;          //TSAccessUnitFlag
+    int             size;
+    const TSFragment*   fragments;  //只在回调中有效，指向调用者的缓冲区，跨 parse() 的部分指向内部缓冲区
+    int             fragmentCount;
+} TSAccessUnit;
+
+typedef struct _TSStreamInfo {
+    int             pid;
+    int             streamType;
+    char            language[4];    //ISO_639_language_descriptor，没有时为空
+} TSStreamInfo;
+
+typedef struct _TSProgramInfo {
+    int             programNumber;
+    int             pmtPid;
+    int             pcrPid;
+    int             version;
+    int             streamCount;
+    TSStreamInfo    streams[TS_STREAMS_OF_PROGRAM_MAX];
+} TSProgramInfo;
+
+typedef struct _TSParserCallbacks {
+    void (*onProgram)(const TSProgramInfo* program, void* userData);    //PMT 版本变化时
+    void (*onAccessUnit)(const TSAccessUnit* au, void* userData);
+    void (*onPCR)(int pid, int64_t pcr, void* userData);                //27MHz
+    void*   userData;
+} TSParserCallbacks;
+
+typedef struct _TSParserStatistics {
+    int64_t     bytes;
+    int64_t     packets;
+    int64_t     accessUnits;
+    int64_t     spilledBytes;       //PES 跨 parse() 时拷贝到内部缓冲区的字节数
+    int         syncLoss;
+    int         continuityErrors;
+    int         transportErrors;
+    int         crcErrors;
+} TSParserStatistics;
+
+
+/**
+ *  @Func: TSFindSyncByte
+ *         ps. :查找第一个 0x47，SSE2 / NEON 每次比较 16 字节，其他平台逐字节比较
+ *  @Param: data, type:: const uint8_t*
+ *  @Param: length, type:: int
+ *  @Return: int, 偏移，没有找到时返回 -1
+ *
+ **/
+int TSFindSyncByte(const uint8_t* data, int length);
+
+/**
+ *  @Func: TSAccessUnitCopy
+ *         ps. :把 access unit 的各个分片拷贝为连续的数据
+ *  @Param: au, type:: const TSAccessUnit*
+ *  @Param: buffer, type:: uint8_t*
+ *  @Param: size, type:: int, 小于 au->size 时返回 -1
+ *  @Return: int, 拷贝的字节数
+ *
+ **/
+int TSAccessUnitCopy(const TSAccessUnit* au, uint8_t* buffer, int size);
+
+
+struct TSPidContext;
+
+class TSParser { /* 流式 TS 解复用：直接在调用者的缓冲区上解析，PES 负载以分片的形式输出，不逐包拷贝 */
+    public:
+        TSParser();
+        ~TSParser();
+
+        void setCallbacks(const TSParserCallbacks& callbacks);
+        int selectProgram(int programNumber);           //-1: 所有节目(默认)，在下一个 PAT 生效
+        int setPacketSize(int packetSize);              //0: 自动检测 188/192/204
+        int parse(const uint8_t* data, int length);     //data 可以是任意长度，不要求按包对齐
+        int flush();                                    //码流结束时输出未完成的 access unit
+        void reset();
+
+        int getPacketSize() { return m_packetSize; }
+        const std::vector<TSProgramInfo>& getPrograms() { return m_programs; }
+        const TSParserStatistics& getStatistics() { return m_statistics; }
+
+    private:
+        int detectPacketSize(const uint8_t* data, int length);
+        int resync(const uint8_t* data, int length);
+        void processPacket(const uint8_t* packet);
+        void processPsi(TSPidContext* context, bool unitStart, const uint8_t* payload, int length);
+        int appendSection(TSPidContext* context, const uint8_t* data, int length);
+        void processSection(TSPidContext* context);
+        void processPat(const uint8_t* section, int length);
+        void processPmt(TSPidContext* context, const uint8_t* section, int length);
+        void processPes(TSPidContext* context, bool unitStart, bool randomAccess, const uint8_t* payload, int length);
+        int parsePesHeader(TSPidContext* context, const uint8_t* header, int length);
+        void emitAccessUnit(TSPidContext* context);
+        void spillPendingFragments();
+        TSPidContext* createContext(int pid, int type);
+        void releaseContext(int pid);
+
+        TSPidContext*               m_pids[TS_PID_MAX];     //未关心的 PID 为 NULL
+        std::vector<int>            m_pesPids;              //当前所有 PES 的 PID
+        std::vector<TSProgramInfo>  m_programs;
+        std::vector<TSFragment>     m_emitFragments;
+        TSParserCallbacks           m_callbacks;
+        TSParserStatistics          m_statistics;
+        int                         m_selectedProgram;
+        int                         m_packetSize;
+        int                         m_fixedPacketSize;      //通过 setPacketSize 指定时不再自动检测
+        int                         m_patVersion;
+        uint8_t                     m_carry[TS_PACKET_SIZE];    //跨 parse() 的不完整的包
+        int                         m_carrySize;
+        int                         m_skip;                 //下次 parse() 开头需要跳过的字节(192/204 包的尾部)
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__TS_PARSER_H__
@@ -0,0 +1,176 @@
+/**
+ *  TeletextDecoder.cpp文件
+ *  EBU 图文电视字幕的解码；
+ *  主要有以下部分：
+ *      1. PES：data_identifier 0x10~0x1F，之后为数据单元，0x02/0x03 为 44 字节的 teletext 数据，除前两个字节外按位序反转
+ *      2. 包：地址为 Hamming 8/4 编码的杂志号和包号，包 0 为页头(页号、C4 清除、C6 字幕、C11 串行)，包 1~23 为奇校验的字符行
+ *      3. 页：选中的页从页头开始收，下一个页头(串行模式任何杂志，并行模式同一杂志)到达时结束，各行去掉控制码后合并为文字
+ *      字符按 G0 拉丁字符集的基本部分输出为 ASCII，不处理国家字符集和 G2 附加字符
+ *
+ **/
+
+#include <string.h>
+
+#include "LogPlayer.h"
+#include "TeletextDecoder.h"
+
+
+#define     TELETEXT_DATA_ID_MIN        0x10
+#define     TELETEXT_DATA_ID_MAX        0x1F
+#define     TELETEXT_UNIT_NONSUBTITLE   0x02
+#define     TELETEXT_UNIT_SUBTITLE      0x03
+#define     TELETEXT_PAGE_NONE          0xFF        //页号为 0xFF 的页头只用于填充时间
+
+
+static uint8_t TeletextReverse(uint8_t value)
+{
+    value = (uint8_t)(((value & 0xF0) >> 4) | ((value & 0x0F) << 4));
+    value = (uint8_t)(((value & 0xCC) >> 2) | ((value & 0x33) << 2));
+    value = (uint8_t)(((value & 0xAA) >> 1) | ((value & 0x55) << 1));
+    return value;
+}
+
+/* Hamming 8/4：反转后 bit1、3、5、7 为数据位 D1~D4，不做纠错 */
+static int TeletextUnham(uint8_t value)
+{
+    return ((value >> 1) & 1) | ((value >> 2) & 2) | ((value >> 3) & 4) | ((value >> 4) & 8);
+}
+
+/* 奇校验，错误或控制码时为空格 */
+static char TeletextChar(uint8_t value)
+{
+    uint8_t parity = value;
+
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+    if ((parity & 1) == 0)
+        return ' ';
+    value &= 0x7F;
+    if (value < 0x20 || value == 0x7F)
+        return ' ';
+    return (char)value;
+}
+
+
+TeletextDecoder::TeletextDecoder()
+    : m_page(0)
+    , m_autoPage(true)
+{
+    reset();
+}
+
+void TeletextDecoder::setPage(int page)
+{
+    m_autoPage = page == 0;
+    m_page = page;
+    m_receiving = false;
+}
+
+void TeletextDecoder::reset()
+{
+    m_receiving = false;
+    m_serial = false;
+    m_magazine = 0;
+    m_pageStartUs = 0;
+    memset(m_rows, 0, sizeof(m_rows));
+}
+
+void TeletextDecoder::finishPage(std::vector<SubtitleCue>& cues)
+{
+    SubtitleCue cue;
+    std::string line;
+    int row, begin, end;
+
+    SubtitleCueInit(&cue, m_pageStartUs, -1);
+    for (row = 1; row < TELETEXT_ROWS - 1; row++) {
+        if (m_rows[row][0] == 0)
+            continue;
+        for (begin = 0; begin < TELETEXT_COLUMNS && m_rows[row][begin] == ' '; begin++);
+        for (end = TELETEXT_COLUMNS; end > begin && m_rows[row][end - 1] == ' '; end--);
+        if (begin == end)
+            continue;
+        line.assign(m_rows[row] + begin, end - begin);
+        if (!cue.text.empty())
+            cue.text += '\n';
+        cue.text += line;
+    }
+    /* 空页也要输出，用来清除前面的字幕 */
+    cues.push_back(cue);
+    m_receiving = false;
+}
+
+void TeletextDecoder::processPacket(const uint8_t* packet, int64_t ptsUs, std::vector<SubtitleCue>& cues)
+{
+    int address = (TeletextUnham(packet[1]) << 4) | TeletextUnham(packet[0]);
+    int magazine = address & 0x07, row = address >> 3, page, i;
+    const uint8_t* data = packet + 2;
+    bool subtitle;
+    unsigned int j;
+
+    if (magazine == 0)
+        magazine = 8;
+
+    if (row == 0) {
+        if (((TeletextUnham(data[1]) << 4) | TeletextUnham(data[0])) == TELETEXT_PAGE_NONE)
+            return;
+        page = (magazine << 8) | (TeletextUnham(data[1]) << 4) | TeletextUnham(data[0]);
+        subtitle = (TeletextUnham(data[5]) & 0x08) != 0;
+
+        /* 当前页在下一个页头结束 */
+        if (m_receiving && (m_serial || magazine == m_magazine))
+            finishPage(cues);
+
+        if (subtitle) {
+            for (j = 0; j < m_subtitlePages.size() && m_subtitlePages[j] != page; j++);
+            if (j == m_subtitlePages.size()) {
+                m_subtitlePages.push_back(page);
+                playerLogInfo("teletext subtitle page [%03x]\n", page);
+            }
+            if (m_autoPage && m_page == 0)
+                m_page = page;
+        }
+        if (page != m_page)
+            return;
+
+        m_receiving = true;
+        m_serial = (TeletextUnham(data[7]) & 0x01) != 0;
+        m_magazine = magazine;
+        m_pageStartUs = ptsUs;
+        /* C4 清除页，字幕页的每次传输都带着 */
+        if (TeletextUnham(data[3]) & 0x08)
+            memset(m_rows, 0, sizeof(m_rows));
+        return;
+    }
+
+    if (!m_receiving || magazine != m_magazine || row >= TELETEXT_ROWS - 1)
+        return;
+    for (i = 0; i < TELETEXT_COLUMNS; i++)
+        m_rows[row][i] = TeletextChar(data[i]);
+    m_rows[row][TELETEXT_COLUMNS] = 0;
+}
+
+int TeletextDecoder::decode(const uint8_t* data, int size, int64_t ptsUs, std::vector<SubtitleCue>& cues)
+{
+    uint8_t packet[TELETEXT_DATA_UNIT_SIZE - 2];
+    int offset = 1, unitId, unitSize, count = cues.size(), i;
+
+    if (size < 1 || data[0] < TELETEXT_DATA_ID_MIN || data[0] > TELETEXT_DATA_ID_MAX)
+        return -1;
+
+    while (offset + 2 <= size) {
+        unitId = data[offset];
+        unitSize = data[offset + 1];
+        offset += 2;
+        if (offset + unitSize > size)
+            break;
+        /* 数据单元：field_parity/line_offset、framing_code(0xE4)、地址 2 字节、数据 40 字节 */
+        if ((unitId == TELETEXT_UNIT_NONSUBTITLE || unitId == TELETEXT_UNIT_SUBTITLE) && unitSize == TELETEXT_DATA_UNIT_SIZE) {
+            for (i = 0; i < TELETEXT_DATA_UNIT_SIZE - 2; i++)
+                packet[i] = TeletextReverse(data[offset + 2 + i]);
+            processPacket(packet, ptsUs, cues);
+        }
+        offset += unitSize;
+    }
+    return cues.size() - count;
+}
@@ -0,0 +1,67 @@
+#ifndef __TELETEXT_DECODER_H__
+#define __TELETEXT_DECODER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SubtitleQueue.h"
+
+
+#define     TELETEXT_DATA_UNIT_SIZE     44      //EN 300 472 中 EBU teletext 数据单元的长度
+#define     TELETEXT_ROWS               25      //0 为页头，1~23 为显示的行，24 不用
+#define     TELETEXT_COLUMNS            40
+
+
+class TeletextDecoder { /* DVB 中的 EBU 图文电视字幕(EN 300 472 / ETS 300 706)，PES 数据得到字幕页的文字；ffmpeg 0.8 没有这个解码器 */
+    public:
+        TeletextDecoder();
+
+        /**
+         *  @Func: setPage
+         *         ps. :page 为 0x100~0x8FF(例如 0x888)，0 为自动选择第一个标记为字幕(C6)的页
+         *  @Param: page, type:: int
+         *  @Return: void
+         *
+         **/
+        void setPage(int page);
+        int getPage() { return m_page; }
+        const std::vector<int>& getSubtitlePages() { return m_subtitlePages; }     //出现过的字幕页
+
+        /**
+         *  @Func: decode
+         *         ps. :一个 PES 的数据(data_identifier 开始)；选中的页在下一个页头到达时结束，
+         *               按页头的时间生成一条 open 字幕，空页生成一条清除字幕
+         *  @Param: data, type:: const uint8_t*
+         *  @Param: size, type:: int
+         *  @Param: ptsUs, type:: int64_t, 媒体时间
+         *  @Param: cues, type:: std::vector<SubtitleCue>&, 追加
+         *  @Return: int, 追加的条数，不是 EBU teletext 数据返回 -1
+         *
+         **/
+        int decode(const uint8_t* data, int size, int64_t ptsUs, std::vector<SubtitleCue>& cues);
+        void reset();           //seek 之后丢弃收了一半的页
+
+    private:
+        void processPacket(const uint8_t* packet, int64_t ptsUs, std::vector<SubtitleCue>& cues);  //位序已经反转的 42 字节
+        void finishPage(std::vector<SubtitleCue>& cues);
+
+        int                 m_page;             //当前选中的页，0 为还没有选中
+        bool                m_autoPage;
+        bool                m_receiving;        //正在收选中的页
+        bool                m_serial;           //页头 C11：串行模式时任何页头都结束当前页
+        int                 m_magazine;         //正在收的页所在的杂志，1~8
+        int64_t             m_pageStartUs;
+        char                m_rows[TELETEXT_ROWS][TELETEXT_COLUMNS + 1];
+        std::vector<int>    m_subtitlePages;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__TELETEXT_DECODER_H__
@@ -0,0 +1,714 @@
+/**
+ *  TestDemuxer.cpp文件
+ *  Demuxer 框架的测试：
+ *          格式探测：H.265 裸码流、FLV、由 H.265 access unit 生成的 TS(PTS 回绕) 和 MP4、生成的 MP3
+ *          各格式读取全部 packet，检查数据、时间戳、关键帧，seek 之后第一个 packet 为关键帧，关闭流后不再输出
+ *          DemuxPacketPool：复用、多线程 ref/unref，与每次 malloc/free 的耗时对比
+ *
+ *  用法：TestDemuxer.elf [file.h265] [file.flv] [media]
+ *          默认为 bigbuckbunny_480x272.h265 和 cuc_ieschool.flv，指定 media 时再读取该文件并统计速度
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "H264Parser.h"
+#include "MP3Parser.h"
+#include "TSParser.h"
+#include "Demuxer.h"
+
+
+#define     TEST_REPEAT                 4           //h265 文件只有一个关键帧，重复几次用于测试 seek
+#define     TEST_FRAME_DURATION         3600        //90kHz，25fps
+#define     TEST_TS_START_PTS           (((int64_t)1 << 33) - 2 * 90000)    //2 秒后回绕
+#define     TEST_VIDEO_PID              0x100
+#define     TEST_AUDIO_PID              0x101
+#define     TEST_PMT_PID                0x1000
+#define     TEST_POOL_THREADS           4
+#define     TEST_POOL_ITERATIONS        200000
+
+
+typedef std::vector<uint8_t> TestBuffer;
+
+typedef struct {
+    std::vector<TestBuffer>     units;      //Annex-B access unit
+    std::vector<int>            keyframes;
+    TestBuffer                  config;     //hvcC
+} TestStream;
+
+typedef struct {
+    std::vector<int>            packets;    //每个流的 packet 数
+    std::vector<int>            keyframes;
+    std::vector<uint32_t>       checksums;
+    std::vector<int64_t>        firstPts;
+    std::vector<int64_t>        lastPts;
+    bool                        ptsIncreasing;  //第一个流的 PTS 单调递增(没有 B 帧时)
+} TestResult;
+
+
+static double TestNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t TestChecksum(uint32_t sum, const uint8_t* data, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        sum = sum * 31 + data[i];
+    return sum;
+}
+
+static int TestMemoryRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    const TestBuffer* data = (const TestBuffer*)opaque;
+
+    if (offset >= (int64_t)data->size())
+        return 0;
+    if (offset + size > (int64_t)data->size())
+        size = data->size() - offset;
+    memcpy(buffer, &(*data)[offset], size);
+    return size;
+}
+
+static DemuxSource TestMemorySource(const TestBuffer& data)
+{
+    DemuxSource source;
+    source.read = TestMemoryRead;
+    source.size = data.size();
+    source.opaque = (void*)&data;
+    return source;
+}
+
+static bool TestReadFile(const char* path, TestBuffer& data)
+{
+    FILE* fp = fopen(path, "rb");
+    long size;
+
+    if (fp == NULL)
+        return false;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data.resize(size);
+    if (size > 0 && fread(&data[0], 1, size, fp) != (size_t)size)
+        data.clear();
+    fclose(fp);
+    return !data.empty();
+}
+
+static void TestReadAll(Demuxer* demuxer, TestResult& result)
+{
+    DemuxPacket* packet;
+    int count = demuxer->getStreamCount();
+
+    result.packets.assign(count, 0);
+    result.keyframes.assign(count, 0);
+    result.checksums.assign(count, 0);
+    result.firstPts.assign(count, DEMUX_TIMESTAMP_NONE);
+    result.lastPts.assign(count, DEMUX_TIMESTAMP_NONE);
+    result.ptsIncreasing = true;
+    while (demuxer->readPacket(&packet) == 0) {
+        int i = packet->streamIndex;
+        result.packets[i]++;
+        if (packet->flags & DemuxPacket_Keyframe)
+            result.keyframes[i]++;
+        result.checksums[i] = TestChecksum(result.checksums[i], packet->data, packet->size);
+        if (result.firstPts[i] == DEMUX_TIMESTAMP_NONE)
+            result.firstPts[i] = packet->ptsUs;
+        else if (i == 0 && packet->ptsUs <= result.lastPts[i])
+            result.ptsIncreasing = false;
+        result.lastPts[i] = packet->ptsUs;
+        DemuxPacketUnref(packet);
+    }
+}
+
+/* seek 之后的第一个 packet 必须是视频关键帧 */
+static bool TestSeek(Demuxer* demuxer, int64_t timeUs, int64_t* ptsUs)
+{
+    DemuxPacket* packet;
+    bool ok;
+
+    if (demuxer->seek(timeUs) < 0 || demuxer->readPacket(&packet) != 0)
+        return false;
+    ok = (packet->flags & DemuxPacket_Keyframe) && demuxer->getStream(packet->streamIndex)->type == DemuxStream_Video;
+    *ptsUs = packet->ptsUs;
+    DemuxPacketUnref(packet);
+    return ok;
+}
+
+
+/* H.265 文件拆分为 access unit，重复 TEST_REPEAT 次 */
+static void TestOnAccessUnit(const H26xAccessUnit* au, void* userData)
+{
+    TestStream* stream = (TestStream*)userData;
+
+    if (au->isKeyframe)
+        stream->keyframes.push_back(stream->units.size());
+    stream->units.push_back(TestBuffer(au->data, au->data + au->size));
+}
+
+static bool TestLoadStream(const TestBuffer& file, TestStream& stream)
+{
+    H264Parser parser(H26xCodec_H265);
+    H264ParserCallbacks callbacks = { TestOnAccessUnit, &stream };
+    int count, i, j;
+
+    parser.setCallbacks(callbacks);
+    parser.parse(&file[0], file.size(), -1, -1);
+    parser.flush();
+    parser.getDecoderConfig(stream.config);
+    count = stream.units.size();
+    if (count == 0 || stream.keyframes.empty())
+        return false;
+    for (i = 1; i < TEST_REPEAT; i++) {
+        for (j = 0; j < count; j++) {
+            if (j == stream.keyframes[0])
+                stream.keyframes.push_back(stream.units.size());
+            stream.units.push_back(stream.units[j]);
+        }
+    }
+    return true;
+}
+
+
+/* TS 生成 */
+static uint32_t TestCrc32(const uint8_t* data, int length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int i, k;
+    for (i = 0; i < length; i++) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (k = 0; k < 8; k++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+    }
+    return crc;
+}
+
+static void TestPacketize(TestBuffer& out, int pid, const uint8_t* data, int size, uint8_t* continuity)
+{
+    bool first = true;
+
+    while (size > 0) {
+        uint8_t packet[TS_PACKET_SIZE];
+        int count = std::min(size, TS_PACKET_SIZE - 4), header = 4;
+
+        memset(packet, 0xFF, sizeof(packet));
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = (first ? 0x40 : 0x00) | (pid >> 8);
+        packet[2] = pid & 0xFF;
+        if (count < TS_PACKET_SIZE - 4) {       //最后一包用适配域填充
+            int stuffing = TS_PACKET_SIZE - 4 - count;
+            packet[3] = 0x30 | (*continuity & 0x0F);
+            packet[4] = stuffing - 1;
+            if (stuffing > 1)
+                packet[5] = 0x00;
+            header = 4 + stuffing;
+        } else {
+            packet[3] = 0x10 | (*continuity & 0x0F);
+        }
+        (*continuity)++;
+        memcpy(packet + header, data, count);
+        out.insert(out.end(), packet, packet + TS_PACKET_SIZE);
+        data += count;
+        size -= count;
+        first = false;
+    }
+}
+
+static void TestWriteSection(TestBuffer& out, int pid, TestBuffer section, uint8_t* continuity)
+{
+    uint32_t crc;
+
+    section[1] = 0xB0 | (((section.size() + 1) >> 8) & 0x0F);
+    section[2] = (section.size() + 1) & 0xFF;
+    crc = TestCrc32(&section[0], section.size());
+    section.push_back(crc >> 24);
+    section.push_back(crc >> 16);
+    section.push_back(crc >> 8);
+    section.push_back(crc);
+    section.insert(section.begin(), 0);     //pointer_field
+    TestPacketize(out, pid, &section[0], section.size(), continuity);
+}
+
+static void TestWritePes(TestBuffer& out, int pid, int streamId, const uint8_t* data, int size, int64_t pts, uint8_t* continuity)
+{
+    TestBuffer pes(14);
+
+    pes[2] = 1; pes[3] = streamId;
+    pes[6] = 0x80; pes[7] = 0x80; pes[8] = 5;
+    pts &= ((int64_t)1 << 33) - 1;
+    pes[9] = 0x21 | ((pts >> 29) & 0x0E);
+    pes[10] = pts >> 22; pes[11] = ((pts >> 14) & 0xFE) | 1;
+    pes[12] = pts >> 7; pes[13] = ((pts << 1) & 0xFE) | 1;
+    pes.insert(pes.end(), data, data + size);
+    TestPacketize(out, pid, &pes[0], pes.size(), continuity);
+}
+
+static void TestBuildTS(const TestStream& stream, TestBuffer& out)
+{
+    static const uint8_t pat[] = { 0x00, 0, 0, 0x00, 0x01, 0xC1, 0, 0, 0, 1, 0xE0 | (TEST_PMT_PID >> 8), TEST_PMT_PID & 0xFF };
+    static const uint8_t pmt[] = { 0x02, 0, 0, 0, 1, 0xC1, 0, 0, 0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0,
+                                   TSStreamType_H265, 0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0,
+                                   TSStreamType_AAC, 0xE0 | (TEST_AUDIO_PID >> 8), TEST_AUDIO_PID & 0xFF, 0xF0, 0 };
+    uint8_t continuity[4] = { 0, 0, 0, 0 }, audio[200];     //PAT, PMT, 视频, 音频
+    size_t i;
+
+    memset(audio, 0x55, sizeof(audio));
+    audio[0] = 0xFF; audio[1] = 0xF1;
+    for (i = 0; i < stream.units.size(); i++) {
+        int64_t pts = TEST_TS_START_PTS + (int64_t)i * TEST_FRAME_DURATION;
+        if (i % 10 == 0) {
+            TestWriteSection(out, TS_PID_PAT, TestBuffer(pat, pat + sizeof(pat)), &continuity[0]);
+            TestWriteSection(out, TEST_PMT_PID, TestBuffer(pmt, pmt + sizeof(pmt)), &continuity[1]);
+        }
+        TestWritePes(out, TEST_VIDEO_PID, 0xE0, &stream.units[i][0], stream.units[i].size(), pts, &continuity[2]);
+        TestWritePes(out, TEST_AUDIO_PID, 0xC0, audio, sizeof(audio), pts, &continuity[3]);
+    }
+}
+
+
+/* MP4 生成：一个 hvc1 track，sample 为 4 字节长度前缀 */
+class TestWriter {
+    public:
+        TestBuffer data;
+
+        void u8(uint32_t v) { data.push_back(v); }
+        void u16(uint32_t v) { u8(v >> 8); u8(v); }
+        void u32(uint32_t v) { u16(v >> 16); u16(v); }
+        void zero(int n) { data.insert(data.end(), n, 0); }
+        void bytes(const TestBuffer& v) { data.insert(data.end(), v.begin(), v.end()); }
+        size_t begin(const char* type) { size_t pos = data.size(); u32(0); data.insert(data.end(), type, type + 4); return pos; }
+        size_t full(const char* type, int version, uint32_t flags) { size_t pos = begin(type); u32((version << 24) | flags); return pos; }
+        void end(size_t pos)
+        {
+            uint32_t size = data.size() - pos;
+            data[pos] = size >> 24; data[pos + 1] = size >> 16; data[pos + 2] = size >> 8; data[pos + 3] = size;
+        }
+};
+
+static void TestBuildMP4(const TestStream& stream, TestBuffer& out, std::vector<TestBuffer>& samples)
+{
+    TestWriter w;
+    std::vector<NALUnit> units(256);
+    uint32_t count = stream.units.size(), duration = count * TEST_FRAME_DURATION, mdatStart, i;
+    size_t moov, trak, mdia, minf, stbl, box, entry;
+
+    for (i = 0; i < count; i++) {
+        int n = H26xSplitAnnexB(&stream.units[i][0], stream.units[i].size(), H26xCodec_H265, &units[0], units.size());
+        TestBuffer sample(stream.units[i].size() + n * 4);
+        sample.resize(H26xWriteLengthPrefixed(&units[0], n, 4, &sample[0], sample.size()));
+        samples.push_back(sample);
+    }
+
+    box = w.begin("ftyp"); w.u32(0x69736F6D); w.u32(0x200); w.u32(0x69736F6D); w.end(box);
+    moov = w.begin("moov");
+    box = w.full("mvhd", 0, 0); w.u32(0); w.u32(0); w.u32(90000); w.u32(duration); w.u32(0x00010000); w.u16(0x0100); w.zero(10);
+    w.u32(0x00010000); w.zero(12); w.u32(0x00010000); w.zero(12); w.u32(0x40000000); w.zero(24); w.u32(2); w.end(box);
+    trak = w.begin("trak");
+    box = w.full("tkhd", 0, 3); w.u32(0); w.u32(0); w.u32(1); w.u32(0); w.u32(duration); w.zero(8); w.u32(0); w.u32(0);
+    w.u32(0x00010000); w.zero(12); w.u32(0x00010000); w.zero(12); w.u32(0x40000000); w.u32(480 << 16); w.u32(272 << 16); w.end(box);
+    mdia = w.begin("mdia");
+    box = w.full("mdhd", 0, 0); w.u32(0); w.u32(0); w.u32(90000); w.u32(duration); w.u16(0x55C4); w.u16(0); w.end(box);
+    box = w.full("hdlr", 0, 0); w.u32(0); w.u32(0x76696465); w.zero(12); w.u8(0); w.end(box);
+    minf = w.begin("minf");
+    stbl = w.begin("stbl");
+    box = w.full("stsd", 0, 0); w.u32(1);
+    entry = w.begin("hvc1");
+    w.zero(6); w.u16(1); w.zero(16); w.u16(480); w.u16(272); w.u32(0x00480000); w.u32(0x00480000); w.u32(0); w.u16(1);
+    w.zero(32); w.u16(24); w.u16(0xFFFF);
+    size_t config = w.begin("hvcC"); w.bytes(stream.config); w.end(config);
+    w.end(entry);
+    w.end(box);
+    box = w.full("stts", 0, 0); w.u32(1); w.u32(count); w.u32(TEST_FRAME_DURATION); w.end(box);
+    box = w.full("stss", 0, 0); w.u32(stream.keyframes.size());
+    for (i = 0; i < stream.keyframes.size(); i++)
+        w.u32(stream.keyframes[i] + 1);
+    w.end(box);
+    box = w.full("stsc", 0, 0); w.u32(1); w.u32(1); w.u32(count); w.u32(1); w.end(box);
+    box = w.full("stsz", 0, 0); w.u32(0); w.u32(count);
+    for (i = 0; i < count; i++)
+        w.u32(samples[i].size());
+    w.end(box);
+    box = w.full("stco", 0, 0); w.u32(1); mdatStart = w.data.size(); w.u32(0); w.end(box);
+    w.end(stbl);
+    w.end(minf);
+    w.end(mdia);
+    w.end(trak);
+    w.end(moov);
+
+    //chunk 偏移指向 mdat 的数据
+    uint32_t dataOffset = w.data.size() + 8;
+    w.data[mdatStart] = dataOffset >> 24; w.data[mdatStart + 1] = dataOffset >> 16;
+    w.data[mdatStart + 2] = dataOffset >> 8; w.data[mdatStart + 3] = dataOffset;
+    box = w.begin("mdat");
+    for (i = 0; i < count; i++)
+        w.bytes(samples[i]);
+    w.end(box);
+    out.swap(w.data);
+}
+
+
+/* MP3 生成：MPEG1 Layer III 128kbps 44.1kHz CBR */
+static void TestBuildMP3(TestBuffer& out, int frames)
+{
+    MP3FrameHeader header;
+    int i;
+
+    for (i = 0; i < frames; i++) {
+        uint8_t frame[4] = { 0xFF, 0xFB, 0x90, 0x40 };
+        size_t start = out.size();
+        if (i % 25 != 0)
+            frame[2] |= 0x02;       //padding，平均帧长 417.96 与 128kbps 一致
+        MP3ParseFrameHeader(frame, &header);
+        out.insert(out.end(), frame, frame + 4);
+        out.resize(start + header.frameSize, 0);
+        out[start + 40] = i & 0xFF;
+    }
+}
+
+
+static Demuxer* TestOpen(const char* name, const TestBuffer& data)
+{
+    DemuxSource source = TestMemorySource(data);
+    const DemuxerDescriptor* descriptor;
+    Demuxer* demuxer;
+    int score;
+
+    descriptor = DemuxerProbe(&data[0], std::min<size_t>(data.size(), DEMUX_PROBE_SIZE), &score);
+    if (descriptor == NULL || strcmp(descriptor->name, name) != 0) {
+        printf("[%s] probe error: %s\n", name, descriptor ? descriptor->name : "none");
+        return NULL;
+    }
+    demuxer = DemuxerOpen(source, NULL);
+    if (demuxer == NULL)
+        printf("[%s] open error\n", name);
+    return demuxer;
+}
+
+static int TestElementary(const TestBuffer& file, const TestStream& stream)
+{
+    Demuxer* demuxer = TestOpen("h26x", file);
+    const DemuxStreamInfo* info;
+    TestResult result;
+    uint32_t checksum = 0;
+    int count = stream.units.size() / TEST_REPEAT, i, failed = 0;
+
+    if (demuxer == NULL)
+        return 1;
+    info = demuxer->getStream(0);
+    for (i = 0; i < count; i++)
+        checksum = TestChecksum(checksum, &stream.units[i][0], stream.units[i].size());
+    TestReadAll(demuxer, result);
+    if (info->codec != DemuxCodec_H265 || info->width != 480 || info->height != 272 || result.packets[0] != count
+        || result.keyframes[0] != 1 || result.checksums[0] != checksum || !result.ptsIncreasing)
+        failed = 1;
+    printf("[h26x] %dx%d, packets %d, keyframes %d, duration %lld ms: %s\n", info->width, info->height,
+           result.packets[0], result.keyframes[0], (long long)demuxer->getDurationUs() / 1000, failed ? "FAILED" : "OK");
+    delete demuxer;
+    return failed;
+}
+
+static int TestTransportStream(const TestStream& stream)
+{
+    TestBuffer file;
+    Demuxer* demuxer;
+    TestResult result;
+    uint32_t checksum = 0;
+    int64_t pts;
+    int count = stream.units.size(), i, failed = 0;
+
+    TestBuildTS(stream, file);
+    demuxer = TestOpen("mpegts", file);
+    if (demuxer == NULL)
+        return 1;
+    for (i = 0; i < count; i++)
+        checksum = TestChecksum(checksum, &stream.units[i][0], stream.units[i].size());
+    TestReadAll(demuxer, result);
+
+    //PTS 从 0 开始，回绕之后继续递增
+    if (demuxer->getStreamCount() != 2 || demuxer->getStream(0)->width != 480 || !demuxer->getStream(1)->adts
+        || result.packets[0] != count || result.packets[1] != count || result.checksums[0] != checksum
+        || result.keyframes[0] != TEST_REPEAT || result.firstPts[0] != 0 || !result.ptsIncreasing
+        || result.lastPts[0] != (int64_t)(count - 1) * TEST_FRAME_DURATION * 100 / 9)
+        failed = 1;
+    printf("[mpegts] streams %d, packets %d/%d, keyframes %d, pts %lld..%lld ms, duration %lld ms: %s\n",
+           demuxer->getStreamCount(), result.packets[0], result.packets[1], result.keyframes[0],
+           (long long)result.firstPts[0] / 1000, (long long)result.lastPts[0] / 1000,
+           (long long)demuxer->getDurationUs() / 1000, failed ? "FAILED" : "OK");
+
+    //按字节比例估计，落在附近的关键帧
+    if (!TestSeek(demuxer, demuxer->getDurationUs() / 2, &pts)) {
+        printf("[mpegts] seek: FAILED\n");
+        failed = 1;
+    } else {
+        printf("[mpegts] seek %lld ms -> keyframe %lld ms\n", (long long)demuxer->getDurationUs() / 2000, (long long)pts / 1000);
+    }
+
+    demuxer->seek(0);
+    demuxer->setStreamEnabled(1, false);
+    TestReadAll(demuxer, result);
+    if (result.packets[0] != count || result.packets[1] != 0) {
+        printf("[mpegts] disabled stream: FAILED\n");
+        failed = 1;
+    }
+    delete demuxer;
+    return failed;
+}
+
+static int TestMP4(const TestStream& stream)
+{
+    TestBuffer file;
+    std::vector<TestBuffer> samples;
+    Demuxer* demuxer;
+    const DemuxStreamInfo* info;
+    TestResult result;
+    uint32_t checksum = 0;
+    int64_t target = 25 * 1000000, pts;
+    int count = stream.units.size(), i, failed = 0;
+
+    TestBuildMP4(stream, file, samples);
+    demuxer = TestOpen("mp4", file);
+    if (demuxer == NULL)
+        return 1;
+    for (i = 0; i < count; i++)
+        checksum = TestChecksum(checksum, &samples[i][0], samples[i].size());
+    info = demuxer->getStream(0);
+    TestReadAll(demuxer, result);
+    if (info->codec != DemuxCodec_H265 || info->nalLengthSize != 4 || info->extradata != stream.config
+        || result.packets[0] != count || result.checksums[0] != checksum || result.keyframes[0] != TEST_REPEAT)
+        failed = 1;
+    printf("[mp4] %dx%d, packets %d, keyframes %d, duration %lld ms: %s\n", info->width, info->height,
+           result.packets[0], result.keyframes[0], (long long)demuxer->getDurationUs() / 1000, failed ? "FAILED" : "OK");
+
+    if (!TestSeek(demuxer, target, &pts) || pts > target) {
+        printf("[mp4] seek: FAILED\n");
+        failed = 1;
+    }
+    delete demuxer;
+    return failed;
+}
+
+static int TestFLV(const TestBuffer& file)
+{
+    Demuxer* demuxer = TestOpen("flv", file);
+    TestResult result;
+    int64_t target, pts;
+    int i, failed = 0;
+
+    if (demuxer == NULL)
+        return 1;
+    TestReadAll(demuxer, result);
+    for (i = 0; i < demuxer->getStreamCount(); i++) {
+        const DemuxStreamInfo* info = demuxer->getStream(i);
+        printf("[flv] stream %d: type %d, codec %d, %dx%d, %d Hz %d ch, extradata %d, packets %d, keyframes %d\n",
+               i, info->type, info->codec, info->width, info->height, info->sampleRate, info->channels,
+               (int)info->extradata.size(), result.packets[i], result.keyframes[i]);
+        if (result.packets[i] == 0 || ((info->codec == DemuxCodec_H264 || info->codec == DemuxCodec_AAC) && info->extradata.empty()))
+            failed = 1;
+    }
+    if (demuxer->getStreamCount() != 2)
+        failed = 1;
+
+    target = demuxer->getDurationUs() / 2;
+    if (!TestSeek(demuxer, target, &pts) || pts > target)
+        failed = 1;
+    printf("[flv] duration %lld ms, seek %lld ms -> keyframe %lld ms: %s\n", (long long)demuxer->getDurationUs() / 1000,
+           (long long)target / 1000, (long long)pts / 1000, failed ? "FAILED" : "OK");
+    delete demuxer;
+    return failed;
+}
+
+static int TestMP3()
+{
+    TestBuffer file;
+    Demuxer* demuxer;
+    DemuxPacket* packet;
+    TestResult result;
+    int frames = 2000, failed = 0;
+    int64_t frameUs = 1152 * 1000000LL / 44100, target = 20 * 1000000;
+
+    TestBuildMP3(file, frames);
+    demuxer = TestOpen("mp3", file);
+    if (demuxer == NULL)
+        return 1;
+    TestReadAll(demuxer, result);
+    if (result.packets[0] != frames || demuxer->getStream(0)->sampleRate != 44100
+        || llabs(demuxer->getDurationUs() - frames * frameUs) > frameUs)
+        failed = 1;
+
+    if (demuxer->seek(target) < 0 || demuxer->readPacket(&packet) != 0) {
+        failed = 1;
+    } else {
+        if (llabs(packet->ptsUs - target) > frameUs)
+            failed = 1;
+        DemuxPacketUnref(packet);
+    }
+    printf("[mp3] packets %d, duration %lld ms: %s\n", result.packets[0], (long long)demuxer->getDurationUs() / 1000,
+           failed ? "FAILED" : "OK");
+    delete demuxer;
+    return failed;
+}
+
+
+/* packet pool */
+typedef struct {
+    DemuxPacketPool*    pool;
+    DemuxPacket**       shared;
+    int                 sharedCount;
+    int                 seed;
+} TestThread;
+
+static void* TestPoolThread(void* arg)
+{
+    TestThread* thread = (TestThread*)arg;
+    int i;
+
+    for (i = 0; i < TEST_POOL_ITERATIONS; i++) {
+        DemuxPacket* shared = DemuxPacketRef(thread->shared[(i + thread->seed) % thread->sharedCount]);
+        DemuxPacket* own = thread->pool->alloc(100 + ((uint32_t)i * 7919 + thread->seed) % 60000);
+        own->data[0] = (uint8_t)i;
+        DemuxPacketUnref(own);
+        DemuxPacketUnref(shared);
+    }
+    return NULL;
+}
+
+static int TestPool()
+{
+    DemuxPacketPool pool;
+    DemuxPacketPoolStatistics statistics;
+    DemuxPacket* shared[16];
+    TestThread threads[TEST_POOL_THREADS];
+    pthread_t ids[TEST_POOL_THREADS];
+    std::vector<DemuxPacket*> live;
+    double begin, poolTime, mallocTime;
+    int i, failed = 0;
+
+    //同一级大小的 packet 复用
+    for (i = 0; i < 1000; i++)
+        DemuxPacketUnref(pool.alloc(1000 + i % 24));
+    statistics = pool.getStatistics();
+    if (statistics.mallocs != 1 || statistics.reuses != 999 || statistics.live != 0)
+        failed = 1;
+
+    for (i = 0; i < 16; i++)
+        shared[i] = pool.alloc(4096);
+    for (i = 0; i < TEST_POOL_THREADS; i++) {
+        threads[i].pool = &pool;
+        threads[i].shared = shared;
+        threads[i].sharedCount = 16;
+        threads[i].seed = i * 131;
+        pthread_create(&ids[i], NULL, TestPoolThread, &threads[i]);
+    }
+    for (i = 0; i < TEST_POOL_THREADS; i++)
+        pthread_join(ids[i], NULL);
+    for (i = 0; i < 16; i++) {
+        if (shared[i]->refCount != 1)
+            failed = 1;
+        DemuxPacketUnref(shared[i]);
+    }
+    statistics = pool.getStatistics();
+    if (statistics.live != 0)
+        failed = 1;
+    printf("[pool] allocs %lld, reuses %lld, mallocs %lld, cached %d KB: %s\n", (long long)statistics.allocs,
+           (long long)statistics.reuses, (long long)statistics.mallocs, statistics.cachedBytes / 1024, failed ? "FAILED" : "OK");
+
+    //解复用的典型情况：队列中保持几十个 packet，大小在 100B~60KB 之间
+    live.assign(64, (DemuxPacket*)NULL);
+    begin = TestNow();
+    for (i = 0; i < 2000000; i++) {
+        DemuxPacketUnref(live[i & 63]);
+        live[i & 63] = pool.alloc(100 + ((uint32_t)i * 7919) % 60000);
+    }
+    poolTime = TestNow() - begin;
+    for (i = 0; i < 64; i++)
+        DemuxPacketUnref(live[i]);
+
+    std::vector<uint8_t*> buffers(64, (uint8_t*)NULL);
+    begin = TestNow();
+    for (i = 0; i < 2000000; i++) {
+        int size = 100 + ((uint32_t)i * 7919) % 60000;
+        free(buffers[i & 63]);
+        buffers[i & 63] = (uint8_t*)malloc(size + DEMUX_PACKET_PADDING);
+        memset(buffers[i & 63] + size, 0, DEMUX_PACKET_PADDING);
+    }
+    mallocTime = TestNow() - begin;
+    for (i = 0; i < 64; i++)
+        free(buffers[i]);
+    printf("[pool] alloc/unref %.1f ns, malloc/free %.1f ns\n", poolTime * 1e9 / 2000000, mallocTime * 1e9 / 2000000);
+    return failed;
+}
+
+
+static int TestMediaFile(const char* path)
+{
+    DemuxSource source;
+    Demuxer* demuxer;
+    TestResult result;
+    double begin;
+    int i;
+
+    if (DemuxSourceOpenFile(&source, path) < 0) {
+        printf("open %s error\n", path);
+        return 1;
+    }
+    demuxer = DemuxerOpen(source, NULL);
+    if (demuxer == NULL) {
+        DemuxSourceCloseFile(&source);
+        return 1;
+    }
+    begin = TestNow();
+    TestReadAll(demuxer, result);
+    printf("[%s] %s, duration %lld ms, %.1f MB/s\n", demuxer->getName(), path, (long long)demuxer->getDurationUs() / 1000,
+           source.size / 1048576.0 / (TestNow() - begin));
+    for (i = 0; i < demuxer->getStreamCount(); i++) {
+        const DemuxStreamInfo* info = demuxer->getStream(i);
+        printf("    stream %d: type %d, codec %d, id %d, packets %d, keyframes %d, pts %lld..%lld ms\n", i, info->type,
+               info->codec, info->id, result.packets[i], result.keyframes[i],
+               (long long)result.firstPts[i] / 1000, (long long)result.lastPts[i] / 1000);
+    }
+    delete demuxer;
+    DemuxSourceCloseFile(&source);
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* h265Path = (argc > 1) ? argv[1] : "bigbuckbunny_480x272.h265";
+    const char* flvPath = (argc > 2) ? argv[2] : "cuc_ieschool.flv";
+    TestBuffer h265, flv;
+    TestStream stream;
+    int failed = 0;
+
+    if (!TestReadFile(h265Path, h265) || !TestLoadStream(h265, stream)) {
+        printf("read %s error\n", h265Path);
+        return 1;
+    }
+    if (!TestReadFile(flvPath, flv)) {
+        printf("read %s error\n", flvPath);
+        return 1;
+    }
+
+    failed += TestElementary(h265, stream);
+    failed += TestTransportStream(stream);
+    failed += TestMP4(stream);
+    failed += TestFLV(flv);
+    failed += TestMP3();
+    failed += TestPool();
+    if (argc > 3)
+        failed += TestMediaFile(argv[3]);
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/**
+ *  TestFLVParser.cpp文件
+ *  FLVParser 测试：
+ *          整个文件输入和按随机大小分块输入，得到的 tag 必须一致
+ *          onMetaData 中的关键帧索引与实际的关键帧 tag 一致
+ *          seekTo 之后从返回的位置继续解析，第一个视频 tag 为关键帧
+ *
+ *  用法：TestFLVParser.elf [file.flv]，默认为 src/Player/test/cuc_ieschool.flv
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "FLVParser.h"
+
+
+typedef struct {
+    int         tags;
+    int         videoTags;
+    int         audioTags;
+    int         sequenceHeaders;
+    uint32_t    checksum;
+    std::vector<FLVKeyframe>    keyframes;
+    int64_t     firstVideoTime;     //seek 测试：resume 后第一个视频 tag
+    int         firstVideoKey;
+} TestFLVResult;
+
+
+static void TestOnTag(const FLVTag* tag, void* userData)
+{
+    TestFLVResult* result = (TestFLVResult*)userData;
+    int i;
+
+    result->tags++;
+    if (tag->type == FLVTag_Video) {
+        if (result->videoTags == 0) {
+            result->firstVideoTime = tag->timestamp;
+            result->firstVideoKey = tag->isKeyframe;
+        }
+        result->videoTags++;
+        //与 onMetaData 一致：同一时间的 sequence header 和关键帧只记录第一个
+        if (tag->isKeyframe && (result->keyframes.empty() || result->keyframes.back().timeMs != tag->timestamp)) {
+            FLVKeyframe keyframe;
+            keyframe.timeMs = tag->timestamp;
+            keyframe.fileOffset = tag->fileOffset;
+            result->keyframes.push_back(keyframe);
+        }
+    } else {
+        result->audioTags++;
+    }
+    if (tag->isSequenceHeader)
+        result->sequenceHeaders++;
+    for (i = 0; i < tag->size; i++)
+        result->checksum = result->checksum * 31 + tag->data[i];
+    result->checksum = result->checksum * 31 + (uint32_t)tag->timestamp;
+}
+
+static void TestParse(FLVParser& parser, TestFLVResult& result, const std::vector<uint8_t>& file, size_t offset, int chunkMax)
+{
+    FLVParserCallbacks callbacks;
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onTag = TestOnTag;
+    callbacks.userData = &result;
+    parser.setCallbacks(callbacks);
+    while (offset < file.size()) {
+        int chunk = (chunkMax > 0) ? 1 + rand() % chunkMax : file.size();
+        if ((size_t)chunk > file.size() - offset)
+            chunk = file.size() - offset;
+        if (parser.parse(&file[offset], chunk) < 0) {
+            printf("  parse error at %d\n", (int)offset);
+            return;
+        }
+        offset += chunk;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* path = (argc > 1) ? argv[1] : "cuc_ieschool.flv";
+    std::vector<uint8_t> file;
+    uint8_t buffer[65536];
+    size_t count, i;
+    int errors = 0;
+    FILE* fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("open %s error.\n", path);
+        return 1;
+    }
+    while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        file.insert(file.end(), buffer, buffer + count);
+    fclose(fp);
+
+    FLVParser whole;
+    TestFLVResult wholeResult = TestFLVResult();
+    TestParse(whole, wholeResult, file, 0, 0);
+    printf("%s: %d tags (video %d, audio %d), sequence headers %d, keyframes %d, index %d (%s)\n", path,
+            wholeResult.tags, wholeResult.videoTags, wholeResult.audioTags, wholeResult.sequenceHeaders,
+            (int)wholeResult.keyframes.size(), (int)whole.getKeyframeIndex().size(),
+            whole.isIndexFromMetaData() ? "onMetaData" : "scanned");
+
+    //任意分块
+    for (int chunkMax = 1; chunkMax <= 65536; chunkMax *= 16) {
+        FLVParser chunked;
+        TestFLVResult chunkedResult = TestFLVResult();
+        TestParse(chunked, chunkedResult, file, 0, chunkMax);
+        if (chunkedResult.tags != wholeResult.tags || chunkedResult.checksum != wholeResult.checksum) {
+            printf("chunk max %d: FAILED (%d tags)\n", chunkMax, chunkedResult.tags);
+            errors++;
+        }
+    }
+    printf("chunked input: %s\n", errors ? "FAILED" : "OK");
+
+    //onMetaData 的索引与实际关键帧一致
+    const std::vector<FLVKeyframe>& index = whole.getKeyframeIndex();
+    if (index.size() != wholeResult.keyframes.size()) {
+        printf("index size %d != keyframes %d\n", (int)index.size(), (int)wholeResult.keyframes.size());
+        errors++;
+    }
+    for (i = 0; i < index.size() && i < wholeResult.keyframes.size(); i++) {
+        if (index[i].fileOffset != wholeResult.keyframes[i].fileOffset) {
+            printf("index[%d] offset %lld != %lld\n", (int)i, (long long)index[i].fileOffset, (long long)wholeResult.keyframes[i].fileOffset);
+            errors++;
+        }
+    }
+
+    //seek 到各个时间点，从返回的位置继续解析
+    int64_t duration = (int64_t)(whole.getMetaData().duration * 1000);
+    for (int64_t timeMs = 0; timeMs <= duration + 1000; timeMs += 1700) {
+        int64_t offset, keyTime;
+        TestFLVResult seekResult = TestFLVResult();
+        if (whole.seekTo(timeMs, &offset, &keyTime) < 0 || (keyTime > timeMs && timeMs >= index[0].timeMs)) {
+            printf("seek %lld FAILED\n", (long long)timeMs);
+            errors++;
+            continue;
+        }
+        whole.resume(offset);
+        TestParse(whole, seekResult, file, offset, 4096);
+        if (!seekResult.firstVideoKey || seekResult.firstVideoTime != keyTime) {
+            printf("seek %lld -> offset %lld time %lld: first video tag %lld key %d FAILED\n", (long long)timeMs,
+                    (long long)offset, (long long)keyTime, (long long)seekResult.firstVideoTime, seekResult.firstVideoKey);
+            errors++;
+        }
+    }
+    printf("seek: %s\n", errors ? "FAILED" : "OK");
+
+    //没有 onMetaData 时顺序读取建立的索引
+    FLVParser scanned;
+    TestFLVResult scannedResult = TestFLVResult();
+    size_t start = 9 + 4 + 11 + ((file[14] << 16) | (file[15] << 8) | file[16]) + 4;
+    if (file[13] == FLVTag_Script) {
+        scanned.resume(start);
+        TestParse(scanned, scannedResult, file, start, 4096);
+        if (scanned.isIndexFromMetaData() || scanned.getKeyframeIndex().size() != index.size()) {
+            printf("scanned index %d FAILED\n", (int)scanned.getKeyframeIndex().size());
+            errors++;
+        }
+        for (i = 0; i < index.size() && i < scanned.getKeyframeIndex().size(); i++) {
+            if (scanned.getKeyframeIndex()[i].fileOffset != index[i].fileOffset)
+                errors++;
+        }
+        printf("scanned index: %s\n", errors ? "FAILED" : "OK");
+    }
+
+    return errors ? 1 : 0;
+}
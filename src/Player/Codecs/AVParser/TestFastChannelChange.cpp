@@ -0,0 +1,327 @@
+/**
+ *  TestFastChannelChange.cpp文件
+ *  快速换台的测试：
+ *          用生成的 H.264 裸码流模拟直播频道，打开时从当前时刻的帧开始，之后按帧率到达，各频道 GOP 起点错开
+ *          冷启动(不预取)和预取前后一个频道时依次换台，比较换台到第一个关键帧的时间
+ *          内存上限小于一个 GOP 时丢弃缓存，全部变为冷启动；带宽上限时预取线程等待
+ *
+ *  用法：TestFastChannelChange.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "H264Parser.h"
+#include "Demuxer.h"
+#include "FastChannelChange.h"
+
+
+#define     TEST_CHANNELS               6
+#define     TEST_GOP                    25          //1 秒一个关键帧
+#define     TEST_FRAME_US               40000
+#define     TEST_IDR_BYTES              40000
+#define     TEST_P_BYTES                8000
+#define     TEST_ZAPS                   4
+#define     TEST_DWELL_US               1300000     //每个频道停留的时间，大于 GOP 加上探测格式的时间
+
+
+typedef std::vector<uint8_t> TestBuffer;
+
+typedef struct {
+    TestBuffer      data;
+    int             bits;
+} TestBitWriter;
+
+typedef struct {
+    int64_t         epochUs;
+} TestLive;
+
+typedef struct {
+    TestLive*       live;
+    int             phase;              //频道的帧序号比时间领先的帧数，错开各频道的关键帧
+    int64_t         joinFrame;
+    int64_t         frames;             //已经到达的帧数
+    TestBuffer      data;
+} TestSession;
+
+typedef struct {
+    int             zaps;
+    int64_t         totalUs;
+    int64_t         maxUs;
+    int             failed;
+} TestZapResult;
+
+
+static int64_t TestNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void TestPutBits(TestBitWriter* writer, uint32_t value, int count)
+{
+    while (count-- > 0) {
+        if ((writer->bits & 7) == 0)
+            writer->data.push_back(0);
+        if ((value >> count) & 1)
+            writer->data.back() |= 0x80 >> (writer->bits & 7);
+        writer->bits++;
+    }
+}
+
+static void TestPutUE(TestBitWriter* writer, uint32_t value)
+{
+    int length = 0;
+
+    while ((value + 1) >> (length + 1))
+        length++;
+    TestPutBits(writer, 0, length);
+    TestPutBits(writer, value + 1, length + 1);
+}
+
+/* rbsp_trailing_bits 之后接到 out，生成的数据中没有 00 00，不需要防竞争字节 */
+static void TestPutNal(TestBuffer& out, uint8_t header, TestBitWriter* writer, int filler)
+{
+    static const uint8_t startCode[4] = { 0, 0, 0, 1 };
+
+    TestPutBits(writer, 1, 1);
+    while (writer->bits & 7)
+        TestPutBits(writer, 0, 1);
+    out.insert(out.end(), startCode, startCode + 4);
+    out.push_back(header);
+    out.insert(out.end(), writer->data.begin(), writer->data.end());
+    out.insert(out.end(), filler, 0xAA);
+}
+
+/* 帧序号 n 的 access unit：AUD，关键帧前有 SPS/PPS */
+static void TestBuildUnit(TestBuffer& out, int64_t n)
+{
+    TestBitWriter writer;
+    bool idr = (n % TEST_GOP) == 0;
+
+    writer.bits = 0;
+    TestPutBits(&writer, 7, 3);             //primary_pic_type
+    TestPutNal(out, 0x09, &writer, 0);
+    if (idr) {
+        writer.data.clear();
+        writer.bits = 0;
+        TestPutBits(&writer, 66, 8);        //baseline
+        TestPutBits(&writer, 0, 8);
+        TestPutBits(&writer, 30, 8);
+        TestPutUE(&writer, 0);              //seq_parameter_set_id
+        TestPutUE(&writer, 0);              //log2_max_frame_num_minus4
+        TestPutUE(&writer, 2);              //pic_order_cnt_type
+        TestPutUE(&writer, 1);              //max_num_ref_frames
+        TestPutBits(&writer, 0, 1);
+        TestPutUE(&writer, 19);             //320x240
+        TestPutUE(&writer, 14);
+        TestPutBits(&writer, 1, 1);         //frame_mbs_only_flag
+        TestPutBits(&writer, 1, 1);
+        TestPutBits(&writer, 0, 1);
+        TestPutBits(&writer, 0, 1);
+        TestPutNal(out, 0x67, &writer, 0);
+
+        writer.data.clear();
+        writer.bits = 0;
+        TestPutUE(&writer, 0);              //pic_parameter_set_id
+        TestPutUE(&writer, 0);
+        TestPutBits(&writer, 0, 2);         //entropy_coding_mode_flag, bottom_field_pic_order_in_frame_present_flag
+        TestPutNal(out, 0x68, &writer, 0);
+    }
+    writer.data.clear();
+    writer.bits = 0;
+    TestPutUE(&writer, 0);                  //first_mb_in_slice
+    TestPutUE(&writer, idr ? 7 : 5);
+    TestPutUE(&writer, 0);
+    TestPutBits(&writer, (uint32_t)(n % TEST_GOP) & 15, 4);
+    if (idr)
+        TestPutUE(&writer, 0);              //idr_pic_id
+    TestPutNal(out, idr ? 0x65 : 0x41, &writer, idr ? TEST_IDR_BYTES : TEST_P_BYTES);
+}
+
+/* 直播源：只能读到已经到达的帧，没有数据时最多等一帧的时间 */
+static int TestLiveRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    TestSession* session = (TestSession*)opaque;
+    int64_t now, arrive;
+
+    for (;;) {
+        now = TestNowUs();
+        for (;;) {
+            arrive = session->live->epochUs + (session->joinFrame + session->frames - session->phase) * TEST_FRAME_US;
+            if (arrive > now)
+                break;
+            TestBuildUnit(session->data, session->joinFrame + session->frames);
+            session->frames++;
+        }
+        if (offset < (int64_t)session->data.size())
+            break;
+        usleep(std::min(arrive - now, (int64_t)TEST_FRAME_US));
+    }
+    size = std::min((int64_t)size, (int64_t)session->data.size() - offset);
+    memcpy(buffer, &session->data[offset], size);
+    return size;
+}
+
+static int TestLiveOpen(void* userData, const char* url, DemuxSource* source)
+{
+    TestLive* live = (TestLive*)userData;
+    TestSession* session;
+    int index;
+
+    if (sscanf(url, "live://%d", &index) != 1)
+        return -1;
+    session = new TestSession;
+    session->live = live;
+    session->phase = index * 7;
+    session->joinFrame = (TestNowUs() - live->epochUs) / TEST_FRAME_US + session->phase;
+    session->frames = 0;
+    source->read = TestLiveRead;
+    source->size = -1;
+    source->opaque = session;
+    return 0;
+}
+
+static void TestLiveClose(void* userData, DemuxSource* source)
+{
+    delete (TestSession*)source->opaque;
+    source->opaque = NULL;
+}
+
+/* 换台到第一个关键帧的时间，之后一直取走数据直到停留时间结束 */
+static void TestZap(FastChannelChange& fcc, int index, TestZapResult* result)
+{
+    int64_t start = TestNowUs(), elapsed = -1;
+    FCCChannel* channel = fcc.zapTo(index);
+    DemuxPacket* packet;
+    int ret;
+
+    if (channel == NULL) {
+        result->failed++;
+        return;
+    }
+    while (TestNowUs() < start + TEST_DWELL_US) {
+        ret = channel->readPacket(&packet, 50);
+        if (ret == -2)
+            continue;
+        if (ret != 0)
+            break;
+        if (elapsed < 0) {
+            if (!(packet->flags & DemuxPacket_Keyframe))
+                result->failed++;       //第一个 packet 必须是关键帧
+            elapsed = TestNowUs() - start;
+            fcc.onFirstFrame();
+        }
+        DemuxPacketUnref(packet);
+    }
+    if (elapsed < 0) {
+        result->failed++;
+        return;
+    }
+    result->zaps++;
+    result->totalUs += elapsed;
+    result->maxUs = std::max(result->maxUs, elapsed);
+}
+
+/* 直播源自己按帧率到达，不需要再按时间戳限速，否则会落后于直播 */
+static void TestConfig(FCCConfig* config)
+{
+    FCCConfigDefault(config);
+    config->realtime = false;
+}
+
+static FCCStatistics TestRun(const char* name, const FCCConfig& config, TestZapResult* result, int64_t* firstUs)
+{
+    const char* urls[TEST_CHANNELS];
+    char names[TEST_CHANNELS][32];
+    FCCSourceOps ops;
+    TestLive live;
+    FCCStatistics statistics;
+    TestZapResult first;
+    int i;
+
+    live.epochUs = TestNowUs();
+    for (i = 0; i < TEST_CHANNELS; i++) {
+        snprintf(names[i], sizeof(names[i]), "live://%d", i);
+        urls[i] = names[i];
+    }
+    ops.open = TestLiveOpen;
+    ops.close = TestLiveClose;
+    ops.userData = &live;
+
+    FastChannelChange fcc(&config, &ops);
+    fcc.setPlaylist(urls, TEST_CHANNELS);
+    memset(&first, 0, sizeof(first));
+    memset(result, 0, sizeof(*result));
+
+    //第一次总是冷启动，不计入对比
+    TestZap(fcc, 0, &first);
+    *firstUs = first.totalUs;
+    result->failed = first.failed;
+    for (i = 1; i <= TEST_ZAPS; i++)
+        TestZap(fcc, i, result);
+    statistics = fcc.getStatistics();
+    printf("[%s] zaps %d, mean %lld ms, max %lld ms, hits %lld, misses %lld, overflows %lld, throttle %lld ms, prefetch %lld KB\n",
+           name, result->zaps, result->zaps ? (long long)result->totalUs / result->zaps / 1000 : 0LL,
+           (long long)result->maxUs / 1000, (long long)statistics.hits, (long long)statistics.misses,
+           (long long)statistics.overflows, (long long)statistics.throttleMs, (long long)statistics.prefetchBytes / 1024);
+    fcc.logStatistics();
+    fcc.close();
+    return statistics;
+}
+
+int main(int argc, char* argv[])
+{
+    FCCConfig config;
+    FCCStatistics cold, prefetch, memory, bandwidth;
+    TestZapResult coldResult, prefetchResult, memoryResult, bandwidthResult;
+    int64_t firstUs;
+    int failed = 0;
+
+    TestConfig(&config);
+    config.neighbours = 0;
+    cold = TestRun("cold", config, &coldResult, &firstUs);
+    if (coldResult.failed || coldResult.zaps != TEST_ZAPS || cold.hits != 0)
+        failed++;
+
+    //停留时间足够预取到关键帧，每次换台都命中
+    TestConfig(&config);
+    prefetch = TestRun("prefetch", config, &prefetchResult, &firstUs);
+    if (prefetchResult.failed || prefetchResult.zaps != TEST_ZAPS || prefetch.hits != TEST_ZAPS
+        || prefetch.histogram[0] < TEST_ZAPS || prefetch.bufferedBytes == 0
+        || prefetchResult.totalUs * 4 > coldResult.totalUs)
+        failed++;
+    printf("[prefetch] first zap %lld ms, cold/prefetch mean %lld/%lld ms: %s\n", (long long)firstUs / 1000,
+           coldResult.zaps ? (long long)coldResult.totalUs / coldResult.zaps / 1000 : 0LL,
+           prefetchResult.zaps ? (long long)prefetchResult.totalUs / prefetchResult.zaps / 1000 : 0LL,
+           failed ? "FAILED" : "OK");
+
+    //每个频道的内存上限小于一个关键帧
+    TestConfig(&config);
+    config.memoryBytes = TEST_IDR_BYTES / 2;
+    memory = TestRun("memory", config, &memoryResult, &firstUs);
+    if (memoryResult.failed || memoryResult.zaps != TEST_ZAPS || memory.hits != 0 || memory.overflows == 0) {
+        printf("[memory] FAILED\n");
+        failed++;
+    }
+
+    //码率约 1.9Mbps，两个预取频道平分 400kbps
+    TestConfig(&config);
+    config.bandwidthKbps = 400;
+    bandwidth = TestRun("bandwidth", config, &bandwidthResult, &firstUs);
+    if (bandwidthResult.failed || bandwidthResult.zaps != TEST_ZAPS || bandwidth.throttleMs == 0) {
+        printf("[bandwidth] FAILED\n");
+        failed++;
+    }
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
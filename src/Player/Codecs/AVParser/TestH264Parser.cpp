@@ -0,0 +1,472 @@
+/**
+ *  TestH264Parser.cpp文件
+ *  H264Parser 的正确性测试和性能测试：
+ *          H.265：src/Player/test/bigbuckbunny_480x272.h265，整个文件输入和按随机大小分块输入，access unit 必须一致
+ *          H.264：生成带多 slice、B 帧(帧号相同只有 POC 不同)、丢失第一个 slice、recovery point 的码流
+ *          hvcC/avcC 的生成和导入，Annex-B 与长度前缀格式之间的转换
+ *          起始码查找与逐字节查找的 GB/s 对比
+ *
+ *  用法：TestH264Parser.elf [file.h265]，默认为 bigbuckbunny_480x272.h265
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "H264Parser.h"
+
+
+typedef struct {
+    int         accessUnits;
+    int         keyframes;
+    int         randomAccess;
+    int         parameterSets;
+    uint32_t    checksum;
+    std::vector<int>        nalCounts;
+    std::vector<int>        flags;          //isKeyframe | isRandomAccess << 1 | hasParameterSets << 2 | pictureType << 3
+    std::vector<int64_t>    pts;
+    std::vector<std::vector<uint8_t> >  units;  //每个 access unit 的 Annex-B 数据
+} TestResult;
+
+
+static void TestOnAccessUnit(const H26xAccessUnit* au, void* userData)
+{
+    TestResult* result = (TestResult*)userData;
+    int i;
+
+    result->accessUnits++;
+    result->keyframes += au->isKeyframe;
+    result->randomAccess += au->isRandomAccess;
+    result->parameterSets += au->hasParameterSets;
+    result->nalCounts.push_back(au->nalCount);
+    result->flags.push_back(au->isKeyframe | (au->isRandomAccess << 1) | (au->hasParameterSets << 2) | (au->pictureType << 3));
+    result->pts.push_back(au->pts);
+    result->units.push_back(std::vector<uint8_t>(au->data, au->data + au->size));
+    for (i = 0; i < au->nalCount; i++) {
+        for (int k = 0; k < au->nals[i].size; k++)
+            result->checksum = result->checksum * 31 + au->nals[i].data[k];
+        result->checksum = result->checksum * 31 + au->nals[i].type;
+    }
+}
+
+static void TestParse(H264Parser& parser, TestResult& result, const std::vector<uint8_t>& stream, int chunkMax)
+{
+    H264ParserCallbacks callbacks;
+    size_t offset = 0;
+
+    callbacks.onAccessUnit = TestOnAccessUnit;
+    callbacks.userData = &result;
+    parser.setCallbacks(callbacks);
+    while (offset < stream.size()) {
+        int chunk = (chunkMax > 0) ? 1 + rand() % chunkMax : stream.size();
+        if ((size_t)chunk > stream.size() - offset)
+            chunk = stream.size() - offset;
+        parser.parse(&stream[offset], chunk, -1, -1);
+        offset += chunk;
+    }
+    parser.flush();
+}
+
+static bool TestSameResult(const TestResult& a, const TestResult& b)
+{
+    return a.accessUnits == b.accessUnits && a.checksum == b.checksum && a.nalCounts == b.nalCounts && a.flags == b.flags;
+}
+
+
+/* Annex-B -> 长度前缀 -> Annex-B，原地或一次拷贝，NAL 必须不变 */
+static int TestConvert(const std::vector<uint8_t>& au, int codec)
+{
+    std::vector<NALUnit> original(256), converted(256);
+    std::vector<uint8_t> buffer(au);
+    std::vector<uint8_t> prefixed;
+    int count, again, i;
+
+    count = H26xSplitAnnexB(&au[0], au.size(), codec, &original[0], original.size());
+    if (H26xAnnexBToLengthPrefixed(&buffer[0], buffer.size()) < 0) { //有 3 字节起始码
+        prefixed.resize(H26xWriteLengthPrefixed(&original[0], count, 4, NULL, 0));
+        if (H26xWriteLengthPrefixed(&original[0], count, 4, &prefixed[0], prefixed.size()) != (int)prefixed.size())
+            return 1;
+        buffer = prefixed;
+    }
+    again = H26xSplitLengthPrefixed(&buffer[0], buffer.size(), 4, codec, &converted[0], converted.size());
+    if (again != count)
+        return 1;
+    for (i = 0; i < count; i++) {
+        if (converted[i].size != original[i].size || memcmp(converted[i].data, original[i].data, original[i].size) != 0)
+            return 1;
+    }
+    if (H26xLengthPrefixedToAnnexB(&buffer[0], buffer.size(), 4) < 0)
+        return 1;
+    again = H26xSplitAnnexB(&buffer[0], buffer.size(), codec, &converted[0], converted.size());
+    if (again != count)
+        return 1;
+    for (i = 0; i < count; i++) {
+        if (converted[i].size != original[i].size || memcmp(converted[i].data, original[i].data, original[i].size) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+
+/* H.264 码流构造 */
+class TestBitWriter {
+    public:
+        std::vector<uint8_t>    bytes;
+        int                     bits;
+
+        TestBitWriter() : bits(0) {}
+        void put(uint32_t value, int count)
+        {
+            while (count-- > 0) {
+                if (bits % 8 == 0)
+                    bytes.push_back(0);
+                if ((value >> count) & 1)
+                    bytes.back() |= 0x80 >> (bits % 8);
+                bits++;
+            }
+        }
+        void ue(uint32_t value)
+        {
+            int length = 0;
+            while ((value + 1) >> (length + 1))
+                length++;
+            put(0, length);
+            put(value + 1, length + 1);
+        }
+        void se(int32_t value) { ue(value > 0 ? 2 * value - 1 : -2 * value); }
+        void trailing()
+        {
+            put(1, 1);
+            while (bits % 8)
+                put(0, 1);
+        }
+};
+
+static void TestAppendNal(std::vector<uint8_t>& stream, uint8_t header, const std::vector<uint8_t>& rbsp, bool longStartCode)
+{
+    int zeros = 0;
+
+    if (longStartCode)
+        stream.push_back(0);
+    stream.push_back(0);
+    stream.push_back(0);
+    stream.push_back(1);
+    stream.push_back(header);
+    for (size_t i = 0; i < rbsp.size(); i++) {
+        if (zeros >= 2 && rbsp[i] <= 3) {
+            stream.push_back(3);
+            zeros = 0;
+        }
+        stream.push_back(rbsp[i]);
+        zeros = rbsp[i] ? 0 : zeros + 1;
+    }
+}
+
+static void TestAppendSlice(std::vector<uint8_t>& stream, int refIdc, bool idr, int firstMb, int sliceType, int frameNum, int poc, int payload)
+{
+    TestBitWriter w;
+
+    w.ue(firstMb);
+    w.ue(sliceType);
+    w.ue(0);                //pps_id
+    w.put(frameNum, 4);
+    if (idr)
+        w.ue(frameNum);     //idr_pic_id
+    w.put(poc, 6);
+    for (int i = 0; i < payload; i++)
+        w.put((i * 37 + 11) & 0xFF, 8);
+    w.trailing();
+    TestAppendNal(stream, (refIdc << 5) | (idr ? H264Nal_IDR : H264Nal_Slice), w.bytes, firstMb == 0);
+}
+
+typedef struct {
+    int         nalCount;
+    int         flags;
+} TestExpectedAU;
+
+/* GOP 12：IDR(2 slice) B B P B B I(recovery point) B B P(只有第二个 slice) B B */
+static void TestBuildH264(std::vector<uint8_t>& stream, std::vector<TestExpectedAU>& expected, std::vector<size_t>& starts, int pictures)
+{
+    int frameNum = 0;
+
+    for (int i = 0; i < pictures; i++) {
+        int gop = i % 12;
+        int poc = (2 * i) % 64;
+        TestExpectedAU au = { 0, 0 };
+
+        starts.push_back(stream.size());
+        if (gop == 0) {
+            TestBitWriter aud, sps, pps;
+            aud.put(0, 3);
+            aud.trailing();
+            TestAppendNal(stream, H264Nal_AUD, aud.bytes, true);
+
+            sps.put(100, 8); sps.put(0, 8); sps.put(40, 8); sps.ue(0);
+            sps.ue(1); sps.ue(0); sps.ue(0); sps.put(0, 1); sps.put(0, 1);
+            sps.ue(0); sps.ue(0); sps.ue(2);        //frame_num 4 位，POC 0，poc_lsb 6 位
+            sps.ue(4); sps.put(0, 1); sps.ue(119); sps.ue(67); sps.put(1, 1); sps.put(1, 1);
+            sps.put(1, 1); sps.ue(0); sps.ue(0); sps.ue(0); sps.ue(4);     //1920x1088 裁剪为 1080
+            sps.put(0, 1);
+            sps.trailing();
+            TestAppendNal(stream, 0x60 | H264Nal_SPS, sps.bytes, true);
+
+            pps.ue(0); pps.ue(0); pps.put(1, 1); pps.put(0, 1); pps.ue(0); pps.ue(0); pps.ue(0);
+            pps.put(0, 1); pps.put(0, 2); pps.se(0); pps.se(0); pps.se(0); pps.put(1, 1); pps.put(0, 1); pps.put(0, 1);
+            pps.trailing();
+            TestAppendNal(stream, 0x60 | H264Nal_PPS, pps.bytes, true);
+
+            frameNum = 0;
+            TestAppendSlice(stream, 3, true, 0, 7, 0, poc, 3000);
+            TestAppendSlice(stream, 3, true, 4080, 7, 0, poc, 2000);
+            au.nalCount = 5;
+            au.flags = 1 | 2 | 4 | (H26xPicture_I << 3);
+            frameNum = 1;
+        } else if (gop == 6) {
+            std::vector<uint8_t> sei;
+            sei.push_back(6);       //recovery_point
+            sei.push_back(1);
+            sei.push_back(0x80);
+            sei.push_back(0x80);
+            TestAppendNal(stream, H264Nal_SEI, sei, true);
+            TestAppendSlice(stream, 2, false, 0, 7, frameNum, poc, 1500);
+            au.nalCount = 2;
+            au.flags = 2 | (H26xPicture_I << 3);
+            frameNum = (frameNum + 1) % 16;
+        } else if (gop % 3 == 0) {
+            if (gop == 9) { //第一个 slice 丢失，靠 frame_num/POC 判断新的图像
+                TestAppendSlice(stream, 2, false, 4080, 5, frameNum, poc, 800);
+                au.nalCount = 1;
+            } else {
+                TestAppendSlice(stream, 2, false, 0, 5, frameNum, poc, 900);
+                TestAppendSlice(stream, 2, false, 4080, 5, frameNum, poc, 700);
+                au.nalCount = 2;
+            }
+            au.flags = H26xPicture_P << 3;
+            frameNum = (frameNum + 1) % 16;
+        } else { //非参考 B 帧，连续两个的 frame_num 相同
+            TestAppendSlice(stream, 0, false, 0, 6, frameNum, poc, 300);
+            au.nalCount = 1;
+            au.flags = H26xPicture_B << 3;
+        }
+        expected.push_back(au);
+    }
+}
+
+
+static double TestNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const uint8_t* TestFindStartCodeBytewise(const uint8_t* p, const uint8_t* end)
+{
+    for (; p + 2 < end; p++) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    }
+    return end;
+}
+
+
+static int TestH265(const char* path)
+{
+    std::vector<uint8_t> file;
+    uint8_t buffer[65536];
+    size_t count;
+    int errors = 0;
+    FILE* fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("open %s error.\n", path);
+        return 1;
+    }
+    while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        file.insert(file.end(), buffer, buffer + count);
+    fclose(fp);
+
+    H264Parser whole(H26xCodec_H265);
+    TestResult wholeResult = TestResult();
+    TestParse(whole, wholeResult, file, 0);
+    const H26xVideoInfo* info = whole.getVideoInfo();
+    printf("%s: %d access units, keyframes %d, parameter sets %d, %dx%d profile %d level %d\n", path,
+            wholeResult.accessUnits, wholeResult.keyframes, wholeResult.parameterSets,
+            info ? info->width : 0, info ? info->height : 0, info ? info->profile : 0, info ? info->level : 0);
+    if (info == NULL || info->width != 480 || info->height != 272 || wholeResult.keyframes < 1 || !(wholeResult.flags[0] & 1)) {
+        printf("  stream info FAILED\n");
+        errors++;
+    }
+
+    for (int chunkMax = 1; chunkMax <= 65536; chunkMax *= 8) {
+        H264Parser chunked(H26xCodec_H265);
+        TestResult chunkedResult = TestResult();
+        TestParse(chunked, chunkedResult, file, chunkMax);
+        if (!TestSameResult(chunkedResult, wholeResult)) {
+            printf("  chunk max %d: %d access units FAILED\n", chunkMax, chunkedResult.accessUnits);
+            errors++;
+        }
+    }
+    printf("  chunked input: %s\n", errors ? "FAILED" : "OK");
+
+    //hvcC
+    std::vector<uint8_t> config, parameterSets;
+    NALUnit units[8];
+    int lengthSize = 0;
+    H264Parser imported(H26xCodec_H265);
+    if (whole.getDecoderConfig(config) < 0 || H26xParseDecoderConfig(&config[0], config.size(), H26xCodec_H265, units, 8, &lengthSize) != 3
+            || lengthSize != 4 || units[0].type != H265Nal_VPS || units[1].type != H265Nal_SPS || units[2].type != H265Nal_PPS
+            || imported.setDecoderConfig(&config[0], config.size()) != 4 || imported.getVideoInfo() == NULL
+            || imported.getVideoInfo()->width != 480 || imported.getParameterSetsAnnexB(parameterSets) < 0
+            || memcmp(&parameterSets[0], &file[0], parameterSets.size()) != 0) {
+        printf("  hvcC FAILED\n");
+        errors++;
+    } else {
+        printf("  hvcC %d bytes: OK\n", (int)config.size());
+    }
+
+    //格式转换，inspect 与流式解析的结果一致
+    int convertErrors = 0;
+    for (size_t i = 0; i < wholeResult.units.size(); i++) {
+        const std::vector<uint8_t>& au = wholeResult.units[i];
+        H26xAccessUnit inspected;
+        convertErrors += TestConvert(au, H26xCodec_H265);
+        if (imported.inspect(&au[0], au.size(), 0, &inspected) < 0 || inspected.nalCount != wholeResult.nalCounts[i]
+                || (inspected.isKeyframe | (inspected.isRandomAccess << 1) | (inspected.hasParameterSets << 2)
+                        | (inspected.pictureType << 3)) != wholeResult.flags[i])
+            convertErrors++;
+    }
+    printf("  convert/inspect: %s\n", convertErrors ? "FAILED" : "OK");
+    errors += convertErrors;
+
+    //流式解析性能
+    double start = TestNow();
+    int rounds = 200;
+    for (int k = 0; k < rounds; k++) {
+        TestResult result = TestResult();
+        H264ParserCallbacks callbacks = { NULL, NULL };
+        whole.setCallbacks(callbacks);
+        for (size_t offset = 0; offset < file.size(); offset += 1316)
+            whole.parse(&file[offset], (file.size() - offset < 1316) ? file.size() - offset : 1316, -1, -1);
+        whole.flush();
+    }
+    printf("  parse 1316 byte chunks: %.0f MB/s\n", file.size() * (double)rounds / (TestNow() - start) / 1e6);
+    return errors;
+}
+
+
+static int TestH264()
+{
+    std::vector<uint8_t> stream;
+    std::vector<TestExpectedAU> expected;
+    std::vector<size_t> starts;
+    int errors = 0;
+    size_t i;
+
+    TestBuildH264(stream, expected, starts, 240);
+    for (int chunkMax = 0; chunkMax <= 4096; chunkMax = chunkMax ? chunkMax * 8 : 1) {
+        H264Parser parser(H26xCodec_H264);
+        TestResult result = TestResult();
+        TestParse(parser, result, stream, chunkMax);
+        bool ok = result.accessUnits == (int)expected.size();
+        for (i = 0; ok && i < expected.size(); i++) {
+            if (result.nalCounts[i] != expected[i].nalCount || result.flags[i] != expected[i].flags) {
+                printf("  h264 chunk max %d: access unit %d: %d nals, flags %x (expected %d, %x)\n", chunkMax, (int)i,
+                        result.nalCounts[i], result.flags[i], expected[i].nalCount, expected[i].flags);
+                ok = false;
+            }
+        }
+        if (!ok || parser.getVideoInfo() == NULL || parser.getVideoInfo()->width != 1920 || parser.getVideoInfo()->height != 1080) {
+            printf("  h264 chunk max %d: %d access units FAILED\n", chunkMax, result.accessUnits);
+            errors++;
+        }
+        if (chunkMax == 0) {
+            for (i = 0; i < result.units.size(); i++)
+                errors += TestConvert(result.units[i], H26xCodec_H264);
+            std::vector<uint8_t> config;
+            NALUnit units[4];
+            int lengthSize;
+            if (parser.getDecoderConfig(config) < 0 || config[1] != 100 || config[3] != 40
+                    || H26xParseDecoderConfig(&config[0], config.size(), H26xCodec_H264, units, 4, &lengthSize) != 2
+                    || units[0].type != H264Nal_SPS || units[1].type != H264Nal_PPS || lengthSize != 4) {
+                printf("  avcC FAILED\n");
+                errors++;
+            }
+        }
+    }
+
+    //每个 access unit 单独输入时带上 PTS
+    H264Parser parser(H26xCodec_H264);
+    TestResult result = TestResult();
+    H264ParserCallbacks callbacks = { TestOnAccessUnit, &result };
+    parser.setCallbacks(callbacks);
+    starts.push_back(stream.size());
+    for (i = 0; i + 1 < starts.size(); i++)
+        parser.parse(&stream[starts[i]], starts[i + 1] - starts[i], i * 3600, i * 3600);
+    parser.flush();
+    for (i = 0; i < result.pts.size(); i++) {
+        if (result.pts[i] != (int64_t)i * 3600) {
+            printf("  h264 pts %d: %lld FAILED\n", (int)i, (long long)result.pts[i]);
+            errors++;
+            break;
+        }
+    }
+    printf("h264 synthetic: %d pictures, %s\n", (int)expected.size(), errors ? "FAILED" : "OK");
+    return errors;
+}
+
+
+static int TestStartCodeSpeed()
+{
+    std::vector<uint8_t> data(64 * 1024 * 1024);
+    const uint8_t* end;
+    const uint8_t* p;
+    int found = 0, bytewise = 0;
+    double start, simd, scalar;
+    size_t i;
+
+    srand(2);
+    for (i = 0; i < data.size(); i++)
+        data[i] = rand() & 0xFF;
+    for (i = 0; i + 3 < data.size(); i += 40000 + rand() % 20000) {
+        data[i] = 0;
+        data[i + 1] = 0;
+        data[i + 2] = 1;
+    }
+    end = &data[0] + data.size();
+
+    start = TestNow();
+    for (p = &data[0]; (p = H26xFindStartCode(p, end)) < end; p += 3)
+        found++;
+    simd = TestNow() - start;
+
+    start = TestNow();
+    for (p = &data[0]; (p = TestFindStartCodeBytewise(p, end)) < end; p += 3)
+        bytewise++;
+    scalar = TestNow() - start;
+
+    printf("start code scan: %.2f GB/s, bytewise %.2f GB/s, %d start codes\n", data.size() / simd / 1e9,
+            data.size() / scalar / 1e9, found);
+    if (found != bytewise) {
+        printf("  found %d, bytewise %d FAILED\n", found, bytewise);
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* path = (argc > 1) ? argv[1] : "bigbuckbunny_480x272.h265";
+    int errors = 0;
+
+    errors += TestH265(path);
+    errors += TestH264();
+    errors += TestStartCodeSpeed();
+    return errors ? 1 : 0;
+}
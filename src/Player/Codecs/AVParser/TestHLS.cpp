@@ -0,0 +1,812 @@
+/**
+ *  TestHLS.cpp文件
+ *  HLS 客户端的测试：
+ *          m3u8 解析(属性、BYTERANGE、EXT-X-MAP、相对地址)和码率选择的规则
+ *          在 /tmp/TestHLS 生成测试目录：三个码率的 TS 点播(其中一个用 BYTERANGE 放在一个文件中)、fMP4、直播
+ *          本机的静态文件服务器：keep-alive，每个连接最多响应几个请求后直接关闭，可以限速，支持 Range 和重定向
+ *          点播：从最低码率开始，缓冲足够时逐级升码率，经过 Demuxer 之后帧完整、顺序正确，连接被复用
+ *          限速：从最高码率开始，带宽不足时降码率
+ *          fMP4：初始化段和分片按顺序拼接；直播：从窗口末尾开始，按列表更新读到结束；seek 之后从分片开头重新开始
+ *
+ *  用法：TestHLS.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "TSParser.h"
+#include "Demuxer.h"
+#include "HLSPlaylist.h"
+#include "HLSClient.h"
+
+
+#define     TEST_ROOT                   "/tmp/TestHLS"
+#define     TEST_VARIANTS               3
+#define     TEST_SEGMENTS               12
+#define     TEST_SEGMENT_FRAMES         25          //1 秒一个分片，分片开头为关键帧
+#define     TEST_FRAME_US               40000
+#define     TEST_VIDEO_PID              0x100
+#define     TEST_PMT_PID                0x1000
+#define     TEST_MAX_REQUESTS           5           //服务器每个连接最多响应的请求数，之后直接关闭
+#define     TEST_LIVE_SEGMENTS          12
+#define     TEST_LIVE_WINDOW            5
+#define     TEST_LIVE_SEGMENT_BYTES     1000
+#define     TEST_LIVE_INTERVAL_US       300000
+#define     TEST_FMP4_SEGMENTS          3
+
+
+static const int64_t sBandwidths[TEST_VARIANTS] = { 200000, 600000, 1500000 };
+
+typedef std::vector<uint8_t> TestBuffer;
+
+typedef struct {
+    int                 listenSocket;
+    int                 port;
+    pthread_t           thread;
+    volatile bool       stop;
+    volatile int        rate;               //每个连接的字节/秒，0 不限
+    volatile int        connections;
+    volatile int        active;
+} TestServer;
+
+typedef struct {
+    TestServer*         server;
+    int                 socket;
+} TestConnection;
+
+static TestServer       sServer;
+static uint8_t          sContinuity[TEST_VARIANTS][8192];      //每个 variant 的分片连续编号，切换 variant 时不连续
+static uint32_t         sCrcTable[256];
+
+
+static int64_t TestNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool TestWriteFile(const std::string& path, const void* data, size_t size)
+{
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+
+    if (file == NULL)
+        return false;
+    fwrite(data, 1, size, file);
+    fclose(file);
+    return rename(temp.c_str(), path.c_str()) == 0;     //直播列表原子替换
+}
+
+static bool TestWriteText(const std::string& path, const std::string& text)
+{
+    return TestWriteFile(path, text.data(), text.size());
+}
+
+static bool TestReadFile(const std::string& path, TestBuffer& data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    uint8_t buffer[64 * 1024];
+    size_t size;
+
+    data.clear();
+    if (file == NULL)
+        return false;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + size);
+    fclose(file);
+    return true;
+}
+
+static std::string TestUrl(const char* path)
+{
+    char url[256];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", sServer.port, path);
+    return url;
+}
+
+
+/* ---------- TS 分片 ---------- */
+
+static uint32_t TestCrc32(const uint8_t* data, int length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int i;
+    for (i = 0; i < length; i++)
+        crc = (crc << 8) ^ sCrcTable[((crc >> 24) ^ data[i]) & 0xFF];
+    return crc;
+}
+
+static void TestPacketize(TestBuffer& out, uint8_t* continuity, int pid, const uint8_t* data, int size, bool randomAccess)
+{
+    bool first = true;
+
+    while (size > 0 || first) {
+        uint8_t packet[TS_PACKET_SIZE];
+        int count = TS_PACKET_SIZE - 4, field = 0;
+
+        memset(packet, 0xFF, sizeof(packet));
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = (first ? 0x40 : 0x00) | ((pid >> 8) & 0x1F);
+        packet[2] = pid & 0xFF;
+        if (first && randomAccess)
+            field = 2;
+        if (size < count - field)
+            field = count - size;
+        count -= field;
+        packet[3] = (field > 0 ? 0x30 : 0x10) | continuity[pid];
+        if (field > 0) {
+            packet[4] = field - 1;
+            if (field > 1)
+                packet[5] = (first && randomAccess) ? 0x40 : 0x00;
+        }
+        continuity[pid] = (continuity[pid] + 1) & 0x0F;
+        memcpy(packet + 4 + field, data, count);
+        out.insert(out.end(), packet, packet + TS_PACKET_SIZE);
+        data += count;
+        size -= count;
+        first = false;
+    }
+}
+
+static void TestWriteSection(TestBuffer& out, uint8_t* continuity, int pid, TestBuffer& section)
+{
+    TestBuffer payload;
+    uint32_t crc;
+
+    section[1] = 0xB0 | (((section.size() + 4 - 3) >> 8) & 0x0F);
+    section[2] = (section.size() + 4 - 3) & 0xFF;
+    crc = TestCrc32(&section[0], section.size());
+    section.push_back(crc >> 24);
+    section.push_back(crc >> 16);
+    section.push_back(crc >> 8);
+    section.push_back(crc);
+    payload.push_back(0);
+    payload.insert(payload.end(), section.begin(), section.end());
+    TestPacketize(out, continuity, pid, &payload[0], payload.size(), false);
+}
+
+/* 一个分片：PAT/PMT 之后是 MPEG-2 视频的 PES，负载开头为帧序号和 variant，关键帧由 random_access_indicator 标记 */
+static void TestBuildSegment(TestBuffer& out, int variant, int segment)
+{
+    static const uint8_t pat[] = { 0x00, 0, 0, 0x00, 0x01, 0xC1, 0, 0, 0, 1, 0xE0 | (TEST_PMT_PID >> 8), TEST_PMT_PID & 0xFF };
+    static const uint8_t pmt[] = { 0x02, 0, 0, 0, 1, 0xC1, 0, 0, 0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0,
+                                   TSStreamType_MPEG2Video, 0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0 };
+    uint8_t* continuity = sContinuity[variant];
+    int frameBytes = (int)(sBandwidths[variant] / 8 * TEST_FRAME_US / 1000000);
+    TestBuffer section, pes;
+    int i, frame;
+    int64_t pts;
+
+    section.assign(pat, pat + sizeof(pat));
+    TestWriteSection(out, continuity, 0, section);
+    section.assign(pmt, pmt + sizeof(pmt));
+    TestWriteSection(out, continuity, TEST_PMT_PID, section);
+
+    for (i = 0; i < TEST_SEGMENT_FRAMES; i++) {
+        frame = segment * TEST_SEGMENT_FRAMES + i;
+        pts = 90000 + (int64_t)frame * TEST_FRAME_US * 9 / 100;
+        pes.assign(14 + frameBytes, 0);
+        pes[2] = 1;
+        pes[3] = 0xE0;
+        pes[6] = 0x80;
+        pes[7] = 0x80;
+        pes[8] = 5;
+        pes[9] = 0x21 | (((pts >> 30) & 0x07) << 1);
+        pes[10] = (pts >> 22) & 0xFF;
+        pes[11] = (((pts >> 15) & 0x7F) << 1) | 1;
+        pes[12] = (pts >> 7) & 0xFF;
+        pes[13] = ((pts & 0x7F) << 1) | 1;
+        pes[14] = frame >> 8;
+        pes[15] = frame & 0xFF;
+        pes[16] = variant;
+        memset(&pes[17], 0x5A, frameBytes - 3);
+        TestPacketize(out, continuity, TEST_VIDEO_PID, &pes[0], pes.size(), i == 0);
+    }
+}
+
+static bool TestGenerateVod()
+{
+    static const char* names[TEST_VARIANTS] = { "low", "mid", "high" };
+    std::string master = "#EXTM3U\n#EXT-X-VERSION:4\n";
+    char line[256];
+    int v, s;
+
+    mkdir(TEST_ROOT "/vod", 0755);
+    //按带宽从高到低写，检查解析后的排序
+    for (v = TEST_VARIANTS - 1; v >= 0; v--) {
+        snprintf(line, sizeof(line), "#EXT-X-STREAM-INF:BANDWIDTH=%lld,CODECS=\"mp2v,mp4a.40.2\",RESOLUTION=%dx%d\n%s/index.m3u8\n",
+                 (long long)sBandwidths[v], 320 * (v + 1), 180 * (v + 1), names[v]);
+        master += line;
+    }
+    if (!TestWriteText(TEST_ROOT "/vod/master.m3u8", master))
+        return false;
+
+    for (v = 0; v < TEST_VARIANTS; v++) {
+        std::string directory = std::string(TEST_ROOT "/vod/") + names[v];
+        std::string media = "#EXTM3U\n#EXT-X-TARGETDURATION:1\n#EXT-X-MEDIA-SEQUENCE:0\n#EXT-X-PLAYLIST-TYPE:VOD\n";
+        TestBuffer all;
+        mkdir(directory.c_str(), 0755);
+        for (s = 0; s < TEST_SEGMENTS; s++) {
+            TestBuffer segment;
+            TestBuildSegment(segment, v, s);
+            if (v == 1) {
+                //mid：所有分片在一个文件中，第一个带 @offset，之后接着上一个
+                snprintf(line, sizeof(line), "#EXTINF:1.000,\n#EXT-X-BYTERANGE:%d", (int)segment.size());
+                media += line;
+                if (s == 0)
+                    media += "@0";
+                media += "\nall.ts\n";
+                all.insert(all.end(), segment.begin(), segment.end());
+            } else {
+                snprintf(line, sizeof(line), "#EXTINF:1.000,\nseg%d.ts\n", s);
+                media += line;
+                snprintf(line, sizeof(line), "%s/seg%d.ts", directory.c_str(), s);
+                if (!TestWriteFile(line, &segment[0], segment.size()))
+                    return false;
+            }
+        }
+        if (v == 1 && !TestWriteFile(directory + "/all.ts", &all[0], all.size()))
+            return false;
+        media += "#EXT-X-ENDLIST\n";
+        if (!TestWriteText(directory + "/index.m3u8", media))
+            return false;
+    }
+    return true;
+}
+
+static bool TestGenerateFmp4(TestBuffer& expected)
+{
+    std::string media = "#EXTM3U\n#EXT-X-TARGETDURATION:2\n#EXT-X-MAP:URI=\"init.mp4\"\n";
+    char path[256];
+    int s, i;
+
+    mkdir(TEST_ROOT "/fmp4", 0755);
+    expected.clear();
+    for (s = -1; s < TEST_FMP4_SEGMENTS; s++) {
+        TestBuffer data(s < 0 ? 700 : 20000 + s * 1000);
+        for (i = 0; i < (int)data.size(); i++)
+            data[i] = (uint8_t)(i * 7 + s * 13);
+        if (s < 0) {
+            snprintf(path, sizeof(path), TEST_ROOT "/fmp4/init.mp4");
+        } else {
+            snprintf(path, sizeof(path), TEST_ROOT "/fmp4/seg%d.m4s", s);
+            media += "#EXTINF:2.0,\n" + std::string(strrchr(path, '/') + 1) + "\n";
+        }
+        if (!TestWriteFile(path, &data[0], data.size()))
+            return false;
+        expected.insert(expected.end(), data.begin(), data.end());
+    }
+    media += "#EXT-X-ENDLIST\n";
+    return TestWriteText(TEST_ROOT "/fmp4/index.m3u8", media);
+}
+
+
+/* ---------- 静态文件服务器 ---------- */
+
+static bool TestSendAll(int socket, const uint8_t* data, size_t size, int rate)
+{
+    int64_t start = TestNowUs();
+    size_t sent = 0;
+    int ret, block;
+
+    while (sent < size) {
+        block = (int)std::min(size - sent, (size_t)4096);
+        ret = send(socket, data + sent, block, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return false;
+        sent += ret;
+        if (rate > 0) {
+            int64_t due = start + (int64_t)sent * 1000000 / rate;
+            int64_t now = TestNowUs();
+            if (due > now)
+                usleep(due - now);
+        }
+    }
+    return true;
+}
+
+static void TestRespond(TestConnection* connection, const std::string& request)
+{
+    std::string path, header;
+    TestBuffer data;
+    long long first = 0, last = -1;
+    size_t start, end;
+    const char* range;
+    char line[256];
+    int status = 200;
+
+    start = request.find(' ');
+    end = request.find(' ', start + 1);
+    path = request.substr(start + 1, end - start - 1);
+    range = strstr(request.c_str(), "\r\nRange: bytes=");
+    if (range)
+        sscanf(range + 15, "%lld-%lld", &first, &last);
+
+    if (path == "/redirect/master.m3u8") {
+        header = "HTTP/1.1 302 Found\r\nLocation: /vod/master.m3u8\r\nContent-Length: 0\r\n\r\n";
+        TestSendAll(connection->socket, (const uint8_t*)header.data(), header.size(), 0);
+        return;
+    }
+    if (path.find("..") != std::string::npos || !TestReadFile(TEST_ROOT + path, data)) {
+        header = "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found";
+        TestSendAll(connection->socket, (const uint8_t*)header.data(), header.size(), 0);
+        return;
+    }
+    if (range) {
+        if (last < 0 || last >= (long long)data.size())
+            last = (long long)data.size() - 1;
+        data.erase(data.begin() + std::min((size_t)(last + 1), data.size()), data.end());
+        data.erase(data.begin(), data.begin() + std::min((size_t)first, data.size()));
+        status = 206;
+    }
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nContent-Length: %d\r\nConnection: keep-alive\r\n\r\n",
+             status, status == 200 ? "OK" : "Partial Content", (int)data.size());
+    header = line;
+    if (TestSendAll(connection->socket, (const uint8_t*)header.data(), header.size(), 0) && !data.empty())
+        TestSendAll(connection->socket, &data[0], data.size(), connection->server->rate);
+}
+
+static void* TestConnectionThread(void* arg)
+{
+    TestConnection* connection = (TestConnection*)arg;
+    std::string buffer;
+    struct pollfd fd;
+    char data[4096];
+    size_t end;
+    int requests = 0, size;
+
+    fd.fd = connection->socket;
+    fd.events = POLLIN;
+    while (!connection->server->stop && requests < TEST_MAX_REQUESTS) {
+        end = buffer.find("\r\n\r\n");
+        if (end != std::string::npos) {
+            TestRespond(connection, buffer.substr(0, end + 2));
+            buffer.erase(0, end + 4);
+            requests++;
+            continue;
+        }
+        if (poll(&fd, 1, 100) <= 0)
+            continue;
+        size = recv(connection->socket, data, sizeof(data), 0);
+        if (size <= 0)
+            break;
+        buffer.append(data, size);
+    }
+    //超过请求数时不发 Connection: close 直接关闭，模拟服务器关闭空闲的 keep-alive 连接
+    close(connection->socket);
+    __sync_fetch_and_sub(&connection->server->active, 1);
+    delete connection;
+    return NULL;
+}
+
+static void* TestAcceptThread(void* arg)
+{
+    TestServer* server = (TestServer*)arg;
+    struct pollfd fd;
+    pthread_t thread;
+    int socket;
+
+    fd.fd = server->listenSocket;
+    fd.events = POLLIN;
+    while (!server->stop) {
+        if (poll(&fd, 1, 100) <= 0)
+            continue;
+        socket = accept(server->listenSocket, NULL, NULL);
+        if (socket < 0)
+            continue;
+        TestConnection* connection = new TestConnection;
+        connection->server = server;
+        connection->socket = socket;
+        __sync_fetch_and_add(&server->connections, 1);
+        __sync_fetch_and_add(&server->active, 1);
+        if (pthread_create(&thread, NULL, TestConnectionThread, connection) != 0) {
+            close(socket);
+            __sync_fetch_and_sub(&server->active, 1);
+            delete connection;
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static bool TestServerStart(TestServer* server)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int on = 1;
+
+    memset(server, 0, sizeof(*server));
+    server->listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listenSocket < 0)
+        return false;
+    setsockopt(server->listenSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server->listenSocket, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(server->listenSocket, 16) < 0)
+        return false;
+    getsockname(server->listenSocket, (struct sockaddr*)&address, &length);
+    server->port = ntohs(address.sin_port);
+    return pthread_create(&server->thread, NULL, TestAcceptThread, server) == 0;
+}
+
+static void TestServerStop(TestServer* server)
+{
+    server->stop = true;
+    pthread_join(server->thread, NULL);
+    while (server->active > 0)
+        usleep(10000);
+    close(server->listenSocket);
+}
+
+
+/* ---------- 测试 ---------- */
+
+static int TestParse()
+{
+    const char* master =
+        "\xEF\xBB\xBF#EXTM3U\r\n"
+        "#EXT-X-STREAM-INF:BANDWIDTH=2000000,CODECS=\"avc1.64001f,mp4a.40.2\",RESOLUTION=1280x720\r\n"
+        "hd/index.m3u8?token=1\r\n"
+        "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",URI=\"audio.m3u8\"\r\n"
+        "#EXT-X-STREAM-INF:AVERAGE-BANDWIDTH=400000,BANDWIDTH=500000\r\n"
+        "../sd/index.m3u8\r\n";
+    const char* media =
+        "#EXTM3U\n#EXT-X-TARGETDURATION:6\n#EXT-X-MEDIA-SEQUENCE:100\n"
+        "#EXT-X-MAP:URI=\"init.mp4\",BYTERANGE=\"720@0\"\n"
+        "#EXTINF:6.006,\n#EXT-X-BYTERANGE:1000@720\nmain.mp4\n"
+        "#EXTINF:5.5,title\n#EXT-X-BYTERANGE:2000\nmain.mp4\n"
+        "#EXT-X-DISCONTINUITY\n#EXTINF:4,\n/abs/seg.m4s\n#EXT-X-ENDLIST\n";
+    const char* encrypted = "#EXTM3U\n#EXT-X-KEY:METHOD=AES-128,URI=\"key\"\n#EXTINF:2,\na.ts\n";
+    static const char* urls[][3] = {
+        { "http://h/a/b/c.m3u8", "d.ts", "http://h/a/b/d.ts" },
+        { "http://h/a/b/c.m3u8?x=/y", "../d.ts", "http://h/a/d.ts" },
+        { "http://h:81/a/c.m3u8", "/e/./f/../g.ts", "http://h:81/e/g.ts" },
+        { "http://h/a/c.m3u8", "//cdn/x.ts", "http://cdn/x.ts" },
+        { "http://h", "x.ts", "http://h/x.ts" },
+        { "http://h/a/", "https://o/x.ts", "https://o/x.ts" },
+    };
+    HLSPlaylist playlist;
+    const HLSSegment* segment;
+    int failed = 0, i;
+
+    if (playlist.parse(master, strlen(master), "http://host/live/master.m3u8") != 0 || !playlist.isMaster()
+        || playlist.getVariantCount() != 2 || playlist.getVariant(0)->bandwidth != 500000
+        || playlist.getVariant(0)->averageBandwidth != 400000 || playlist.getVariant(0)->url != "http://host/sd/index.m3u8"
+        || playlist.getVariant(1)->codecs != "avc1.64001f,mp4a.40.2" || playlist.getVariant(1)->height != 720
+        || playlist.getVariant(1)->url != "http://host/live/hd/index.m3u8?token=1")
+        failed = 1;
+
+    if (playlist.parse(media, strlen(media), "http://host/vod/index.m3u8") != 0 || playlist.isMaster() || !playlist.isEnded()
+        || playlist.getSegmentCount() != 3 || playlist.getTargetDurationUs() != 6000000 || playlist.getFirstSequence() != 100
+        || playlist.getDurationUs() != 15506000) {
+        failed = 1;
+    } else {
+        segment = playlist.getSegment(1);
+        if (playlist.getSegment(0)->rangeOffset != 720 || segment->rangeOffset != 1720 || segment->rangeLength != 2000
+            || segment->startUs != 6006000 || segment->sequence != 101 || segment->mapIndex != 0
+            || playlist.getMap(0)->rangeLength != 720 || playlist.getMap(0)->url != "http://host/vod/init.mp4"
+            || !playlist.getSegment(2)->discontinuity || playlist.getSegment(2)->url != "http://host/abs/seg.m4s"
+            || playlist.findTime(6005999) != 0 || playlist.findTime(6006000) != 1 || playlist.findTime(99000000) != 2
+            || playlist.findSequence(102) != 2 || playlist.findSequence(103) != -1)
+            failed = 1;
+    }
+    if (playlist.parse(encrypted, strlen(encrypted), "http://host/x.m3u8") == 0 || playlist.parse("a.ts\n", 5, "http://h/x") == 0)
+        failed = 1;
+
+    for (i = 0; i < (int)(sizeof(urls) / sizeof(urls[0])); i++) {
+        std::string resolved = HLSResolveUrl(urls[i][0], urls[i][1]);
+        if (resolved != urls[i][2]) {
+            printf("    resolve [%s] [%s] -> [%s]\n", urls[i][0], urls[i][1], resolved.c_str());
+            failed = 1;
+        }
+    }
+    if (!HLSIsPlaylistUrl("http://h/a.M3U8?x") || HLSIsPlaylistUrl("http://h/a.ts") || HLSIsPlaylistUrl("/tmp/a.m3u8"))
+        failed = 1;
+    printf("[parse] master, media, resolve: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestAdaptation()
+{
+    std::vector<int64_t> bandwidths(sBandwidths, sBandwidths + TEST_VARIANTS);
+    HLSAdaptation adaptation;
+    HLSConfig config;
+    int failed = 0, i;
+
+    HLSConfigDefault(&config);
+    //没有样本时不变
+    if (adaptation.select(bandwidths, 1, 0, config) != 1)
+        failed = 1;
+    //10Mbps：缓冲不够时不升，够时每次升一级
+    adaptation.addSample(1250000, 1000000);
+    if (adaptation.getBandwidth() != 10000000 || adaptation.select(bandwidths, 0, config.lowBufferUs, config) != 0
+        || adaptation.select(bandwidths, 0, config.switchUpBufferUs, config) != 1
+        || adaptation.select(bandwidths, 1, config.switchUpBufferUs, config) != 2)
+        failed = 1;
+    //太小的样本忽略；带宽降到 1Mbps：快速的 EWMA 跟随，高码率超过估计时降
+    adaptation.addSample(1000, 1000000);
+    for (i = 0; i < 6; i++)
+        adaptation.addSample(125000, 1000000);
+    if (adaptation.getBandwidth() > 1300000 || adaptation.select(bandwidths, 2, config.maxBufferUs, config) != 1)
+        failed = 1;
+    //600k 在估计之内：缓冲正常时保持，低于低水位时按 70% 降到最低
+    adaptation.reset();
+    adaptation.addSample(100000, 1000000);
+    if (adaptation.select(bandwidths, 1, config.switchUpBufferUs - 1, config) != 1
+        || adaptation.select(bandwidths, 1, config.lowBufferUs - 1, config) != 0)
+        failed = 1;
+    printf("[adaptation] estimate and switching rules: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestSourceRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    int ret = ((HLSClient*)opaque)->read(offset, buffer, size, HLS_SOURCE_TIMEOUT_MS);
+    return (ret == -2) ? -1 : ret;
+}
+
+/* 经过 Demuxer 读完，检查帧序号连续；返回读到的帧数，variants 为每帧的 variant */
+static int TestDemux(const DemuxSource& source, int firstFrame, std::vector<int>& variants, bool* ordered)
+{
+    Demuxer* demuxer = DemuxerOpen(source, NULL);
+    DemuxPacket* packet;
+    int frames = 0, frame;
+
+    *ordered = (demuxer != NULL);
+    variants.clear();
+    if (demuxer == NULL)
+        return 0;
+    while (demuxer->readPacket(&packet) == 0) {
+        frame = (packet->data[0] << 8) | packet->data[1];
+        if (frame != firstFrame + frames || ((frame % TEST_SEGMENT_FRAMES == 0) != ((packet->flags & DemuxPacket_Keyframe) != 0)))
+            *ordered = false;
+        variants.push_back(packet->data[2]);
+        frames++;
+        DemuxPacketUnref(packet);
+    }
+    delete demuxer;
+    return frames;
+}
+
+static int TestVod()
+{
+    HLSClient client;
+    HLSConfig config;
+    HLSStatistics statistics;
+    DemuxSource source;
+    std::vector<int> variants;
+    bool ordered, monotonic = true;
+    int frames, failed = 0;
+    size_t i;
+
+    HLSConfigDefault(&config);
+    config.maxBufferUs = 6000000;
+    config.lowBufferUs = 2000000;
+    config.switchUpBufferUs = 3000000;
+    sServer.rate = 0;
+    if (client.open(TestUrl("/redirect/master.m3u8").c_str(), &config) != 0) {
+        printf("[vod] open: FAILED\n");
+        return 1;
+    }
+    usleep(300000);         //先预取到缓冲上限
+    source.read = TestSourceRead;
+    source.size = -1;
+    source.opaque = &client;
+    frames = TestDemux(source, 0, variants, &ordered);
+    statistics = client.getStatistics();
+    for (i = 1; i < variants.size(); i++) {
+        if (variants[i] < variants[i - 1])
+            monotonic = false;
+    }
+    if (!ordered || frames != TEST_SEGMENTS * TEST_SEGMENT_FRAMES || !monotonic || variants.back() != TEST_VARIANTS - 1
+        || statistics.switchesUp != TEST_VARIANTS - 1 || statistics.switchesDown != 0 || client.getDurationUs() != TEST_SEGMENTS * 1000000
+        || statistics.http.reuses == 0 || statistics.http.retries == 0
+        || statistics.http.connects > statistics.http.requests / (TEST_MAX_REQUESTS - 1) + 1)
+        failed = 1;
+    printf("[vod] frames %d, up %lld, last variant %d, requests %lld on %lld connections (%lld retries): %s\n", frames,
+           (long long)statistics.switchesUp, variants.empty() ? -1 : variants.back(), (long long)statistics.http.requests,
+           (long long)statistics.http.connects, (long long)statistics.http.retries, failed ? "FAILED" : "OK");
+    client.close();
+    return failed;
+}
+
+static int TestThrottle()
+{
+    HLSClient client;
+    HLSConfig config;
+    HLSStatistics statistics;
+    uint8_t buffer[64 * 1024];
+    int64_t offset = 0;
+    int size, failed = 0;
+
+    //每个连接 150KB/s = 1.2Mbps，最高码率 1.5Mbps 不够
+    HLSConfigDefault(&config);
+    config.startBandwidth = 10000000;
+    sServer.rate = 150000;
+    if (client.open(TestUrl("/vod/master.m3u8").c_str(), &config) != 0 || client.getVariant() != TEST_VARIANTS - 1) {
+        printf("[throttle] open: FAILED\n");
+        sServer.rate = 0;
+        return 1;
+    }
+    while (client.getStatistics().segments < 4 && (size = client.read(offset, buffer, sizeof(buffer), 10000)) > 0)
+        offset += size;
+    statistics = client.getStatistics();
+    if (statistics.switchesDown < 1 || client.getVariant() != 1 || statistics.switchesUp != 0
+        || statistics.bandwidth < 900000 || statistics.bandwidth > 1300000)
+        failed = 1;
+    printf("[throttle] estimate %lld bps, down %lld, variant %d: %s\n", (long long)statistics.bandwidth,
+           (long long)statistics.switchesDown, client.getVariant(), failed ? "FAILED" : "OK");
+    client.close();
+    sServer.rate = 0;
+    return failed;
+}
+
+static int TestFmp4(const TestBuffer& expected)
+{
+    HLSClient client;
+    TestBuffer received;
+    uint8_t buffer[5000];
+    int size, failed = 0;
+
+    if (client.open(TestUrl("/fmp4/index.m3u8").c_str(), NULL) != 0) {
+        printf("[fmp4] open: FAILED\n");
+        return 1;
+    }
+    while ((size = client.read(received.size(), buffer, sizeof(buffer), 5000)) > 0)
+        received.insert(received.end(), buffer, buffer + size);
+    //DemuxerOpen 会从头重读
+    if (size != 0 || received != expected || client.read(0, buffer, 16, 0) != 16 || memcmp(buffer, &expected[0], 16) != 0)
+        failed = 1;
+    printf("[fmp4] init + %d segments, %d bytes: %s\n", TEST_FMP4_SEGMENTS, (int)received.size(), failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestSeek()
+{
+    DemuxSource source;
+    std::vector<int> variants;
+    int64_t startUs;
+    bool ordered;
+    int frames, failed = 0;
+
+    if (DemuxSourceOpenHLS(&source, TestUrl("/vod/low/index.m3u8").c_str()) != 0) {
+        printf("[seek] open: FAILED\n");
+        return 1;
+    }
+    startUs = ((HLSClient*)source.opaque)->seek(5500000);
+    frames = TestDemux(source, 5 * TEST_SEGMENT_FRAMES, variants, &ordered);
+    if (startUs != 5000000 || !ordered || frames != (TEST_SEGMENTS - 5) * TEST_SEGMENT_FRAMES)
+        failed = 1;
+    printf("[seek] 5.5s -> segment %lld ms, frames %d: %s\n", (long long)startUs / 1000, frames, failed ? "FAILED" : "OK");
+    DemuxSourceCloseHLS(&source);
+    return failed;
+}
+
+/* 直播列表：每 TEST_LIVE_INTERVAL_US 增加一个分片，窗口中保留 TEST_LIVE_WINDOW 个，最后加上 ENDLIST */
+static void TestWriteLive(int last, bool ended)
+{
+    int first = std::max(0, last - TEST_LIVE_WINDOW + 1), s;
+    char line[128];
+    std::string media = "#EXTM3U\n#EXT-X-TARGETDURATION:0.3\n";
+
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%d\n", first);
+    media += line;
+    for (s = first; s <= last; s++) {
+        snprintf(line, sizeof(line), "#EXTINF:0.3,\nseg%d.bin\n", s);
+        media += line;
+    }
+    if (ended)
+        media += "#EXT-X-ENDLIST\n";
+    TestWriteText(TEST_ROOT "/live/index.m3u8", media);
+}
+
+static void* TestLiveThread(void* arg)
+{
+    int s;
+
+    for (s = TEST_LIVE_WINDOW; s < TEST_LIVE_SEGMENTS; s++) {
+        usleep(TEST_LIVE_INTERVAL_US);
+        TestWriteLive(s, s == TEST_LIVE_SEGMENTS - 1);
+    }
+    return arg;
+}
+
+static int TestLive()
+{
+    HLSClient client;
+    HLSStatistics statistics;
+    TestBuffer received;
+    std::vector<int> sequences;
+    pthread_t thread;
+    uint8_t buffer[4096];
+    char path[128];
+    bool contiguous = true;
+    int size, s, failed = 0;
+    size_t i;
+
+    mkdir(TEST_ROOT "/live", 0755);
+    for (s = 0; s < TEST_LIVE_SEGMENTS; s++) {
+        TestBuffer segment(TEST_LIVE_SEGMENT_BYTES, '.');
+        snprintf((char*)&segment[0], TEST_LIVE_SEGMENT_BYTES, "SEQ%08d", s);
+        snprintf(path, sizeof(path), TEST_ROOT "/live/seg%d.bin", s);
+        TestWriteFile(path, &segment[0], segment.size());
+    }
+    TestWriteLive(TEST_LIVE_WINDOW - 1, false);
+
+    if (client.open(TestUrl("/live/index.m3u8").c_str(), NULL) != 0 || !client.isLive()) {
+        printf("[live] open: FAILED\n");
+        return 1;
+    }
+    pthread_create(&thread, NULL, TestLiveThread, NULL);
+    while ((size = client.read(received.size(), buffer, sizeof(buffer), 5000)) > 0)
+        received.insert(received.end(), buffer, buffer + size);
+    pthread_join(thread, NULL);
+
+    for (i = 0; i + TEST_LIVE_SEGMENT_BYTES <= received.size(); i += TEST_LIVE_SEGMENT_BYTES) {
+        if (sscanf((const char*)&received[i], "SEQ%08d", &s) == 1)
+            sequences.push_back(s);
+    }
+    for (i = 1; i < sequences.size(); i++) {
+        if (sequences[i] != sequences[i - 1] + 1)
+            contiguous = false;
+    }
+    statistics = client.getStatistics();
+    //从窗口的倒数第 HLS_LIVE_EDGE_SEGMENTS 个开始，读到 ENDLIST 结束
+    if (size != 0 || sequences.empty() || sequences[0] != TEST_LIVE_WINDOW - HLS_LIVE_EDGE_SEGMENTS || !contiguous
+        || sequences.back() != TEST_LIVE_SEGMENTS - 1 || received.size() % TEST_LIVE_SEGMENT_BYTES != 0
+        || statistics.reloads < TEST_LIVE_SEGMENTS - TEST_LIVE_WINDOW || client.isLive())
+        failed = 1;
+    printf("[live] segments %d..%d, reloads %lld: %s\n", sequences.empty() ? -1 : sequences[0],
+           sequences.empty() ? -1 : sequences.back(), (long long)statistics.reloads, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+
+int main()
+{
+    TestBuffer fmp4;
+    int failed = 0, i, j;
+
+    for (i = 0; i < 256; i++) {
+        uint32_t crc = (uint32_t)i << 24;
+        for (j = 0; j < 8; j++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        sCrcTable[i] = crc;
+    }
+
+    failed += TestParse();
+    failed += TestAdaptation();
+
+    mkdir(TEST_ROOT, 0755);
+    if (!TestGenerateVod() || !TestGenerateFmp4(fmp4) || !TestServerStart(&sServer)) {
+        printf("[fixture] %s: FAILED\n", TEST_ROOT);
+        return 1;
+    }
+    failed += TestVod();
+    failed += TestThrottle();
+    failed += TestFmp4(fmp4);
+    failed += TestSeek();
+    failed += TestLive();
+    TestServerStop(&sServer);
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,499 @@
+/**
+ *  TestMP3Parser.cpp文件
+ *  MP3Parser 的正确性测试和性能测试，测试文件在内存中生成：
+ *          30 分钟 VBR：ID3v2 + Xing/LAME 头 + ID3v1，整个输入和随机分块输入结果一致，采样 seek 表和 Xing TOC seek
+ *          CBR：没有 VBR 头，APEv2 + ID3v1，由文件大小计算时长，seek 按帧对齐
+ *          VBRI 头，MPEG2 Layer III 单声道，中间插入垃圾数据后重新同步
+ *
+ *  用法：TestMP3Parser.elf [file.mp3]，指定文件时输出该文件的信息并测试 seek
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "MP3Parser.h"
+
+
+typedef struct {
+    std::vector<uint8_t>    data;
+    std::vector<int64_t>    offsets;        //每一帧音频的位置，不包括 Xing/VBRI 帧
+    int64_t                 audioStart;
+    int64_t                 audioEnd;
+} TestFile;
+
+typedef struct {
+    int                     infoCount;
+    std::vector<int64_t>    offsets;
+    std::vector<int64_t>    frameNumbers;
+    std::vector<int64_t>    pts;
+    uint32_t                checksum;
+} TestResult;
+
+
+static uint32_t s_seed = 1;
+static uint32_t TestRandom()
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return s_seed >> 8;
+}
+
+static double TestNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/* MPEG1/MPEG2 Layer III 帧，side information 全为 0 (解码为静音)，之后为随机数据 */
+static int TestAppendFrame(std::vector<uint8_t>& out, bool mpeg1, int bitrateIndex, int rateIndex, bool padding, bool mono)
+{
+    uint8_t header[4];
+    MP3FrameHeader parsed;
+    size_t start = out.size();
+    int sideInfo = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    header[0] = 0xFF;
+    header[1] = mpeg1 ? 0xFB : 0xF3;
+    header[2] = (bitrateIndex << 4) | (rateIndex << 2) | (padding ? 2 : 0);
+    header[3] = mono ? 0xC0 : 0x40;
+    MP3ParseFrameHeader(header, &parsed);
+    out.insert(out.end(), header, header + 4);
+    out.resize(start + 4 + sideInfo, 0);
+    while (out.size() < start + parsed.frameSize)
+        out.push_back(TestRandom() & 0xFF);
+    return parsed.frameSize;
+}
+
+static void TestAppendID3v2(std::vector<uint8_t>& out, int size)
+{
+    const uint8_t header[10] = { 'I', 'D', '3', 4, 0, 0, (uint8_t)((size >> 21) & 0x7F), (uint8_t)((size >> 14) & 0x7F),
+                                 (uint8_t)((size >> 7) & 0x7F), (uint8_t)(size & 0x7F) };
+    out.insert(out.end(), header, header + 10);
+    for (int i = 0; i < size; i++)
+        out.push_back((i % 7 == 0) ? 0xFF : 'a' + i % 26);     //标签内容中的 0xFF 不能被当作同步字
+}
+
+static void TestAppendID3v1(std::vector<uint8_t>& out)
+{
+    uint8_t tag[128];
+    memset(tag, 0, sizeof(tag));
+    memcpy(tag, "TAG", 3);
+    memcpy(tag + 3, "Test Title", 10);
+    memcpy(tag + 33, "Test Artist   ", 14);
+    memcpy(tag + 93, "2016", 4);
+    tag[126] = 7;
+    tag[127] = 17;
+    out.insert(out.end(), tag, tag + sizeof(tag));
+}
+
+static void TestPutU32(uint8_t* p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+
+/* VBR：ID3v2 + Xing/LAME + frames 帧随机码率 + ID3v1 */
+static void TestBuildVbr(TestFile& file, int frames)
+{
+    std::vector<uint8_t>& out = file.data;
+    uint8_t* xing;
+    int64_t bytes;
+    int i;
+
+    TestAppendID3v2(out, 3000);
+    file.audioStart = out.size();
+    TestAppendFrame(out, true, 9, 0, false, false);
+    for (i = 0; i < frames; i++) {
+        file.offsets.push_back(out.size());
+        TestAppendFrame(out, true, 5 + TestRandom() % 10, 0, TestRandom() & 1, false);
+    }
+    file.audioEnd = out.size();
+    TestAppendID3v1(out);
+
+    bytes = file.audioEnd - file.audioStart;
+    xing = &out[file.audioStart + 4 + 32];
+    memcpy(xing, "Xing", 4);
+    TestPutU32(xing + 4, 0x0F);
+    TestPutU32(xing + 8, frames);
+    TestPutU32(xing + 12, bytes);
+    for (i = 0; i < MP3_XING_TOC_SIZE; i++)
+        xing[16 + i] = (uint8_t)((file.offsets[(int64_t)frames * i / 100] - file.audioStart) * 256 / bytes);
+    TestPutU32(xing + 116, 50);
+    memcpy(xing + 120, "LAME3.100", 9);
+    xing[120 + 21] = 576 >> 4;                          //delay 576，padding 1000
+    xing[120 + 22] = ((576 & 0x0F) << 4) | (1000 >> 8);
+    xing[120 + 23] = 1000 & 0xFF;
+}
+
+/* CBR 128kbps，按编码器的方式插入 padding，末尾 APEv2 + ID3v1 */
+static void TestBuildCbr(TestFile& file, int frames)
+{
+    std::vector<uint8_t>& out = file.data;
+    uint8_t footer[32];
+    int rest = 0;
+
+    file.audioStart = 0;
+    for (int i = 0; i < frames; i++) {
+        bool padding;
+        rest += (144 * 128000) % 44100;
+        padding = rest >= 44100;
+        if (padding)
+            rest -= 44100;
+        file.offsets.push_back(out.size());
+        TestAppendFrame(out, true, 9, 0, padding, false);
+    }
+    file.audioEnd = out.size();
+
+    memset(footer, 0, sizeof(footer));
+    memcpy(footer, "APETAGEX", 8);
+    footer[8] = 0xD0;
+    footer[9] = 0x07;           //2000
+    footer[12] = 100;           //大小包括 footer，不包括 header
+    footer[23] = 0x80;          //有 header
+    out.insert(out.end(), footer, footer + 32);             //header
+    out.resize(out.size() + 100 - 32, 0x20);
+    out.insert(out.end(), footer, footer + 32);
+    TestAppendID3v1(out);
+}
+
+/* VBRI：MPEG1 Layer III，表中每项 entryFrames 帧 */
+static void TestBuildVbri(TestFile& file, int frames, int entryFrames)
+{
+    std::vector<uint8_t>& out = file.data;
+    int entries = (frames + entryFrames - 1) / entryFrames;
+    uint8_t* vbri;
+    int i;
+
+    file.audioStart = 0;
+    TestAppendFrame(out, true, 14, 0, false, false);        //320kbps，放得下表
+    for (i = 0; i < frames; i++) {
+        file.offsets.push_back(out.size());
+        TestAppendFrame(out, true, 5 + TestRandom() % 10, 0, false, false);
+    }
+    file.offsets.push_back(out.size());
+    file.audioEnd = out.size();
+
+    vbri = &out[4 + 32];
+    memset(vbri, 0, 26 + entries * 2);
+    memcpy(vbri, "VBRI", 4);
+    vbri[5] = 1;
+    vbri[7] = 0x40;                                     //delay
+    TestPutU32(vbri + 10, file.audioEnd);
+    TestPutU32(vbri + 14, frames);
+    vbri[18] = entries >> 8;
+    vbri[19] = entries & 0xFF;
+    vbri[21] = 1;                                       //scale
+    vbri[23] = 2;                                       //entry size
+    vbri[25] = entryFrames;
+    for (i = 0; i < entries; i++) {
+        int64_t begin = (i == 0) ? 0 : file.offsets[i * entryFrames];
+        int64_t end = file.offsets[std::min((i + 1) * entryFrames, frames)];
+        vbri[26 + i * 2] = (end - begin) >> 8;
+        vbri[27 + i * 2] = (end - begin) & 0xFF;
+    }
+}
+
+
+static void TestOnInfo(const MP3Info* /*info*/, void* userData)
+{
+    ((TestResult*)userData)->infoCount++;
+}
+
+static void TestOnFrame(const MP3Frame* frame, void* userData)
+{
+    TestResult* result = (TestResult*)userData;
+
+    result->offsets.push_back(frame->fileOffset);
+    result->frameNumbers.push_back(frame->frameNumber);
+    result->pts.push_back(frame->ptsUs);
+    for (int i = 0; i < frame->size; i += 64)
+        result->checksum = result->checksum * 31 + frame->data[i];
+}
+
+static void TestParse(MP3Parser& parser, TestResult& result, const uint8_t* data, int64_t size, int chunkMax)
+{
+    MP3ParserCallbacks callbacks = { TestOnInfo, TestOnFrame, &result };
+    int64_t offset = 0;
+
+    parser.setCallbacks(callbacks);
+    while (offset < size) {
+        int chunk = (chunkMax > 0) ? 1 + TestRandom() % chunkMax : (int)std::min<int64_t>(size, 1 << 30);
+        if (chunk > size - offset)
+            chunk = size - offset;
+        parser.parse(data + offset, chunk);
+        offset += chunk;
+    }
+    parser.flush();
+}
+
+static bool TestFramesMatch(const TestResult& result, const TestFile& file, int frames, int sampleRate, int samplesPerFrame)
+{
+    if ((int)result.offsets.size() != frames)
+        return false;
+    for (int i = 0; i < frames; i++) {
+        if (result.offsets[i] != file.offsets[i] || result.frameNumbers[i] != i
+                || result.pts[i] != (int64_t)i * samplesPerFrame * 1000000 / sampleRate)
+            return false;
+    }
+    return true;
+}
+
+/* 从 seek 得到的位置继续解析，返回第一帧 */
+static int TestResumeAt(MP3Parser& parser, const TestFile& file, int64_t offset, int64_t timeUs, TestResult& result)
+{
+    int64_t end = std::min<int64_t>(offset + 32768, file.data.size());
+    parser.resume(offset, timeUs);
+    TestParse(parser, result, &file.data[offset], end - offset, 4096);
+    return result.offsets.empty() ? -1 : 0;
+}
+
+
+static int TestVbr()
+{
+    const int frames = 30 * 60 * 44100 / 1152;             //30 分钟
+    TestFile file;
+    int errors = 0;
+    double start;
+
+    s_seed = 1;
+    TestBuildVbr(file, frames);
+
+    MP3Parser whole;
+    TestResult wholeResult = TestResult();
+    start = TestNow();
+    whole.parseTail(&file.data[file.data.size() - MP3_TAIL_SIZE], MP3_TAIL_SIZE, file.data.size());
+    TestParse(whole, wholeResult, &file.data[0], file.data.size(), 0);
+    double seconds = TestNow() - start;
+    const MP3Info* info = whole.getInfo();
+    const MP3ID3v1Tag* tag = whole.getTag();
+    printf("vbr %.1f MB: %d frames, %.1f s, %d bps, parse %.0f MB/s\n", file.data.size() / 1e6, (int)wholeResult.offsets.size(),
+            info ? info->durationUs / 1e6 : 0, info ? info->bitrate : 0, file.data.size() / seconds / 1e6);
+    if (info == NULL || info->vbrHeader != MP3VbrHeader_Xing || !info->isVBR || info->frames != frames
+            || info->durationUs != (int64_t)frames * 1152 * 1000000 / 44100 || info->encoderDelay != 576 || info->encoderPadding != 1000
+            || info->id3v2Size != 3010 || info->audioStart != file.audioStart || info->audioEnd != file.audioEnd
+            || wholeResult.infoCount != 1 || tag == NULL || strcmp(tag->title, "Test Title") != 0
+            || strcmp(tag->artist, "Test Artist") != 0 || tag->track != 7 || tag->genre != 17) {
+        printf("  info FAILED\n");
+        errors++;
+    }
+    if (!TestFramesMatch(wholeResult, file, frames, 44100, 1152)) {
+        printf("  frames FAILED\n");
+        errors++;
+    }
+
+    //分块输入：块越小只输入越短的开头
+    for (int chunkMax = 1; chunkMax <= 1 << 20; chunkMax *= 32) {
+        MP3Parser chunked;
+        TestResult chunkedResult = TestResult();
+        int64_t size = std::min<int64_t>(file.data.size(), (int64_t)chunkMax * 65536);
+        size_t complete = std::upper_bound(file.offsets.begin(), file.offsets.end(), size - MP3_FRAME_SIZE_MAX) - file.offsets.begin();
+        TestParse(chunked, chunkedResult, &file.data[0], size, chunkMax);
+        bool ok = chunkedResult.offsets.size() >= complete && chunkedResult.offsets.size() <= wholeResult.offsets.size();
+        for (size_t i = 0; ok && i < chunkedResult.offsets.size(); i++)
+            ok = chunkedResult.offsets[i] == wholeResult.offsets[i] && chunkedResult.pts[i] == wholeResult.pts[i];
+        if (!ok || (size == (int64_t)file.data.size() && chunkedResult.checksum != wholeResult.checksum)) {
+            printf("  chunk max %d: %d frames FAILED\n", chunkMax, (int)chunkedResult.offsets.size());
+            errors++;
+        }
+    }
+
+    //已解析的部分：采样 seek 表，精确到帧
+    int seekErrors = 0;
+    for (int k = 0; k < 200; k++) {
+        int64_t timeUs = (int64_t)(TestRandom() % 1800000) * 1000, offset, frameTimeUs;
+        TestResult resumed = TestResult();
+        if (whole.seekTo(timeUs, &offset, &frameTimeUs) != 1 || frameTimeUs > timeUs || timeUs - frameTimeUs > 32 * 26123
+                || TestResumeAt(whole, file, offset, frameTimeUs, resumed) < 0 || resumed.offsets[0] != offset
+                || resumed.frameNumbers[0] % MP3_SEEK_INDEX_INTERVAL != 0 || file.offsets[resumed.frameNumbers[0]] != offset
+                || resumed.pts[0] != wholeResult.pts[resumed.frameNumbers[0]])
+            seekErrors++;
+    }
+    printf("  seek with index: %s\n", seekErrors ? "FAILED" : "OK");
+    errors += seekErrors;
+
+    //只读了开头：Xing TOC 估计位置，误差在 TOC 的精度内
+    MP3Parser fresh;
+    TestResult freshResult = TestResult();
+    int64_t maxError = 0;
+    seekErrors = 0;
+    TestParse(fresh, freshResult, &file.data[0], 65536, 0);
+    for (int k = 0; k < 200; k++) {
+        int64_t timeUs = (int64_t)(TestRandom() % 1800000) * 1000, offset, frameTimeUs, actual;
+        TestResult resumed = TestResult();
+        if (fresh.seekTo(timeUs, &offset, &frameTimeUs) != 0 || TestResumeAt(fresh, file, offset, frameTimeUs, resumed) < 0
+                || resumed.frameNumbers[0] != -1 || resumed.pts[0] != frameTimeUs) {
+            seekErrors++;
+            continue;
+        }
+        actual = file.offsets[(int64_t)timeUs * 44100 / (1152 * 1000000LL)];
+        maxError = std::max<int64_t>(maxError, llabs(resumed.offsets[0] - actual));
+    }
+    printf("  seek with xing toc: max error %lld bytes (file/256 = %lld) %s\n", (long long)maxError,
+            (long long)(file.audioEnd - file.audioStart) / 256, seekErrors ? "FAILED" : "OK");
+    if (maxError > (file.audioEnd - file.audioStart) / 256 + MP3_FRAME_SIZE_MAX)
+        seekErrors++;
+    errors += seekErrors;
+
+    //O(1) seek 的耗时
+    int64_t offset;
+    start = TestNow();
+    for (int k = 0; k < 1000000; k++)
+        whole.seekTo((int64_t)k * 1800, &offset, NULL);
+    printf("  seekTo: %.1f ns\n", (TestNow() - start) * 1e3);
+    return errors;
+}
+
+
+static int TestCbr()
+{
+    const int frames = 10 * 60 * 44100 / 1152;
+    TestFile file;
+    int errors = 0;
+
+    TestBuildCbr(file, frames);
+    MP3Parser parser;
+    TestResult result = TestResult();
+    parser.parseTail(&file.data[file.data.size() - MP3_TAIL_SIZE], MP3_TAIL_SIZE, file.data.size());
+    TestParse(parser, result, &file.data[0], 32768, 1000);     //只读开头
+    const MP3Info* info = parser.getInfo();
+    int64_t expectUs = (int64_t)((file.audioEnd - file.audioStart) * 8e6 / 128000);
+    if (info == NULL || info->isVBR || info->vbrHeader != MP3VbrHeader_None || info->audioEnd != file.audioEnd
+            || info->bitrate != 128000 || info->durationUs != expectUs || parser.getTag() == NULL) {
+        printf("  cbr info FAILED\n");
+        errors++;
+    }
+    for (int k = 0; k < 200; k++) {
+        int64_t timeUs = (int64_t)(10000 + TestRandom() % 590000) * 1000, offset, frameTimeUs;     //开头 10 秒在采样 seek 表中
+        int64_t frame = timeUs * 44100 / (1152 * 1000000LL);
+        TestResult resumed = TestResult();
+        if (parser.seekTo(timeUs, &offset, &frameTimeUs) != 0 || frameTimeUs != frame * 1152 * 1000000 / 44100
+                || TestResumeAt(parser, file, offset, frameTimeUs, resumed) < 0
+                || llabs(resumed.offsets[0] - file.offsets[frame]) > MP3_FRAME_SIZE_MAX) {
+            errors++;
+            break;
+        }
+    }
+
+    MP3Parser whole;
+    TestResult wholeResult = TestResult();
+    whole.parseTail(&file.data[file.data.size() - MP3_TAIL_SIZE], MP3_TAIL_SIZE, file.data.size());
+    TestParse(whole, wholeResult, &file.data[0], file.data.size(), 5000);
+    if (!TestFramesMatch(wholeResult, file, frames, 44100, 1152)) {
+        printf("  cbr frames FAILED\n");
+        errors++;
+    }
+    printf("cbr %d frames, %.1f s: %s\n", frames, info ? info->durationUs / 1e6 : 0, errors ? "FAILED" : "OK");
+    return errors;
+}
+
+
+static int TestVbriAndResync()
+{
+    TestFile file, mpeg2;
+    int errors = 0;
+
+    TestBuildVbri(file, 5000, 50);
+    MP3Parser parser;
+    TestResult result = TestResult();
+    TestParse(parser, result, &file.data[0], file.data.size(), 3000);
+    const MP3Info* info = parser.getInfo();
+    if (info == NULL || info->vbrHeader != MP3VbrHeader_VBRI || info->frames != 5000 || info->encoderDelay != 0x40
+            || !TestFramesMatch(result, file, 5000, 44100, 1152)) {
+        printf("  vbri info FAILED\n");
+        errors++;
+    }
+    //采样 seek 表覆盖整个文件，重新建一个只读开头的 parser 测试 VBRI 表
+    MP3Parser fresh;
+    TestResult freshResult = TestResult();
+    TestParse(fresh, freshResult, &file.data[0], 8192, 0);
+    for (int k = 0; k < 100; k++) {
+        int64_t timeUs = (int64_t)(TestRandom() % 130000) * 1000, offset, frameTimeUs;
+        int64_t frame = std::min<int64_t>(timeUs * 44100 / (1152 * 1000000LL), 4999);
+        if (fresh.seekTo(timeUs, &offset, &frameTimeUs) != 0 || llabs(offset - file.offsets[frame]) > 2 * MP3_FRAME_SIZE_MAX) {
+            printf("  vbri seek %lld: offset %lld, frame at %lld FAILED\n", (long long)timeUs, (long long)offset,
+                    (long long)file.offsets[frame]);
+            errors++;
+            break;
+        }
+    }
+
+    //MPEG2 Layer III 22050Hz 单声道，中间插入带 0xFF 的垃圾数据
+    std::vector<int64_t> expected;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 500 == 250) {
+            for (int k = 0; k < 300; k++)
+                mpeg2.data.push_back((k % 3) ? 0xFF : 0xE2);
+        }
+        expected.push_back(mpeg2.data.size());
+        TestAppendFrame(mpeg2.data, false, 1 + TestRandom() % 14, 0, false, true);
+    }
+    MP3Parser resync;
+    TestResult resyncResult = TestResult();
+    TestParse(resync, resyncResult, &mpeg2.data[0], mpeg2.data.size(), 700);
+    if (resyncResult.offsets != expected || resync.getInfo() == NULL || resync.getInfo()->samplesPerFrame != 576
+            || resync.getInfo()->sampleRate != 22050 || resync.getInfo()->channels != 1
+            || resyncResult.pts.back() != 2999LL * 576 * 1000000 / 22050) {
+        printf("  resync: %d frames of %d FAILED\n", (int)resyncResult.offsets.size(), (int)expected.size());
+        errors++;
+    }
+    printf("vbri / mpeg2 resync: %s\n", errors ? "FAILED" : "OK");
+    return errors;
+}
+
+
+static int TestRealFile(const char* path)
+{
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t count;
+    FILE* fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("open %s error.\n", path);
+        return 1;
+    }
+    while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    fclose(fp);
+
+    MP3Parser parser;
+    TestResult result = TestResult();
+    int tail = std::min<int>(MP3_TAIL_SIZE, data.size());
+    parser.parseTail(&data[data.size() - tail], tail, data.size());
+    TestParse(parser, result, &data[0], data.size(), 65536);
+    const MP3Info* info = parser.getInfo();
+    if (info == NULL) {
+        printf("%s: no mpeg audio frame.\n", path);
+        return 1;
+    }
+    printf("%s: MPEG%s layer %d, %d Hz, %d ch, %d bps%s, vbr header %d, %lld frames (parsed %d), %.3f s, delay %d padding %d\n",
+            path, info->version == MP3Version_1 ? "1" : (info->version == MP3Version_2 ? "2" : "2.5"), info->layer,
+            info->sampleRate, info->channels, info->bitrate, info->isVBR ? " VBR" : "", info->vbrHeader,
+            (long long)info->frames, (int)result.offsets.size(), info->durationUs / 1e6, info->encoderDelay, info->encoderPadding);
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int errors = 0;
+
+    if (argc > 1)
+        return TestRealFile(argv[1]);
+
+    errors += TestVbr();
+    errors += TestCbr();
+    errors += TestVbriAndResync();
+    return errors ? 1 : 0;
+}
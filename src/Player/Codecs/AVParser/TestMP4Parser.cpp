@@ -0,0 +1,696 @@
+/**
+ *  TestMP4Parser.cpp文件
+ *  MP4Parser 的正确性测试和性能测试：
+ *          生成 3 小时的 MP4(moov 在文件末尾/开头)和 30 分钟的 fragmented MP4，
+ *          只有 box 放在内存中，mdat 的内容按位置计算，模拟 HTTP Range 请求的数据来源
+ *          顺序读取的 sample 与写入的一致，seek 后第一个视频 sample 为 timeUs 之前最近的关键帧
+ *          统计 open() 的耗时、读取的字节数和请求数，以及 sample table 占用的内存
+ *
+ *  用法：TestMP4Parser.elf [file.mp4]
+ *          指定文件时再对该文件做一次 open 和顺序读取的测试
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "MP4Parser.h"
+
+
+#define     TEST_VIDEO_TIMESCALE        90000
+#define     TEST_AUDIO_TIMESCALE        48000
+#define     TEST_AUDIO_DELTA            1024
+#define     TEST_VIDEO_EDIT             7200        //elst media_time，抵消 B 帧的 CTS
+#define     TEST_GOP                    50
+#define     TEST_VIDEO_CHUNK            5
+#define     TEST_AUDIO_CHUNK            10
+#define     TEST_FRAGMENT_SECONDS       2
+
+
+/* 虚拟文件：box 在内存中，其余位置的内容由位置计算 */
+typedef struct {
+    int64_t                 offset;
+    std::vector<uint8_t>    data;
+} TestRegion;
+
+typedef struct {
+    std::vector<TestRegion>     regions;        //按 offset 排序
+    int64_t                     size;
+    int                         requests;
+} TestFile;
+
+static inline uint8_t TestPattern(int64_t offset)
+{
+    return (uint8_t)((offset * 7) ^ (offset >> 13));
+}
+
+static int TestFileRead(void* opaque, int64_t offset, uint8_t* buffer, int size)
+{
+    TestFile* file = (TestFile*)opaque;
+    size_t i;
+
+    file->requests++;
+    if (offset + size > file->size)
+        size = file->size - offset;
+    for (int j = 0; j < size; j++)
+        buffer[j] = TestPattern(offset + j);
+    for (i = 0; i < file->regions.size(); i++) {
+        const TestRegion& region = file->regions[i];
+        int64_t begin = std::max(offset, region.offset);
+        int64_t end = std::min(offset + size, region.offset + (int64_t)region.data.size());
+        if (begin < end)
+            memcpy(buffer + (begin - offset), &region.data[begin - region.offset], end - begin);
+    }
+    return size;
+}
+
+
+/* box 构造 */
+class TestWriter {
+    public:
+        std::vector<uint8_t> data;
+
+        void u8(uint32_t v) { data.push_back(v); }
+        void u16(uint32_t v) { u8(v >> 8); u8(v); }
+        void u32(uint32_t v) { u16(v >> 16); u16(v); }
+        void u64(uint64_t v) { u32(v >> 32); u32(v); }
+        void zero(int n) { data.insert(data.end(), n, 0); }
+        void fourcc(const char* s) { data.insert(data.end(), s, s + 4); }
+        size_t begin(const char* type) { size_t pos = data.size(); u32(0); fourcc(type); return pos; }
+        size_t full(const char* type, int version, uint32_t flags) { size_t pos = begin(type); u32((version << 24) | flags); return pos; }
+        void end(size_t pos)
+        {
+            uint32_t size = data.size() - pos;
+            data[pos] = size >> 24; data[pos + 1] = size >> 16; data[pos + 2] = size >> 8; data[pos + 3] = size;
+        }
+        void patch32(size_t pos, uint32_t v) { data[pos] = v >> 24; data[pos + 1] = v >> 16; data[pos + 2] = v >> 8; data[pos + 3] = v; }
+};
+
+
+/* 期望的 sample */
+typedef struct {
+    int64_t     offset;
+    int         size;
+    int64_t     dts;        //减去 edit 之后
+    int64_t     pts;
+    int         isKeyframe;
+} TestSample;
+
+typedef struct {
+    std::vector<TestSample>     video;
+    std::vector<TestSample>     audio;
+} TestExpected;
+
+static uint32_t TestVideoSize(uint32_t i) { return (i % TEST_GOP == 0) ? 60000 + i % 977 : 3000 + (i * 7919) % 20000; }
+static uint32_t TestVideoDelta(uint32_t i) { return ((i / 7) % 2) ? 3600 : 3602; }      //VFR，stts 每 7 个 sample 一个 run
+static int32_t TestVideoCts(uint32_t i) { static const int32_t pattern[4] = { 7200, 14400, 0, 3600 }; return pattern[i % 4]; }
+static uint32_t TestAudioSize(uint32_t i) { return 200 + (i * 31) % 300; }
+
+
+static void TestWriteTrackHeader(TestWriter& w, int trackId, bool video, uint32_t timescale, uint64_t duration, bool edit)
+{
+    size_t box;
+
+    box = w.full("tkhd", 0, 3);
+    w.u32(0); w.u32(0); w.u32(trackId); w.u32(0); w.u32(duration * 1000 / timescale);
+    w.zero(8); w.u16(0); w.u16(0); w.u16(video ? 0 : 0x0100); w.u16(0);
+    w.u32(0x00010000); w.zero(12); w.u32(0x00010000); w.zero(12); w.u32(0x40000000);
+    w.u32(video ? 1280 << 16 : 0); w.u32(video ? 720 << 16 : 0);
+    w.end(box);
+    if (edit) {
+        size_t edts = w.begin("edts");
+        box = w.full("elst", 0, 0);
+        w.u32(1); w.u32(duration * 1000 / timescale); w.u32(TEST_VIDEO_EDIT); w.u32(0x00010000);
+        w.end(box);
+        w.end(edts);
+    }
+}
+
+static void TestWriteMediaHeader(TestWriter& w, bool video, uint32_t timescale, uint64_t duration)
+{
+    size_t box = w.full("mdhd", 0, 0);
+    w.u32(0); w.u32(0); w.u32(timescale); w.u32(duration);
+    w.u16(((('e' - 0x60) << 10) | (('n' - 0x60) << 5) | ('g' - 0x60))); w.u16(0);
+    w.end(box);
+    box = w.full("hdlr", 0, 0);
+    w.u32(0); w.fourcc(video ? "vide" : "soun"); w.zero(12); w.u8(0);
+    w.end(box);
+}
+
+static void TestWriteSampleDescription(TestWriter& w, bool video)
+{
+    size_t stsd = w.full("stsd", 0, 0), entry, box;
+    w.u32(1);
+    if (video) {
+        entry = w.begin("avc1");
+        w.zero(6); w.u16(1);
+        w.zero(16); w.u16(1280); w.u16(720); w.u32(0x00480000); w.u32(0x00480000); w.u32(0); w.u16(1);
+        w.zero(32); w.u16(24); w.u16(0xFFFF);
+        box = w.begin("avcC");
+        w.u8(1); w.u8(0x64); w.u8(0); w.u8(0x1F); w.u8(0xFF); w.u8(0xE1); w.u16(4); w.u32(0x6764001F); w.u8(1); w.u16(4); w.u32(0x68EE3CB0);
+        w.end(box);
+        w.end(entry);
+    } else {
+        entry = w.begin("mp4a");
+        w.zero(6); w.u16(1);
+        w.zero(8); w.u16(2); w.u16(16); w.u16(0); w.u16(0); w.u32(TEST_AUDIO_TIMESCALE << 16);
+        box = w.full("esds", 0, 0);
+        w.u8(3); w.u8(25); w.u16(2); w.u8(0);
+        w.u8(4); w.u8(17); w.u8(0x40); w.u8(0x15); w.zero(3); w.u32(128000); w.u32(128000);
+        w.u8(5); w.u8(2); w.u8(0x11); w.u8(0x90);
+        w.u8(6); w.u8(1); w.u8(2);
+        w.end(box);
+        w.end(entry);
+    }
+    w.end(stsd);
+}
+
+
+/* 把相邻的相同值压缩为 (count, value) run */
+static void TestWriteRuns(TestWriter& w, const char* type, const std::vector<uint32_t>& values)
+{
+    size_t box = w.full(type, 0, 0), countPos;
+    uint32_t runs = 0;
+    size_t i = 0;
+
+    countPos = w.data.size();
+    w.u32(0);
+    while (i < values.size()) {
+        size_t j = i;
+        while (j < values.size() && values[j] == values[i])
+            j++;
+        w.u32(j - i);
+        w.u32(values[i]);
+        runs++;
+        i = j;
+    }
+    w.patch32(countPos, runs);
+    w.end(box);
+}
+
+
+/* 3 小时的普通 MP4：视频 25fps VFR + B 帧，音频 AAC；moovFirst 时 moov 在 mdat 之前 */
+static void TestBuildProgressive(TestFile& file, TestExpected& expected, double hours, bool moovFirst)
+{
+    uint32_t videoCount = (uint32_t)(hours * 3600 * 25);
+    uint32_t audioCount = (uint32_t)(hours * 3600 * TEST_AUDIO_TIMESCALE / TEST_AUDIO_DELTA);
+    std::vector<int64_t> videoChunks, audioChunks;
+    std::vector<int64_t> videoDts(videoCount + 1);
+    int64_t mdatStart, offset, moovSize = 0;
+    uint32_t v = 0, a = 0, i;
+    TestWriter head, moov;
+
+    videoDts[0] = 0;
+    for (i = 0; i < videoCount; i++)
+        videoDts[i + 1] = videoDts[i] + TestVideoDelta(i);
+
+    size_t box = head.begin("ftyp");
+    head.fourcc("isom"); head.u32(512); head.fourcc("isom"); head.fourcc("avc1");
+    head.end(box);
+
+    for (int pass = 0; pass < 2; pass++) {
+        //按 chunk 第一个 sample 的时间交织
+        mdatStart = head.data.size() + (moovFirst ? moovSize : 0) + 16;
+        offset = mdatStart;
+        videoChunks.clear();
+        audioChunks.clear();
+        expected.video.clear();
+        expected.audio.clear();
+        v = a = 0;
+        while (v < videoCount || a < audioCount) {
+            bool video = a >= audioCount || (v < videoCount
+                    && videoDts[v] * TEST_AUDIO_TIMESCALE <= (int64_t)a * TEST_AUDIO_DELTA * TEST_VIDEO_TIMESCALE);
+            if (video) {
+                videoChunks.push_back(offset);
+                for (i = 0; i < TEST_VIDEO_CHUNK && v < videoCount; i++, v++) {
+                    TestSample s = { offset, (int)TestVideoSize(v), videoDts[v] - TEST_VIDEO_EDIT,
+                            videoDts[v] - TEST_VIDEO_EDIT + TestVideoCts(v), v % TEST_GOP == 0 };
+                    expected.video.push_back(s);
+                    offset += s.size;
+                }
+            } else {
+                audioChunks.push_back(offset);
+                for (i = 0; i < TEST_AUDIO_CHUNK && a < audioCount; i++, a++) {
+                    TestSample s = { offset, (int)TestAudioSize(a), (int64_t)a * TEST_AUDIO_DELTA, (int64_t)a * TEST_AUDIO_DELTA, 1 };
+                    expected.audio.push_back(s);
+                    offset += s.size;
+                }
+            }
+        }
+
+        moov.data.clear();
+        size_t moovBox = moov.begin("moov");
+        box = moov.full("mvhd", 0, 0);
+        moov.u32(0); moov.u32(0); moov.u32(1000); moov.u32(videoDts[videoCount] / 90);
+        moov.u32(0x00010000); moov.u16(0x0100); moov.zero(10);
+        moov.u32(0x00010000); moov.zero(12); moov.u32(0x00010000); moov.zero(12); moov.u32(0x40000000);
+        moov.zero(24); moov.u32(3);
+        moov.end(box);
+        for (int t = 0; t < 2; t++) {
+            bool video = (t == 0);
+            uint32_t count = video ? videoCount : audioCount;
+            uint32_t timescale = video ? TEST_VIDEO_TIMESCALE : TEST_AUDIO_TIMESCALE;
+            uint64_t duration = video ? videoDts[videoCount] : (uint64_t)audioCount * TEST_AUDIO_DELTA;
+            const std::vector<int64_t>& chunks = video ? videoChunks : audioChunks;
+            uint32_t perChunk = video ? TEST_VIDEO_CHUNK : TEST_AUDIO_CHUNK;
+            std::vector<uint32_t> values;
+
+            size_t trak = moov.begin("trak");
+            TestWriteTrackHeader(moov, t + 1, video, timescale, duration, video);
+            size_t mdia = moov.begin("mdia");
+            TestWriteMediaHeader(moov, video, timescale, duration);
+            size_t minf = moov.begin("minf");
+            size_t stbl = moov.begin("stbl");
+            TestWriteSampleDescription(moov, video);
+
+            for (i = 0; i < count; i++)
+                values.push_back(video ? TestVideoDelta(i) : TEST_AUDIO_DELTA);
+            TestWriteRuns(moov, "stts", values);
+            if (video) {
+                values.clear();
+                for (i = 0; i < count; i++)
+                    values.push_back(TestVideoCts(i));
+                TestWriteRuns(moov, "ctts", values);
+            }
+
+            box = moov.full("stsc", 0, 0);
+            if (count % perChunk) {
+                moov.u32(2); moov.u32(1); moov.u32(perChunk); moov.u32(1);
+                moov.u32(chunks.size()); moov.u32(count % perChunk); moov.u32(1);
+            } else {
+                moov.u32(1); moov.u32(1); moov.u32(perChunk); moov.u32(1);
+            }
+            moov.end(box);
+
+            box = moov.full("stsz", 0, 0);
+            moov.u32(0); moov.u32(count);
+            for (i = 0; i < count; i++)
+                moov.u32(video ? TestVideoSize(i) : TestAudioSize(i));
+            moov.end(box);
+
+            box = moov.full("co64", 0, 0);
+            moov.u32(chunks.size());
+            for (i = 0; i < chunks.size(); i++)
+                moov.u64(chunks[i]);
+            moov.end(box);
+
+            if (video) {
+                box = moov.full("stss", 0, 0);
+                moov.u32((count + TEST_GOP - 1) / TEST_GOP);
+                for (i = 0; i < count; i += TEST_GOP)
+                    moov.u32(i + 1);
+                moov.end(box);
+            }
+            moov.end(stbl);
+            moov.end(minf);
+            moov.end(mdia);
+            moov.end(trak);
+        }
+        moov.end(moovBox);
+        moovSize = moov.data.size();    //两遍的大小相同，第二遍得到 moov 在前时的 chunk offset
+    }
+
+    TestWriter mdat;
+    mdat.u32(1); mdat.fourcc("mdat"); mdat.u64(offset - mdatStart + 16);
+    file.regions.clear();
+    file.regions.push_back(TestRegion());
+    file.regions.back().offset = 0;
+    file.regions.back().data = head.data;
+    if (moovFirst) {
+        file.regions.push_back(TestRegion());
+        file.regions.back().offset = head.data.size();
+        file.regions.back().data = moov.data;
+    }
+    file.regions.push_back(TestRegion());
+    file.regions.back().offset = mdatStart - 16;
+    file.regions.back().data = mdat.data;
+    if (!moovFirst) {
+        file.regions.push_back(TestRegion());
+        file.regions.back().offset = offset;
+        file.regions.back().data = moov.data;
+    }
+    file.size = offset + (moovFirst ? 0 : moovSize);
+    file.requests = 0;
+}
+
+
+/* fragmented MP4：moov 中只有 mvex/trex，每 TEST_FRAGMENT_SECONDS 秒一个 moof + mdat */
+static void TestBuildFragmented(TestFile& file, TestExpected& expected, double hours)
+{
+    uint32_t videoCount = (uint32_t)(hours * 3600 * 25);
+    uint32_t audioCount = (uint32_t)(hours * 3600 * TEST_AUDIO_TIMESCALE / TEST_AUDIO_DELTA);
+    uint32_t v = 0, a = 0, i, sequence = 1;
+    TestWriter head;
+    int64_t offset;
+    size_t box;
+
+    box = head.begin("ftyp");
+    head.fourcc("iso6"); head.u32(0); head.fourcc("iso6"); head.fourcc("dash");
+    head.end(box);
+    size_t moov = head.begin("moov");
+    box = head.full("mvhd", 0, 0);
+    head.u32(0); head.u32(0); head.u32(1000); head.u32(0);
+    head.u32(0x00010000); head.u16(0x0100); head.zero(10);
+    head.u32(0x00010000); head.zero(12); head.u32(0x00010000); head.zero(12); head.u32(0x40000000);
+    head.zero(24); head.u32(3);
+    head.end(box);
+    for (int t = 0; t < 2; t++) {
+        bool video = (t == 0);
+        uint32_t timescale = video ? TEST_VIDEO_TIMESCALE : TEST_AUDIO_TIMESCALE;
+        size_t trak = head.begin("trak");
+        TestWriteTrackHeader(head, t + 1, video, timescale, 0, video);
+        size_t mdia = head.begin("mdia");
+        TestWriteMediaHeader(head, video, timescale, 0);
+        size_t minf = head.begin("minf");
+        size_t stbl = head.begin("stbl");
+        TestWriteSampleDescription(head, video);
+        const char* empty[4] = { "stts", "stsc", "stco", NULL };
+        for (int k = 0; empty[k]; k++) {
+            box = head.full(empty[k], 0, 0);
+            head.u32(0);
+            head.end(box);
+        }
+        box = head.full("stsz", 0, 0);
+        head.u32(0); head.u32(0);
+        head.end(box);
+        head.end(stbl);
+        head.end(minf);
+        head.end(mdia);
+        head.end(trak);
+    }
+    size_t mvex = head.begin("mvex");
+    box = head.full("mehd", 0, 0);
+    head.u32((uint64_t)videoCount * 3600 / 90);
+    head.end(box);
+    for (int t = 0; t < 2; t++) {
+        box = head.full("trex", 0, 0);
+        head.u32(t + 1); head.u32(1); head.u32(t == 0 ? 3600 : TEST_AUDIO_DELTA); head.u32(0); head.u32(t == 0 ? 0x01010000 : 0);
+        head.end(box);
+    }
+    head.end(mvex);
+    head.end(moov);
+
+    file.regions.clear();
+    file.regions.push_back(TestRegion());
+    file.regions.back().offset = 0;
+    file.regions.back().data = head.data;
+    offset = head.data.size();
+    expected.video.clear();
+    expected.audio.clear();
+
+    while (v < videoCount || a < audioCount) {
+        uint32_t videoEnd = std::min(videoCount, v + 25 * TEST_FRAGMENT_SECONDS);
+        uint32_t audioEnd = a;
+        while (audioEnd < audioCount && (int64_t)audioEnd * TEST_AUDIO_DELTA * 25 < (int64_t)videoEnd * TEST_AUDIO_TIMESCALE)
+            audioEnd++;
+        if (videoEnd == v)
+            audioEnd = audioCount;
+
+        TestWriter moof;
+        size_t videoOffset = 0, audioOffset = 0;
+        size_t moofBox = moof.begin("moof");
+        box = moof.full("mfhd", 0, 0);
+        moof.u32(sequence++);
+        moof.end(box);
+        if (videoEnd > v) {
+            size_t traf = moof.begin("traf");
+            box = moof.full("tfhd", 0, 0x020000);
+            moof.u32(1);
+            moof.end(box);
+            box = moof.full("tfdt", 1, 0);
+            moof.u64((uint64_t)v * 3600);
+            moof.end(box);
+            box = moof.full("trun", 0, 0x001 | 0x200 | 0x400 | 0x800);
+            moof.u32(videoEnd - v);
+            videoOffset = moof.data.size();
+            moof.u32(0);
+            for (i = v; i < videoEnd; i++) {
+                moof.u32(TestVideoSize(i));
+                moof.u32(i % TEST_GOP == 0 ? 0x02000000 : 0x01010000);
+                moof.u32(TestVideoCts(i));
+            }
+            moof.end(box);
+            moof.end(traf);
+        }
+        if (audioEnd > a) {
+            size_t traf = moof.begin("traf");
+            box = moof.full("tfhd", 0, 0x020000 | 0x08);
+            moof.u32(2); moof.u32(TEST_AUDIO_DELTA);
+            moof.end(box);
+            box = moof.full("tfdt", 1, 0);
+            moof.u64((uint64_t)a * TEST_AUDIO_DELTA);
+            moof.end(box);
+            box = moof.full("trun", 0, 0x001 | 0x200);
+            moof.u32(audioEnd - a);
+            audioOffset = moof.data.size();
+            moof.u32(0);
+            for (i = a; i < audioEnd; i++)
+                moof.u32(TestAudioSize(i));
+            moof.end(box);
+            moof.end(traf);
+        }
+        moof.end(moofBox);
+
+        //mdat：先视频后音频
+        int64_t data = offset + moof.data.size() + 8;
+        int64_t dataStart = data;
+        if (videoOffset)
+            moof.patch32(videoOffset, data - offset);
+        for (i = v; i < videoEnd; i++) {
+            TestSample s = { data, (int)TestVideoSize(i), (int64_t)i * 3600 - TEST_VIDEO_EDIT,
+                    (int64_t)i * 3600 - TEST_VIDEO_EDIT + TestVideoCts(i), i % TEST_GOP == 0 };
+            expected.video.push_back(s);
+            data += s.size;
+        }
+        if (audioOffset)
+            moof.patch32(audioOffset, data - offset);
+        for (i = a; i < audioEnd; i++) {
+            TestSample s = { data, (int)TestAudioSize(i), (int64_t)i * TEST_AUDIO_DELTA, (int64_t)i * TEST_AUDIO_DELTA, 1 };
+            expected.audio.push_back(s);
+            data += s.size;
+        }
+        moof.u32(data - dataStart + 8);
+        moof.fourcc("mdat");
+
+        file.regions.push_back(TestRegion());
+        file.regions.back().offset = offset;
+        file.regions.back().data = moof.data;
+        offset = data;
+        v = videoEnd;
+        a = audioEnd;
+    }
+    file.size = offset;
+    file.requests = 0;
+}
+
+
+static double TestNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool TestSampleEqual(const MP4Sample& sample, const TestSample& expected)
+{
+    return sample.offset == expected.offset && sample.size == expected.size && sample.dts == expected.dts
+            && sample.pts == expected.pts && sample.isKeyframe == expected.isKeyframe;
+}
+
+
+/* 顺序读取全部 sample，再随机 seek */
+static int TestVerify(const char* name, TestFile& file, const TestExpected& expected)
+{
+    MP4ByteSource source = { TestFileRead, file.size, &file };
+    MP4Parser parser;
+    MP4Sample sample;
+    size_t counts[2] = { 0, 0 };
+    size_t sampleCount = expected.video.size() + expected.audio.size();
+    int64_t lastDtsUs = -1000000000;
+    int errors = 0;
+    double start;
+    int ret;
+
+    start = TestNow();
+    if (parser.open(source) < 0) {
+        printf("%s: open FAILED\n", name);
+        return 1;
+    }
+    printf("%s: file %.2f GB, %d samples, duration %.1f s\n", name, file.size / 1e9, (int)sampleCount, parser.getDurationUs() / 1e6);
+    printf("  open: %.3f ms, %d requests, %lld bytes, table memory %d KB (expanded tables: %d KB)\n",
+            (TestNow() - start) * 1000, parser.getStatistics().openReads, (long long)parser.getStatistics().openBytes,
+            parser.getStatistics().tableMemory / 1024, (int)(sampleCount * sizeof(MP4Sample) / 1024));
+
+    const MP4TrackInfo* video = parser.getTrack(0);
+    const MP4TrackInfo* audio = parser.getTrack(1);
+    if (parser.getTrackCount() != 2 || video->type != MP4Track_Video || audio->type != MP4Track_Audio
+            || video->width != 1280 || video->height != 720 || video->codec != MP4_FOURCC('a', 'v', 'c', '1')
+            || audio->sampleRate != TEST_AUDIO_TIMESCALE || audio->channels != 2 || audio->codecConfigSize != 2
+            || video->codecConfigSize != 19 || strcmp(audio->language, "eng") != 0) {
+        printf("  track info FAILED\n");
+        errors++;
+    }
+
+    start = TestNow();
+    while ((ret = parser.readSample(&sample)) == 0) {
+        const std::vector<TestSample>& samples = (sample.track == 0) ? expected.video : expected.audio;
+        size_t& index = counts[sample.track];
+        if (index >= samples.size() || !TestSampleEqual(sample, samples[index]) || sample.dtsUs < lastDtsUs) {
+            if (errors++ < 5)
+                printf("  track %d sample %d: offset %lld size %d dts %lld pts %lld key %d FAILED\n", sample.track, (int)index,
+                        (long long)sample.offset, sample.size, (long long)sample.dts, (long long)sample.pts, sample.isKeyframe);
+        }
+        if (index < 1000) {
+            uint8_t data[16];
+            if (parser.readSampleData(&sample, data, sizeof(data)) <= 0 || data[0] != TestPattern(sample.offset))
+                errors++;
+        }
+        lastDtsUs = sample.dtsUs;
+        index++;
+    }
+    if (ret < 0 || counts[0] != expected.video.size() || counts[1] != expected.audio.size()) {
+        printf("  read %d/%d video, %d/%d audio FAILED\n", (int)counts[0], (int)expected.video.size(),
+                (int)counts[1], (int)expected.audio.size());
+        errors++;
+    }
+    printf("  sequential: %.1f M samples/s, table memory %d KB\n",
+            sampleCount / (TestNow() - start) / 1e6, parser.getStatistics().tableMemory / 1024);
+
+    //seek：第一次会建立检查点
+    int64_t durationUs = expected.video.back().dts * 1000000 / TEST_VIDEO_TIMESCALE;
+    double firstSeek = 0, seekTotal = 0;
+    int seeks = 200;
+    srand(1);
+    for (int k = 0; k < seeks; k++) {
+        int64_t timeUs = (k == 0) ? durationUs / 2 : (int64_t)((double)rand() / RAND_MAX * durationUs);
+        bool gotVideo = false, gotAudio = false;
+        int64_t keyUs = 0;
+
+        start = TestNow();
+        if (parser.seek(timeUs) < 0) {
+            printf("  seek %lld FAILED\n", (long long)timeUs);
+            errors++;
+            continue;
+        }
+        if (k == 0)
+            firstSeek = TestNow() - start;
+        else
+            seekTotal += TestNow() - start;
+
+        //期望的关键帧：dts 不大于 timeUs 的最后一个
+        size_t expectedKey = 0;
+        for (size_t i = 0; i < expected.video.size(); i += TEST_GOP) {
+            if (expected.video[i].dts * 1000000 / TEST_VIDEO_TIMESCALE > timeUs)
+                break;
+            expectedKey = i;
+        }
+        while ((!gotVideo || !gotAudio) && parser.readSample(&sample) == 0) {
+            if (sample.track == 0 && !gotVideo) {
+                gotVideo = true;
+                keyUs = sample.dtsUs;
+                if (!TestSampleEqual(sample, expected.video[expectedKey])) {
+                    if (errors++ < 5)
+                        printf("  seek %lld: video dts %lld key %d, expected sample %d FAILED\n", (long long)timeUs,
+                                (long long)sample.dts, sample.isKeyframe, (int)expectedKey);
+                }
+            } else if (sample.track == 1 && !gotAudio) {
+                gotAudio = true;
+                if (gotVideo && (sample.dtsUs > keyUs + 1 || sample.dtsUs + TEST_AUDIO_DELTA * 1000000LL / TEST_AUDIO_TIMESCALE < keyUs - 1)) {
+                    if (errors++ < 5)
+                        printf("  seek %lld: audio %lld not aligned to video %lld FAILED\n", (long long)timeUs,
+                                (long long)sample.dtsUs, (long long)keyUs);
+                }
+            }
+        }
+    }
+    printf("  seek: first %.3f ms, then %.1f us average, table memory %d KB\n", firstSeek * 1000,
+            seekTotal / (seeks - 1) * 1e6, parser.getStatistics().tableMemory / 1024);
+
+    //新打开后直接 seek：fragmented MP4 需要向后扫描 moof 建立索引
+    MP4Parser fresh;
+    int64_t timeUs = durationUs * 3 / 4;
+    size_t expectedKey = 0;
+    for (size_t i = 0; i < expected.video.size() && expected.video[i].dts * 1000000 / TEST_VIDEO_TIMESCALE <= timeUs; i += TEST_GOP)
+        expectedKey = i;
+    file.requests = 0;
+    start = TestNow();
+    if (fresh.open(source) < 0 || fresh.seek(timeUs) < 0) {
+        printf("  seek after open FAILED\n");
+        errors++;
+    } else {
+        printf("  seek after open: %.3f ms, %d requests\n", (TestNow() - start) * 1000, file.requests);
+        while (fresh.readSample(&sample) == 0 && sample.track != 0)
+            ;
+        if (sample.track != 0 || !TestSampleEqual(sample, expected.video[expectedKey])) {
+            printf("  seek after open: video dts %lld FAILED\n", (long long)sample.dts);
+            errors++;
+        }
+    }
+    printf("  %s\n", errors ? "FAILED" : "OK");
+    return errors;
+}
+
+
+static int TestRealFile(const char* path)
+{
+    MP4ByteSource source;
+    MP4Parser parser;
+    MP4Sample sample;
+    int64_t samples = 0, bytes = 0;
+    double start;
+
+    if (MP4ByteSourceOpenFile(&source, path) < 0) {
+        printf("open %s error.\n", path);
+        return 1;
+    }
+    start = TestNow();
+    if (parser.open(source) < 0) {
+        printf("%s: open FAILED\n", path);
+        MP4ByteSourceCloseFile(&source);
+        return 1;
+    }
+    printf("%s: open %.3f ms, %d requests, %lld bytes, duration %.1f s\n", path, (TestNow() - start) * 1000,
+            parser.getStatistics().openReads, (long long)parser.getStatistics().openBytes, parser.getDurationUs() / 1e6);
+    for (int i = 0; i < parser.getTrackCount(); i++) {
+        const MP4TrackInfo* track = parser.getTrack(i);
+        printf("  track %d: type %d codec %.4s timescale %u samples %u %dx%d %dch %dHz config %d\n", track->trackId,
+                track->type, (char*)&track->codec, track->timescale, track->sampleCount, track->width, track->height,
+                track->channels, track->sampleRate, track->codecConfigSize);
+    }
+    start = TestNow();
+    while (parser.readSample(&sample) == 0) {
+        samples++;
+        bytes += sample.size;
+    }
+    printf("  %lld samples, %lld bytes, %.3f ms, table memory %d KB\n", (long long)samples, (long long)bytes,
+            (TestNow() - start) * 1000, parser.getStatistics().tableMemory / 1024);
+    MP4ByteSourceCloseFile(&source);
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestExpected expected;
+    TestFile file;
+    int errors = 0;
+
+    TestBuildProgressive(file, expected, 3.0, false);
+    errors += TestVerify("3h mp4, moov at end", file, expected);
+
+    TestBuildProgressive(file, expected, 3.0, true);
+    errors += TestVerify("3h mp4, moov at start", file, expected);
+
+    TestBuildFragmented(file, expected, 0.5);
+    errors += TestVerify("30min fragmented mp4", file, expected);
+
+    if (argc > 1)
+        errors += TestRealFile(argv[1]);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,492 @@
+/**
+ *  TestRTPJitterBuffer.cpp文件
+ *  RTP 抖动缓冲和接收的测试：
+ *          按模拟的到达时间放入 RTPJitterBuffer：随机抖动、丢包/重复/乱序、序号和时间戳回绕、抖动变化时延时的调整、SSRC 变化
+ *          生成 pcap 抓包(随机抖动、丢包、乱序)，按抓包时间回放到本机端口，由 RTPReceiver 接收并检查顺序
+ *
+ *  用法：TestRTPJitterBuffer.elf [capture.pcap [udp-port]]
+ *          指定 pcap 时只回放该文件(udp-port 过滤目的端口)到本机并输出接收统计
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "RTPJitterBuffer.h"
+#include "RTPReceiver.h"
+
+
+#define     TEST_PAYLOAD_SIZE           (7 * 188)
+#define     TEST_PACKET_US              2000
+#define     TEST_SSRC                   0x12345678
+#define     TEST_PCAP_PATH              "/tmp/TestRTPJitterBuffer.pcap"
+#define     TEST_PCAP_LINK_ETHERNET     1
+#define     TEST_PCAP_LINK_RAW          101
+#define     TEST_PCAP_LINK_SLL          113
+
+
+typedef std::vector<uint8_t> TestBuffer;
+
+typedef struct {
+    int64_t         arrivalUs;
+    TestBuffer      data;
+} TestArrival;
+
+typedef struct {
+    std::vector<uint32_t>   delivered;      //负载中的序号
+    std::vector<int64_t>    lostSequences;
+    bool                    ordered;
+    RTPJitterStatistics     statistics;
+    int64_t                 maxDelayUs;
+} TestResult;
+
+
+static int64_t TestNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t TestReadU32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void TestPutU32(uint8_t* p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/* 负载开头为 packet 的序号，之后为 TS 同步字节填充 */
+static TestBuffer TestBuildRtp(uint16_t sequence, uint32_t timestamp, uint32_t ssrc, uint32_t index)
+{
+    TestBuffer packet(RTP_HEADER_SIZE + TEST_PAYLOAD_SIZE, 0x47);
+
+    packet[0] = 0x80;
+    packet[1] = RTP_PAYLOAD_MP2T;
+    packet[2] = sequence >> 8;
+    packet[3] = sequence;
+    TestPutU32(&packet[4], timestamp);
+    TestPutU32(&packet[8], ssrc);
+    TestPutU32(&packet[RTP_HEADER_SIZE], index);
+    return packet;
+}
+
+/* 每 TEST_PACKET_US 发送一个 packet，到达时间加上 [0, jitterUs) 的随机抖动 */
+static void TestSchedule(std::vector<TestArrival>& arrivals, int count, uint16_t sequence, uint32_t timestamp,
+                         uint32_t ssrc, uint32_t firstIndex, int64_t startUs, int64_t jitterUs)
+{
+    TestArrival arrival;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        arrival.arrivalUs = startUs + (int64_t)i * TEST_PACKET_US + 5000 + (jitterUs > 0 ? rand() % jitterUs : 0);
+        arrival.data = TestBuildRtp(sequence + i, timestamp + i * (TEST_PACKET_US * 90 / 1000), ssrc, firstIndex + i);
+        arrivals.push_back(arrival);
+    }
+}
+
+static bool TestEarlier(const TestArrival& a, const TestArrival& b)
+{
+    return a.arrivalUs < b.arrivalUs;
+}
+
+static void TestOnLoss(int64_t firstSequence, int count, void* userData)
+{
+    TestResult* result = (TestResult*)userData;
+    int i;
+
+    for (i = 0; i < count; i++)
+        result->lostSequences.push_back(firstSequence + i);
+}
+
+/* 按 1ms 的步长推进时间，到达的放入缓冲，到期的取出 */
+static void TestSimulate(std::vector<TestArrival> arrivals, TestResult* result, const RTPJitterConfig* config)
+{
+    RTPJitterBuffer jitter(config);
+    RTPJitterCallbacks callbacks;
+    RTPPacket* packet;
+    int64_t now, waitUs, end;
+    size_t next = 0;
+    uint32_t index;
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onLoss = TestOnLoss;
+    callbacks.userData = result;
+    jitter.setCallbacks(callbacks);
+    result->delivered.clear();
+    result->lostSequences.clear();
+    result->ordered = true;
+    result->maxDelayUs = 0;
+
+    std::stable_sort(arrivals.begin(), arrivals.end(), TestEarlier);
+    end = arrivals.back().arrivalUs + 2000000;
+    for (now = 0; now < end; now += 1000) {
+        for (; next < arrivals.size() && arrivals[next].arrivalUs <= now; next++)
+            jitter.insert(&arrivals[next].data[0], arrivals[next].data.size(), arrivals[next].arrivalUs);
+        while (jitter.pop(now, &packet, &waitUs) == 0) {
+            index = TestReadU32(packet->payload);
+            if (!result->delivered.empty() && index <= result->delivered.back())
+                result->ordered = false;
+            result->delivered.push_back(index);
+            jitter.release(packet);
+        }
+        result->maxDelayUs = std::max(result->maxDelayUs, jitter.getStatistics().delayUs);
+    }
+    result->statistics = jitter.getStatistics();
+}
+
+static void TestPrint(const char* name, const TestResult& result, bool failed)
+{
+    printf("[%s] delivered %d, lost %lld, late %lld, duplicates %lld, reordered %lld, resyncs %lld, jitter max %lld us, "
+           "delay %lld us (max %lld us): %s\n", name, (int)result.delivered.size(), (long long)result.statistics.lost,
+           (long long)result.statistics.late, (long long)result.statistics.duplicates, (long long)result.statistics.reordered,
+           (long long)result.statistics.resyncs, (long long)result.statistics.maxJitterUs, (long long)result.statistics.delayUs,
+           (long long)result.maxDelayUs, failed ? "FAILED" : "OK");
+}
+
+/* 0~30ms 的随机抖动，延时应增加到能覆盖抖动 */
+static int TestJitter()
+{
+    std::vector<TestArrival> arrivals;
+    TestResult result;
+    bool failed;
+
+    TestSchedule(arrivals, 2000, 100, 0, TEST_SSRC, 0, 0, 30000);
+    TestSimulate(arrivals, &result, NULL);
+    failed = !result.ordered || result.statistics.lost + result.statistics.late > 40
+            || result.delivered.size() + result.statistics.lost < 2000 - 40 || result.statistics.delayUs < 30000;
+    TestPrint("jitter", result, failed);
+    return failed ? 1 : 0;
+}
+
+/* 固定延时，每 50 个丢一个，每 37 个重复一个，每 20 个交换相邻两个 */
+static int TestLossReorder()
+{
+    std::vector<TestArrival> arrivals, sent;
+    TestResult result;
+    std::vector<int64_t> dropped;
+    TestArrival duplicate;
+    bool failed;
+    int i, duplicates = 0;
+
+    TestSchedule(arrivals, 1000, 0, 0, TEST_SSRC, 0, 0, 0);
+    for (i = 0; i < 1000; i++) {
+        if (i % 50 == 25) {
+            dropped.push_back(i);
+            continue;
+        }
+        if (i % 20 == 10 && i + 1 < 1000)
+            std::swap(arrivals[i].arrivalUs, arrivals[i + 1].arrivalUs);
+        sent.push_back(arrivals[i]);
+        if (i % 37 == 0) {
+            duplicate = arrivals[i];
+            duplicate.arrivalUs += 3000;
+            sent.push_back(duplicate);
+            duplicates++;
+        }
+    }
+    TestSimulate(sent, &result, NULL);
+    failed = !result.ordered || result.delivered.size() != 1000 - dropped.size() || result.lostSequences != dropped
+            || result.statistics.duplicates != duplicates || result.statistics.reordered == 0 || result.statistics.late != 0;
+    TestPrint("loss", result, failed);
+    return failed ? 1 : 0;
+}
+
+/* 序号和时间戳同时回绕 */
+static int TestWrap()
+{
+    std::vector<TestArrival> arrivals;
+    TestResult result;
+    bool failed;
+
+    TestSchedule(arrivals, 1000, 65000, 0xFFFFFFFF - 180 * 300, TEST_SSRC, 0, 0, 4000);
+    TestSimulate(arrivals, &result, NULL);
+    failed = !result.ordered || result.delivered.size() != 1000 || result.statistics.resyncs != 0 || result.statistics.lost != 0;
+    TestPrint("wrap", result, failed);
+    return failed ? 1 : 0;
+}
+
+/* 抖动先大后小：延时先增加，之后慢慢回落 */
+static int TestAdapt()
+{
+    std::vector<TestArrival> arrivals;
+    TestResult result;
+    bool failed;
+
+    TestSchedule(arrivals, 500, 0, 0, TEST_SSRC, 0, 0, 60000);
+    TestSchedule(arrivals, 2500, 500, 500 * 180, TEST_SSRC, 500, 500 * TEST_PACKET_US, 0);
+    TestSimulate(arrivals, &result, NULL);
+    failed = !result.ordered || result.maxDelayUs < 60000 || result.statistics.delayUs > 30000;
+    TestPrint("adapt", result, failed);
+    return failed ? 1 : 0;
+}
+
+/* 中途换了 SSRC 和序号(例如服务器重启)，缓冲中旧流的 packet 丢弃，重新开始后继续输出 */
+static int TestResync()
+{
+    std::vector<TestArrival> arrivals;
+    TestResult result;
+    bool failed;
+
+    TestSchedule(arrivals, 500, 1000, 5000, TEST_SSRC, 0, 0, 0);
+    TestSchedule(arrivals, 500, 40000, 777, TEST_SSRC + 1, 500, 500 * TEST_PACKET_US, 0);
+    TestSimulate(arrivals, &result, NULL);
+    failed = !result.ordered || result.delivered.size() < 1000 - RTP_JITTER_MIN_DELAY_US / TEST_PACKET_US
+            || result.delivered.back() != 999 || result.statistics.resyncs != 1;
+    TestPrint("resync", result, failed);
+    return failed ? 1 : 0;
+}
+
+
+/* pcap：以太网 + IPv4 + UDP */
+static void TestWritePcap(const char* path, const std::vector<TestArrival>& arrivals, int port)
+{
+    FILE* file = fopen(path, "wb");
+    uint32_t global[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, TEST_PCAP_LINK_ETHERNET };
+    uint8_t headers[14 + 20 + 8];
+    uint32_t record[4];
+    size_t i;
+    int length;
+
+    if (file == NULL)
+        return;
+    fwrite(global, sizeof(global), 1, file);
+    for (i = 0; i < arrivals.size(); i++) {
+        length = arrivals[i].data.size();
+        memset(headers, 0, sizeof(headers));
+        headers[12] = 0x08;                 //IPv4
+        headers[14] = 0x45;
+        headers[16] = (20 + 8 + length) >> 8;
+        headers[17] = (20 + 8 + length);
+        headers[22] = 64;
+        headers[23] = 17;                   //UDP
+        TestPutU32(&headers[26], 0x7F000001);
+        TestPutU32(&headers[30], 0x7F000001);
+        headers[34] = 0x13;
+        headers[35] = 0x88;
+        headers[36] = port >> 8;
+        headers[37] = port;
+        headers[38] = (8 + length) >> 8;
+        headers[39] = (8 + length);
+        record[0] = arrivals[i].arrivalUs / 1000000;
+        record[1] = arrivals[i].arrivalUs % 1000000;
+        record[2] = record[3] = sizeof(headers) + length;
+        fwrite(record, sizeof(record), 1, file);
+        fwrite(headers, sizeof(headers), 1, file);
+        fwrite(&arrivals[i].data[0], length, 1, file);
+    }
+    fclose(file);
+}
+
+/* 读出 pcap 中的 UDP 负载和时间，port 不为 0 时只取该目的端口 */
+static bool TestReadPcap(const char* path, int port, std::vector<TestArrival>& arrivals)
+{
+    FILE* file = fopen(path, "rb");
+    uint8_t global[24], record[16];
+    std::vector<uint8_t> frame;
+    TestArrival arrival;
+    uint32_t magic, link, length;
+    bool swapped, nano;
+    int offset, type, ihl;
+
+    if (file == NULL || fread(global, sizeof(global), 1, file) != 1) {
+        if (file)
+            fclose(file);
+        return false;
+    }
+    magic = TestReadU32(global);
+    swapped = (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1);     //文件按小端写
+    nano = (magic == 0xa1b23c4d || magic == 0x4d3cb2a1);
+    if (!swapped && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) {
+        fclose(file);
+        return false;
+    }
+#define TEST_U32(p) (swapped ? ((uint32_t)(p)[3] << 24 | (p)[2] << 16 | (p)[1] << 8 | (p)[0]) : TestReadU32(p))
+    link = TEST_U32(global + 20);
+    arrivals.clear();
+    while (fread(record, sizeof(record), 1, file) == 1) {
+        length = TEST_U32(record + 8);
+        frame.resize(length);
+        if (length == 0 || fread(&frame[0], length, 1, file) != 1)
+            break;
+        arrival.arrivalUs = (int64_t)TEST_U32(record) * 1000000 + TEST_U32(record + 4) / (nano ? 1000 : 1);
+
+        if (link == TEST_PCAP_LINK_ETHERNET) {
+            offset = 14;
+            type = (frame[12] << 8) | frame[13];
+            if (type == 0x8100 && length >= 18) {
+                offset = 18;
+                type = (frame[16] << 8) | frame[17];
+            }
+        } else if (link == TEST_PCAP_LINK_SLL) {
+            offset = 16;
+            type = (frame[14] << 8) | frame[15];
+        } else if (link == TEST_PCAP_LINK_RAW || link == 12) {
+            offset = 0;
+            type = 0x0800;
+        } else {
+            break;
+        }
+        if (type != 0x0800 || (int)length < offset + 20 || frame[offset + 9] != 17)
+            continue;
+        ihl = (frame[offset] & 0x0F) * 4;
+        if ((int)length < offset + ihl + 8)
+            continue;
+        if (port && ((frame[offset + ihl + 2] << 8) | frame[offset + ihl + 3]) != port)
+            continue;
+        arrival.data.assign(frame.begin() + offset + ihl + 8, frame.end());
+        arrivals.push_back(arrival);
+    }
+#undef TEST_U32
+    fclose(file);
+    return !arrivals.empty();
+}
+
+typedef struct {
+    const std::vector<TestArrival>*     arrivals;
+    int                                 port;
+} TestReplay;
+
+/* 按抓包中的时间间隔发送到本机 */
+static void* TestReplayThread(void* arg)
+{
+    TestReplay* replay = (TestReplay*)arg;
+    const std::vector<TestArrival>& arrivals = *replay->arrivals;
+    struct sockaddr_in target;
+    int64_t start = TestNowUs(), wait;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    size_t i;
+
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(replay->port);
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (i = 0; i < arrivals.size(); i++) {
+        wait = start + arrivals[i].arrivalUs - arrivals[0].arrivalUs - TestNowUs();
+        if (wait > 0)
+            usleep(wait);
+        sendto(fd, &arrivals[i].data[0], arrivals[i].data.size(), 0, (struct sockaddr*)&target, sizeof(target));
+    }
+    close(fd);
+    return NULL;
+}
+
+/* 回放到 RTPReceiver，按顺序读出负载；返回读到的 packet 个数 */
+static int TestReceive(const std::vector<TestArrival>& arrivals, TestResult* result)
+{
+    RTPReceiver receiver;
+    TestReplay replay;
+    pthread_t thread;
+    uint8_t buffer[TEST_PAYLOAD_SIZE];
+    int64_t offset = 0;
+    uint32_t index;
+    int size, got = 0;
+
+    if (receiver.open("rtp://127.0.0.1:0", NULL) < 0)
+        return -1;
+    receiver.setLossCallback(TestOnLoss, result);
+    result->delivered.clear();
+    result->lostSequences.clear();
+    result->ordered = true;
+
+    replay.arrivals = &arrivals;
+    replay.port = receiver.getPort();
+    pthread_create(&thread, NULL, TestReplayThread, &replay);
+
+    //负载都是 TEST_PAYLOAD_SIZE，按 packet 读出序号
+    for (;;) {
+        size = receiver.read(offset, buffer + got, TEST_PAYLOAD_SIZE - got, 1000);
+        if (size <= 0)
+            break;
+        offset += size;
+        got += size;
+        if (got < TEST_PAYLOAD_SIZE)
+            continue;
+        index = TestReadU32(buffer);
+        if (!result->delivered.empty() && index <= result->delivered.back())
+            result->ordered = false;
+        result->delivered.push_back(index);
+        got = 0;
+    }
+    pthread_join(thread, NULL);
+    result->statistics = receiver.getStatistics();
+    receiver.logStatistics();
+    receiver.close();
+    return result->delivered.size();
+}
+
+static int TestLoopback()
+{
+    std::vector<TestArrival> arrivals, sent, replayed;
+    TestResult result;
+    bool failed;
+    int i;
+
+    TestSchedule(arrivals, 1000, 30000, 1000, TEST_SSRC, 0, 0, 15000);
+    for (i = 0; i < 1000; i++) {
+        if (i % 100 != 50)
+            sent.push_back(arrivals[i]);
+    }
+    std::stable_sort(sent.begin(), sent.end(), TestEarlier);
+    TestWritePcap(TEST_PCAP_PATH, sent, 5004);
+    if (!TestReadPcap(TEST_PCAP_PATH, 5004, replayed) || replayed.size() != sent.size()) {
+        printf("[loopback] read pcap FAILED\n");
+        return 1;
+    }
+
+    TestReceive(replayed, &result);
+    failed = !result.ordered || result.delivered.size() < 980 || result.statistics.lost < 10
+            || result.statistics.received != 990 || result.delivered.size() + result.statistics.late != 990;
+    printf("[loopback] pcap %d packets, delivered %d, lost %lld, late %lld, reordered %lld, jitter max %lld us, delay %lld us: %s\n",
+           (int)replayed.size(), (int)result.delivered.size(), (long long)result.statistics.lost,
+           (long long)result.statistics.late, (long long)result.statistics.reordered,
+           (long long)result.statistics.maxJitterUs, (long long)result.statistics.delayUs, failed ? "FAILED" : "OK");
+    unlink(TEST_PCAP_PATH);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<TestArrival> arrivals;
+    TestResult result;
+    int failed = 0;
+
+    if (argc > 1) {
+        if (!TestReadPcap(argv[1], (argc > 2) ? atoi(argv[2]) : 0, arrivals)) {
+            printf("read %s error\n", argv[1]);
+            return 1;
+        }
+        TestReceive(arrivals, &result);
+        printf("[replay] %s: sent %d, delivered %d, lost %lld, late %lld, reordered %lld, jitter max %lld us, delay %lld us\n",
+               argv[1], (int)arrivals.size(), (int)result.delivered.size(), (long long)result.statistics.lost,
+               (long long)result.statistics.late, (long long)result.statistics.reordered,
+               (long long)result.statistics.maxJitterUs, (long long)result.statistics.delayUs);
+        return 0;
+    }
+
+    srand(1);
+    failed += TestJitter();
+    failed += TestLossReorder();
+    failed += TestWrap();
+    failed += TestAdapt();
+    failed += TestResync();
+    failed += TestLoopback();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,360 @@
+/**
+ *  TestSubtitle.cpp文件
+ *  字幕的测试：
+ *          SubtitleQueue：随机的字幕乱序插入，各个时刻的查找结果和下一次变化的时间与逐条比较的结果相同
+ *          open 字幕被下一条或清除截断，重复的字幕忽略
+ *          SRT：BOM、CRLF、标签、缺少空行、错误的时间行；ASS：Format 的列顺序、文字中的逗号、样式和换行
+ *          图文电视：构造 EN 300 472 的 PES，自动选择字幕页，非字幕页忽略，空页清除
+ *
+ *  用法：TestSubtitle.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "SubtitleQueue.h"
+#include "SubtitleParser.h"
+#include "TeletextDecoder.h"
+
+
+#define     TEST_QUEUE_CUES             2000
+#define     TEST_QUEUE_SPAN_US          600000000   //10 分钟
+#define     TEST_QUEUE_PROBES           5000
+
+
+static uint32_t sRandom = 12345;
+
+static uint32_t TestRandom()
+{
+    sRandom = sRandom * 1103515245 + 12345;
+    return (sRandom >> 8) & 0xFFFFFF;
+}
+
+static SubtitleCue TestCue(int64_t startUs, int64_t endUs, const char* text)
+{
+    SubtitleCue cue;
+
+    SubtitleCueInit(&cue, startUs, endUs);
+    cue.text = text;
+    return cue;
+}
+
+static int TestQueue()
+{
+    std::vector<SubtitleCue> all, active;
+    SubtitleQueue queue;
+    int64_t timeUs, changeUs, expectUs;
+    unsigned int i, count;
+    int failed = 0, probe;
+    char text[32];
+
+    for (i = 0; i < TEST_QUEUE_CUES; i++) {
+        SubtitleCue cue;
+        int64_t startUs = (int64_t)TestRandom() * TEST_QUEUE_SPAN_US / 0xFFFFFF;
+
+        snprintf(text, sizeof(text), "cue %u", i);
+        /* 大部分几秒，少数很长，和别的字幕重叠 */
+        cue = TestCue(startUs, startUs + 1 + (i % 50 == 0 ? TestRandom() * 10 : TestRandom() % 5000000), text);
+        all.push_back(cue);
+        queue.insert(cue);
+    }
+    if (queue.size() != TEST_QUEUE_CUES)
+        failed = 1;
+
+    for (probe = 0; probe < TEST_QUEUE_PROBES && !failed; probe++) {
+        timeUs = (int64_t)TestRandom() * (TEST_QUEUE_SPAN_US + 10000000) / 0xFFFFFF;
+        if (probe % 10 == 0)
+            timeUs = all[probe % all.size()].startUs - (probe % 20 == 0 ? 1 : 0);    //边界
+        changeUs = queue.getActive(timeUs, active);
+
+        expectUs = SUBTITLE_TIME_NONE;
+        for (i = 0, count = 0; i < all.size(); i++) {
+            if (all[i].startUs <= timeUs && all[i].endUs > timeUs) {
+                count++;
+                if (all[i].endUs < expectUs)
+                    expectUs = all[i].endUs;
+            } else if (all[i].startUs > timeUs && all[i].startUs < expectUs) {
+                expectUs = all[i].startUs;
+            }
+        }
+        if (count != active.size() || changeUs != expectUs)
+            failed = 1;
+        for (i = 0; i < active.size(); i++) {
+            if (active[i].startUs > timeUs || active[i].endUs <= timeUs || (i > 0 && active[i - 1].startUs > active[i].startUs))
+                failed = 1;
+        }
+    }
+    printf("[queue] %d cues, %d probes against brute force: %s\n", TEST_QUEUE_CUES, probe, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestOpenCues()
+{
+    std::vector<SubtitleCue> active;
+    SubtitleQueue queue;
+    uint32_t generation;
+    int failed = 0;
+
+    /* 没有结束时间：最多 SUBTITLE_OPEN_MAX_US，下一条开始时结束 */
+    queue.insert(TestCue(1000000, -1, "a"));
+    if (queue.getActive(1000000 + SUBTITLE_OPEN_MAX_US - 1, active) != 1000000 + SUBTITLE_OPEN_MAX_US || active.size() != 1)
+        failed = 1;
+    queue.insert(TestCue(3000000, -1, "b"));
+    if (queue.getActive(2999999, active) != 3000000 || active.size() != 1 || active[0].text != "a")
+        failed = 1;
+
+    /* 清除只截断，不保存 */
+    generation = queue.getGeneration();
+    if (queue.insert(TestCue(4000000, -1, "")) || queue.size() != 2 || queue.getGeneration() == generation)
+        failed = 1;
+    if (queue.getActive(3500000, active) != 4000000 || queue.getActive(4000000, active) != SUBTITLE_TIME_NONE || !active.empty())
+        failed = 1;
+
+    /* seek 之后再次解复用的重复字幕 */
+    if (queue.insert(TestCue(3000000, -1, "b")) || queue.size() != 2)
+        failed = 1;
+
+    /* 乱序插入：后到的前面一条截断已有的 open 字幕，自己到后面一条为止 */
+    queue.insert(TestCue(2000000, -1, "c"));
+    if (queue.getActive(1500000, active) != 2000000 || queue.getActive(2500000, active) != 3000000
+        || active.size() != 1 || active[0].text != "c")
+        failed = 1;
+
+    /* 有结束时间的字幕不被截断 */
+    queue.insert(TestCue(5000000, 8000000, "d"));
+    queue.insert(TestCue(6000000, 7000000, "e"));
+    if (queue.getActive(6500000, active) != 7000000 || active.size() != 2 || active[0].text != "d" || active[1].text != "e")
+        failed = 1;
+
+    queue.clear();
+    if (queue.size() != 0 || queue.getActive(6500000, active) != SUBTITLE_TIME_NONE || !active.empty())
+        failed = 1;
+    printf("[open] truncation, clear marker, duplicates: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestSRT()
+{
+    const char* srt =
+        "\xEF\xBB\xBF" "1\r\n"
+        "00:00:01,500 --> 00:00:03,000\r\n"
+        "<i>Hello</i> <font color=\"#ff0000\">world</font>\r\n"
+        "  second line  \r\n"
+        "\r\n"
+        "2\r\n"
+        "00:00:04.25 --> 00:00:05,000 X1:10 X2:20\r\n"
+        "{\\an8}a < b\r\n"
+        "3\r\n"
+        "00:00:06,000 --> 00:00:07,000\r\n"
+        "no blank line before\r\n"
+        "\r\n"
+        "4\r\n"
+        "00:00:xx,000 --> 00:00:09,000\r\n"
+        "broken\r\n"
+        "\r\n"
+        "5\n"
+        "1:02:03,004 --> 1:02:04,000\n"
+        "last";
+    std::vector<SubtitleCue> cues;
+    int failed = 0;
+
+    if (SubtitleParser::parse(srt, strlen(srt), cues) != SubtitleFormat_SRT || cues.size() != 4)
+        failed = 1;
+    else if (cues[0].startUs != 1500000 || cues[0].endUs != 3000000 || cues[0].open || cues[0].text != "Hello world\nsecond line"
+             || cues[1].startUs != 4250000 || cues[1].text != "a < b"
+             || cues[2].startUs != 6000000 || cues[2].text != "no blank line before"
+             || cues[3].startUs != 3723004000LL || cues[3].text != "last")
+        failed = 1;
+    if (SubtitleParser::parseTime("12:34", NULL) != 754000000 || SubtitleParser::parseTime("1:2:3:4", NULL) != -1
+        || SubtitleParser::parseTime("0:00:01.1", NULL) != 1100000)
+        failed = 1;
+    printf("[srt] %u cues: %s\n", (unsigned int)cues.size(), failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestASS()
+{
+    const char* ass =
+        "[Script Info]\n"
+        "ScriptType: v4.00+\n"
+        "\n"
+        "[V4+ Styles]\n"
+        "Format: Name, Fontname\n"
+        "Style: Default,Arial\n"
+        "\n"
+        "[Events]\n"
+        "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n"
+        "Comment: 0,0:00:00.00,0:00:01.00,Default,,0,0,0,,ignored\n"
+        "Dialogue: 0,0:00:02.50,0:00:04.00,Default,,0,0,0,,{\\b1}Hi{\\b0}, there\\Nnext\\hline\n"
+        "Dialogue: 0,0:01:00.00,0:01:01.00,Default,,0,0,0,,{\\i1}Italic{\\i0}\n"
+        "Dialogue: bad\n";
+    const char* ssa =
+        "[Script Info]\n"
+        "[Events]\n"
+        "Format: Marked, Start, End, Style, Text\n"
+        "Dialogue: Marked=0,0:00:05.00,0:00:06.00,Default,a,b\n";
+    std::vector<SubtitleCue> cues;
+    int failed = 0;
+
+    if (SubtitleParser::parse(ass, strlen(ass), cues) != SubtitleFormat_ASS || cues.size() != 2)
+        failed = 1;
+    else if (cues[0].startUs != 2500000 || cues[0].endUs != 4000000 || cues[0].text != "Hi, there\nnext line"
+             || cues[1].startUs != 60000000 || cues[1].text != "Italic")
+        failed = 1;
+
+    cues.clear();
+    if (SubtitleParser::parse(ssa, strlen(ssa), cues) != SubtitleFormat_ASS || cues.size() != 1
+        || cues[0].startUs != 5000000 || cues[0].text != "a,b")
+        failed = 1;
+
+    cues.clear();
+    if (SubtitleParser::parse("\xFF\xFE\x31\x00", 4, cues) != SubtitleFormat_Unknown
+        || SubtitleParser::parse("plain text", 10, cues) != SubtitleFormat_Unknown || !cues.empty())
+        failed = 1;
+    printf("[ass] format order, commas in text, tags: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+/* PES 中的字节：位序反转之前 */
+static uint8_t TestReverse(uint8_t value)
+{
+    uint8_t result = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        result |= ((value >> i) & 1) << (7 - i);
+    return result;
+}
+
+static uint8_t TestHam(int nibble)
+{
+    int d1 = nibble & 1, d2 = (nibble >> 1) & 1, d3 = (nibble >> 2) & 1, d4 = (nibble >> 3) & 1;
+    int p1 = 1 ^ d1 ^ d3 ^ d4, p2 = 1 ^ d1 ^ d2 ^ d4, p3 = 1 ^ d1 ^ d2 ^ d3;
+    int p4 = 1 ^ p1 ^ d1 ^ p2 ^ d2 ^ p3 ^ d3 ^ d4;
+
+    /* 传输顺序 P1 D1 P2 D2 P3 D3 P4 D4，先传的在 PES 字节的高位 */
+    return TestReverse((uint8_t)(p1 | (d1 << 1) | (p2 << 2) | (d2 << 3) | (p3 << 4) | (d3 << 5) | (p4 << 6) | (d4 << 7)));
+}
+
+static uint8_t TestOddParity(char c)
+{
+    uint8_t value = (uint8_t)c & 0x7F;
+    int bits = 0, i;
+
+    for (i = 0; i < 7; i++)
+        bits += (value >> i) & 1;
+    return TestReverse((uint8_t)(value | ((bits & 1) ? 0 : 0x80)));
+}
+
+static void TestPacket(std::vector<uint8_t>& pes, int magazine, int row, const uint8_t* data)
+{
+    int address = (row << 3) | (magazine & 7);
+
+    pes.push_back(0x03);
+    pes.push_back(TELETEXT_DATA_UNIT_SIZE);
+    pes.push_back(0xC0);
+    pes.push_back(0xE4);
+    pes.push_back(TestHam(address & 0x0F));
+    pes.push_back(TestHam(address >> 4));
+    pes.insert(pes.end(), data, data + TELETEXT_COLUMNS);
+}
+
+static void TestHeader(std::vector<uint8_t>& pes, int page, bool subtitle, bool serial)
+{
+    uint8_t data[TELETEXT_COLUMNS];
+    int i;
+
+    data[0] = TestHam(page & 0x0F);
+    data[1] = TestHam((page >> 4) & 0x0F);
+    data[2] = TestHam(0);
+    data[3] = TestHam(0x08);                    //C4 清除页
+    data[4] = TestHam(0);
+    data[5] = TestHam(subtitle ? 0x08 : 0);     //C6 字幕
+    data[6] = TestHam(0);
+    data[7] = TestHam(serial ? 0x01 : 0);       //C11 串行
+    for (i = 8; i < TELETEXT_COLUMNS; i++)
+        data[i] = TestOddParity(' ');
+    TestPacket(pes, page >> 8, 0, data);
+}
+
+static void TestRow(std::vector<uint8_t>& pes, int magazine, int row, const char* text)
+{
+    uint8_t data[TELETEXT_COLUMNS];
+    int i, length = strlen(text);
+
+    /* 字幕行前面通常是颜色和开始方框的控制码 */
+    data[0] = TestOddParity(0x07);
+    data[1] = TestOddParity(0x0B);
+    data[2] = TestOddParity(0x0B);
+    for (i = 3; i < TELETEXT_COLUMNS; i++)
+        data[i] = TestOddParity(i - 3 < length ? text[i - 3] : (i == TELETEXT_COLUMNS - 1 ? 0x0A : ' '));
+    TestPacket(pes, magazine, row, data);
+}
+
+static int TestTeletext()
+{
+    TeletextDecoder decoder;
+    SubtitleQueue queue;
+    std::vector<SubtitleCue> cues, active;
+    std::vector<uint8_t> pes;
+    unsigned int i;
+    int failed = 0;
+
+    /* 非字幕页 100 在前，字幕页 888(杂志 8 的页地址为 0) */
+    pes.push_back(0x10);
+    TestHeader(pes, 0x100, false, false);
+    TestRow(pes, 1, 1, "not a subtitle");
+    TestHeader(pes, 0x888, true, false);
+    TestRow(pes, 8, 20, "Hello");
+    TestRow(pes, 8, 22, "world");
+    TestRow(pes, 1, 21, "other magazine");
+    if (decoder.decode(&pes[0], pes.size(), 1000000, cues) != 0 || decoder.getPage() != 0x888)
+        failed = 1;
+
+    /* 下一个同杂志的页头结束上一页 */
+    pes.clear();
+    pes.push_back(0x10);
+    TestHeader(pes, 0x888, true, false);
+    TestRow(pes, 8, 22, "again");
+    if (decoder.decode(&pes[0], pes.size(), 3000000, cues) != 1 || cues[0].text != "Hello\nworld" || cues[0].startUs != 1000000
+        || !cues[0].open)
+        failed = 1;
+
+    /* 空页为清除 */
+    pes.clear();
+    pes.push_back(0x10);
+    TestHeader(pes, 0x888, true, false);
+    TestHeader(pes, 0x888, true, false);
+    if (decoder.decode(&pes[0], pes.size(), 5000000, cues) != 2 || cues[1].text != "again" || !cues[2].text.empty())
+        failed = 1;
+
+    for (i = 0; i < cues.size(); i++)
+        queue.insert(cues[i]);
+    if (queue.getActive(4000000, active) != 5000000 || active.size() != 1 || active[0].text != "again"
+        || queue.getActive(5000000, active) != SUBTITLE_TIME_NONE || !active.empty())
+        failed = 1;
+
+    if (decoder.decode((const uint8_t*)"\x20\x03", 2, 0, cues) != -1 || decoder.getSubtitlePages().size() != 1)
+        failed = 1;
+    printf("[teletext] page 888, %u cues: %s\n", (unsigned int)cues.size(), failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main()
+{
+    int failed = 0;
+
+    failed += TestQueue();
+    failed += TestOpenCues();
+    failed += TestSRT();
+    failed += TestASS();
+    failed += TestTeletext();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,354 @@
+/**
+ *  TestTSParser.cpp文件
+ *  TSParser 的正确性测试和性能测试：
+ *          生成多节目的 TS 码流(188/192/204)，检查解复用得到的 access unit 与写入的一致
+ *          按 UDP 包大小(1316)和大块(64K)输入，统计单核 MB/s
+ *
+ *  用法：TestTSParser.elf [capture.ts]
+ *          指定文件时再对该文件做一次性能测试
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "TSParser.h"
+
+
+#define     TEST_PROGRAM_COUNT          8
+#define     TEST_DURATION_FRAMES        1500        //每个节目 25fps * 60s
+#define     TEST_PMT_PID_BASE           0x1000
+#define     TEST_ES_PID_BASE            0x100
+
+
+typedef struct {
+    int         accessUnits;
+    int         flagged;
+    uint32_t    checksum;
+    int64_t     lastPts;
+} TestPidResult;
+
+static TestPidResult    sExpected[TS_PID_MAX];
+static TestPidResult    sActual[TS_PID_MAX];
+static uint8_t          sContinuity[TS_PID_MAX];
+static uint32_t         sCrcTable[256];
+
+
+static uint32_t TestChecksum(uint32_t sum, const uint8_t* data, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        sum = sum * 31 + data[i];
+    return sum;
+}
+
+static uint32_t TestCrc32(const uint8_t* data, int length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int i;
+    for (i = 0; i < length; i++)
+        crc = (crc << 8) ^ sCrcTable[((crc >> 24) ^ data[i]) & 0xFF];
+    return crc;
+}
+
+static void TestWriteTimestamp(uint8_t* p, int prefix, int64_t ts)
+{
+    p[0] = (prefix << 4) | (((ts >> 30) & 0x07) << 1) | 1;
+    p[1] = (ts >> 22) & 0xFF;
+    p[2] = (((ts >> 15) & 0x7F) << 1) | 1;
+    p[3] = (ts >> 7) & 0xFF;
+    p[4] = ((ts & 0x7F) << 1) | 1;
+}
+
+
+//把 data 切成 TS 包，pcr >= 0 时在第一个包中写入 PCR
+static void TestPacketize(std::vector<uint8_t>& out, int pid, const uint8_t* data, int size, bool randomAccess, int64_t pcr)
+{
+    bool first = true;
+
+    while (size > 0 || first) {
+        uint8_t packet[TS_PACKET_SIZE];
+        int header = 4;
+        int fieldLength = -1;
+        int count;
+
+        memset(packet, 0xFF, sizeof(packet));
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = (first ? 0x40 : 0x00) | ((pid >> 8) & 0x1F);
+        packet[2] = pid & 0xFF;
+
+        if (first && (randomAccess || pcr >= 0)) {
+            fieldLength = 1 + ((pcr >= 0) ? 6 : 0);
+            packet[5] = (randomAccess ? 0x40 : 0) | ((pcr >= 0) ? 0x10 : 0);
+            if (pcr >= 0) {
+                int64_t base = pcr / 300;
+                packet[6] = (base >> 25) & 0xFF;
+                packet[7] = (base >> 17) & 0xFF;
+                packet[8] = (base >> 9) & 0xFF;
+                packet[9] = (base >> 1) & 0xFF;
+                packet[10] = ((base & 1) << 7) | 0x7E;
+                packet[11] = pcr % 300;
+            }
+        }
+        count = TS_PACKET_SIZE - header - ((fieldLength >= 0) ? fieldLength + 1 : 0);
+        if (size < count) {         //最后一包用适配域填充
+            int stuffing = count - size;
+            if (fieldLength < 0) {
+                fieldLength = stuffing - 1;
+                if (fieldLength > 0)
+                    packet[5] = 0x00;
+            } else {
+                fieldLength += stuffing;
+            }
+            count = size;
+        }
+        if (fieldLength >= 0) {
+            packet[3] = 0x30 | sContinuity[pid];
+            packet[4] = fieldLength;
+            header = 5 + fieldLength;
+        } else {
+            packet[3] = 0x10 | sContinuity[pid];
+        }
+        sContinuity[pid] = (sContinuity[pid] + 1) & 0x0F;
+        memcpy(packet + header, data, count);
+        out.insert(out.end(), packet, packet + TS_PACKET_SIZE);
+        data += count;
+        size -= count;
+        first = false;
+    }
+}
+
+static void TestWriteSection(std::vector<uint8_t>& out, int pid, std::vector<uint8_t>& section)
+{
+    uint32_t crc;
+    std::vector<uint8_t> payload;
+
+    section[1] = 0xB0 | (((section.size() + 4 - 3) >> 8) & 0x0F);
+    section[2] = (section.size() + 4 - 3) & 0xFF;
+    crc = TestCrc32(&section[0], section.size());
+    section.push_back(crc >> 24);
+    section.push_back(crc >> 16);
+    section.push_back(crc >> 8);
+    section.push_back(crc);
+    payload.push_back(0);           //pointer_field
+    payload.insert(payload.end(), section.begin(), section.end());
+    TestPacketize(out, pid, &payload[0], payload.size(), false, -1);
+}
+
+static void TestWritePsi(std::vector<uint8_t>& out)
+{
+    std::vector<uint8_t> pat;
+    int p;
+
+    pat.push_back(0x00); pat.push_back(0); pat.push_back(0);
+    pat.push_back(0x00); pat.push_back(0x01); pat.push_back(0xC1); pat.push_back(0); pat.push_back(0);
+    for (p = 0; p < TEST_PROGRAM_COUNT; p++) {
+        pat.push_back(0); pat.push_back(p + 1);
+        pat.push_back(0xE0 | ((TEST_PMT_PID_BASE + p) >> 8)); pat.push_back((TEST_PMT_PID_BASE + p) & 0xFF);
+    }
+    TestWriteSection(out, TS_PID_PAT, pat);
+
+    for (p = 0; p < TEST_PROGRAM_COUNT; p++) {
+        std::vector<uint8_t> pmt;
+        int video = TEST_ES_PID_BASE + p * 16;
+        int audio = video + 1;
+        pmt.push_back(0x02); pmt.push_back(0); pmt.push_back(0);
+        pmt.push_back(0); pmt.push_back(p + 1); pmt.push_back(0xC1); pmt.push_back(0); pmt.push_back(0);
+        pmt.push_back(0xE0 | (video >> 8)); pmt.push_back(video & 0xFF);
+        pmt.push_back(0xF0); pmt.push_back(0);
+        pmt.push_back(TSStreamType_H264); pmt.push_back(0xE0 | (video >> 8)); pmt.push_back(video & 0xFF); pmt.push_back(0xF0); pmt.push_back(0);
+        pmt.push_back(TSStreamType_AAC); pmt.push_back(0xE0 | (audio >> 8)); pmt.push_back(audio & 0xFF); pmt.push_back(0xF0); pmt.push_back(5);
+        pmt.push_back(0x0A); pmt.push_back(3); pmt.push_back('c'); pmt.push_back('h'); pmt.push_back('i');
+        TestWriteSection(out, TEST_PMT_PID_BASE + p, pmt);
+    }
+}
+
+static void TestWritePes(std::vector<uint8_t>& out, int pid, int streamId, int payloadSize, int64_t pts, bool bounded, bool randomAccess, int64_t pcr)
+{
+    std::vector<uint8_t> pes(14 + payloadSize);
+    int i;
+
+    pes[0] = 0; pes[1] = 0; pes[2] = 1; pes[3] = streamId;
+    pes[4] = bounded ? ((payloadSize + 8) >> 8) : 0;
+    pes[5] = bounded ? ((payloadSize + 8) & 0xFF) : 0;
+    pes[6] = 0x80; pes[7] = 0x80; pes[8] = 5;
+    TestWriteTimestamp(&pes[9], 2, pts);
+    for (i = 0; i < payloadSize; i++)
+        pes[14 + i] = rand() & 0xFF;
+    TestPacketize(out, pid, &pes[0], pes.size(), randomAccess, pcr);
+
+    sExpected[pid].accessUnits++;
+    sExpected[pid].checksum = TestChecksum(sExpected[pid].checksum, &pes[14], payloadSize);
+    sExpected[pid].lastPts = pts;
+}
+
+static void TestGenerateStream(std::vector<uint8_t>& out)
+{
+    int frame, p;
+    uint8_t null[TS_PACKET_SIZE];
+
+    memset(null, 0xFF, sizeof(null));
+    null[0] = TS_SYNC_BYTE; null[1] = 0x1F; null[2] = 0xFF; null[3] = 0x10;
+
+    srand(1);
+    for (frame = 0; frame < TEST_DURATION_FRAMES; frame++) {
+        if (frame % 10 == 0)
+            TestWritePsi(out);
+        for (p = 0; p < TEST_PROGRAM_COUNT; p++) {
+            int video = TEST_ES_PID_BASE + p * 16;
+            int64_t pts = 90000 + frame * 3600;
+            bool key = (frame % 25) == 0;
+            TestWritePes(out, video, 0xE0, key ? 40000 + rand() % 20000 : 2000 + rand() % 12000, pts, false, key, pts * 300);
+            TestWritePes(out, video + 1, 0xC0, 300 + rand() % 300, pts, true, false, -1);
+            TestWritePes(out, video + 1, 0xC0, 300 + rand() % 300, pts + 1920, true, false, -1);
+        }
+        if (frame % 4 == 0)
+            out.insert(out.end(), null, null + TS_PACKET_SIZE);
+    }
+}
+
+
+static void TestOnAccessUnitVerify(const TSAccessUnit* au, void* userData)
+{
+    TestPidResult* result = &sActual[au->pid];
+    int i;
+
+    result->accessUnits++;
+    for (i = 0; i < au->fragmentCount; i++)
+        result->checksum = TestChecksum(result->checksum, au->fragments[i].data, au->fragments[i].size);
+    if (au->flags & (TSAccessUnit_Discontinuity | TSAccessUnit_Truncated))
+        result->flagged++;
+    result->lastPts = au->pts;
+}
+
+static void TestOnAccessUnitCount(const TSAccessUnit* au, void* userData)
+{
+    (*(int64_t*)userData) += au->size;
+}
+
+
+static double TestCpuSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int TestVerify(const char* name, const std::vector<uint8_t>& stream, int chunk)
+{
+    TSParser parser;
+    TSParserCallbacks callbacks;
+    size_t offset;
+    int pid, errors = 0;
+
+    memset(sActual, 0, sizeof(sActual));
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onAccessUnit = TestOnAccessUnitVerify;
+    parser.setCallbacks(callbacks);
+    for (offset = 0; offset < stream.size(); offset += chunk)
+        parser.parse(&stream[offset], (stream.size() - offset < (size_t)chunk) ? stream.size() - offset : chunk);
+    parser.flush();
+
+    for (pid = 0; pid < TS_PID_MAX; pid++) {
+        if (sExpected[pid].accessUnits == 0)
+            continue;
+        if (sActual[pid].accessUnits != sExpected[pid].accessUnits || sActual[pid].checksum != sExpected[pid].checksum
+                || sActual[pid].lastPts != sExpected[pid].lastPts || sActual[pid].flagged) {
+            printf("  pid 0x%x: expected %d AU, got %d, flagged %d\n", pid, sExpected[pid].accessUnits, sActual[pid].accessUnits, sActual[pid].flagged);
+            errors++;
+        }
+    }
+    printf("%-24s chunk %6d: %s (packet size %d, AU %lld, spilled %lld bytes)\n", name, chunk, errors ? "FAILED" : "OK",
+            parser.getPacketSize(), (long long)parser.getStatistics().accessUnits, (long long)parser.getStatistics().spilledBytes);
+    return errors;
+}
+
+static void TestBenchmark(const char* name, const std::vector<uint8_t>& stream, int chunk)
+{
+    TSParser parser;
+    TSParserCallbacks callbacks;
+    int64_t payload = 0;
+    double begin, seconds;
+    int round, rounds = 5;
+    size_t offset;
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.onAccessUnit = TestOnAccessUnitCount;
+    callbacks.userData = &payload;
+    parser.setCallbacks(callbacks);
+
+    begin = TestCpuSeconds();
+    for (round = 0; round < rounds; round++) {
+        for (offset = 0; offset < stream.size(); offset += chunk)
+            parser.parse(&stream[offset], (stream.size() - offset < (size_t)chunk) ? stream.size() - offset : chunk);
+        parser.flush();
+    }
+    seconds = TestCpuSeconds() - begin;
+    printf("%-24s chunk %6d: %8.1f MB/s per core (%lld MB payload)\n", name, chunk,
+            stream.size() * (double)rounds / seconds / (1024 * 1024), (long long)(payload >> 20));
+}
+
+static void TestConvert(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, int packetSize)
+{
+    size_t i;
+
+    out.clear();
+    out.reserve(in.size() / TS_PACKET_SIZE * packetSize);
+    for (i = 0; i + TS_PACKET_SIZE <= in.size(); i += TS_PACKET_SIZE) {
+        if (packetSize == TS_PACKET_SIZE_M2TS)
+            out.insert(out.end(), 4, 0x00);
+        out.insert(out.end(), in.begin() + i, in.begin() + i + TS_PACKET_SIZE);
+        if (packetSize == TS_PACKET_SIZE_FEC)
+            out.insert(out.end(), 16, 0x00);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::vector<uint8_t> stream, converted;
+    uint32_t i, j, crc;
+    int errors = 0;
+
+    for (i = 0; i < 256; i++) {
+        for (crc = i << 24, j = 0; j < 8; j++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        sCrcTable[i] = crc;
+    }
+
+    TestGenerateStream(stream);
+    printf("generated %d programs, %.1f MB\n", TEST_PROGRAM_COUNT, stream.size() / (1024.0 * 1024));
+
+    errors += TestVerify("188", stream, 1316);
+    errors += TestVerify("188", stream, 65536);
+    errors += TestVerify("188", stream, 1000);      //不按包对齐
+    TestConvert(stream, converted, TS_PACKET_SIZE_M2TS);
+    errors += TestVerify("192", converted, 1000);
+    TestConvert(stream, converted, TS_PACKET_SIZE_FEC);
+    errors += TestVerify("204", converted, 1000);
+
+    TestBenchmark("188 multi-program", stream, 1316);
+    TestBenchmark("188 multi-program", stream, 65536);
+
+    if (argc > 1) {
+        FILE* fp = fopen(argv[1], "rb");
+        if (fp != NULL) {
+            uint8_t buffer[65536];
+            size_t count;
+            std::vector<uint8_t> capture;
+            while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+                capture.insert(capture.end(), buffer, buffer + count);
+            fclose(fp);
+            TestBenchmark(argv[1], capture, 1316);
+            TestBenchmark(argv[1], capture, 65536);
+        } else {
+            printf("open %s error.\n", argv[1]);
+        }
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,417 @@
+/**
+ *  TestTrickPlay.cpp文件
+ *  快进快退和精确 seek 的测试：
+ *          模拟的解复用：25fps 视频、20ms 一个的音频，seek 到之前的关键帧；可以设置 seek 粒度很粗、落在最近的关键帧上
+ *          精确 seek：目标之前的视频只解码，音频丢弃，第一个显示的帧就是目标
+ *          2x~32x 前进、后退只输出关键帧，间隔和顺序正确，跨度大时用 seek 跳过，seek 粒度粗时后退也能结束
+ *          AudioTimeStretch：0.5x~2x 输出时长、音调(过零率)、波形连续
+ *          seek 到第一帧的延时：模拟的解复用和本地文件(只统计解复用和 seek，不包括解码)
+ *
+ *  用法：TestTrickPlay.elf [media ...]
+ *          默认为 cuc_ieschool.flv，文件不存在时跳过
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Demuxer.h"
+#include "TrickPlay.h"
+#include "AudioTimeStretch.h"
+
+
+#define     TEST_DURATION_US            60000000
+#define     TEST_FRAME_US               40000
+#define     TEST_AUDIO_US               20000
+#define     TEST_GOP                    25          //1 秒一个关键帧
+#define     TEST_SEEKS                  20
+#define     TEST_SAMPLE_RATE            48000
+#define     TEST_TONE_HZ                440
+
+
+/* 模拟的解复用：按时间交织视频和音频，seek 到 granularity 的整数倍之前(nearest 时为最近)的关键帧 */
+class TestDemuxer : public Demuxer {
+    public:
+        TestDemuxer(int64_t granularityUs, bool nearest)
+            : m_granularityUs(granularityUs), m_nearest(nearest), m_videoUs(0), m_audioUs(0), m_seeks(0), m_reads(0)
+        {
+            DemuxStreamInfo info = DemuxStreamInfo();
+
+            info.type = DemuxStream_Video;
+            info.codec = DemuxCodec_H264;
+            addStream(info);
+            info.type = DemuxStream_Audio;
+            info.codec = DemuxCodec_AAC;
+            addStream(info);
+            m_durationUs = TEST_DURATION_US;
+        }
+
+        const char* getName() { return "test"; }
+        int open(const DemuxSource& /*source*/) { return 0; }
+
+        int seek(int64_t timeUs)
+        {
+            int64_t gopUs = (int64_t)TEST_GOP * TEST_FRAME_US, positionUs;
+
+            if (timeUs < 0 || timeUs >= m_durationUs)
+                return -1;
+            positionUs = m_nearest ? (timeUs + m_granularityUs / 2) / m_granularityUs * m_granularityUs
+                                   : timeUs / m_granularityUs * m_granularityUs;
+            positionUs = std::min(positionUs / gopUs * gopUs, (m_durationUs - 1) / gopUs * gopUs);
+            m_videoUs = m_audioUs = positionUs;
+            m_seeks++;
+            return 0;
+        }
+
+        int readPacket(DemuxPacket** packet)
+        {
+            bool video = m_videoUs <= m_audioUs;
+            int64_t ptsUs = video ? m_videoUs : m_audioUs;
+
+            if (ptsUs >= m_durationUs)
+                return 1;
+            *packet = allocPacket(video ? 0 : 1, 16);
+            (*packet)->ptsUs = (*packet)->dtsUs = ptsUs;
+            if (!video || (ptsUs / TEST_FRAME_US) % TEST_GOP == 0)
+                (*packet)->flags |= DemuxPacket_Keyframe;
+            if (video)
+                m_videoUs += TEST_FRAME_US;
+            else
+                m_audioUs += TEST_AUDIO_US;
+            m_reads++;
+            return 0;
+        }
+
+        int64_t     m_granularityUs;
+        bool        m_nearest;
+        int64_t     m_videoUs;
+        int64_t     m_audioUs;
+        int         m_seeks;
+        int         m_reads;
+};
+
+typedef struct {
+    std::vector<int64_t>    videoPts;       //输出的视频，不包括只解码的
+    int                     decodeOnly;
+    int                     audio;
+    int                     nonKeyframes;
+    int                     result;
+} TestOutput;
+
+
+static int64_t TestNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void TestRead(Demuxer* demuxer, TrickPlayControl* control, int maxVideo, TestOutput* output)
+{
+    DemuxPacket* packet;
+
+    output->videoPts.clear();
+    output->decodeOnly = output->audio = output->nonKeyframes = 0;
+    while ((int)output->videoPts.size() < maxVideo) {
+        output->result = TrickPlayReadPacket(demuxer, control, &packet);
+        if (output->result != 0)
+            break;
+        if (packet->streamIndex != 0)
+            output->audio++;
+        else if (packet->flags & DemuxPacket_DecodeOnly)
+            output->decodeOnly++;
+        else
+            output->videoPts.push_back(packet->ptsUs);
+        if (packet->streamIndex == 0 && !(packet->flags & DemuxPacket_Keyframe))
+            output->nonKeyframes++;
+        DemuxPacketUnref(packet);
+    }
+}
+
+static int TestNormal()
+{
+    TestDemuxer demuxer(TEST_FRAME_US, false);
+    TrickPlayControl control;
+    TestOutput output;
+    int failed = 0;
+
+    TestRead(&demuxer, &control, 0x7FFFFFFF, &output);
+    if (output.result != 1 || (int)output.videoPts.size() != TEST_DURATION_US / TEST_FRAME_US
+        || output.audio != TEST_DURATION_US / TEST_AUDIO_US || output.decodeOnly != 0)
+        failed = 1;
+    printf("[normal] video %d, audio %d: %s\n", (int)output.videoPts.size(), output.audio, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestAccurateSeek()
+{
+    TestDemuxer demuxer(TEST_FRAME_US, false);
+    TrickPlayControl control;
+    TestOutput output;
+    int64_t target = 12340000, keyframe = 12000000;
+    int expected = (int)((target - keyframe + TEST_FRAME_US - 1) / TEST_FRAME_US), failed = 0;
+    DemuxPacket* packet;
+    int early = 0, ret;
+
+    //关键帧只 seek 到之前的关键帧
+    TrickPlaySeek(&demuxer, &control, target, false, 0);
+    TestRead(&demuxer, &control, 1, &output);
+    if (output.videoPts.empty() || output.videoPts[0] != keyframe || output.decodeOnly != 0)
+        failed = 1;
+
+    TrickPlaySeek(&demuxer, &control, target, true, 5000000);
+    TestRead(&demuxer, &control, 1, &output);
+    if (output.videoPts.empty() || output.videoPts[0] < target || output.videoPts[0] >= target + TEST_FRAME_US
+        || output.decodeOnly != expected || control.toPlayUs(target) != 5000000)
+        failed = 1;
+    while ((ret = TrickPlayReadPacket(&demuxer, &control, &packet)) == 0) {
+        if (packet->ptsUs >= target + 1000000)
+            break;
+        if (packet->ptsUs < target)
+            early++;
+        DemuxPacketUnref(packet);
+    }
+    if (ret == 0)
+        DemuxPacketUnref(packet);
+    if (early > 0)
+        failed = 1;
+    printf("[seek] target %lld ms, first frame %lld ms, decode only %d: %s\n", (long long)target / 1000,
+           output.videoPts.empty() ? -1LL : (long long)output.videoPts[0] / 1000, output.decodeOnly, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+/* 只有关键帧，顺序和间隔正确 */
+static bool TestCheckKeyframes(const TestOutput& output, int rate)
+{
+    int64_t step = (int64_t)abs(rate) * TRICKPLAY_FRAME_INTERVAL_US / TRICKPLAY_RATE_NORMAL;
+    size_t i;
+
+    if (output.videoPts.empty() || output.audio != 0 || output.nonKeyframes != 0 || output.decodeOnly != 0)
+        return false;
+    for (i = 1; i < output.videoPts.size(); i++) {
+        int64_t delta = output.videoPts[i] - output.videoPts[i - 1];
+        if (rate > 0 && delta < step)
+            return false;
+        if (rate < 0 && (delta >= 0 || (-delta < step && output.videoPts[i] != 0)))
+            return false;
+    }
+    return true;
+}
+
+static int TestForward()
+{
+    static const int rates[] = { 400, 800, 1600, 3200 };
+    int64_t start = 10000000;
+    int i, failed = 0;
+
+    for (i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+        TestDemuxer demuxer(TEST_FRAME_US, false);
+        TrickPlayControl control;
+        TestOutput output;
+        bool ok;
+
+        control.setRate(rates[i]);
+        TrickPlaySeek(&demuxer, &control, start, false, 0);
+        TestRead(&demuxer, &control, 0x7FFFFFFF, &output);
+        ok = output.result == 1 && TestCheckKeyframes(output, rates[i]) && output.videoPts[0] == start;
+        //跨度超过 2 秒时用 seek 跳过，读取的 packet 比顺序读少
+        if (rates[i] >= 1600 && (demuxer.m_seeks < 2 || demuxer.m_reads > (TEST_DURATION_US - start) / TEST_FRAME_US))
+            ok = false;
+        failed += ok ? 0 : 1;
+        printf("[forward %dx] frames %d, seeks %d, packets read %d: %s\n", rates[i] / 100, (int)output.videoPts.size(),
+               demuxer.m_seeks, demuxer.m_reads, ok ? "OK" : "FAILED");
+    }
+    return failed;
+}
+
+static int TestBackward()
+{
+    static const int rates[] = { -200, -800, -3200 };
+    int64_t start = 30000000, lastPlay;
+    int i, k, failed = 0;
+
+    /* k = 1 时 seek 落在 5 秒粒度上最近的关键帧，经常回到同一帧，要逐步往前退 */
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+            TestDemuxer demuxer(k ? 5000000 : TEST_FRAME_US, k == 1);
+            TrickPlayControl control;
+            TestOutput output;
+            size_t j;
+            bool ok;
+
+            control.setRate(rates[i]);
+            TrickPlaySeek(&demuxer, &control, start, false, 0);
+            TestRead(&demuxer, &control, 0x7FFFFFFF, &output);
+            ok = output.result == 1 && TestCheckKeyframes(output, rates[i]) && output.videoPts.back() == 0;
+            //播放时间仍然递增
+            for (lastPlay = -1, j = 0; j < output.videoPts.size(); j++) {
+                if (control.toPlayUs(output.videoPts[j]) <= lastPlay)
+                    ok = false;
+                lastPlay = control.toPlayUs(output.videoPts[j]);
+            }
+            if (k == 0 && rates[i] == -200 && (int)output.videoPts.size() != start / (TEST_GOP * TEST_FRAME_US) + 1)
+                ok = false;
+            failed += ok ? 0 : 1;
+            printf("[backward %dx%s] frames %d, first %lld ms, seeks %d: %s\n", -rates[i] / 100, k ? " coarse" : "",
+                   (int)output.videoPts.size(), output.videoPts.empty() ? -1LL : (long long)output.videoPts[0] / 1000,
+                   demuxer.m_seeks, ok ? "OK" : "FAILED");
+        }
+    }
+    return failed;
+}
+
+static int TestRateMapping()
+{
+    TrickPlayControl control;
+    int failed = 0;
+
+    if (control.setRate(0) == 0 || control.setRate(40) == 0 || control.setRate(-100) == 0 || control.setRate(6400) == 0)
+        failed = 1;
+    if (control.setRate(50) < 0 || control.isKeyframeOnly() || !control.isAudioEnabled())
+        failed = 1;
+    control.seek(10000000, true, 1000000);
+    if (control.toPlayUs(11000000) != 3000000 || control.toMediaUs(3000000) != 11000000
+        || control.toPlayDurationUs(TEST_FRAME_US) != 2 * TEST_FRAME_US)
+        failed = 1;
+    if (control.setRate(200) < 0 || control.isKeyframeOnly() || control.setRate(-200) < 0 || !control.isKeyframeOnly())
+        failed = 1;
+    control.seek(10000000, true, 0);
+    if (control.toPlayUs(8000000) != 1000000 || control.toMediaUs(1000000) != 8000000)
+        failed = 1;
+    printf("[rate] mapping: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+
+static int TestStretch()
+{
+    static const int rates[] = { 50, 75, 100, 150, 200 };
+    std::vector<int16_t> input, output;
+    int frames = TEST_SAMPLE_RATE * 4, chunk = 1024, i, j, failed = 0;
+
+    for (i = 0; i < frames; i++) {
+        int16_t value = (int16_t)(10000 * sin(2 * M_PI * TEST_TONE_HZ * i / TEST_SAMPLE_RATE));
+        input.push_back(value);
+        input.push_back(value / 2);
+    }
+
+    for (i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+        AudioTimeStretch stretch;
+        int produced = 0, crossings = 0, maxStep = 0, expected = frames * 100 / rates[i];
+        int64_t begin;
+        double seconds, hz;
+        bool ok;
+
+        stretch.open(TEST_SAMPLE_RATE, 2);
+        stretch.setRate(rates[i]);
+        output.clear();
+        begin = TestNowUs();
+        for (j = 0; j < frames; j += chunk)
+            produced += stretch.process(&input[j * 2], std::min(chunk, frames - j), output);
+        produced += stretch.flush(output);
+        seconds = (TestNowUs() - begin) / 1e6;
+
+        for (j = 1; j < produced; j++) {
+            if ((output[j * 2 - 2] < 0) != (output[j * 2] < 0))
+                crossings++;
+            maxStep = std::max(maxStep, abs(output[j * 2] - output[j * 2 - 2]));
+        }
+        hz = crossings / 2.0 / ((double)produced / TEST_SAMPLE_RATE);
+        //结尾不足一段的输入丢弃，最多差 STRETCH_SEQUENCE_MS + STRETCH_SEEK_MS
+        ok = (int)output.size() == produced * 2 && abs(produced - expected) <= TEST_SAMPLE_RATE * 60 / 1000 * 100 / rates[i]
+             && fabs(hz - TEST_TONE_HZ) < TEST_TONE_HZ * 0.03 && maxStep < 1500;
+        failed += ok ? 0 : 1;
+        printf("[stretch %d%%] %d -> %d frames (expect %d), %.1f Hz, max step %d, %.1fx realtime: %s\n", rates[i], frames,
+               produced, expected, hz, maxStep, seconds > 0 ? frames / (double)TEST_SAMPLE_RATE / seconds : 0.0,
+               ok ? "OK" : "FAILED");
+    }
+    return failed;
+}
+
+
+/* seek 到第一帧：精确时从 seek 到目标帧(中间的只解码)，关键帧时到第一个关键帧 */
+static void TestSeekLatency(const char* name, Demuxer* demuxer)
+{
+    int64_t duration = demuxer->getDurationUs(), total[2] = { 0, 0 }, worst[2] = { 0, 0 }, begin, elapsed;
+    int count[2] = { 0, 0 }, decodeOnly = 0, i, k;
+    TrickPlayControl control;
+    TestOutput output;
+
+    if (duration <= 0) {
+        printf("[latency] %s: unknown duration, skipped\n", name);
+        return;
+    }
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < TEST_SEEKS; i++) {
+            int64_t target = duration * (i * 7 % TEST_SEEKS) / TEST_SEEKS + 123456 % (duration / TEST_SEEKS + 1);
+            begin = TestNowUs();
+            if (TrickPlaySeek(demuxer, &control, target, k == 1, 0) < 0)
+                continue;
+            TestRead(demuxer, &control, 1, &output);
+            elapsed = TestNowUs() - begin;
+            if (output.videoPts.empty())
+                continue;
+            total[k] += elapsed;
+            worst[k] = std::max(worst[k], elapsed);
+            count[k]++;
+            if (k == 1)
+                decodeOnly += output.decodeOnly;
+        }
+    }
+    printf("[latency] %s: keyframe seek avg %.3f ms max %.3f ms; accurate seek avg %.3f ms max %.3f ms, "
+           "%.1f decode-only frames per seek (%d/%d seeks)\n", name,
+           count[0] ? total[0] / 1000.0 / count[0] : 0.0, worst[0] / 1000.0,
+           count[1] ? total[1] / 1000.0 / count[1] : 0.0, worst[1] / 1000.0,
+           count[1] ? (double)decodeOnly / count[1] : 0.0, count[0], count[1]);
+}
+
+static void TestMediaLatency(const char* path)
+{
+    DemuxSource source;
+    Demuxer* demuxer;
+
+    if (DemuxSourceOpenFile(&source, path) < 0) {
+        printf("[latency] %s: can't open, skipped\n", path);
+        return;
+    }
+    demuxer = DemuxerOpen(source, NULL);
+    if (demuxer == NULL) {
+        printf("[latency] %s: unknown format, skipped\n", path);
+        DemuxSourceCloseFile(&source);
+        return;
+    }
+    TestSeekLatency(path, demuxer);
+    delete demuxer;
+    DemuxSourceCloseFile(&source);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestDemuxer demuxer(TEST_FRAME_US, false);
+    int failed = 0, i;
+
+    failed += TestNormal();
+    failed += TestAccurateSeek();
+    failed += TestForward();
+    failed += TestBackward();
+    failed += TestRateMapping();
+    failed += TestStretch();
+
+    TestSeekLatency("synthetic", &demuxer);
+    if (argc > 1) {
+        for (i = 1; i < argc; i++)
+            TestMediaLatency(argv[i]);
+    } else {
+        TestMediaLatency("cuc_ieschool.flv");
+    }
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
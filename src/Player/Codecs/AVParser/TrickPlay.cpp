@@ -0,0 +1,203 @@
+/**
+ *  TrickPlay.cpp文件
+ *  快进快退和精确 seek；
+ *  主要有以下部分：
+ *      1. 0.5x ~ 2x：所有帧都解码，播放时间按倍速换算，音频由 AudioTimeStretch 变速
+ *      2. 2x 以上前进：只输出关键帧，相邻两帧至少相隔 N * 125ms；跨度大时用 seek 索引直接跳过中间的 GOP
+ *      3. 后退：输出一个关键帧后 seek 到它之前 N * 125ms，取 seek 之后的第一个关键帧；
+ *         seek 索引的粒度太粗又回到同一个关键帧时，逐步往前退
+ *      4. 精确 seek：解复用 seek 到目标之前的关键帧，目标之前的视频只解码不显示，音频丢弃
+ *
+ **/
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "LogPlayer.h"
+#include "TrickPlay.h"
+
+
+TrickPlayControl::TrickPlayControl()
+    : m_rate(TRICKPLAY_RATE_NORMAL)
+    , m_keyframeOnly(false)
+    , m_mediaBaseUs(0)
+    , m_playBaseUs(0)
+    , m_targetUs(-1)
+    , m_lastUs(-1)
+    , m_seekUs(0)
+    , m_jumped(false)
+    , m_needSeek(false)
+{
+}
+
+bool TrickPlayControl::isSupported(int rate)
+{
+    if (rate > 0)
+        return rate >= TRICKPLAY_RATE_MIN && rate <= TRICKPLAY_RATE_MAX;
+    return rate <= -TRICKPLAY_RATE_STRETCH_MAX && rate >= -TRICKPLAY_RATE_MAX;
+}
+
+int TrickPlayControl::setRate(int rate)
+{
+    if (!isSupported(rate)) {
+        playerLogWarning("trick play: rate [%d%%] not supported.\n", rate);
+        return -1;
+    }
+    m_rate = rate;
+    m_keyframeOnly = (rate < 0 || rate > TRICKPLAY_RATE_STRETCH_MAX);
+    return 0;
+}
+
+void TrickPlayControl::seek(int64_t timeUs, bool accurate, int64_t playUs)
+{
+    m_mediaBaseUs = timeUs;
+    m_playBaseUs = playUs;
+    m_targetUs = (accurate && !m_keyframeOnly) ? timeUs : -1;
+    m_lastUs = -1;
+    m_seekUs = timeUs;
+    m_jumped = false;
+    m_needSeek = false;
+}
+
+int64_t TrickPlayControl::stepUs()
+{
+    return (int64_t)abs(m_rate) * TRICKPLAY_FRAME_INTERVAL_US / TRICKPLAY_RATE_NORMAL;
+}
+
+/* 后退时 seek 之后没有找到更前面的关键帧 */
+int TrickPlayControl::backOff()
+{
+    if (m_seekUs <= 0)
+        return TrickPlay_End;
+    m_seekUs = std::max(m_seekUs - std::max(stepUs(), (int64_t)TRICKPLAY_BACKOFF_US), (int64_t)0);
+    return TrickPlay_Seek;
+}
+
+int TrickPlayControl::filter(int streamType, int flags, int64_t ptsUs)
+{
+    bool video = (streamType == DemuxStream_Video);
+    bool keyframe = video && (flags & DemuxPacket_Keyframe) && ptsUs != DEMUX_TIMESTAMP_NONE;
+
+    if (!m_keyframeOnly) {
+        if (m_targetUs < 0 || ptsUs == DEMUX_TIMESTAMP_NONE)
+            return TrickPlay_Output;
+        if (!video)
+            return ptsUs < m_targetUs ? TrickPlay_Drop : TrickPlay_Output;
+        if (ptsUs < m_targetUs)
+            return TrickPlay_DecodeOnly;
+        if (ptsUs >= m_targetUs + TRICKPLAY_REORDER_US)
+            m_targetUs = -1;
+        return TrickPlay_Output;
+    }
+
+    if (m_rate > 0) {
+        if (!video)
+            return TrickPlay_Drop;
+        if (!keyframe) {
+            //GOP 内的帧：跨度大时直接 seek 到下一帧的位置，只 seek 一次，落在前面时顺序读过去
+            if (m_lastUs >= 0 && !m_jumped && stepUs() >= TRICKPLAY_FORWARD_SEEK_US) {
+                m_jumped = true;
+                m_seekUs = m_lastUs + stepUs();
+                return TrickPlay_Seek;
+            }
+            return TrickPlay_Drop;
+        }
+        if (m_lastUs >= 0 && ptsUs < (m_jumped ? m_lastUs + 1 : m_lastUs + stepUs()))
+            return TrickPlay_Drop;
+        m_lastUs = ptsUs;
+        m_jumped = false;
+        return TrickPlay_Output;
+    }
+
+    if (m_needSeek)
+        return onEnd();
+    if (!keyframe)
+        return TrickPlay_Drop;
+    if (m_lastUs >= 0 && ptsUs >= m_lastUs)
+        return backOff();
+    m_lastUs = ptsUs;
+    m_needSeek = true;
+    return TrickPlay_Output;
+}
+
+int TrickPlayControl::onEnd()
+{
+    if (!m_keyframeOnly || m_rate > 0)
+        return TrickPlay_End;
+    if (!m_needSeek)
+        return backOff();
+
+    if (m_lastUs <= 0)
+        return TrickPlay_End;
+    m_needSeek = false;
+    m_seekUs = std::max(m_lastUs - stepUs(), (int64_t)0);
+    return TrickPlay_Seek;
+}
+
+int64_t TrickPlayControl::toPlayUs(int64_t ptsUs)
+{
+    return m_playBaseUs + (ptsUs - m_mediaBaseUs) * TRICKPLAY_RATE_NORMAL / m_rate;
+}
+
+int64_t TrickPlayControl::toMediaUs(int64_t playUs)
+{
+    return m_mediaBaseUs + (playUs - m_playBaseUs) * m_rate / TRICKPLAY_RATE_NORMAL;
+}
+
+int64_t TrickPlayControl::toPlayDurationUs(int64_t durationUs)
+{
+    if (m_keyframeOnly)
+        return TRICKPLAY_FRAME_INTERVAL_US;
+    return durationUs * TRICKPLAY_RATE_NORMAL / m_rate;
+}
+
+
+int TrickPlayReadPacket(Demuxer* demuxer, TrickPlayControl* control, DemuxPacket** packet)
+{
+    const DemuxStreamInfo* stream;
+    DemuxPacket* current;
+    int result, action;
+
+    for (;;) {
+        result = demuxer->readPacket(&current);
+        if (result < 0)
+            return -1;
+        if (result > 0) {
+            action = control->onEnd();
+        } else {
+            stream = demuxer->getStream(current->streamIndex);
+            action = control->filter(stream ? stream->type : DemuxStream_Data, current->flags, current->ptsUs);
+            if (action == TrickPlay_Output || action == TrickPlay_DecodeOnly) {
+                if (action == TrickPlay_DecodeOnly)
+                    current->flags |= DemuxPacket_DecodeOnly;
+                *packet = current;
+                return 0;
+            }
+            DemuxPacketUnref(current);
+        }
+
+        if (action == TrickPlay_End)
+            return 1;
+        if (action != TrickPlay_Seek)
+            continue;
+        //前进跳过了结尾
+        if (demuxer->getDurationUs() > 0 && control->getSeekTargetUs() >= demuxer->getDurationUs())
+            return 1;
+        if (demuxer->seek(control->getSeekTargetUs()) < 0) {
+            playerLogWarning("trick play: %s seek to [%lld]us failed.\n", demuxer->getName(),
+                             (long long)control->getSeekTargetUs());
+            return -1;
+        }
+    }
+}
+
+int TrickPlaySeek(Demuxer* demuxer, TrickPlayControl* control, int64_t timeUs, bool accurate, int64_t playUs)
+{
+    int result = demuxer->seek(timeUs);
+
+    if (result < 0)
+        return result;
+    control->seek(timeUs, accurate, playUs);
+    return result;
+}
@@ -0,0 +1,105 @@
+#ifndef __TRICK_PLAY_H__
+#define __TRICK_PLAY_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include "Demuxer.h"
+
+
+#define     TRICKPLAY_RATE_NORMAL       100             //倍速以百分比表示，负数为后退
+#define     TRICKPLAY_RATE_MIN          50              //0.5x ~ 2x 全部解码，音频变速不变调
+#define     TRICKPLAY_RATE_STRETCH_MAX  200
+#define     TRICKPLAY_RATE_MAX          3200            //2x 以上和所有后退只解码关键帧，最高 32x
+#define     TRICKPLAY_FRAME_INTERVAL_US 125000          //只解码关键帧时最多每秒显示 8 帧，N 倍速每帧跨过 N * 125ms
+#define     TRICKPLAY_FORWARD_SEEK_US   2000000         //前进时每帧跨过的时间超过这么多，用 seek 跳过中间的数据
+#define     TRICKPLAY_BACKOFF_US        1000000         //后退时 seek 回到同一个关键帧，再往前退的最小距离
+#define     TRICKPLAY_REORDER_US        1000000         //精确 seek 时超过目标这么多以后不会再有目标之前的帧(B 帧重排)
+
+
+typedef enum {
+    TrickPlay_Drop = 0,
+    TrickPlay_Output,
+    TrickPlay_DecodeOnly,               //解码但不显示
+    TrickPlay_Seek,                     //调用者 seek 到 getSeekTargetUs()，之后继续读取
+    TrickPlay_End
+} TrickPlayAction;
+
+
+class TrickPlayControl { /* 快进快退和精确 seek 的决策：按读到的 packet 决定输出、只解码、丢弃还是再次 seek，不依赖具体的解复用 */
+    public:
+        TrickPlayControl();
+
+        /**
+         *  @Func: setRate
+         *         ps. :只改变模式，调用者随后 seek() 到当前位置，丢弃按旧倍速排队的数据
+         *  @Param: rate, type:: int, 百分比，50~200 或者 ±200~±3200
+         *  @Return: int, 0 成功，不支持的倍速返回 -1
+         *
+         **/
+        int setRate(int rate);
+        static bool isSupported(int rate);
+
+        /**
+         *  @Func: seek
+         *         ps. :调用者已经让解复用 seek 到 timeUs 之前的关键帧；重新开始映射播放时间，
+         *               timeUs 显示在 playUs；accurate 时目标之前的视频只解码、音频丢弃
+         *  @Param: timeUs, type:: int64_t, 媒体时间
+         *  @Param: accurate, type:: bool, 只解码关键帧时忽略
+         *  @Param: playUs, type:: int64_t, 播放时间，按实际时间 1x 走
+         *
+         **/
+        void seek(int64_t timeUs, bool accurate, int64_t playUs);
+
+        int filter(int streamType, int flags, int64_t ptsUs);  //DemuxStreamType、DemuxPacketFlag，返回 TrickPlayAction
+        int onEnd();                                            //读到结束：后退时继续往前 seek，否则 TrickPlay_End
+        int64_t getSeekTargetUs() { return m_seekUs; }
+
+        int getRate() { return m_rate; }
+        bool isKeyframeOnly() { return m_keyframeOnly; }
+        bool isAudioEnabled() { return !m_keyframeOnly; }
+
+        /* 媒体时间和播放时间互相换算：后退时媒体时间减小，播放时间仍然增加 */
+        int64_t toPlayUs(int64_t ptsUs);
+        int64_t toMediaUs(int64_t playUs);
+        int64_t toPlayDurationUs(int64_t durationUs);           //只解码关键帧时为每帧的显示间隔
+
+    private:
+        int64_t stepUs();
+        int backOff();
+
+        int                     m_rate;
+        bool                    m_keyframeOnly;
+        int64_t                 m_mediaBaseUs;
+        int64_t                 m_playBaseUs;
+        int64_t                 m_targetUs;         //精确 seek 的目标，-1 为没有
+        int64_t                 m_lastUs;           //最近输出的关键帧，-1 为 seek 之后还没有输出
+        int64_t                 m_seekUs;
+        bool                    m_jumped;           //前进：输出之后已经 seek 过一次
+        bool                    m_needSeek;         //后退：输出之后要 seek 到更前面
+};
+
+
+/**
+ *  @Func: TrickPlayReadPacket
+ *         ps. :按 TrickPlayControl 从 Demuxer 读取：丢弃不需要的 packet，需要时 seek，
+ *               目标之前的帧设置 DemuxPacket_DecodeOnly
+ *  @Param: demuxer, type:: Demuxer*
+ *  @Param: control, type:: TrickPlayControl*
+ *  @Param: packet, type:: DemuxPacket**, 使用完后 DemuxPacketUnref()
+ *  @Return: int, 0 成功，结束返回 1，出错或不支持 seek 返回 -1
+ *
+ **/
+int TrickPlayReadPacket(Demuxer* demuxer, TrickPlayControl* control, DemuxPacket** packet);
+
+/* Demuxer seek 之后 control->seek()，返回 Demuxer::seek() 的结果 */
+int TrickPlaySeek(Demuxer* demuxer, TrickPlayControl* control, int64_t timeUs, bool accurate, int64_t playUs);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__TRICK_PLAY_H__
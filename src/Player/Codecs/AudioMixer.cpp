@@ -0,0 +1,205 @@
+/**
+ *  AudioMixer.cpp文件
+ *  音频回调中的后处理；
+ *  主要有以下部分：
+ *      1. AudioGain：音量和静音都是 Q15 的目标增益，回调中每帧向目标靠近一步，20ms 内完成，满音量时不做乘法
+ *      2. AudioMixer：提示音在 play() 的线程中转换为输出格式并乘上自己的音量，回调中只做饱和加法(SSE2 一次 8 个)；
+ *         声部的状态只由一方修改：调用线程 FREE -> PLAYING，回调 PLAYING -> DONE，调用线程回收 DONE -> FREE
+ *
+ **/
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "AudioMixer.h"
+
+
+static inline int16_t MixerClip(int32_t value)
+{
+    if (value > 32767)
+        return 32767;
+    if (value < -32768)
+        return -32768;
+    return (int16_t)value;
+}
+
+static int32_t MixerVolumeToGain(int volume)
+{
+    if (volume <= 0)
+        return 0;
+    if (volume >= AUDIO_VOLUME_MAX)
+        return 32768;
+    return (int32_t)((int64_t)volume * volume * 32768 / (AUDIO_VOLUME_MAX * AUDIO_VOLUME_MAX));
+}
+
+static void MixerAdd(int16_t* output, const int16_t* input, int count)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i sum = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(output + i)),
+                                     _mm_loadu_si128((const __m128i*)(input + i)));
+        _mm_storeu_si128((__m128i*)(output + i), sum);
+    }
+#endif
+    for (; i < count; i++)
+        output[i] = MixerClip((int32_t)output[i] + input[i]);
+}
+
+
+AudioGain::AudioGain()
+    : m_channels(0)
+    , m_rampStep(32768)
+    , m_volume(AUDIO_VOLUME_MAX)
+    , m_mute(false)
+    , m_gain(32768)
+{
+}
+
+void AudioGain::open(int sampleRate, int channels)
+{
+    int frames = sampleRate * AUDIO_GAIN_RAMP_MS / 1000;
+
+    m_channels = channels;
+    m_rampStep = frames > 0 ? (32768 + frames - 1) / frames : 32768;
+    m_gain = m_mute ? 0 : MixerVolumeToGain(m_volume);
+}
+
+void AudioGain::setVolume(int volume)
+{
+    if (volume < 0)
+        volume = 0;
+    if (volume > AUDIO_VOLUME_MAX)
+        volume = AUDIO_VOLUME_MAX;
+    m_volume = volume;
+}
+
+void AudioGain::process(int16_t* samples, int frames)
+{
+    int32_t target = m_mute ? 0 : MixerVolumeToGain(m_volume);
+    int n, c;
+
+    if (m_channels <= 0)
+        return;
+    if (m_gain == target) {
+        if (target == 32768)
+            return;
+        if (target == 0) {
+            memset(samples, 0, frames * m_channels * sizeof(int16_t));
+            return;
+        }
+    }
+
+    for (n = 0; n < frames; n++) {
+        if (m_gain < target)
+            m_gain = m_gain + m_rampStep < target ? m_gain + m_rampStep : target;
+        else if (m_gain > target)
+            m_gain = m_gain - m_rampStep > target ? m_gain - m_rampStep : target;
+        for (c = 0; c < m_channels; c++, samples++)
+            *samples = (int16_t)(((int32_t)*samples * m_gain) >> 15);
+    }
+}
+
+
+AudioMixer::AudioMixer()
+    : m_sampleRate(0)
+    , m_channels(0)
+{
+    int i;
+
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        m_voices[i].position = 0;
+        m_voices[i].state = VOICE_FREE;
+        m_voices[i].stop = false;
+    }
+}
+
+int AudioMixer::open(int sampleRate, int channels)
+{
+    if (sampleRate <= 0 || channels <= 0 || channels > CHANNEL_MAP_MAX)
+        return -1;
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    return 0;
+}
+
+int AudioMixer::play(const int16_t* pcm, int frames, int sampleRate, int channels, int volume)
+{
+    AudioConverter converter;
+    Voice* voice = NULL;
+    int32_t gain = MixerVolumeToGain(volume);
+    int i;
+
+    if (m_channels <= 0 || pcm == NULL || frames <= 0 || (int64_t)frames * 1000 > (int64_t)sampleRate * AUDIO_MIXER_SOUND_MS_MAX)
+        return -1;
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (m_voices[i].state == VOICE_DONE) {
+            std::vector<int16_t>().swap(m_voices[i].data);
+            m_voices[i].state = VOICE_FREE;
+        }
+        if (voice == NULL && m_voices[i].state == VOICE_FREE)
+            voice = &m_voices[i];
+    }
+    if (voice == NULL || converter.open(sampleRate, channels, m_sampleRate, m_channels) < 0)
+        return -1;
+
+    voice->data.clear();
+    converter.process(pcm, frames, voice->data);
+    converter.flush(voice->data);
+    if (gain < 32768) {
+        for (i = 0; i < (int)voice->data.size(); i++)
+            voice->data[i] = (int16_t)(((int32_t)voice->data[i] * gain) >> 15);
+    }
+    voice->position = 0;
+    voice->stop = false;
+    __sync_synchronize();                       //先准备好数据再交给回调
+    voice->state = VOICE_PLAYING;
+    return 0;
+}
+
+void AudioMixer::stop()
+{
+    int i;
+
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++)
+        if (m_voices[i].state == VOICE_PLAYING)
+            m_voices[i].stop = true;
+}
+
+bool AudioMixer::isPlaying()
+{
+    int i;
+
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++)
+        if (m_voices[i].state == VOICE_PLAYING)
+            return true;
+    return false;
+}
+
+void AudioMixer::mix(int16_t* output, int frames)
+{
+    int i, count;
+
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        Voice* voice = &m_voices[i];
+
+        if (voice->state != VOICE_PLAYING)
+            continue;
+        __sync_synchronize();
+        count = (int)voice->data.size() - voice->position;
+        if (count > frames * m_channels)
+            count = frames * m_channels;
+        if (!voice->stop && count > 0) {
+            MixerAdd(output, &voice->data[voice->position], count);
+            voice->position += count;
+        }
+        if (voice->stop || voice->position >= (int)voice->data.size()) {
+            __sync_synchronize();
+            voice->state = VOICE_DONE;
+        }
+    }
+}
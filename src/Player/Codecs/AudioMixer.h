@@ -0,0 +1,84 @@
+#ifndef __AUDIO_MIXER_H__
+#define __AUDIO_MIXER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+#include "AudioResampler.h"
+
+
+#define     AUDIO_VOLUME_MAX            100
+#define     AUDIO_GAIN_RAMP_MS          20          //音量和静音的渐变时间，避免爆音
+#define     AUDIO_MIXER_VOICES          8           //同时叠加的提示音
+#define     AUDIO_MIXER_SOUND_MS_MAX    10000       //提示音的最大时长
+
+
+class AudioGain { /* 主音量和静音：Q15 增益，控制线程只改目标值，音频回调中逐帧渐变到目标 */
+    public:
+        AudioGain();
+
+        void open(int sampleRate, int channels);
+        void setVolume(int volume);                 //0~AUDIO_VOLUME_MAX，按平方换算，听感上比线性均匀
+        int getVolume() { return m_volume; }
+        void setMute(bool mute) { m_mute = mute; }
+        bool getMute() { return m_mute; }
+        void process(int16_t* samples, int frames); //音频回调中调用
+
+    private:
+        int                     m_channels;
+        int                     m_rampStep;         //每帧的最大变化
+        volatile int            m_volume;
+        volatile bool           m_mute;
+        int32_t                 m_gain;             //当前增益，只在回调中修改
+};
+
+
+class AudioMixer { /* 在节目音频上叠加提示音：调用线程转换为输出格式后放进空闲的声部，回调中饱和相加，播放完由调用线程回收 */
+    public:
+        AudioMixer();
+
+        int open(int sampleRate, int channels);     //输出格式，0 成功
+
+        /**
+         *  @Func: play
+         *         ps. :在控制线程中调用(同一时间只有一个线程)，转换格式在调用线程完成，回调中只做加法
+         *  @Param: pcm, type:: const int16_t*, S16 交织
+         *  @Param: frames, type:: int
+         *  @Param: sampleRate, type:: int
+         *  @Param: channels, type:: int
+         *  @Param: volume, type:: int, 0~AUDIO_VOLUME_MAX，相对节目音频，之后还要经过主音量
+         *  @Return: int, 0 成功，声部都在使用或参数错误返回 -1
+         *
+         **/
+        int play(const int16_t* pcm, int frames, int sampleRate, int channels, int volume);
+        void stop();                                //停止所有提示音，回调中下一次结束
+        bool isPlaying();
+        void mix(int16_t* output, int frames);      //音频回调中调用，叠加到 output 上
+
+    private:
+        enum { VOICE_FREE, VOICE_PLAYING, VOICE_DONE };
+
+        typedef struct _Voice {
+            std::vector<int16_t>    data;           //输出格式
+            int                     position;       //回调中修改
+            volatile int            state;          //FREE 和 DONE 属于调用线程，PLAYING 属于回调
+            volatile bool           stop;
+        } Voice;
+
+        AudioMixer(const AudioMixer&);
+        AudioMixer& operator=(const AudioMixer&);
+
+        int                     m_sampleRate;
+        int                     m_channels;
+        Voice                   m_voices[AUDIO_MIXER_VOICES];
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__AUDIO_MIXER_H__
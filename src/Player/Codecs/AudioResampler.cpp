@@ -0,0 +1,396 @@
+/**
+ *  AudioResampler.cpp文件
+ *  音频重采样和声道数转换；
+ *  主要有以下部分：
+ *      1. 滤波器：Kaiser 窗的 sinc，截止频率按两边较低的采样率，每个相位归一化为 Q15 后直流增益为 1；
+ *         输出/输入化简后的分母不大时每个相位对应精确的位置(44.1k->48k 为 320 个相位)，否则取 1/256 采样的最近相位
+ *      2. 位置：整数的输入位置加 16 位小数的相位，长时间没有累计误差；微调(skew)只改变每个输出前进的相位数
+ *      3. 计算：输入拆成单声道连续存放，点积用 SSE2 的 pmaddwd 一次 8 个，没有 SSE2 时用 C 实现
+ *      4. 声道：按声道数推断布局(ffmpeg 的默认顺序)，下混系数按 ITU-R BS.775，每行归一化避免削波
+ *
+ **/
+
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "AudioResampler.h"
+
+
+#define     RESAMPLER_HALF              (RESAMPLER_TAPS / 2)
+
+
+static int ResamplerGcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* 第一类零阶修正贝塞尔函数，Kaiser 窗使用 */
+static double ResamplerBesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+static inline int16_t ResamplerClip(int32_t value)
+{
+    if (value > 32767)
+        return 32767;
+    if (value < -32768)
+        return -32768;
+    return (int16_t)value;
+}
+
+/* 系数的绝对值之和不超过 1.3 倍 Q15，累加不会溢出 32 位 */
+static inline int32_t ResamplerDot(const int16_t* samples, const int16_t* taps)
+{
+#if defined(__SSE2__)
+    __m128i sum = _mm_setzero_si128();
+    int i;
+
+    for (i = 0; i < RESAMPLER_TAPS; i += 8)
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(samples + i)),
+                                                _mm_loadu_si128((const __m128i*)(taps + i))));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    int i;
+
+    for (i = 0; i < RESAMPLER_TAPS; i++)
+        sum += (int32_t)samples[i] * taps[i];
+    return sum;
+#endif
+}
+
+
+AudioResampler::AudioResampler()
+    : m_inRate(0)
+    , m_outRate(0)
+    , m_channels(0)
+    , m_skew(0)
+    , m_bypass(true)
+    , m_phases(1)
+    , m_step(0)
+    , m_phase(0)
+    , m_index(0)
+{
+}
+
+int AudioResampler::open(int inRate, int outRate, int channels)
+{
+    int gcd;
+
+    if (inRate <= 0 || outRate <= 0 || channels <= 0 || channels > CHANNEL_MAP_MAX)
+        return -1;
+    m_inRate = inRate;
+    m_outRate = outRate;
+    m_channels = channels;
+    m_skew = 0;
+
+    /* 精确比例时相位数取分母的倍数，至少 RESAMPLER_PHASES_DEFAULT 个，微调时也有足够的精度 */
+    gcd = ResamplerGcd(inRate, outRate);
+    m_phases = outRate / gcd;
+    if (m_phases > RESAMPLER_PHASES_MAX)
+        m_phases = RESAMPLER_PHASES_DEFAULT;
+    else
+        m_phases *= (RESAMPLER_PHASES_DEFAULT + m_phases - 1) / m_phases;
+    buildFilter();
+    updateStep();
+    reset();
+    return 0;
+}
+
+void AudioResampler::buildFilter()
+{
+    double cutoff = RESAMPLER_CUTOFF * (m_outRate < m_inRate ? (double)m_outRate / m_inRate : 1.0);
+    double window = ResamplerBesselI0(RESAMPLER_KAISER_BETA);
+    double taps[RESAMPLER_TAPS], sum, distance, x, w;
+    int32_t total;
+    int phase, k, peak;
+
+    m_filter.resize(m_phases * RESAMPLER_TAPS);
+    for (phase = 0; phase < m_phases; phase++) {
+        sum = 0;
+        for (k = 0; k < RESAMPLER_TAPS; k++) {
+            /* 第 k 个抽头的输入到输出位置的距离，范围 [-HALF, HALF] */
+            distance = k - RESAMPLER_HALF + 1 - (double)phase / m_phases;
+            x = distance / RESAMPLER_HALF;
+            w = 1.0 - x * x;
+            w = w > 0 ? ResamplerBesselI0(RESAMPLER_KAISER_BETA * sqrt(w)) / window : 0;
+            x = M_PI * cutoff * distance;
+            taps[k] = cutoff * (fabs(x) < 1e-9 ? 1.0 : sin(x) / x) * w;
+            sum += taps[k];
+        }
+
+        /* 取整的误差加到最大的抽头上，保证直流增益精确为 1 */
+        total = 0;
+        peak = 0;
+        for (k = 0; k < RESAMPLER_TAPS; k++) {
+            m_filter[phase * RESAMPLER_TAPS + k] = ResamplerClip((int32_t)floor(taps[k] / sum * 32768.0 + 0.5));
+            total += m_filter[phase * RESAMPLER_TAPS + k];
+            if (taps[k] > taps[peak])
+                peak = k;
+        }
+        m_filter[phase * RESAMPLER_TAPS + peak] = ResamplerClip(m_filter[phase * RESAMPLER_TAPS + peak] + 32768 - total);
+    }
+}
+
+void AudioResampler::updateStep()
+{
+    double step = (double)m_inRate * m_phases / m_outRate * 65536.0;
+
+    m_step = (int64_t)floor(step * (1000000.0 + m_skew) / 1000000.0 + 0.5);
+    m_bypass = (m_inRate == m_outRate && m_skew == 0);
+}
+
+int AudioResampler::setSkew(int ppm)
+{
+    if (m_channels <= 0 || ppm < -RESAMPLER_SKEW_MAX || ppm > RESAMPLER_SKEW_MAX)
+        return -1;
+    m_skew = ppm;
+    updateStep();
+    return 0;
+}
+
+void AudioResampler::reset()
+{
+    int c;
+
+    /* 前面补 HALF - 1 帧静音，第一个输出正好对准第一个输入 */
+    for (c = 0; c < CHANNEL_MAP_MAX; c++)
+        m_planes[c].assign(c < m_channels ? RESAMPLER_HALF - 1 : 0, 0);
+    m_index = 0;
+    m_phase = 0;
+}
+
+int AudioResampler::process(const int16_t* input, int frames, std::vector<int16_t>& output)
+{
+    int64_t period = (int64_t)m_phases << 16;
+    int available, start, produced = 0, base, i, c;
+
+    if (m_channels <= 0 || frames < 0)
+        return 0;
+
+    if (m_bypass) {
+        /* 刚从微调切换回来时，还没有输出的输入从最近的位置接着输出 */
+        available = (int)m_planes[0].size();
+        start = m_index + RESAMPLER_HALF - 1 + (m_phase * 2 >= period ? 1 : 0);
+        base = (int)output.size();
+        if (start < available) {
+            output.resize(base + (available - start) * m_channels);
+            for (i = start; i < available; i++)
+                for (c = 0; c < m_channels; c++)
+                    output[base + (i - start) * m_channels + c] = m_planes[c][i];
+            produced = available - start;
+        }
+        output.insert(output.end(), input, input + frames * m_channels);
+        produced += frames;
+
+        /* 只保留最后 HALF - 1 帧，切换到滤波时作为历史 */
+        for (c = 0; c < m_channels; c++) {
+            std::vector<int16_t>& plane = m_planes[c];
+            for (i = 0; i < frames; i++)
+                plane.push_back(input[i * m_channels + c]);
+            if ((int)plane.size() > RESAMPLER_HALF - 1)
+                plane.erase(plane.begin(), plane.end() - (RESAMPLER_HALF - 1));
+        }
+        m_index = 0;
+        m_phase = 0;
+        return produced;
+    }
+
+    for (c = 0; c < m_channels; c++) {
+        std::vector<int16_t>& plane = m_planes[c];
+        base = (int)plane.size();
+        plane.resize(base + frames);
+        for (i = 0; i < frames; i++)
+            plane[base + i] = input[i * m_channels + c];
+    }
+    available = (int)m_planes[0].size();
+
+    /* 先按上限分配，最后截掉多余的部分 */
+    base = (int)output.size();
+    if (available - m_index >= RESAMPLER_TAPS)
+        output.resize(base + (int)(((int64_t)(available - m_index - RESAMPLER_TAPS + 1) * period) / m_step + 2) * m_channels);
+    while (m_index + RESAMPLER_TAPS <= available) {
+        const int16_t* taps = &m_filter[(int)(m_phase >> 16) * RESAMPLER_TAPS];
+        for (c = 0; c < m_channels; c++)
+            output[base + c] = ResamplerClip((ResamplerDot(&m_planes[c][m_index], taps) + (1 << 14)) >> 15);
+        base += m_channels;
+        produced++;
+
+        m_phase += m_step;
+        if (m_phase >= period) {
+            m_index += (int)(m_phase / period);
+            m_phase %= period;
+        }
+    }
+    output.resize(base);
+
+    /* 丢弃不再需要的输入；下一个输出可能已经跳过了全部输入(降采样) */
+    start = m_index < available ? m_index : available;
+    for (c = 0; c < m_channels; c++)
+        m_planes[c].erase(m_planes[c].begin(), m_planes[c].begin() + start);
+    m_index -= start;
+    return produced;
+}
+
+int AudioResampler::flush(std::vector<int16_t>& output)
+{
+    std::vector<int16_t> silence(RESAMPLER_TAPS * m_channels, 0);
+    int64_t period = (int64_t)m_phases << 16;
+    int end, produced = 0, frames;
+
+    if (m_channels <= 0)
+        return 0;
+    if (!m_bypass) {
+        /* 只输出位置在最后一个输入之前的部分 */
+        end = (int)m_planes[0].size();
+        frames = (int)(((int64_t)(end - (m_index + RESAMPLER_HALF - 1)) * period - m_phase + m_step - 1) / m_step);
+        if (frames > 0) {
+            std::vector<int16_t> tail;
+            process(&silence[0], RESAMPLER_TAPS, tail);
+            if (frames > (int)tail.size() / m_channels)
+                frames = (int)tail.size() / m_channels;
+            output.insert(output.end(), tail.begin(), tail.begin() + frames * m_channels);
+            produced = frames;
+        }
+    }
+    reset();
+    return produced;
+}
+
+
+AudioChannelMap::AudioChannelMap()
+    : m_inChannels(0)
+    , m_outChannels(0)
+{
+    memset(m_matrix, 0, sizeof(m_matrix));
+}
+
+int AudioChannelMap::open(int inChannels, int outChannels)
+{
+    /* 按声道数推断布局：L R C LFE Ls Rs 的顺序，和 ffmpeg 的默认布局一致 */
+    enum { ROLE_L, ROLE_R, ROLE_C, ROLE_LFE, ROLE_LS, ROLE_RS, ROLE_CS };
+    static const int roles[CHANNEL_MAP_MAX][CHANNEL_MAP_MAX] = {
+        { ROLE_C },
+        { ROLE_L, ROLE_R },
+        { ROLE_L, ROLE_R, ROLE_C },
+        { ROLE_L, ROLE_R, ROLE_LS, ROLE_RS },
+        { ROLE_L, ROLE_R, ROLE_C, ROLE_LS, ROLE_RS },
+        { ROLE_L, ROLE_R, ROLE_C, ROLE_LFE, ROLE_LS, ROLE_RS },
+        { ROLE_L, ROLE_R, ROLE_C, ROLE_LFE, ROLE_CS, ROLE_LS, ROLE_RS },
+        { ROLE_L, ROLE_R, ROLE_C, ROLE_LFE, ROLE_LS, ROLE_RS, ROLE_LS, ROLE_RS },
+    };
+    const double center = 0.70710678;
+    double matrix[CHANNEL_MAP_MAX][CHANNEL_MAP_MAX], row, peak;
+    int o, i;
+
+    if (inChannels <= 0 || inChannels > CHANNEL_MAP_MAX || outChannels <= 0 || outChannels > CHANNEL_MAP_MAX)
+        return -1;
+    m_inChannels = inChannels;
+    m_outChannels = outChannels;
+    memset(matrix, 0, sizeof(matrix));
+
+    if (outChannels <= 2 && inChannels > 1) {
+        /* 先下混到立体声，LFE 不参与 */
+        for (i = 0; i < inChannels; i++) {
+            switch (roles[inChannels - 1][i]) {
+                case ROLE_L:    matrix[0][i] = 1.0; break;
+                case ROLE_R:    matrix[1][i] = 1.0; break;
+                case ROLE_C:    matrix[0][i] = matrix[1][i] = center; break;
+                case ROLE_LS:   matrix[0][i] = center; break;
+                case ROLE_RS:   matrix[1][i] = center; break;
+                case ROLE_CS:   matrix[0][i] = matrix[1][i] = 0.5; break;
+                default:        break;
+            }
+        }
+        if (outChannels == 1) {
+            for (i = 0; i < inChannels; i++)
+                matrix[0][i] = (matrix[0][i] + matrix[1][i]) / 2;
+        }
+    } else if (inChannels == 1) {
+        /* 单声道放在前两个声道 */
+        for (o = 0; o < outChannels && o < 2; o++)
+            matrix[o][0] = 1.0;
+    } else {
+        for (o = 0; o < outChannels && o < inChannels; o++)
+            matrix[o][o] = 1.0;
+    }
+
+    /* 所有声道同时满幅时也不削波 */
+    peak = 1.0;
+    for (o = 0; o < outChannels; o++) {
+        row = 0;
+        for (i = 0; i < inChannels; i++)
+            row += matrix[o][i];
+        if (row > peak)
+            peak = row;
+    }
+    for (o = 0; o < CHANNEL_MAP_MAX; o++)
+        for (i = 0; i < CHANNEL_MAP_MAX; i++)
+            m_matrix[o][i] = (int32_t)floor(matrix[o][i] / peak * 16384.0 + 0.5);
+    return 0;
+}
+
+void AudioChannelMap::process(const int16_t* input, int frames, int16_t* output)
+{
+    int32_t sum;
+    int n, o, i;
+
+    if (isBypass()) {
+        memcpy(output, input, frames * m_inChannels * sizeof(int16_t));
+        return;
+    }
+    for (n = 0; n < frames; n++) {
+        for (o = 0; o < m_outChannels; o++) {
+            sum = 0;
+            for (i = 0; i < m_inChannels; i++)
+                sum += m_matrix[o][i] * input[i];
+            output[o] = ResamplerClip((sum + (1 << 13)) >> 14);
+        }
+        input += m_inChannels;
+        output += m_outChannels;
+    }
+}
+
+
+AudioConverter::AudioConverter()
+{
+}
+
+int AudioConverter::open(int inRate, int inChannels, int outRate, int outChannels)
+{
+    if (m_channelMap.open(inChannels, outChannels) < 0)
+        return -1;
+    return m_resampler.open(inRate, outRate, outChannels);
+}
+
+int AudioConverter::process(const int16_t* input, int frames, std::vector<int16_t>& output)
+{
+    if (frames <= 0)
+        return 0;
+    if (m_channelMap.isBypass())
+        return m_resampler.process(input, frames, output);
+    m_mapped.resize(frames * CHANNEL_MAP_MAX);
+    m_channelMap.process(input, frames, &m_mapped[0]);
+    return m_resampler.process(&m_mapped[0], frames, output);
+}
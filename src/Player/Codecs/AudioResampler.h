@@ -0,0 +1,104 @@
+#ifndef __AUDIO_RESAMPLER_H__
+#define __AUDIO_RESAMPLER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     RESAMPLER_TAPS              32          //每个相位的抽头数，SIMD 每次 8 个，必须是 8 的倍数
+#define     RESAMPLER_PHASES_MAX        640         //输出/输入化简后的分母不超过这个时按精确的有理数比例
+#define     RESAMPLER_PHASES_DEFAULT    256         //相位数的下限；比例不精确时按 1/256 采样取最近的相位
+#define     RESAMPLER_CUTOFF            0.95        //通带截止，相对两边较低的奈奎斯特频率
+#define     RESAMPLER_KAISER_BETA       8.0         //阻带约 -80dB
+#define     RESAMPLER_SKEW_MAX          5000        //百万分之一，时钟同步时的微调范围
+#define     CHANNEL_MAP_MAX             8
+
+
+class AudioResampler { /* 多相 FIR 重采样：S16 交织输入先拆成单声道，每个输出按相位取一组 Q15 系数做点积，有 SSE2 时 8 个一组 */
+    public:
+        AudioResampler();
+
+        int open(int inRate, int outRate, int channels);    //0 成功，采样率相同时直接复制
+        void reset();                                       //seek 之后调用，丢弃缓冲的输入
+
+        /**
+         *  @Func: setSkew
+         *         ps. :输入按 (1 + ppm / 1000000) 倍的速度消耗，正数输出变短；用于和外部时钟同步的微调，
+         *               非 0 时采样率相同也要经过滤波器
+         *  @Param: ppm, type:: int, 范围 ±RESAMPLER_SKEW_MAX
+         *  @Return: int, 0 成功
+         *
+         **/
+        int setSkew(int ppm);
+        int getSkew() { return m_skew; }
+
+        /**
+         *  @Func: process
+         *         ps. :输出和输入按时间对齐，没有延时；最后 RESAMPLER_TAPS / 2 帧输入要等后面的数据或 flush()
+         *  @Param: input, type:: const int16_t*
+         *  @Param: frames, type:: int, 每帧 channels 个采样
+         *  @Param: output, type:: std::vector<int16_t>&, 结果追加在后面
+         *  @Return: int, 追加的帧数
+         *
+         **/
+        int process(const int16_t* input, int frames, std::vector<int16_t>& output);
+        int flush(std::vector<int16_t>& output);            //补静音输出剩下的输入
+
+    private:
+        void buildFilter();
+        void updateStep();
+
+        int                         m_inRate;
+        int                         m_outRate;
+        int                         m_channels;
+        int                         m_skew;
+        bool                        m_bypass;
+        int                         m_phases;
+        std::vector<int16_t>        m_filter;           //m_phases 组，每组 RESAMPLER_TAPS 个 Q15 系数
+        int64_t                     m_step;             //每个输出前进的相位数，16 位小数
+        int64_t                     m_phase;            //当前输出在 m_index 之后的相位，16 位小数
+        int                         m_index;            //当前输出第一个抽头在 m_planes 中的位置
+        std::vector<int16_t>        m_planes[CHANNEL_MAP_MAX];  //每个声道还需要的输入
+};
+
+
+class AudioChannelMap { /* 声道数转换：多声道按 ITU 系数下混到立体声或单声道，单声道复制到两边，其他情况按顺序对应；Q14 系数 */
+    public:
+        AudioChannelMap();
+
+        int open(int inChannels, int outChannels);          //声道数 1~CHANNEL_MAP_MAX，0 成功
+        bool isBypass() { return m_inChannels == m_outChannels; }
+        void process(const int16_t* input, int frames, int16_t* output);   //output 为 frames * outChannels
+
+    private:
+        int                         m_inChannels;
+        int                         m_outChannels;
+        int32_t                     m_matrix[CHANNEL_MAP_MAX][CHANNEL_MAP_MAX];    //[输出][输入]
+};
+
+
+class AudioConverter { /* 解码输出转换为设备格式：先转换声道数(多声道下混时减少重采样的计算)，再重采样 */
+    public:
+        AudioConverter();
+
+        int open(int inRate, int inChannels, int outRate, int outChannels);
+        void reset() { m_resampler.reset(); }
+        int setSkew(int ppm) { return m_resampler.setSkew(ppm); }
+        int process(const int16_t* input, int frames, std::vector<int16_t>& output);   //追加，返回帧数
+        int flush(std::vector<int16_t>& output) { return m_resampler.flush(output); }
+
+    private:
+        AudioChannelMap             m_channelMap;
+        AudioResampler              m_resampler;
+        std::vector<int16_t>        m_mapped;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__AUDIO_RESAMPLER_H__
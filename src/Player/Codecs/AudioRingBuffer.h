@@ -0,0 +1,128 @@
+#ifndef __AUDIO_RING_BUFFER_H__
+#define __AUDIO_RING_BUFFER_H__
+
+
+#ifdef __cplusplus
+
+#include <string.h>
+
+
+/**
+ *  AudioRingBuffer
+ *      单生产者单消费者的字节环形缓冲：解码线程写，音频回调读；
+ *      读写位置各自只由一方修改，只用内存屏障，不加锁、不分配内存，回调里不会因为解码线程而阻塞；
+ *      writeRecord() 把头和数据一次发布，读方看到头时数据一定已经完整
+ *
+ **/
+class AudioRingBuffer {
+    public:
+        AudioRingBuffer() : m_data(NULL), m_capacity(0), m_read(0), m_write(0) {}
+        ~AudioRingBuffer() { delete[] m_data; }
+
+        /* 容量向上取 2 的幂，0 成功；只能在两边都没有使用时调用 */
+        int open(int capacity)
+        {
+            unsigned int size = 1;
+
+            if (capacity <= 0)
+                return -1;
+            while (size < (unsigned int)capacity)
+                size <<= 1;
+            delete[] m_data;
+            m_data = new unsigned char[size];
+            m_capacity = size;
+            m_read = m_write = 0;
+            return 0;
+        }
+
+        void close()
+        {
+            delete[] m_data;
+            m_data = NULL;
+            m_capacity = 0;
+            m_read = m_write = 0;
+        }
+
+        /* 丢弃所有数据，只能在两边都没有使用时调用 */
+        void reset() { m_read = m_write = 0; }
+
+        int capacity() { return (int)m_capacity; }
+        int readable() { return (int)(m_write - m_read); }
+        int writable() { return (int)(m_capacity - (m_write - m_read)); }
+
+        /* 空间不够时什么都不写，返回 false */
+        bool writeRecord(const void* header, int headerSize, const void* data, int size)
+        {
+            unsigned int write = m_write;
+
+            if (headerSize + size > writable())
+                return false;
+            copyIn(write, header, headerSize);
+            copyIn(write + headerSize, data, size);
+            __sync_synchronize();               //先写数据再发布 m_write
+            m_write = write + headerSize + size;
+            return true;
+        }
+
+        bool write(const void* data, int size) { return writeRecord(NULL, 0, data, size); }
+
+        /* 最多读 size 字节，data 为 NULL 时只丢弃，返回实际的字节数 */
+        int read(void* data, int size)
+        {
+            unsigned int read = m_read;
+            int available = (int)(m_write - read);
+
+            if (size > available)
+                size = available;
+            if (size <= 0)
+                return 0;
+            __sync_synchronize();
+            if (data)
+                copyOut(read, data, size);
+            __sync_synchronize();               //读完数据才释放空间
+            m_read = read + size;
+            return size;
+        }
+
+        int skip(int size) { return read(NULL, size); }
+
+    private:
+        AudioRingBuffer(const AudioRingBuffer&);
+        AudioRingBuffer& operator=(const AudioRingBuffer&);
+
+        void copyIn(unsigned int position, const void* data, int size)
+        {
+            unsigned int offset = position & (m_capacity - 1);
+            unsigned int first = m_capacity - offset;
+
+            if (size <= 0)
+                return;
+            if (first > (unsigned int)size)
+                first = size;
+            memcpy(m_data + offset, data, first);
+            memcpy(m_data, (const unsigned char*)data + first, size - first);
+        }
+
+        void copyOut(unsigned int position, void* data, int size)
+        {
+            unsigned int offset = position & (m_capacity - 1);
+            unsigned int first = m_capacity - offset;
+
+            if (first > (unsigned int)size)
+                first = size;
+            memcpy(data, m_data + offset, first);
+            memcpy((unsigned char*)data + first, m_data, size - first);
+        }
+
+        unsigned char*              m_data;
+        unsigned int                m_capacity;
+        volatile unsigned int       m_read;     //只由读方修改，回绕由无符号减法处理
+        volatile unsigned int       m_write;    //只由写方修改
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__AUDIO_RING_BUFFER_H__
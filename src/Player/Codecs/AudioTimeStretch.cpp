@@ -0,0 +1,170 @@
+/**
+ *  AudioTimeStretch.cpp文件
+ *  音频变速不变调(WSOLA)；
+ *  主要有以下部分：
+ *      1. 每次输出 40ms 的一段，名义上输入前进 30ms * 倍速，输出前进 30ms，所以时长变为 1/倍速
+ *      2. 下一段在名义位置之后 15ms 内找与上一段结尾波形最相似的位置(归一化互相关，隔一个采样计算)，
+ *         避免相位跳变；两段之间 10ms 线性交叉淡化
+ *      3. 只用整数采样，名义位置的小数部分累计在 m_remainder 中，长时间播放没有漂移
+ *
+ **/
+
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "AudioTimeStretch.h"
+
+
+#define     STRETCH_RATE_NORMAL         100
+
+
+AudioTimeStretch::AudioTimeStretch()
+    : m_sampleRate(0)
+    , m_channels(0)
+    , m_rate(STRETCH_RATE_NORMAL)
+    , m_sequence(0)
+    , m_overlap(0)
+    , m_seek(0)
+    , m_position(0)
+    , m_remainder(0)
+{
+}
+
+int AudioTimeStretch::open(int sampleRate, int channels)
+{
+    if (sampleRate <= 0 || channels <= 0)
+        return -1;
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_sequence = sampleRate * STRETCH_SEQUENCE_MS / 1000;
+    m_overlap = sampleRate * STRETCH_OVERLAP_MS / 1000;
+    m_seek = sampleRate * STRETCH_SEEK_MS / 1000;
+    if (m_overlap < 1)
+        m_overlap = 1;
+    if (m_sequence < m_overlap * 3)
+        m_sequence = m_overlap * 3;
+    if (m_seek < 1)
+        m_seek = 1;
+    reset();
+    return 0;
+}
+
+int AudioTimeStretch::setRate(int rate)
+{
+    if (rate < STRETCH_RATE_MIN || rate > STRETCH_RATE_MAX)
+        return -1;
+    if (rate != m_rate)
+        reset();
+    m_rate = rate;
+    return 0;
+}
+
+void AudioTimeStretch::reset()
+{
+    m_input.clear();
+    m_tail.clear();
+    m_reference.clear();
+    m_position = 0;
+    m_remainder = 0;
+}
+
+int AudioTimeStretch::findBestOffset(const int16_t* input)
+{
+    double score, bestScore = -1e300;
+    int64_t correlation, energy;
+    int32_t mono;
+    int offset, i, c, best = 0;
+
+    for (offset = 0; offset < m_seek; offset++) {
+        correlation = 0;
+        energy = 0;
+        for (i = 0; i < m_overlap; i += 2) {
+            const int16_t* sample = input + (offset + i) * m_channels;
+            mono = 0;
+            for (c = 0; c < m_channels; c++)
+                mono += sample[c];
+            correlation += (int64_t)mono * m_reference[i];
+            energy += (int64_t)mono * mono;
+        }
+        score = (double)correlation / sqrt((double)energy + 1.0);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+void AudioTimeStretch::crossFade(const int16_t* input, std::vector<int16_t>& output)
+{
+    int i, c;
+
+    for (i = 0; i < m_overlap; i++) {
+        for (c = 0; c < m_channels; c++) {
+            int index = i * m_channels + c;
+            output.push_back((int16_t)(((int32_t)m_tail[index] * (m_overlap - i) + (int32_t)input[index] * i) / m_overlap));
+        }
+    }
+}
+
+int AudioTimeStretch::process(const int16_t* input, int frames, std::vector<int16_t>& output)
+{
+    const int16_t* base;
+    int produced = 0, consumed, offset, step, i, c;
+
+    if (m_channels <= 0 || frames <= 0)
+        return 0;
+    if (m_rate == STRETCH_RATE_NORMAL) {
+        output.insert(output.end(), input, input + frames * m_channels);
+        return frames;
+    }
+
+    m_input.insert(m_input.end(), input, input + frames * m_channels);
+    while ((int)(m_input.size() / m_channels) >= m_position + m_seek + m_sequence) {
+        base = &m_input[m_position * m_channels];
+        if (m_tail.empty()) {
+            offset = 0;
+            output.insert(output.end(), base, base + (m_sequence - m_overlap) * m_channels);
+        } else {
+            offset = findBestOffset(base);
+            crossFade(base + offset * m_channels, output);
+            output.insert(output.end(), base + (offset + m_overlap) * m_channels,
+                          base + (offset + m_sequence - m_overlap) * m_channels);
+        }
+        produced += m_sequence - m_overlap;
+
+        m_tail.assign(base + (offset + m_sequence - m_overlap) * m_channels, base + (offset + m_sequence) * m_channels);
+        m_reference.resize(m_overlap);
+        for (i = 0; i < m_overlap; i++) {
+            m_reference[i] = 0;
+            for (c = 0; c < m_channels; c++)
+                m_reference[i] += m_tail[i * m_channels + c];
+        }
+
+        step = (m_sequence - m_overlap) * m_rate + m_remainder;
+        m_position += step / STRETCH_RATE_NORMAL;
+        m_remainder = step % STRETCH_RATE_NORMAL;
+    }
+
+    //2x 时名义位置可能超过已有的输入，多出的部分在下一次输入中跳过
+    consumed = std::min(m_position, (int)(m_input.size() / m_channels));
+    if (consumed > 0) {
+        m_input.erase(m_input.begin(), m_input.begin() + consumed * m_channels);
+        m_position -= consumed;
+    }
+    return produced;
+}
+
+int AudioTimeStretch::flush(std::vector<int16_t>& output)
+{
+    int frames = 0;
+
+    if (m_channels > 0) {
+        frames = m_tail.size() / m_channels;
+        output.insert(output.end(), m_tail.begin(), m_tail.end());
+    }
+    reset();
+    return frames;
+}
@@ -0,0 +1,61 @@
+#ifndef __AUDIO_TIME_STRETCH_H__
+#define __AUDIO_TIME_STRETCH_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <vector>
+
+
+#define     STRETCH_SEQUENCE_MS         40          //每次输出的一段
+#define     STRETCH_OVERLAP_MS          10          //相邻两段交叉淡化的长度
+#define     STRETCH_SEEK_MS             15          //找最相似位置的搜索范围
+#define     STRETCH_RATE_MIN            50          //百分比
+#define     STRETCH_RATE_MAX            200
+
+
+class AudioTimeStretch { /* WSOLA 变速不变调：按倍速跳过或重复输入，每段在搜索范围内找与上一段结尾最相似的位置再交叉淡化 */
+    public:
+        AudioTimeStretch();
+
+        int open(int sampleRate, int channels);     //S16 交织，0 成功
+        int setRate(int rate);                      //百分比 50~200，改变时丢弃缓冲的数据
+        int getRate() { return m_rate; }
+        void reset();                               //seek 之后调用，丢弃缓冲的数据
+
+        /**
+         *  @Func: process
+         *         ps. :输入不够一段时只缓存；100% 时直接复制
+         *  @Param: input, type:: const int16_t*
+         *  @Param: frames, type:: int, 每帧 channels 个采样
+         *  @Param: output, type:: std::vector<int16_t>&, 结果追加在后面
+         *  @Return: int, 追加的帧数
+         *
+         **/
+        int process(const int16_t* input, int frames, std::vector<int16_t>& output);
+        int flush(std::vector<int16_t>& output);   //输出最后一段的结尾，不足一段的输入丢弃
+
+    private:
+        int findBestOffset(const int16_t* input);
+        void crossFade(const int16_t* input, std::vector<int16_t>& output);
+
+        int                     m_sampleRate;
+        int                     m_channels;
+        int                     m_rate;
+        int                     m_sequence;         //以下都是帧数
+        int                     m_overlap;
+        int                     m_seek;
+        std::vector<int16_t>    m_input;            //还没有用完的输入
+        int                     m_position;         //下一段在 m_input 中的名义位置
+        int                     m_remainder;        //名义位置的小数部分，单位 1/100 帧
+        std::vector<int16_t>    m_tail;             //上一段的结尾，和下一段交叉淡化
+        std::vector<int32_t>    m_reference;        //m_tail 的单声道，搜索时使用
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__AUDIO_TIME_STRETCH_H__
@@ -14,6 +14,18 @@ purpose: ffmpeg
 
 #define SHOW_TITLE
 
+static const AVRational gMicrosecond = {1, 1000000};
+
+
+//  MediaClock ĵʱ䣬΢
+static int64_t RTSPPlayerNowUs()
+{
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
 
 const char* WcharToUtf8(const wchar_t *pwStr)
 {
@@ -43,7 +55,8 @@ CRTSPPlayer::CRTSPPlayer(HWND hWnd, LPRECT lpRect):
         m_nStreamIndex(-1),
         m_pFrameYUV(NULL),
         m_pFrameRGB(NULL),
-        m_pBufRGB(NULL),
+        m_pSurfaceRGB(NULL),
+        m_clock(MediaClockMode_Video),
         m_nPlayStatus(RTSP_PLAYSTATUS_NONE)
 {
     memset(m_strFilePath,0,sizeof(m_strFilePath));
@@ -75,6 +88,7 @@ void CRTSPPlayer::Play()
     if(GetPlayStatus() == RTSP_PLAYSTATUS_STOP){
         DecodeInit(m_strFilePath);
     }
+    m_clock.setPaused(false, RTSPPlayerNowUs());
     BOOL bRet = StartDecodeThread();
     if(bRet){
         SetPlayStatus(RTSP_PLAYSTATUS_PLAYING);
@@ -86,6 +100,7 @@ void CRTSPPlayer::Play()
 void CRTSPPlayer::Pause()
 {
     StopDecodeThread();
+    m_clock.setPaused(true, RTSPPlayerNowUs());
     SetPlayStatus(RTSP_PLAYSTATUS_PAUSE);
 }
 
@@ -94,6 +109,7 @@ void CRTSPPlayer::Stop()
 {
     StopDecodeThread();
     DecodeUninit();
+    m_clock.reset();
     SetPlayStatus(RTSP_PLAYSTATUS_STOP);
 }
 
@@ -120,24 +136,12 @@ void CRTSPPlayer::StopDecodeThread()
 
 int CRTSPPlayer::ImgConvert(AVPicture * dst, PixelFormat dst_pix_fmt, const AVPicture * src, PixelFormat src_pix_fmt, int src_width, int src_height)
 {
-    unsigned char * srcSlice[4];
-    int srcStride[4] = {0};
-    unsigned char * dstSlice[4];
-    int dstStride[4] = {0};
-    
-    for (int i=0; i<4; i++){
-        srcSlice[i] = src->data[i];
-        srcStride[i] = src->linesize[i];
-        dstSlice[i] = dst->data[i];
-        dstStride[i] = dst->linesize[i];
-    }
-    SwsContext *pSwsContext = sws_getContext(src_width, src_height, src_pix_fmt, src_width, src_height, dst_pix_fmt, SWS_BICUBIC, NULL, NULL, NULL);
-    int nRet = sws_scale(pSwsContext, srcSlice, srcStride, 0, src_height, dstSlice, dstStride);
-    if (pSwsContext != NULL){
-        sws_freeContext(pSwsContext);
+    // SwsContext  m_imageConvert ʽͳߴ绺棬֡
+    if (m_imageConvert.convert(src, src_pix_fmt, src_width, src_height, dst, dst_pix_fmt, src_width, src_height) < 0){
+        return -1;
     }
     
-    return nRet;
+    return src_height;
 }
 
 
@@ -201,6 +205,9 @@ int CRTSPPlayer::DecodeInit(LPCTSTR pFileName)
         m_pCodecContext->flags |= CODEC_FLAG_TRUNCATED; // we do not send complete frames
     }
     
+    // ֵ֧Ľֱӽ뵽֡أʱһεڴ
+    VideoFramePool::attachDecoder(m_pCodecContext, m_pCodec, VideoFramePool::shared());
+    
     // Open codec
     if (avcodec_open(m_pCodecContext, m_pCodec) < 0){
         return -6; // Could not open codec
@@ -212,13 +219,16 @@ int CRTSPPlayer::DecodeInit(LPCTSTR pFileName)
     // Allocate an AVFrame structure
     m_pFrameRGB = avcodec_alloc_frame();
     
-    // Determine required buffer size and allocate buffer
-    int numBytes = avpicture_get_size(PIX_FMT_BGR24, m_pCodecContext->width, m_pCodecContext->height);
-    m_pBufRGB = new BYTE [numBytes];
-    memset(m_pBufRGB,0,numBytes);
+    // RGB ֡ȡ
+    m_pSurfaceRGB = VideoFramePool::shared()->acquire(PIX_FMT_BGR24, m_pCodecContext->width, m_pCodecContext->height);
+    if (m_pSurfaceRGB == NULL){
+        return -7; // Could not allocate RGB buffer
+    }
+    memset(m_pSurfaceRGB->data[0], 0, m_pSurfaceRGB->linesize[0] * m_pCodecContext->height);
     
     // Assign appropriate parts of buffer to image planes in m_pFrameRGB
-    avpicture_fill((AVPicture *)m_pFrameRGB, m_pBufRGB, PIX_FMT_BGR24, m_pCodecContext->width, m_pCodecContext->height);
+    memcpy(m_pFrameRGB->data, m_pSurfaceRGB->data, sizeof(m_pSurfaceRGB->data));
+    memcpy(m_pFrameRGB->linesize, m_pSurfaceRGB->linesize, sizeof(m_pSurfaceRGB->linesize));
     m_nFrameWidth = m_pCodecContext->width;
     m_nFrameHeight = m_pCodecContext->height;
     
@@ -249,9 +259,9 @@ void CRTSPPlayer::DecodeUninit()
         av_free(m_pFrameRGB);
         m_pFrameRGB = NULL;
     }
-    if (m_pBufRGB){
-        delete [] m_pBufRGB;
-        m_pBufRGB = NULL;
+    if (m_pSurfaceRGB){
+        VideoFramePool::shared()->release(m_pSurfaceRGB);
+        m_pSurfaceRGB = NULL;
     }
 }
 
@@ -260,7 +270,9 @@ int CRTSPPlayer::BeginDecode()
 {
     int bytesRemaining = 0, bytesDecoded;
     BYTE * rawData = NULL;
-    int frameFinished = 0;
+    int frameFinished = 0, action;
+    int64_t timestamp, ptsUs, durationUs, waitUs = 0;
+    AVStream* stream;
     m_struPacket.data = NULL;
     m_struPacket.size = 0;
     m_bExitDecodeThread = FALSE;
@@ -290,6 +302,21 @@ int CRTSPPlayer::BeginDecode()
             
             // Did we finish the current frame Then we can return
             if (frameFinished) {
+                // ʱȵʾʱ䣬һ֡϶׷ʱӣûʱʱֱʾ
+                stream = m_pFormatContext->streams[m_nStreamIndex];
+                timestamp = m_struPacket.pts != (int64_t)AV_NOPTS_VALUE ? m_struPacket.pts : m_struPacket.dts;
+                action = MediaClockVideo_Show;
+                if (timestamp != (int64_t)AV_NOPTS_VALUE) {
+                    ptsUs = av_rescale_q(timestamp, stream->time_base, gMicrosecond);
+                    durationUs = stream->r_frame_rate.num > 0 ? (int64_t)stream->r_frame_rate.den * 1000000 / stream->r_frame_rate.num : 40000;
+                    action = m_clock.syncVideo(ptsUs, durationUs, true, RTSPPlayerNowUs(), &waitUs);
+                    while (action == MediaClockVideo_Wait && !m_bExitDecodeThread) {
+                        Sleep(waitUs > 100000 ? 100 : (DWORD)(waitUs / 1000));
+                        action = m_clock.syncVideo(ptsUs, durationUs, true, RTSPPlayerNowUs(), &waitUs);
+                    }
+                }
+                if (action != MediaClockVideo_Show)
+                    continue;
                 ImgConvert(
                         (AVPicture *)m_pFrameRGB,
                         PIX_FMT_BGR24,
@@ -326,7 +353,11 @@ void CRTSPPlayer::Display()
     BYTE *pData = NULL;
     HBITMAP hBitmap = CreateDIBSection (NULL, (BITMAPINFO *)&bmpHdr, DIB_RGB_COLORS, (void**)&pData, NULL, 0);
     try{
-        memcpy(pData, m_pBufRGB, m_nFrameWidth * m_nFrameHeight * 3);
+        // DIB ÿа 4 ֽڶ룬֡صпͬи
+        int nDibStride = (m_nFrameWidth * 3 + 3) & ~3;
+        for (int y = 0; y < m_nFrameHeight; y++){
+            memcpy(pData + y * nDibStride, m_pSurfaceRGB->data[0] + y * m_pSurfaceRGB->linesize[0], m_nFrameWidth * 3);
+        }
     }catch (CMemoryException* e){
     }
     HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDc, hBitmap);
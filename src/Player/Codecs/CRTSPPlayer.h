@@ -14,6 +14,10 @@ extern "C"
 #include "libswscale\swscale.h"
 };
 
+#include "ImageConvert.h"
+#include "MediaClock.h"
+#include "VideoFramePool.h"
+
 
 
 // 播放状态
@@ -87,7 +91,9 @@ private:
     AVFrame* m_pFrameRGB;
     int m_nFrameWidth;
     int m_nFrameHeight;
-    BYTE* m_pBufRGB; // 解码后的RGB数据
+    VideoSurface* m_pSurfaceRGB; // 解码后的RGB数据，从帧池取，行按 VIDEO_POOL_ALIGN 对齐
+    ImageConvert m_imageConvert; // 缓存 SwsContext，不再每帧创建
+    MediaClock m_clock; // 视频主时钟，按时间戳控制显示节奏
     RTSP_PLAYSTATUS m_nPlayStatus;
     HWND m_hWnd;
     RECT m_rcWnd;
@@ -7,6 +7,8 @@
 
 
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 
 #include "log/LogC.h"
 #include "LogPlayer.h"
@@ -29,14 +31,24 @@
 
 int SendMessageToCodec(int msgNo)
 {
+    return SendMessageToCodecWithArgs(msgNo, 0, 0);
+}
+
+
+/* 参数放在 user.code 和 user.data1 中，由解码循环按消息类型解释 */
+int SendMessageToCodecWithArgs(int msgNo, int arg1, int arg2)
+{
+    SDL_Event event;
+
     if(msgNo < SOFTWARE_CODEC_EVENT_RESERVED || msgNo > SOFTWARE_CODEC_EVENT_MAX) {
         playerLogError("SendMessageToCodec: msgNo[%d]\n", msgNo);
         return -1;
     }
     
-    //TODO:: create SDL Event
-    SDL_Event event;
+    memset(&event, 0, sizeof(event));
     event.type = msgNo;
+    event.user.code = arg1;
+    event.user.data1 = (void *)(intptr_t)arg2;
     SDL_Delay(33);      //33ms
     SDL_PushEvent(&event);
     
@@ -118,12 +130,11 @@ int PlayerOptionsResume()
 }
 
 
-int PlayerOptionsSeekto()
+int PlayerOptionsSeekto(int timeMs, int accurate)
 {
-    playerLogVerbose("PlayerOptionsSeekto\n");
+    playerLogVerbose("PlayerOptionsSeekto [%d]ms, accurate[%d]\n", timeMs, accurate);
     
-    //TODO:: 先设置seek谁，保存在全局变量里，seek多少，seek倍速，然后发送消息
-    SendMessageToCodec(SOFTWARE_CODEC_EVENT_SEEKTO);
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SEEKTO, timeMs, accurate);
 
     return 0;
 }
@@ -133,8 +144,7 @@ int PlayerOptionsSeektoStart()
 {
     playerLogVerbose("PlayerOptionsSeektoStart\n");
     
-    //TODO:: 先设置seek谁，保存在全局变量里，seek多少，然后发送消息
-    SendMessageToCodec(SOFTWARE_CODEC_EVENT_SEEKTO);
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SEEKTO, 0, 1);
 
     return 0;
 }
@@ -144,30 +154,47 @@ int PlayerOptionsSeektoEnd()
 {
     playerLogVerbose("PlayerOptionsSeektoEnd\n");
     
-    //TODO:: 先设置seek谁，保存在全局变量里，seek多少，然后发送消息
-    SendMessageToCodec(SOFTWARE_CODEC_EVENT_SEEKTO);
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SEEKTO, -1, 0);
+
+    return 0;
+}
+
+
+int PlayerOptionsFastForward(int rate)
+{
+    playerLogVerbose("PlayerOptionsFastForward [%d%%]\n", rate);
+    
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SETRATE, rate, 0);
+
+    return 0;
+}
+
+
+int PlayerOptionsFastRewind(int rate)
+{
+    playerLogVerbose("PlayerOptionsFastRewind [%d%%]\n", rate);
+    
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SETRATE, -rate, 0);
 
     return 0;
 }
 
 
-int PlayerOptionsFastForward()
+int PlayerOptionsSelectSubtitle(int pid)
 {
-    playerLogVerbose("PlayerOptionsFastForward\n");
+    playerLogVerbose("PlayerOptionsSelectSubtitle pid[%d]\n", pid);
     
-    //TODO:: 先设置seek谁，保存在全局变量里，seek倍速，然后发送消息
-    SendMessageToCodec(SOFTWARE_CODEC_EVENT_SEEKTO);
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_SUBTITLE, pid, 0);
 
     return 0;
 }
 
 
-int PlayerOptionsFastRewind()
+int PlayerOptionsSelectAudioTrack(int pid)
 {
-    playerLogVerbose("PlayerOptionsFastRewind\n");
+    playerLogVerbose("PlayerOptionsSelectAudioTrack pid[%d]\n", pid);
     
-    //TODO:: 先设置seek谁，保存在全局变量里，seek倍速，然后发送消息
-    SendMessageToCodec(SOFTWARE_CODEC_EVENT_SEEKTO);
+    SendMessageToCodecWithArgs(SOFTWARE_CODEC_EVENT_AUDIOTRACK, pid, 0);
 
     return 0;
 }
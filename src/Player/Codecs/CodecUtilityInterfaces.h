@@ -24,6 +24,27 @@ int PlayerCodecsFastForward();
 int PlayerCodecsFastRewind();
 
 
+//=================================================================================================
+// 播放控制与解码器的接口，向解码循环发送 SDL 消息
+//=================================================================================================
+int SendMessageToCodec(int msgNo);
+int SendMessageToCodecWithArgs(int msgNo, int arg1, int arg2);
+
+int PlayerOptionsOpen();
+int PlayerOptionsPlay();
+int PlayerOptionsClose();
+int PlayerOptionsStop();
+int PlayerOptionsPause();
+int PlayerOptionsResume();
+int PlayerOptionsSeekto(int timeMs, int accurate);   //timeMs 小于 0 为结尾
+int PlayerOptionsSeektoStart();
+int PlayerOptionsSeektoEnd();
+int PlayerOptionsFastForward(int rate);             //rate 为百分比
+int PlayerOptionsFastRewind(int rate);
+int PlayerOptionsSelectSubtitle(int pid);           //pid 可以为 PLAY_TRACK_OFF、PLAY_TRACK_NEXT
+int PlayerOptionsSelectAudioTrack(int pid);         //pid 可以为 PLAY_TRACK_NEXT
+
+
 
 
 
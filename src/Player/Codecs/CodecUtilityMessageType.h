@@ -22,7 +22,10 @@ typedef enum _softwareCodecEvent {
     SOFTWARE_CODEC_EVENT_STOP,
     SOFTWARE_CODEC_EVENT_PAUSE,
     SOFTWARE_CODEC_EVENT_RESUME,
-    SOFTWARE_CODEC_EVENT_SEEKTO,
+    SOFTWARE_CODEC_EVENT_SEEKTO,        //user.code 毫秒，小于 0 为结尾；user.data1 非 NULL 为精确 seek
+    SOFTWARE_CODEC_EVENT_SETRATE,       //user.code 倍速百分比，负数为后退
+    SOFTWARE_CODEC_EVENT_SUBTITLE,      //user.code 字幕的 PID，或者 PLAY_TRACK_OFF、PLAY_TRACK_NEXT
+    SOFTWARE_CODEC_EVENT_AUDIOTRACK,    //user.code 音轨的 PID，或者 PLAY_TRACK_NEXT
     
     SOFTWARE_CODEC_EVENT_VIDEO_RESIZE,
     SOFTWARE_CODEC_EVENT_VIDEO_FULLSCREEN,
@@ -0,0 +1,478 @@
+/**
+ *  ImageConvert.cpp文件
+ *  像素格式转换服务；
+ *  主要有以下部分：
+ *      1. SwsContext 缓存：按 (源格式, 目标格式, 尺寸, flags, 条带) 查找，满了淘汰最久没用的
+ *      2. 输出帧池：预分配、每行 32 字节对齐，尺寸不变时不再分配
+ *      3. SIMD 路径：YUV420P 到 BGRA(小端的 RGB32) 和 NV12，SSE2/NEON，其余平台用 C
+ *      4. 条带并行：尺寸不变的转换按行拆成条带，交给线程池，调用线程也处理一条
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+//Linux...
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+#include "LogPlayer.h"
+};
+
+#include "ImageConvert.h"
+
+
+/* BT.601 limited range，系数放大 64 倍，16 位运算不会溢出到影响结果(饱和的值本来就要截到 255) */
+#define     YUV_Y_COEF      74
+#define     YUV_RV_COEF     102
+#define     YUV_GU_COEF     25
+#define     YUV_GV_COEF     52
+#define     YUV_BU_COEF     129
+
+
+static inline int ClampSaturate16(int value)
+{
+    return value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+}
+
+static inline uint8_t ClampByte(int value)
+{
+    return (uint8_t)(value > 255 ? 255 : (value < 0 ? 0 : value));
+}
+
+/* 与 SIMD 的 adds_epi16 + srai 结果一致 */
+static inline uint8_t YUVToComponent(int luma, int chroma)
+{
+    return ClampByte(ClampSaturate16(ClampSaturate16(luma + chroma) + 32) >> 6);
+}
+
+static void YUV420PToBGRARow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int start, int width)
+{
+    int x, luma, r, g, b;
+
+    for (x = start; x < width; x++) {
+        luma = (y[x] - 16) * YUV_Y_COEF;
+        r = (v[x >> 1] - 128) * YUV_RV_COEF;
+        g = -(u[x >> 1] - 128) * YUV_GU_COEF - (v[x >> 1] - 128) * YUV_GV_COEF;
+        b = (u[x >> 1] - 128) * YUV_BU_COEF;
+        dst[x * 4 + 0] = YUVToComponent(luma, b);
+        dst[x * 4 + 1] = YUVToComponent(luma, g);
+        dst[x * 4 + 2] = YUVToComponent(luma, r);
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+void ImageConvertYUV420PToBGRA(const uint8_t* const src[4], const int srcStride[4],
+                               uint8_t* dst, int dstStride, int width, int height)
+{
+    int row, x;
+
+    for (row = 0; row < height; row++) {
+        const uint8_t* y = src[0] + row * srcStride[0];
+        const uint8_t* u = src[1] + (row >> 1) * srcStride[1];
+        const uint8_t* v = src[2] + (row >> 1) * srcStride[2];
+        uint8_t* out = dst + row * dstStride;
+
+        x = 0;
+#if defined(__SSE2__)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i alpha = _mm_set1_epi8((char)0xFF);
+            const __m128i round = _mm_set1_epi16(32);
+            const __m128i bias16 = _mm_set1_epi16(16);
+            const __m128i bias128 = _mm_set1_epi16(128);
+            const __m128i yCoef = _mm_set1_epi16(YUV_Y_COEF);
+            const __m128i rvCoef = _mm_set1_epi16(YUV_RV_COEF);
+            const __m128i guCoef = _mm_set1_epi16(YUV_GU_COEF);
+            const __m128i gvCoef = _mm_set1_epi16(YUV_GV_COEF);
+            const __m128i buCoef = _mm_set1_epi16(YUV_BU_COEF);
+
+            for (; x + 16 <= width; x += 16) {
+                __m128i yy = _mm_loadu_si128((const __m128i*)(y + x));
+                __m128i uu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u + (x >> 1))), zero), bias128);
+                __m128i vv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(v + (x >> 1))), zero), bias128);
+                __m128i rc = _mm_mullo_epi16(vv, rvCoef);
+                __m128i gc = _mm_sub_epi16(_mm_sub_epi16(zero, _mm_mullo_epi16(uu, guCoef)), _mm_mullo_epi16(vv, gvCoef));
+                __m128i bc = _mm_mullo_epi16(uu, buCoef);
+                __m128i ylo = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(yy, zero), bias16), yCoef);
+                __m128i yhi = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(yy, zero), bias16), yCoef);
+                /* 每个色度值对应两个亮度 */
+                __m128i rlo = _mm_unpacklo_epi16(rc, rc), rhi = _mm_unpackhi_epi16(rc, rc);
+                __m128i glo = _mm_unpacklo_epi16(gc, gc), ghi = _mm_unpackhi_epi16(gc, gc);
+                __m128i blo = _mm_unpacklo_epi16(bc, bc), bhi = _mm_unpackhi_epi16(bc, bc);
+                __m128i r, g, b, bg, ra;
+
+                r = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ylo, rlo), round), 6),
+                                     _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yhi, rhi), round), 6));
+                g = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ylo, glo), round), 6),
+                                     _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yhi, ghi), round), 6));
+                b = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ylo, blo), round), 6),
+                                     _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yhi, bhi), round), 6));
+
+                bg = _mm_unpacklo_epi8(b, g);
+                ra = _mm_unpacklo_epi8(r, alpha);
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_unpacklo_epi16(bg, ra));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+                bg = _mm_unpackhi_epi8(b, g);
+                ra = _mm_unpackhi_epi8(r, alpha);
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 32), _mm_unpacklo_epi16(bg, ra));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 48), _mm_unpackhi_epi16(bg, ra));
+            }
+        }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        {
+            const int16x8_t round = vdupq_n_s16(32);
+            const int16x8_t bias16 = vdupq_n_s16(16);
+            const int16x8_t bias128 = vdupq_n_s16(128);
+
+            for (; x + 16 <= width; x += 16) {
+                uint8x16_t yy = vld1q_u8(y + x);
+                int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + (x >> 1)))), bias128);
+                int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + (x >> 1)))), bias128);
+                int16x8_t rc = vmulq_n_s16(vv, YUV_RV_COEF);
+                int16x8_t gc = vnegq_s16(vaddq_s16(vmulq_n_s16(uu, YUV_GU_COEF), vmulq_n_s16(vv, YUV_GV_COEF)));
+                int16x8_t bc = vmulq_n_s16(uu, YUV_BU_COEF);
+                int16x8_t ys[2];
+                int16x8x2_t rz = vzipq_s16(rc, rc), gz = vzipq_s16(gc, gc), bz = vzipq_s16(bc, bc);
+                uint8x8x4_t pixels;
+                int half;
+
+                ys[0] = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yy))), bias16), YUV_Y_COEF);
+                ys[1] = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yy))), bias16), YUV_Y_COEF);
+                pixels.val[3] = vdup_n_u8(255);
+                for (half = 0; half < 2; half++) {
+                    pixels.val[0] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(ys[half], bz.val[half]), round), 6));
+                    pixels.val[1] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(ys[half], gz.val[half]), round), 6));
+                    pixels.val[2] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(ys[half], rz.val[half]), round), 6));
+                    vst4_u8(out + (x + half * 8) * 4, pixels);
+                }
+            }
+        }
+#endif
+        YUV420PToBGRARow(y, u, v, out, x, width);
+    }
+}
+
+void ImageConvertYUV420PToNV12(const uint8_t* const src[4], const int srcStride[4],
+                               uint8_t* const dst[2], const int dstStride[2], int width, int height)
+{
+    int row, x, chromaWidth = (width + 1) >> 1;
+
+    for (row = 0; row < height; row++)
+        memcpy(dst[0] + row * dstStride[0], src[0] + row * srcStride[0], width);
+
+    for (row = 0; row < (height + 1) >> 1; row++) {
+        const uint8_t* u = src[1] + row * srcStride[1];
+        const uint8_t* v = src[2] + row * srcStride[2];
+        uint8_t* uv = dst[1] + row * dstStride[1];
+
+        x = 0;
+#if defined(__SSE2__)
+        for (; x + 16 <= chromaWidth; x += 16) {
+            __m128i uu = _mm_loadu_si128((const __m128i*)(u + x));
+            __m128i vv = _mm_loadu_si128((const __m128i*)(v + x));
+            _mm_storeu_si128((__m128i*)(uv + x * 2), _mm_unpacklo_epi8(uu, vv));
+            _mm_storeu_si128((__m128i*)(uv + x * 2 + 16), _mm_unpackhi_epi8(uu, vv));
+        }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        for (; x + 16 <= chromaWidth; x += 16) {
+            uint8x16x2_t pair;
+            pair.val[0] = vld1q_u8(u + x);
+            pair.val[1] = vld1q_u8(v + x);
+            vst2q_u8(uv + x * 2, pair);
+        }
+#endif
+        for (; x < chromaWidth; x++) {
+            uv[x * 2] = u[x];
+            uv[x * 2 + 1] = v[x];
+        }
+    }
+}
+
+
+/* 第 plane 个平面在垂直方向上的缩小倍数(log2) */
+static int PlaneVerticalShift(int format, int plane)
+{
+    const AVPixFmtDescriptor* desc = &av_pix_fmt_descriptors[format];
+
+    if (desc->nb_components >= 3 && desc->comp[0].plane != plane
+        && (desc->comp[1].plane == plane || desc->comp[2].plane == plane))
+        return desc->log2_chroma_h;
+    return 0;
+}
+
+static bool FormatSliceable(int format)
+{
+    const AVPixFmtDescriptor* desc = &av_pix_fmt_descriptors[format];
+
+    return !(desc->flags & (PIX_FMT_PAL | PIX_FMT_BITSTREAM | PIX_FMT_HWACCEL)) && desc->log2_chroma_h <= 1;
+}
+
+
+ImageConvert::ImageConvert(int threads)
+    : m_pool(NULL)
+    , m_threads(threads)
+    , m_sliceDone(NULL)
+    , m_useCounter(0)
+{
+    memset(m_cache, 0, sizeof(m_cache));
+    memset(m_frames, 0, sizeof(m_frames));
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_mutex = ThreadMutexCreate();
+
+    if (m_threads <= 0)
+        m_threads = SDL_GetCPUCount();
+    if (m_threads > IMAGE_CONVERT_SLICES_MAX)
+        m_threads = IMAGE_CONVERT_SLICES_MAX;
+    /* 调用线程自己也处理一个条带，池里少一个线程 */
+    if (m_threads > 1) {
+        m_pool = threadpool_create(m_threads - 1, IMAGE_CONVERT_SLICES_MAX, 0);
+        m_sliceDone = SDL_CreateSemaphore(0);
+        if (m_pool == NULL || m_sliceDone == NULL) {
+            playerLogWarning("ImageConvert threadpool create failed, convert in one thread.\n");
+            if (m_pool)
+                threadpool_destroy(m_pool, 0);
+            m_pool = NULL;
+            m_threads = 1;
+        }
+    }
+}
+
+ImageConvert::~ImageConvert()
+{
+    int i;
+
+    if (m_pool)
+        threadpool_destroy(m_pool, threadpool_graceful);
+    if (m_sliceDone)
+        SDL_DestroySemaphore(m_sliceDone);
+    for (i = 0; i < IMAGE_CONVERT_CACHE_SIZE; i++) {
+        if (m_cache[i].context)
+            sws_freeContext(m_cache[i].context);
+    }
+    for (i = 0; i < IMAGE_CONVERT_POOL_FRAMES; i++)
+        av_free(m_frames[i].buffer);
+    ThreadMutexDestroy(m_mutex);
+}
+
+struct SwsContext* ImageConvert::getContext(int srcFormat, int srcWidth, int srcHeight,
+                                            int dstFormat, int dstWidth, int dstHeight, int flags, int slot)
+{
+    CacheEntry* entry;
+    CacheEntry* oldest = &m_cache[0];
+    int i;
+
+    for (i = 0; i < IMAGE_CONVERT_CACHE_SIZE; i++) {
+        entry = &m_cache[i];
+        if (entry->context && entry->srcFormat == srcFormat && entry->srcWidth == srcWidth
+            && entry->srcHeight == srcHeight && entry->dstFormat == dstFormat && entry->dstWidth == dstWidth
+            && entry->dstHeight == dstHeight && entry->flags == flags && entry->slot == slot) {
+            entry->lastUsed = ++m_useCounter;
+            return entry->context;
+        }
+        if (entry->context == NULL || (oldest->context && entry->lastUsed < oldest->lastUsed))
+            oldest = entry;
+    }
+
+    /* 一次转换最多用 IMAGE_CONVERT_SLICES_MAX 个，淘汰的一定不是本次刚取出的 */
+    if (oldest->context)
+        sws_freeContext(oldest->context);
+    oldest->context = sws_getContext(srcWidth, srcHeight, (enum PixelFormat)srcFormat,
+                                     dstWidth, dstHeight, (enum PixelFormat)dstFormat, flags, NULL, NULL, NULL);
+    if (oldest->context == NULL) {
+        playerLogError("sws_getContext %dx%d[%d] -> %dx%d[%d] failed.\n",
+                       srcWidth, srcHeight, srcFormat, dstWidth, dstHeight, dstFormat);
+        return NULL;
+    }
+    oldest->srcFormat = srcFormat;
+    oldest->srcWidth = srcWidth;
+    oldest->srcHeight = srcHeight;
+    oldest->dstFormat = dstFormat;
+    oldest->dstWidth = dstWidth;
+    oldest->dstHeight = dstHeight;
+    oldest->flags = flags;
+    oldest->slot = slot;
+    oldest->lastUsed = ++m_useCounter;
+    m_statistics.contextCreated++;
+    return oldest->context;
+}
+
+bool ImageConvert::hasFastPath(int srcFormat, int dstFormat)
+{
+    return srcFormat == PIX_FMT_YUV420P && (dstFormat == PIX_FMT_BGRA || dstFormat == PIX_FMT_NV12);
+}
+
+int ImageConvert::sliceCount(int srcFormat, int dstFormat, int width, int height)
+{
+    int slices;
+
+    if (m_pool == NULL || !FormatSliceable(srcFormat) || !FormatSliceable(dstFormat))
+        return 1;
+    slices = height / IMAGE_CONVERT_SLICE_MIN_ROWS;
+    if (slices > m_threads)
+        slices = m_threads;
+    /* 小图拆分的调度开销比转换本身还大 */
+    if ((int64_t)width * height < 640 * 360)
+        return 1;
+    return slices > 1 ? slices : 1;
+}
+
+void ImageConvert::runSlice(SliceTask* task)
+{
+    if (task->context) {
+        sws_scale(task->context, task->src, task->srcStride, 0, task->height, task->dst, task->dstStride);
+    } else if (task->dstFormat == PIX_FMT_NV12) {
+        ImageConvertYUV420PToNV12(task->src, task->srcStride, task->dst, task->dstStride, task->width, task->height);
+    } else {
+        ImageConvertYUV420PToBGRA(task->src, task->srcStride, task->dst[0], task->dstStride[0], task->width, task->height);
+    }
+}
+
+void ImageConvert::sliceWorker(void* arg)
+{
+    SliceTask* task = (SliceTask*)arg;
+
+    runSlice(task);
+    SDL_SemPost(task->owner->m_sliceDone);
+}
+
+int ImageConvert::convert(const AVPicture* src, int srcFormat, int srcWidth, int srcHeight,
+                          AVPicture* dst, int dstFormat, int dstWidth, int dstHeight, int flags)
+{
+    SliceTask tasks[IMAGE_CONVERT_SLICES_MAX];
+    bool fastPath, sameSize;
+    int slices = 1, rows, top, i, p, ret = 0;
+
+    if (src == NULL || dst == NULL || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0
+        || srcFormat < 0 || srcFormat >= PIX_FMT_NB || dstFormat < 0 || dstFormat >= PIX_FMT_NB)
+        return -1;
+
+    ThreadMutexLock(m_mutex);
+    sameSize = (srcWidth == dstWidth && srcHeight == dstHeight);
+    fastPath = sameSize && hasFastPath(srcFormat, dstFormat);
+    /* 缩放时 sws_scale 的条带必须按顺序交给同一个 context，只有尺寸不变才能拆 */
+    if (sameSize)
+        slices = sliceCount(srcFormat, dstFormat, srcWidth, srcHeight);
+    /* 条带高度取 16 的倍数，色度平面的行不会被分开 */
+    rows = ((srcHeight + slices - 1) / slices + 15) & ~15;
+
+    for (i = 0, top = 0; i < slices && top < srcHeight; i++, top += rows) {
+        SliceTask* task = &tasks[i];
+        int height = srcHeight - top < rows ? srcHeight - top : rows;
+
+        task->owner = this;
+        task->srcFormat = srcFormat;
+        task->dstFormat = dstFormat;
+        task->width = srcWidth;
+        task->height = slices > 1 ? height : srcHeight;
+        task->context = NULL;
+        if (!fastPath) {
+            task->context = slices > 1
+                ? getContext(srcFormat, srcWidth, height, dstFormat, dstWidth, height, flags, i)
+                : getContext(srcFormat, srcWidth, srcHeight, dstFormat, dstWidth, dstHeight, flags, 0);
+            if (task->context == NULL) {
+                ret = -1;
+                break;
+            }
+        }
+        for (p = 0; p < 4; p++) {
+            task->src[p] = src->data[p] ? src->data[p] + (top >> PlaneVerticalShift(srcFormat, p)) * src->linesize[p] : NULL;
+            task->srcStride[p] = src->linesize[p];
+            task->dst[p] = dst->data[p] ? dst->data[p] + (top >> PlaneVerticalShift(dstFormat, p)) * dst->linesize[p] : NULL;
+            task->dstStride[p] = dst->linesize[p];
+        }
+    }
+    slices = i;
+
+    if (ret == 0) {
+        /* 第一条在调用线程中转换，其余的交给线程池；池满时也在调用线程中做 */
+        for (i = 1; i < slices; i++) {
+            if (threadpool_add(m_pool, sliceWorker, &tasks[i], 0) != 0)
+                sliceWorker(&tasks[i]);
+        }
+        runSlice(&tasks[0]);
+        for (i = 1; i < slices; i++)
+            SDL_SemWait(m_sliceDone);
+
+        m_statistics.frames++;
+        if (fastPath)
+            m_statistics.fastPathFrames++;
+        if (slices > 1)
+            m_statistics.slicedFrames++;
+    }
+    ThreadMutexUnLock(m_mutex);
+    return ret;
+}
+
+ImageConvertFrame* ImageConvert::acquireFrame(int format, int width, int height)
+{
+    ImageConvertFrame* frame = NULL;
+    uint8_t* data[4];
+    int linesize[4], size, p, i;
+
+    if (format < 0 || format >= PIX_FMT_NB || width <= 0 || height <= 0)
+        return NULL;
+
+    ThreadMutexLock(m_mutex);
+    /* 优先取尺寸相同的空闲帧，不需要重新分配 */
+    for (i = 0; i < IMAGE_CONVERT_POOL_FRAMES; i++) {
+        if (m_frames[i].used)
+            continue;
+        if (m_frames[i].buffer && m_frames[i].format == format && m_frames[i].width == width && m_frames[i].height == height) {
+            frame = &m_frames[i];
+            break;
+        }
+        if (frame == NULL)
+            frame = &m_frames[i];
+    }
+    if (frame == NULL) {
+        ThreadMutexUnLock(m_mutex);
+        playerLogWarning("ImageConvert frame pool exhausted.\n");
+        return NULL;
+    }
+
+    if (frame->buffer == NULL || frame->format != format || frame->width != width || frame->height != height) {
+        /* 宽度按 IMAGE_CONVERT_ALIGN 像素取整，每个平面的行首都对齐 */
+        if (av_image_fill_linesizes(linesize, (enum PixelFormat)format, (width + IMAGE_CONVERT_ALIGN - 1) & ~(IMAGE_CONVERT_ALIGN - 1)) < 0
+            || (size = av_image_fill_pointers(data, (enum PixelFormat)format, height, NULL, linesize)) < 0) {
+            ThreadMutexUnLock(m_mutex);
+            return NULL;
+        }
+        size += IMAGE_CONVERT_ALIGN;
+        if (size > frame->bufferSize) {
+            av_free(frame->buffer);
+            frame->buffer = (uint8_t*)av_malloc(size);
+            frame->bufferSize = frame->buffer ? size : 0;
+            if (frame->buffer == NULL) {
+                ThreadMutexUnLock(m_mutex);
+                playerLogError("av_malloc frame [%d] failed.\n", size);
+                return NULL;
+            }
+        }
+        av_image_fill_pointers(frame->picture.data, (enum PixelFormat)format, height, frame->buffer, linesize);
+        for (p = 0; p < 4; p++)
+            frame->picture.linesize[p] = linesize[p];
+        frame->format = format;
+        frame->width = width;
+        frame->height = height;
+    }
+    frame->used = true;
+    ThreadMutexUnLock(m_mutex);
+    return frame;
+}
+
+void ImageConvert::releaseFrame(ImageConvertFrame* frame)
+{
+    if (frame == NULL)
+        return;
+    ThreadMutexLock(m_mutex);
+    frame->used = false;
+    ThreadMutexUnLock(m_mutex);
+}
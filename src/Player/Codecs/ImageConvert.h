@@ -0,0 +1,130 @@
+#ifndef __IMAGE_CONVERT_H__
+#define __IMAGE_CONVERT_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+//Linux...
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <SDL2/SDL.h>
+#include "ThreadPool.h"
+};
+
+#include "ThreadMutex.h"
+
+
+#define     IMAGE_CONVERT_CACHE_SIZE        16          //缓存的 SwsContext 个数，按最近使用淘汰
+#define     IMAGE_CONVERT_POOL_FRAMES       8           //预分配的输出帧个数
+#define     IMAGE_CONVERT_SLICES_MAX        8           //一帧最多分成的条带数
+#define     IMAGE_CONVERT_SLICE_MIN_ROWS    128         //条带少于这么多行时不再拆分
+#define     IMAGE_CONVERT_ALIGN             32          //输出帧每行按字节对齐
+
+
+typedef struct _ImageConvertFrame {
+    AVPicture       picture;
+    int             format;             //PixelFormat
+    int             width;
+    int             height;
+    uint8_t*        buffer;
+    int             bufferSize;
+    bool            used;
+} ImageConvertFrame;
+
+typedef struct _ImageConvertStatistics {
+    int64_t         frames;
+    int64_t         fastPathFrames;     //没有经过 sws_scale 的帧
+    int64_t         slicedFrames;       //拆成多个条带并行转换的帧
+    int64_t         contextCreated;     //SwsContext 缓存未命中次数
+} ImageConvertStatistics;
+
+
+class ImageConvert { /* 缓存 SwsContext 的像素格式转换，YUV420P 到 RGB32/NV12 走 SIMD，大帧按条带拆到线程池 */
+    public:
+        ImageConvert(int threads = 0);      //0 时按 CPU 个数，1 时不拆分
+        ~ImageConvert();
+
+        /**
+         *  @Func: convert
+         *         ps. :同一个 ImageConvert 上的调用互斥；SwsContext 按 (源格式, 目标格式, 尺寸, flags) 复用，
+         *              尺寸不变时拆成条带并行，YUV420P 到 BGRA/NV12 不经过 sws_scale
+         *  @Param: src, type:: const AVPicture*
+         *  @Param: srcFormat/srcWidth/srcHeight, type:: int
+         *  @Param: dst, type:: AVPicture*
+         *  @Param: dstFormat/dstWidth/dstHeight, type:: int
+         *  @Param: flags, type:: int, SWS_BICUBIC 等
+         *  @Return: int, 0 成功，-1 失败
+         *
+         **/
+        int convert(const AVPicture* src, int srcFormat, int srcWidth, int srcHeight,
+                    AVPicture* dst, int dstFormat, int dstWidth, int dstHeight, int flags = SWS_BICUBIC);
+
+        /* 从池中取一个行对齐的输出帧，大小不同时重新分配；池用完时返回 NULL */
+        ImageConvertFrame* acquireFrame(int format, int width, int height);
+        void releaseFrame(ImageConvertFrame* frame);
+
+        const ImageConvertStatistics& getStatistics() { return m_statistics; }
+
+    private:
+        typedef struct _CacheEntry {
+            struct SwsContext*  context;
+            int                 srcFormat;
+            int                 srcWidth;
+            int                 srcHeight;
+            int                 dstFormat;
+            int                 dstWidth;
+            int                 dstHeight;
+            int                 flags;
+            int                 slot;           //并行的条带各用一个
+            uint64_t            lastUsed;
+        } CacheEntry;
+
+        typedef struct _SliceTask {
+            ImageConvert*       owner;
+            struct SwsContext*  context;        //NULL 时走 SIMD 路径
+            const uint8_t*      src[4];
+            int                 srcStride[4];
+            uint8_t*            dst[4];
+            int                 dstStride[4];
+            int                 srcFormat;
+            int                 dstFormat;
+            int                 width;
+            int                 height;
+        } SliceTask;
+
+        ImageConvert(const ImageConvert&);
+        ImageConvert& operator=(const ImageConvert&);
+
+        struct SwsContext* getContext(int srcFormat, int srcWidth, int srcHeight,
+                                      int dstFormat, int dstWidth, int dstHeight, int flags, int slot);
+        int sliceCount(int srcFormat, int dstFormat, int width, int height);
+        static bool hasFastPath(int srcFormat, int dstFormat);
+        static void runSlice(SliceTask* task);
+        static void sliceWorker(void* arg);
+
+        threadpool_t*               m_pool;
+        int                         m_threads;
+        SDL_sem*                    m_sliceDone;
+        ThreadMutex_Type            m_mutex;
+        CacheEntry                  m_cache[IMAGE_CONVERT_CACHE_SIZE];
+        uint64_t                    m_useCounter;
+        ImageConvertFrame           m_frames[IMAGE_CONVERT_POOL_FRAMES];
+        ImageConvertStatistics      m_statistics;
+};
+
+
+/* SIMD 路径，单独导出便于对照 sws_scale 测试；BT.601 limited range */
+void ImageConvertYUV420PToBGRA(const uint8_t* const src[4], const int srcStride[4],
+                               uint8_t* dst, int dstStride, int width, int height);
+void ImageConvertYUV420PToNV12(const uint8_t* const src[4], const int srcStride[4],
+                               uint8_t* const dst[2], const int dstStride[2], int width, int height);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__IMAGE_CONVERT_H__
@@ -0,0 +1,358 @@
+/**
+ *  MediaClock.cpp文件
+ *  播放器共用的主时钟和音视频同步；
+ *  主要有以下部分：
+ *      1. 两个时钟：音频时钟由音频回调报告，两次报告之间按经过的时间外推(有上限)；系统时钟按单调时间走，
+ *         由第一帧视频、音频结束时的主时钟或者外部参考(PCR/NTP)对齐
+ *      2. 模式：音频主时钟时优先用音频时钟，没有时用系统时钟；视频主时钟和外部参考时只用系统时钟
+ *      3. 视频：按帧和主时钟的误差决定显示、等待(上一帧重复显示)、丢弃，误差太大时认为时间戳跳变，重新对齐
+ *      4. 音频：非音频主时钟时按音频时钟和主时钟的误差给出重采样的微调，比例控制，有死区和上限
+ *      5. C 接口：给 ffplay.c 派生的代码使用
+ *
+ **/
+
+#include <string.h>
+#include <time.h>
+
+#include "MediaClock.h"
+
+
+MediaClock::MediaClock(int mode)
+    : m_mode(mode)
+    , m_audioLimitUs(MEDIACLOCK_AUDIO_LIMIT_US)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    reset();
+}
+
+MediaClock::~MediaClock()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int64_t MediaClock::nowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void MediaClock::reset()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_audioUs = -1;
+    m_audioTicks = 0;
+    m_systemBaseUs = 0;
+    m_systemBaseTicks = -1;
+    m_paused = false;
+    m_pausedUs = -1;
+    m_drops = 0;
+    m_lastShowUs = -1;
+    m_waitPtsUs = -1;
+    m_driftUs = 0;
+    m_driftValid = false;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_statistics.mode = m_mode;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void MediaClock::setMode(int mode, int64_t nowUs)
+{
+    int64_t clock;
+
+    pthread_mutex_lock(&m_mutex);
+    clock = masterLocked(nowUs);
+    m_mode = mode;
+    m_statistics.mode = mode;
+    if (clock >= 0 && !m_paused)
+        anchorLocked(clock, nowUs);
+    m_driftValid = false;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int64_t MediaClock::audioLocked(int64_t nowUs)
+{
+    int64_t elapsed;
+
+    if (m_audioUs < 0)
+        return -1;
+    elapsed = nowUs - m_audioTicks;
+    if (elapsed < 0)
+        elapsed = 0;
+    if (m_audioLimitUs > 0 && elapsed > m_audioLimitUs)
+        elapsed = m_audioLimitUs;
+    return m_audioUs + elapsed;
+}
+
+int64_t MediaClock::systemLocked(int64_t nowUs)
+{
+    if (m_systemBaseTicks < 0)
+        return -1;
+    return m_systemBaseUs + nowUs - m_systemBaseTicks;
+}
+
+int64_t MediaClock::masterLocked(int64_t nowUs)
+{
+    int64_t clock;
+
+    if (m_paused)
+        return m_pausedUs;
+    if (m_mode == MediaClockMode_Audio) {
+        clock = audioLocked(nowUs);
+        if (clock >= 0)
+            return clock;
+    }
+    return systemLocked(nowUs);
+}
+
+void MediaClock::anchorLocked(int64_t ptsUs, int64_t nowUs)
+{
+    m_systemBaseUs = ptsUs;
+    m_systemBaseTicks = nowUs;
+}
+
+void MediaClock::setAudio(int64_t ptsUs, int64_t nowUs)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_audioUs = ptsUs;
+    m_audioTicks = nowUs;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void MediaClock::endAudio(int64_t nowUs)
+{
+    int64_t clock;
+
+    pthread_mutex_lock(&m_mutex);
+    clock = masterLocked(nowUs);
+    m_audioUs = -1;
+    m_driftValid = false;
+    if (clock >= 0)
+        anchorLocked(clock, nowUs);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void MediaClock::setExternal(int64_t referenceUs, int64_t nowUs)
+{
+    int64_t offset;
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_mode == MediaClockMode_External && !m_paused) {
+        if (m_systemBaseTicks < 0) {
+            anchorLocked(referenceUs, nowUs);
+        } else {
+            offset = referenceUs - systemLocked(nowUs);
+            if (offset > MEDIACLOCK_RESYNC_US || offset < -MEDIACLOCK_RESYNC_US) {
+                anchorLocked(referenceUs, nowUs);
+                m_statistics.resyncs++;
+            } else {
+                m_systemBaseUs += offset / MEDIACLOCK_EXTERNAL_WEIGHT;
+            }
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int64_t MediaClock::getUs(int64_t nowUs)
+{
+    int64_t clock;
+
+    pthread_mutex_lock(&m_mutex);
+    clock = masterLocked(nowUs);
+    pthread_mutex_unlock(&m_mutex);
+    return clock;
+}
+
+void MediaClock::start(int64_t ptsUs, int64_t nowUs)
+{
+    pthread_mutex_lock(&m_mutex);
+    if (masterLocked(nowUs) < 0)
+        anchorLocked(ptsUs, nowUs);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int64_t MediaClock::flush(int64_t nowUs)
+{
+    int64_t clock;
+
+    pthread_mutex_lock(&m_mutex);
+    clock = masterLocked(nowUs);
+    m_audioUs = -1;
+    m_systemBaseTicks = -1;
+    m_drops = 0;
+    m_lastShowUs = -1;
+    m_waitPtsUs = -1;
+    m_driftValid = false;
+    if (m_paused)
+        m_pausedUs = clock >= 0 ? clock : 0;
+    pthread_mutex_unlock(&m_mutex);
+    return clock;
+}
+
+void MediaClock::setPaused(bool paused, int64_t nowUs)
+{
+    pthread_mutex_lock(&m_mutex);
+    if (paused && !m_paused) {
+        m_pausedUs = masterLocked(nowUs);
+        m_paused = true;
+    } else if (!paused && m_paused) {
+        /* 从暂停的位置继续，音频时钟等下一次回调更新 */
+        if (m_pausedUs >= 0 && m_systemBaseTicks >= 0)
+            anchorLocked(m_pausedUs, nowUs);
+        m_audioTicks = nowUs;
+        m_paused = false;
+        m_pausedUs = -1;
+        m_lastShowUs = -1;
+        m_driftValid = false;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int MediaClock::syncVideo(int64_t ptsUs, int64_t durationUs, bool hasNext, int64_t nowUs, int64_t* waitUs)
+{
+    int64_t clock, diff, late = durationUs > MEDIACLOCK_SYNC_THRESHOLD_US ? durationUs : MEDIACLOCK_SYNC_THRESHOLD_US;
+
+    pthread_mutex_lock(&m_mutex);
+    clock = masterLocked(nowUs);
+    if (clock < 0) {
+        anchorLocked(ptsUs, nowUs);
+        clock = ptsUs;
+    }
+    diff = ptsUs - clock;
+
+    if (diff > MEDIACLOCK_RESYNC_US || diff < -MEDIACLOCK_RESYNC_US) {
+        /* 时间戳跳变：音频主时钟时以音频为准，只是不等待；否则按这一帧重新开始 */
+        m_statistics.resyncs++;
+        if (m_mode != MediaClockMode_Audio || audioLocked(nowUs) < 0)
+            anchorLocked(ptsUs, nowUs);
+        diff = 0;
+    } else if (diff > MEDIACLOCK_SYNC_THRESHOLD_US) {
+        /* 上一帧已经显示了一个帧间隔以上还要等，算作重复一次 */
+        if (m_lastShowUs >= 0 && nowUs - m_lastShowUs > durationUs + MEDIACLOCK_SYNC_THRESHOLD_US && ptsUs != m_waitPtsUs) {
+            m_statistics.duplicatedFrames++;
+            m_waitPtsUs = ptsUs;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        if (waitUs)
+            *waitUs = diff;
+        return MediaClockVideo_Wait;
+    } else if (diff < -late && hasNext && m_drops < MEDIACLOCK_DROP_MAX) {
+        m_drops++;
+        m_statistics.droppedFrames++;
+        pthread_mutex_unlock(&m_mutex);
+        return MediaClockVideo_Drop;
+    }
+
+    m_drops = 0;
+    m_lastShowUs = nowUs;
+    m_statistics.shownFrames++;
+    m_statistics.syncErrorUs = diff;
+    if (diff < 0)
+        diff = -diff;
+    m_statistics.syncErrorAvgUs += (diff - m_statistics.syncErrorAvgUs) / MEDIACLOCK_ERROR_WEIGHT;
+    if (diff > m_statistics.syncErrorMaxUs)
+        m_statistics.syncErrorMaxUs = diff;
+    pthread_mutex_unlock(&m_mutex);
+    return MediaClockVideo_Show;
+}
+
+int MediaClock::getAudioSkew(int64_t nowUs)
+{
+    int64_t audio, master, drift, excess;
+    int skew = 0;
+
+    pthread_mutex_lock(&m_mutex);
+    audio = audioLocked(nowUs);
+    master = systemLocked(nowUs);
+    if (m_mode == MediaClockMode_Audio || m_paused || audio < 0 || master < 0) {
+        m_driftValid = false;
+    } else {
+        drift = audio - master;
+        if (drift > MEDIACLOCK_RESYNC_US || drift < -MEDIACLOCK_RESYNC_US) {
+            m_driftValid = false;           //时间戳跳变，微调没有意义
+        } else {
+            m_driftUs = m_driftValid ? m_driftUs + (drift - m_driftUs) / MEDIACLOCK_DRIFT_WEIGHT : drift;
+            m_driftValid = true;
+            m_statistics.audioDriftUs = m_driftUs;
+
+            /* 音频落后时加快(正数)，超前时放慢 */
+            excess = (m_driftUs < 0 ? -m_driftUs : m_driftUs) - MEDIACLOCK_SKEW_DEADBAND_US;
+            if (excess > 0) {
+                excess = excess * 1000000 / MEDIACLOCK_SKEW_TIME_US;
+                if (excess > MEDIACLOCK_SKEW_MAX_PPM)
+                    excess = MEDIACLOCK_SKEW_MAX_PPM;
+                skew = (int)(m_driftUs < 0 ? excess : -excess);
+            }
+        }
+    }
+    m_statistics.audioSkewPpm = skew;
+    pthread_mutex_unlock(&m_mutex);
+    return skew;
+}
+
+MediaClockStatistics MediaClock::getStatistics()
+{
+    MediaClockStatistics statistics;
+
+    pthread_mutex_lock(&m_mutex);
+    statistics = m_statistics;
+    pthread_mutex_unlock(&m_mutex);
+    return statistics;
+}
+
+
+MediaClock_Type MediaClockCreate(int mode)
+{
+    return new MediaClock(mode);
+}
+
+void MediaClockDestroy(MediaClock_Type clock)
+{
+    delete clock;
+}
+
+int64_t MediaClockNowUs(void)
+{
+    return MediaClock::nowUs();
+}
+
+void MediaClockSetAudio(MediaClock_Type clock, int64_t ptsUs, int64_t nowUs)
+{
+    clock->setAudio(ptsUs, nowUs);
+}
+
+void MediaClockSetExternal(MediaClock_Type clock, int64_t referenceUs, int64_t nowUs)
+{
+    clock->setExternal(referenceUs, nowUs);
+}
+
+int64_t MediaClockGetUs(MediaClock_Type clock, int64_t nowUs)
+{
+    return clock->getUs(nowUs);
+}
+
+int MediaClockSyncVideo(MediaClock_Type clock, int64_t ptsUs, int64_t durationUs, int hasNext, int64_t nowUs, int64_t* waitUs)
+{
+    return clock->syncVideo(ptsUs, durationUs, hasNext != 0, nowUs, waitUs);
+}
+
+int MediaClockGetAudioSkew(MediaClock_Type clock, int64_t nowUs)
+{
+    return clock->getAudioSkew(nowUs);
+}
+
+void MediaClockSetPaused(MediaClock_Type clock, int paused, int64_t nowUs)
+{
+    clock->setPaused(paused != 0, nowUs);
+}
+
+int64_t MediaClockFlush(MediaClock_Type clock, int64_t nowUs)
+{
+    return clock->flush(nowUs);
+}
+
+void MediaClockGetStatistics(MediaClock_Type clock, MediaClockStatistics* statistics)
+{
+    *statistics = clock->getStatistics();
+}
@@ -0,0 +1,178 @@
+#ifndef __MEDIA_CLOCK_H__
+#define __MEDIA_CLOCK_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#include <pthread.h>
+#endif
+
+
+#define     MEDIACLOCK_SYNC_THRESHOLD_US    10000       //视频比主时钟早这么多以内就显示
+#define     MEDIACLOCK_RESYNC_US            3000000     //误差超过这么多认为时间戳跳变，按新的时间戳重新开始，不追帧
+#define     MEDIACLOCK_AUDIO_LIMIT_US       100000      //两次音频更新之间最多外推这么久，回调停了时钟也停
+#define     MEDIACLOCK_DROP_MAX             8           //连续丢帧的上限，一直落后时画面也要更新
+#define     MEDIACLOCK_EXTERNAL_WEIGHT      8           //外部参考(PCR/NTP)每次只修正误差的 1/8，平滑网络抖动
+#define     MEDIACLOCK_SKEW_MAX_PPM         2000        //音频重采样微调的范围，听不出音调变化
+#define     MEDIACLOCK_SKEW_DEADBAND_US     5000        //音频误差在这个以内不微调
+#define     MEDIACLOCK_SKEW_TIME_US         10000000    //按多长时间消除音频误差来计算微调量
+#define     MEDIACLOCK_DRIFT_WEIGHT         8           //音频误差的平滑
+#define     MEDIACLOCK_ERROR_WEIGHT         16          //同步误差平均值的平滑
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 主时钟 */
+typedef enum {
+    MediaClockMode_Audio = 0,       //音频设备播放的位置，视频跟随；没有音频或音频结束时用系统时钟
+    MediaClockMode_Video,           //从第一帧开始按系统时间走，音频用重采样微调跟随
+    MediaClockMode_External,        //外部参考(TS 的 PCR、RTCP 的 NTP 换算为媒体时间)，音频和视频都跟随
+} MediaClockMode;
+
+/* syncVideo 的结果 */
+typedef enum {
+    MediaClockVideo_Show = 0,       //现在显示
+    MediaClockVideo_Wait,           //还没到时间，上一帧继续显示
+    MediaClockVideo_Drop,           //太晚，不显示
+} MediaClockVideoAction;
+
+typedef struct _MediaClockStatistics {
+    int64_t         syncErrorUs;        //最近显示的帧相对主时钟，正数为视频早
+    int64_t         syncErrorAvgUs;     //绝对值的平均
+    int64_t         syncErrorMaxUs;     //绝对值的最大值
+    int64_t         audioDriftUs;       //非音频主时钟时音频相对主时钟(平滑后)，正数为音频早
+    int64_t         shownFrames;
+    int64_t         droppedFrames;      //落后一帧以上而丢弃
+    int64_t         duplicatedFrames;   //等主时钟时上一帧已经显示超过一个帧间隔(音频卡住、视频超前)
+    int64_t         resyncs;            //时间戳跳变或外部参考跳变，重新对齐
+    int             audioSkewPpm;       //最近一次给音频重采样的微调
+    int             mode;
+} MediaClockStatistics;
+
+/* 给 C 代码(ffplay.c 派生的播放器)使用的接口，时间都是微秒，nowUs 为调用者的单调时间 */
+typedef struct MediaClock* MediaClock_Type;
+
+MediaClock_Type MediaClockCreate(int mode);
+void MediaClockDestroy(MediaClock_Type clock);
+int64_t MediaClockNowUs(void);
+void MediaClockSetAudio(MediaClock_Type clock, int64_t ptsUs, int64_t nowUs);
+void MediaClockSetExternal(MediaClock_Type clock, int64_t referenceUs, int64_t nowUs);
+int64_t MediaClockGetUs(MediaClock_Type clock, int64_t nowUs);
+int MediaClockSyncVideo(MediaClock_Type clock, int64_t ptsUs, int64_t durationUs, int hasNext, int64_t nowUs, int64_t* waitUs);
+int MediaClockGetAudioSkew(MediaClock_Type clock, int64_t nowUs);
+void MediaClockSetPaused(MediaClock_Type clock, int paused, int64_t nowUs);
+int64_t MediaClockFlush(MediaClock_Type clock, int64_t nowUs);
+void MediaClockGetStatistics(MediaClock_Type clock, MediaClockStatistics* statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#ifdef __cplusplus
+
+struct MediaClock { /* 播放器共用的主时钟：音频、系统(视频或外部参考驱动)两个时钟按模式选择，决定视频的显示、丢弃，给出音频的重采样微调 */
+    public:
+        MediaClock(int mode = MediaClockMode_Audio);
+        ~MediaClock();
+
+        void setMode(int mode, int64_t nowUs);  //切换时主时钟从当前值接着走
+        int getMode() { return m_mode; }
+        void setAudioLimitUs(int64_t limitUs) { m_audioLimitUs = limitUs; }    //一般为设备缓冲区的时长
+        void reset();                       //关闭时调用，所有时钟未知，取消暂停，统计清零
+        static int64_t nowUs();             //CLOCK_MONOTONIC，调用者也可以用自己的单调时间，前后一致即可
+
+        /**
+         *  @Func: setAudio
+         *         ps. :音频回调中调用，ptsUs 为此刻从设备出来的位置(已经减去设备缓冲区)
+         *  @Param: ptsUs, type:: int64_t
+         *  @Param: nowUs, type:: int64_t
+         *
+         **/
+        void setAudio(int64_t ptsUs, int64_t nowUs);
+        void endAudio(int64_t nowUs);       //音频结束，系统时钟从主时钟的当前值接着走
+
+        /**
+         *  @Func: setExternal
+         *         ps. :外部参考模式下调整系统时钟，每次修正误差的 1/MEDIACLOCK_EXTERNAL_WEIGHT，跳变时直接对齐；
+         *               其他模式下忽略
+         *  @Param: referenceUs, type:: int64_t, PCR 或 NTP 换算到和 pts 相同的时间轴
+         *  @Param: nowUs, type:: int64_t, 参考时间到达的时刻
+         *
+         **/
+        void setExternal(int64_t referenceUs, int64_t nowUs);
+
+        int64_t getUs(int64_t nowUs);       //主时钟，未知返回 -1
+        void start(int64_t ptsUs, int64_t nowUs);   //主时钟未知时系统时钟从 ptsUs 开始走
+
+        /**
+         *  @Func: flush
+         *         ps. :seek 时调用，之后时钟从第一个到达的音频或视频重新开始；暂停时保持暂停，位置为返回值
+         *  @Param: nowUs, type:: int64_t
+         *  @Return: int64_t, flush 之前的主时钟，未知返回 -1
+         *
+         **/
+        int64_t flush(int64_t nowUs);
+        void setPaused(bool paused, int64_t nowUs);
+        bool isPaused() { return m_paused; }
+
+        /**
+         *  @Func: syncVideo
+         *         ps. :主时钟未知时从这一帧开始；早 MEDIACLOCK_SYNC_THRESHOLD_US 以上等待，晚一帧以上并且后面还有帧时丢弃，
+         *               连续丢弃 MEDIACLOCK_DROP_MAX 帧之后显示一帧；误差超过 MEDIACLOCK_RESYNC_US 时立即显示，
+         *               非音频主时钟时按这一帧重新对齐
+         *  @Param: ptsUs, type:: int64_t
+         *  @Param: durationUs, type:: int64_t, 帧间隔
+         *  @Param: hasNext, type:: bool, 后面是否已经有解码好的帧，没有时不丢弃
+         *  @Param: nowUs, type:: int64_t
+         *  @Param: waitUs, type:: int64_t*, Wait 时为距离显示的时间，可以为 NULL
+         *  @Return: int, MediaClockVideoAction
+         *
+         **/
+        int syncVideo(int64_t ptsUs, int64_t durationUs, bool hasNext, int64_t nowUs, int64_t* waitUs);
+
+        /**
+         *  @Func: getAudioSkew
+         *         ps. :非音频主时钟时，按音频相对主时钟的误差给出 AudioResampler::setSkew 的值，正数使音频走得快；
+         *               比例控制，误差在死区以内为 0；音频主时钟、暂停或者时钟未知时为 0
+         *  @Param: nowUs, type:: int64_t
+         *  @Return: int, 百万分之一
+         *
+         **/
+        int getAudioSkew(int64_t nowUs);
+
+        MediaClockStatistics getStatistics();
+
+    private:
+        MediaClock(const MediaClock&);
+        MediaClock& operator=(const MediaClock&);
+
+        int64_t masterLocked(int64_t nowUs);
+        int64_t audioLocked(int64_t nowUs);
+        int64_t systemLocked(int64_t nowUs);
+        void anchorLocked(int64_t ptsUs, int64_t nowUs);
+
+        pthread_mutex_t         m_mutex;            //保护以下成员
+        int                     m_mode;
+        int64_t                 m_audioUs;          //-1 为未知或已经结束
+        int64_t                 m_audioTicks;
+        int64_t                 m_audioLimitUs;
+        int64_t                 m_systemBaseUs;     //系统时钟：m_systemBaseUs + (now - m_systemBaseTicks)
+        int64_t                 m_systemBaseTicks;  //-1 为未开始
+        bool                    m_paused;
+        int64_t                 m_pausedUs;         //暂停时的主时钟，-1 为未知
+        int                     m_drops;            //连续丢弃的帧数
+        int64_t                 m_lastShowUs;       //上一帧显示的时刻，-1 为没有
+        int64_t                 m_waitPtsUs;        //已经算作重复的帧，每帧只算一次
+        int64_t                 m_driftUs;          //平滑后的音频误差
+        bool                    m_driftValid;
+        MediaClockStatistics    m_statistics;
+};
+
+#endif  // __cplusplus
+
+
+
+#endif //__MEDIA_CLOCK_H__
@@ -0,0 +1,655 @@
+/**
+ *  MosaicPlayer.cpp文件
+ *  多路画中画/马赛克播放；
+ *  主要有以下部分：
+ *      1. 调度：每个 tile 同一时间最多一个解码任务，在公共的线程池中执行，一个任务读到保留一帧为止；
+ *         焦点 tile 先排，其余按等待合成的帧数从少到多，9 路不再需要 9 套解复用/解码/转换线程
+ *      2. 降级：非焦点 tile 跳过非参考帧(AVDISCARD_NONREF)，帧率超过 MOSAIC_BACKGROUND_FPS 的帧不缩放；
+ *         码流比 tile 大很多时用解码器的 lowres 直接输出低分辨率
+ *      3. 合成：解码线程把帧缩放到 tile 的大小，显示线程按各 tile 自己的时钟取到期的帧，复制到一个 YUV420P 画面，
+ *         只更新一次纹理
+ *      4. 内存：解码器和缩放后的帧都从共用的 VideoFramePool 取，增删 tile、改变大小时 surface 回到池中复用
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <string.h>
+#include <stdlib.h>
+
+//Linux...
+extern "C" {
+#include "LogPlayer.h"
+};
+
+#include "MosaicPlayer.h"
+
+
+static const AVRational gMicrosecond = { 1, 1000000 };
+
+
+static int64_t MosaicNowUs()
+{
+    static uint64_t frequency = 0;
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    if (frequency == 0)
+        frequency = SDL_GetPerformanceFrequency();
+    return (int64_t)(counter / frequency * 1000000 + counter % frequency * 1000000 / frequency);
+}
+
+static bool MosaicRectValid(const MosaicRect& rect, int width, int height)
+{
+    return rect.x >= 0 && rect.y >= 0 && rect.width >= 2 && rect.height >= 2
+        && rect.x + rect.width <= width && rect.y + rect.height <= height;
+}
+
+/* YUV420P 的色度平面是一半，位置和大小按 2 对齐 */
+static MosaicRect MosaicRectAlign(const MosaicRect& rect)
+{
+    MosaicRect aligned;
+
+    aligned.x = rect.x & ~1;
+    aligned.y = rect.y & ~1;
+    aligned.width = rect.width & ~1;
+    aligned.height = rect.height & ~1;
+    return aligned;
+}
+
+
+MosaicPlayer::MosaicPlayer(int threads)
+    : m_pool(NULL)
+    , m_framePool(VideoFramePool::shared())
+    , m_threads(threads)
+    , m_focus(-1)
+    , m_width(0)
+    , m_height(0)
+    , m_surfaceDirty(false)
+    , m_texture(NULL)
+{
+    int i;
+
+    memset(m_tiles, 0, sizeof(m_tiles));
+    memset(&m_surface, 0, sizeof(m_surface));
+    for (i = 0; i < MOSAIC_TILES_MAX; i++) {
+        m_tiles[i].owner = this;
+        m_tiles[i].index = i;
+        m_tiles[i].mutex = ThreadMutexCreate();
+    }
+
+    if (m_threads <= 0)
+        m_threads = SDL_GetCPUCount();
+    if (m_threads < 1)
+        m_threads = 1;
+    m_pool = threadpool_create(m_threads, MOSAIC_TILES_MAX, 0);
+    if (m_pool == NULL)
+        playerLogWarning("MosaicPlayer threadpool create failed, decode in compose().\n");
+}
+
+MosaicPlayer::~MosaicPlayer()
+{
+    int i;
+
+    close();
+    if (m_pool)
+        threadpool_destroy(m_pool, threadpool_graceful);
+    for (i = 0; i < MOSAIC_TILES_MAX; i++)
+        ThreadMutexDestroy(m_tiles[i].mutex);
+}
+
+int MosaicPlayer::open(int width, int height)
+{
+    width &= ~1;
+    height &= ~1;
+    if (width <= 0 || height <= 0)
+        return -1;
+    if (m_surface.data[0])
+        avpicture_free(&m_surface);
+    if (avpicture_alloc(&m_surface, PIX_FMT_YUV420P, width, height) < 0) {
+        playerLogError("MosaicPlayer surface %dx%d alloc failed.\n", width, height);
+        memset(&m_surface, 0, sizeof(m_surface));
+        return -1;
+    }
+    m_width = width;
+    m_height = height;
+
+    /* 没有 tile 的地方为黑色 */
+    MosaicRect whole = { 0, 0, width, height };
+    clearRect(whole);
+    m_surfaceDirty = true;
+    return 0;
+}
+
+void MosaicPlayer::close()
+{
+    int i;
+
+    for (i = 0; i < MOSAIC_TILES_MAX; i++)
+        removeTile(i);
+    if (m_texture) {
+        SDL_DestroyTexture(m_texture);
+        m_texture = NULL;
+    }
+    if (m_surface.data[0])
+        avpicture_free(&m_surface);
+    memset(&m_surface, 0, sizeof(m_surface));
+    m_width = m_height = 0;
+    m_focus = -1;
+}
+
+MosaicRect MosaicPlayer::gridRect(int width, int height, int rows, int cols, int index)
+{
+    MosaicRect rect;
+    int cellWidth = cols > 0 ? width / cols : width;
+    int cellHeight = rows > 0 ? height / rows : height;
+
+    rect.x = cols > 0 ? index % cols * cellWidth : 0;
+    rect.y = cols > 0 ? index / cols * cellHeight : 0;
+    rect.width = cellWidth;
+    rect.height = cellHeight;
+    return MosaicRectAlign(rect);
+}
+
+MosaicRect MosaicPlayer::pipRect(int width, int height, int scale)
+{
+    MosaicRect rect;
+
+    if (scale < 2)
+        scale = 2;
+    rect.width = width / scale;
+    rect.height = height / scale;
+    rect.x = width - rect.width - width / 32;
+    rect.y = height - rect.height - height / 32;
+    return MosaicRectAlign(rect);
+}
+
+int MosaicPlayer::addTile(const char* url, const MosaicRect& rect)
+{
+    MosaicRect aligned = MosaicRectAlign(rect);
+    Tile* tile = NULL;
+    int i;
+
+    if (m_surface.data[0] == NULL || !MosaicRectValid(aligned, m_width, m_height)) {
+        playerLogError("MosaicPlayer tile [%d,%d %dx%d] out of surface %dx%d.\n",
+                       rect.x, rect.y, rect.width, rect.height, m_width, m_height);
+        return -1;
+    }
+    for (i = 0; i < MOSAIC_TILES_MAX && tile == NULL; i++) {
+        if (!m_tiles[i].used)
+            tile = &m_tiles[i];
+    }
+    if (tile == NULL) {
+        playerLogError("MosaicPlayer tiles full [%d].\n", MOSAIC_TILES_MAX);
+        return -1;
+    }
+
+    tile->used = true;
+    tile->rect = aligned;
+    if (openTile(tile, url) < 0) {
+        closeTile(tile);
+        tile->used = false;
+        return -1;
+    }
+    tile->focused = (tile->index == m_focus);
+    tile->opened = true;
+    playerLogInfo("MosaicPlayer tile [%d] %s, %dx%d lowres[%d] -> [%d,%d %dx%d]\n", tile->index, url,
+                  tile->codec->width, tile->codec->height, tile->statistics.lowres,
+                  aligned.x, aligned.y, aligned.width, aligned.height);
+    return tile->index;
+}
+
+int MosaicPlayer::openTile(Tile* tile, const char* url)
+{
+    AVCodecContext* codecCtx;
+    AVCodec* codec;
+    unsigned int i;
+    int lowres = 0;
+
+    if (avformat_open_input(&tile->format, url, NULL, NULL) != 0) {
+        playerLogError("Couldn't open input stream, url[%s].\n", url);
+        tile->format = NULL;
+        return -1;
+    }
+    if (avformat_find_stream_info(tile->format, NULL) < 0) {
+        playerLogError("Couldn't find stream information.\n");
+        return -1;
+    }
+    tile->videoIndex = -1;
+    for (i = 0; i < tile->format->nb_streams && tile->videoIndex < 0; i++) {
+        if (tile->format->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            tile->videoIndex = i;
+    }
+    if (tile->videoIndex < 0) {
+        playerLogError("Didn't find a video stream.\n");
+        return -1;
+    }
+    tile->startTime = tile->format->start_time != (int64_t)AV_NOPTS_VALUE ? tile->format->start_time : 0;
+
+    codecCtx = tile->format->streams[tile->videoIndex]->codec;
+    codec = avcodec_find_decoder(codecCtx->codec_id);
+    if (codec == NULL) {
+        playerLogError("Codec not found.\n");
+        return -1;
+    }
+    /* 线程由线程池统一分配，解码器自己不再开线程；lowres 只能在打开之前设置 */
+    codecCtx->thread_count = 1;
+    while (lowres < codec->max_lowres && (codecCtx->width >> (lowres + 1)) >= tile->rect.width
+           && (codecCtx->height >> (lowres + 1)) >= tile->rect.height)
+        lowres++;
+    codecCtx->lowres = lowres;
+    VideoFramePool::attachDecoder(codecCtx, codec, m_framePool);
+    if (avcodec_open2(codecCtx, codec, NULL) < 0) {
+        playerLogError("Could not open codec.\n");
+        return -1;
+    }
+    tile->codec = codecCtx;
+    tile->statistics.lowres = lowres;
+
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+    tile->decoded = av_frame_alloc();
+#else
+    tile->decoded = avcodec_alloc_frame();
+#endif
+    tile->convert = new ImageConvert(1);
+    if (tile->decoded == NULL || !allocFrames(tile))
+        return -1;
+    return 0;
+}
+
+bool MosaicPlayer::allocFrames(Tile* tile)
+{
+    TileFrame* frame;
+    int i;
+
+    for (i = 0; i < MOSAIC_TILE_FRAMES; i++) {
+        frame = &tile->frames[i];
+        m_framePool->release(frame->surface);
+        memset(frame, 0, sizeof(*frame));
+        frame->surface = m_framePool->acquire(PIX_FMT_YUV420P, tile->rect.width, tile->rect.height);
+        if (frame->surface == NULL) {
+            playerLogError("MosaicPlayer tile frame %dx%d alloc failed.\n", tile->rect.width, tile->rect.height);
+            return false;
+        }
+        memcpy(frame->picture.data, frame->surface->data, sizeof(frame->picture.data));
+        memcpy(frame->picture.linesize, frame->surface->linesize, sizeof(frame->picture.linesize));
+        frame->width = tile->rect.width;
+        frame->height = tile->rect.height;
+    }
+    tile->readyHead = 0;
+    tile->ready = 0;
+    tile->lastKeptUs = -1;
+    tile->clockBaseTicks = -1;
+    return true;
+}
+
+void MosaicPlayer::closeTile(Tile* tile)
+{
+    int i;
+
+    if (tile->codec) {
+        avcodec_close(tile->codec);
+        tile->codec = NULL;
+    }
+    if (tile->format) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+        avformat_close_input(&tile->format);
+#else
+        av_close_input_file(tile->format);
+        tile->format = NULL;
+#endif
+    }
+    if (tile->decoded) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+        av_frame_free(&tile->decoded);
+#else
+        av_free(tile->decoded);
+#endif
+        tile->decoded = NULL;
+    }
+    delete tile->convert;
+    tile->convert = NULL;
+    for (i = 0; i < MOSAIC_TILE_FRAMES; i++)
+        m_framePool->release(tile->frames[i].surface);
+    memset(tile->frames, 0, sizeof(tile->frames));
+    memset(&tile->statistics, 0, sizeof(tile->statistics));
+    tile->readyHead = tile->ready = 0;
+    tile->opened = tile->ended = tile->removing = tile->focused = false;
+}
+
+void MosaicPlayer::waitIdle(Tile* tile)
+{
+    /* 任务可能还在线程池的队列中，removing 让它尽快返回 */
+    while (tile->busy)
+        SDL_Delay(1);
+}
+
+void MosaicPlayer::removeTile(int index)
+{
+    Tile* tile;
+
+    if (index < 0 || index >= MOSAIC_TILES_MAX || !m_tiles[index].used)
+        return;
+    tile = &m_tiles[index];
+    tile->removing = true;
+    waitIdle(tile);
+    if (tile->opened && m_surface.data[0])
+        clearRect(tile->rect);
+    closeTile(tile);
+    tile->used = false;
+    m_surfaceDirty = true;
+}
+
+int MosaicPlayer::setRect(int index, const MosaicRect& rect)
+{
+    MosaicRect aligned = MosaicRectAlign(rect);
+    Tile* tile;
+
+    if (index < 0 || index >= MOSAIC_TILES_MAX || !m_tiles[index].opened || !MosaicRectValid(aligned, m_width, m_height))
+        return -1;
+    tile = &m_tiles[index];
+    waitIdle(tile);
+    tile->rect = aligned;
+    m_surfaceDirty = true;
+    return allocFrames(tile) ? 0 : -1;
+}
+
+void MosaicPlayer::setFocus(int index)
+{
+    int i;
+
+    if (index == m_focus)
+        return;
+    /* 旧焦点的边框在下一帧复制时覆盖 */
+    for (i = 0; i < MOSAIC_TILES_MAX; i++)
+        m_tiles[i].focused = (i == index);
+    m_focus = index;
+    m_surfaceDirty = true;
+}
+
+int MosaicPlayer::getTileCount()
+{
+    int i, count = 0;
+
+    for (i = 0; i < MOSAIC_TILES_MAX; i++) {
+        if (m_tiles[i].opened)
+            count++;
+    }
+    return count;
+}
+
+const MosaicTileStatistics* MosaicPlayer::getStatistics(int index)
+{
+    if (index < 0 || index >= MOSAIC_TILES_MAX || !m_tiles[index].opened)
+        return NULL;
+    return &m_tiles[index].statistics;
+}
+
+void MosaicPlayer::decodeTask(void* arg)
+{
+    Tile* tile = (Tile*)arg;
+
+    tile->owner->decodeTile(tile);
+    __sync_synchronize();
+    tile->busy = false;
+}
+
+void MosaicPlayer::decodeTile(Tile* tile)
+{
+    int64_t startUs = MosaicNowUs();
+    AVPacket packet;
+    int i, gotPicture;
+
+    for (i = 0; i < MOSAIC_TASK_PACKETS && !tile->removing; i++) {
+        if (av_read_frame(tile->format, &packet) < 0) {
+            /* 取出解码器中剩下的帧 */
+            av_init_packet(&packet);
+            packet.data = NULL;
+            packet.size = 0;
+            gotPicture = 0;
+            if (avcodec_decode_video2(tile->codec, tile->decoded, &gotPicture, &packet) >= 0 && gotPicture) {
+                tile->statistics.decodedFrames++;
+                if (outputFrame(tile))
+                    break;
+                continue;
+            }
+            tile->ended = true;
+            break;
+        }
+        if (packet.stream_index != tile->videoIndex) {
+            av_free_packet(&packet);
+            continue;
+        }
+        tile->statistics.packets++;
+
+        /* 非焦点只解码参考帧，帧率降低但后面的帧不受影响；每个 packet 之前设置，焦点切换立即生效 */
+        tile->codec->skip_frame = tile->focused ? AVDISCARD_DEFAULT : AVDISCARD_NONREF;
+        gotPicture = 0;
+        if (avcodec_decode_video2(tile->codec, tile->decoded, &gotPicture, &packet) < 0)
+            gotPicture = 0;
+        av_free_packet(&packet);
+        if (gotPicture) {
+            tile->statistics.decodedFrames++;
+            if (outputFrame(tile))
+                break;
+        }
+    }
+    tile->statistics.decodeUs += MosaicNowUs() - startUs;
+}
+
+bool MosaicPlayer::outputFrame(Tile* tile)
+{
+    AVStream* stream = tile->format->streams[tile->videoIndex];
+    TileFrame* frame;
+    int64_t timestamp, ptsUs = -1;
+    int slot;
+
+    timestamp = tile->decoded->best_effort_timestamp;
+    if (timestamp == (int64_t)AV_NOPTS_VALUE)
+        timestamp = tile->decoded->pkt_pts;
+    if (timestamp != (int64_t)AV_NOPTS_VALUE)
+        ptsUs = av_rescale_q(timestamp, stream->time_base, gMicrosecond) - tile->startTime;
+
+    /* 非焦点限制帧率，省掉缩放 */
+    if (!tile->focused && ptsUs >= 0 && tile->lastKeptUs >= 0 && ptsUs >= tile->lastKeptUs
+        && ptsUs - tile->lastKeptUs < 1000000 / MOSAIC_BACKGROUND_FPS) {
+        tile->statistics.droppedFrames++;
+        return false;
+    }
+
+    ThreadMutexLock(tile->mutex);
+    slot = tile->ready < MOSAIC_TILE_FRAMES ? (tile->readyHead + tile->ready) % MOSAIC_TILE_FRAMES : -1;
+    ThreadMutexUnLock(tile->mutex);
+    if (slot < 0)
+        return false;
+
+    /* 队列之外的位置只有解码一侧使用，缩放时不用加锁 */
+    frame = &tile->frames[slot];
+    if (tile->convert->convert((const AVPicture*)tile->decoded, tile->codec->pix_fmt, tile->codec->width, tile->codec->height,
+                               &frame->picture, PIX_FMT_YUV420P, frame->width, frame->height,
+                               tile->focused ? SWS_BICUBIC : SWS_FAST_BILINEAR) < 0)
+        return false;
+    frame->ptsUs = ptsUs;
+    tile->lastKeptUs = ptsUs;
+
+    ThreadMutexLock(tile->mutex);
+    tile->ready++;
+    ThreadMutexUnLock(tile->mutex);
+    return true;
+}
+
+bool MosaicPlayer::takeFrame(Tile* tile, int64_t nowUs)
+{
+    TileFrame* frame;
+    int64_t clock;
+    int head, ready, due;
+
+    ThreadMutexLock(tile->mutex);
+    head = tile->readyHead;
+    ready = tile->ready;
+    ThreadMutexUnLock(tile->mutex);
+    if (ready == 0)
+        return false;
+
+    /* 每个 tile 有自己的时钟，第一帧、没有时间戳和跳变时重新对齐 */
+    frame = &tile->frames[head];
+    clock = tile->clockBaseUs + nowUs - tile->clockBaseTicks;
+    if (tile->clockBaseTicks < 0 || frame->ptsUs < 0
+        || frame->ptsUs - clock > MOSAIC_RESYNC_US || clock - frame->ptsUs > MOSAIC_RESYNC_US) {
+        tile->clockBaseUs = frame->ptsUs;
+        tile->clockBaseTicks = nowUs;
+        clock = frame->ptsUs;
+    }
+
+    for (due = 0; due < ready; due++) {
+        if (tile->frames[(head + due) % MOSAIC_TILE_FRAMES].ptsUs > clock)
+            break;
+    }
+    if (due == 0)
+        return false;
+
+    /* 只显示到期的最后一帧，之前的算作丢弃 */
+    copyFrame(tile, &tile->frames[(head + due - 1) % MOSAIC_TILE_FRAMES]);
+    tile->statistics.shownFrames++;
+    tile->statistics.droppedFrames += due - 1;
+
+    ThreadMutexLock(tile->mutex);
+    tile->readyHead = (head + due) % MOSAIC_TILE_FRAMES;
+    tile->ready -= due;
+    ThreadMutexUnLock(tile->mutex);
+    return true;
+}
+
+void MosaicPlayer::copyFrame(Tile* tile, TileFrame* frame)
+{
+    const MosaicRect& rect = tile->rect;
+    int plane, row, shift, width, height;
+    uint8_t* dst;
+    const uint8_t* src;
+
+    if (frame->width != rect.width || frame->height != rect.height)
+        return;
+    for (plane = 0; plane < 3; plane++) {
+        shift = plane ? 1 : 0;
+        width = rect.width >> shift;
+        height = rect.height >> shift;
+        dst = m_surface.data[plane] + (rect.y >> shift) * m_surface.linesize[plane] + (rect.x >> shift);
+        src = frame->picture.data[plane];
+        for (row = 0; row < height; row++) {
+            memcpy(dst, src, width);
+            dst += m_surface.linesize[plane];
+            src += frame->picture.linesize[plane];
+        }
+    }
+    if (tile->focused)
+        drawBorder(rect, 235);
+}
+
+void MosaicPlayer::clearRect(const MosaicRect& rect)
+{
+    int plane, row, shift;
+
+    for (plane = 0; plane < 3; plane++) {
+        shift = plane ? 1 : 0;
+        for (row = 0; row < rect.height >> shift; row++)
+            memset(m_surface.data[plane] + ((rect.y >> shift) + row) * m_surface.linesize[plane] + (rect.x >> shift),
+                   plane ? 128 : 16, rect.width >> shift);
+    }
+}
+
+void MosaicPlayer::drawBorder(const MosaicRect& rect, uint8_t luma)
+{
+    uint8_t* line;
+    int row, border = MOSAIC_BORDER;
+
+    if (border * 2 > rect.width || border * 2 > rect.height)
+        return;
+    /* 只画亮度，在 tile 内部，不影响相邻的 tile */
+    for (row = 0; row < rect.height; row++) {
+        line = m_surface.data[0] + (rect.y + row) * m_surface.linesize[0] + rect.x;
+        if (row < border || row >= rect.height - border) {
+            memset(line, luma, rect.width);
+        } else {
+            memset(line, luma, border);
+            memset(line + rect.width - border, luma, border);
+        }
+    }
+}
+
+void MosaicPlayer::schedule()
+{
+    Tile* order[MOSAIC_TILES_MAX];
+    Tile* tile;
+    int count = 0, i, j, ready;
+
+    for (i = 0; i < MOSAIC_TILES_MAX; i++) {
+        tile = &m_tiles[i];
+        if (!tile->opened || tile->busy || tile->ended || tile->removing)
+            continue;
+        ThreadMutexLock(tile->mutex);
+        ready = tile->ready;
+        ThreadMutexUnLock(tile->mutex);
+        if (ready >= MOSAIC_TILE_FRAMES)
+            continue;
+
+        /* 插入排序：焦点最前，其余按等待的帧数，线程池按提交的顺序执行 */
+        for (j = count; j > 0; j--) {
+            if (tile->focused || (!order[j - 1]->focused && order[j - 1]->ready > ready))
+                order[j] = order[j - 1];
+            else
+                break;
+        }
+        order[j] = tile;
+        count++;
+    }
+
+    for (i = 0; i < count; i++) {
+        tile = order[i];
+        tile->busy = true;
+        if (m_pool == NULL) {
+            decodeTask(tile);
+            continue;
+        }
+        if (threadpool_add(m_pool, decodeTask, tile, 0) != 0) {
+            tile->busy = false;
+            break;
+        }
+    }
+}
+
+bool MosaicPlayer::compose()
+{
+    int64_t nowUs = MosaicNowUs();
+    bool changed = m_surfaceDirty;
+    int i;
+
+    if (m_surface.data[0] == NULL)
+        return false;
+    for (i = 0; i < MOSAIC_TILES_MAX; i++) {
+        if (m_tiles[i].opened && takeFrame(&m_tiles[i], nowUs))
+            changed = true;
+    }
+    m_surfaceDirty = false;
+    schedule();
+    return changed;
+}
+
+int MosaicPlayer::render(SDL_Renderer* renderer)
+{
+    if (!compose() && m_texture)
+        return MOSAIC_IDLE_WAIT_MS;
+
+    if (m_texture == NULL) {
+        //IYUV: Y + U + V  (3 planes)
+        m_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, m_width, m_height);
+        if (m_texture == NULL) {
+            playerLogError("SDL_CreateTexture failed - %s\n", SDL_GetError());
+            return MOSAIC_IDLE_WAIT_MS;
+        }
+    }
+    SDL_UpdateYUVTexture(m_texture, NULL, m_surface.data[0], m_surface.linesize[0],
+                         m_surface.data[1], m_surface.linesize[1], m_surface.data[2], m_surface.linesize[2]);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, m_texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+    return 0;
+}
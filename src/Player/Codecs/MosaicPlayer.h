@@ -0,0 +1,167 @@
+#ifndef __MOSAIC_PLAYER_H__
+#define __MOSAIC_PLAYER_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+//Linux...
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <SDL2/SDL.h>
+#include "ThreadPool.h"
+};
+
+#include "ThreadMutex.h"
+#include "ImageConvert.h"
+#include "VideoFramePool.h"
+
+
+#define     MOSAIC_TILES_MAX            16
+#define     MOSAIC_TILE_FRAMES          3           //每个 tile 解码缩放之后等待合成的帧
+#define     MOSAIC_TASK_PACKETS         32          //一次解码任务最多读取的 packet，避免一个 tile 长时间占住线程
+#define     MOSAIC_BACKGROUND_FPS       12          //非焦点 tile 的最高帧率
+#define     MOSAIC_RESYNC_US            500000      //tile 落后时钟超过这么多时重新对齐，不追帧
+#define     MOSAIC_BORDER               2           //焦点 tile 边框的宽度，像素
+#define     MOSAIC_IDLE_WAIT_MS         5           //没有新帧时 render() 建议的等待时间
+
+
+typedef struct _MosaicRect {
+    int             x;
+    int             y;
+    int             width;
+    int             height;
+} MosaicRect;
+
+typedef struct _MosaicTileStatistics {
+    int64_t         packets;
+    int64_t         decodedFrames;
+    int64_t         droppedFrames;      //非焦点时超过帧率上限没有缩放的帧
+    int64_t         shownFrames;
+    int64_t         decodeUs;           //解码和缩放占用线程的时间
+    int             lowres;             //打开解码器时的 lowres
+} MosaicTileStatistics;
+
+
+class MosaicPlayer { /* 多路画中画/马赛克：所有 tile 共用一个解码线程池，非焦点 tile 降分辨率、跳过非参考帧，合成到一个输出画面 */
+    public:
+        MosaicPlayer(int threads = 0);      //解码线程数，0 时按 CPU 个数
+        ~MosaicPlayer();
+
+        /**
+         *  @Func: open
+         *         ps. :分配 YUV420P 的输出画面
+         *  @Param: width, type:: int
+         *  @Param: height, type:: int
+         *  @Return: int, 0 成功
+         *
+         **/
+        int open(int width, int height);
+        void close();
+
+        /**
+         *  @Func: addTile
+         *         ps. :按 tile 的大小选择 lowres，之后 setRect 变大时只能靠缩放；只解码视频，
+         *               焦点 tile 的声音由主播放器播放；增删 tile 和改变位置、焦点都与 compose() 在同一个线程
+         *  @Param: url, type:: const char*
+         *  @Param: rect, type:: const MosaicRect&, 在输出画面中的位置，坐标和大小按 2 对齐
+         *  @Return: int, tile 的编号，失败返回 -1
+         *
+         **/
+        int addTile(const char* url, const MosaicRect& rect);
+        void removeTile(int index);
+        int setRect(int index, const MosaicRect& rect);
+        void setFocus(int index);           //-1 为没有焦点
+        int getFocus() { return m_focus; }
+        int getTileCount();
+
+        /* 把输出画面按 rows * cols 等分，第 index 个格子的位置 */
+        static MosaicRect gridRect(int width, int height, int rows, int cols, int index);
+        /* 画中画：主画面占满，小画面在右下角，边长为主画面的 1/scale */
+        static MosaicRect pipRect(int width, int height, int scale);
+
+        /**
+         *  @Func: compose
+         *         ps. :在显示线程中调用；取出各 tile 到期的帧复制到输出画面，然后为空闲的 tile 安排解码任务，
+         *               焦点 tile 和等待的帧最少的 tile 先排
+         *  @Return: bool, 输出画面是否有变化
+         *
+         **/
+        bool compose();
+        int render(SDL_Renderer* renderer);     //compose 之后更新纹理，返回建议的等待毫秒数
+        const AVPicture* getSurface() { return &m_surface; }
+        const MosaicTileStatistics* getStatistics(int index);
+
+    private:
+        typedef struct _TileFrame {
+            AVPicture       picture;        //tile 大小的 YUV420P，指向 surface
+            VideoSurface*   surface;        //从帧池取，tile 关闭或改变大小时归还，别的 tile 和码流可以复用
+            int             width;
+            int             height;
+            int64_t         ptsUs;
+        } TileFrame;
+
+        typedef struct _Tile {
+            MosaicPlayer*           owner;
+            int                     index;
+            bool                    used;
+            AVFormatContext*        format;
+            AVCodecContext*         codec;
+            int                     videoIndex;
+            int64_t                 startTime;
+            AVFrame*                decoded;
+            ImageConvert*           convert;        //每个 tile 一个，缓存各自的 SwsContext
+            MosaicRect              rect;
+            volatile bool           focused;
+            volatile bool           busy;           //有任务在线程池中，同一时间只有一个线程解码该 tile
+            volatile bool           ended;
+            volatile bool           removing;
+            bool                    opened;
+
+            ThreadMutex_Type        mutex;          //保护以下的帧队列
+            TileFrame               frames[MOSAIC_TILE_FRAMES];
+            int                     readyHead;      //frames 用作环形队列：ready 个已解码
+            int                     ready;
+            int64_t                 lastKeptUs;     //非焦点时上一帧保留的时间戳
+
+            int64_t                 clockBaseUs;    //tile 的时钟：clockBaseUs + (now - clockBaseTicks)
+            int64_t                 clockBaseTicks; //-1 为还没有显示第一帧
+            MosaicTileStatistics    statistics;
+        } Tile;
+
+        MosaicPlayer(const MosaicPlayer&);
+        MosaicPlayer& operator=(const MosaicPlayer&);
+
+        int openTile(Tile* tile, const char* url);
+        void closeTile(Tile* tile);
+        bool allocFrames(Tile* tile);
+        static void decodeTask(void* arg);
+        void decodeTile(Tile* tile);
+        bool outputFrame(Tile* tile);
+        bool takeFrame(Tile* tile, int64_t nowUs);
+        void copyFrame(Tile* tile, TileFrame* frame);
+        void clearRect(const MosaicRect& rect);
+        void drawBorder(const MosaicRect& rect, uint8_t luma);
+        void schedule();
+        void waitIdle(Tile* tile);
+
+        threadpool_t*           m_pool;
+        VideoFramePool*         m_framePool;    //tile 的解码器和缩放后的帧共用
+        int                     m_threads;
+        Tile                    m_tiles[MOSAIC_TILES_MAX];
+        int                     m_focus;
+        AVPicture               m_surface;
+        int                     m_width;
+        int                     m_height;
+        bool                    m_surfaceDirty;
+        SDL_Texture*            m_texture;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__MOSAIC_PLAYER_H__
@@ -0,0 +1,161 @@
+#ifndef __PIPELINE_QUEUE_H__
+#define __PIPELINE_QUEUE_H__
+
+
+#ifdef __cplusplus
+
+//Linux...
+extern "C" {
+#include <SDL2/SDL.h>
+};
+
+
+#define     PIPELINE_QUEUE_WAIT_MS      10      //等待时的超时，防止丢失唤醒时一直阻塞
+
+
+/**
+ *  PipelineQueue
+ *      有界的单生产者单消费者队列，两个线程之间传递指针等小对象；
+ *      入队/出队只用内存屏障，不加锁；队列满/空时才在信号量上等待，对方只在有人等待时才 post
+ *
+ **/
+template <typename T>
+class PipelineQueue {
+    public:
+        PipelineQueue(int capacity)
+            : m_head(0), m_tail(0), m_aborted(0), m_consumerWaiting(0), m_producerWaiting(0)
+        {
+            m_capacity = 1;
+            while (m_capacity < (unsigned int)capacity)
+                m_capacity <<= 1;
+            m_items = new T[m_capacity];
+            m_notEmpty = SDL_CreateSemaphore(0);
+            m_notFull = SDL_CreateSemaphore(0);
+        }
+
+        ~PipelineQueue()
+        {
+            SDL_DestroySemaphore(m_notEmpty);
+            SDL_DestroySemaphore(m_notFull);
+            delete[] m_items;
+        }
+
+        bool tryPush(const T& item)
+        {
+            unsigned int tail = m_tail;
+
+            if (tail - m_head == m_capacity)
+                return false;
+            m_items[tail & (m_capacity - 1)] = item;
+            __sync_synchronize();               //先写数据再发布 tail
+            m_tail = tail + 1;
+            __sync_synchronize();
+            if (m_consumerWaiting)
+                SDL_SemPost(m_notEmpty);
+            return true;
+        }
+
+        bool tryPop(T* item)
+        {
+            unsigned int head = m_head;
+
+            if (m_tail == head)
+                return false;
+            __sync_synchronize();
+            *item = m_items[head & (m_capacity - 1)];
+            __sync_synchronize();               //读完数据才释放位置
+            m_head = head + 1;
+            __sync_synchronize();
+            if (m_producerWaiting)
+                SDL_SemPost(m_notFull);
+            return true;
+        }
+
+        /* 阻塞直到成功，abort() 之后返回 false */
+        bool push(const T& item)
+        {
+            while (!m_aborted) {
+                if (tryPush(item))
+                    return true;
+                m_producerWaiting = 1;
+                __sync_synchronize();           //先标记等待再检查，对方出队后一定能看到标记
+                if (tryPush(item)) {
+                    m_producerWaiting = 0;
+                    return true;
+                }
+                SDL_SemWaitTimeout(m_notFull, PIPELINE_QUEUE_WAIT_MS);
+                m_producerWaiting = 0;
+            }
+            return false;
+        }
+
+        /* 最多等待 timeoutMs，仍然满或者已经 abort() 返回 false，调用者可以在等待之间处理别的请求 */
+        bool push(const T& item, int timeoutMs)
+        {
+            if (m_aborted)
+                return false;
+            if (tryPush(item))
+                return true;
+            m_producerWaiting = 1;
+            __sync_synchronize();
+            if (tryPush(item)) {
+                m_producerWaiting = 0;
+                return true;
+            }
+            SDL_SemWaitTimeout(m_notFull, timeoutMs);
+            m_producerWaiting = 0;
+            return !m_aborted && tryPush(item);
+        }
+
+        bool pop(T* item)
+        {
+            while (!m_aborted) {
+                if (tryPop(item))
+                    return true;
+                m_consumerWaiting = 1;
+                __sync_synchronize();
+                if (tryPop(item)) {
+                    m_consumerWaiting = 0;
+                    return true;
+                }
+                SDL_SemWaitTimeout(m_notEmpty, PIPELINE_QUEUE_WAIT_MS);
+                m_consumerWaiting = 0;
+            }
+            return false;
+        }
+
+        /* 唤醒两端并让 push/pop 返回 false，用于停止；队列中剩下的由调用者 tryPop 取出释放 */
+        void abort()
+        {
+            m_aborted = 1;
+            __sync_synchronize();
+            SDL_SemPost(m_notEmpty);
+            SDL_SemPost(m_notFull);
+        }
+
+        void resume() { m_aborted = 0; }
+        bool isAborted() { return m_aborted != 0; }
+        int size() { return (int)(m_tail - m_head); }
+        int capacity() { return (int)m_capacity; }
+
+    private:
+        PipelineQueue(const PipelineQueue&);
+        PipelineQueue& operator=(const PipelineQueue&);
+
+        T*                      m_items;
+        unsigned int            m_capacity;             //2 的幂
+        volatile unsigned int   m_head;                 //只由消费者修改
+        volatile unsigned int   m_tail;                 //只由生产者修改
+        volatile int            m_aborted;
+        volatile int            m_consumerWaiting;
+        volatile int            m_producerWaiting;
+        SDL_sem*                m_notEmpty;
+        SDL_sem*                m_notFull;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__PIPELINE_QUEUE_H__
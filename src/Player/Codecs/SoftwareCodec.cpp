@@ -21,155 +21,65 @@ extern "C" {
 
 #include "CodecUtilityMessageType.h"
 #include "SoftwareCodec.h"
+#include "SoftwarePipeline.h"
 #include "PlayUtilityDataStructures.h"
 
-//Refresh Event
-#define SFM_REFRESH_EVENT  (SDL_USEREVENT + 1)
-
-static int thread_exit=0;
 static int video_opened = 0;
 
-static int sfp_refresh_thread(void *opaque)
-{
-    printf("sfp_refresh_thread::video_opened[%d]\n", video_opened);
-    
-	while (thread_exit == 0) {
-		SDL_Event event;
-		event.type = SFM_REFRESH_EVENT;
-		SDL_PushEvent(&event);
-		SDL_Delay(40);
-	}
-	return 0;
-}
-
 
 int SoftwareCodecInit(int argc, char* argv[], CodecCtrl_type* codecCtrl)
 {
-	AVFormatContext	*pFormatCtx;
-	int				i, videoindex;
-	AVCodecContext	*pCodecCtx;
-	AVCodec			*pCodec;
-	AVFrame	*pFrame, *pFrameYUV;
-	uint8_t *out_buffer;
-	AVPacket *packet;
-	int ret, got_picture;
-    
-    
+	SoftwarePipeline pipeline;  //⸴á롢תڸԵֻ̣߳¼ʾ
+	int				i, wait, quit = 0, started = 0, track;
+
 	//------------SDL----------------
 	int screen_w, screen_h;
 	SDL_Window *screen;  //2.0һָ
 	SDL_Renderer* sdlRenderer;//Ⱦ
-	SDL_Texture* sdlTexture;// ˢ
-	SDL_Rect sdlRect;
-	SDL_Thread *video_tid;
 	SDL_Event event;
 
-	struct SwsContext *img_convert_ctx;
-
-	char filepath[]="cuc_ieschool.flv";
-
 	av_register_all();
 	//avformat_network_init();
-	pFormatCtx = avformat_alloc_context();
 
-
-    //ýļ //avformat_open_input   av_open_input_file
-    if (avformat_open_input(&pFormatCtx, argv[1], NULL, NULL) != 0) {
-        playerLogError("Couldn't open input stream, argv[%s].\n", argv[1]); /*ܻmonitorģ󣬴򲻿*/
-        return -1;
-    }
-    
-    // Retrieve stream information
-	if(avformat_find_stream_info(pFormatCtx, NULL)<0){
-		playerLogError("Couldn't find stream information.\n");  // Couldn't find stream information
+	/* Ƶ豸 pipeline.open() д򿪣SDL Ҫȳʼ */
+	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER)) {
+		playerLogError( "Could not initialize SDL - %s\n", SDL_GetError());
 		return -1;
 	}
-	videoindex=-1;
-    
-    // Find the first video stream
-	for(i = 0; i < pFormatCtx->nb_streams; i++) 
-		if(pFormatCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO){
-			videoindex = i;
-			break;
-		}
-	if(videoindex == -1){
-		playerLogError("Didn't find a video stream.\n");  // Didn't find a video stream
-		return -1;
-	}
-    
-    // Get a pointer to the codec context for the video stream
-	pCodecCtx = pFormatCtx->streams[videoindex]->codec;
-    
-    // Find the decoder for the video stream
-	pCodec = avcodec_find_decoder(pCodecCtx->codec_id);
-	if(pCodec == NULL){
-		playerLogError("Codec not found.\n"); // Codec not found
-		return -1;
-	}
-    
-    // Open codec
-	if(avcodec_open2(pCodecCtx, pCodec, NULL) < 0){
-		playerLogError("Could not open codec.\n");
+
+	//ýļͽ
+	if (pipeline.open(argv[1]) < 0) {
+		playerLogError("Couldn't open input stream, argv[%s].\n", argv[1]); /*ܻmonitorģ󣬴򲻿*/
+		SDL_Quit();
 		return -1;
 	}
-        
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
-    //Allocate frame video
-    pFrame = av_frame_alloc();
-    // Allocate video frame  struct AVFrame
-    pFrameYUV = av_frame_alloc();
-#else
-    pFrame = avcodec_alloc_frame();
-    // Allocate video frame
-    pFrameYUV = avcodec_alloc_frame();
-#endif
-
-    // Assign appropriate parts of buffer to image planes in pFrameYUV
-	out_buffer = (uint8_t *)av_malloc(avpicture_get_size(PIX_FMT_YUV420P, pCodecCtx->width, pCodecCtx->height));
-	avpicture_fill((AVPicture *)pFrameYUV, out_buffer, PIX_FMT_YUV420P, pCodecCtx->width, pCodecCtx->height);
+	//ĻļʧʱֻûĻ
+	if (argc > 2)
+		pipeline.addExternalSubtitle(argv[2]);
 
-	//Output Info-----------------------------
-	printf("---------------------------------- File Information ---------------------------------\n");
-	av_dump_format(pFormatCtx, 0, filepath, 0);
-	printf("-------------------------------------------------------------------------------------\n");
-	
-	img_convert_ctx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt, 
-                                     pCodecCtx->width, pCodecCtx->height, PIX_FMT_YUV420P, SWS_BICUBIC, NULL, NULL, NULL); 
-	
-
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER)) {  
-		playerLogError( "Could not initialize SDL - %s\n", SDL_GetError()); 
-		return -1;
-	} 
 	//SDL 2.0 Support for multiple windows
-	screen_w = pCodecCtx->width;
-	screen_h = pCodecCtx->height;
+	screen_w = pipeline.getVideoWidth();
+	screen_h = pipeline.getVideoHeight();
 	screen = SDL_CreateWindow("Simplest ffmpeg player's Window", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screen_w, screen_h, SDL_WINDOW_OPENGL);
 
-	if(!screen) {  
-		playerLogError("SDL: could not create window - exiting:%s\n",SDL_GetError());  
+	if(!screen) {
+		playerLogError("SDL: could not create window - exiting:%s\n",SDL_GetError());
+		pipeline.close();
+		SDL_Quit();
 		return -1;
 	}
-	sdlRenderer = SDL_CreateRenderer(screen, -1, 0);  // ΪĴȾ
-	//IYUV: Y + U + V  (3 planes)
-	//YV12: Y + V + U  (3 planes)
-	sdlTexture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, pCodecCtx->width, pCodecCtx->height);  //һˢ
-
-	sdlRect.x = 0;
-	sdlRect.y = 0;
-	sdlRect.w = screen_w;
-	sdlRect.h = screen_h;
-
-	packet = (AVPacket *)av_malloc(sizeof(AVPacket));
-
-	video_tid = SDL_CreateThread(sfp_refresh_thread, NULL, NULL);
+	sdlRenderer = SDL_CreateRenderer(screen, -1, 0);  // ΪĴȾˢ pipeline ֡ĴС
 	//------------SDL End------------
-    
+
 	//Event Loop
-	for (i = 0; ; i++) {
-		//Wait
-		SDL_WaitEvent(&event);
-        
+	wait = PIPELINE_IDLE_WAIT_MS;
+	for (i = 0; !quit; i++) {
+		//WaitʱʱΪһ֡ڵʱ䣬ù̶ 40ms ˢ߳
+		if (SDL_WaitEventTimeout(&event, wait) == 0) {
+			wait = video_opened ? pipeline.render(sdlRenderer) : PIPELINE_IDLE_WAIT_MS;
+			continue;
+		}
+
         playerLogInfo("event.type[%u],\n", event.type);
         switch(event.type){
         case SOFTWARE_CODEC_EVENT_OPEN:{
@@ -178,8 +88,16 @@ int SoftwareCodecInit(int argc, char* argv[], CodecCtrl_type* codecCtrl)
             break;
             }
         case SOFTWARE_CODEC_EVENT_PLAY:{
-            //TODO:: do play stream
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_PLAY\n", event.type);
+            if (!started) {
+                if (pipeline.start() < 0) {
+                    quit = 1;
+                    break;
+                }
+                started = 1;
+            } else {
+                pipeline.setPaused(false);
+            }
             video_opened = 1;
             break;
             }
@@ -191,24 +109,61 @@ int SoftwareCodecInit(int argc, char* argv[], CodecCtrl_type* codecCtrl)
         case SOFTWARE_CODEC_EVENT_STOP:{
             //TODO:: do stop stream
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_STOP\n", event.type);
+            pipeline.setPaused(true);
             video_opened = 0;
             break;
-            }    
+            }
         case SOFTWARE_CODEC_EVENT_PAUSE:{
-            //TODO:: do pause play
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_PAUSE\n", event.type);
+            pipeline.setPaused(true);
             video_opened = 0;
             break;
-            }    
+            }
         case SOFTWARE_CODEC_EVENT_RESUME:{
-            //TODO:: do resume play
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_RESUME\n", event.type);
-            video_opened = 1;
+            if (started) {
+                pipeline.setPaused(false);
+                video_opened = 1;
+            }
             break;
-            }    
+            }
         case SOFTWARE_CODEC_EVENT_SEEKTO:{
-            //TODO:: do seek to (include fast forward && fast rewind)
-            playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_SEEKTO\n", event.type);
+            //code Ϊ룬С 0 Ϊβdata1  0 Ϊȷ seek
+            playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_SEEKTO, [%d]ms\n", event.type, event.user.code);
+            if (started)
+                pipeline.seek(event.user.code < 0 ? -1 : (int64_t)event.user.code * 1000, event.user.data1 != NULL);
+            break;
+            }
+        case SOFTWARE_CODEC_EVENT_SETRATE:{
+            //code ΪٷֱȣΪ
+            playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_SETRATE, [%d%%]\n", event.type, event.user.code);
+            if (started)
+                pipeline.setRate(event.user.code);
+            break;
+            }
+        case SOFTWARE_CODEC_EVENT_SUBTITLE:{
+            //code ΪĻ PIDPLAY_TRACK_NEXT ˳лһ֮ر
+            playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_SUBTITLE, pid[%d]\n", event.type, event.user.code);
+            if (event.user.code == PLAY_TRACK_NEXT) {
+                track = pipeline.getSubtitleTrack() + 1;
+                pipeline.selectSubtitle(track < pipeline.getSubtitleTrackCount() ? track : -1);
+            } else if (event.user.code == PLAY_TRACK_OFF) {
+                pipeline.selectSubtitle(-1);
+            } else if ((track = pipeline.findSubtitleTrack(event.user.code)) >= 0) {
+                pipeline.selectSubtitle(track);
+            } else {
+                playerLogWarning("subtitle pid [%d] not found.\n", event.user.code);
+            }
+            break;
+            }
+        case SOFTWARE_CODEC_EVENT_AUDIOTRACK:{
+            //code Ϊ PIDPLAY_TRACK_NEXT ѭл½⸴ãѾŶӵľ첥֮
+            playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_AUDIOTRACK, pid[%d]\n", event.type, event.user.code);
+            if (event.user.code == PLAY_TRACK_NEXT)
+                track = pipeline.getAudioTrackCount() > 0 ? (pipeline.getAudioTrack() + 1) % pipeline.getAudioTrackCount() : -1;
+            else
+                track = pipeline.findAudioTrack(event.user.code);
+            pipeline.selectAudioTrack(track);
             break;
             }
         case SOFTWARE_CODEC_EVENT_VIDEO_FULLSCREEN:{
@@ -216,70 +171,32 @@ int SoftwareCodecInit(int argc, char* argv[], CodecCtrl_type* codecCtrl)
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_VIDEO_FULLSCREEN\n", event.type);
             break;
             }
-        case SFM_REFRESH_EVENT:
         case SOFTWARE_CODEC_EVENT_VIDEO_REFRESH:{
-            //TODO:: do refresh display
+            //ʾ render() ʱ
             playerLogVerbose("event.type[%u],SOFTWARE_CODEC_EVENT_VIDEO_REFRESH\n", event.type);
-            if(video_opened == 0)
-                break;
-            if(av_read_frame(pFormatCtx, packet) >= 0){
-				if(packet->stream_index == videoindex){
-                    // Decode the next chunk of data
-					ret = avcodec_decode_video2(pCodecCtx, pFrame, &got_picture, packet);
-					if(ret < 0){
-						playerLogError("Decode Error.\n");
-						return -1;
-					}
-					if(got_picture){
-						sws_scale(img_convert_ctx, (const uint8_t* const*)pFrame->data, pFrame->linesize, 0, pCodecCtx->height, pFrameYUV->data, pFrameYUV->linesize);
-						//SDL---------------------------
-						SDL_UpdateTexture( sdlTexture, NULL, pFrameYUV->data[0], pFrameYUV->linesize[0] );  
-						SDL_RenderClear( sdlRenderer );  
-						//SDL_RenderCopy( sdlRenderer, sdlTexture, &sdlRect, &sdlRect );  
-						SDL_RenderCopy( sdlRenderer, sdlTexture, NULL, NULL);  
-						SDL_RenderPresent( sdlRenderer );  
-						//SDL End-----------------------
-					}
-				}
-				av_free_packet(packet);
-			}else{
-				//Exit Thread
-				thread_exit=1;
-				break;
-			}
             break;
             }
         case SDL_QUIT:{
-            //TODO:: do exit
             playerLogVerbose("SDL_QUIT\n");
-            thread_exit=1;
+            quit = 1;
             break;
             }
         default :{
             break;
             }
         } // end switch(event.type)
+
+        /* ¼ҲһΣ¼ʱƳʾ */
+        wait = video_opened ? pipeline.render(sdlRenderer) : PIPELINE_IDLE_WAIT_MS;
         playerLogInfo("for loop count i=[%d]\n", i);
 	} //end for(;;)
-        
-	sws_freeContext(img_convert_ctx);
-	SDL_Quit();
-    
-    
+
 	//--------------
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)  
-	av_frame_free(&pFrameYUV);
-	av_frame_free(&pFrame);
-#else
-    av_free(pFrameYUV);
-#endif
-    
-	avcodec_close(pCodecCtx);
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)  
-	avformat_close_input(&pFormatCtx);
-#else
-    av_close_input_file(pFormatCtx);
-#endif
+	/* ˢȾҪȾ֮ǰͷ */
+	pipeline.close();
+	SDL_DestroyRenderer(sdlRenderer);
+	SDL_DestroyWindow(screen);
+	SDL_Quit();
 
 	return 0;
 }
@@ -287,4 +204,3 @@ int SoftwareCodecInit(int argc, char* argv[], CodecCtrl_type* codecCtrl)
 
 
 
-
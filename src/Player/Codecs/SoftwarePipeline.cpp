@@ -0,0 +1,1691 @@
+/**
+ *  SoftwarePipeline.cpp文件
+ *  软解码播放的流水线；
+ *  主要有以下部分：
+ *      1. 解复用线程：av_read_frame，按流分发 packet；执行 seek 和倍速，由 TrickPlayControl 决定输出哪些 packet
+ *      2. 视频解码线程：打开 ffmpeg 的帧级/片级多线程，支持 DR1 的解码器直接解码到 VideoFramePool 的 surface，
+ *         输出时只增加引用，不复制；转换和显示也从同一个池取 surface
+ *      3. 音频解码线程：解码为 S16 PCM，声道数和采样率转换为固定的输出格式，写入无锁的环形缓冲；
+ *         SDL 音频回调只读环形缓冲、叠加提示音、乘音量，不加锁不分配内存，解码线程提高优先级，减少 CPU 忙时的欠载
+ *      4. 转换线程：非 YUV420P 时经 ImageConvert 转换，否则直接传递
+ *      5. 显示：在窗口线程中按 MediaClock 显示、丢帧；默认音频主时钟，也可以用视频或外部参考，此时音频按重采样微调跟随
+ *      6. seek：每次请求 serial 加一，解复用 seek 之后向两个解码线程发送带 serial 的 flush packet，
+ *         各阶段丢弃 serial 不同的数据，不需要停止线程；时间戳换算为播放时间，倍速和后退时主时钟仍按 1x 走
+ *      7. 字幕：解复用线程把所有字幕轨道解码到各自的 SubtitleQueue(DVB 经 ffmpeg，图文电视自己解码，外挂文件一次读入)，
+ *         按媒体时间保存，切换轨道和 seek 都不需要重新解复用；图形字幕在显示时叠加
+ *      8. 音轨：切换时解复用改送新音轨，音频线程在新音轨的第一个 packet 换解码器
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <string.h>
+#include <stdlib.h>
+
+//Linux...
+extern "C" {
+#include "LogPlayer.h"
+};
+
+#include "SoftwarePipeline.h"
+#include "SubtitleParser.h"
+
+
+static const AVRational gMicrosecond = { 1, 1000000 };
+
+
+static void PipelineFreePacket(AVPacket* packet)
+{
+    if (packet == NULL)
+        return;
+    av_free_packet(packet);
+    av_free(packet);
+}
+
+/* seek 之后通知解码线程：pos 为 serial；视频的 pts 为精确 seek 的目标(-1 为没有)，音频的 pts 为 seek 的目标 */
+static AVPacket* PipelineFlushPacket(int serial, int64_t timeUs)
+{
+    AVPacket* packet = (AVPacket*)av_malloc(sizeof(AVPacket));
+
+    if (packet == NULL)
+        return NULL;
+    av_init_packet(packet);
+    packet->data = NULL;
+    packet->size = 0;
+    packet->stream_index = -1;
+    packet->pos = serial;
+    packet->pts = timeUs;
+    return packet;
+}
+
+static bool PipelineIsFlushPacket(AVPacket* packet)
+{
+    return packet != NULL && packet->stream_index < 0 && packet->data == NULL;
+}
+
+static void PipelineTrackInfoInit(PipelineTrackInfo* info, AVStream* stream, int index)
+{
+    AVDictionaryEntry* language = av_dict_get(stream->metadata, "language", NULL, 0);
+
+    info->streamIndex = index;
+    info->pid = stream->id > 0 ? stream->id : index;
+    info->codecId = stream->codec->codec_id;
+    info->language = language ? language->value : "";
+    info->path.clear();
+}
+
+/* ffmpeg 的 ass 字段为整行 "Dialogue: 0,0:00:01.00,0:00:02.00,Default,,0,0,0,,文字"，文字在第 9 个逗号之后 */
+static std::string PipelineAssText(const char* ass)
+{
+    const char* text = strncmp(ass, "Dialogue:", 9) == 0 ? ass : NULL;
+    int commas = 0;
+
+    for (; text && *text && commas < 9; text++) {
+        if (*text == ',')
+            commas++;
+    }
+    return SubtitleParser::stripAssTags(text && commas == 9 ? text : ass);
+}
+
+/* DVB 没有结束时间(end_display_time 只是超时)，由下一条截断 */
+static void PipelineSubtitleToCue(const AVSubtitle* subtitle, AVCodecContext* codecCtx, int64_t ptsUs, SubtitleCue* cue)
+{
+    int64_t startUs = ptsUs + (int64_t)subtitle->start_display_time * 1000;
+    int64_t endUs = ptsUs + (int64_t)subtitle->end_display_time * 1000;
+    bool open = codecCtx->codec_id == CODEC_ID_DVB_SUBTITLE || endUs <= startUs;
+    AVSubtitleRect* rect;
+    SubtitleBitmap bitmap;
+    const uint32_t* palette;
+    const uint8_t* indexes;
+    unsigned int i;
+    int x, y;
+
+    SubtitleCueInit(cue, startUs, open ? -1 : endUs);
+    if (open && endUs > startUs && endUs < cue->endUs)
+        cue->endUs = endUs;
+    cue->canvasWidth = codecCtx->width > 0 ? codecCtx->width : PIPELINE_SUBTITLE_WIDTH;
+    cue->canvasHeight = codecCtx->height > 0 ? codecCtx->height : PIPELINE_SUBTITLE_HEIGHT;
+
+    for (i = 0; i < subtitle->num_rects; i++) {
+        rect = subtitle->rects[i];
+        if (rect->type == SUBTITLE_BITMAP && rect->pict.data[0] && rect->pict.data[1] && rect->w > 0 && rect->h > 0) {
+            /* 调色板为 ARGB，和叠加用的画刷格式相同 */
+            palette = (const uint32_t*)rect->pict.data[1];
+            bitmap.x = rect->x;
+            bitmap.y = rect->y;
+            bitmap.width = rect->w;
+            bitmap.height = rect->h;
+            bitmap.pixels.resize(rect->w * rect->h);
+            for (y = 0; y < rect->h; y++) {
+                indexes = rect->pict.data[0] + y * rect->pict.linesize[0];
+                for (x = 0; x < rect->w; x++)
+                    bitmap.pixels[y * rect->w + x] = indexes[x] < rect->nb_colors ? palette[indexes[x]] : 0;
+            }
+            cue->bitmaps.push_back(bitmap);
+        } else if (rect->type == SUBTITLE_ASS && rect->ass) {
+            if (!cue->text.empty())
+                cue->text += '\n';
+            cue->text += PipelineAssText(rect->ass);
+        } else if (rect->type == SUBTITLE_TEXT && rect->text) {
+            if (!cue->text.empty())
+                cue->text += '\n';
+            cue->text += rect->text;
+        }
+    }
+}
+
+/* 开始时间和内容相同时不需要更新画刷 */
+static bool PipelineSameCues(const std::vector<SubtitleCue>& a, const std::vector<SubtitleCue>& b)
+{
+    unsigned int i;
+
+    if (a.size() != b.size())
+        return false;
+    for (i = 0; i < a.size(); i++) {
+        if (a[i].startUs != b[i].startUs || a[i].bitmaps.size() != b[i].bitmaps.size() || a[i].text != b[i].text)
+            return false;
+    }
+    return true;
+}
+
+static int64_t PipelineNowUs()
+{
+    static uint64_t frequency = 0;
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    if (frequency == 0)
+        frequency = SDL_GetPerformanceFrequency();
+    return (int64_t)(counter / frequency * 1000000 + counter % frequency * 1000000 / frequency);
+}
+
+
+SoftwarePipeline::SoftwarePipeline()
+    : m_format(NULL)
+    , m_videoCodec(NULL)
+    , m_audioCodec(NULL)
+    , m_videoIndex(-1)
+    , m_audioIndex(-1)
+    , m_startTime(0)
+    , m_frameDurationUs(40000)
+    , m_nextVideoPtsUs(0)
+    , m_passThrough(false)
+    , m_framePool(VideoFramePool::shared())
+    , m_directRendering(false)
+    , m_videoPackets(PIPELINE_VIDEO_PACKETS)
+    , m_audioPackets(PIPELINE_AUDIO_PACKETS)
+    , m_decoded(PIPELINE_DECODED_FRAMES)
+    , m_display(PIPELINE_DISPLAY_FRAMES + 1)
+    , m_decodedFree(PIPELINE_DECODED_FRAMES + PIPELINE_DISPLAY_FRAMES)
+    , m_displayFree(PIPELINE_DISPLAY_FRAMES)
+    , m_demuxThread(NULL)
+    , m_videoThread(NULL)
+    , m_audioThread(NULL)
+    , m_convertThread(NULL)
+    , m_stopped(false)
+    , m_paused(false)
+    , m_texture(NULL)
+    , m_textureWidth(0)
+    , m_textureHeight(0)
+    , m_pendingFrame(NULL)
+    , m_videoEnded(false)
+    , m_audioOpened(false)
+    , m_audioEnded(false)
+    , m_audioBytesPerSecond(0)
+    , m_audioLatencyUs(0)
+    , m_audioRecordLeft(0)
+    , m_audioClockUs(-1)
+    , m_seekRequest(false)
+    , m_seekTargetUs(0)
+    , m_seekPlayUs(0)
+    , m_seekAccurate(false)
+    , m_requestRate(TRICKPLAY_RATE_NORMAL)
+    , m_serial(0)
+    , m_demuxSerial(0)
+    , m_seekStartUs(-1)
+    , m_audioSwitchCodec(NULL)
+    , m_subtitleTrack(-1)
+    , m_externalSubtitles(0)
+    , m_subtitleTexture(NULL)
+    , m_subtitleTextureWidth(0)
+    , m_subtitleTextureHeight(0)
+    , m_subtitleVisible(false)
+    , m_subtitleShownTrack(-1)
+    , m_subtitleGeneration(0)
+    , m_subtitleQueryUs(0)
+    , m_subtitleChangeUs(0)
+{
+    memset(m_frames, 0, sizeof(m_frames));
+    memset(&m_audioRecord, 0, sizeof(m_audioRecord));
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_seekMutex = ThreadMutexCreate();
+    m_subtitleMutex = ThreadMutexCreate();
+}
+
+SoftwarePipeline::~SoftwarePipeline()
+{
+    close();
+    ThreadMutexDestroy(m_subtitleMutex);
+    ThreadMutexDestroy(m_seekMutex);
+}
+
+int SoftwarePipeline::open(const char* url)
+{
+    int videoIndex = -1, audioIndex = -1;
+    unsigned int i;
+
+    if (avformat_open_input(&m_format, url, NULL, NULL) != 0) {
+        playerLogError("Couldn't open input stream, url[%s].\n", url);
+        m_format = NULL;
+        return -1;
+    }
+    if (avformat_find_stream_info(m_format, NULL) < 0) {
+        playerLogError("Couldn't find stream information.\n");
+        close();
+        return -1;
+    }
+    m_startTime = m_format->start_time != (int64_t)AV_NOPTS_VALUE ? m_format->start_time : 0;
+
+    for (i = 0; i < m_format->nb_streams; i++) {
+        if (videoIndex < 0 && m_format->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+            videoIndex = i;
+        } else if (m_format->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
+            PipelineTrackInfo info;
+
+            PipelineTrackInfoInit(&info, m_format->streams[i], i);
+            m_audioTracks.push_back(info);
+            if (audioIndex < 0)
+                audioIndex = i;
+        } else if (m_format->streams[i]->codec->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+            openSubtitle(i);
+        }
+    }
+    if (videoIndex < 0) {
+        playerLogError("Didn't find a video stream.\n");
+        close();
+        return -1;
+    }
+    if (openVideo(videoIndex) < 0) {
+        close();
+        return -1;
+    }
+    if (audioIndex >= 0 && openAudio(audioIndex) < 0)
+        playerLogWarning("audio stream [%d] can't be played, video only.\n", audioIndex);
+
+    /* 直接传递时所有帧都在解码一侧循环，否则两侧各一个池 */
+    for (i = 0; i < PIPELINE_DECODED_FRAMES + PIPELINE_DISPLAY_FRAMES; i++) {
+        if (m_passThrough || i < PIPELINE_DECODED_FRAMES)
+            m_decodedFree.tryPush(&m_frames[i]);
+        else
+            m_displayFree.tryPush(&m_frames[i]);
+    }
+
+    av_dump_format(m_format, 0, url, 0);
+    return 0;
+}
+
+int SoftwarePipeline::openVideo(int index)
+{
+    AVStream* stream = m_format->streams[index];
+    AVCodecContext* codecCtx = stream->codec;
+    AVCodec* codec = avcodec_find_decoder(codecCtx->codec_id);
+    int threads = SDL_GetCPUCount();
+
+    if (codec == NULL) {
+        playerLogError("Codec not found.\n");
+        return -1;
+    }
+    /* 必须在 avcodec_open2 之前设置，解码器不支持帧级多线程时 ffmpeg 自动退回片级或单线程 */
+    if (threads > PIPELINE_DECODE_THREADS_MAX)
+        threads = PIPELINE_DECODE_THREADS_MAX;
+    codecCtx->thread_count = threads > 0 ? threads : 1;
+    codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    m_directRendering = VideoFramePool::attachDecoder(codecCtx, codec, m_framePool);
+    if (avcodec_open2(codecCtx, codec, NULL) < 0) {
+        playerLogError("Could not open codec.\n");
+        return -1;
+    }
+
+    m_videoCodec = codecCtx;
+    m_videoIndex = index;
+    m_passThrough = (codecCtx->pix_fmt == PIX_FMT_YUV420P || codecCtx->pix_fmt == PIX_FMT_YUVJ420P);
+    if (stream->r_frame_rate.num > 0 && stream->r_frame_rate.den > 0)
+        m_frameDurationUs = (int64_t)stream->r_frame_rate.den * 1000000 / stream->r_frame_rate.num;
+    m_statistics.decodeThreads = codecCtx->thread_count;
+
+    playerLogInfo("video [%s] %dx%d, threads[%d] type[%d], %s, %s\n", codec->name, codecCtx->width, codecCtx->height,
+                  codecCtx->thread_count, codecCtx->active_thread_type, m_passThrough ? "pass through" : "convert",
+                  m_directRendering ? "direct rendering" : "copy");
+    return 0;
+}
+
+int SoftwarePipeline::openAudioCodec(AVCodecContext* codecCtx)
+{
+    AVCodec* codec = avcodec_find_decoder(codecCtx->codec_id);
+
+    if (codec == NULL || avcodec_open2(codecCtx, codec, NULL) < 0) {
+        playerLogWarning("Could not open audio codec.\n");
+        return -1;
+    }
+    if (codecCtx->sample_fmt != AV_SAMPLE_FMT_S16 || codecCtx->channels <= 0 || codecCtx->sample_rate <= 0) {
+        playerLogWarning("audio sample format [%d] channels [%d] rate [%d] not supported.\n",
+                         codecCtx->sample_fmt, codecCtx->channels, codecCtx->sample_rate);
+        avcodec_close(codecCtx);
+        return -1;
+    }
+
+    if (codecCtx->channels > CHANNEL_MAP_MAX) {
+        playerLogWarning("audio channels [%d] not supported.\n", codecCtx->channels);
+        avcodec_close(codecCtx);
+        return -1;
+    }
+    return 0;
+}
+
+int SoftwarePipeline::openAudio(int index)
+{
+    AVCodecContext* codecCtx = m_format->streams[index]->codec;
+    SDL_AudioSpec wanted;
+
+    if (openAudioCodec(codecCtx) < 0)
+        return -1;
+
+    /* 设备按固定的格式打开，换文件或者码流中途变化都不需要重新打开 */
+    m_audioBytesPerSecond = PIPELINE_AUDIO_RATE * PIPELINE_AUDIO_CHANNELS * 2;
+    if (m_audioRing.open(m_audioBytesPerSecond / 1000 * PIPELINE_AUDIO_BUFFER_MS) < 0) {
+        avcodec_close(codecCtx);
+        return -1;
+    }
+    m_audioRecordLeft = 0;
+    m_audioGain.open(PIPELINE_AUDIO_RATE, PIPELINE_AUDIO_CHANNELS);
+    m_audioMixer.open(PIPELINE_AUDIO_RATE, PIPELINE_AUDIO_CHANNELS);
+
+    memset(&wanted, 0, sizeof(wanted));
+    wanted.freq = PIPELINE_AUDIO_RATE;
+    wanted.format = AUDIO_S16SYS;
+    wanted.channels = PIPELINE_AUDIO_CHANNELS;
+    wanted.samples = 1024;
+    wanted.callback = audioCallback;
+    wanted.userdata = this;
+    /* obtained 传 NULL，设备格式不同时由 SDL 转换，wanted.size 为回调每次要的字节数 */
+    if (SDL_OpenAudio(&wanted, NULL) < 0) {
+        playerLogWarning("SDL_OpenAudio failed - %s\n", SDL_GetError());
+        m_audioRing.close();
+        avcodec_close(codecCtx);
+        return -1;
+    }
+
+    m_audioCodec = codecCtx;
+    m_audioIndex = index;
+    m_audioOpened = true;
+    m_audioEnded = false;
+    m_audioLatencyUs = (int)((int64_t)wanted.size * 1000000 / m_audioBytesPerSecond);
+    m_clock.setAudioLimitUs(m_audioLatencyUs);     //两次回调之间最多外推一个设备缓冲区
+    playerLogInfo("audio rate[%d] channels[%d] -> rate[%d] channels[%d], buffer[%d]ms latency[%d]us\n",
+                  codecCtx->sample_rate, codecCtx->channels, wanted.freq, wanted.channels,
+                  m_audioRing.capacity() * 1000 / m_audioBytesPerSecond, m_audioLatencyUs);
+    return 0;
+}
+
+int SoftwarePipeline::start()
+{
+    m_stopped = false;
+    m_demuxThread = SDL_CreateThread(demuxThread, "demux", this);
+    m_videoThread = SDL_CreateThread(videoDecodeThread, "videoDecode", this);
+    m_convertThread = SDL_CreateThread(convertThread, "convert", this);
+    if (m_audioOpened)
+        m_audioThread = SDL_CreateThread(audioDecodeThread, "audioDecode", this);
+    if (m_demuxThread == NULL || m_videoThread == NULL || m_convertThread == NULL
+        || (m_audioOpened && m_audioThread == NULL)) {
+        playerLogError("SDL_CreateThread failed - %s\n", SDL_GetError());
+        close();
+        return -1;
+    }
+    setPaused(false);
+    return 0;
+}
+
+void SoftwarePipeline::close()
+{
+    unsigned int i;
+
+    m_stopped = true;
+    m_videoPackets.abort();
+    m_audioPackets.abort();
+    m_decoded.abort();
+    m_display.abort();
+    m_decodedFree.abort();
+    m_displayFree.abort();
+    if (m_demuxThread) SDL_WaitThread(m_demuxThread, NULL);
+    if (m_videoThread) SDL_WaitThread(m_videoThread, NULL);
+    if (m_audioThread) SDL_WaitThread(m_audioThread, NULL);
+    if (m_convertThread) SDL_WaitThread(m_convertThread, NULL);
+    m_demuxThread = m_videoThread = m_audioThread = m_convertThread = NULL;
+
+    /* 等回调结束后才能清理环形缓冲 */
+    if (m_audioOpened) {
+        SDL_CloseAudio();
+        m_audioOpened = false;
+    }
+    drainQueues();
+
+    for (i = 0; i < PIPELINE_DECODED_FRAMES + PIPELINE_DISPLAY_FRAMES; i++)
+        releaseSurface(&m_frames[i]);
+    memset(m_frames, 0, sizeof(m_frames));
+    m_audioRing.close();
+
+    if (m_texture) {
+        SDL_DestroyTexture(m_texture);
+        m_texture = NULL;
+    }
+    if (m_subtitleTexture) {
+        SDL_DestroyTexture(m_subtitleTexture);
+        m_subtitleTexture = NULL;
+    }
+    m_subtitleTextureWidth = m_subtitleTextureHeight = 0;
+    m_subtitleVisible = false;
+    m_subtitleCues.clear();
+    m_subtitleShownTrack = -1;
+    closeSubtitles();
+    if (m_videoCodec) {
+        avcodec_close(m_videoCodec);
+        m_videoCodec = NULL;
+    }
+    if (m_audioCodec) {
+        avcodec_close(m_audioCodec);
+        m_audioCodec = NULL;
+    }
+    if (m_audioSwitchCodec) {
+        avcodec_close(m_audioSwitchCodec);
+        m_audioSwitchCodec = NULL;
+    }
+    m_audioTracks.clear();
+    if (m_format) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+        avformat_close_input(&m_format);
+#else
+        av_close_input_file(m_format);
+        m_format = NULL;
+#endif
+    }
+    m_videoIndex = m_audioIndex = -1;
+    m_videoEnded = false;
+    m_audioEnded = false;
+    m_audioClockUs = -1;
+    m_clock.reset();
+    m_trickPlay = TrickPlayControl();
+    m_seekRequest = false;
+    m_seekTargetUs = 0;
+    m_requestRate = TRICKPLAY_RATE_NORMAL;
+    m_serial = m_demuxSerial = 0;
+    m_seekStartUs = -1;
+}
+
+void SoftwarePipeline::drainQueues()
+{
+    AVPacket* packet;
+    PipelineFrame* frame;
+
+    while (m_videoPackets.tryPop(&packet))
+        PipelineFreePacket(packet);
+    while (m_audioPackets.tryPop(&packet))
+        PipelineFreePacket(packet);
+
+    /* 帧都在固定的池中，只需清空队列 */
+    while (m_decoded.tryPop(&frame));
+    while (m_display.tryPop(&frame));
+    while (m_decodedFree.tryPop(&frame));
+    while (m_displayFree.tryPop(&frame));
+    m_pendingFrame = NULL;
+    m_audioRing.reset();
+    m_audioRecordLeft = 0;
+
+    m_videoPackets.resume();
+    m_audioPackets.resume();
+    m_decoded.resume();
+    m_display.resume();
+    m_decodedFree.resume();
+    m_displayFree.resume();
+}
+
+int64_t SoftwarePipeline::toUs(int64_t timestamp, AVRational timeBase)
+{
+    return av_rescale_q(timestamp, timeBase, gMicrosecond) - m_startTime;
+}
+
+int64_t SoftwarePipeline::toPlayUs(int64_t ptsUs)
+{
+    int64_t playUs;
+
+    ThreadMutexLock(m_seekMutex);
+    playUs = m_trickPlay.toPlayUs(ptsUs);
+    ThreadMutexUnLock(m_seekMutex);
+    return playUs;
+}
+
+int64_t SoftwarePipeline::getDurationUs()
+{
+    if (m_format == NULL || m_format->duration == (int64_t)AV_NOPTS_VALUE || m_format->duration <= 0)
+        return -1;
+    return m_format->duration;
+}
+
+int SoftwarePipeline::seekFormat(int64_t timeUs)
+{
+    /* AV_TIME_BASE 为微秒，落在目标之前的关键帧 */
+    if (av_seek_frame(m_format, -1, timeUs + m_startTime, AVSEEK_FLAG_BACKWARD) < 0) {
+        playerLogWarning("seek to [%lld]us failed.\n", (long long)timeUs);
+        return -1;
+    }
+    return 0;
+}
+
+void SoftwarePipeline::handleSeek()
+{
+    int64_t targetUs, playUs;
+    bool accurate;
+    int rate, serial;
+    AVPacket* flush;
+    unsigned int i;
+
+    ThreadMutexLock(m_seekMutex);
+    targetUs = m_seekTargetUs;
+    playUs = m_seekPlayUs;
+    accurate = m_seekAccurate;
+    rate = m_requestRate;
+    serial = m_serial;
+    m_seekRequest = false;
+    ThreadMutexUnLock(m_seekMutex);
+
+    /* seek 失败时从当前位置继续读，排队的数据仍然要丢弃 */
+    seekFormat(targetUs);
+    ThreadMutexLock(m_seekMutex);
+    m_trickPlay.setRate(rate);
+    m_trickPlay.seek(targetUs, accurate, playUs);
+    m_demuxSerial = serial;
+    ThreadMutexUnLock(m_seekMutex);
+    m_statistics.seeks++;
+
+    /* 已经解码的字幕按媒体时间保存，不用清空；图文电视丢弃收了一半的页 */
+    ThreadMutexLock(m_subtitleMutex);
+    for (i = 0; i < m_subtitleTracks.size(); i++) {
+        if (m_subtitleTracks[i].teletext)
+            m_subtitleTracks[i].teletext->reset();
+    }
+    ThreadMutexUnLock(m_subtitleMutex);
+    playerLogInfo("seek to [%lld]us, rate[%d%%] accurate[%d] serial[%d]\n", (long long)targetUs, rate, accurate, serial);
+
+    flush = PipelineFlushPacket(serial, accurate && !m_trickPlay.isKeyframeOnly() ? targetUs : -1);
+    if (flush)
+        queuePacket(m_videoPackets, flush);
+    flush = m_audioOpened ? PipelineFlushPacket(serial, targetUs) : NULL;
+    if (flush)
+        queuePacket(m_audioPackets, flush);
+}
+
+int SoftwarePipeline::filterPacket(AVPacket* packet)
+{
+    AVStream* stream;
+    int64_t timestamp;
+    int type;
+
+    if (packet->stream_index == m_videoIndex)
+        type = DemuxStream_Video;
+    else if (packet->stream_index == m_audioIndex && m_audioOpened)
+        type = DemuxStream_Audio;
+    else
+        return TrickPlay_Drop;
+
+    stream = m_format->streams[packet->stream_index];
+    timestamp = packet->pts != (int64_t)AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    return m_trickPlay.filter(type, (packet->flags & AV_PKT_FLAG_KEY) ? DemuxPacket_Keyframe : 0,
+                              timestamp != (int64_t)AV_NOPTS_VALUE ? toUs(timestamp, stream->time_base) : DEMUX_TIMESTAMP_NONE);
+}
+
+int SoftwarePipeline::dispatchPacket(AVPacket* packet)
+{
+    /* 队列中的 packet 要在下一次 av_read_frame 之后仍然有效 */
+    if (av_dup_packet(packet) != 0) {
+        PipelineFreePacket(packet);
+        return 0;
+    }
+    if (packet->stream_index == m_videoIndex) {
+        m_statistics.videoPackets++;
+        return queuePacket(m_videoPackets, packet);
+    }
+    m_statistics.audioPackets++;
+    return queuePacket(m_audioPackets, packet);
+}
+
+int SoftwarePipeline::queuePacket(PipelineQueue<AVPacket*>& queue, AVPacket* packet)
+{
+    /* 队列满时也要响应 seek，不用等解码线程把旧数据消耗完 */
+    while (!queue.push(packet, PIPELINE_IDLE_WAIT_MS)) {
+        if (queue.isAborted() || m_seekRequest) {
+            PipelineFreePacket(packet);
+            return queue.isAborted() ? -1 : 0;
+        }
+    }
+    return 0;
+}
+
+int SoftwarePipeline::demuxThread(void* arg)
+{
+    SoftwarePipeline* self = (SoftwarePipeline*)arg;
+    AVPacket* packet;
+    bool ended = false;
+    int action;
+
+    while (!self->m_stopped) {
+        if (self->m_seekRequest) {
+            self->handleSeek();
+            ended = false;
+            continue;
+        }
+        if (ended) {
+            SDL_Delay(PIPELINE_IDLE_WAIT_MS);   //结束之后线程不退出，等待 seek
+            continue;
+        }
+
+        packet = (AVPacket*)av_malloc(sizeof(AVPacket));
+        if (packet == NULL)
+            break;
+        if (av_read_frame(self->m_format, packet) < 0) {
+            av_free(packet);
+            action = self->m_trickPlay.onEnd();
+        } else if (self->decodeSubtitle(packet)) {
+            PipelineFreePacket(packet);
+            continue;
+        } else {
+            action = self->filterPacket(packet);
+            if (action == TrickPlay_Output || action == TrickPlay_DecodeOnly) {
+                if (self->dispatchPacket(packet) < 0)
+                    break;
+                continue;
+            }
+            PipelineFreePacket(packet);
+        }
+
+        /* 快进快退跳到下一个位置，超过结尾时结束 */
+        if (action == TrickPlay_Seek) {
+            if ((self->getDurationUs() < 0 || self->m_trickPlay.getSeekTargetUs() < self->getDurationUs())
+                && self->seekFormat(self->m_trickPlay.getSeekTargetUs()) == 0)
+                continue;
+            action = TrickPlay_End;
+        }
+        if (action != TrickPlay_End)
+            continue;
+
+        if (self->queuePacket(self->m_videoPackets, NULL) < 0
+            || (self->m_audioOpened && self->queuePacket(self->m_audioPackets, NULL) < 0))
+            break;
+        ended = true;
+        playerLogInfo("demux end, video[%lld] audio[%lld] packets\n",
+                      (long long)self->m_statistics.videoPackets, (long long)self->m_statistics.audioPackets);
+    }
+    return 0;
+}
+
+int SoftwarePipeline::videoDecodeThread(void* arg)
+{
+    SoftwarePipeline* self = (SoftwarePipeline*)arg;
+    AVFrame* decoded;
+    AVPacket* packet;
+    AVPacket flush;
+    int64_t targetUs = -1;
+    int gotPicture, serial = 0;
+
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+    decoded = av_frame_alloc();
+#else
+    decoded = avcodec_alloc_frame();
+#endif
+    if (decoded == NULL) {
+        self->m_decoded.push(NULL);
+        return -1;
+    }
+    while (self->m_videoPackets.pop(&packet)) {
+        if (PipelineIsFlushPacket(packet)) {
+            avcodec_flush_buffers(self->m_videoCodec);
+            serial = (int)packet->pos;
+            targetUs = packet->pts;
+            PipelineFreePacket(packet);
+            continue;
+        }
+        /* seek 之前排队的 packet 不再解码 */
+        if (serial != self->m_demuxSerial) {
+            PipelineFreePacket(packet);
+            continue;
+        }
+        if (packet == NULL) {
+            /* 多线程解码时最后几帧还在解码器中，用空 packet 取出 */
+            av_init_packet(&flush);
+            flush.data = NULL;
+            flush.size = 0;
+            do {
+                gotPicture = 0;
+                if (avcodec_decode_video2(self->m_videoCodec, decoded, &gotPicture, &flush) < 0)
+                    break;
+                if (gotPicture)
+                    self->outputVideoFrame(decoded, serial, targetUs);
+            } while (gotPicture && !self->m_stopped);
+            self->outputVideoEnd(serial);
+            continue;
+        }
+
+        gotPicture = 0;
+        if (avcodec_decode_video2(self->m_videoCodec, decoded, &gotPicture, packet) < 0) {
+            self->m_statistics.decodeErrors++;
+            playerLogWarning("Decode Error, pts[%lld].\n", (long long)packet->pts);
+        } else if (gotPicture) {
+            self->outputVideoFrame(decoded, serial, targetUs);
+        }
+        PipelineFreePacket(packet);
+    }
+
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+    av_frame_free(&decoded);
+#else
+    av_free(decoded);
+#endif
+    return 0;
+}
+
+void SoftwarePipeline::outputVideoFrame(AVFrame* decoded, int serial, int64_t targetUs)
+{
+    AVStream* stream = m_format->streams[m_videoIndex];
+    PipelineFrame* frame;
+    VideoSurface* surface;
+    AVPicture picture;
+    int64_t timestamp, ptsUs, durationUs;
+
+    timestamp = decoded->best_effort_timestamp;
+    if (timestamp == (int64_t)AV_NOPTS_VALUE)
+        timestamp = decoded->pkt_pts;
+    ptsUs = timestamp != (int64_t)AV_NOPTS_VALUE ? toUs(timestamp, stream->time_base) : m_nextVideoPtsUs;
+    durationUs = m_frameDurationUs * (decoded->repeat_pict + 2) / 2;
+    m_nextVideoPtsUs = ptsUs + durationUs;
+    m_statistics.decodedFrames++;
+
+    /* 精确 seek：显示时间不包含目标的帧只解码 */
+    if (targetUs >= 0 && ptsUs + durationUs <= targetUs) {
+        m_statistics.decodeOnlyFrames++;
+        return;
+    }
+    if (!m_decodedFree.pop(&frame))
+        return;
+
+    /* 直接解码到帧池时只增加引用；否则解码器会复用自己的缓冲区，必须复制出来 */
+    surface = m_directRendering ? VideoFramePool::frameSurface(decoded) : NULL;
+    if (surface) {
+        m_framePool->addRef(surface);
+        frame->surface = surface;
+        memcpy(frame->data, decoded->data, sizeof(frame->data));
+        memcpy(frame->linesize, decoded->linesize, sizeof(frame->linesize));
+        frame->format = m_videoCodec->pix_fmt;
+        frame->width = m_videoCodec->width;
+        frame->height = m_videoCodec->height;
+    } else if (prepareFrame(frame, m_videoCodec->pix_fmt, m_videoCodec->width, m_videoCodec->height)) {
+        memcpy(picture.data, frame->data, sizeof(picture.data));
+        memcpy(picture.linesize, frame->linesize, sizeof(picture.linesize));
+        av_picture_copy(&picture, (const AVPicture*)decoded, m_videoCodec->pix_fmt, frame->width, frame->height);
+        m_statistics.copiedFrames++;
+    } else {
+        frame->width = 0;   //分配失败，后面的阶段直接归还
+    }
+
+    ThreadMutexLock(m_seekMutex);
+    frame->ptsUs = m_trickPlay.toPlayUs(ptsUs);
+    frame->durationUs = m_trickPlay.toPlayDurationUs(durationUs);
+    ThreadMutexUnLock(m_seekMutex);
+    frame->serial = serial;
+    frame->endOfStream = false;
+    m_decoded.push(frame);
+}
+
+void SoftwarePipeline::outputVideoEnd(int serial)
+{
+    PipelineFrame* frame;
+
+    if (!m_decodedFree.pop(&frame))
+        return;
+    frame->width = 0;
+    frame->serial = serial;
+    frame->endOfStream = true;
+    m_decoded.push(frame);
+}
+
+bool SoftwarePipeline::prepareFrame(PipelineFrame* frame, int format, int width, int height)
+{
+    releaseSurface(frame);
+    frame->surface = m_framePool->acquire(format, width, height);
+    if (frame->surface == NULL)
+        return false;
+    memcpy(frame->data, frame->surface->data, sizeof(frame->data));
+    memcpy(frame->linesize, frame->surface->linesize, sizeof(frame->linesize));
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    return true;
+}
+
+void SoftwarePipeline::releaseSurface(PipelineFrame* frame)
+{
+    m_framePool->release(frame->surface);
+    frame->surface = NULL;
+}
+
+int SoftwarePipeline::convertThread(void* arg)
+{
+    SoftwarePipeline* self = (SoftwarePipeline*)arg;
+    PipelineFrame* frame;
+    PipelineFrame* output;
+
+    while (self->m_decoded.pop(&frame)) {
+        if (frame == NULL) {
+            self->m_display.push(NULL);
+            break;
+        }
+        if (self->m_passThrough) {
+            if (!self->m_display.push(frame))
+                break;
+            continue;
+        }
+        /* 转换失败的帧和 seek 之前的帧不再转换；结束标记要传到显示一侧 */
+        if ((frame->width == 0 && !frame->endOfStream) || frame->serial != self->m_serial) {
+            self->releaseSurface(frame);
+            self->m_decodedFree.push(frame);
+            continue;
+        }
+
+        if (!self->m_displayFree.pop(&output))
+            break;
+        if (frame->endOfStream) {
+            output->width = 0;
+        } else if (self->prepareFrame(output, PIX_FMT_YUV420P, frame->width, frame->height)) {
+            AVPicture src, dst;
+
+            memcpy(src.data, frame->data, sizeof(src.data));
+            memcpy(src.linesize, frame->linesize, sizeof(src.linesize));
+            memcpy(dst.data, output->data, sizeof(dst.data));
+            memcpy(dst.linesize, output->linesize, sizeof(dst.linesize));
+            if (self->m_imageConvert.convert(&src, frame->format, frame->width, frame->height,
+                                             &dst, PIX_FMT_YUV420P, output->width, output->height) < 0)
+                output->width = 0;
+        } else {
+            output->width = 0;
+        }
+        output->ptsUs = frame->ptsUs;
+        output->durationUs = frame->durationUs;
+        output->serial = frame->serial;
+        output->endOfStream = frame->endOfStream;
+        self->releaseSurface(frame);
+        self->m_decodedFree.push(frame);
+        if (!self->m_display.push(output))
+            break;
+    }
+    return 0;
+}
+
+void SoftwarePipeline::releaseFrame(PipelineFrame* frame)
+{
+    releaseSurface(frame);
+    if (m_passThrough)
+        m_decodedFree.tryPush(frame);
+    else
+        m_displayFree.tryPush(frame);
+}
+
+int SoftwarePipeline::render(SDL_Renderer* renderer)
+{
+    PipelineFrame* frame;
+    int64_t waitUs = 0;
+    int action;
+
+    if (m_videoIndex < 0 || m_videoEnded || m_paused)
+        return PIPELINE_IDLE_WAIT_MS;
+
+    for (;;) {
+        if (m_pendingFrame == NULL) {
+            if (!m_display.tryPop(&m_pendingFrame))
+                return PIPELINE_IDLE_WAIT_MS;
+            if (m_pendingFrame == NULL) {
+                m_videoEnded = true;
+                playerLogInfo("video end, decoded[%lld] rendered[%lld] dropped[%lld] errors[%d]\n",
+                              (long long)m_statistics.decodedFrames, (long long)m_statistics.renderedFrames,
+                              (long long)m_statistics.droppedFrames, m_statistics.decodeErrors);
+                return PIPELINE_IDLE_WAIT_MS;
+            }
+        }
+        frame = m_pendingFrame;
+        if (frame->width == 0 || frame->serial != m_serial) {
+            m_pendingFrame = NULL;
+            releaseFrame(frame);
+            if (frame->endOfStream && frame->serial == m_serial) {
+                m_videoEnded = true;
+                playerLogInfo("video end, decoded[%lld] rendered[%lld] dropped[%lld] errors[%d]\n",
+                              (long long)m_statistics.decodedFrames, (long long)m_statistics.renderedFrames,
+                              (long long)m_statistics.droppedFrames, m_statistics.decodeErrors);
+                return PIPELINE_IDLE_WAIT_MS;
+            }
+            continue;
+        }
+
+        action = m_clock.syncVideo(frame->ptsUs, frame->durationUs, m_display.size() > 0, PipelineNowUs(), &waitUs);
+        if (action == MediaClockVideo_Wait)
+            return waitUs > 100000 ? 100 : (int)(waitUs / 1000);
+
+        /* 晚了一帧以上且后面还有帧，丢弃以追上时钟 */
+        if (action == MediaClockVideo_Drop) {
+            m_statistics.droppedFrames++;
+            releaseFrame(frame);
+            m_pendingFrame = NULL;
+            continue;
+        }
+
+        displayFrame(renderer, frame);
+        releaseFrame(frame);
+        m_pendingFrame = NULL;
+        m_statistics.renderedFrames++;
+        if (m_seekStartUs >= 0) {
+            m_statistics.seekLatencyUs = PipelineNowUs() - m_seekStartUs;
+            m_seekStartUs = -1;
+            playerLogInfo("seek latency [%lld]us, decode only [%lld] frames\n",
+                          (long long)m_statistics.seekLatencyUs, (long long)m_statistics.decodeOnlyFrames);
+        }
+        return 0;
+    }
+}
+
+void SoftwarePipeline::displayFrame(SDL_Renderer* renderer, PipelineFrame* frame)
+{
+    if (m_texture == NULL || m_textureWidth != frame->width || m_textureHeight != frame->height) {
+        if (m_texture)
+            SDL_DestroyTexture(m_texture);
+        //IYUV: Y + U + V  (3 planes)
+        m_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, frame->width, frame->height);
+        if (m_texture == NULL) {
+            playerLogError("SDL_CreateTexture failed - %s\n", SDL_GetError());
+            return;
+        }
+        m_textureWidth = frame->width;
+        m_textureHeight = frame->height;
+    }
+    SDL_UpdateYUVTexture(m_texture, NULL, frame->data[0], frame->linesize[0],
+                         frame->data[1], frame->linesize[1], frame->data[2], frame->linesize[2]);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, m_texture, NULL, NULL);
+    renderSubtitles(renderer, frame);
+    SDL_RenderPresent(renderer);
+}
+
+bool SoftwarePipeline::isFinished()
+{
+    return m_videoEnded && (!m_audioOpened || m_audioEnded);
+}
+
+int SoftwarePipeline::audioDecodeThread(void* arg)
+{
+    SoftwarePipeline* self = (SoftwarePipeline*)arg;
+    int streamIndex = self->m_audioIndex;
+    AVRational timeBase = self->m_format->streams[streamIndex]->time_base;
+    int scratchSize = AVCODEC_MAX_AUDIO_FRAME_SIZE * 3 / 2;
+    int16_t* scratch = (int16_t*)av_malloc(scratchSize);
+    int sampleRate = self->m_audioCodec->sample_rate, channels = self->m_audioCodec->channels;
+    AudioConverter converter;
+    AudioTimeStretch stretch;
+    std::vector<int16_t> converted, stretched;
+    PipelineAudioRecord record;
+    AVPacket* packet;
+    AVPacket pending;
+    int64_t ptsUs = -1, seekUs = 0;
+    int used, size, rate, serial = 0;
+    bool running = true;
+
+    /* 回调在等这个线程的数据，CPU 忙时优先调度 */
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    converter.open(sampleRate, channels, PIPELINE_AUDIO_RATE, PIPELINE_AUDIO_CHANNELS);
+    stretch.open(PIPELINE_AUDIO_RATE, PIPELINE_AUDIO_CHANNELS);
+    while (scratch && running && self->m_audioPackets.pop(&packet)) {
+        if (PipelineIsFlushPacket(packet)) {
+            avcodec_flush_buffers(self->m_audioCodec);
+            ThreadMutexLock(self->m_seekMutex);
+            rate = self->m_trickPlay.getRate();
+            ThreadMutexUnLock(self->m_seekMutex);
+            /* 只解码关键帧时没有音频 packet，倍速不在变速范围内也没有关系 */
+            if (stretch.setRate(rate) < 0)
+                stretch.setRate(TRICKPLAY_RATE_NORMAL);
+            stretch.reset();
+            converter.reset();
+            serial = (int)packet->pos;
+            seekUs = packet->pts;
+            ptsUs = -1;
+            PipelineFreePacket(packet);
+            continue;
+        }
+        if (serial != self->m_demuxSerial) {
+            PipelineFreePacket(packet);
+            continue;
+        }
+        if (packet == NULL) {
+            converted.clear();
+            stretched.clear();
+            converter.flush(converted);
+            if (!converted.empty())
+                stretch.process(&converted[0], converted.size() / PIPELINE_AUDIO_CHANNELS, stretched);
+            stretch.flush(stretched);
+            if (ptsUs >= 0 && !stretched.empty())
+                running = self->outputAudio(&stretched[0], stretched.size() / PIPELINE_AUDIO_CHANNELS, serial, &ptsUs);
+            self->outputAudioEnd(serial);
+            continue;
+        }
+
+        /* 切换音轨：之前排队的旧音轨已经解码完，新音轨从解复用切换的位置接上，声音连续 */
+        if (packet->stream_index != streamIndex) {
+            if (!self->switchAudioCodec(packet->stream_index)) {
+                PipelineFreePacket(packet);
+                continue;
+            }
+            streamIndex = packet->stream_index;
+            timeBase = self->m_format->streams[streamIndex]->time_base;
+            stretch.reset();
+            converter.reset();
+            ptsUs = -1;
+        }
+
+        /* 1x 时每个 packet 按时间戳重新对齐；变速时输出的时长和输入不同，只能按输出的长度累加 */
+        if (packet->pts != (int64_t)AV_NOPTS_VALUE && (ptsUs < 0 || stretch.getRate() == TRICKPLAY_RATE_NORMAL))
+            ptsUs = self->toPlayUs(self->toUs(packet->pts, timeBase));
+        else if (ptsUs < 0)
+            ptsUs = self->toPlayUs(seekUs);
+
+        /* 一个 packet 可能包含多帧 */
+        pending = *packet;
+        while (pending.size > 0 && running && !self->m_stopped) {
+            size = scratchSize;
+            used = avcodec_decode_audio3(self->m_audioCodec, scratch, &size, &pending);
+            if (used < 0) {
+                self->m_statistics.decodeErrors++;
+                break;
+            }
+            pending.data += used;
+            pending.size -= used;
+            if (size <= 0)
+                continue;
+
+            /* 解码器的格式可能在第一帧之后才确定(如 HE-AAC)，或者码流中途变化 */
+            if (self->m_audioCodec->sample_rate != sampleRate || self->m_audioCodec->channels != channels) {
+                playerLogInfo("audio format changed, rate[%d] channels[%d] -> rate[%d] channels[%d]\n", sampleRate, channels,
+                              self->m_audioCodec->sample_rate, self->m_audioCodec->channels);
+                sampleRate = self->m_audioCodec->sample_rate;
+                channels = self->m_audioCodec->channels;
+                if (converter.open(sampleRate, channels, PIPELINE_AUDIO_RATE, PIPELINE_AUDIO_CHANNELS) < 0) {
+                    playerLogError("audio rate[%d] channels[%d] not supported.\n", sampleRate, channels);
+                    running = false;
+                    break;
+                }
+            }
+
+            /* 非音频主时钟时按误差微调重采样比例，音频慢慢跟上主时钟 */
+            converter.setSkew(self->m_clock.getAudioSkew(PipelineNowUs()));
+            converted.clear();
+            if (converter.process(scratch, size / (channels * 2), converted) <= 0)
+                continue;
+            if (stretch.getRate() == TRICKPLAY_RATE_NORMAL) {
+                running = self->outputAudio(&converted[0], converted.size() / PIPELINE_AUDIO_CHANNELS, serial, &ptsUs);
+            } else {
+                stretched.clear();
+                if (stretch.process(&converted[0], converted.size() / PIPELINE_AUDIO_CHANNELS, stretched) > 0)
+                    running = self->outputAudio(&stretched[0], stretched.size() / PIPELINE_AUDIO_CHANNELS, serial, &ptsUs);
+            }
+        }
+        PipelineFreePacket(packet);
+    }
+
+    /* 线程退出，回调不再等待数据；关闭时环形缓冲满也没有关系 */
+    record.size = 0;
+    record.serial = -1;
+    record.ptsUs = 0;
+    record.endOfStream = 1;
+    self->m_audioRing.writeRecord(&record, sizeof(record), NULL, 0);
+    av_free(scratch);
+    return 0;
+}
+
+bool SoftwarePipeline::outputAudio(const int16_t* data, int frames, int serial, int64_t* ptsUs)
+{
+    PipelineAudioRecord record;
+    const uint8_t* pcm = (const uint8_t*)data;
+    int frameBytes = PIPELINE_AUDIO_CHANNELS * 2;
+    int size = frames * frameBytes, n;
+
+    /* 分成较小的记录，回调中按记录丢弃太晚的数据 */
+    while (size > 0) {
+        n = size;
+        if (n > PIPELINE_AUDIO_RECORD_BYTES)
+            n = PIPELINE_AUDIO_RECORD_BYTES / frameBytes * frameBytes;
+        record.size = n;
+        record.serial = serial;
+        record.ptsUs = *ptsUs;
+        record.endOfStream = 0;
+        if (!writeAudioRecord(&record, pcm))
+            return false;
+        pcm += n;
+        size -= n;
+        *ptsUs += (int64_t)n * 1000000 / m_audioBytesPerSecond;
+    }
+    return true;
+}
+
+void SoftwarePipeline::outputAudioEnd(int serial)
+{
+    PipelineAudioRecord record;
+
+    record.size = 0;
+    record.serial = serial;
+    record.ptsUs = 0;
+    record.endOfStream = 1;
+    writeAudioRecord(&record, NULL);
+}
+
+/* 环形缓冲满时等回调读出；回调不用等待任何锁，所以这里轮询；已经 seek 的数据不再需要，直接丢弃 */
+bool SoftwarePipeline::writeAudioRecord(const PipelineAudioRecord* record, const void* data)
+{
+    while (!m_audioRing.writeRecord(record, sizeof(*record), data, record->size)) {
+        if (m_stopped)
+            return false;
+        if (record->serial != m_demuxSerial)
+            return true;
+        SDL_Delay(PIPELINE_AUDIO_WAIT_MS);
+    }
+    return true;
+}
+
+void SoftwarePipeline::setFramePool(VideoFramePool* pool)
+{
+    /* 已经打开的解码器还在用原来的池 */
+    if (pool == NULL || m_format != NULL)
+        return;
+    m_framePool = pool;
+}
+
+int SoftwarePipeline::playSound(const int16_t* pcm, int frames, int sampleRate, int channels, int volume)
+{
+    if (!m_audioOpened)
+        return -1;
+    return m_audioMixer.play(pcm, frames, sampleRate, channels, volume);
+}
+
+void SoftwarePipeline::audioCallback(void* userData, Uint8* stream, int length)
+{
+    ((SoftwarePipeline*)userData)->fillAudio(stream, length);
+}
+
+void SoftwarePipeline::fillAudio(Uint8* stream, int length)
+{
+    PipelineAudioRecord* record = &m_audioRecord;
+    int frames = length / (PIPELINE_AUDIO_CHANNELS * 2);
+    int64_t startUs = -1, recordEndUs, nowUs = PipelineNowUs(), clockUs = m_clock.getUs(nowUs);
+    int written = 0, n;
+
+    while (written < length && !m_audioEnded) {
+        if (m_audioRecordLeft == 0) {
+            /* 记录是整条发布的，有数据时至少有一个完整的头 */
+            if (m_audioRing.read(record, sizeof(*record)) < (int)sizeof(*record))
+                break;
+            m_audioRecordLeft = record->size;
+            if (record->endOfStream && (record->serial == m_serial || record->serial < 0)) {
+                /* 音频结束，系统时钟从音频时钟接着走 */
+                m_clock.endAudio(PipelineNowUs());
+                m_audioEnded = true;
+                break;
+            }
+            recordEndUs = record->ptsUs + (int64_t)record->size * 1000000 / m_audioBytesPerSecond;
+            if (record->serial == m_serial && clockUs >= 0 && recordEndUs < clockUs - PIPELINE_AUDIO_DROP_US) {
+                m_statistics.droppedAudio++;
+                m_audioRing.skip(m_audioRecordLeft);
+                m_audioRecordLeft = 0;
+                continue;
+            }
+        }
+
+        /* seek 之前的，包括 seek 时正在播放的记录剩下的部分 */
+        if (record->serial != m_serial) {
+            m_audioRing.skip(m_audioRecordLeft);
+            m_audioRecordLeft = 0;
+            continue;
+        }
+        if (startUs < 0)
+            startUs = record->ptsUs + (int64_t)(record->size - m_audioRecordLeft) * 1000000 / m_audioBytesPerSecond;
+        n = m_audioRecordLeft;
+        if (n > length - written)
+            n = length - written;
+        m_audioRing.read(stream + written, n);
+        written += n;
+        m_audioRecordLeft -= n;
+    }
+
+    if (written < length) {
+        memset(stream + written, 0, length - written);
+        if (!m_audioEnded && m_audioClockUs >= 0)
+            m_statistics.audioUnderruns++;
+    }
+
+    /* 提示音在节目音频欠载或结束之后也要播放，主音量和静音对两者都起作用 */
+    m_audioMixer.mix((int16_t*)stream, frames);
+    m_audioGain.process((int16_t*)stream, frames);
+    if (m_audioEnded)
+        return;
+
+    /* 刚写入的数据要经过设备缓冲区才播放出来；欠载时静音也算时间流逝，避免视频卡住 */
+    if (startUs >= 0)
+        m_audioClockUs = startUs - m_audioLatencyUs;
+    else if (m_audioClockUs >= 0)
+        m_audioClockUs += (int64_t)length * 1000000 / m_audioBytesPerSecond;
+    if (m_audioClockUs >= 0)
+        m_clock.setAudio(m_audioClockUs, nowUs);
+}
+
+int64_t SoftwarePipeline::getClockUs()
+{
+    return m_clock.getUs(PipelineNowUs());
+}
+
+void SoftwarePipeline::setClockMode(int mode)
+{
+    m_clock.setMode(mode, PipelineNowUs());
+}
+
+void SoftwarePipeline::setExternalClock(int64_t referenceUs)
+{
+    m_clock.setExternal(referenceUs, PipelineNowUs());
+}
+
+void SoftwarePipeline::setPaused(bool paused)
+{
+    m_clock.setPaused(paused, PipelineNowUs());
+    m_paused = paused;
+
+    if (m_audioOpened)
+        SDL_PauseAudio(paused ? 1 : 0);
+}
+
+int SoftwarePipeline::seek(int64_t timeUs, bool accurate)
+{
+    int64_t durationUs = getDurationUs(), nowUs, playUs;
+
+    if (m_format == NULL || m_demuxThread == NULL)
+        return -1;
+    if (timeUs < 0 || (durationUs > 0 && timeUs > durationUs)) {
+        timeUs = durationUs > 0 ? durationUs : 0;
+        accurate = false;
+    }
+
+    /* 回调不能在中间看到新的 serial 而使用旧的时钟，先停住回调 */
+    if (m_audioOpened)
+        SDL_LockAudio();
+    nowUs = PipelineNowUs();
+    /* 时钟从第一个到达的音频或视频重新开始，seek 期间的解码时间不算落后 */
+    playUs = m_clock.flush(nowUs);
+    if (playUs < 0)
+        playUs = 0;
+    m_audioClockUs = -1;
+
+    ThreadMutexLock(m_seekMutex);
+    m_seekTargetUs = timeUs;
+    m_seekPlayUs = playUs;
+    m_seekAccurate = accurate;
+    m_serial++;
+    m_seekRequest = true;
+    ThreadMutexUnLock(m_seekMutex);
+
+    /* 环形缓冲中 seek 之前的记录由回调按 serial 跳过 */
+    m_audioEnded = false;
+    if (m_audioOpened)
+        SDL_UnlockAudio();
+
+    m_videoEnded = false;
+    m_seekStartUs = nowUs;
+    return 0;
+}
+
+int SoftwarePipeline::setRate(int rate)
+{
+    int64_t positionUs;
+
+    if (!TrickPlayControl::isSupported(rate)) {
+        playerLogWarning("rate [%d%%] not supported.\n", rate);
+        return -1;
+    }
+    if (rate == m_requestRate)
+        return 0;
+
+    /* 从当前位置按新的倍速重新开始，丢弃按旧倍速排队的数据 */
+    positionUs = getPositionUs();
+    ThreadMutexLock(m_seekMutex);
+    m_requestRate = rate;
+    ThreadMutexUnLock(m_seekMutex);
+    return seek(positionUs, true);
+}
+
+int64_t SoftwarePipeline::getPositionUs()
+{
+    int64_t clock = getClockUs(), positionUs;
+
+    ThreadMutexLock(m_seekMutex);
+    if (clock < 0 || m_demuxSerial != m_serial)
+        positionUs = m_seekTargetUs;
+    else
+        positionUs = m_trickPlay.toMediaUs(clock);
+    ThreadMutexUnLock(m_seekMutex);
+    return positionUs > 0 ? positionUs : 0;
+}
+
+void SoftwarePipeline::openSubtitle(int index)
+{
+    AVCodecContext* codecCtx = m_format->streams[index]->codec;
+    PipelineSubtitleTrack track;
+    AVCodec* codec;
+
+    PipelineTrackInfoInit(&track.info, m_format->streams[index], index);
+    track.codec = NULL;
+    track.teletext = NULL;
+    /* ffmpeg 0.8 没有图文电视的解码器 */
+    if (codecCtx->codec_id == CODEC_ID_DVB_TELETEXT) {
+        track.teletext = new TeletextDecoder();
+    } else {
+        codec = avcodec_find_decoder(codecCtx->codec_id);
+        if (codec == NULL || avcodec_open2(codecCtx, codec, NULL) < 0) {
+            playerLogWarning("subtitle stream [%d] codec [%d] not supported.\n", index, codecCtx->codec_id);
+            return;
+        }
+        track.codec = codecCtx;
+    }
+    track.queue = new SubtitleQueue();
+
+    ThreadMutexLock(m_subtitleMutex);
+    m_subtitleTracks.push_back(track);
+    ThreadMutexUnLock(m_subtitleMutex);
+    playerLogInfo("subtitle track [%d], stream [%d] pid [%d] codec [%d] language [%s]\n", (int)m_subtitleTracks.size() - 1,
+                  index, track.info.pid, track.info.codecId, track.info.language.c_str());
+}
+
+void SoftwarePipeline::closeSubtitles()
+{
+    unsigned int i;
+
+    /* 解复用线程已经退出 */
+    ThreadMutexLock(m_subtitleMutex);
+    for (i = 0; i < m_subtitleTracks.size(); i++) {
+        if (m_subtitleTracks[i].codec)
+            avcodec_close(m_subtitleTracks[i].codec);
+        delete m_subtitleTracks[i].teletext;
+        delete m_subtitleTracks[i].queue;
+    }
+    m_subtitleTracks.clear();
+    m_subtitleTrack = -1;
+    m_externalSubtitles = 0;
+    ThreadMutexUnLock(m_subtitleMutex);
+}
+
+bool SoftwarePipeline::decodeSubtitle(AVPacket* packet)
+{
+    AVStream* stream = m_format->streams[packet->stream_index];
+    PipelineSubtitleTrack track;
+    std::vector<SubtitleCue> cues;
+    AVSubtitle subtitle;
+    int64_t timestamp, ptsUs;
+    unsigned int i;
+    int gotSubtitle = 0;
+    bool found;
+
+    if (stream->codec->codec_type != AVMEDIA_TYPE_SUBTITLE)
+        return false;
+
+    /* 复制一份，追加外挂字幕时数组可能重新分配，各个指针不变 */
+    ThreadMutexLock(m_subtitleMutex);
+    for (i = 0; i < m_subtitleTracks.size() && m_subtitleTracks[i].info.streamIndex != packet->stream_index; i++);
+    found = i < m_subtitleTracks.size();
+    if (found)
+        track = m_subtitleTracks[i];
+    ThreadMutexUnLock(m_subtitleMutex);
+
+    /* 不支持的字幕流也在这里丢弃 */
+    timestamp = packet->pts != (int64_t)AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (!found || timestamp == (int64_t)AV_NOPTS_VALUE)
+        return true;
+    ptsUs = toUs(timestamp, stream->time_base);
+
+    if (track.teletext) {
+        track.teletext->decode(packet->data, packet->size, ptsUs, cues);
+    } else if (avcodec_decode_subtitle2(track.codec, &subtitle, &gotSubtitle, packet) >= 0 && gotSubtitle) {
+        cues.resize(1);
+        PipelineSubtitleToCue(&subtitle, track.codec, ptsUs, &cues[0]);
+        avsubtitle_free(&subtitle);
+    }
+    for (i = 0; i < cues.size(); i++)
+        track.queue->insert(cues[i]);
+    return true;
+}
+
+int SoftwarePipeline::addExternalSubtitle(const char* path)
+{
+    PipelineSubtitleTrack track;
+    int index;
+
+    track.queue = new SubtitleQueue();
+    if (SubtitleParser::load(path, track.queue) < 0) {
+        delete track.queue;
+        return -1;
+    }
+    track.codec = NULL;
+    track.teletext = NULL;
+    track.info.streamIndex = -1;
+    track.info.codecId = CODEC_ID_NONE;
+    track.info.path = path;
+
+    ThreadMutexLock(m_subtitleMutex);
+    track.info.pid = PIPELINE_EXTERNAL_PID_BASE + m_externalSubtitles++;
+    m_subtitleTracks.push_back(track);
+    index = m_subtitleTracks.size() - 1;
+    m_subtitleTrack = index;
+    ThreadMutexUnLock(m_subtitleMutex);
+    playerLogInfo("subtitle track [%d], external [%s]\n", index, path);
+    return index;
+}
+
+int SoftwarePipeline::getSubtitleTrackCount()
+{
+    int count;
+
+    ThreadMutexLock(m_subtitleMutex);
+    count = m_subtitleTracks.size();
+    ThreadMutexUnLock(m_subtitleMutex);
+    return count;
+}
+
+bool SoftwarePipeline::getSubtitleTrackInfo(int index, PipelineTrackInfo* info)
+{
+    bool found;
+
+    ThreadMutexLock(m_subtitleMutex);
+    found = index >= 0 && index < (int)m_subtitleTracks.size();
+    if (found)
+        *info = m_subtitleTracks[index].info;
+    ThreadMutexUnLock(m_subtitleMutex);
+    return found;
+}
+
+int SoftwarePipeline::findSubtitleTrack(int pid)
+{
+    int index;
+
+    ThreadMutexLock(m_subtitleMutex);
+    for (index = m_subtitleTracks.size() - 1; index >= 0 && m_subtitleTracks[index].info.pid != pid; index--);
+    ThreadMutexUnLock(m_subtitleMutex);
+    return index;
+}
+
+int SoftwarePipeline::selectSubtitle(int index)
+{
+    ThreadMutexLock(m_subtitleMutex);
+    if (index < -1 || index >= (int)m_subtitleTracks.size()) {
+        ThreadMutexUnLock(m_subtitleMutex);
+        playerLogWarning("subtitle track [%d] not found.\n", index);
+        return -1;
+    }
+    m_subtitleTrack = index;
+    ThreadMutexUnLock(m_subtitleMutex);
+    playerLogInfo("subtitle track [%d] selected\n", index);
+    return 0;
+}
+
+int64_t SoftwarePipeline::getActiveSubtitles(std::vector<SubtitleCue>& cues)
+{
+    SubtitleQueue* queue = NULL;
+
+    ThreadMutexLock(m_subtitleMutex);
+    if (m_subtitleTrack >= 0)
+        queue = m_subtitleTracks[m_subtitleTrack].queue;
+    ThreadMutexUnLock(m_subtitleMutex);
+    if (queue == NULL) {
+        cues.clear();
+        return SUBTITLE_TIME_NONE;
+    }
+    return queue->getActive(getPositionUs(), cues);
+}
+
+void SoftwarePipeline::renderSubtitles(SDL_Renderer* renderer, PipelineFrame* frame)
+{
+    std::vector<SubtitleCue> cues;
+    SubtitleQueue* queue = NULL;
+    int64_t mediaUs;
+    int track;
+
+    ThreadMutexLock(m_subtitleMutex);
+    track = m_subtitleTrack;
+    if (track >= 0)
+        queue = m_subtitleTracks[track].queue;
+    ThreadMutexUnLock(m_subtitleMutex);
+    if (queue == NULL) {
+        m_subtitleShownTrack = -1;
+        return;
+    }
+
+    /* 按这一帧的媒体时间，和视频同步 */
+    ThreadMutexLock(m_seekMutex);
+    mediaUs = m_trickPlay.toMediaUs(frame->ptsUs);
+    ThreadMutexUnLock(m_seekMutex);
+
+    /* 结果在 [m_subtitleQueryUs, m_subtitleChangeUs) 内不变，除非轨道切换或者有新的字幕 */
+    if (track != m_subtitleShownTrack || queue->getGeneration() != m_subtitleGeneration
+        || mediaUs < m_subtitleQueryUs || mediaUs >= m_subtitleChangeUs) {
+        m_subtitleGeneration = queue->getGeneration();
+        m_subtitleChangeUs = queue->getActive(mediaUs, cues);
+        m_subtitleQueryUs = mediaUs;
+        if (track != m_subtitleShownTrack || !PipelineSameCues(cues, m_subtitleCues)) {
+            m_subtitleCues.swap(cues);
+            m_subtitleShownTrack = track;
+            updateSubtitleTexture(renderer, frame->width, frame->height);
+        }
+    }
+    if (m_subtitleVisible)
+        SDL_RenderCopy(renderer, m_subtitleTexture, NULL, NULL);
+}
+
+/* 画刷按字幕的画面大小创建，显示时和视频一样缩放到整个窗口 */
+void SoftwarePipeline::updateSubtitleTexture(SDL_Renderer* renderer, int width, int height)
+{
+    const SubtitleBitmap* bitmap;
+    uint8_t* pixels;
+    unsigned int i, j;
+    int pitch, x, y, left, right;
+
+    m_subtitleVisible = false;
+    for (i = 0; i < m_subtitleCues.size() && m_subtitleCues[i].bitmaps.empty(); i++);
+    if (i == m_subtitleCues.size())
+        return;
+    if (m_subtitleCues[i].canvasWidth > 0 && m_subtitleCues[i].canvasHeight > 0) {
+        width = m_subtitleCues[i].canvasWidth;
+        height = m_subtitleCues[i].canvasHeight;
+    }
+
+    if (m_subtitleTexture == NULL || m_subtitleTextureWidth != width || m_subtitleTextureHeight != height) {
+        if (m_subtitleTexture)
+            SDL_DestroyTexture(m_subtitleTexture);
+        m_subtitleTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (m_subtitleTexture == NULL) {
+            playerLogError("SDL_CreateTexture failed - %s\n", SDL_GetError());
+            m_subtitleTextureWidth = m_subtitleTextureHeight = 0;
+            return;
+        }
+        SDL_SetTextureBlendMode(m_subtitleTexture, SDL_BLENDMODE_BLEND);
+        m_subtitleTextureWidth = width;
+        m_subtitleTextureHeight = height;
+    }
+    if (SDL_LockTexture(m_subtitleTexture, NULL, (void**)&pixels, &pitch) < 0)
+        return;
+
+    /* 透明的底，各区域按坐标裁剪到画面内 */
+    for (y = 0; y < height; y++)
+        memset(pixels + y * pitch, 0, width * 4);
+    for (i = 0; i < m_subtitleCues.size(); i++) {
+        for (j = 0; j < m_subtitleCues[i].bitmaps.size(); j++) {
+            bitmap = &m_subtitleCues[i].bitmaps[j];
+            left = bitmap->x < 0 ? -bitmap->x : 0;
+            right = bitmap->x + bitmap->width > width ? width - bitmap->x : bitmap->width;
+            for (y = bitmap->y < 0 ? -bitmap->y : 0; y < bitmap->height && bitmap->y + y < height && left < right; y++) {
+                for (x = left; x < right; x++) {
+                    if (bitmap->pixels[y * bitmap->width + x] >> 24)
+                        ((uint32_t*)(pixels + (bitmap->y + y) * pitch))[bitmap->x + x] = bitmap->pixels[y * bitmap->width + x];
+                }
+            }
+        }
+    }
+    SDL_UnlockTexture(m_subtitleTexture);
+    m_subtitleVisible = true;
+}
+
+int SoftwarePipeline::selectAudioTrack(int index)
+{
+    AVCodecContext* codecCtx;
+    int streamIndex;
+    bool pending;
+
+    if (!m_audioOpened || index < 0 || index >= (int)m_audioTracks.size()) {
+        playerLogWarning("audio track [%d] can't be selected.\n", index);
+        return -1;
+    }
+    streamIndex = m_audioTracks[index].streamIndex;
+    if (streamIndex == m_audioIndex)
+        return 0;
+
+    ThreadMutexLock(m_seekMutex);
+    pending = m_audioSwitchCodec != NULL;
+    ThreadMutexUnLock(m_seekMutex);
+    if (pending) {
+        playerLogWarning("audio track switching in progress.\n");
+        return -1;
+    }
+
+    /* 在这里打开，不支持的格式直接返回失败，当前音轨不受影响 */
+    codecCtx = m_format->streams[streamIndex]->codec;
+    if (openAudioCodec(codecCtx) < 0)
+        return -1;
+
+    if (m_audioThread == NULL) {
+        avcodec_close(m_audioCodec);
+        m_audioCodec = codecCtx;
+        m_audioIndex = streamIndex;
+    } else {
+        ThreadMutexLock(m_seekMutex);
+        m_audioSwitchCodec = codecCtx;
+        m_audioIndex = streamIndex;
+        ThreadMutexUnLock(m_seekMutex);
+    }
+    playerLogInfo("audio track [%d] stream [%d] selected\n", index, streamIndex);
+    return 0;
+}
+
+bool SoftwarePipeline::switchAudioCodec(int streamIndex)
+{
+    AVCodecContext* codecCtx;
+
+    ThreadMutexLock(m_seekMutex);
+    codecCtx = m_audioSwitchCodec;
+    if (codecCtx != NULL && codecCtx == m_format->streams[streamIndex]->codec)
+        m_audioSwitchCodec = NULL;
+    else
+        codecCtx = NULL;
+    ThreadMutexUnLock(m_seekMutex);
+    if (codecCtx == NULL)
+        return false;
+
+    avcodec_close(m_audioCodec);
+    m_audioCodec = codecCtx;
+    playerLogInfo("audio decoder switched to stream [%d]\n", streamIndex);
+    return true;
+}
+
+int SoftwarePipeline::getAudioTrack()
+{
+    int index;
+
+    for (index = m_audioTracks.size() - 1; index >= 0 && m_audioTracks[index].streamIndex != m_audioIndex; index--);
+    return m_audioOpened ? index : -1;
+}
+
+bool SoftwarePipeline::getAudioTrackInfo(int index, PipelineTrackInfo* info)
+{
+    if (index < 0 || index >= (int)m_audioTracks.size())
+        return false;
+    *info = m_audioTracks[index];
+    return true;
+}
+
+int SoftwarePipeline::findAudioTrack(int pid)
+{
+    int index;
+
+    for (index = m_audioTracks.size() - 1; index >= 0 && m_audioTracks[index].pid != pid; index--);
+    return index;
+}
@@ -0,0 +1,332 @@
+#ifndef __SOFTWARE_PIPELINE_H__
+#define __SOFTWARE_PIPELINE_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//Linux...
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <SDL2/SDL.h>
+};
+
+#include "ThreadMutex.h"
+#include "PipelineQueue.h"
+#include "ImageConvert.h"
+#include "VideoFramePool.h"
+#include "AudioTimeStretch.h"
+#include "AudioRingBuffer.h"
+#include "AudioResampler.h"
+#include "AudioMixer.h"
+#include "MediaClock.h"
+#include "TrickPlay.h"
+#include "SubtitleQueue.h"
+#include "TeletextDecoder.h"
+
+
+#define     PIPELINE_VIDEO_PACKETS      256         //解复用之后等待解码的 packet 数
+#define     PIPELINE_AUDIO_PACKETS      256
+#define     PIPELINE_DECODED_FRAMES     4           //解码之后等待转换的帧
+#define     PIPELINE_DISPLAY_FRAMES     3           //转换之后等待显示的帧
+#define     PIPELINE_AUDIO_BUFFER_MS    500         //解码之后等待播放的 PCM，按输出格式的时长
+#define     PIPELINE_AUDIO_RECORD_BYTES 8192        //环形缓冲中每条记录的最大 PCM 字节数
+#define     PIPELINE_AUDIO_RATE         48000       //输出格式固定，和解码器的格式无关
+#define     PIPELINE_AUDIO_CHANNELS     2
+#define     PIPELINE_AUDIO_WAIT_MS      5           //环形缓冲满时解码线程的等待间隔
+#define     PIPELINE_DECODE_THREADS_MAX 16
+#define     PIPELINE_IDLE_WAIT_MS       10          //暂停或没有帧时 render() 建议的等待时间
+#define     PIPELINE_AUDIO_DROP_US      100000      //时钟已经超过 PCM 这么多时丢弃，追上视频
+#define     PIPELINE_SUBTITLE_WIDTH     720         //DVB 字幕没有 display definition 时坐标所在的画面大小
+#define     PIPELINE_SUBTITLE_HEIGHT    576
+#define     PIPELINE_EXTERNAL_PID_BASE  0x10000     //外挂字幕的 PID 从这里开始，TS 的 PID 只有 13 位
+
+
+typedef struct _PipelineFrame {
+    uint8_t*        data[4];
+    int             linesize[4];
+    int             width;
+    int             height;
+    int             format;             //PixelFormat
+    int64_t         ptsUs;
+    int64_t         durationUs;
+    VideoSurface*   surface;            //data 所在的帧池 surface，持有一个引用，回到空闲队列之前释放
+    int             serial;             //seek 的序号，和当前不同的帧直接归还
+    bool            endOfStream;        //width 为 0，表示该 serial 的码流结束
+} PipelineFrame;
+
+/* 环形缓冲中每段 PCM 前面的头，PCM 为输出格式的 AUDIO_S16SYS 交织 */
+typedef struct _PipelineAudioRecord {
+    int             size;               //后面 PCM 的字节数
+    int             serial;             //-1 为解码线程退出
+    int64_t         ptsUs;
+    int             endOfStream;        //size 为 0
+} PipelineAudioRecord;
+
+typedef struct _PipelineStatistics {
+    int64_t         videoPackets;
+    int64_t         audioPackets;
+    int64_t         decodedFrames;
+    int64_t         copiedFrames;       //解码器不能直接解码到帧池，输出时复制的帧
+    int64_t         renderedFrames;
+    int64_t         droppedFrames;      //太晚而丢弃的帧
+    int64_t         droppedAudio;       //太晚而丢弃的 PCM 记录
+    int             decodeErrors;
+    int             audioUnderruns;
+    int             decodeThreads;      //ffmpeg 视频解码线程数
+    int             seeks;
+    int64_t         decodeOnlyFrames;   //精确 seek 时目标之前只解码不显示的帧
+    int64_t         seekLatencyUs;      //最近一次 seek 到显示第一帧
+} PipelineStatistics;
+
+
+typedef struct _PipelineTrackInfo {
+    int             streamIndex;        //AVFormatContext 中流的序号，外挂字幕为 -1
+    int             pid;                //TS 的 PID(AVStream::id)，没有时为流的序号；外挂字幕从 PIPELINE_EXTERNAL_PID_BASE 开始
+    int             codecId;            //CodecID，外挂字幕为 CODEC_ID_NONE
+    std::string     language;           //ISO 639 语言码，未知为空
+    std::string     path;               //外挂字幕的文件
+} PipelineTrackInfo;
+
+/* 一个字幕轨道，所有轨道都由解复用线程解码，切换时不需要重新读数据 */
+typedef struct _PipelineSubtitleTrack {
+    PipelineTrackInfo   info;
+    AVCodecContext*     codec;          //ffmpeg 解码的字幕(DVB、文字)，否则为 NULL
+    TeletextDecoder*    teletext;       //EBU 图文电视字幕，否则为 NULL
+    SubtitleQueue*      queue;
+} PipelineSubtitleTrack;
+
+
+class SoftwarePipeline { /* 解复用、视频解码、音频解码、格式转换、显示分别在不同线程，之间用有界的无锁队列连接 */
+    public:
+        SoftwarePipeline();
+        ~SoftwarePipeline();
+
+        int open(const char* url);          //打开文件和解码器，音频设备打开失败时只播放视频
+        void close();
+        int start();                        //启动各阶段的线程
+        void setPaused(bool paused);
+        bool isPaused() { return m_paused; }
+        bool isFinished();                  //所有帧都已显示
+
+        /**
+         *  @Func: seek
+         *         ps. :异步，由解复用线程执行，之前排队的数据按 serial 丢弃；在 render() 的线程中调用
+         *  @Param: timeUs, type:: int64_t, 从 0 开始的媒体时间，小于 0 或超过时长为结尾(显示最后一个关键帧)
+         *  @Param: accurate, type:: bool, true 时目标之前的帧只解码不显示，false 时从之前的关键帧开始显示
+         *  @Return: int, 0 成功，还没有 start() 返回 -1
+         *
+         **/
+        int seek(int64_t timeUs, bool accurate);
+        int setRate(int rate);              //百分比，范围见 TrickPlay.h，从当前位置按新的倍速继续
+        int getRate() { return m_requestRate; }
+        int64_t getPositionUs();            //当前显示的媒体时间
+        int64_t getDurationUs();            //未知返回 -1
+
+        /**
+         *  @Func: render
+         *         ps. :在创建窗口的线程中调用，按主时钟(见 setClockMode)显示到期的帧，丢弃太晚的帧
+         *  @Param: renderer, type:: SDL_Renderer*
+         *  @Return: int, 距离下一帧到期的毫秒数，作为 SDL_WaitEventTimeout 的超时
+         *
+         **/
+        int render(SDL_Renderer* renderer);
+
+        int getVideoWidth() { return m_videoCodec ? m_videoCodec->width : 0; }
+        int getVideoHeight() { return m_videoCodec ? m_videoCodec->height : 0; }
+        int64_t getClockUs();
+        void setClockMode(int mode);        //MediaClockMode，默认音频主时钟；非音频主时钟时音频用重采样微调跟随
+        void setExternalClock(int64_t referenceUs);     //外部参考模式下调用，PCR/NTP 换算到播放时间
+        MediaClockStatistics getSyncStatistics() { return m_clock.getStatistics(); }
+        void setVolume(int volume) { m_audioGain.setVolume(volume); }     //0~AUDIO_VOLUME_MAX，渐变
+        int getVolume() { return m_audioGain.getVolume(); }
+        void setMute(bool mute) { m_audioGain.setMute(mute); }
+        bool getMute() { return m_audioGain.getMute(); }
+
+        /**
+         *  @Func: playSound
+         *         ps. :提示音叠加在节目音频上，同样受主音量和静音控制；暂停时等恢复之后播放，音频设备没有打开时返回 -1
+         *  @Param: pcm, type:: const int16_t*, S16 交织，任意采样率和声道数
+         *  @Param: frames, type:: int
+         *  @Param: sampleRate, type:: int
+         *  @Param: channels, type:: int
+         *  @Param: volume, type:: int, 0~AUDIO_VOLUME_MAX
+         *  @Return: int, 0 成功
+         *
+         **/
+        int playSound(const int16_t* pcm, int frames, int sampleRate, int channels, int volume);
+        const PipelineStatistics& getStatistics() { return m_statistics; }
+        void setFramePool(VideoFramePool* pool);    //open() 之前调用，默认 VideoFramePool::shared()
+        VideoFramePoolStatistics getFramePoolStatistics() { return m_framePool->getStatistics(); }
+
+        /**
+         *  @Func: addExternalSubtitle
+         *         ps. :SRT、ASS/SSA 文件一次读入，加入之后选中；open() 之后随时可以调用
+         *  @Param: path, type:: const char*
+         *  @Return: int, 轨道序号，失败返回 -1
+         *
+         **/
+        int addExternalSubtitle(const char* path);
+        int getSubtitleTrackCount();
+        bool getSubtitleTrackInfo(int index, PipelineTrackInfo* info);
+        int findSubtitleTrack(int pid);             //没有返回 -1
+        int selectSubtitle(int index);              //-1 为关闭，立即生效
+        int getSubtitleTrack() { return m_subtitleTrack; }
+
+        /**
+         *  @Func: getActiveSubtitles
+         *         ps. :当前位置显示的字幕；图形字幕由 render() 叠加在视频上，文字字幕由上层绘制
+         *  @Param: cues, type:: std::vector<SubtitleCue>&
+         *  @Return: int64_t, 结果在这个媒体时间之前不变，见 SubtitleQueue::getActive；没有选中字幕时为 SUBTITLE_TIME_NONE
+         *
+         **/
+        int64_t getActiveSubtitles(std::vector<SubtitleCue>& cues);
+
+        /**
+         *  @Func: selectAudioTrack
+         *         ps. :解复用从当前位置开始只送新音轨的 packet，已经排队的旧音轨播放完之后音频线程换解码器，声音连续；
+         *               音频设备没有打开或者上一次切换还没有完成时返回 -1
+         *  @Param: index, type:: int, 音轨序号
+         *  @Return: int, 0 成功
+         *
+         **/
+        int selectAudioTrack(int index);
+        int getAudioTrack();
+        int getAudioTrackCount() { return m_audioTracks.size(); }
+        bool getAudioTrackInfo(int index, PipelineTrackInfo* info);
+        int findAudioTrack(int pid);
+
+    private:
+        static int demuxThread(void* arg);
+        static int videoDecodeThread(void* arg);
+        static int audioDecodeThread(void* arg);
+        static int convertThread(void* arg);
+        static void audioCallback(void* userData, Uint8* stream, int length);
+
+        int openVideo(int index);
+        int openAudio(int index);
+        int openAudioCodec(AVCodecContext* codecCtx);  //失败时已经关闭
+        bool switchAudioCodec(int streamIndex);         //音频线程中调用
+        void openSubtitle(int index);
+        void closeSubtitles();
+        bool decodeSubtitle(AVPacket* packet);          //字幕 packet 返回 true，由调用者释放
+        void renderSubtitles(SDL_Renderer* renderer, PipelineFrame* frame);
+        void updateSubtitleTexture(SDL_Renderer* renderer, int width, int height);
+        int64_t toUs(int64_t timestamp, AVRational timeBase);
+        int64_t toPlayUs(int64_t ptsUs);
+        int seekFormat(int64_t timeUs);
+        void handleSeek();
+        int filterPacket(AVPacket* packet);
+        int dispatchPacket(AVPacket* packet);
+        int queuePacket(PipelineQueue<AVPacket*>& queue, AVPacket* packet);
+        void outputVideoFrame(AVFrame* decoded, int serial, int64_t targetUs);
+        void outputVideoEnd(int serial);
+        bool outputAudio(const int16_t* data, int frames, int serial, int64_t* ptsUs);
+        bool writeAudioRecord(const PipelineAudioRecord* record, const void* data);
+        void outputAudioEnd(int serial);
+        bool prepareFrame(PipelineFrame* frame, int format, int width, int height);
+        void releaseSurface(PipelineFrame* frame);
+        void releaseFrame(PipelineFrame* frame);
+        void displayFrame(SDL_Renderer* renderer, PipelineFrame* frame);
+        void fillAudio(Uint8* stream, int length);
+        void drainQueues();
+
+        AVFormatContext*                    m_format;
+        AVCodecContext*                     m_videoCodec;
+        AVCodecContext*                     m_audioCodec;
+        int                                 m_videoIndex;
+        volatile int                        m_audioIndex;       //切换音轨时由控制线程修改
+        int64_t                             m_startTime;        //AV_TIME_BASE，时间戳从 0 开始
+        int64_t                             m_frameDurationUs;
+        int64_t                             m_nextVideoPtsUs;   //解码帧没有时间戳时使用
+        bool                                m_passThrough;      //解码输出已经是 YUV420P，不需要转换
+        ImageConvert                        m_imageConvert;
+        VideoFramePool*                     m_framePool;        //解码、转换、显示共用
+        bool                                m_directRendering;  //解码器直接解码到帧池
+
+        /* 各阶段之间的队列，packet 为 NULL、帧和 PCM 记录为 endOfStream 表示码流结束 */
+        PipelineQueue<AVPacket*>            m_videoPackets;
+        PipelineQueue<AVPacket*>            m_audioPackets;
+        PipelineQueue<PipelineFrame*>       m_decoded;
+        PipelineQueue<PipelineFrame*>       m_display;
+
+        /* 空闲的帧，由使用完的一方归还 */
+        PipelineQueue<PipelineFrame*>       m_decodedFree;
+        PipelineQueue<PipelineFrame*>       m_displayFree;
+        PipelineFrame                       m_frames[PIPELINE_DECODED_FRAMES + PIPELINE_DISPLAY_FRAMES];
+
+        SDL_Thread*                         m_demuxThread;
+        SDL_Thread*                         m_videoThread;
+        SDL_Thread*                         m_audioThread;
+        SDL_Thread*                         m_convertThread;
+        volatile bool                       m_stopped;
+        volatile bool                       m_paused;
+
+        /* 显示，只在 render() 的线程中使用 */
+        SDL_Texture*                        m_texture;
+        int                                 m_textureWidth;
+        int                                 m_textureHeight;
+        PipelineFrame*                      m_pendingFrame;     //已经取出但还没到时间的帧
+        bool                                m_videoEnded;
+
+        /* 音频：解码线程转换为输出格式写入环形缓冲，回调读出后叠加提示音、乘音量 */
+        bool                                m_audioOpened;
+        volatile bool                       m_audioEnded;
+        int                                 m_audioBytesPerSecond;
+        int                                 m_audioLatencyUs;   //设备缓冲区的时长
+        AudioRingBuffer                     m_audioRing;        //PipelineAudioRecord 和 PCM 交替
+        PipelineAudioRecord                 m_audioRecord;      //回调正在播放的记录
+        int                                 m_audioRecordLeft;  //该记录还没有读出的字节数
+        AudioGain                           m_audioGain;
+        AudioMixer                          m_audioMixer;
+
+        /* 主时钟 */
+        MediaClock                          m_clock;
+        int64_t                             m_audioClockUs;     //回调最近一次报告的位置，-1 为未知；只在回调和锁住回调时使用
+
+        /* seek 和倍速：控制线程提出请求，解复用线程执行，serial 区分 seek 前后的数据 */
+        ThreadMutex_Type                    m_seekMutex;
+        TrickPlayControl                    m_trickPlay;        //解复用线程使用，换算时间时加 m_seekMutex
+        volatile bool                       m_seekRequest;
+        int64_t                             m_seekTargetUs;
+        int64_t                             m_seekPlayUs;       //目标显示时的播放时间
+        bool                                m_seekAccurate;
+        int                                 m_requestRate;
+        volatile int                        m_serial;           //最近一次请求
+        volatile int                        m_demuxSerial;      //解复用已经执行到的请求
+        int64_t                             m_seekStartUs;      //显示第一帧之后为 -1
+
+        /* 音轨：切换时控制线程打开新的解码器，音频线程收到新音轨的 packet 时换用 */
+        std::vector<PipelineTrackInfo>      m_audioTracks;      //open() 之后不变
+        AVCodecContext*                     m_audioSwitchCodec; //还没有换用的解码器，加 m_seekMutex
+
+        /* 字幕：轨道列表可以在播放中追加，queue 等指针在 close() 之前一直有效 */
+        ThreadMutex_Type                    m_subtitleMutex;    //保护 m_subtitleTracks 和 m_subtitleTrack
+        std::vector<PipelineSubtitleTrack>  m_subtitleTracks;
+        volatile int                        m_subtitleTrack;    //-1 为关闭
+        int                                 m_externalSubtitles;
+
+        /* 图形字幕的叠加，只在 render() 的线程中使用；字幕没有变化时不重新查找、不更新画刷 */
+        SDL_Texture*                        m_subtitleTexture;
+        int                                 m_subtitleTextureWidth;
+        int                                 m_subtitleTextureHeight;
+        bool                                m_subtitleVisible;  //画刷中有内容
+        std::vector<SubtitleCue>            m_subtitleCues;     //当前显示的字幕
+        int                                 m_subtitleShownTrack;
+        uint32_t                            m_subtitleGeneration;
+        int64_t                             m_subtitleQueryUs;  //m_subtitleCues 在 [m_subtitleQueryUs, m_subtitleChangeUs) 有效
+        int64_t                             m_subtitleChangeUs;
+
+        PipelineStatistics                  m_statistics;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__SOFTWARE_PIPELINE_H__
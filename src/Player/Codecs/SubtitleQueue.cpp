@@ -0,0 +1,174 @@
+/**
+ *  SubtitleQueue.cpp文件
+ *  字幕轨道的时间索引；
+ *  主要有以下部分：
+ *      1. 插入：按开始时间二分查找位置，忽略重复的字幕，截断前面没有结束时间的字幕
+ *      2. 索引：按开始时间排好的数组上建一棵隐式的区间树，节点为子树中最晚的结束时间，插入之后在下一次查找时 O(n) 重建
+ *      3. 查找：开始时间 <= t 的前缀中，剪掉最晚结束时间 <= t 的子树，O(log n + k)
+ *
+ **/
+
+#include "SubtitleQueue.h"
+
+
+void SubtitleCueInit(SubtitleCue* cue, int64_t startUs, int64_t endUs)
+{
+    cue->startUs = startUs;
+    cue->open = endUs < 0;
+    cue->endUs = cue->open ? startUs + SUBTITLE_OPEN_MAX_US : endUs;
+    cue->text.clear();
+    cue->bitmaps.clear();
+    cue->canvasWidth = 0;
+    cue->canvasHeight = 0;
+}
+
+
+SubtitleQueue::SubtitleQueue()
+    : m_leaves(0)
+    , m_dirty(true)
+    , m_generation(0)
+{
+    m_mutex = ThreadMutexCreate();
+}
+
+SubtitleQueue::~SubtitleQueue()
+{
+    ThreadMutexDestroy(m_mutex);
+}
+
+int SubtitleQueue::upperBound(int64_t timeUs)
+{
+    int low = 0, high = m_cues.size(), middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (m_cues[middle].startUs <= timeUs)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static bool SubtitleCueSame(const SubtitleCue& a, const SubtitleCue& b)
+{
+    unsigned int i;
+
+    if (a.text != b.text || a.bitmaps.size() != b.bitmaps.size())
+        return false;
+    for (i = 0; i < a.bitmaps.size(); i++) {
+        if (a.bitmaps[i].x != b.bitmaps[i].x || a.bitmaps[i].y != b.bitmaps[i].y
+            || a.bitmaps[i].width != b.bitmaps[i].width || a.bitmaps[i].height != b.bitmaps[i].height)
+            return false;
+    }
+    return true;
+}
+
+bool SubtitleQueue::insert(const SubtitleCue& cue)
+{
+    int position, i;
+    bool stored = !cue.text.empty() || !cue.bitmaps.empty();
+
+    ThreadMutexLock(m_mutex);
+    position = upperBound(cue.startUs);
+    for (i = position - 1; stored && i >= 0 && m_cues[i].startUs == cue.startUs; i--) {
+        if (SubtitleCueSame(m_cues[i], cue)) {
+            ThreadMutexUnLock(m_mutex);
+            return false;
+        }
+    }
+
+    /* 前面最近的 open 字幕到这里为止，清除也一样 */
+    for (i = position - 1; i >= 0; i--) {
+        if (m_cues[i].open && m_cues[i].startUs < cue.startUs) {
+            if (m_cues[i].endUs > cue.startUs)
+                m_cues[i].endUs = cue.startUs;
+            break;
+        }
+    }
+
+    if (stored) {
+        m_cues.insert(m_cues.begin() + position, cue);
+        /* 乱序插入时 open 字幕到后面一条为止 */
+        if (cue.open && position + 1 < (int)m_cues.size() && m_cues[position + 1].startUs < m_cues[position].endUs)
+            m_cues[position].endUs = m_cues[position + 1].startUs;
+        if (m_cues.size() > SUBTITLE_QUEUE_CUES_MAX)
+            m_cues.erase(m_cues.begin());
+    }
+    m_dirty = true;
+    m_generation++;
+    ThreadMutexUnLock(m_mutex);
+    return stored;
+}
+
+void SubtitleQueue::clear()
+{
+    ThreadMutexLock(m_mutex);
+    m_cues.clear();
+    m_dirty = true;
+    m_generation++;
+    ThreadMutexUnLock(m_mutex);
+}
+
+int SubtitleQueue::size()
+{
+    int size;
+
+    ThreadMutexLock(m_mutex);
+    size = m_cues.size();
+    ThreadMutexUnLock(m_mutex);
+    return size;
+}
+
+void SubtitleQueue::rebuild()
+{
+    int count = m_cues.size(), i;
+
+    for (m_leaves = 1; m_leaves < count; m_leaves *= 2);
+    m_maxEnd.assign(m_leaves * 2, -SUBTITLE_TIME_NONE);
+    for (i = 0; i < count; i++)
+        m_maxEnd[m_leaves + i] = m_cues[i].endUs;
+    for (i = m_leaves - 1; i > 0; i--)
+        m_maxEnd[i] = m_maxEnd[i * 2] > m_maxEnd[i * 2 + 1] ? m_maxEnd[i * 2] : m_maxEnd[i * 2 + 1];
+    m_dirty = false;
+}
+
+/* 节点 node 包含 [begin, end)，只看下标小于 limit(开始时间 <= timeUs)的字幕 */
+void SubtitleQueue::collect(int node, int begin, int end, int limit, int64_t timeUs, std::vector<int>& result)
+{
+    int middle;
+
+    if (begin >= limit || m_maxEnd[node] <= timeUs)
+        return;
+    if (end - begin == 1) {
+        result.push_back(begin);
+        return;
+    }
+    middle = (begin + end) / 2;
+    collect(node * 2, begin, middle, limit, timeUs, result);
+    collect(node * 2 + 1, middle, end, limit, timeUs, result);
+}
+
+int64_t SubtitleQueue::getActive(int64_t timeUs, std::vector<SubtitleCue>& cues)
+{
+    std::vector<int> indexes;
+    int64_t changeUs;
+    unsigned int i;
+    int limit;
+
+    cues.clear();
+    ThreadMutexLock(m_mutex);
+    if (m_dirty)
+        rebuild();
+    limit = upperBound(timeUs);
+    changeUs = limit < (int)m_cues.size() ? m_cues[limit].startUs : SUBTITLE_TIME_NONE;
+    if (limit > 0)
+        collect(1, 0, m_leaves, limit, timeUs, indexes);
+    for (i = 0; i < indexes.size(); i++) {
+        cues.push_back(m_cues[indexes[i]]);
+        if (m_cues[indexes[i]].endUs < changeUs)
+            changeUs = m_cues[indexes[i]].endUs;
+    }
+    ThreadMutexUnLock(m_mutex);
+    return changeUs;
+}
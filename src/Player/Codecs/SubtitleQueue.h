@@ -0,0 +1,91 @@
+#ifndef __SUBTITLE_QUEUE_H__
+#define __SUBTITLE_QUEUE_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ThreadMutex.h"
+
+
+#define     SUBTITLE_OPEN_MAX_US        10000000    //没有结束时间的字幕(DVB、图文电视)最多显示这么久
+#define     SUBTITLE_QUEUE_CUES_MAX     8192        //每个轨道最多保存的字幕，超过时删除开始最早的
+#define     SUBTITLE_TIME_NONE          ((int64_t)(~(uint64_t)0 >> 1))     //getActive 之后一直不变
+
+
+/* 图形字幕的一个区域，像素为 ARGB(小端内存中为 BGRA)，和 SDL_PIXELFORMAT_ARGB8888 相同 */
+typedef struct _SubtitleBitmap {
+    int                     x;
+    int                     y;
+    int                     width;
+    int                     height;
+    std::vector<uint32_t>   pixels;
+} SubtitleBitmap;
+
+typedef struct _SubtitleCue {
+    int64_t                     startUs;        //媒体时间，和 SoftwarePipeline::getPositionUs() 相同
+    int64_t                     endUs;
+    bool                        open;           //结束时间未知，同一轨道的下一条到达时截断，最长 SUBTITLE_OPEN_MAX_US
+    std::string                 text;           //UTF-8，多行用 '\n' 分隔，已经去掉样式
+    std::vector<SubtitleBitmap> bitmaps;
+    int                         canvasWidth;    //bitmap 坐标所在的画面大小，0 为视频的大小
+    int                         canvasHeight;
+} SubtitleCue;
+
+void SubtitleCueInit(SubtitleCue* cue, int64_t startUs, int64_t endUs);    //endUs 小于 0 时为 open
+
+
+class SubtitleQueue { /* 一个字幕轨道的所有字幕，按开始时间排序，区间树查找某一时刻显示的字幕；seek 之后不需要清空 */
+    public:
+        SubtitleQueue();
+        ~SubtitleQueue();
+
+        /**
+         *  @Func: insert
+         *         ps. :可以乱序插入；前面最近的一条 open 字幕在这一条开始时结束；
+         *               没有文字也没有 bitmap 的字幕只表示清除，不保存；开始时间和内容相同的重复字幕(seek 之后再次解复用)忽略
+         *  @Param: cue, type:: const SubtitleCue&
+         *  @Return: bool, false 为重复或清除
+         *
+         **/
+        bool insert(const SubtitleCue& cue);
+        void clear();
+        int size();
+
+        /**
+         *  @Func: getActive
+         *         ps. :O(log n + k)，k 为结果的条数；结果按开始时间排列
+         *  @Param: timeUs, type:: int64_t
+         *  @Param: cues, type:: std::vector<SubtitleCue>&, 清空后填入 timeUs 时显示的字幕
+         *  @Return: int64_t, 结果在这个时间之前不变(下一条开始或者某一条结束)，没有变化时为 SUBTITLE_TIME_NONE；
+         *           之后 insert 的字幕由 getGeneration() 的变化得知
+         *
+         **/
+        int64_t getActive(int64_t timeUs, std::vector<SubtitleCue>& cues);
+        uint32_t getGeneration() { return m_generation; }
+
+    private:
+        SubtitleQueue(const SubtitleQueue&);
+        SubtitleQueue& operator=(const SubtitleQueue&);
+
+        int upperBound(int64_t timeUs);         //开始时间 <= timeUs 的个数，调用者持有 m_mutex
+        void rebuild();                         //调用者持有 m_mutex
+        void collect(int node, int begin, int end, int limit, int64_t timeUs, std::vector<int>& result);
+
+        ThreadMutex_Type            m_mutex;        //保护以下成员
+        std::vector<SubtitleCue>    m_cues;         //按开始时间排序，相同时按插入顺序
+        std::vector<int64_t>        m_maxEnd;       //隐式的区间树：叶子为各条的结束时间，节点为子树的最大值
+        int                         m_leaves;       //叶子数，2 的幂
+        bool                        m_dirty;        //insert 之后下一次查找前重建
+        volatile uint32_t           m_generation;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__SUBTITLE_QUEUE_H__
@@ -0,0 +1,401 @@
+/**
+ *  TestAudioPipeline.cpp文件
+ *  音频输出流水线的测试：
+ *          AudioRingBuffer：两个线程，回绕、满、空，记录整条发布，按任意长度读出的数据正确
+ *          AudioResampler：常见采样率之间的频率、幅度、信噪比，输出没有延时，降采样的抗混叠，
+ *                          微调(skew)的速度和开关时波形连续，处理速度
+ *          AudioChannelMap：5.1/四声道下混、单声道和立体声互转、满幅不削波
+ *          AudioGain/AudioMixer：音量渐变、静音，提示音重采样后叠加、饱和、声部用完和回收
+ *
+ *  用法：TestAudioPipeline.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "AudioRingBuffer.h"
+#include "AudioResampler.h"
+#include "AudioMixer.h"
+
+
+#define     TEST_RING_RECORDS           200000
+#define     TEST_RING_CAPACITY          1024
+#define     TEST_TONE_HZ                1000
+#define     TEST_AMPLITUDE              16000
+
+
+static int64_t TestNowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/* 记录：4 字节序号 + 序号决定的长度和内容 */
+static int TestRecordSize(int sequence)
+{
+    return (sequence * 7919) % 301;
+}
+
+static void* TestRingProducer(void* arg)
+{
+    AudioRingBuffer* ring = (AudioRingBuffer*)arg;
+    unsigned char data[512];
+    int sequence, size, i;
+
+    for (sequence = 0; sequence < TEST_RING_RECORDS; sequence++) {
+        size = TestRecordSize(sequence);
+        for (i = 0; i < size; i++)
+            data[i] = (unsigned char)(sequence + i);
+        while (!ring->writeRecord(&sequence, sizeof(sequence), data, size))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static int TestRing()
+{
+    AudioRingBuffer ring;
+    pthread_t producer;
+    unsigned char data[512];
+    int sequence, expected, size, offset, n, i, errors = 0, pieces = 0;
+    bool ok;
+
+    ring.open(TEST_RING_CAPACITY - 100);
+    pthread_create(&producer, NULL, TestRingProducer, &ring);
+    for (expected = 0; expected < TEST_RING_RECORDS && errors == 0; expected++) {
+        while (ring.read(&sequence, sizeof(sequence)) == 0)
+            sched_yield();
+        size = TestRecordSize(expected);
+        if (sequence != expected || ring.readable() < size) {
+            errors++;
+            break;
+        }
+        /* 数据已经完整，按任意长度分几次读出 */
+        for (offset = 0; offset < size; offset += n) {
+            n = std::min(size - offset, 1 + (expected + offset) % 97);
+            if (ring.read(data + offset, n) != n)
+                errors++;
+            pieces++;
+        }
+        for (i = 0; i < size; i++)
+            if (data[i] != (unsigned char)(expected + i))
+                errors++;
+    }
+    pthread_join(producer, NULL);
+
+    ok = errors == 0 && expected == TEST_RING_RECORDS && ring.readable() == 0 && ring.capacity() == TEST_RING_CAPACITY;
+    printf("[ring] %d records, %d reads, capacity %d: %s\n", expected, pieces, ring.capacity(), ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+/* 最小二乘拟合 hz 的正弦，返回幅度、相位(相对 sin)和剩余部分的信噪比 */
+static void TestFitTone(const std::vector<int16_t>& pcm, int channels, int channel, int rate, double hz, int skip,
+                        double* amplitude, double* phase, double* snr)
+{
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, a, b, det, residual = 0, signal;
+    int frames = (int)pcm.size() / channels, i;
+
+    for (i = skip; i < frames - skip; i++) {
+        double s = sin(2 * M_PI * hz * i / rate), c = cos(2 * M_PI * hz * i / rate), y = pcm[i * channels + channel];
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        ys += y * s;
+        yc += y * c;
+    }
+    det = ss * cc - sc * sc;
+    a = (ys * cc - yc * sc) / det;
+    b = (yc * ss - ys * sc) / det;
+    for (i = skip; i < frames - skip; i++) {
+        double y = pcm[i * channels + channel] - a * sin(2 * M_PI * hz * i / rate) - b * cos(2 * M_PI * hz * i / rate);
+        residual += y * y;
+    }
+    *amplitude = sqrt(a * a + b * b);
+    *phase = atan2(b, a);
+    signal = *amplitude * *amplitude / 2 * (frames - 2 * skip);
+    *snr = 10 * log10(signal / (residual + 1e-9));
+}
+
+static void TestTone(std::vector<int16_t>& pcm, int rate, double hz, int frames)
+{
+    int i;
+
+    pcm.resize(frames * 2);
+    for (i = 0; i < frames; i++) {
+        int16_t value = (int16_t)floor(TEST_AMPLITUDE * sin(2 * M_PI * hz * i / rate) + 0.5);
+        pcm[i * 2] = value;
+        pcm[i * 2 + 1] = (int16_t)(-value / 2);
+    }
+}
+
+static int TestResampleCase(int inRate, int outRate, int skew, double minSnr)
+{
+    AudioResampler resampler;
+    std::vector<int16_t> input, output;
+    double amplitude, phase, snr, rightAmplitude, rightPhase, rightSnr, outHz = TEST_TONE_HZ * (1.0 + skew / 1e6);
+    int frames = inRate, produced = 0, expected, offset, n;
+    bool ok;
+
+    TestTone(input, inRate, TEST_TONE_HZ, frames);
+    resampler.open(inRate, outRate, 2);
+    resampler.setSkew(skew);
+    for (offset = 0; offset < frames; offset += n) {
+        n = std::min(frames - offset, 1 + offset % 1111);
+        produced += resampler.process(&input[offset * 2], n, output);
+    }
+    produced += resampler.flush(output);
+    expected = (int)floor((double)frames * outRate / inRate / (1.0 + skew / 1e6) + 0.5);
+
+    TestFitTone(output, 2, 0, outRate, outHz, RESAMPLER_TAPS, &amplitude, &phase, &snr);
+    TestFitTone(output, 2, 1, outRate, outHz, RESAMPLER_TAPS, &rightAmplitude, &rightPhase, &rightSnr);
+    //没有延时：第一个输出对准第一个输入，相位误差小于 1/4 个输出采样
+    ok = (int)output.size() == produced * 2 && abs(produced - expected) <= 2
+         && fabs(amplitude - TEST_AMPLITUDE) < TEST_AMPLITUDE * 0.002 && fabs(rightAmplitude - TEST_AMPLITUDE / 2) < TEST_AMPLITUDE * 0.002
+         && fabs(phase) < 2 * M_PI * outHz / outRate / 4 && snr > minSnr && rightSnr > minSnr - 6;
+    printf("[resample %d -> %d skew %d] %d frames (expect %d), amplitude %.1f/%.1f phase %.4f, snr %.1f dB: %s\n",
+           inRate, outRate, skew, produced, expected, amplitude, rightAmplitude, phase, snr, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/* 降采样时高于新奈奎斯特频率的输入要被滤掉 */
+static int TestAntiAlias()
+{
+    AudioResampler resampler;
+    std::vector<int16_t> input, output;
+    double energy = 0, level;
+    int i;
+    bool ok;
+
+    TestTone(input, 48000, 18000, 48000);
+    resampler.open(48000, 22050, 2);
+    resampler.process(&input[0], 48000, output);
+    for (i = RESAMPLER_TAPS; i < (int)output.size() / 2; i++)
+        energy += (double)output[i * 2] * output[i * 2];
+    level = 10 * log10(energy / (output.size() / 2 - RESAMPLER_TAPS) / (TEST_AMPLITUDE * TEST_AMPLITUDE / 2.0) + 1e-12);
+
+    ok = level < -60;
+    printf("[resample alias] 18kHz 48000 -> 22050, %.1f dB: %s\n", level, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/* 播放中打开、关闭微调，波形不能有跳变 */
+static int TestSkewSwitch()
+{
+    AudioResampler resampler;
+    std::vector<int16_t> input, output;
+    int frames = 48000, offset, n, maxStep = 0, produced = 0, i;
+    int limit = (int)(2 * M_PI * TEST_TONE_HZ / 48000 * TEST_AMPLITUDE * 1.1);
+    bool ok;
+
+    TestTone(input, 48000, TEST_TONE_HZ, frames);
+    resampler.open(48000, 48000, 2);
+    for (offset = 0, i = 0; offset < frames; offset += n, i++) {
+        n = std::min(frames - offset, 480 + i * 37 % 300);
+        resampler.setSkew(i % 3 == 1 ? 2000 : (i % 3 == 2 ? -1500 : 0));
+        produced += resampler.process(&input[offset * 2], n, output);
+    }
+    produced += resampler.flush(output);
+    for (i = 1; i < produced; i++)
+        maxStep = std::max(maxStep, abs(output[i * 2] - output[i * 2 - 2]));
+
+    ok = maxStep <= limit && abs(produced - frames) < 200;
+    printf("[resample skew switch] %d -> %d frames, max step %d (limit %d): %s\n", frames, produced, maxStep, limit,
+           ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestResampleSpeed()
+{
+    AudioResampler resampler;
+    std::vector<int16_t> input, output;
+    int seconds = 20, i;
+    int64_t begin;
+    double elapsed;
+
+    TestTone(input, 44100, TEST_TONE_HZ, 44100);
+    resampler.open(44100, 48000, 2);
+    begin = TestNowUs();
+    for (i = 0; i < seconds * 10; i++) {
+        output.clear();
+        resampler.process(&input[i % 10 * 4410 * 2], 4410, output);
+    }
+    elapsed = (TestNowUs() - begin) / 1e6;
+    printf("[resample speed] 44100 -> 48000 stereo, %.0fx realtime (%s)\n", elapsed > 0 ? seconds / elapsed : 0.0,
+#if defined(__SSE2__)
+           "SSE2"
+#else
+           "C"
+#endif
+           );
+    return 0;
+}
+
+static int TestResampler()
+{
+    int failed = 0;
+
+    failed += TestResampleCase(44100, 48000, 0, 70);
+    failed += TestResampleCase(48000, 44100, 0, 70);
+    failed += TestResampleCase(32000, 48000, 0, 70);
+    failed += TestResampleCase(22050, 48000, 0, 70);
+    failed += TestResampleCase(11025, 48000, 0, 70);
+    failed += TestResampleCase(8000, 48000, 0, 70);
+    failed += TestResampleCase(48000, 48000, 0, 90);
+    failed += TestResampleCase(12345, 48000, 0, 55);       //分母太大，取最近的相位
+    failed += TestResampleCase(48000, 48000, 2000, 55);
+    failed += TestResampleCase(44100, 48000, -3000, 55);
+    failed += TestAntiAlias();
+    failed += TestSkewSwitch();
+    failed += TestResampleSpeed();
+    return failed;
+}
+
+
+static int TestChannelMap()
+{
+    static const int16_t surround[6] = { 1000, 2000, 3000, 30000, 4000, 5000 };   //L R C LFE Ls Rs
+    static const int16_t quad[4] = { 1000, 2000, 3000, 4000 };                      //L R Ls Rs
+    const double norm = 1 + 2 * 0.70710678;
+    int16_t full[8], output[8], stereo[2] = { 1000, -3000 }, mono = -1234;
+    AudioChannelMap map;
+    bool ok = true;
+    int i;
+
+    map.open(6, 2);
+    map.process(surround, 1, output);
+    ok = ok && abs(output[0] - (int)floor((1000 + 0.70710678 * 7000) / norm + 0.5)) <= 2
+            && abs(output[1] - (int)floor((2000 + 0.70710678 * 8000) / norm + 0.5)) <= 2;
+    printf("[channel 5.1 -> 2] %d %d\n", output[0], output[1]);
+
+    map.open(4, 2);
+    map.process(quad, 1, output);
+    ok = ok && abs(output[0] - (int)floor((1000 + 0.70710678 * 3000) / (1 + 0.70710678) + 0.5)) <= 2
+            && abs(output[1] - (int)floor((2000 + 0.70710678 * 4000) / (1 + 0.70710678) + 0.5)) <= 2;
+
+    map.open(2, 1);
+    map.process(stereo, 1, output);
+    ok = ok && output[0] == -1000;
+
+    map.open(1, 2);
+    map.process(&mono, 1, output);
+    ok = ok && output[0] == mono && output[1] == mono && !map.isBypass();
+
+    /* 满幅的 7.1 下混到单声道不能溢出回绕 */
+    for (i = 0; i < 8; i++)
+        full[i] = 32767;
+    map.open(8, 1);
+    map.process(full, 1, output);
+    ok = ok && output[0] > 32000;
+    for (i = 0; i < 8; i++)
+        full[i] = -32768;
+    map.process(full, 1, output);
+    ok = ok && output[0] < -32000;
+
+    ok = ok && map.open(9, 2) < 0 && map.open(2, 0) < 0;
+    printf("[channel map] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+static int TestGain()
+{
+    AudioGain gain;
+    std::vector<int16_t> pcm;
+    int ramp = 48000 * AUDIO_GAIN_RAMP_MS / 1000, maxStep = 0, i;
+    bool ok;
+
+    gain.open(48000, 2);
+    pcm.assign(4800 * 2, 20000);
+    gain.process(&pcm[0], 4800);
+    ok = pcm[0] == 20000 && pcm[9599] == 20000;
+
+    /* 50% 为 1/4 增益，在渐变时间内到达，中间没有跳变 */
+    gain.setVolume(50);
+    pcm.assign(4800 * 2, 20000);
+    gain.process(&pcm[0], 4800);
+    for (i = 1; i < 4800; i++)
+        maxStep = std::max(maxStep, abs(pcm[i * 2] - pcm[i * 2 - 2]));
+    ok = ok && pcm[0] > 19900 && abs(pcm[ramp * 2 + 2] - 5000) <= 1 && pcm[9599] == 5000 && maxStep < 40;
+
+    gain.setMute(true);
+    pcm.assign(4800 * 2, 20000);
+    gain.process(&pcm[0], 4800);
+    ok = ok && pcm[0] > 4900 && pcm[ramp * 2] == 0 && pcm[9599] == 0 && gain.getMute() && gain.getVolume() == 50;
+
+    gain.setMute(false);
+    gain.setVolume(AUDIO_VOLUME_MAX + 10);
+    pcm.assign(4800 * 2, 20000);
+    gain.process(&pcm[0], 4800);
+    ok = ok && pcm[0] < 100 && pcm[9599] == 20000 && gain.getVolume() == AUDIO_VOLUME_MAX;
+
+    printf("[gain] ramp %d frames, max step %d: %s\n", ramp, maxStep, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestMixer()
+{
+    AudioMixer mixer;
+    std::vector<int16_t> sound(4410, 20000), program;
+    int frames = 0, i;
+    bool ok;
+
+    mixer.open(48000, 2);
+    ok = mixer.play(&sound[0], 4410, 44100, 1, AUDIO_VOLUME_MAX) == 0 && mixer.isPlaying();
+
+    /* 0.1 秒的单声道 44.1k 提示音变为 4800 帧立体声，和满幅的节目音频相加饱和 */
+    while (mixer.isPlaying() && frames < 48000) {
+        program.assign(256 * 2, 30000);
+        mixer.mix(&program[0], 256);
+        if (frames == 256)
+            ok = ok && program[0] == 32767 && program[1] == 32767;
+        frames += 256;
+    }
+    ok = ok && abs(frames - 4864) <= 256;
+
+    program.assign(256 * 2, -100);
+    mixer.mix(&program[0], 256);
+    ok = ok && program[0] == -100;
+
+    /* 声部用完，回收之后可以再用；stop 之后下一次回调结束 */
+    for (i = 0; i < AUDIO_MIXER_VOICES; i++)
+        ok = ok && mixer.play(&sound[0], 4410, 44100, 1, 30) == 0;
+    ok = ok && mixer.play(&sound[0], 4410, 44100, 1, 30) < 0;
+    program.assign(256 * 2, 0);
+    mixer.mix(&program[0], 256);
+    ok = ok && abs(program[100] - 20000 * 9 / 100 * AUDIO_MIXER_VOICES) <= AUDIO_MIXER_VOICES * 2;
+    mixer.stop();
+    mixer.mix(&program[0], 256);
+    ok = ok && !mixer.isPlaying() && mixer.play(&sound[0], 4410, 44100, 1, 50) == 0;
+    ok = ok && mixer.play(&sound[0], 0, 44100, 1, 50) < 0 && mixer.play(&sound[0], 4410, 44100, 9, 50) < 0;
+
+    printf("[mixer] sound %d frames: %s\n", frames, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+int main()
+{
+    int failed = 0;
+
+    failed += TestRing();
+    failed += TestResampler();
+    failed += TestChannelMap();
+    failed += TestGain();
+    failed += TestMixer();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,296 @@
+/**
+ *  TestMediaClock.cpp文件
+ *  MediaClock 的测试，时间是模拟的，每步 1ms：
+ *          音频主时钟：视频跟随音频，误差在一步以内，不丢帧
+ *          解码卡顿：积压的帧丢弃追上时钟，连续丢帧不超过 MEDIACLOCK_DROP_MAX，之后误差恢复
+ *          音频卡住：时钟外推到上限后停住，视频等待(重复上一帧)，恢复后继续
+ *          视频主时钟：音频设备快 1000ppm，重采样微调收敛到约 -1000ppm，误差有界
+ *          外部参考：PCR 到达时间的抖动被平滑，跳变时重新对齐
+ *          暂停、flush 和 C 接口
+ *
+ *  用法：TestMediaClock.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <deque>
+
+#include "MediaClock.h"
+
+
+#define     TEST_STEP_US                1000
+#define     TEST_FRAME_US               40000
+#define     TEST_AUDIO_PERIOD_US        10000       //音频回调的间隔
+#define     TEST_AUDIO_LATENCY_US       20000
+
+
+/* 模拟 render()：到期的帧显示，太晚且后面还有帧时丢弃；返回下一次调用的时刻，和 render() 一样按毫秒取整、最多 100ms */
+static int64_t TestRender(MediaClock& clock, std::deque<int64_t>& queue, int64_t nowUs, int* run, int* maxRun)
+{
+    int64_t waitUs;
+    int action;
+
+    while (!queue.empty()) {
+        action = clock.syncVideo(queue.front(), TEST_FRAME_US, queue.size() > 1, nowUs, &waitUs);
+        if (action == MediaClockVideo_Wait)
+            return nowUs + (waitUs > 100000 ? 100000 : waitUs / 1000 * 1000);
+        queue.pop_front();
+        if (action == MediaClockVideo_Drop) {
+            (*run)++;
+            if (*run > *maxRun)
+                *maxRun = *run;
+            continue;
+        }
+        *run = 0;
+        break;
+    }
+    return nowUs + TEST_STEP_US;
+}
+
+static int TestAudioFollow()
+{
+    MediaClock clock(MediaClockMode_Audio);
+    MediaClockStatistics statistics;
+    std::deque<int64_t> queue;
+    int64_t now, nextPts = 0, renderUs = 0;
+    int run = 0, maxRun = 0;
+    bool ok;
+
+    clock.setAudioLimitUs(TEST_AUDIO_LATENCY_US);
+    for (now = 0; now < 10000000; now += TEST_STEP_US) {
+        if (now % TEST_AUDIO_PERIOD_US == 0)
+            clock.setAudio(now, now);
+        while (queue.size() < 3) {
+            queue.push_back(nextPts);
+            nextPts += TEST_FRAME_US;
+        }
+        if (now >= renderUs)
+            renderUs = TestRender(clock, queue, now, &run, &maxRun);
+    }
+
+    statistics = clock.getStatistics();
+    ok = statistics.shownFrames == 250 && statistics.droppedFrames == 0 && statistics.duplicatedFrames == 0;
+    ok = ok && statistics.syncErrorMaxUs <= TEST_STEP_US && statistics.resyncs == 0;
+    printf("[audio master] shown %lld dropped %lld error avg %lldus max %lldus: %s\n",
+           (long long)statistics.shownFrames, (long long)statistics.droppedFrames,
+           (long long)statistics.syncErrorAvgUs, (long long)statistics.syncErrorMaxUs, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestDecodeStall()
+{
+    MediaClock clock(MediaClockMode_Audio);
+    MediaClockStatistics statistics;
+    std::deque<int64_t> queue;
+    int64_t now, nextPts = 0, renderUs = 0;
+    int run = 0, maxRun = 0;
+    bool ok;
+
+    /* 2s ~ 3s 解码卡住，之后一下子解出积压的帧 */
+    clock.setAudioLimitUs(TEST_AUDIO_LATENCY_US);
+    for (now = 0; now < 6000000; now += TEST_STEP_US) {
+        if (now % TEST_AUDIO_PERIOD_US == 0)
+            clock.setAudio(now, now);
+        if (now < 2000000 || now >= 3000000) {
+            while (queue.size() < 3 || (now >= 3000000 && nextPts <= now + TEST_FRAME_US)) {
+                queue.push_back(nextPts);
+                nextPts += TEST_FRAME_US;
+            }
+        }
+        if (now >= renderUs)
+            renderUs = TestRender(clock, queue, now, &run, &maxRun);
+    }
+
+    statistics = clock.getStatistics();
+    ok = statistics.droppedFrames > 10 && maxRun <= MEDIACLOCK_DROP_MAX;
+    ok = ok && statistics.shownFrames + statistics.droppedFrames + (int64_t)queue.size() == nextPts / TEST_FRAME_US;
+    ok = ok && llabs(statistics.syncErrorUs) <= TEST_STEP_US;
+    printf("[decode stall] dropped %lld, max run %d, last error %lldus: %s\n",
+           (long long)statistics.droppedFrames, maxRun, (long long)statistics.syncErrorUs, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestAudioStall()
+{
+    MediaClock clock(MediaClockMode_Audio);
+    MediaClockStatistics statistics;
+    std::deque<int64_t> queue;
+    int64_t now, nextPts = 0, renderUs = 0, audioUs = 0, frozenUs = -1;
+    int run = 0, maxRun = 0;
+    bool ok = true;
+
+    /* 2s ~ 2.5s 音频回调停住，音频位置也不走 */
+    clock.setAudioLimitUs(TEST_AUDIO_LATENCY_US);
+    for (now = 0; now < 5000000; now += TEST_STEP_US) {
+        if (now % TEST_AUDIO_PERIOD_US == 0 && (now < 2000000 || now >= 2500000)) {
+            clock.setAudio(audioUs, now);
+            audioUs += TEST_AUDIO_PERIOD_US;
+        }
+        if (now == 2400000)
+            frozenUs = clock.getUs(now);
+        while (queue.size() < 3) {
+            queue.push_back(nextPts);
+            nextPts += TEST_FRAME_US;
+        }
+        if (now >= renderUs)
+            renderUs = TestRender(clock, queue, now, &run, &maxRun);
+    }
+
+    statistics = clock.getStatistics();
+    ok = ok && frozenUs == 1990000 + TEST_AUDIO_LATENCY_US && clock.getUs(now) == audioUs;
+    ok = ok && statistics.duplicatedFrames > 0 && statistics.droppedFrames == 0 && statistics.resyncs == 0;
+    printf("[audio stall] clock frozen at %lldus, duplicated %lld: %s\n",
+           (long long)frozenUs, (long long)statistics.duplicatedFrames, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestVideoMaster()
+{
+    MediaClock clock(MediaClockMode_Video);
+    MediaClockStatistics statistics;
+    std::deque<int64_t> queue;
+    int64_t now, nextPts = 0, renderUs = 0, maxDrift = 0, drift;
+    double audioUs = 0;
+    int run = 0, maxRun = 0, skew = 0;
+    bool ok;
+
+    /* 设备时钟快 1000ppm，微调为 skew 时音频按 (1 + 0.001) * (1 + skew / 1e6) 的速度走 */
+    clock.setAudioLimitUs(TEST_AUDIO_LATENCY_US);
+    for (now = 0; now < 60000000; now += TEST_STEP_US) {
+        while (queue.size() < 3) {
+            queue.push_back(nextPts);
+            nextPts += TEST_FRAME_US;
+        }
+        if (now >= renderUs)
+            renderUs = TestRender(clock, queue, now, &run, &maxRun);
+        if (now % TEST_AUDIO_PERIOD_US == 0) {
+            clock.setAudio((int64_t)audioUs, now);
+            skew = clock.getAudioSkew(now);
+            drift = (int64_t)audioUs - now;
+            if (llabs(drift) > maxDrift)
+                maxDrift = llabs(drift);
+        }
+        audioUs += TEST_STEP_US * 1.001 * (1 + skew / 1000000.0);
+    }
+
+    statistics = clock.getStatistics();
+    ok = skew <= -900 && skew >= -1100 && maxDrift < 20000 && statistics.audioSkewPpm == skew;
+    ok = ok && statistics.droppedFrames == 0 && statistics.syncErrorMaxUs <= TEST_STEP_US;
+    printf("[video master] skew %dppm, audio drift %lldus max %lldus: %s\n",
+           skew, (long long)statistics.audioDriftUs, (long long)maxDrift, ok ? "OK" : "FAILED");
+
+    /* 音频主时钟不微调 */
+    clock.setMode(MediaClockMode_Audio, now);
+    ok = ok && clock.getAudioSkew(now) == 0;
+    return ok ? 0 : 1;
+}
+
+static int TestExternal()
+{
+    MediaClock clock(MediaClockMode_External);
+    MediaClockStatistics statistics;
+    int64_t now, offsetUs = 5000000, error, maxError = 0, jitterUs;
+    unsigned int seed = 12345;
+    bool ok;
+
+    /* PCR 每 40ms 发送一次，网络延时 0~30ms，主时钟应接近平均延时之后的参考时间 */
+    for (now = 0; now < 10000000; now += TEST_STEP_US) {
+        if (now % TEST_FRAME_US == 0) {
+            seed = seed * 1103515245 + 12345;
+            jitterUs = (seed >> 16) % 30000;
+            clock.setExternal(now + offsetUs, now + jitterUs);
+        }
+        if (now >= 2000000) {
+            error = llabs(clock.getUs(now) - (now + offsetUs - 15000));
+            if (error > maxError)
+                maxError = error;
+        }
+    }
+    statistics = clock.getStatistics();
+    ok = maxError < 12000 && statistics.resyncs == 0;
+
+    /* 参考时间跳变(节目切换) */
+    clock.setExternal(now + offsetUs + 10000000, now);
+    statistics = clock.getStatistics();
+    ok = ok && statistics.resyncs == 1 && clock.getUs(now) == now + offsetUs + 10000000;
+
+    /* 其他模式下忽略 */
+    clock.setMode(MediaClockMode_Video, now);
+    clock.setExternal(0, now);
+    ok = ok && clock.getUs(now) == now + offsetUs + 10000000;
+    printf("[external] jitter 30ms, max error %lldus: %s\n", (long long)maxError, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestPauseFlush()
+{
+    MediaClock clock(MediaClockMode_Audio);
+    int64_t waitUs = 0;
+    bool ok;
+
+    /* 没有音频时第一帧开始系统时钟 */
+    ok = clock.getUs(0) < 0 && clock.syncVideo(500000, TEST_FRAME_US, false, 0, &waitUs) == MediaClockVideo_Show;
+    ok = ok && clock.getUs(1000000) == 1500000;
+    clock.setPaused(true, 1000000);
+    ok = ok && clock.isPaused() && clock.getUs(3000000) == 1500000;
+    ok = ok && clock.syncVideo(1600000, TEST_FRAME_US, false, 3000000, &waitUs) == MediaClockVideo_Wait && waitUs == 100000;
+    clock.setPaused(false, 3000000);
+    ok = ok && clock.getUs(3100000) == 1600000;
+
+    /* 暂停时 flush 保持暂停的位置，之后从第一帧重新开始 */
+    clock.setPaused(true, 3100000);
+    ok = ok && clock.flush(3200000) == 1600000 && clock.getUs(3300000) == 1600000;
+    clock.setPaused(false, 3300000);
+    ok = ok && clock.getUs(3300000) < 0;
+    clock.setAudio(8000000, 3400000);
+    ok = ok && clock.getUs(3410000) == 8010000;
+    ok = ok && clock.flush(3410000) == 8010000 && clock.getUs(3410000) < 0;
+
+    /* 音频结束，系统时钟接着走 */
+    clock.setAudio(100000, 4000000);
+    clock.endAudio(4010000);
+    ok = ok && clock.getUs(5010000) == 1110000;
+    clock.reset();
+    ok = ok && clock.getUs(5010000) < 0 && !clock.isPaused() && clock.getStatistics().shownFrames == 0;
+    printf("[pause flush] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestCInterface()
+{
+    MediaClock_Type clock = MediaClockCreate(MediaClockMode_Video);
+    MediaClockStatistics statistics;
+    int64_t now = MediaClockNowUs(), waitUs = 0;
+    bool ok;
+
+    ok = clock != NULL && MediaClockSyncVideo(clock, 0, TEST_FRAME_US, 0, now, &waitUs) == MediaClockVideo_Show;
+    ok = ok && MediaClockSyncVideo(clock, TEST_FRAME_US, TEST_FRAME_US, 0, now, &waitUs) == MediaClockVideo_Wait;
+    ok = ok && MediaClockGetUs(clock, now + 5000) == 5000 && MediaClockGetAudioSkew(clock, now) == 0;
+    MediaClockSetPaused(clock, 1, now + 5000);
+    ok = ok && MediaClockGetUs(clock, now + 9000) == 5000 && MediaClockFlush(clock, now + 9000) == 5000;
+    MediaClockGetStatistics(clock, &statistics);
+    ok = ok && statistics.shownFrames == 1 && statistics.mode == MediaClockMode_Video;
+    MediaClockDestroy(clock);
+    ok = ok && MediaClockNowUs() >= now;
+    printf("[c interface] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+int main()
+{
+    int failed = 0;
+
+    failed += TestAudioFollow();
+    failed += TestDecodeStall();
+    failed += TestAudioStall();
+    failed += TestVideoMaster();
+    failed += TestExternal();
+    failed += TestPauseFlush();
+    failed += TestCInterface();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,499 @@
+/**
+ *  TestPlaybackBench.cpp文件
+ *  播放的性能基准和一致性检查，不开窗口，不输出声音：
+ *          demux：只 av_read_frame，统计 packet 速度，校验和为所有 packet 的数据
+ *          decode：解复用加视频、音频解码，和 SoftwarePipeline 一样打开多线程解码、直接解码到 VideoFramePool
+ *          convert：decode 之后经 ImageConvert 转为显示用的 BGRA
+ *          每一遍输出帧率、每帧的延时分位数(不含解复用)、CPU 时间、进程的峰值 RSS，
+ *          视频帧和 PCM 的 Adler-32 校验和(只算可见的像素，和行对齐无关)
+ *          -w 把校验和写入参考文件，-r 和参考文件比较，不一致时失败，用于发现解码、转换的回归
+ *
+ *  用法：TestPlaybackBench.elf [-p demux|decode|convert|all] [-t threads] [-n frames] [-r|-w reference] [media ...]
+ *          默认为 cuc_ieschool.flv 和 bigbuckbunny_480x272.h265 所有的遍，文件不存在或没有解码器时跳过
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/adler32.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+};
+
+#include "ImageConvert.h"
+#include "VideoFramePool.h"
+
+
+#define     BENCH_DECODE_THREADS_MAX    16          //和 PIPELINE_DECODE_THREADS_MAX 相同
+#define     BENCH_REFERENCE_LINE        512
+
+
+typedef enum {
+    BenchPass_Demux = 0,
+    BenchPass_Decode,
+    BenchPass_Convert,
+    BenchPass_Count,
+} BenchPass;
+
+static const char* g_passNames[BenchPass_Count] = {"demux", "decode", "convert"};
+
+typedef struct _BenchOptions {
+    int             passes;             //按 BenchPass 的位
+    int             threads;            //0 时按 CPU 个数
+    int64_t         maxFrames;          //0 时整个文件
+    const char*     readReference;
+    const char*     writeReference;
+} BenchOptions;
+
+typedef struct _BenchResult {
+    int64_t                 frames;         //demux 为视频 packet，其他为输出的视频帧
+    int64_t                 packets;
+    int64_t                 bytes;
+    int64_t                 samples;        //解码出的音频采样(每声道)
+    int64_t                 decodeErrors;
+    int64_t                 wallUs;
+    int64_t                 cpuUs;
+    long                    peakRssKB;
+    unsigned long           videoChecksum;
+    unsigned long           audioChecksum;
+    std::vector<int64_t>    latencyUs;      //每帧
+} BenchResult;
+
+
+static int64_t BenchNowUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int64_t BenchCpuUs(long* peakRssKB)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    if (peakRssKB)
+        *peakRssKB = usage.ru_maxrss;   //Linux 为 KB
+    return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/* 只算每行可见的字节，解码器和帧池的对齐不同时校验和也相同 */
+static unsigned long BenchPictureChecksum(unsigned long checksum, const AVPicture* picture, int format, int width, int height)
+{
+    const AVPixFmtDescriptor* desc = &av_pix_fmt_descriptors[format];
+    int bytes[4], planeHeight, p, y;
+
+    if (av_image_fill_linesizes(bytes, (enum PixelFormat)format, width) < 0)
+        return checksum;
+    for (p = 0; p < 4 && picture->data[p]; p++) {
+        if (bytes[p] <= 0)
+            continue;
+        planeHeight = (p == 1 || p == 2) ? -((-height) >> desc->log2_chroma_h) : height;
+        for (y = 0; y < planeHeight; y++)
+            checksum = av_adler32_update(checksum, picture->data[p] + y * picture->linesize[p], bytes[p]);
+    }
+    return checksum;
+}
+
+static AVCodecContext* BenchOpenCodec(AVFormatContext* format, int index, int threads)
+{
+    AVCodecContext* codecCtx = format->streams[index]->codec;
+    AVCodec* codec = avcodec_find_decoder(codecCtx->codec_id);
+
+    if (codec == NULL)
+        return NULL;
+    if (codecCtx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        codecCtx->thread_count = threads;
+        codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        VideoFramePool::attachDecoder(codecCtx, codec, VideoFramePool::shared());
+    }
+    if (avcodec_open2(codecCtx, codec, NULL) < 0)
+        return NULL;
+    return codecCtx;
+}
+
+class BenchRunner { /* 一个文件的一遍：打开、按遍解复用/解码/转换、统计 */
+    public:
+        BenchRunner(const BenchOptions& options, BenchPass pass)
+            : m_options(options), m_pass(pass), m_format(NULL), m_video(NULL), m_audio(NULL)
+            , m_videoIndex(-1), m_audioIndex(-1), m_decoded(NULL), m_pcm(NULL) {}
+        ~BenchRunner() { close(); }
+
+        int run(const char* path, BenchResult* result);
+
+    private:
+        BenchRunner(const BenchRunner&);
+        BenchRunner& operator=(const BenchRunner&);
+
+        int open(const char* path);
+        void close();
+        void decodeVideo(AVPacket* packet, BenchResult* result, int64_t* pendingUs);
+        void decodeAudio(AVPacket* packet, BenchResult* result);
+        void outputFrame(BenchResult* result, int64_t* pendingUs);
+
+        const BenchOptions&     m_options;
+        BenchPass               m_pass;
+        AVFormatContext*        m_format;
+        AVCodecContext*         m_video;
+        AVCodecContext*         m_audio;
+        int                     m_videoIndex;
+        int                     m_audioIndex;
+        AVFrame*                m_decoded;
+        int16_t*                m_pcm;
+        ImageConvert            m_imageConvert;
+};
+
+int BenchRunner::open(const char* path)
+{
+    int threads = m_options.threads;
+    unsigned int i;
+
+    if (avformat_open_input(&m_format, path, NULL, NULL) != 0) {
+        m_format = NULL;
+        return -1;
+    }
+    if (avformat_find_stream_info(m_format, NULL) < 0)
+        return -1;
+    for (i = 0; i < m_format->nb_streams; i++) {
+        if (m_videoIndex < 0 && m_format->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            m_videoIndex = i;
+        else if (m_audioIndex < 0 && m_format->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            m_audioIndex = i;
+    }
+    if (m_videoIndex < 0)
+        return -1;
+    if (m_pass == BenchPass_Demux)
+        return 0;
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > BENCH_DECODE_THREADS_MAX)
+        threads = BENCH_DECODE_THREADS_MAX;
+    m_video = BenchOpenCodec(m_format, m_videoIndex, threads > 0 ? threads : 1);
+    if (m_video == NULL)
+        return -2;
+    if (m_audioIndex >= 0)
+        m_audio = BenchOpenCodec(m_format, m_audioIndex, 1);
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+    m_decoded = av_frame_alloc();
+#else
+    m_decoded = avcodec_alloc_frame();
+#endif
+    m_pcm = (int16_t*)av_malloc(AVCODEC_MAX_AUDIO_FRAME_SIZE * 3 / 2);
+    return (m_decoded && m_pcm) ? 0 : -1;
+}
+
+void BenchRunner::close()
+{
+    if (m_video)
+        avcodec_close(m_video);
+    if (m_audio)
+        avcodec_close(m_audio);
+    if (m_format) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+        avformat_close_input(&m_format);
+#else
+        av_close_input_file(m_format);
+#endif
+    }
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,28,1)
+    av_frame_free(&m_decoded);
+#else
+    av_free(m_decoded);
+#endif
+    av_free(m_pcm);
+    m_format = NULL;
+    m_video = NULL;
+    m_audio = NULL;
+    m_decoded = NULL;
+    m_pcm = NULL;
+}
+
+void BenchRunner::outputFrame(BenchResult* result, int64_t* pendingUs)
+{
+    ImageConvertFrame* bgra;
+    int64_t startUs;
+
+    if (m_pass == BenchPass_Convert) {
+        startUs = BenchNowUs();
+        bgra = m_imageConvert.acquireFrame(PIX_FMT_BGRA, m_video->width, m_video->height);
+        if (bgra && m_imageConvert.convert((const AVPicture*)m_decoded, m_video->pix_fmt, m_video->width, m_video->height,
+                                           &bgra->picture, PIX_FMT_BGRA, m_video->width, m_video->height) == 0) {
+            *pendingUs += BenchNowUs() - startUs;
+            result->videoChecksum = BenchPictureChecksum(result->videoChecksum, &bgra->picture, PIX_FMT_BGRA,
+                                                         m_video->width, m_video->height);
+        } else {
+            result->decodeErrors++;
+        }
+        m_imageConvert.releaseFrame(bgra);
+    } else {
+        result->videoChecksum = BenchPictureChecksum(result->videoChecksum, (const AVPicture*)m_decoded, m_video->pix_fmt,
+                                                     m_video->width, m_video->height);
+    }
+    result->latencyUs.push_back(*pendingUs);
+    result->frames++;
+    *pendingUs = 0;
+}
+
+/* 一帧的延时为从上一帧输出之后所有解码调用的时间，多线程解码开始时的几帧要等流水线填满 */
+void BenchRunner::decodeVideo(AVPacket* packet, BenchResult* result, int64_t* pendingUs)
+{
+    int64_t startUs = BenchNowUs();
+    int gotPicture = 0;
+
+    if (avcodec_decode_video2(m_video, m_decoded, &gotPicture, packet) < 0) {
+        result->decodeErrors++;
+        gotPicture = 0;
+    }
+    *pendingUs += BenchNowUs() - startUs;
+    if (gotPicture)
+        outputFrame(result, pendingUs);
+}
+
+void BenchRunner::decodeAudio(AVPacket* packet, BenchResult* result)
+{
+    AVPacket pending = *packet;
+    int size, used;
+
+    while (pending.size > 0) {
+        size = AVCODEC_MAX_AUDIO_FRAME_SIZE * 3 / 2;
+        used = avcodec_decode_audio3(m_audio, m_pcm, &size, &pending);
+        if (used < 0) {
+            result->decodeErrors++;
+            break;
+        }
+        pending.data += used;
+        pending.size -= used;
+        if (size <= 0)
+            continue;
+        result->audioChecksum = av_adler32_update(result->audioChecksum, (const uint8_t*)m_pcm, size);
+        if (m_audio->channels > 0)
+            result->samples += size / (2 * m_audio->channels);
+    }
+}
+
+int BenchRunner::run(const char* path, BenchResult* result)
+{
+    AVPacket packet, flush;
+    int64_t startUs, startCpuUs, pendingUs = 0, readUs;
+    int ret;
+
+    ret = open(path);
+    if (ret < 0)
+        return ret;
+
+    startCpuUs = BenchCpuUs(NULL);
+    startUs = BenchNowUs();
+    while (m_options.maxFrames <= 0 || result->frames < m_options.maxFrames) {
+        readUs = BenchNowUs();
+        if (av_read_frame(m_format, &packet) < 0)
+            break;
+        readUs = BenchNowUs() - readUs;
+        result->packets++;
+        result->bytes += packet.size;
+        if (m_pass == BenchPass_Demux) {
+            if (packet.stream_index == m_videoIndex || packet.stream_index == m_audioIndex)
+                result->videoChecksum = av_adler32_update(result->videoChecksum, packet.data, packet.size);
+            if (packet.stream_index == m_videoIndex) {
+                result->latencyUs.push_back(readUs);
+                result->frames++;
+            }
+        } else if (packet.stream_index == m_videoIndex) {
+            decodeVideo(&packet, result, &pendingUs);
+        } else if (packet.stream_index == m_audioIndex && m_audio) {
+            decodeAudio(&packet, result);
+        }
+        av_free_packet(&packet);
+    }
+
+    /* 多线程解码时最后几帧还在解码器中 */
+    if (m_video) {
+        av_init_packet(&flush);
+        flush.data = NULL;
+        flush.size = 0;
+        while (m_options.maxFrames <= 0 || result->frames < m_options.maxFrames) {
+            int64_t frames = result->frames;
+
+            decodeVideo(&flush, result, &pendingUs);
+            if (result->frames == frames)
+                break;
+        }
+    }
+
+    result->wallUs = BenchNowUs() - startUs;
+    result->cpuUs = BenchCpuUs(&result->peakRssKB) - startCpuUs;
+    close();
+    return 0;
+}
+
+
+static void BenchResultReset(BenchResult* result)
+{
+    result->frames = result->packets = result->bytes = result->samples = result->decodeErrors = 0;
+    result->wallUs = result->cpuUs = 0;
+    result->peakRssKB = 0;
+    result->videoChecksum = result->audioChecksum = 1;     //Adler-32 的初值
+    result->latencyUs.clear();
+}
+
+static int64_t BenchPercentile(const std::vector<int64_t>& sorted, int percent)
+{
+    size_t index;
+
+    if (sorted.empty())
+        return 0;
+    index = (sorted.size() * percent + 99) / 100;
+    return sorted[index > 0 ? index - 1 : 0];
+}
+
+static void BenchReport(const char* name, BenchPass pass, BenchResult* result)
+{
+    std::vector<int64_t>& latency = result->latencyUs;
+    double seconds = result->wallUs > 0 ? result->wallUs / 1000000.0 : 1e-6;
+
+    std::sort(latency.begin(), latency.end());
+    printf("[%s] %s: %lld frames %.1f fps, %lld packets %.1f MB/s", g_passNames[pass], name, (long long)result->frames,
+           result->frames / seconds, (long long)result->packets, result->bytes / seconds / (1 << 20));
+    if (pass != BenchPass_Demux)
+        printf(", %lld audio samples", (long long)result->samples);
+    printf("\n        latency p50 %.3fms p90 %.3fms p99 %.3fms max %.3fms, cpu %.3fs (%.0f%%), peak rss %ldKB\n",
+           BenchPercentile(latency, 50) / 1000.0, BenchPercentile(latency, 90) / 1000.0,
+           BenchPercentile(latency, 99) / 1000.0, latency.empty() ? 0.0 : latency.back() / 1000.0,
+           result->cpuUs / 1000000.0, result->cpuUs * 100.0 / (result->wallUs > 0 ? result->wallUs : 1), result->peakRssKB);
+    printf("        checksum video %08lx audio %08lx, decode errors %lld\n", result->videoChecksum, result->audioChecksum,
+           (long long)result->decodeErrors);
+}
+
+/* 参考文件每行：文件名 遍 帧数 视频校验和 音频校验和；帧数不同(用了 -n)时不比较 */
+static bool BenchCheckReference(FILE* reference, const char* name, BenchPass pass, const BenchResult* result, bool* found)
+{
+    char line[BENCH_REFERENCE_LINE], fileName[BENCH_REFERENCE_LINE], passName[32];
+    long long frames;
+    unsigned long video, audio;
+
+    *found = false;
+    rewind(reference);
+    while (fgets(line, sizeof(line), reference)) {
+        if (sscanf(line, "%511s %31s %lld %lx %lx", fileName, passName, &frames, &video, &audio) != 5)
+            continue;
+        if (strcmp(fileName, name) != 0 || strcmp(passName, g_passNames[pass]) != 0 || frames != result->frames)
+            continue;
+        *found = true;
+        return video == result->videoChecksum && audio == result->audioChecksum;
+    }
+    return true;
+}
+
+static void BenchUsage()
+{
+    printf("usage: TestPlaybackBench.elf [-p demux|decode|convert|all] [-t threads] [-n frames] [-r|-w reference] [media ...]\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    std::vector<const char*> files;
+    FILE* readFile = NULL;
+    FILE* writeFile = NULL;
+    BenchResult result;
+    const char* name;
+    bool found, matched;
+    int failed = 0, checked = 0, pass, i, ret;
+
+    memset(&options, 0, sizeof(options));
+    options.passes = (1 << BenchPass_Count) - 1;
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            files.push_back(argv[i]);
+            continue;
+        }
+        if (i + 1 >= argc || argv[i][2] != '\0') {
+            BenchUsage();
+            return 1;
+        }
+        switch (argv[i][1]) {
+            case 'p':
+                options.passes = 0;
+                for (pass = 0; pass < BenchPass_Count; pass++) {
+                    if (strcmp(argv[i + 1], g_passNames[pass]) == 0 || strcmp(argv[i + 1], "all") == 0)
+                        options.passes |= 1 << pass;
+                }
+                break;
+            case 't': options.threads = atoi(argv[i + 1]); break;
+            case 'n': options.maxFrames = atoll(argv[i + 1]); break;
+            case 'r': options.readReference = argv[i + 1]; break;
+            case 'w': options.writeReference = argv[i + 1]; break;
+            default: options.passes = 0; break;
+        }
+        if (options.passes == 0) {
+            BenchUsage();
+            return 1;
+        }
+        i++;
+    }
+    if (files.empty()) {
+        files.push_back("cuc_ieschool.flv");
+        files.push_back("bigbuckbunny_480x272.h265");
+    }
+    if (options.readReference && (readFile = fopen(options.readReference, "r")) == NULL) {
+        printf("can't read reference [%s]\n", options.readReference);
+        return 1;
+    }
+    if (options.writeReference && (writeFile = fopen(options.writeReference, "w")) == NULL) {
+        printf("can't write reference [%s]\n", options.writeReference);
+        if (readFile)
+            fclose(readFile);
+        return 1;
+    }
+
+    av_register_all();
+    av_log_set_level(AV_LOG_ERROR);
+    for (i = 0; i < (int)files.size(); i++) {
+        name = strrchr(files[i], '/') ? strrchr(files[i], '/') + 1 : files[i];
+        for (pass = 0; pass < BenchPass_Count; pass++) {
+            if (!(options.passes & (1 << pass)))
+                continue;
+            BenchRunner runner(options, (BenchPass)pass);
+
+            BenchResultReset(&result);
+            ret = runner.run(files[i], &result);
+            if (ret < 0) {
+                printf("[%s] %s: %s, skipped\n", g_passNames[pass], name, ret == -2 ? "no decoder" : "can't open");
+                continue;
+            }
+            BenchReport(name, (BenchPass)pass, &result);
+            if (writeFile)
+                fprintf(writeFile, "%s %s %lld %08lx %08lx\n", name, g_passNames[pass], (long long)result.frames,
+                        result.videoChecksum, result.audioChecksum);
+            if (readFile) {
+                matched = BenchCheckReference(readFile, name, (BenchPass)pass, &result, &found);
+                checked += found ? 1 : 0;
+                failed += matched ? 0 : 1;
+                printf("        reference: %s\n", !found ? "not found" : (matched ? "OK" : "FAILED"));
+            }
+        }
+    }
+
+    if (readFile)
+        fclose(readFile);
+    if (writeFile)
+        fclose(writeFile);
+    if (readFile && checked == 0)
+        printf("no result matched the reference\n");
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+/**
+ *  TestVideoFramePool.cpp文件
+ *  VideoFramePool 的测试：
+ *          分配：YUV420P/NV12/BGR24 每个平面的起始和行宽对齐，奇数尺寸的色度平面够用
+ *          复用：归还后相同 (格式, 尺寸) 取到同一块内存，不同尺寸重新分配
+ *          引用计数：最后一个 release 才回到池中
+ *          淘汰：种类超过 VIDEO_POOL_CLASSES 淘汰最久没用的一类，空闲字节数不超过上限，上限为 0 时不缓存
+ *          高水位：使用中的个数和字节数，resetHighWater 从当前值重新统计
+ *          多线程：几个线程同时 acquire/addRef/release，结束后没有使用中的 surface，统计一致
+ *
+ *  用法：TestVideoFramePool.elf
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "VideoFramePool.h"
+
+
+#define     TEST_THREADS                4
+#define     TEST_THREAD_LOOPS           20000
+
+
+static bool TestAligned(const VideoSurface* surface, int planes)
+{
+    int p;
+
+    for (p = 0; p < planes; p++) {
+        if (surface->data[p] == NULL || ((uintptr_t)surface->data[p] & (VIDEO_POOL_ALIGN - 1)) != 0
+            || surface->linesize[p] <= 0 || (surface->linesize[p] & (VIDEO_POOL_ALIGN - 1)) != 0)
+            return false;
+    }
+    return true;
+}
+
+static int TestAlloc()
+{
+    VideoFramePool pool;
+    VideoSurface* yuv = pool.acquire(PIX_FMT_YUV420P, 719, 481);
+    VideoSurface* nv12 = pool.acquire(PIX_FMT_NV12, 1920, 1080);
+    VideoSurface* bgr = pool.acquire(PIX_FMT_BGR24, 480, 272);
+    bool ok;
+
+    ok = yuv && nv12 && bgr && TestAligned(yuv, 3) && TestAligned(nv12, 2) && TestAligned(bgr, 1);
+    ok = ok && yuv->width >= 719 && yuv->linesize[0] >= 719 && yuv->linesize[1] * 2 >= yuv->linesize[0];
+    ok = ok && yuv->data[3] == NULL && nv12->data[2] == NULL && bgr->data[1] == NULL;
+    /* 最后一行写满，不越过 buffer */
+    if (ok) {
+        memset(yuv->data[0], 0x10, yuv->linesize[0] * 481);
+        memset(yuv->data[1], 0x80, yuv->linesize[1] * 241);
+        memset(yuv->data[2], 0x80, yuv->linesize[2] * 241);
+        ok = yuv->data[2] + yuv->linesize[2] * 241 <= yuv->buffer + yuv->size;
+        ok = ok && yuv->data[0] + yuv->linesize[0] * 481 <= yuv->data[1] && yuv->data[1] + yuv->linesize[1] * 241 <= yuv->data[2];
+        ok = ok && bgr->data[0] + bgr->linesize[0] * 272 <= bgr->buffer + bgr->size;
+    }
+    ok = ok && pool.acquire(PIX_FMT_YUV420P, 0, 480) == NULL && pool.acquire(-1, 640, 480) == NULL;
+    pool.release(yuv);
+    pool.release(nv12);
+    pool.release(bgr);
+    pool.release(NULL);
+    ok = ok && pool.getStatistics().inUse == 0;
+    printf("[alloc] yuv %dx%d linesize %d/%d/%d: %s\n", yuv ? yuv->width : 0, yuv ? yuv->height : 0,
+           yuv ? yuv->linesize[0] : 0, yuv ? yuv->linesize[1] : 0, yuv ? yuv->linesize[2] : 0, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestReuse()
+{
+    VideoFramePool pool;
+    VideoFramePoolStatistics statistics;
+    VideoSurface* first;
+    VideoSurface* second;
+    uint8_t* buffer;
+    bool ok;
+
+    first = pool.acquire(PIX_FMT_YUV420P, 640, 480);
+    buffer = first->buffer;
+    pool.release(first);
+    second = pool.acquire(PIX_FMT_YUV420P, 630, 480);     //取整后同一类
+    ok = second && second->buffer == buffer && second->refs == 1;
+    pool.release(second);
+    second = pool.acquire(PIX_FMT_YUV420P, 640, 360);
+    ok = ok && second && second->buffer != buffer;
+    pool.release(second);
+
+    statistics = pool.getStatistics();
+    ok = ok && statistics.acquired == 3 && statistics.reused == 1 && statistics.allocated == 2 && statistics.freed == 0;
+    ok = ok && statistics.surfaces == 2 && statistics.inUse == 0 && statistics.inUseBytes == 0;
+    pool.trim();
+    statistics = pool.getStatistics();
+    ok = ok && statistics.surfaces == 0 && statistics.bytes == 0 && statistics.freed == 2;
+    printf("[reuse] acquired %lld reused %lld allocated %lld: %s\n", (long long)statistics.acquired,
+           (long long)statistics.reused, (long long)statistics.allocated, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestRefs()
+{
+    VideoFramePool pool;
+    VideoSurface* surface = pool.acquire(PIX_FMT_YUV420P, 320, 240);
+    bool ok;
+
+    pool.addRef(surface);
+    pool.addRef(surface);
+    pool.release(surface);
+    pool.release(surface);
+    ok = surface->refs == 1 && pool.getStatistics().inUse == 1;
+    pool.release(surface);
+    ok = ok && pool.getStatistics().inUse == 0 && pool.getStatistics().surfaces == 1;
+    printf("[refs] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestEvict()
+{
+    VideoFramePool pool;
+    VideoFramePoolStatistics statistics;
+    VideoSurface* surfaces[VIDEO_POOL_CLASSES + 1];
+    VideoSurface* surface;
+    int64_t size;
+    bool ok = true;
+    int i;
+
+    /* 每类一个，第一类最久没用，再放一类时被淘汰 */
+    for (i = 0; i <= VIDEO_POOL_CLASSES; i++)
+        surfaces[i] = pool.acquire(PIX_FMT_YUV420P, 64, 64 + i * 2);
+    for (i = 0; i <= VIDEO_POOL_CLASSES; i++)
+        pool.release(surfaces[i]);
+    statistics = pool.getStatistics();
+    ok = statistics.surfaces == VIDEO_POOL_CLASSES && statistics.freed == 1;
+    surface = pool.acquire(PIX_FMT_YUV420P, 64, 64);
+    ok = ok && pool.getStatistics().reused == 0;
+    pool.release(surface);
+    surface = pool.acquire(PIX_FMT_YUV420P, 64, 66);
+    ok = ok && pool.getStatistics().reused == 0;      //第二类在上面被淘汰
+    pool.release(surface);
+
+    /* 空闲上限：只留得下两个 */
+    size = surface->size;
+    pool.trim();
+    pool.setIdleLimit(size * 2);
+    for (i = 0; i < 4; i++)
+        surfaces[i] = pool.acquire(PIX_FMT_YUV420P, 64, 66);
+    for (i = 0; i < 4; i++)
+        pool.release(surfaces[i]);
+    statistics = pool.getStatistics();
+    ok = ok && statistics.surfaces == 2 && statistics.bytes == size * 2;
+
+    pool.setIdleLimit(0);
+    statistics = pool.getStatistics();
+    ok = ok && statistics.surfaces == 0;
+    surface = pool.acquire(PIX_FMT_YUV420P, 64, 66);
+    pool.release(surface);
+    ok = ok && pool.getStatistics().surfaces == 0;
+    printf("[evict] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int TestHighWater()
+{
+    VideoFramePool pool;
+    VideoFramePoolStatistics statistics;
+    VideoSurface* surfaces[6];
+    bool ok;
+    int i;
+
+    for (i = 0; i < 6; i++)
+        surfaces[i] = pool.acquire(PIX_FMT_YUV420P, 352, 288);
+    for (i = 0; i < 6; i++)
+        pool.release(surfaces[i]);
+    surfaces[0] = pool.acquire(PIX_FMT_YUV420P, 352, 288);
+    statistics = pool.getStatistics();
+    ok = statistics.inUse == 1 && statistics.inUseHighWater == 6 && statistics.inUseBytesHighWater == surfaces[0]->size * 6;
+    ok = ok && statistics.bytesHighWater == surfaces[0]->size * 6;
+    pool.resetHighWater();
+    statistics = pool.getStatistics();
+    ok = ok && statistics.inUseHighWater == 1 && statistics.inUseBytesHighWater == surfaces[0]->size;
+    pool.release(surfaces[0]);
+    printf("[high water] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/* 模拟解码、转换、显示：取一个，传给下一个阶段(addRef)，两边各自 release */
+static void* TestWorker(void* arg)
+{
+    VideoFramePool* pool = (VideoFramePool*)arg;
+    VideoSurface* held[4] = {NULL, NULL, NULL, NULL};
+    VideoSurface* surface;
+    int i;
+
+    for (i = 0; i < TEST_THREAD_LOOPS; i++) {
+        surface = pool->acquire(PIX_FMT_YUV420P, 160 + (i % 3) * 32, 120);
+        if (surface == NULL)
+            continue;
+        surface->data[0][0] = (uint8_t)i;
+        pool->addRef(surface);
+        pool->release(held[i % 4]);
+        held[i % 4] = surface;
+        pool->release(surface);
+    }
+    for (i = 0; i < 4; i++)
+        pool->release(held[i]);
+    return NULL;
+}
+
+static int TestThreads()
+{
+    VideoFramePool pool;
+    VideoFramePoolStatistics statistics;
+    pthread_t threads[TEST_THREADS];
+    bool ok;
+    int i;
+
+    for (i = 0; i < TEST_THREADS; i++)
+        pthread_create(&threads[i], NULL, TestWorker, &pool);
+    for (i = 0; i < TEST_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    statistics = pool.getStatistics();
+    ok = statistics.acquired == TEST_THREADS * TEST_THREAD_LOOPS && statistics.failures == 0;
+    ok = ok && statistics.inUse == 0 && statistics.inUseBytes == 0;
+    ok = ok && statistics.acquired == statistics.reused + statistics.allocated;
+    ok = ok && statistics.surfaces == statistics.allocated - statistics.freed;
+    ok = ok && statistics.inUseHighWater <= TEST_THREADS * 5;
+    printf("[threads] acquired %lld allocated %lld high water %d: %s\n", (long long)statistics.acquired,
+           (long long)statistics.allocated, statistics.inUseHighWater, ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+int main()
+{
+    int failed = 0;
+
+    failed += TestAlloc();
+    failed += TestReuse();
+    failed += TestRefs();
+    failed += TestEvict();
+    failed += TestHighWater();
+    failed += TestThreads();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
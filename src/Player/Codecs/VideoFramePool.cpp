@@ -0,0 +1,371 @@
+/**
+ *  VideoFramePool.cpp文件
+ *  解码、转换、显示共用的视频帧池；
+ *  主要有以下部分：
+ *      1. 分配：宽度按色度的采样取整，使每个平面的行都按 VIDEO_POOL_ALIGN 字节对齐，平面的起始也对齐，后面留余量
+ *      2. 回收：引用计数为 0 时按 (格式, 尺寸) 放回空闲链表；种类满了淘汰最久没用的一类，空闲的总字节数有上限
+ *      3. 直接解码(DR1)：get_buffer/release_buffer 从池中取 surface，解码器的参考帧和后面的阶段各持有引用；
+ *         reget_buffer 时如果后面的阶段还在用，先复制一份，已经输出的帧不会被改写
+ *      4. 统计：使用中的个数和字节数的高水位，用来设置内存紧张的设备上的队列长度
+ *
+ **/
+
+#define __STDC_CONSTANT_MACROS
+
+#include <string.h>
+#include <limits.h>
+
+//Linux...
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+#include "LogPlayer.h"
+};
+
+#include "VideoFramePool.h"
+
+
+VideoFramePool::VideoFramePool(int64_t idleBytes)
+    : m_useCounter(0)
+    , m_idleBytes(0)
+    , m_idleLimit(idleBytes)
+{
+    memset(m_classes, 0, sizeof(m_classes));
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    m_mutex = ThreadMutexCreate();
+}
+
+VideoFramePool::~VideoFramePool()
+{
+    ThreadMutexLock(m_mutex);
+    shrinkIdle(0);
+    if (m_statistics.inUse > 0)
+        playerLogWarning("VideoFramePool destroyed with [%d] surfaces in use.\n", m_statistics.inUse);
+    ThreadMutexUnLock(m_mutex);
+    ThreadMutexDestroy(m_mutex);
+}
+
+VideoFramePool* VideoFramePool::shared()
+{
+    static VideoFramePool pool;
+
+    return &pool;
+}
+
+VideoSurface* VideoFramePool::allocSurface(int format, int width, int height)
+{
+    const AVPixFmtDescriptor* desc = &av_pix_fmt_descriptors[format];
+    VideoSurface* surface;
+    int linesize[4], offset[4], planeHeight, size = 0, p;
+
+    /* 色度平面的行也要对齐，宽度按色度的采样放大 */
+    width = (width + (VIDEO_POOL_ALIGN << desc->log2_chroma_w) - 1) & ~((VIDEO_POOL_ALIGN << desc->log2_chroma_w) - 1);
+    if (av_image_fill_linesizes(linesize, (enum PixelFormat)format, width) < 0)
+        return NULL;
+    memset(offset, 0, sizeof(offset));
+    for (p = 0; p < 4; p++) {
+        if (linesize[p] <= 0 && !(p == 1 && (desc->flags & PIX_FMT_PAL)))
+            continue;
+        planeHeight = (p == 1 || p == 2) ? -((-height) >> desc->log2_chroma_h) : height;
+        offset[p] = size;
+        size += (linesize[p] > 0 ? linesize[p] * planeHeight : 256 * 4) + VIDEO_POOL_ALIGN;    //调色板 256 个 32 位颜色
+        size = (size + VIDEO_POOL_ALIGN - 1) & ~(VIDEO_POOL_ALIGN - 1);
+    }
+
+    surface = new VideoSurface;
+    memset(surface, 0, sizeof(*surface));
+    /* av_malloc 不一定按 VIDEO_POOL_ALIGN 对齐，多分配一些自己对齐 */
+    surface->buffer = (uint8_t*)av_malloc(size + VIDEO_POOL_ALIGN);
+    if (surface->buffer == NULL) {
+        delete surface;
+        return NULL;
+    }
+    for (p = 0; p < 4; p++) {
+        if (linesize[p] <= 0 && !(p == 1 && (desc->flags & PIX_FMT_PAL)))
+            continue;
+        surface->data[p] = (uint8_t*)(((uintptr_t)surface->buffer + VIDEO_POOL_ALIGN - 1) & ~(uintptr_t)(VIDEO_POOL_ALIGN - 1)) + offset[p];
+        surface->linesize[p] = linesize[p];
+    }
+    surface->format = format;
+    surface->width = width;
+    surface->height = height;
+    surface->size = size + VIDEO_POOL_ALIGN;
+    surface->pool = this;
+    return surface;
+}
+
+void VideoFramePool::freeSurface(VideoSurface* surface)
+{
+    m_statistics.surfaces--;
+    m_statistics.bytes -= surface->size;
+    m_statistics.freed++;
+    av_free(surface->buffer);
+    delete surface;
+}
+
+VideoSurface* VideoFramePool::acquire(int format, int width, int height)
+{
+    const AVPixFmtDescriptor* desc;
+    VideoSurface* surface = NULL;
+    FreeClass* freeClass;
+    int i;
+
+    if (format < 0 || format >= PIX_FMT_NB || width <= 0 || height <= 0)
+        return NULL;
+    desc = &av_pix_fmt_descriptors[format];
+    width = (width + (VIDEO_POOL_ALIGN << desc->log2_chroma_w) - 1) & ~((VIDEO_POOL_ALIGN << desc->log2_chroma_w) - 1);
+
+    ThreadMutexLock(m_mutex);
+    m_statistics.acquired++;
+    for (i = 0; i < VIDEO_POOL_CLASSES; i++) {
+        freeClass = &m_classes[i];
+        if (freeClass->head && freeClass->format == format && freeClass->width == width && freeClass->height == height) {
+            surface = freeClass->head;
+            freeClass->head = surface->next;
+            freeClass->count--;
+            freeClass->lastUsed = ++m_useCounter;
+            m_idleBytes -= surface->size;
+            m_statistics.reused++;
+            break;
+        }
+    }
+    ThreadMutexUnLock(m_mutex);
+
+    /* 分配不在锁内，解码线程的 get_buffer 不用等别的线程分配 */
+    if (surface == NULL) {
+        surface = allocSurface(format, width, height);
+        ThreadMutexLock(m_mutex);
+        if (surface == NULL) {
+            m_statistics.failures++;
+            ThreadMutexUnLock(m_mutex);
+            playerLogError("VideoFramePool alloc format[%d] %dx%d failed.\n", format, width, height);
+            return NULL;
+        }
+        m_statistics.allocated++;
+        m_statistics.surfaces++;
+        m_statistics.bytes += surface->size;
+        if (m_statistics.bytes > m_statistics.bytesHighWater)
+            m_statistics.bytesHighWater = m_statistics.bytes;
+    } else {
+        ThreadMutexLock(m_mutex);
+    }
+    m_statistics.inUse++;
+    m_statistics.inUseBytes += surface->size;
+    if (m_statistics.inUse > m_statistics.inUseHighWater)
+        m_statistics.inUseHighWater = m_statistics.inUse;
+    if (m_statistics.inUseBytes > m_statistics.inUseBytesHighWater)
+        m_statistics.inUseBytesHighWater = m_statistics.inUseBytes;
+    ThreadMutexUnLock(m_mutex);
+
+    surface->refs = 1;
+    surface->next = NULL;
+    return surface;
+}
+
+void VideoFramePool::addRef(VideoSurface* surface)
+{
+    __sync_add_and_fetch(&surface->refs, 1);
+}
+
+void VideoFramePool::release(VideoSurface* surface)
+{
+    if (surface == NULL)
+        return;
+    if (__sync_sub_and_fetch(&surface->refs, 1) == 0)
+        surface->pool->recycle(surface);
+}
+
+void VideoFramePool::recycle(VideoSurface* surface)
+{
+    FreeClass* freeClass = NULL;
+    FreeClass* oldest = NULL;
+    VideoSurface* next;
+    int i;
+
+    ThreadMutexLock(m_mutex);
+    m_statistics.inUse--;
+    m_statistics.inUseBytes -= surface->size;
+    if (m_idleLimit <= 0) {
+        freeSurface(surface);
+        ThreadMutexUnLock(m_mutex);
+        return;
+    }
+
+    /* 找到同一类；没有时用空的一类，都不空时淘汰最久没用的一类 */
+    for (i = 0; i < VIDEO_POOL_CLASSES; i++) {
+        if (m_classes[i].head && m_classes[i].format == surface->format
+            && m_classes[i].width == surface->width && m_classes[i].height == surface->height) {
+            freeClass = &m_classes[i];
+            break;
+        }
+        if (oldest == NULL || m_classes[i].head == NULL || (oldest->head && m_classes[i].lastUsed < oldest->lastUsed))
+            oldest = &m_classes[i];
+    }
+    if (freeClass == NULL) {
+        freeClass = oldest;
+        while (freeClass->head) {
+            next = freeClass->head->next;
+            m_idleBytes -= freeClass->head->size;
+            freeSurface(freeClass->head);
+            freeClass->head = next;
+        }
+        freeClass->format = surface->format;
+        freeClass->width = surface->width;
+        freeClass->height = surface->height;
+        freeClass->count = 0;
+    }
+    surface->next = freeClass->head;
+    freeClass->head = surface;
+    freeClass->count++;
+    freeClass->lastUsed = ++m_useCounter;
+    m_idleBytes += surface->size;
+    shrinkIdle(m_idleLimit);
+    ThreadMutexUnLock(m_mutex);
+}
+
+void VideoFramePool::shrinkIdle(int64_t limit)
+{
+    FreeClass* oldest;
+    VideoSurface* surface;
+    int i;
+
+    while (m_idleBytes > limit) {
+        oldest = NULL;
+        for (i = 0; i < VIDEO_POOL_CLASSES; i++) {
+            if (m_classes[i].head && (oldest == NULL || m_classes[i].lastUsed < oldest->lastUsed))
+                oldest = &m_classes[i];
+        }
+        if (oldest == NULL)
+            break;
+        surface = oldest->head;
+        oldest->head = surface->next;
+        oldest->count--;
+        m_idleBytes -= surface->size;
+        freeSurface(surface);
+    }
+}
+
+void VideoFramePool::setIdleLimit(int64_t bytes)
+{
+    ThreadMutexLock(m_mutex);
+    m_idleLimit = bytes;
+    shrinkIdle(bytes > 0 ? bytes : 0);
+    ThreadMutexUnLock(m_mutex);
+}
+
+void VideoFramePool::trim()
+{
+    ThreadMutexLock(m_mutex);
+    shrinkIdle(0);
+    ThreadMutexUnLock(m_mutex);
+}
+
+VideoFramePoolStatistics VideoFramePool::getStatistics()
+{
+    VideoFramePoolStatistics statistics;
+
+    ThreadMutexLock(m_mutex);
+    statistics = m_statistics;
+    ThreadMutexUnLock(m_mutex);
+    return statistics;
+}
+
+void VideoFramePool::resetHighWater()
+{
+    ThreadMutexLock(m_mutex);
+    m_statistics.inUseHighWater = m_statistics.inUse;
+    m_statistics.inUseBytesHighWater = m_statistics.inUseBytes;
+    m_statistics.bytesHighWater = m_statistics.bytes;
+    ThreadMutexUnLock(m_mutex);
+}
+
+
+bool VideoFramePool::attachDecoder(AVCodecContext* codecCtx, AVCodec* codec, VideoFramePool* pool)
+{
+    if (codec == NULL || pool == NULL || !(codec->capabilities & CODEC_CAP_DR1))
+        return false;
+    /* 池中的 surface 没有留边，解码器自己处理越界的运动矢量 */
+    codecCtx->flags |= CODEC_FLAG_EMU_EDGE;
+    codecCtx->opaque = pool;
+    codecCtx->get_buffer = getBuffer;
+    codecCtx->release_buffer = releaseBuffer;
+    codecCtx->reget_buffer = regetBuffer;
+    codecCtx->thread_safe_callbacks = 1;
+    return true;
+}
+
+VideoSurface* VideoFramePool::frameSurface(const AVFrame* frame)
+{
+    if (frame == NULL || frame->type != FF_BUFFER_TYPE_USER || frame->opaque == NULL)
+        return NULL;
+    return (VideoSurface*)frame->opaque;
+}
+
+int VideoFramePool::getBuffer(AVCodecContext* codecCtx, AVFrame* frame)
+{
+    VideoFramePool* pool = (VideoFramePool*)codecCtx->opaque;
+    VideoSurface* surface;
+    int width = codecCtx->width, height = codecCtx->height, align[4];
+
+    if (av_image_check_size(width, height, 0, codecCtx) < 0)
+        return -1;
+    avcodec_align_dimensions2(codecCtx, &width, &height, align);
+    surface = pool->acquire(codecCtx->pix_fmt, width, height);
+    if (surface == NULL)
+        return -1;
+
+    memcpy(frame->data, surface->data, sizeof(frame->data));
+    memcpy(frame->linesize, surface->linesize, sizeof(frame->linesize));
+    frame->opaque = surface;
+    frame->age = INT_MAX;
+    frame->type = FF_BUFFER_TYPE_USER;
+    frame->reordered_opaque = codecCtx->reordered_opaque;
+    frame->pkt_pts = codecCtx->pkt ? codecCtx->pkt->pts : (int64_t)AV_NOPTS_VALUE;
+    return 0;
+}
+
+void VideoFramePool::releaseBuffer(AVCodecContext* codecCtx, AVFrame* frame)
+{
+    VideoSurface* surface = frameSurface(frame);
+
+    (void)codecCtx;
+    memset(frame->data, 0, sizeof(frame->data));
+    frame->opaque = NULL;
+    if (surface)
+        surface->pool->release(surface);
+}
+
+int VideoFramePool::regetBuffer(AVCodecContext* codecCtx, AVFrame* frame)
+{
+    VideoSurface* surface = frameSurface(frame);
+    VideoSurface* copy;
+    AVPicture src, dst;
+
+    if (frame->data[0] == NULL) {
+        frame->buffer_hints |= FF_BUFFER_HINTS_READABLE;
+        return getBuffer(codecCtx, frame);
+    }
+    if (surface == NULL || surface->format != codecCtx->pix_fmt) {
+        playerLogError("VideoFramePool reget_buffer, picture properties changed.\n");
+        return -1;
+    }
+
+    /* 解码器要在上一帧上修改，后面的阶段还持有这一帧时先复制，已经输出的帧保持不变 */
+    if (surface->refs > 1) {
+        copy = surface->pool->acquire(surface->format, surface->width, surface->height);
+        if (copy == NULL)
+            return -1;
+        memcpy(src.data, surface->data, sizeof(src.data));
+        memcpy(src.linesize, surface->linesize, sizeof(src.linesize));
+        memcpy(dst.data, copy->data, sizeof(dst.data));
+        memcpy(dst.linesize, copy->linesize, sizeof(dst.linesize));
+        av_picture_copy(&dst, &src, (enum PixelFormat)surface->format, surface->width, surface->height);
+        memcpy(frame->data, copy->data, sizeof(frame->data));
+        memcpy(frame->linesize, copy->linesize, sizeof(frame->linesize));
+        frame->opaque = copy;
+        surface->pool->release(surface);
+    }
+    frame->reordered_opaque = codecCtx->reordered_opaque;
+    frame->pkt_pts = codecCtx->pkt ? codecCtx->pkt->pts : (int64_t)AV_NOPTS_VALUE;
+    return 0;
+}
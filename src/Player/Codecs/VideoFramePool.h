@@ -0,0 +1,123 @@
+#ifndef __VIDEO_FRAME_POOL_H__
+#define __VIDEO_FRAME_POOL_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+//Linux...
+extern "C" {
+#include <libavcodec/avcodec.h>
+};
+
+#include "ThreadMutex.h"
+
+
+#define     VIDEO_POOL_ALIGN            32          //每行和每个平面的起始按字节对齐，末尾多留这么多给 SIMD 越界读
+#define     VIDEO_POOL_CLASSES          8           //同时缓存的 (格式, 尺寸) 种类，满了淘汰最久没用的一类
+#define     VIDEO_POOL_IDLE_BYTES       (64 << 20)  //空闲 surface 最多缓存的字节数，超过时释放最久没用的
+
+
+/* 引用计数的视频帧内存，由 VideoFramePool 分配和回收；引用为 0 之前内容只读 */
+typedef struct _VideoSurface {
+    uint8_t*                data[4];
+    int                     linesize[4];
+    int                     format;             //PixelFormat
+    int                     width;              //分配的尺寸，解码时包含解码器要求的对齐
+    int                     height;
+    int                     size;               //buffer 的字节数
+    uint8_t*                buffer;
+    volatile int            refs;
+    class VideoFramePool*   pool;               //所属的池，release 时归还到这里
+    struct _VideoSurface*   next;               //空闲链表
+} VideoSurface;
+
+typedef struct _VideoFramePoolStatistics {
+    int64_t         acquired;           //acquire 次数
+    int64_t         reused;             //从空闲链表取到，没有分配
+    int64_t         allocated;
+    int64_t         freed;              //淘汰、超过空闲上限或 trim 释放
+    int64_t         failures;           //分配失败
+    int             surfaces;           //现有的，使用中加空闲
+    int             inUse;
+    int             inUseHighWater;     //使用中的最大个数，按它设置内存紧张的设备上的池大小
+    int64_t         bytes;              //现有的总字节数
+    int64_t         bytesHighWater;
+    int64_t         inUseBytes;
+    int64_t         inUseBytesHighWater;
+} VideoFramePoolStatistics;
+
+
+class VideoFramePool { /* 解码、转换、显示共用的帧池：按 (格式, 尺寸) 分类的空闲链表，引用计数，引用为 0 时回到链表，不同码流之间复用 */
+    public:
+        VideoFramePool(int64_t idleBytes = VIDEO_POOL_IDLE_BYTES);
+        ~VideoFramePool();                  //使用中的 surface 不释放，记录警告
+        static VideoFramePool* shared();    //进程共用，播放器实例默认使用
+
+        /**
+         *  @Func: acquire
+         *         ps. :优先取相同格式和尺寸的空闲 surface，没有时分配；宽度按 VIDEO_POOL_ALIGN 像素取整，
+         *               每个平面的起始和每行都对齐
+         *  @Param: format, type:: int, PixelFormat
+         *  @Param: width/height, type:: int
+         *  @Return: VideoSurface*, 引用为 1，失败返回 NULL
+         *
+         **/
+        VideoSurface* acquire(int format, int width, int height);
+        void addRef(VideoSurface* surface);
+        void release(VideoSurface* surface);    //NULL 时忽略
+
+        void setIdleLimit(int64_t bytes);   //0 时不缓存，release 之后立即释放
+        void trim();                        //释放所有空闲的 surface
+        VideoFramePoolStatistics getStatistics();
+        void resetHighWater();              //高水位从当前值重新统计
+
+        /**
+         *  @Func: attachDecoder
+         *         ps. :支持 CODEC_CAP_DR1 的解码器直接解码到池中的 surface，解码器和后面的阶段各持有引用，
+         *               输出帧不需要复制；必须在 avcodec_open 之前调用，会设置 CODEC_FLAG_EMU_EDGE 和 codec->opaque
+         *  @Param: codecCtx, type:: AVCodecContext*
+         *  @Param: codec, type:: AVCodec*
+         *  @Param: pool, type:: VideoFramePool*, 必须比解码器活得久
+         *  @Return: bool, false 时解码器不支持，仍用 ffmpeg 自己的缓冲区
+         *
+         **/
+        static bool attachDecoder(AVCodecContext* codecCtx, AVCodec* codec, VideoFramePool* pool);
+        static VideoSurface* frameSurface(const AVFrame* frame);   //attachDecoder 之后解码出的帧所在的 surface，否则 NULL
+
+    private:
+        typedef struct _FreeClass {
+            int                 format;
+            int                 width;
+            int                 height;
+            VideoSurface*       head;
+            int                 count;
+            uint64_t            lastUsed;
+        } FreeClass;
+
+        VideoFramePool(const VideoFramePool&);
+        VideoFramePool& operator=(const VideoFramePool&);
+
+        VideoSurface* allocSurface(int format, int width, int height);
+        void freeSurface(VideoSurface* surface);       //调用者持有 m_mutex
+        void recycle(VideoSurface* surface);
+        void shrinkIdle(int64_t limit);                //调用者持有 m_mutex
+        static int getBuffer(AVCodecContext* codecCtx, AVFrame* frame);
+        static void releaseBuffer(AVCodecContext* codecCtx, AVFrame* frame);
+        static int regetBuffer(AVCodecContext* codecCtx, AVFrame* frame);
+
+        ThreadMutex_Type            m_mutex;            //保护以下成员，引用计数用原子操作
+        FreeClass                   m_classes[VIDEO_POOL_CLASSES];
+        uint64_t                    m_useCounter;
+        int64_t                     m_idleBytes;
+        int64_t                     m_idleLimit;
+        VideoFramePoolStatistics    m_statistics;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__VIDEO_FRAME_POOL_H__
@@ -25,12 +25,14 @@ extern "C" {
 #include "PlayListUtility.h"
 
 #include "MappingPlayList.h"
+#include "PlayListIndex.h"
 
 
 MappingPlayList::MappingPlayList()
+    : m_playList(new PlayListIndex())
+    , m_version(0)
+    , m_mutex(NULL)
 {
-    if (m_mutex)
-        playerLogWarning("thread mutex has init.\n");
     m_mutex = ThreadMutexCreate( );
     
     m_outputFileName = OUTPUT_PLAYLIST_FILE_PATH;
@@ -40,8 +42,8 @@ MappingPlayList::MappingPlayList()
 
 MappingPlayList::~MappingPlayList()
 {
-    
-    
+    delete m_playList;
+    ThreadMutexDestroy(m_mutex);
 }
 
 
@@ -192,13 +194,13 @@ PlayListItemS* parseRecordLine(std::string& strLine)
  *  e.g: 
  *  Name[file.mp4] in [/root], AddTime[2012-Jan-01 08:02:05.481], LastPlayPosition[01:02:05.481];
  **/
-int combineRecordLine(PlayListItemS& playListItem, std::string& line)
+int combineRecordLine(const PlayListItemView& playListItem, std::string& line)
 {
     
-    line += "Name[" + playListItem.Name;
-    line += "] in [" + playListItem.Path;
-    line += "],AddTime[" + playListItem.AddTime;
-    line += "], LastPlayPosition[" + playListItem.LastPlayPosition;
+    line.append("Name[").append(playListItem.Name);
+    line.append("] in [").append(playListItem.Path);
+    line.append("],AddTime[").append(playListItem.AddTime);
+    line.append("], LastPlayPosition[").append(playListItem.LastPlayPosition);
     line.append("];");
     
     playerLogInfo("combineRecordLine, line[%s].\n", line.c_str());
@@ -206,12 +208,12 @@ int combineRecordLine(PlayListItemS& playListItem, std::string& line)
 }
 /**
  *  @Func: loadPlayListMap
- *         ps. :逐行从文件 config_param_modify.record 加载到 m_playListMap
+ *         ps. :逐行从文件 config_param_modify.record 加载到 m_playList
  *  @Param: 
  *  @Return: int
  *  
  **/
-int MappingPlayList::loadPlayListMap()    //将 m_cfgPlayingFileList 中配置文件里的键值对加载到 m_playListMap
+int MappingPlayList::loadPlayListMap()    //将 m_cfgPlayingFileList 中配置文件里的键值对加载到 m_playList
 {
     std::vector<std::string>::iterator cfgPlayingFileListIt;
     bool fileAvailableLineFlag = false;
@@ -239,12 +241,13 @@ int MappingPlayList::loadPlayListMap()    //将 m_cfgPlayingFileList 中配置
                 break;
             }
             playerLogInfo("Start parse line[%s].\n", line.c_str());
-            addItemToPlayListMap(parseRecordLine(line)); //逐行添加
+            addItem(parseRecordLine(line), -1, NULL); //逐行添加，加载完后一次通知
             line.clear();
         }
         fin.close();
         playerLogInfo("Load %s ok.\n", (*cfgPlayingFileListIt).c_str());
     }
+    notifyReset();
 
     return 0;
 }
@@ -252,11 +255,15 @@ int MappingPlayList::loadPlayListMap()    //将 m_cfgPlayingFileList 中配置
 
 int MappingPlayList::unloadPlayListMap()
 {
-    if(m_playListMap.empty()){
-        playerLogError("unloadModifyRecordParam:: m_playListMap has been empty, ERROR.\n");
+    ThreadMutexLock(m_mutex);
+    if(m_playList->size() == 0){
+        ThreadMutexUnLock(m_mutex);
+        playerLogError("unloadModifyRecordParam:: m_playList has been empty, ERROR.\n");
         return -1;
     }
-    m_playListMap.erase(m_playListMap.begin(), m_playListMap.end());
+    m_playList->clear();
+    ThreadMutexUnLock(m_mutex);
+    notifyReset();
     playerLogVerbose("Has unload ModifyRecord OK.\n");
     
     return 0;
@@ -266,18 +273,20 @@ int MappingPlayList::unloadPlayListMap()
 int MappingPlayList::savePlayListMapFormating()
 {
     playerLogVerbose("savePlayListMapFormating\n");
-    std::multimap<std::string, PlayListItemS>::iterator it;
     std::string line("");
     FILE *fp = NULL;
+    int i;
     
     if (ThreadMutexLock(m_mutex))
         playerLogWarning("thread mutex locking error.\n");
     if ((fp = fopen(m_outputFileName.c_str(), "wb")) == NULL) {
+        ThreadMutexUnLock(m_mutex);
         playerLogError("Open file error.(%s)\n", m_outputFileName.c_str());
         return -1;
     }
-    for(it = m_playListMap.begin(); it != m_playListMap.end(); ++it){
-        combineRecordLine(it->second, line);
+    for(i = 0; i < m_playList->size(); i++){    //按列表顺序保存
+        line.clear();
+        combineRecordLine(*m_playList->at(i), line);
         fwrite(line.c_str(), 1, line.length(), fp);
     }
     fclose(fp);
@@ -288,222 +297,193 @@ int MappingPlayList::savePlayListMapFormating()
 }
 
 
-int MappingPlayList::addItemToPlayListMap(PlayListItemS* playListItem)  //在每次将修改信息写入到 m_fileName 文件后，更新内存中的配置文件拷贝 m_paramConfigFileMap ，
+/**
+ *  @Func: addItem
+ *         ps. :插入条目，change 不为 NULL 时填写变化，由调用者在解锁后通知
+ *  @Param: playListItem, type:: PlayListItemS*
+ *  @Param: position, type:: int, 从 0 开始，-1 加在最后
+ *  @Param: change, type:: PlayListChange*
+ *  @Return: int, 0 成功，-1 失败
+ *  
+ **/
+int MappingPlayList::addItem(PlayListItemS* playListItem, int position, PlayListChange* change)
 {
     if( (playListItem->Name).compare("ERROR") == 0 || (playListItem->Name).empty() ){
         playerLogError("playListItem[%p], Name[%s].\n", playListItem, playListItem->Name.c_str());
         return -1;
     }
     
-    std::pair<std::string, PlayListItemS> listItem(playListItem->Name, *playListItem);
-    m_playListMap.insert(listItem);
+    ThreadMutexLock(m_mutex);
+    position = m_playList->insert(*playListItem, position);
+    if (position >= 0 && change)
+        makeChange(PlayListChange_Inserted, position, change);
+    ThreadMutexUnLock(m_mutex);
     
-    return 0;
+    return (position < 0) ? -1 : 0;
 }
 
 
-int MappingPlayList::deleteItemToPlayListMap(std::string& name, PlayListItemS& playListItem)
+int MappingPlayList::addItemToPlayListMap(PlayListItemS* playListItem)  //在每次将修改信息写入到 m_fileName 文件后，更新内存中的配置文件拷贝 m_paramConfigFileMap ，
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.find(name);
+    PlayListChange change;
     
-    if(iter == m_playListMap.end()){
-        playerLogError("Cannot find PlayList Item[%s].\n", name.c_str());
+    if (addItem(playListItem, -1, &change) < 0)
         return -1;
-    }
-    
-    m_playListMap.erase(iter->first);
+    notify(change);
     
     return 0;
 }
 
 
-/**
-typedef struct _PlayList{
-    std::string Name;               //primary key 文件名称
-    std::string Path;               //文件所在路径
-    std::string Type;               //文件类型,后缀名
-    std::string Size;               //文件大小
-    std::string AddTime;            //添加到列表的时间
-    std::string Duration;           //文件播放时长
-    std::string LastPlayPosition;   //记录上次播放位置
-    
-    std::string Singer;
-    std::string AVinfo; //记录音视频信息，json格式
-    int IsCurrentPlaying;
-    int RandomValue;
-} PlayListItemS;
-**/
-int cmpFileName(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
+int MappingPlayList::insertItemToPlayListMap(int index, PlayListItemS* playListItem)   //index 从 1 开始
 {
-    playerLogDebug("\n");
-    return ((x.second).Name).compare((y.second).Name);
+    PlayListChange change;
+    
+    if (addItem(playListItem, index - 1, &change) < 0)
+        return -1;
+    notify(change);
+    
+    return 0;
 }
 
-int cmpFilePath(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
-{
-    playerLogDebug("\n");
-    return ((x.second).Path).compare((y.second).Path);
-}
 
-int cmpFileType(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
+int MappingPlayList::updateItemToPlayListMap(PlayListItemS* playListItem)
 {
-    playerLogDebug("\n");
-    return ((x.second).Type).compare((y.second).Type);
+    PlayListChange change;
+    int ret;
+    
+    ThreadMutexLock(m_mutex);
+    ret = m_playList->update(*playListItem);
+    if (ret == 0)
+        makeChange(PlayListChange_Updated, m_playList->positionOf(playListItem->Name), &change);
+    ThreadMutexUnLock(m_mutex);
+    if (ret < 0) {
+        playerLogError("Cannot find PlayList Item[%s].\n", playListItem->Name.c_str());
+        return -1;
+    }
+    notify(change);
+    
+    return 0;
 }
 
-int cmpFileSize(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
-{
-    return ((x.second).Size).compare((y.second).Size);
-}
 
-int cmpAddTime(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
+int MappingPlayList::deleteItemToPlayListMap(std::string& name, PlayListItemS& playListItem)
 {
-    playerLogDebug("\n");
-    return ((x.second).AddTime).compare((y.second).AddTime);
+    const PlayListItemView* item;
+    PlayListChange change;
+    
+    ThreadMutexLock(m_mutex);
+    item = m_playList->find(name);
+    if(item == NULL){
+        ThreadMutexUnLock(m_mutex);
+        playerLogError("Cannot find PlayList Item[%s].\n", name.c_str());
+        return -1;
+    }
+    PlayListItemViewCopy(playListItem, *item);
+    makeChange(PlayListChange_Removed, m_playList->positionOf(name), &change);
+    m_playList->erase(name);
+    change.size--;
+    ThreadMutexUnLock(m_mutex);
+    notify(change);
+    
+    return 0;
 }
 
-int cmpPlayDuration(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
-{
-    playerLogDebug("\n");
-    return ((x.second).Duration).compare((y.second).Duration);
-}
 
-int cmpSinger(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
+int MappingPlayList::sortPlayListByField(int sortField, int order)   //升序排列 ascending order 按降序排 descending order
 {
-    playerLogDebug("\n");
-    return ((x.second).Singer).compare((y.second).Singer);
+    PlayListSortKey key;
+    
+    key.field = sortField;
+    key.order = order;
+    return sortPlayListByKeys(&key, 1);
 }
 
-int cmpRandomValue(const std::pair<std::string, PlayListItemS> &x, const std::pair<std::string, PlayListItemS> &y)
+
+int MappingPlayList::sortPlayListByKeys(const PlayListSortKey* keys, int count)
 {
+    int ret;
+    
     playerLogDebug("\n");
-    return ((x.second).RandomValue - (y.second).RandomValue);
+    ThreadMutexLock(m_mutex);
+    ret = m_playList->sort(keys, count);
+    ThreadMutexUnLock(m_mutex);
+    if (ret < 0)
+        playerLogError("sortPlayListByKeys, count[%d] field[%d] order[%d] ERROR.\n", count, (count > 0) ? keys[0].field : -1, (count > 0) ? keys[0].order : -1);
+    else
+        notifyReset();
+    
+    return ret;
 }
 
 
-int MappingPlayList::sortPlayListByField(int sortField, int order)   //升序排列 ascending order 按降序排 descending order
+/**
+ *  @Func: copyItemAt
+ *         ps. :按列表位置(从 0 开始)拷贝条目，O(log n)
+ *  @Param: position, type:: int
+ *  @Param: playListItem, type:: PlayListItemS&
+ *  @Return: int, 0 成功，-1 超出范围
+ *  
+ **/
+int MappingPlayList::copyItemAt(int position, PlayListItemS& playListItem)
 {
-    std::vector< std::pair<std::string, PlayListItemS> > t_vec;
+    const PlayListItemView* item;
     
-    playerLogDebug("\n");
-    for(std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.begin(); iter != m_playListMap.end(); iter ++) {
-        t_vec.push_back(make_pair(iter->first, iter->second));
-    }
-    
-    switch(order){
-    case SortOrder_Ascending:  //升序排列
-        switch(sortField){
-        case SortField_FileName:
-            sort(t_vec.begin(), t_vec.end(), cmpFileName);
-            break;
-        case SortField_FilePath:
-            sort(t_vec.begin(), t_vec.end(), cmpFilePath);
-            break;
-        case SortField_FileType:
-            sort(t_vec.begin(), t_vec.end(), cmpFileType);
-            break;
-        case SortField_FileSize:
-            sort(t_vec.begin(), t_vec.end(), cmpFileSize);
-            break;
-        case SortField_AddTime:
-            sort(t_vec.begin(), t_vec.end(), cmpAddTime);
-            break;
-        case SortField_PlayDuration:
-            sort(t_vec.begin(), t_vec.end(), cmpPlayDuration);
-            break;
-        case SortField_Singer:
-            sort(t_vec.begin(), t_vec.end(), cmpSinger);
-            break;
-        default:
-            break;
-        }
-        break;
-        
-    case SortOrder_Descending:  //按降序排
-        switch(sortField){
-        case SortField_FileName:
-            sort(t_vec.end(), t_vec.begin(), cmpFileName);
-            break;
-        case SortField_FilePath:
-            sort(t_vec.end(), t_vec.begin(), cmpFilePath);
-            break;
-        case SortField_FileType:
-            sort(t_vec.end(), t_vec.begin(), cmpFileType);
-            break;
-        case SortField_FileSize:
-            sort(t_vec.end(), t_vec.begin(), cmpFileSize);
-            break;
-        case SortField_AddTime:
-            sort(t_vec.end(), t_vec.begin(), cmpAddTime);
-            break;
-        case SortField_PlayDuration:
-            sort(t_vec.end(), t_vec.begin(), cmpPlayDuration);
-            break;
-        case SortField_Singer:
-            sort(t_vec.end(), t_vec.begin(), cmpSinger);
-            break;
-        default:
-            break;
-        } 
-        break;
-    case SortOrder_Random:  //按随机序排
-        sort(t_vec.begin(), t_vec.end(), cmpRandomValue);  //吧随机数按升序排列
-        break;
-    default:  //其他
-        break;
-    }
+    ThreadMutexLock(m_mutex);
+    item = m_playList->at(position);
+    if (item)
+        PlayListItemViewCopy(playListItem, *item);
+    ThreadMutexUnLock(m_mutex);
     
-    playerLogDebug("\n");
-    return 0;
+    return item ? 0 : -1;
 }
 
 
-int copyPlayListItem(PlayListItemS& playItemOut, PlayListItemS& playItemIn)
+int MappingPlayList::getFirstItem(PlayListItemS& playListItem)
 {
     playerLogDebug("\n");
     
-    playItemOut.Name = playItemIn.Name;
-    playItemOut.Path = playItemIn.Path;
-    playItemOut.Type = playItemIn.Type;
-    playItemOut.Size = playItemIn.Size;
-    playItemOut.AddTime = playItemIn.AddTime;
-    playItemOut.Duration = playItemIn.Duration;
-    playItemOut.LastPlayPosition = playItemIn.LastPlayPosition;
-    playItemOut.Singer = playItemIn.Singer;
-    playItemOut.AVinfo = playItemIn.AVinfo;
-
-    return 0;
+    return copyItemAt(0, playListItem);
 }
 
-/*
-    std::string Name;               //primary key 文件名称
-    std::string Path;               //文件所在路径
-    std::string Type;               //文件类型,后缀名
-    std::string Size;               //文件大小
-    std::string AddTime;            //添加到列表的时间
-    std::string Duration;           //文件播放时长
-    std::string LastPlayPosition;   //记录上次播放位置
-    
-    std::string Singer;
-*/
-int MappingPlayList::getFirstItem(PlayListItemS& playListItem)
+
+int MappingPlayList::getLastItem(PlayListItemS& playListItem)
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.begin();
+    const PlayListItemView* item;
     
     playerLogDebug("\n");
-    copyPlayListItem(playListItem, iter->second);
+    ThreadMutexLock(m_mutex);
+    item = m_playList->at(m_playList->size() - 1);
+    if (item)
+        PlayListItemViewCopy(playListItem, *item);
+    ThreadMutexUnLock(m_mutex);
     
-    return 0;
+    return item ? 0 : -1;
 }
 
 
-int MappingPlayList::getLastItem(PlayListItemS& playListItem)
+int MappingPlayList::setCurrentPlayingItem(std::string name)
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.end();
-    
-    playerLogDebug("\n");
-    iter--;
-    copyPlayListItem(playListItem, iter->second);
+    PlayListChange previous, current;
+    int position, ret;
+    
+    previous.index = 0;
+    ThreadMutexLock(m_mutex);
+    position = m_playList->currentPosition();
+    ret = m_playList->setCurrent(name);
+    if (ret == 0) {
+        if (position >= 0 && position != m_playList->currentPosition())
+            makeChange(PlayListChange_Updated, position, &previous);   //原来的条目 IsCurrentPlaying 也变了
+        makeChange(PlayListChange_Updated, m_playList->currentPosition(), &current);
+    }
+    ThreadMutexUnLock(m_mutex);
+    if (ret < 0) {
+        playerLogError("Cannot find PlayList Item[%s].\n", name.c_str());
+        return -1;
+    }
+    if (previous.index > 0)
+        notify(previous);
+    notify(current);
     
     return 0;
 }
@@ -511,16 +491,15 @@ int MappingPlayList::getLastItem(PlayListItemS& playListItem)
 
 int MappingPlayList::getCurrentPlayingItem(PlayListItemS& playListItem)
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.begin();
+    const PlayListItemView* item;
     
     playerLogDebug("\n");
-    for( ;iter != m_playListMap.end(); iter++){
-        if((iter->second).IsCurrentPlaying == 1){
-            copyPlayListItem(playListItem, iter->second);
-            break;
-        }
-    }
-    if(iter == m_playListMap.end()){
+    ThreadMutexLock(m_mutex);
+    item = m_playList->current();
+    if (item)
+        PlayListItemViewCopy(playListItem, *item);
+    ThreadMutexUnLock(m_mutex);
+    if(item == NULL){
         playerLogError("Can not find Item is Playing.\n");
         return -1;
     }
@@ -531,101 +510,214 @@ int MappingPlayList::getCurrentPlayingItem(PlayListItemS& playListItem)
 
 int MappingPlayList::getNextByItem(std::string name, PlayListItemS& playListItem)
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.find(name);
+    int position;
     
     playerLogDebug("\n");
-    iter++;
-    copyPlayListItem(playListItem, iter->second);
+    ThreadMutexLock(m_mutex);
+    position = m_playList->positionOf(name);
+    ThreadMutexUnLock(m_mutex);
+    if (position < 0) {
+        playerLogError("Cannot find PlayList Item[%s].\n", name.c_str());
+        return -1;
+    }
 
-    return 0;
+    return copyItemAt(position + 1, playListItem);
 }
 
 
 int MappingPlayList::getPreviousByItem(std::string name, PlayListItemS& playListItem)
 {
-    std::map<std::string, PlayListItemS>::iterator iter = m_playListMap.find(name);
+    int position;
     
     playerLogDebug("\n");
-    iter--;
-    copyPlayListItem(playListItem, iter->second);
+    ThreadMutexLock(m_mutex);
+    position = m_playList->positionOf(name);
+    ThreadMutexUnLock(m_mutex);
+    if (position <= 0) {
+        playerLogError("PlayList Item[%s] has no previous.\n", name.c_str());
+        return -1;
+    }
     
-    return 0;
+    return copyItemAt(position - 1, playListItem);
 }
 
 
-
-int MappingPlayList::getItemByListIndex(int index, PlayListItemS& playListItem)
+int MappingPlayList::getItemByListIndex(int index, PlayListItemS& playListItem)   //index 从 1 开始
 {
-    std::map<std::string, PlayListItemS>::iterator iter;
-    int i = 0;
-    
     playerLogDebug("\n");
-    if(index <= 0 || index > m_playListMap.size()){
-        printf("getItemByListIndex error.\n");
+    if(copyItemAt(index - 1, playListItem) < 0){
+        playerLogError("getItemByListIndex index[%d] error.\n", index);
         return -1;
     }
-    for(iter = m_playListMap.begin(); iter != m_playListMap.end(); ) {
-        i ++;
-        iter ++;
-        if(index == i){
-            copyPlayListItem(playListItem, iter->second);
-            break;
-        }
-    }
     
     return 0;
 }
 
 
-
-
-int MappingPlayList::formatingListItemOutput()
+int MappingPlayList::getListIndexByName(std::string name)
 {
-    playerLogDebug("\n");
-    std::map<std::string, PlayListItemS>::iterator iter;
-    for(iter = m_playListMap.begin(); iter != m_playListMap.end(); iter ++) {
-        ;
-    }
-
-    return 0;
+    int position;
+    
+    ThreadMutexLock(m_mutex);
+    position = m_playList->positionOf(name);
+    ThreadMutexUnLock(m_mutex);
+    
+    return (position < 0) ? -1 : position + 1;
 }
 
 
-int MappingPlayList::playListMapOutput()
+/**
+ *  @Func: getPlayListWindow
+ *         ps. :取 index 开始的 count 个条目的视图，O(log n + count)，不拷贝字符串；视图中的字符串在
+ *               unloadPlayListMap() 之前一直有效，条目删除、修改后也可以读
+ *  @Param: index, type:: int, 从 1 开始
+ *  @Param: count, type:: int
+ *  @Param: views, type:: std::vector<PlayListItemView>&
+ *  @Param: version, type:: unsigned int*, 可以为 NULL；返回取窗口时的列表版本，与变化通知中的 version 对应
+ *  @Return: int, 取到的条目数
+ *  
+ **/
+int MappingPlayList::getPlayListWindow(int index, int count, std::vector<PlayListItemView>& views, unsigned int* version)
 {
-    playerLogDebug("\n");
-    std::multimap<std::string, PlayListItemS>::iterator it;
+    int ret;
     
-    for(it = m_playListMap.begin(); it != m_playListMap.end(); ++it){
-        std::cout << "playListMapOutput:: key:"<< it->first << " Name:" << (it->second).Name << " Path:" << (it->second).Path << " Type:" << (it->second).Type << " Size:" << (it->second).Size;
-        std::cout << " AddTime: " << (it->second).AddTime << " LastPlayPosition:" << (it->second).LastPlayPosition <<std::endl;
-    }
+    ThreadMutexLock(m_mutex);
+    ret = m_playList->getWindow(index - 1, count, views);
+    if (version)
+        *version = m_version;
+    ThreadMutexUnLock(m_mutex);
     
-    return 0;
+    return ret;
 }
 
 
+int MappingPlayList::addChangeListener(PlayListChangeCallback callback, void* userData)
+{
+    if (callback == NULL)
+        return -1;
+    ThreadMutexLock(m_mutex);
+    m_listeners.push_back(std::make_pair(callback, userData));
+    ThreadMutexUnLock(m_mutex);
+    
+    return 0;
+}
 
 
+int MappingPlayList::removeChangeListener(PlayListChangeCallback callback, void* userData)
+{
+    std::vector< std::pair<PlayListChangeCallback, void*> >::iterator it;
+    int ret = -1;
+    
+    ThreadMutexLock(m_mutex);
+    it = std::find(m_listeners.begin(), m_listeners.end(), std::make_pair(callback, userData));
+    if (it != m_listeners.end()) {
+        m_listeners.erase(it);
+        ret = 0;
+    }
+    ThreadMutexUnLock(m_mutex);
+    
+    return ret;
+}
 
 
+/* 加锁时调用：版本加一，position 从 0 开始 */
+void MappingPlayList::makeChange(int type, int position, PlayListChange* change)
+{
+    change->type = type;
+    change->index = position + 1;
+    change->size = m_playList->size();
+    change->version = ++m_version;
+}
 
 
+/* 解锁后调用，监听者可以在回调中取窗口 */
+void MappingPlayList::notify(const PlayListChange& change)
+{
+    std::vector< std::pair<PlayListChangeCallback, void*> > listeners;
+    size_t i;
+    
+    ThreadMutexLock(m_mutex);
+    listeners = m_listeners;
+    ThreadMutexUnLock(m_mutex);
+    for (i = 0; i < listeners.size(); i++)
+        listeners[i].first(&change, listeners[i].second);
+}
 
 
+void MappingPlayList::notifyReset()
+{
+    PlayListChange change;
+    
+    ThreadMutexLock(m_mutex);
+    makeChange(PlayListChange_Reset, -1, &change);
+    ThreadMutexUnLock(m_mutex);
+    notify(change);
+}
 
 
+int MappingPlayList::getListSize()
+{
+    int size;
+    
+    ThreadMutexLock(m_mutex);
+    size = m_playList->size();
+    ThreadMutexUnLock(m_mutex);
+    
+    return size;
+}
 
 
+static void toListIndexes(std::vector<int>& indexes)
+{
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i]++;
+}
 
+int MappingPlayList::getItemsByDuration(int64_t fromMs, int64_t toMs, std::vector<int>& indexes)
+{
+    ThreadMutexLock(m_mutex);
+    m_playList->findByDuration(fromMs, toMs, indexes);
+    ThreadMutexUnLock(m_mutex);
+    toListIndexes(indexes);
+    
+    return (int)indexes.size();
+}
 
 
+int MappingPlayList::getItemsByAddTime(const std::string& from, const std::string& to, std::vector<int>& indexes)
+{
+    ThreadMutexLock(m_mutex);
+    m_playList->findByAddTime(PlayListParseAddTime(from), PlayListParseAddTime(to), indexes);
+    ThreadMutexUnLock(m_mutex);
+    toListIndexes(indexes);
+    
+    return (int)indexes.size();
+}
 
 
 
 
+int MappingPlayList::formatingListItemOutput()
+{
+    playerLogDebug("\n");
 
+    return 0;
+}
 
 
-
-
+int MappingPlayList::playListMapOutput()
+{
+    playerLogDebug("\n");
+    const PlayListItemView* item;
+    int i;
+    
+    ThreadMutexLock(m_mutex);
+    for(i = 0; i < m_playList->size(); i++){
+        item = m_playList->at(i);
+        std::cout << "playListMapOutput:: index:"<< i + 1 << " Name:" << item->Name << " Path:" << item->Path << " Type:" << item->Type << " Size:" << item->Size;
+        std::cout << " AddTime: " << item->AddTime << " LastPlayPosition:" << item->LastPlayPosition <<std::endl;
+    }
+    ThreadMutexUnLock(m_mutex);
+    
+    return 0;
+}
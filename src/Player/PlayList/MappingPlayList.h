@@ -3,9 +3,10 @@
 
 #ifdef __cplusplus
 
+#include <stdint.h>
 #include <string>
 #include <vector>
-#include <map>
+#include <utility>
 
 #include "ThreadMutex.h"
 
@@ -123,6 +124,29 @@ playlist 格式：
     6,type,0,iscurrent,1,filename,[阳光电影www.ygdy8.com].暗夜逐仇.BD.720p.中英双字幕.rmvb
 */
 
+class PlayListIndex;
+struct _PlayListSortKey;
+struct _PlayListItemView;
+
+/* 列表变化的通知：界面只需要重新取受影响的窗口 */
+enum _PlayListChangeType{
+    PlayListChange_Inserted,    //index 处插入一条，后面的条目 index 加一
+    PlayListChange_Removed,     //index 处删除一条，后面的条目 index 减一
+    PlayListChange_Updated,     //index 处的条目内容变化，包括 IsCurrentPlaying
+    PlayListChange_Reset,       //排序、加载、清空，顺序全部变化
+    PlayListChange_Max
+};
+
+typedef struct _PlayListChange {
+    int             type;           //_PlayListChangeType
+    int             index;          //从 1 开始，Reset 时为 0
+    int             size;           //变化后的列表长度
+    unsigned int    version;        //每次变化加一，与 getPlayListWindow 返回的 version 对应
+} PlayListChange;
+
+/* 在发生变化的线程中调用，调用时没有加锁，可以在回调中取窗口 */
+typedef void (*PlayListChangeCallback)(const PlayListChange* change, void* userData);
+
 class MappingPlayList { /* 在内存中维护对配置文件中参数的键值对的拷贝 */
     public:
         MappingPlayList();
@@ -131,28 +155,53 @@ class MappingPlayList { /* 在内存中维护对配置文件中参数的键值
         bool addPlayListFile(std::string file);
         bool deletePlayListFile(std::string file);
         
-        int loadPlayListMap();     //将 m_cfgPlayingFileList 中配置文件里的键值对加载到 m_playListMap
+        int loadPlayListMap();     //将 m_cfgPlayingFileList 中配置文件里的键值对加载到 m_playList
         int unloadPlayListMap();
         int savePlayListMapFormating();
         
         int addItemToPlayListMap(PlayListItemS* playListItem);  //在每次将修改信息写入到 m_fileName 文件后，更新内存中的配置文件拷贝 m_paramConfigFileMap ，
+        int insertItemToPlayListMap(int index, PlayListItemS* playListItem);   //index 从 1 开始
+        int updateItemToPlayListMap(PlayListItemS* playListItem);   //按 Name 找到条目，更新其他字段，位置不变
         int deleteItemToPlayListMap(std::string& name, PlayListItemS& playListItem);
-        int sortPlayListByField(int sortField, int order) ;   //按比较项目排序,排序后输出到另一种容器
+        int sortPlayListByField(int sortField, int order) ;   //按比较项目排序，稳定排序，相等的条目保持上次排序的先后
+        int sortPlayListByKeys(const struct _PlayListSortKey* keys, int count);     //多级排序，前面的 key 优先
         
         int getFirstItem(PlayListItemS& playListItem);
         int getLastItem(PlayListItemS& playListItem);
+        int setCurrentPlayingItem(std::string name);
         int getCurrentPlayingItem(PlayListItemS& playListItem);   //获取当前播放文件
         
-        int getNextByItem(std::string name, PlayListItemS& playListItem);
+        int getNextByItem(std::string name, PlayListItemS& playListItem);       //按当前的列表顺序
         int getPreviousByItem(std::string name, PlayListItemS& playListItem);
-        int getItemByListIndex(int index, PlayListItemS& playListItem);
+        int getItemByListIndex(int index, PlayListItemS& playListItem);         //index 从 1 开始，O(log n)
+        int getListIndexByName(std::string name);                               //-1 不存在
+        int getListSize();
+        
+        /* 界面按窗口取条目的视图，不拷贝字符串；变化通过回调增量通知 */
+        int getPlayListWindow(int index, int count, std::vector<struct _PlayListItemView>& views, unsigned int* version);
+        int addChangeListener(PlayListChangeCallback callback, void* userData);
+        int removeChangeListener(PlayListChangeCallback callback, void* userData);
+        
+        /* 二级索引的范围查询，返回 [from, to] 内条目的 index(从 1 开始) */
+        int getItemsByDuration(int64_t fromMs, int64_t toMs, std::vector<int>& indexes);
+        int getItemsByAddTime(const std::string& from, const std::string& to, std::vector<int>& indexes);   //"2012-Jan-01 08:02:05.481"
         
         int formatingListItemOutput();
         int playListMapOutput();
         
     private:
+        MappingPlayList(const MappingPlayList&);
+        MappingPlayList& operator=(const MappingPlayList&);
+        
+        int copyItemAt(int position, PlayListItemS& playListItem);
+        int addItem(PlayListItemS* playListItem, int position, PlayListChange* change);
+        void makeChange(int type, int position, PlayListChange* change);
+        void notify(const PlayListChange& change);
+        void notifyReset();
         
-        std::map<std::string, PlayListItemS>  m_playListMap;   //保存各个配置文件中的键值对
+        PlayListIndex*      m_playList;         //按列表顺序保存条目，名称、时长、添加时间有二级索引
+        unsigned int        m_version;
+        std::vector< std::pair<PlayListChangeCallback, void*> >     m_listeners;
         std::vector<std::string>    m_cfgPlayingFileList;                  //可能会修改的配置文件列表，在构造时初始化
         std::string         m_outputFileName;
         ThreadMutex_Type    m_mutex;
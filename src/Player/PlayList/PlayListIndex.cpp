@@ -0,0 +1,520 @@
+/**
+ *  PlayListIndex.cpp文件
+ *  播放列表的索引；
+ *  主要有以下部分：
+ *      1. 按列表位置的 treap：节点记录子树大小，按位置取条目、取条目的位置、插入、删除都是 O(log n)
+ *      2. 二级索引：名称(主键)、时长、添加时间，条目增删改时同步更新
+ *      3. 排序：取出全部节点做稳定的多级排序，再按新的顺序 O(n) 重建 treap，二级索引不受影响
+ *      4. 条目的字符串驻留在字符串池中，对外只给视图；按窗口取条目时从窗口起点顺序走 treap
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#include "log/LogC.h"
+#include "../LogPlayer.h"
+
+#ifdef __cplusplus
+};
+#endif  // __cplusplus
+
+#include "PlayListIndex.h"
+
+
+static const char* s_monthNames[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+
+int64_t PlayListParseDuration(const std::string& duration)
+{
+    const char* p = duration.c_str();
+    char* end;
+    int64_t total = 0;
+    int parts = 0, scale;
+
+    for (;;) {
+        if (*p < '0' || *p > '9')
+            return -1;
+        total = total * 60 + strtoll(p, &end, 10);
+        p = end;
+        if (*p != ':')
+            break;
+        if (++parts == 3)
+            return -1;
+        p++;
+    }
+    total *= 1000;
+    if (*p == '.') {
+        for (p++, scale = 100; *p >= '0' && *p <= '9'; p++, scale /= 10)
+            total += (*p - '0') * scale;
+    }
+    return *p ? -1 : total;
+}
+
+int64_t PlayListParseAddTime(const std::string& addTime)
+{
+    char month[4] = { 0 };
+    int year, mon = 0, day, hour = 0, minute = 0, second = 0, ms = 0, i;
+
+    if (sscanf(addTime.c_str(), "%d-%3[A-Za-z0-9]-%d %d:%d:%d.%d", &year, month, &day, &hour, &minute, &second, &ms) < 3)
+        return -1;
+    for (i = 0; i < 12; i++) {
+        if (strcasecmp(month, s_monthNames[i]) == 0)
+            mon = i + 1;
+    }
+    if (mon == 0)
+        mon = atoi(month);
+    if (mon < 1 || mon > 12 || day < 1 || day > 31 || year < 0)
+        return -1;
+    return (((((int64_t)year * 100 + mon) * 100 + day) * 100 + hour) * 100 + minute) * 100000 + second * 1000 + ms;
+}
+
+int64_t PlayListParseSize(const std::string& size)
+{
+    char* end;
+    int64_t value;
+
+    if (size.empty() || size[0] < '0' || size[0] > '9')
+        return -1;
+    value = strtoll(size.c_str(), &end, 10);
+    return *end ? -1 : value;
+}
+
+
+/* 多级比较：前面的 key 相等时才比较后面的 */
+class PlayListCompare {
+    public:
+        PlayListCompare(const PlayListSortKey* keys, int count) : m_keys(keys), m_count(count) {}
+
+        bool operator()(const PlayListNode* x, const PlayListNode* y) const
+        {
+            int i, result;
+
+            for (i = 0; i < m_count; i++) {
+                result = compareField(x, y, m_keys[i].field);
+                if (result != 0)
+                    return (m_keys[i].order == SortOrder_Descending) ? result > 0 : result < 0;
+            }
+            return false;
+        }
+
+    private:
+        static int compareNumber(int64_t x, int64_t y) { return (x < y) ? -1 : (x > y); }
+
+        static int compareField(const PlayListNode* x, const PlayListNode* y, int field)
+        {
+            switch (field) {
+            case SortField_FileName:        return strcmp(x->item.Name, y->item.Name);
+            case SortField_FilePath:        return strcmp(x->item.Path, y->item.Path);
+            case SortField_FileType:        return strcmp(x->item.Type, y->item.Type);
+            case SortField_FileSize:        return compareNumber(x->sizeBytes, y->sizeBytes);
+            case SortField_AddTime:         return compareNumber(x->addTime, y->addTime);
+            case SortField_PlayDuration:    return compareNumber(x->durationMs, y->durationMs);
+            case SortField_Singer:          return strcmp(x->item.Singer, y->item.Singer);
+            default:                        return 0;
+            }
+        }
+
+        const PlayListSortKey*  m_keys;
+        int                     m_count;
+};
+
+
+void PlayListItemViewCopy(PlayListItemS& playItemOut, const PlayListItemView& playItemIn)
+{
+    playItemOut.Name = playItemIn.Name;
+    playItemOut.Path = playItemIn.Path;
+    playItemOut.Type = playItemIn.Type;
+    playItemOut.Size = playItemIn.Size;
+    playItemOut.AddTime = playItemIn.AddTime;
+    playItemOut.Duration = playItemIn.Duration;
+    playItemOut.LastPlayPosition = playItemIn.LastPlayPosition;
+    playItemOut.Singer = playItemIn.Singer;
+    playItemOut.AVinfo = playItemIn.AVinfo;
+    playItemOut.IsCurrentPlaying = playItemIn.IsCurrentPlaying;
+    playItemOut.RandomValue = playItemIn.RandomValue;
+}
+
+
+PlayListIndex::PlayListIndex()
+    : m_root(NULL)
+    , m_current(NULL)
+    , m_seed((uint32_t)time(NULL) | 1)
+{
+}
+
+PlayListIndex::~PlayListIndex()
+{
+    clear();
+}
+
+/* xorshift，不影响 rand() 的序列 */
+uint32_t PlayListIndex::nextPriority()
+{
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+void PlayListIndex::pull(PlayListNode* node)
+{
+    node->count = 1 + count(node->left) + count(node->right);
+    if (node->left)
+        node->left->parent = node;
+    if (node->right)
+        node->right->parent = node;
+}
+
+/* 前 position 个节点分到 left，其余分到 right */
+void PlayListIndex::split(PlayListNode* node, int position, PlayListNode** left, PlayListNode** right)
+{
+    if (!node) {
+        *left = *right = NULL;
+        return;
+    }
+    if (count(node->left) >= position) {
+        split(node->left, position, left, &node->left);
+        *right = node;
+    } else {
+        split(node->right, position - count(node->left) - 1, &node->right, right);
+        *left = node;
+    }
+    pull(node);
+    if (*left)
+        (*left)->parent = NULL;
+    if (*right)
+        (*right)->parent = NULL;
+}
+
+PlayListNode* PlayListIndex::merge(PlayListNode* left, PlayListNode* right)
+{
+    if (!left || !right)
+        return left ? left : right;
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        pull(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    pull(right);
+    return right;
+}
+
+void PlayListIndex::collect(PlayListNode* node, std::vector<PlayListNode*>& nodes)
+{
+    if (!node)
+        return;
+    collect(node->left, nodes);
+    nodes.push_back(node);
+    collect(node->right, nodes);
+}
+
+static void PlayListPullTree(PlayListNode* node)
+{
+    if (!node)
+        return;
+    PlayListPullTree(node->left);
+    PlayListPullTree(node->right);
+    node->count = 1 + (node->left ? node->left->count : 0) + (node->right ? node->right->count : 0);
+    if (node->left)
+        node->left->parent = node;
+    if (node->right)
+        node->right->parent = node;
+}
+
+/* 按 nodes 的顺序和节点原有的优先级建笛卡尔树，O(n) */
+void PlayListIndex::build(const std::vector<PlayListNode*>& nodes)
+{
+    std::vector<PlayListNode*> stack;
+    PlayListNode* last;
+    size_t i;
+
+    for (i = 0; i < nodes.size(); i++) {
+        last = NULL;
+        nodes[i]->left = nodes[i]->right = nodes[i]->parent = NULL;
+        while (!stack.empty() && stack.back()->priority < nodes[i]->priority) {
+            last = stack.back();
+            stack.pop_back();
+        }
+        nodes[i]->left = last;
+        if (!stack.empty())
+            stack.back()->right = nodes[i];
+        stack.push_back(nodes[i]);
+    }
+    m_root = stack.empty() ? NULL : stack[0];
+    PlayListPullTree(m_root);
+    if (m_root)
+        m_root->parent = NULL;
+}
+
+PlayListNode* PlayListIndex::select(int position) const
+{
+    PlayListNode* node = m_root;
+
+    if (position < 0 || position >= size())
+        return NULL;
+    while (node) {
+        if (position < count(node->left)) {
+            node = node->left;
+        } else if (position == count(node->left)) {
+            break;
+        } else {
+            position -= count(node->left) + 1;
+            node = node->right;
+        }
+    }
+    return node;
+}
+
+/* 中序的下一个节点 */
+PlayListNode* PlayListIndex::successor(PlayListNode* node)
+{
+    if (node->right) {
+        for (node = node->right; node->left; node = node->left);
+        return node;
+    }
+    while (node->parent && node == node->parent->right)
+        node = node->parent;
+    return node->parent;
+}
+
+int PlayListIndex::rank(const PlayListNode* node)
+{
+    int position = count(node->left);
+
+    for (; node->parent; node = node->parent) {
+        if (node == node->parent->right)
+            position += count(node->parent->left) + 1;
+    }
+    return position;
+}
+
+/* 字符串放入字符串池，IsCurrentPlaying 由调用者决定 */
+void PlayListIndex::assign(PlayListNode* node, const PlayListItemS& item)
+{
+    node->item.Name = m_strings.intern(item.Name);
+    node->item.Path = m_strings.intern(item.Path);
+    node->item.Type = m_strings.intern(item.Type);
+    node->item.Size = m_strings.intern(item.Size);
+    node->item.AddTime = m_strings.intern(item.AddTime);
+    node->item.Duration = m_strings.intern(item.Duration);
+    node->item.LastPlayPosition = m_strings.intern(item.LastPlayPosition);
+    node->item.Singer = m_strings.intern(item.Singer);
+    node->item.AVinfo = m_strings.intern(item.AVinfo);
+    node->item.RandomValue = item.RandomValue;
+    parseKeys(node);
+}
+
+void PlayListIndex::parseKeys(PlayListNode* node)
+{
+    node->durationMs = PlayListParseDuration(node->item.Duration);
+    node->addTime = PlayListParseAddTime(node->item.AddTime);
+    node->sizeBytes = PlayListParseSize(node->item.Size);
+}
+
+void PlayListIndex::eraseKey(KeyIndex& index, int64_t key, PlayListNode* node)
+{
+    std::pair<KeyIndex::iterator, KeyIndex::iterator> range = index.equal_range(key);
+    KeyIndex::iterator it;
+
+    for (it = range.first; it != range.second; ++it) {
+        if (it->second == node) {
+            index.erase(it);
+            return;
+        }
+    }
+}
+
+
+int PlayListIndex::insert(const PlayListItemS& item, int position)
+{
+    PlayListNode* node;
+    PlayListNode* left;
+    PlayListNode* right;
+
+    if (m_names.find(item.Name.c_str()) != m_names.end()) {
+        playerLogWarning("PlayList item[%s] already exists.\n", item.Name.c_str());
+        return -1;
+    }
+    if (position < 0 || position > size())
+        position = size();
+
+    node = new PlayListNode;
+    assign(node, item);
+    node->item.IsCurrentPlaying = 0;
+    node->left = node->right = node->parent = NULL;
+    node->priority = nextPriority();
+    node->count = 1;
+
+    split(m_root, position, &left, &right);
+    m_root = merge(merge(left, node), right);
+    m_root->parent = NULL;
+
+    m_names[node->item.Name] = node;
+    m_durations.insert(std::make_pair(node->durationMs, node));
+    m_addTimes.insert(std::make_pair(node->addTime, node));
+    if (item.IsCurrentPlaying)
+        setCurrent(item.Name);
+    return position;
+}
+
+int PlayListIndex::erase(const std::string& name)
+{
+    NameIndex::iterator it = m_names.find(name.c_str());
+    PlayListNode* node;
+    PlayListNode* left;
+    PlayListNode* middle;
+    PlayListNode* right;
+
+    if (it == m_names.end())
+        return -1;
+    node = it->second;
+    split(m_root, rank(node), &left, &middle);
+    split(middle, 1, &middle, &right);
+    m_root = merge(left, right);
+    if (m_root)
+        m_root->parent = NULL;
+
+    m_names.erase(it);
+    eraseKey(m_durations, node->durationMs, node);
+    eraseKey(m_addTimes, node->addTime, node);
+    if (m_current == node)
+        m_current = NULL;
+    delete node;
+    return 0;
+}
+
+int PlayListIndex::update(const PlayListItemS& item)
+{
+    NameIndex::iterator it = m_names.find(item.Name.c_str());
+    PlayListNode* node;
+
+    if (it == m_names.end())
+        return -1;
+    node = it->second;
+    eraseKey(m_durations, node->durationMs, node);
+    eraseKey(m_addTimes, node->addTime, node);
+    assign(node, item);
+    m_durations.insert(std::make_pair(node->durationMs, node));
+    m_addTimes.insert(std::make_pair(node->addTime, node));
+    return 0;
+}
+
+void PlayListIndex::clear()
+{
+    std::vector<PlayListNode*> nodes;
+    size_t i;
+
+    collect(m_root, nodes);
+    for (i = 0; i < nodes.size(); i++)
+        delete nodes[i];
+    m_root = NULL;
+    m_current = NULL;
+    m_names.clear();
+    m_durations.clear();
+    m_addTimes.clear();
+    m_strings.clear();
+}
+
+const PlayListItemView* PlayListIndex::at(int position) const
+{
+    PlayListNode* node = select(position);
+
+    return node ? &node->item : NULL;
+}
+
+const PlayListItemView* PlayListIndex::find(const std::string& name) const
+{
+    NameIndex::const_iterator it = m_names.find(name.c_str());
+
+    return (it == m_names.end()) ? NULL : &it->second->item;
+}
+
+int PlayListIndex::positionOf(const std::string& name) const
+{
+    NameIndex::const_iterator it = m_names.find(name.c_str());
+
+    return (it == m_names.end()) ? -1 : rank(it->second);
+}
+
+int PlayListIndex::getWindow(int start, int count, std::vector<PlayListItemView>& views) const
+{
+    PlayListNode* node = select(start);
+
+    views.clear();
+    for (; node && count > 0; node = successor(node), count--)
+        views.push_back(node->item);
+    return (int)views.size();
+}
+
+int PlayListIndex::setCurrent(const std::string& name)
+{
+    NameIndex::iterator it = m_names.find(name.c_str());
+
+    if (it == m_names.end())
+        return -1;
+    if (m_current)
+        m_current->item.IsCurrentPlaying = 0;
+    m_current = it->second;
+    m_current->item.IsCurrentPlaying = 1;
+    return 0;
+}
+
+int PlayListIndex::sort(const PlayListSortKey* keys, int count)
+{
+    std::vector<PlayListNode*> nodes;
+    size_t i, j;
+    int k;
+
+    if (count <= 0 || count > PLAYLIST_SORT_KEYS_MAX)
+        return -1;
+    for (k = 0; k < count; k++) {
+        if (keys[k].order <= SortOrder_Reserved || keys[k].order >= SortOrder_Max)
+            return -1;
+        if (keys[k].order != SortOrder_Random && (keys[k].field <= SortField_Reserved || keys[k].field >= SortField_Max))
+            return -1;
+    }
+
+    nodes.reserve(size());
+    collect(m_root, nodes);
+    if (keys[0].order == SortOrder_Random) {
+        for (i = nodes.size(); i > 1; i--) {
+            j = nextPriority() % i;
+            std::swap(nodes[i - 1], nodes[j]);
+        }
+    } else {
+        std::stable_sort(nodes.begin(), nodes.end(), PlayListCompare(keys, count));
+    }
+    build(nodes);
+    return 0;
+}
+
+void PlayListIndex::findByKey(const KeyIndex& index, int64_t from, int64_t to, std::vector<int>& positions) const
+{
+    KeyIndex::const_iterator it;
+
+    positions.clear();
+    for (it = index.lower_bound(from); it != index.end() && it->first <= to; ++it)
+        positions.push_back(rank(it->second));
+}
+
+int PlayListIndex::findByDuration(int64_t fromMs, int64_t toMs, std::vector<int>& positions) const
+{
+    findByKey(m_durations, fromMs, toMs, positions);
+    return (int)positions.size();
+}
+
+int PlayListIndex::findByAddTime(int64_t from, int64_t to, std::vector<int>& positions) const
+{
+    findByKey(m_addTimes, from, to, positions);
+    return (int)positions.size();
+}
@@ -0,0 +1,160 @@
+#ifndef __PLAY_LIST_INDEX_H__
+#define __PLAY_LIST_INDEX_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "MappingPlayList.h"
+#include "PlayListStringPool.h"
+
+
+#define     PLAYLIST_SORT_KEYS_MAX      4
+
+
+typedef struct _PlayListSortKey {
+    int             field;              //_SortField
+    int             order;              //_SortOrder，SortOrder_Random 时忽略其他的 key，打乱整个列表
+} PlayListSortKey;
+
+/* 排序和二级索引使用的数值，解析失败为 -1 */
+int64_t PlayListParseDuration(const std::string& duration);    //"01:02:05.481"、"02:05"、"125" -> 毫秒
+int64_t PlayListParseAddTime(const std::string& addTime);      //"2012-Jan-01 08:02:05.481" -> 20120101080205481
+int64_t PlayListParseSize(const std::string& size);
+
+
+/* PlayListItemS 的轻量视图：字符串驻留在 PlayListIndex 的字符串池中，拷贝视图不拷贝字符串；
+   条目删除、修改后旧的视图仍然可以读，直到 clear() */
+typedef struct _PlayListItemView {
+    const char*     Name;
+    const char*     Path;
+    const char*     Type;
+    const char*     Size;
+    const char*     AddTime;
+    const char*     Duration;
+    const char*     LastPlayPosition;
+    const char*     Singer;
+    const char*     AVinfo;
+    int             IsCurrentPlaying;
+    int             RandomValue;
+} PlayListItemView;
+
+void PlayListItemViewCopy(PlayListItemS& playItemOut, const PlayListItemView& playItemIn);
+
+
+typedef struct _PlayListNode {
+    PlayListItemView        item;
+    int64_t                 durationMs;
+    int64_t                 addTime;
+    int64_t                 sizeBytes;
+
+    /* 按列表位置的 treap，count 为子树的节点数 */
+    struct _PlayListNode*   left;
+    struct _PlayListNode*   right;
+    struct _PlayListNode*   parent;
+    uint32_t                priority;
+    int                     count;
+} PlayListNode;
+
+
+class PlayListIndex { /* 播放列表：按位置的顺序统计树，按位置、名称取条目都是 O(log n)；名称、时长、添加时间有二级索引 */
+    public:
+        PlayListIndex();
+        ~PlayListIndex();
+
+        /**
+         *  @Func: insert
+         *         ps. :名称是主键，重复时失败
+         *  @Param: item, type:: const PlayListItemS&
+         *  @Param: position, type:: int, 从 0 开始，-1 或者超过列表长度时加在最后
+         *  @Return: int, 插入的位置，-1 失败
+         *
+         **/
+        int insert(const PlayListItemS& item, int position);
+        int erase(const std::string& name);
+        int update(const PlayListItemS& item);      //按名称找到条目，更新其他字段和二级索引，位置不变
+        void clear();
+
+        int size() const { return m_root ? m_root->count : 0; }
+        const PlayListItemView* at(int position) const;         //从 0 开始，超出范围返回 NULL
+        const PlayListItemView* find(const std::string& name) const;
+        int positionOf(const std::string& name) const;          //-1 不存在
+
+        /**
+         *  @Func: getWindow
+         *         ps. :取 [start, start + count) 的视图，O(log n + count)，与列表长度基本无关
+         *  @Param: start, type:: int, 从 0 开始
+         *  @Param: count, type:: int
+         *  @Param: views, type:: std::vector<PlayListItemView>&, 超出列表的部分不返回
+         *  @Return: int, 取到的条目数
+         *
+         **/
+        int getWindow(int start, int count, std::vector<PlayListItemView>& views) const;
+
+        int setCurrent(const std::string& name);
+        const PlayListItemView* current() const { return m_current ? &m_current->item : NULL; }
+        int currentPosition() const { return m_current ? rank(m_current) : -1; }
+
+        int stringCount() const { return m_strings.count(); }
+        int64_t stringBytes() const { return m_strings.bytes(); }
+
+        /**
+         *  @Func: sort
+         *         ps. :稳定排序，前面的 key 优先，所有 key 都相等的条目保持原来的先后顺序，所以连续两次排序
+         *               相当于后一次为主、前一次为次的多级排序
+         *  @Param: keys, type:: const PlayListSortKey*
+         *  @Param: count, type:: int, 不超过 PLAYLIST_SORT_KEYS_MAX
+         *  @Return: int, 0 成功，-1 参数错误
+         *
+         **/
+        int sort(const PlayListSortKey* keys, int count);
+
+        /* 二级索引的范围查询：[from, to] 内的条目位置，按 key 的顺序 */
+        int findByDuration(int64_t fromMs, int64_t toMs, std::vector<int>& positions) const;
+        int findByAddTime(int64_t from, int64_t to, std::vector<int>& positions) const;
+
+    private:
+        PlayListIndex(const PlayListIndex&);
+        PlayListIndex& operator=(const PlayListIndex&);
+
+        struct NameLess {
+            bool operator()(const char* x, const char* y) const { return strcmp(x, y) < 0; }
+        };
+        typedef std::map<const char*, PlayListNode*, NameLess>  NameIndex;
+        typedef std::multimap<int64_t, PlayListNode*>   KeyIndex;
+
+        uint32_t nextPriority();
+        static int count(const PlayListNode* node) { return node ? node->count : 0; }
+        static void pull(PlayListNode* node);
+        static void split(PlayListNode* node, int position, PlayListNode** left, PlayListNode** right);
+        static PlayListNode* merge(PlayListNode* left, PlayListNode* right);
+        static void collect(PlayListNode* node, std::vector<PlayListNode*>& nodes);
+        void build(const std::vector<PlayListNode*>& nodes);
+        PlayListNode* select(int position) const;
+        static int rank(const PlayListNode* node);
+        static PlayListNode* successor(PlayListNode* node);
+        void assign(PlayListNode* node, const PlayListItemS& item);
+
+        static void parseKeys(PlayListNode* node);
+        static void eraseKey(KeyIndex& index, int64_t key, PlayListNode* node);
+        void findByKey(const KeyIndex& index, int64_t from, int64_t to, std::vector<int>& positions) const;
+
+        PlayListNode*               m_root;
+        PlayListNode*               m_current;
+        uint32_t                    m_seed;
+        PlayListStringPool          m_strings;
+        NameIndex                   m_names;
+        KeyIndex                    m_durations;
+        KeyIndex                    m_addTimes;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__PLAY_LIST_INDEX_H__
@@ -0,0 +1,74 @@
+/**
+ *  PlayListStringPool.cpp文件
+ *  播放列表条目字符串的驻留；
+ *  主要有以下部分：
+ *      1. 按块分配：一个块放很多短字符串，超过块大小的单独分配
+ *      2. 去重：路径、类型、歌手等大量重复的字段只保存一份
+ *
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "PlayListStringPool.h"
+
+
+PlayListStringPool::PlayListStringPool()
+    : m_cursor(NULL)
+    , m_left(0)
+    , m_bytes(0)
+{
+}
+
+PlayListStringPool::~PlayListStringPool()
+{
+    clear();
+}
+
+const char* PlayListStringPool::intern(const std::string& str)
+{
+    std::set<const char*, Less>::iterator it = m_strings.find(str.c_str());
+    int size = (int)str.size() + 1;
+    char* copy;
+
+    if (it != m_strings.end())
+        return *it;
+    if (size > PLAYLIST_STRING_BLOCK_SIZE / 4) {
+        copy = new char[size];
+        m_blocks.push_back(copy);
+        m_bytes += size;
+    } else {
+        if (size > m_left) {
+            m_cursor = new char[PLAYLIST_STRING_BLOCK_SIZE];
+            m_left = PLAYLIST_STRING_BLOCK_SIZE;
+            m_blocks.push_back(m_cursor);
+            m_bytes += PLAYLIST_STRING_BLOCK_SIZE;
+        }
+        copy = m_cursor;
+        m_cursor += size;
+        m_left -= size;
+    }
+    memcpy(copy, str.c_str(), size);
+    m_strings.insert(copy);
+    return copy;
+}
+
+const char* PlayListStringPool::find(const char* str) const
+{
+    std::set<const char*, Less>::const_iterator it = m_strings.find(str);
+
+    return (it == m_strings.end()) ? NULL : *it;
+}
+
+void PlayListStringPool::clear()
+{
+    size_t i;
+
+    m_strings.clear();
+    for (i = 0; i < m_blocks.size(); i++)
+        delete[] m_blocks[i];
+    m_blocks.clear();
+    m_cursor = NULL;
+    m_left = 0;
+    m_bytes = 0;
+}
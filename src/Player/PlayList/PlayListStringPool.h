@@ -0,0 +1,56 @@
+#ifndef __PLAY_LIST_STRING_POOL_H__
+#define __PLAY_LIST_STRING_POOL_H__
+
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string.h>
+#include <set>
+#include <string>
+#include <vector>
+
+
+#define     PLAYLIST_STRING_BLOCK_SIZE      (64 * 1024)
+
+
+class PlayListStringPool { /* 字符串驻留：相同的字符串只保存一份，放在按块分配的内存中，clear() 之前指针一直有效 */
+    public:
+        PlayListStringPool();
+        ~PlayListStringPool();
+
+        /**
+         *  @Func: intern
+         *         ps. :返回池中的拷贝，以 '\0' 结束；已经有相同的字符串时直接返回
+         *  @Param: str, type:: const std::string&
+         *  @Return: const char*
+         *
+         **/
+        const char* intern(const std::string& str);
+        const char* find(const char* str) const;        //不存在时返回 NULL，不分配
+        void clear();
+
+        int count() const { return (int)m_strings.size(); }
+        int64_t bytes() const { return m_bytes; }       //已经分配的块的大小
+
+    private:
+        PlayListStringPool(const PlayListStringPool&);
+        PlayListStringPool& operator=(const PlayListStringPool&);
+
+        struct Less {
+            bool operator()(const char* x, const char* y) const { return strcmp(x, y) < 0; }
+        };
+
+        std::set<const char*, Less>     m_strings;
+        std::vector<char*>              m_blocks;
+        char*                           m_cursor;       //当前块中未使用的部分
+        int                             m_left;
+        int64_t                         m_bytes;
+};
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__PLAY_LIST_STRING_POOL_H__
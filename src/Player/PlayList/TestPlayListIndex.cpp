@@ -0,0 +1,421 @@
+/**
+ *  TestPlayListIndex.cpp文件
+ *  播放列表索引的测试：
+ *          随机位置插入、删除后和 std::vector 的结果比较位置和名称的对应
+ *          多级稳定排序和 std::stable_sort 的结果比较，降序、随机顺序
+ *          时长、添加时间的范围查询和逐个比较的结果比较
+ *          MappingPlayList 按 index、前后条目取条目，大列表上按 index 取条目的时间
+ *          按窗口取视图和 at() 比较，列表从 1k 到 100k 时取一屏的时间；字符串池去重；增删改、排序的变化通知
+ *
+ *  用法：TestPlayListIndex.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "MappingPlayList.h"
+#include "PlayListIndex.h"
+
+
+#define     TEST_ITEMS                  6000
+#define     TEST_LOOKUPS                200000
+#define     TEST_WINDOW                 20          //一屏的条目数
+#define     TEST_WINDOW_FETCHES         20000
+
+
+static int64_t TestNowUs()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static PlayListItemS TestItem(int i)
+{
+    static const char* singers[] = { "Adele", "Beyond", "Coldplay", "Eagles", "Faye" };
+    static const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    PlayListItemS item;
+    char buffer[64];
+
+    snprintf(buffer, sizeof(buffer), "file%05d.mp4", (i * 7919) % 100000);
+    item.Name = buffer;
+    item.Path = "/media";
+    item.Type = "mp4";
+    snprintf(buffer, sizeof(buffer), "%d", (i * 131) % 9973 * 1024);
+    item.Size = buffer;
+    snprintf(buffer, sizeof(buffer), "20%02d-%s-%02d 08:02:05.481", 10 + i % 5, months[i % 12], 1 + i % 28);
+    item.AddTime = buffer;
+    snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03d", i % 3, (i * 7) % 60, (i * 13) % 60, i % 1000);
+    item.Duration = buffer;
+    item.LastPlayPosition = "00:00:00.000";
+    item.Singer = singers[i % 5];
+    item.AVinfo = "";
+    item.IsCurrentPlaying = 0;
+    item.RandomValue = 0;
+    return item;
+}
+
+static bool TestSame(PlayListIndex& index, const std::vector<PlayListItemS>& expected)
+{
+    size_t i;
+
+    if (index.size() != (int)expected.size())
+        return false;
+    for (i = 0; i < expected.size(); i++) {
+        if (index.at((int)i)->Name != expected[i].Name || index.positionOf(expected[i].Name) != (int)i)
+            return false;
+    }
+    return index.at(index.size()) == NULL && index.at(-1) == NULL;
+}
+
+static int TestParse()
+{
+    bool failed;
+
+    failed = PlayListParseDuration("01:02:05.481") != 3725481 || PlayListParseDuration("02:05") != 125000
+            || PlayListParseDuration("125") != 125000 || PlayListParseDuration("1:2:3:4") != -1
+            || PlayListParseDuration("error") != -1 || PlayListParseDuration("") != -1
+            || PlayListParseAddTime("2012-Jan-01 08:02:05.481") != 20120101080205481LL
+            || PlayListParseAddTime("2012-12-31") != 20121231000000000LL || PlayListParseAddTime("ERROR") != -1
+            || PlayListParseSize("1024") != 1024 || PlayListParseSize("error") != -1;
+    printf("[parse] duration, add time, size: %s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+static int TestInsertErase()
+{
+    PlayListIndex index;
+    std::vector<PlayListItemS> expected;
+    int i, position;
+    bool failed = false;
+
+    for (i = 0; i < TEST_ITEMS; i++) {
+        position = (i % 3 == 0) ? -1 : rand() % (int)(expected.size() + 1);
+        PlayListItemS item = TestItem(i);
+        if (index.insert(item, position) < 0) {
+            failed = true;
+            break;
+        }
+        if (position < 0)
+            expected.push_back(item);
+        else
+            expected.insert(expected.begin() + position, item);
+    }
+    failed = failed || index.insert(TestItem(0), 0) >= 0 || !TestSame(index, expected);
+
+    for (i = 0; i < TEST_ITEMS / 2 && !failed; i++) {
+        position = rand() % (int)expected.size();
+        failed = index.erase(expected[position].Name) < 0;
+        expected.erase(expected.begin() + position);
+    }
+    failed = failed || index.erase("missing") >= 0 || !TestSame(index, expected);
+
+    expected[10].Duration = "09:59:59";
+    failed = failed || index.update(expected[10]) < 0 || strcmp(index.at(10)->Duration, "09:59:59") != 0 || !TestSame(index, expected);
+
+    printf("[insert] %d inserts, %d erases at random positions, size %d: %s\n",
+           TEST_ITEMS, TEST_ITEMS / 2, index.size(), failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+static bool TestBySingerThenName(const PlayListItemS& x, const PlayListItemS& y)
+{
+    if (x.Singer != y.Singer)
+        return x.Singer < y.Singer;
+    return x.Name > y.Name;
+}
+
+/* 先比较 singer，相同时比较 name */
+static int TestCompare(const char* singerX, const char* singerY, const char* nameX, const char* nameY)
+{
+    int result = strcmp(singerX, singerY);
+
+    return result ? result : strcmp(nameX, nameY);
+}
+
+static bool TestByName(const PlayListItemS& x, const PlayListItemS& y)
+{
+    return x.Name < y.Name;
+}
+
+static int TestSort()
+{
+    PlayListIndex index;
+    std::vector<PlayListItemS> expected, shuffled;
+    PlayListSortKey keys[2];
+    bool failed = false;
+    int i, moved = 0;
+
+    for (i = 0; i < TEST_ITEMS; i++) {
+        expected.push_back(TestItem(i));
+        index.insert(expected.back(), -1);
+    }
+
+    //多级排序
+    keys[0].field = SortField_Singer;
+    keys[0].order = SortOrder_Ascending;
+    keys[1].field = SortField_FileName;
+    keys[1].order = SortOrder_Descending;
+    std::stable_sort(expected.begin(), expected.end(), TestBySingerThenName);
+    failed = index.sort(keys, 2) < 0 || !TestSame(index, expected);
+
+    //稳定：先按名称再按歌手，歌手相同的按名称；再按歌手降序，歌手相同的仍按名称升序
+    keys[0].field = SortField_FileName;
+    keys[0].order = SortOrder_Ascending;
+    failed = failed || index.sort(keys, 1) < 0;
+    keys[0].field = SortField_Singer;
+    failed = failed || index.sort(keys, 1) < 0;
+    for (i = 0; i < index.size() - 1 && !failed; i++) {
+        failed = TestCompare(index.at(i)->Singer, index.at(i + 1)->Singer, index.at(i)->Name, index.at(i + 1)->Name) > 0;
+    }
+    keys[0].order = SortOrder_Descending;
+    failed = failed || index.sort(keys, 1) < 0;
+    for (i = 0; i < index.size() - 1 && !failed; i++) {
+        failed = TestCompare(index.at(i + 1)->Singer, index.at(i)->Singer, index.at(i)->Name, index.at(i + 1)->Name) > 0;
+    }
+
+    //数值：时长
+    keys[0].field = SortField_PlayDuration;
+    keys[0].order = SortOrder_Ascending;
+    failed = failed || index.sort(keys, 1) < 0;
+    for (i = 0; i < index.size() - 1 && !failed; i++)
+        failed = PlayListParseDuration(index.at(i)->Duration) > PlayListParseDuration(index.at(i + 1)->Duration);
+
+    //随机：条目不变，顺序改变
+    keys[0].order = SortOrder_Random;
+    failed = failed || index.sort(keys, 1) < 0;
+    for (i = 0; i < index.size(); i++) {
+        shuffled.push_back(PlayListItemS());
+        PlayListItemViewCopy(shuffled.back(), *index.at(i));
+        moved += PlayListParseDuration(shuffled[i].Duration) < PlayListParseDuration(shuffled[(i > 0) ? i - 1 : 0].Duration);
+    }
+    std::sort(shuffled.begin(), shuffled.end(), TestByName);
+    std::sort(expected.begin(), expected.end(), TestByName);
+    failed = failed || moved < TEST_ITEMS / 4;
+    for (i = 0; i < (int)expected.size() && !failed; i++)
+        failed = shuffled[i].Name != expected[i].Name;
+
+    keys[0].field = SortField_Reserved;
+    keys[0].order = SortOrder_Ascending;
+    failed = failed || index.sort(keys, 1) >= 0 || index.sort(keys, 0) >= 0;
+
+    printf("[sort] multi-key, stable, descending, numeric, random on %d items: %s\n", TEST_ITEMS, failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+static int TestRange()
+{
+    PlayListIndex index;
+    std::vector<int> positions, expected;
+    PlayListSortKey key;
+    int64_t from, to, value;
+    bool failed = false;
+    int i;
+
+    for (i = 0; i < TEST_ITEMS; i++)
+        index.insert(TestItem(i), -1);
+    key.field = SortField_Singer;
+    key.order = SortOrder_Ascending;
+    index.sort(&key, 1);
+
+    from = 30 * 60000;
+    to = 90 * 60000;
+    index.findByDuration(from, to, positions);
+    for (i = 0; i < index.size(); i++) {
+        value = PlayListParseDuration(index.at(i)->Duration);
+        if (value >= from && value <= to)
+            expected.push_back(i);
+    }
+    std::sort(positions.begin(), positions.end());
+    failed = positions != expected || positions.empty();
+
+    from = PlayListParseAddTime("2011-Mar-01");
+    to = PlayListParseAddTime("2012-Jun-30 23:59:59.999");
+    index.findByAddTime(from, to, positions);
+    expected.clear();
+    for (i = 0; i < index.size(); i++) {
+        value = PlayListParseAddTime(index.at(i)->AddTime);
+        if (value >= from && value <= to)
+            expected.push_back(i);
+    }
+    std::sort(positions.begin(), positions.end());
+    failed = failed || positions != expected || positions.empty();
+
+    printf("[range] duration and add time indexes: %s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+static int TestMapping()
+{
+    MappingPlayList list;
+    PlayListItemS item, out;
+    std::vector<int> indexes;
+    int64_t startUs, elapsedUs;
+    bool failed = false;
+    int i, sum = 0;
+
+    for (i = 0; i < TEST_ITEMS; i++) {
+        item = TestItem(i);
+        list.addItemToPlayListMap(&item);
+    }
+    list.sortPlayListByField(SortField_FileName, SortOrder_Descending);
+    failed = list.getListSize() != TEST_ITEMS || list.getFirstItem(out) < 0 || out.Name != "file99989.mp4"
+            || list.getItemByListIndex(2, item) < 0 || list.getNextByItem(out.Name, out) < 0 || out.Name != item.Name
+            || list.getPreviousByItem(out.Name, out) < 0 || out.Name != "file99989.mp4"
+            || list.getPreviousByItem(out.Name, out) >= 0 || list.getLastItem(out) < 0
+            || list.getNextByItem(out.Name, out) >= 0 || list.getListIndexByName(out.Name) != TEST_ITEMS
+            || list.getItemByListIndex(0, out) >= 0 || list.getItemByListIndex(TEST_ITEMS + 1, out) >= 0
+            || list.getCurrentPlayingItem(out) >= 0 || list.setCurrentPlayingItem(item.Name) < 0
+            || list.getCurrentPlayingItem(out) < 0 || out.Name != item.Name
+            || list.getItemsByDuration(0, 59999, indexes) <= 0;
+
+    startUs = TestNowUs();
+    for (i = 0; i < TEST_LOOKUPS; i++) {
+        list.getItemByListIndex(1 + (i * 7) % TEST_ITEMS, out);
+        sum += out.Name.size();
+    }
+    elapsedUs = TestNowUs() - startUs;
+
+    printf("[mapping] first/last/next/previous/index/current, %d index lookups in %lld us (%.2f us each): %s\n",
+           TEST_LOOKUPS, (long long)elapsedUs, (double)elapsedUs / TEST_LOOKUPS, (failed || sum == 0) ? "FAILED" : "OK");
+    return (failed || sum == 0) ? 1 : 0;
+}
+
+static int TestWindow()
+{
+    PlayListIndex index;
+    std::vector<PlayListItemView> views;
+    const PlayListItemView* erased;
+    const char* name;
+    int64_t startUs, elapsedUs[3];
+    int sizes[3] = { 1000, 10000, 100000 };
+    bool failed = false;
+    int i, j, k, start, got;
+
+    for (i = 0; i < TEST_ITEMS; i++)
+        index.insert(TestItem(i), rand() % (index.size() + 1));
+    for (i = 0; i < 1000 && !failed; i++) {
+        start = rand() % (index.size() + TEST_WINDOW) - TEST_WINDOW / 2;
+        got = index.getWindow(start, TEST_WINDOW, views);
+        failed = got != (int)views.size() || got != ((start < 0) ? 0 : std::max(0, std::min(TEST_WINDOW, index.size() - start)));
+        for (j = 0; j < got && !failed; j++)
+            failed = views[j].Name != index.at(start + j)->Name;
+    }
+
+    //字符串驻留：Path、Type、Singer 等重复的字段只有一份；删除后旧的视图仍然可以读
+    failed = failed || index.stringCount() > TEST_ITEMS * 6;
+    erased = index.at(0);
+    name = erased->Name;
+    index.getWindow(0, 1, views);
+    index.erase(name);
+    failed = failed || strcmp(views[0].Name, name) != 0 || index.positionOf(views[0].Name) >= 0;
+    printf("[window] %d random windows, %d strings in %lld bytes for %d items: %s\n", 1000,
+           index.stringCount(), (long long)index.stringBytes(), index.size(), failed ? "FAILED" : "OK");
+
+    //取一屏的时间与列表长度基本无关
+    for (k = 0; k < 3; k++) {
+        index.clear();
+        for (i = 0; i < sizes[k]; i++)
+            index.insert(TestItem(i), -1);
+        startUs = TestNowUs();
+        for (i = 0; i < TEST_WINDOW_FETCHES; i++)
+            index.getWindow((int)(((int64_t)i * 7919) % sizes[k]), TEST_WINDOW, views);
+        elapsedUs[k] = TestNowUs() - startUs;
+        printf("[window] %d items, %d-item window: %.2f us each\n", sizes[k], TEST_WINDOW, (double)elapsedUs[k] / TEST_WINDOW_FETCHES);
+    }
+    return failed ? 1 : 0;
+}
+
+typedef struct {
+    MappingPlayList*                list;
+    std::vector<PlayListChange>     changes;
+    std::vector<std::string>        names;      //回调中按窗口取到的变化的条目
+} TestListener;
+
+static void TestOnChange(const PlayListChange* change, void* userData)
+{
+    TestListener* listener = (TestListener*)userData;
+    std::vector<PlayListItemView> views;
+
+    listener->changes.push_back(*change);
+    if (change->type != PlayListChange_Removed && change->type != PlayListChange_Reset
+        && listener->list->getPlayListWindow(change->index, 1, views, NULL) == 1)
+        listener->names.push_back(views[0].Name);
+    else
+        listener->names.push_back("");
+}
+
+static int TestNotification()
+{
+    MappingPlayList list;
+    TestListener listener;
+    PlayListItemS item, out;
+    std::vector<PlayListItemView> views;
+    std::string name;
+    unsigned int version;
+    bool failed;
+    int i;
+
+    listener.list = &list;
+    list.addChangeListener(TestOnChange, &listener);
+    for (i = 0; i < 5; i++) {
+        item = TestItem(i);
+        list.addItemToPlayListMap(&item);
+    }
+    item = TestItem(5);
+    list.insertItemToPlayListMap(2, &item);         //0 5 1 2 3 4
+    item = TestItem(1);
+    item.LastPlayPosition = "00:10:00.000";
+    list.updateItemToPlayListMap(&item);
+    list.setCurrentPlayingItem(TestItem(3).Name);
+    list.setCurrentPlayingItem(TestItem(0).Name);
+    name = TestItem(2).Name;
+    list.deleteItemToPlayListMap(name, out);        //0 5 1 3 4
+    list.sortPlayListByField(SortField_FileName, SortOrder_Ascending);
+    list.removeChangeListener(TestOnChange, &listener);
+    item = TestItem(6);
+    list.addItemToPlayListMap(&item);
+
+    failed = listener.changes.size() != 12
+            || listener.changes[4].type != PlayListChange_Inserted || listener.changes[4].index != 5 || listener.names[4] != TestItem(4).Name
+            || listener.changes[5].type != PlayListChange_Inserted || listener.changes[5].index != 2 || listener.names[5] != TestItem(5).Name
+            || listener.changes[6].type != PlayListChange_Updated || listener.changes[6].index != 3 || listener.names[6] != TestItem(1).Name
+            || listener.changes[7].index != 5 || listener.changes[8].index != 5 || listener.changes[9].index != 1
+            || listener.changes[10].type != PlayListChange_Removed || listener.changes[10].index != 4 || listener.changes[10].size != 5
+            || listener.changes[11].type != PlayListChange_Reset || listener.changes[11].size != 5;
+    for (i = 1; i < (int)listener.changes.size() && !failed; i++)
+        failed = listener.changes[i].version != listener.changes[i - 1].version + 1;
+
+    failed = failed || list.getPlayListWindow(1, 10, views, &version) != 6 || version != listener.changes.back().version + 1
+            || strcmp(views[0].Name, TestItem(0).Name.c_str()) != 0 || !views[0].IsCurrentPlaying
+            || list.getItemByListIndex(list.getListIndexByName(TestItem(1).Name), out) < 0 || out.LastPlayPosition != "00:10:00.000";
+
+    printf("[notify] insert/update/current/remove/reset, %d changes, window in callback: %s\n",
+           (int)listener.changes.size(), failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int failed = 0;
+
+    srand(1);
+    failed += TestParse();
+    failed += TestInsertErase();
+    failed += TestSort();
+    failed += TestRange();
+    failed += TestMapping();
+    failed += TestWindow();
+    failed += TestNotification();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -112,10 +112,10 @@ int StreamPlayerUtilityCtrlResume(int playerIndex)
 }
 
 
-int StreamPlayerUtilityCtrlSeekto(int playerIndex)
+int StreamPlayerUtilityCtrlSeekto(int playerIndex, int timeMs, int accurate)
 {
 
-    SendPlayMessageToHandler(PLAY_CMD_SEEKTO, playerIndex);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_SEEKTO, playerIndex, timeMs, accurate);
     
     return 0;
 }
@@ -139,19 +139,19 @@ int StreamPlayerUtilityCtrlSeektoEnd(int playerIndex)
 }
 
 
-int StreamPlayerUtilityCtrlFastForward(int playerIndex)
+int StreamPlayerUtilityCtrlFastForward(int playerIndex, int rate)
 {
 
-    SendPlayMessageToHandler(PLAY_CMD_FASTFORWARD, playerIndex);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_FASTFORWARD, playerIndex, rate, 0);
     
     return 0;
 }
 
 
-int StreamPlayerUtilityCtrlFastRewind(int playerIndex)
+int StreamPlayerUtilityCtrlFastRewind(int playerIndex, int rate)
 {
 
-    SendPlayMessageToHandler(PLAY_CMD_FASTREWIND, playerIndex);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_FASTREWIND, playerIndex, rate, 0);
     
     return 0;
 }
@@ -560,9 +560,10 @@ int StreamPlayerGetCurrentSubtitleInfo(int playerIndex)
 }
 
 
-int StreamPlayerSelectSubtitle(int playerIndex)
+int StreamPlayerSelectSubtitle(int playerIndex, int subtitlePid)
 {
-    playerLogInfo("StreamPlayerSelectSubtitle playerIndex[%d]\n", playerIndex);
+    playerLogInfo("StreamPlayerSelectSubtitle playerIndex[%d] pid[%d]\n", playerIndex, subtitlePid);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_SELECT_SUBTITLE, playerIndex, subtitlePid, 0);
 
     return 0;
 }
@@ -571,6 +572,7 @@ int StreamPlayerSelectSubtitle(int playerIndex)
 int StreamPlayerSwitchSubtitle(int playerIndex)
 {
     playerLogInfo("StreamPlayerSwitchSubtitle playerIndex[%d]\n", playerIndex);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_SELECT_SUBTITLE, playerIndex, PLAY_TRACK_NEXT, 0);
 
     return 0;
 }
@@ -763,9 +765,10 @@ int StreamPlayerGetCurrentAudioTrackInfo(int playerIndex)
     return 0;
 }
 
-int StreamPlayerSelectAudioTrack(int playerIndex)
+int StreamPlayerSelectAudioTrack(int playerIndex, int audioTrackPid)
 {
-    playerLogInfo("StreamPlayerSelectAudioTrack playerIndex[%d]\n", playerIndex);
+    playerLogInfo("StreamPlayerSelectAudioTrack playerIndex[%d] pid[%d]\n", playerIndex, audioTrackPid);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_SELECT_AUDIOTRACK, playerIndex, audioTrackPid, 0);
 
     return 0;
 }
@@ -774,6 +777,7 @@ int StreamPlayerSelectAudioTrack(int playerIndex)
 int StreamPlayerSwitchAudioTrack(int playerIndex)
 {
     playerLogInfo("StreamPlayerSwitchAudioTrack playerIndex[%d]\n", playerIndex);
+    SendPlayMessageToHandlerWithArgs(PLAY_CMD_SELECT_AUDIOTRACK, playerIndex, PLAY_TRACK_NEXT, 0);
 
     return 0;
 }
@@ -21,11 +21,11 @@ int StreamPlayerUtilityCtrlClose(int playerIndex);
 int StreamPlayerUtilityCtrlStop(int playerIndex);
 int StreamPlayerUtilityCtrlPause(int playerIndex);
 int StreamPlayerUtilityCtrlResume(int playerIndex);
-int StreamPlayerUtilityCtrlSeekto(int playerIndex);
+int StreamPlayerUtilityCtrlSeekto(int playerIndex, int timeMs, int accurate);     //timeMs 小于 0 为结尾
 int StreamPlayerUtilityCtrlSeektoStart(int playerIndex);
 int StreamPlayerUtilityCtrlSeektoEnd(int playerIndex);
-int StreamPlayerUtilityCtrlFastForward(int playerIndex);
-int StreamPlayerUtilityCtrlFastRewind(int playerIndex);
+int StreamPlayerUtilityCtrlFastForward(int playerIndex, int rate);  //rate 为百分比，50~3200
+int StreamPlayerUtilityCtrlFastRewind(int playerIndex, int rate);   //rate 为百分比，200~3200
 
 
 //播放方式控制
@@ -66,7 +66,7 @@ int StreamPlayerGetCurrentTimeString(int playerIndex);
 //播放字幕
 int StreamPlayerGetAllSubtitleInfo(int playerIndex);
 int StreamPlayerGetCurrentSubtitleInfo(int playerIndex);
-int StreamPlayerSelectSubtitle(int playerIndex);
+int StreamPlayerSelectSubtitle(int playerIndex, int subtitlePid);     //PLAY_TRACK_OFF 关闭字幕
 int StreamPlayerSwitchSubtitle(int playerIndex);
 int StreamPlayerGetSubtitileFlag(int playerIndex);
 int StreamPlayerSetSubtitileFlag(int playerIndex);
@@ -95,7 +95,7 @@ int StreamPlayerGetTrack(int playerIndex);
 int StreamPlayerGetTrackInfo(int playerIndex);
 int StreamPlayerGetAllAudioTrackInfo(int playerIndex);
 int StreamPlayerGetCurrentAudioTrackInfo(int playerIndex);
-int StreamPlayerSelectAudioTrack(int playerIndex);
+int StreamPlayerSelectAudioTrack(int playerIndex, int audioTrackPid);
 int StreamPlayerSwitchAudioTrack(int playerIndex);
 
 
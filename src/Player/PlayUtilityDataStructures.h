@@ -19,6 +19,9 @@ typedef struct {
     char**  PlayListAddr;
     char*   PlayUrl;
 
+    int     fccNeighbours;      //快速换台预取前后各几个频道，0 关闭
+    int     fccMemoryKB;        //预取缓冲总和上限，0 为默认
+    int     fccBandwidthKbps;   //预取带宽上限，0 不限
 } PlayerArgs_Type;
 
 
@@ -310,17 +310,17 @@ static int PlayerBasicCtrlThread(void *args)
             }
         case PLAY_CMD_SEEKTO: {
                 playerLogVerbose("PLAY_CMD_SEEKTO\n");
-                PlayerOptionsSeekto();
+                PlayerOptionsSeekto(playCmd.arg1, playCmd.arg2);
                 break;
             }
         case PLAY_CMD_FASTFORWARD: {
                 playerLogVerbose("PLAY_CMD_FASTFORWARD\n");
-                PlayerOptionsFastForward();
+                PlayerOptionsFastForward(playCmd.arg1);
                 break;
             }
         case PLAY_CMD_FASTREWIND: {
                 playerLogVerbose("PLAY_CMD_FASTREWIND\n");
-                PlayerOptionsFastRewind();
+                PlayerOptionsFastRewind(playCmd.arg1);
                 break;
             }
         case PLAY_CMD_SEEKTO_START: {
@@ -333,6 +333,16 @@ static int PlayerBasicCtrlThread(void *args)
                 PlayerOptionsSeektoEnd();
                 break;
             }
+        case PLAY_CMD_SELECT_SUBTITLE: {
+                playerLogVerbose("PLAY_CMD_SELECT_SUBTITLE\n");
+                PlayerOptionsSelectSubtitle(playCmd.arg1);
+                break;
+            }
+        case PLAY_CMD_SELECT_AUDIOTRACK: {
+                playerLogVerbose("PLAY_CMD_SELECT_AUDIOTRACK\n");
+                PlayerOptionsSelectAudioTrack(playCmd.arg1);
+                break;
+            }
         default:
             playerLogVerbose("default\n");
             playerLogWarning("Command[%d] unable to recognize && untreated.\n", playCmd.cmd);
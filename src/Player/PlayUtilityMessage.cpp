@@ -64,7 +64,14 @@ int PlayCommandToSending(MessageQueue_Type messageQueue, int cmd, int subCMD, in
 
 int SendPlayMessageToHandler(int playMsg, int playerIndex)
 {
-    playerLogInfo(" playMsg = [%d]\n", playMsg);
+    return SendPlayMessageToHandlerWithArgs(playMsg, playerIndex, 0, 0);
+}
+
+
+
+int SendPlayMessageToHandlerWithArgs(int playMsg, int playerIndex, int arg1, int arg2)
+{
+    playerLogInfo(" playMsg = [%d], arg1[%d], arg2[%d]\n", playMsg, arg1, arg2);
     
     int microSecond = PLAYER_CMD_SENDING_DELAY_TIME;
     MessageQueue_Type messageQueue;
@@ -73,7 +80,7 @@ int SendPlayMessageToHandler(int playMsg, int playerIndex)
     streamCtrl = StreamDispatcher(playerIndex);
     messageQueue =  streamCtrl->msgQueue;    //GlobalMessageQueueGet(0);
 
-    PlayCommandToSending( messageQueue, playMsg, 0, 0, 0, microSecond);
+    PlayCommandToSending( messageQueue, playMsg, 0, arg1, arg2, microSecond);
 
     
     return 0;
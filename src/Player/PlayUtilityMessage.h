@@ -7,6 +7,7 @@
 int PlayCommandToSending(MessageQueue_Type messageQueue, int cmd, int subCMD, int arg1, int arg2, unsigned int microSecond );
 
 int SendPlayMessageToHandler(int playMsg, int playerIndex);
+int SendPlayMessageToHandlerWithArgs(int playMsg, int playerIndex, int arg1, int arg2);   //参数放在 arg1、arg2 中
 
 
 
@@ -3,6 +3,8 @@
 
 
 #define     PLAY_MESSAGE_VALUE_MAX      10000
+#define     PLAY_TRACK_OFF              (-1)        //选择字幕、音轨时代替 PID：关闭字幕
+#define     PLAY_TRACK_NEXT             (-2)        //切换到下一个，字幕在最后一个之后为关闭
 
 
 // 基本的播放控制命令 //
@@ -19,6 +21,8 @@ typedef enum PlayCmd {
     PLAY_CMD_SEEKTO_END,
     PLAY_CMD_FASTFORWARD,   //10
     PLAY_CMD_FASTREWIND,
+    PLAY_CMD_SELECT_SUBTITLE,
+    PLAY_CMD_SELECT_AUDIOTRACK,
     PLAY_CMD_MAX
 } PLAY_CMD;
 
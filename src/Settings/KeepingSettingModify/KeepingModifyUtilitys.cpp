@@ -5,6 +5,7 @@
 #include <vector>
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -18,7 +19,7 @@
 using namespace std; 
 
 extern "C" {
-ParametersItem ERROR_PARAM_ITEM = {"string error", "string error", "string error", "string error", "string error", "string error"};
+ParametersItem ERROR_PARAM_ITEM = {"string error", "string error", "string error", "string error", "string error", "string error", 0};
 std::string gMonthStr[13] = {"Undefined", "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 }
 
@@ -135,6 +136,96 @@ int dateTimeCompare(std::string& strBaseDTime, std::string& strNowDTime)  //(con
 
 
 
+/**
+ *  @Func: dateTimeStringToEpochMs
+ *         ps. :将 "2012-Jan-01 08:02:05.521" 格式的本地时间转换为 epoch 毫秒值
+ *  @Param: strDTime, type:: const std::string&
+ *  @Return: int64_t, 格式错误时返回 -1
+ *  
+ **/
+int64_t dateTimeStringToEpochMs(const std::string& strDTime)
+{
+    int year = 0, day = 0, hour = 0, minute = 0, second = 0, msecond = 0;
+    char month[8] = {0};
+    struct tm temp_time;
+    time_t seconds;
+    int i = 0;
+
+    if (sscanf(strDTime.c_str(), "%d-%3s-%d %d:%d:%d.%d", &year, month, &day, &hour, &minute, &second, &msecond) < 6) {
+        settingsLogError("strDTime[%s] format error.\n", strDTime.c_str());
+        return -1;
+    }
+    for (i = 1; i < 13; i++) {
+        if (gMonthStr[i].compare(month) == 0)
+            break;
+    }
+    if (i == 13) {
+        settingsLogError("strDTime[%s] month error.\n", strDTime.c_str());
+        return -1;
+    }
+    memset(&temp_time, 0, sizeof(temp_time));
+    temp_time.tm_year  = year - 1900;
+    temp_time.tm_mon   = i - 1;
+    temp_time.tm_mday  = day;
+    temp_time.tm_hour  = hour;
+    temp_time.tm_min   = minute;
+    temp_time.tm_sec   = second;
+    temp_time.tm_isdst = -1;
+    seconds = mktime(&temp_time);
+
+    return (int64_t)seconds * 1000 + msecond;
+}
+
+
+/**
+ *  @Func: epochMsToDateTimeString
+ *         ps. :将 epoch 毫秒值转换为 "2012-Jan-01 08:02:05.521" 格式的本地时间
+ *  @Param: timeMs, type:: int64_t
+ *  @Return: std::string
+ *  
+ **/
+std::string epochMsToDateTimeString(int64_t timeMs)
+{
+    char buf[64] = {0};
+    struct tm temp_time;
+    time_t seconds = (time_t)(timeMs / 1000);
+
+    localtime_r(&seconds, &temp_time);
+    snprintf(buf, sizeof(buf) - 1, "%04d-%s-%02d %02d:%02d:%02d.%03d",
+                    temp_time.tm_year + 1900, gMonthStr[temp_time.tm_mon + 1].c_str(), temp_time.tm_mday,
+                    temp_time.tm_hour, temp_time.tm_min, temp_time.tm_sec, (int)(timeMs % 1000));
+
+    return std::string(buf);
+}
+
+
+/**
+ *  @Func: recordChangedSourceName
+ *         ps. :RecordChangedSource 对应记录中的 sourceModule 字段
+ *  @Param: module, type:: int
+ *  @Return: const char*
+ *  
+ **/
+const char* recordChangedSourceName(int module)
+{
+    switch(module) {
+    case RecordChangedSource_STBMonitor:
+        return "STBManageTool";
+    case RecordChangedSource_tr069Manager:
+        return "TR069";
+    case RecordChangedSource_JsLocalSetting:
+        return "JSLocal";
+    case RecordChangedSource_JsEpgSetting:
+        return "JSEPG";
+    case RecordChangedSource_Other:
+        return "Other";
+    default:
+        return "";
+    }
+}
+
+
+
 /**
  *  @Func: getValueByTag
  *         ps. :从文件 m_fileName 的每一行中得到所需的字段值
@@ -198,6 +289,7 @@ ParametersItem* parseRecordLine(std::string& strLine)
     paramItem->modifiedFile = getValueByTag(strLine, " ].");
     if (paramItem->modifiedFile == "fail")
         return &ERROR_PARAM_ITEM;
+    paramItem->modifyTimeMs = dateTimeStringToEpochMs(paramItem->modifyTimeStamp);
 
 /*     settingsLogVerbose("parseRecordLine paramItem.paramName[%s] newValue[%s] sourceModule[%s] oldValue[%s] modifyTimeStamp[%s] modifiedFile[%s].\n", 
                     (paramItem->paramName).c_str(), (paramItem->newValue).c_str(), (paramItem->sourceModule).c_str(), 
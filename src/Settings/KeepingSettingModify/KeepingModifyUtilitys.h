@@ -5,6 +5,8 @@
 
 #include <string>
 
+#include <stdint.h>
+
 #define     COUNT_OF_PARAM_IN_MODIFY_FILE_MAX           10
 #define     PARAM_CHANGE_RECORD_KEEPING_VERSION     "1.0"
 #define     STRING_ERROR    "string error"
@@ -41,11 +43,13 @@ typedef struct _ParametersItem {
     std::string     modifyTimeStamp;    //什么时间修改的
     std::string     sourceModule;       //谁来修改的
     std::string     modifiedFile;       //被修改的谁是哪个文件中的
+    int64_t         modifyTimeMs;       //modifyTimeStamp 对应的 epoch 毫秒值
 } ParametersItem;
 
  typedef struct _ParamStatistics{
     std::string paramName;          //paramName, 字段名
     std::string earliestTimeStamp;  //earliestTimeStamp, record文件中paramName字段的最早记录
+    int64_t     earliestTimeMs;     //earliestTimeStamp 对应的 epoch 毫秒值
     int         recordCount;        //recordCount, record文件中paramName字段的记录次数
 } ParamStatistics;
 
@@ -55,6 +59,9 @@ extern "C" std::string gMonthStr[12 + 1];
 int dateTimeCompare(std::string& strBaseDTime, std::string& strNowDTime);
 std::string getValueByTag(std::string& str, const char *tag);
 ParametersItem* parseRecordLine(std::string& strLine);
+int64_t dateTimeStringToEpochMs(const std::string& strDTime);
+std::string epochMsToDateTimeString(int64_t timeMs);
+const char* recordChangedSourceName(int module);
 
 
 
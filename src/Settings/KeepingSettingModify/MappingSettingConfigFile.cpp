@@ -1,7 +1,15 @@
 #include <algorithm>
 #include <iostream>
 
+#include <fstream>
+#include <set>
+
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 
 #include "Log/LogC.h"
 #include "logSettings.h"
@@ -14,6 +22,49 @@
 using namespace std; 
 
 
+#define CONFIG_FILE_WATCH_EVENT_BUFFER_SIZE     4096
+
+
+static void* configFileWatchTask(void* arg)
+{
+    ((MappingSettingConfigFile*)arg)->configFileWatchLoop();
+
+    return NULL;
+}
+
+
+/* 敏感字段的值不保存原文，只保存 hash 用于比较 */
+static std::string sensitiveValueDigest(const std::string& value)
+{
+    char buf[16] = {0};
+    uint32_t hash = 2166136261u;
+    std::string::size_type i = 0;
+
+    for (i = 0; i < value.size(); i++)
+        hash = (hash ^ (uint8_t)value[i]) * 16777619u;
+    snprintf(buf, sizeof(buf), "#%08x", hash);
+
+    return std::string(buf);
+}
+
+
+MappingSettingConfigFile::MappingSettingConfigFile()
+    : m_watchFd(-1)
+    , m_watchStop(0)
+    , m_watchRunning(false)
+{
+    m_watchPipe[0] = m_watchPipe[1] = -1;
+    m_mutex = ThreadMutexCreate( );
+}
+
+
+MappingSettingConfigFile::~MappingSettingConfigFile()
+{
+    stopConfigFileWatch();
+    ThreadMutexDestroy(m_mutex);
+}
+
+
 /**
  *  @Func: addConfigFile
  *  @Param: file, type:: std::string
@@ -50,6 +101,125 @@ bool MappingSettingConfigFile::deleteConfigFile(std::string file)
 }
 
 
+/**
+ *  @Func: parseConfigFile
+ *         ps. : 逐行解析 file 中 "tag=value" 格式的键值对
+ *  @Param: file, type:: const std::string&
+ *          params, type:: std::map<std::string, std::string>&
+ *  @Return: int
+ *  
+ **/
+int MappingSettingConfigFile::parseConfigFile(const std::string& file, std::map<std::string, std::string>& params)
+{
+    std::string line("");
+    std::string::size_type position;
+
+    std::ifstream fin(file.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) {
+        settingsLogError("Open file error!(%s)\n", file.c_str());
+        return -1;
+    }
+    while (std::getline(fin, line)) {
+        position = line.find('=');
+        if (position == std::string::npos) {
+            if (!line.empty())
+                settingsLogWarning("Not found \"=\", line=[%s]\n", line.c_str());
+            continue;
+        }
+        params[line.substr(0, position)] = line.substr(position + 1);
+    }
+
+    return 0;
+}
+
+
+/**
+ *  @Func: diffConfigFileParam
+ *         ps. : 比较 file 修改前后的键值对，更新 m_fileParamMap 和 m_paramConfigFileMap，
+ *               有变化的参数保存到 changes
+ *  @Param: file, type:: const std::string&
+ *          params, type:: std::map<std::string, std::string>&, 重新解析得到的键值对
+ *          changes, type:: std::vector<ConfigParamChanged>&
+ *  @Return: int, 有变化的参数个数
+ *  
+ **/
+int MappingSettingConfigFile::diffConfigFileParam(const std::string& file, std::map<std::string, std::string>& params, std::vector<ConfigParamChanged>& changes)
+{
+    std::map<std::string, std::string>::iterator newIt, oldIt;
+    ConfigParamChanged change;
+    std::string digest("");
+    bool sensitive = false;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    std::map<std::string, std::string>& oldParams = m_fileParamMap[file];
+
+    //两个有序 map 归并比较
+    newIt = params.begin();
+    oldIt = oldParams.begin();
+    while (newIt != params.end() || oldIt != oldParams.end()) {
+        if (oldIt == oldParams.end() || (newIt != params.end() && newIt->first < oldIt->first)) {
+            change.changeType = ConfigParamChanged_Added;
+        } else if (newIt == params.end() || oldIt->first < newIt->first) {
+            change.name = oldIt->first;
+            change.value = "";
+            change.changeType = ConfigParamChanged_Removed;
+            changes.push_back(change);
+            retakeConfigFileParam(file, oldIt->first);
+            oldParams.erase(oldIt++);
+            continue;
+        } else {
+            change.changeType = ConfigParamChanged_Modified;
+        }
+
+        sensitive = gSensitiveParamFilter.filteringSensitiveParam(newIt->first);
+        digest = sensitive ? sensitiveValueDigest(newIt->second) : newIt->second;
+        if (change.changeType == ConfigParamChanged_Added || oldIt->second != digest) {
+            change.name = newIt->first;
+            change.value = sensitive ? "" : newIt->second;
+            changes.push_back(change);
+            oldParams[newIt->first] = digest;
+            m_paramConfigFileMap[newIt->first] = change.value;
+        }
+        if (change.changeType == ConfigParamChanged_Modified)
+            ++oldIt;
+        ++newIt;
+    }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return changes.size();
+}
+
+
+/**
+ *  @Func: retakeConfigFileParam
+ *         ps. : name 从 file 中删除后，其他文件中仍有该参数时改用其他文件中的值，否则从 m_paramConfigFileMap 中删除；
+ *               调用时已持有 m_mutex
+ *  @Param: file, type:: const std::string&
+ *          name, type:: const std::string&
+ *  @Return: void
+ *  
+ **/
+void MappingSettingConfigFile::retakeConfigFileParam(const std::string& file, const std::string& name)
+{
+    std::map<std::string, std::map<std::string, std::string> >::iterator fileIt;
+    std::map<std::string, std::string>::iterator paramIt;
+
+    for (fileIt = m_fileParamMap.begin(); fileIt != m_fileParamMap.end(); ++fileIt) {
+        if (fileIt->first == file)
+            continue;
+        paramIt = fileIt->second.find(name);
+        if (paramIt != fileIt->second.end()) {
+            //敏感字段只保存了 hash，值与加载时一样为空
+            m_paramConfigFileMap[name] = gSensitiveParamFilter.filteringSensitiveParam(name) ? "" : paramIt->second;
+            return;
+        }
+    }
+    m_paramConfigFileMap.erase(name);
+}
+
+
 /**
  *  @Func: loadConfigFileParam
  *         ps. : 从 m_cfgFileList 文件列表中包含的文件里加载到 m_paramConfigFileMap
@@ -59,48 +229,285 @@ bool MappingSettingConfigFile::deleteConfigFile(std::string file)
  **/
 int MappingSettingConfigFile::loadConfigFileParam()
 {
-    FILE *fp = NULL;
-    char ch;
-    std::string line("");
-    std::string tag("");
-    std::string value("");
     std::vector<std::string>::iterator cfgFileListIt;
-    std::string::size_type position;
-    
+    std::vector<ConfigParamChanged> changes;
+    int ret = 0;
     
     for (cfgFileListIt = m_cfgFileList.begin(); cfgFileListIt != m_cfgFileList.end(); ++cfgFileListIt){
+        std::map<std::string, std::string> params;
+
         settingsLogVerbose("I will load \"%s\".\n", (*cfgFileListIt).c_str());
-        fp = fopen((*cfgFileListIt).c_str(), "rb");
-        if (!fp) {
-            settingsLogError("Open file error!\n");
-            return -1;
+        if (parseConfigFile(*cfgFileListIt, params) < 0) {
+            ret = -1;
+            continue;
         }
-        while((ch = fgetc(fp)) != (char)EOF || !line.empty()) {
-            if(ch != '\n' && ch != (char)EOF) {
-                line += ch;
-                continue;
-            }
-            position = line.find('=');
-            if (position == std::string::npos) {
-                settingsLogWarning("Not found \"=\", line=[%s]\n", line.c_str());
-                line.clear();
-                continue;
-            }
-            tag = line.substr(0, position);
-            value = line.substr(position + 1);
-            updateConfigFileParamMap(tag, value);
-            line.clear();
-        }
-        fclose(fp);
-        fp = NULL;
+        changes.clear();
+        diffConfigFileParam(*cfgFileListIt, params, changes);
         settingsLogVerbose("load \"%s\" ok.\n", (*cfgFileListIt).c_str());
     }
     settingsLogVerbose("Has load ConfigFile OK.\n");
     
-    return 0;
+    return ret;
 }     
 
 
+/**
+ *  @Func: reloadConfigFile
+ *         ps. : 配置文件被修改后只重新解析该文件，并通知有变化的参数
+ *  @Param: file, type:: const std::string&
+ *  @Return: int, 有变化的参数个数
+ *  
+ **/
+int MappingSettingConfigFile::reloadConfigFile(const std::string& file)
+{
+    std::map<std::string, std::string> params;
+    std::vector<ConfigParamChanged> changes;
+
+    if (parseConfigFile(file, params) < 0)
+        return -1;
+    diffConfigFileParam(file, params, changes);
+    settingsLogVerbose("reload \"%s\" ok, changed[%d].\n", file.c_str(), (int)changes.size());
+    if (!changes.empty())
+        publishConfigParamChanged(file, changes);
+
+    return changes.size();
+}
+
+
+/**
+ *  @Func: publishConfigParamChanged
+ *         ps. : 在锁外回调，回调中可以调用 getConfigFileParamValue
+ *  @Param: file, type:: const std::string&
+ *          changes, type:: std::vector<ConfigParamChanged>&
+ *  @Return: void
+ *  
+ **/
+void MappingSettingConfigFile::publishConfigParamChanged(const std::string& file, std::vector<ConfigParamChanged>& changes)
+{
+    std::vector<std::pair<ConfigParamChangedCallback, void*> > subscribers;
+    std::vector<std::pair<ConfigParamChangedCallback, void*> >::iterator subIt;
+    std::vector<ConfigParamChanged>::iterator it;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    subscribers = m_subscribers;
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    for (it = changes.begin(); it != changes.end(); ++it) {
+        settingsLogVerbose("file[%s] name[%s] value[%s] changeType[%d].\n", file.c_str(), it->name.c_str(), it->value.c_str(), it->changeType);
+        for (subIt = subscribers.begin(); subIt != subscribers.end(); ++subIt)
+            subIt->first(file.c_str(), it->name.c_str(), it->value.c_str(), it->changeType, subIt->second);
+    }
+
+    return ;
+}
+
+
+/**
+ *  @Func: subscribeConfigParamChanged
+ *  @Param: callback, type:: ConfigParamChangedCallback
+ *          userData, type:: void*
+ *  @Return: int
+ *  
+ **/
+int MappingSettingConfigFile::subscribeConfigParamChanged(ConfigParamChangedCallback callback, void* userData)
+{
+    if (!callback) {
+        settingsLogError("callback is NULL.\n");
+        return -1;
+    }
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    m_subscribers.push_back(std::make_pair(callback, userData));
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return 0;
+}
+
+
+/**
+ *  @Func: unsubscribeConfigParamChanged
+ *  @Param: callback, type:: ConfigParamChangedCallback
+ *          userData, type:: void*
+ *  @Return: int
+ *  
+ **/
+int MappingSettingConfigFile::unsubscribeConfigParamChanged(ConfigParamChangedCallback callback, void* userData)
+{
+    std::vector<std::pair<ConfigParamChangedCallback, void*> >::iterator it;
+    int ret = -1;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    it = std::find(m_subscribers.begin(), m_subscribers.end(), std::make_pair(callback, userData));
+    if (it != m_subscribers.end()) {
+        m_subscribers.erase(it);
+        ret = 0;
+    }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return ret;
+}
+
+
+/**
+ *  @Func: startConfigFileWatch
+ *         ps. : 配置文件一般以 "写临时文件 + rename" 的方式更新，所以监听文件所在的目录
+ *  @Param: 
+ *  @Return: int
+ *  
+ **/
+int MappingSettingConfigFile::startConfigFileWatch()
+{
+    std::vector<std::string>::iterator cfgFileListIt;
+    std::set<std::string> dirs;
+    std::set<std::string>::iterator dirIt;
+    std::string::size_type position;
+    int wd = -1;
+
+    if (m_watchRunning) {
+        settingsLogWarning("config file watch has started.\n");
+        return 0;
+    }
+    m_watchFd = inotify_init();
+    if (m_watchFd < 0) {
+        settingsLogError("inotify_init error.(%s)\n", strerror(errno));
+        return -1;
+    }
+    if (pipe(m_watchPipe) < 0) {
+        settingsLogError("pipe error.(%s)\n", strerror(errno));
+        close(m_watchFd);
+        m_watchFd = -1;
+        return -1;
+    }
+    for (cfgFileListIt = m_cfgFileList.begin(); cfgFileListIt != m_cfgFileList.end(); ++cfgFileListIt) {
+        position = (*cfgFileListIt).rfind('/');
+        dirs.insert(position == std::string::npos ? std::string(".") : (*cfgFileListIt).substr(0, position));
+    }
+    for (dirIt = dirs.begin(); dirIt != dirs.end(); ++dirIt) {
+        wd = inotify_add_watch(m_watchFd, (*dirIt).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            settingsLogError("inotify_add_watch [%s] error.(%s)\n", (*dirIt).c_str(), strerror(errno));
+            continue;
+        }
+        m_watchDirs[wd] = *dirIt;
+    }
+    m_watchStop = 0;
+    if (pthread_create(&m_watchThread, NULL, configFileWatchTask, (void *)this)) {
+        settingsLogError("pthread create error.\n");
+        close(m_watchPipe[0]);
+        close(m_watchPipe[1]);
+        m_watchPipe[0] = m_watchPipe[1] = -1;
+        close(m_watchFd);
+        m_watchFd = -1;
+        m_watchDirs.clear();
+        return -1;
+    }
+    m_watchRunning = true;
+    settingsLogVerbose("config file watch start, dirs[%d].\n", (int)m_watchDirs.size());
+
+    return 0;
+}
+
+
+/**
+ *  @Func: stopConfigFileWatch
+ *         ps. : 通过 m_watchPipe 唤醒阻塞在 poll 中的监听线程，join 之后再关闭 inotify，
+ *               返回后监听线程不会再访问本对象；不能在参数变化的通知回调中调用
+ *  @Param: 
+ *  @Return: int
+ *  
+ **/
+int MappingSettingConfigFile::stopConfigFileWatch()
+{
+    char wakeup = 0;
+
+    if (!m_watchRunning)
+        return 0;
+    m_watchStop = 1;
+    if (write(m_watchPipe[1], &wakeup, 1) != 1)
+        settingsLogWarning("wake up config file watch error.(%s)\n", strerror(errno));
+    pthread_join(m_watchThread, NULL);
+    m_watchRunning = false;
+
+    close(m_watchPipe[0]);
+    close(m_watchPipe[1]);
+    m_watchPipe[0] = m_watchPipe[1] = -1;
+    close(m_watchFd);
+    m_watchFd = -1;
+    m_watchDirs.clear();
+    settingsLogVerbose("config file watch stop.\n");
+
+    return 0;
+}
+
+
+/**
+ *  @Func: configFileWatchLoop
+ *         ps. : 一次 read 得到的事件中，同一文件只重新加载一次；
+ *               m_watchFd、m_watchDirs 在线程退出前不会被修改
+ *  @Param: 
+ *  @Return: void
+ *  
+ **/
+void MappingSettingConfigFile::configFileWatchLoop()
+{
+    char buffer[CONFIG_FILE_WATCH_EVENT_BUFFER_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    std::vector<std::string>::iterator cfgFileListIt;
+    std::map<int, std::string>::iterator dirIt;
+    std::set<std::string> changedFiles;
+    std::set<std::string>::iterator fileIt;
+    const struct inotify_event* event = NULL;
+    struct pollfd fds[2];
+    std::string path("");
+    ssize_t length = 0;
+    char* ptr = NULL;
+
+    fds[0].fd = m_watchFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_watchPipe[0];
+    fds[1].events = POLLIN;
+    while (!m_watchStop) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            settingsLogError("poll inotify error.(%s)\n", strerror(errno));
+            break;
+        }
+        if (m_watchStop || fds[1].revents)
+            break;
+        if (!(fds[0].revents & POLLIN))
+            continue;
+        length = read(m_watchFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR)
+                continue;
+            settingsLogError("read inotify error.(%s)\n", strerror(errno));
+            break;
+        }
+        changedFiles.clear();
+        for (ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event*)ptr;
+            if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) || event->len == 0 || (dirIt = m_watchDirs.find(event->wd)) == m_watchDirs.end())
+                continue;
+            path = dirIt->second + "/" + event->name;
+            for (cfgFileListIt = m_cfgFileList.begin(); cfgFileListIt != m_cfgFileList.end(); ++cfgFileListIt) {
+                if (*cfgFileListIt == path || (dirIt->second == "." && *cfgFileListIt == event->name))
+                    changedFiles.insert(*cfgFileListIt);
+            }
+        }
+        for (fileIt = changedFiles.begin(); fileIt != changedFiles.end(); ++fileIt)
+            reloadConfigFile(*fileIt);
+    }
+    settingsLogVerbose("config file watch loop exit.\n");
+
+    return ;
+}
+
+
 /**
  *  @Func: updateConfigFileParamMap
  *         ps. : 将解析到的 添加到 m_paramConfigFileMap
@@ -115,9 +522,10 @@ int MappingSettingConfigFile::updateConfigFileParamMap(std::string& name, std::s
         settingsLogError("name[%s]  is NULL.\n", name.c_str());
         return -1;
     }
-    std::map<std::string, std::string>::iterator cfgFileMapIt = m_paramConfigFileMap.find(name);
-    
     settingsLogVerbose("INPUT: name[%s] value[%s].\n", name.c_str(), value.c_str());
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    std::map<std::string, std::string>::iterator cfgFileMapIt = m_paramConfigFileMap.find(name);
     if (gSensitiveParamFilter.filteringSensitiveParam(name)) {
         if (cfgFileMapIt != m_paramConfigFileMap.end())
             cfgFileMapIt->second = "";
@@ -129,6 +537,8 @@ int MappingSettingConfigFile::updateConfigFileParamMap(std::string& name, std::s
         else
             m_paramConfigFileMap[name] = value;
     }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     settingsLogVerbose("Has update OK.\n");
     
     return 0;
@@ -147,7 +557,12 @@ int MappingSettingConfigFile::unloadConfigFileParam()
         settingsLogError("unloadConfigFileParam:: m_paramConfigFileMap has been empty.\n");
         return -1;
     }
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     m_paramConfigFileMap.erase(m_paramConfigFileMap.begin(), m_paramConfigFileMap.end()); //成片删除要注意的是，也是STL的特性，删除区间是一个前闭后开的集合 
+    m_fileParamMap.clear();
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     settingsLogVerbose("Has unload ConfigFile OK.\n");
 
     return 0;
@@ -166,9 +581,13 @@ std::string MappingSettingConfigFile::getConfigFileParamValue(std::string name)
     std::map<std::string, std::string>::iterator cfgFileMapIt;
     std::string value("");
     
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     cfgFileMapIt = m_paramConfigFileMap.find(name);
     if (cfgFileMapIt != m_paramConfigFileMap.end())
         value = cfgFileMapIt->second;
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     settingsLogVerbose("GET: name[%s] value[%s].\n", name.c_str(), value.c_str());
 
     return value;
@@ -6,25 +6,66 @@
 #include <vector>
 #include <map>
 
+#include <pthread.h>
+
+#include "ThreadMutex.h"
+
 #define     PARAM_CHANGE_RECORD_KEEPING_FILE_PATH       "./config_param_modify.record"
 
 
+typedef enum {
+    ConfigParamChanged_Added = 0,
+    ConfigParamChanged_Modified,
+    ConfigParamChanged_Removed
+} ConfigParamChangedType;
+
+/* 配置文件中参数变化的通知，敏感字段的 value 为空 */
+typedef void (*ConfigParamChangedCallback)(const char* file, const char* name, const char* value, int changeType, void* userData);
+
+typedef struct _ConfigParamChanged {
+    std::string     name;
+    std::string     value;
+    int             changeType;     //ConfigParamChangedType
+} ConfigParamChanged;
+
+
 class MappingSettingConfigFile { /* 在内存中维护对配置文件中参数的键值对的拷贝 */
     public:
-        MappingSettingConfigFile(){}
-        ~MappingSettingConfigFile(){}
-        
+        MappingSettingConfigFile();
+        ~MappingSettingConfigFile();
+
         bool addConfigFile(std::string file);
         bool deleteConfigFile(std::string file);
         int loadConfigFileParam();                                          //将 m_cfgFileList 中配置文件里的键值对加载到 m_paramConfigFileMap
         int unloadConfigFileParam();
+        int reloadConfigFile(const std::string& file);                      //只重新加载 file，并通知有变化的参数
         int updateConfigFileParamMap(std::string& name, std::string& value);  //在每次将修改信息写入到 m_fileName 文件后，更新内存中的配置文件拷贝 m_paramConfigFileMap ，
         std::string getConfigFileParamValue(std::string name);
         int paramConfigFileMapOutput();
-        
+
+        int startConfigFileWatch();                                         //inotify 监听 m_cfgFileList 中文件所在的目录
+        int stopConfigFileWatch();                                          //等待监听线程退出后返回
+        int subscribeConfigParamChanged(ConfigParamChangedCallback callback, void* userData);
+        int unsubscribeConfigParamChanged(ConfigParamChangedCallback callback, void* userData);
+        void configFileWatchLoop();                                         //监听线程
+
     private:
+        int parseConfigFile(const std::string& file, std::map<std::string, std::string>& params);
+        int diffConfigFileParam(const std::string& file, std::map<std::string, std::string>& params, std::vector<ConfigParamChanged>& changes);
+        void retakeConfigFileParam(const std::string& file, const std::string& name);  //参数从 file 中删除后更新 m_paramConfigFileMap
+        void publishConfigParamChanged(const std::string& file, std::vector<ConfigParamChanged>& changes);
+
         std::map<std::string, std::string>  m_paramConfigFileMap;   //保存各个配置文件（包括：yx_config_system.ini，yx_config_customer.ini，yx_config_tr069.ini）中的键值对
+        std::map<std::string, std::map<std::string, std::string> >  m_fileParamMap;    //file -> 该文件的键值对，用于比较文件修改前后的差异，敏感字段只保存 hash
         std::vector<std::string>    m_cfgFileList;                  //可能会修改的配置文件列表，在构造时初始化
+        std::vector<std::pair<ConfigParamChangedCallback, void*> >  m_subscribers;
+        std::map<int, std::string>  m_watchDirs;                    //inotify watch descriptor -> 目录
+        int                         m_watchFd;
+        int                         m_watchPipe[2];                 //stopConfigFileWatch 写入，唤醒监听线程
+        volatile int                m_watchStop;
+        bool                        m_watchRunning;                 //监听线程已创建，还没有 join
+        pthread_t                   m_watchThread;
+        ThreadMutex_Type            m_mutex;
 };
 
 
@@ -38,4 +79,3 @@ class MappingSettingConfigFile { /* 在内存中维护对配置文件中参数
 
 
 #endif //__MAPPING_SETTING_CONFIG_FILE_H__
-
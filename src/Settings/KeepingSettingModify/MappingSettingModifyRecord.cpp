@@ -16,21 +16,35 @@
 using namespace std;
 
 
-int IsModifyRecordMappingLoaded = 0;
+/* 敏感字段的值不写入日志文件，和文本输出一样替换为 "***" */
+static bool maskSensitiveItem(ParametersItem& item)
+{
+    if (!gSensitiveParamFilter.filteringSensitiveParam(item.paramName))
+        return false;
+    item.oldValue = "***";
+    item.newValue = "***";
 
+    return true;
+}
 
 
 MappingSettingModifyRecord::MappingSettingModifyRecord(std::string fileName)
     : m_fileName(fileName)
+    , m_recordCount(0)
     , m_version(PARAM_CHANGE_RECORD_KEEPING_VERSION)
 {
     if (m_mutex) {
         settingsLogWarning("thread mutex has init.\n");
     }
     m_mutex = ThreadMutexCreate( );
-    
-    //paramStatisticsMapping initial
-    m_paramStatisticsMapping = new MappingSettingStatistics(fileName);    
+    m_journal = new ModifyRecordJournal(fileName + ".journal");
+}
+
+
+MappingSettingModifyRecord::~MappingSettingModifyRecord()
+{
+    delete m_journal;
+    ThreadMutexDestroy(m_mutex);
 }
 
 
@@ -43,10 +57,30 @@ MappingSettingModifyRecord::MappingSettingModifyRecord(std::string fileName)
  **/
 int MappingSettingModifyRecord::loadModifyRecordParam()  
 {
-    (*m_paramStatisticsMapping).loadStatisticsRecord();
-    (*m_paramStatisticsMapping).statisticsRecordMapOutput();
+    std::vector<ParametersItem> items;
+    std::vector<ParametersItem>::iterator itemIt;
 
-    FILE *fp = NULL;
+    if ((*m_journal).isExist() && (*m_journal).loadRecords(items) >= 0) {
+        int maskedCount = 0;
+
+        settingsLogVerbose("loadModifyRecordParam from journal.\n");
+        for (itemIt = items.begin(); itemIt != items.end(); ++itemIt) {
+            if (maskSensitiveItem(*itemIt))
+                maskedCount++;
+            updateModifyRecordParamMap(&(*itemIt));
+        }
+        //旧版本写入的日志中可能有敏感字段的明文，重写日志
+        if (maskedCount > 0) {
+            items.clear();
+            getModifyRecordItems(items);
+            return (*m_journal).compact(items);
+        }
+        (*m_journal).open();
+
+        return 0;
+    }
+
+    //没有日志文件时从旧的文本格式文件加载，并转换为日志
     bool fileAvailableLineFlag = false;
     std::string line("");
 
@@ -74,9 +108,9 @@ int MappingSettingModifyRecord::loadModifyRecordParam()
         line.clear();
     }
     settingsLogVerbose("Load %s ok.\n", m_fileName.c_str());
-    
-    IsModifyRecordMappingLoaded = 1;
-    dereplicationModifyRecordParamMap();
+
+    getModifyRecordItems(items);
+    (*m_journal).compact(items);
     
     return 0;
 }
@@ -91,75 +125,126 @@ int MappingSettingModifyRecord::loadModifyRecordParam()
  **/
 int MappingSettingModifyRecord::updateModifyRecordParamMap(ParametersItem *paramItem)
 {
+    int ret = 0;
+
     if( (paramItem->paramName).compare(ERROR_PARAM_ITEM.paramName) == 0 
         || (paramItem->paramName).empty() || (paramItem->modifyTimeStamp).empty()){
         settingsLogError("paramItem[%p], paramName[%s] modifyTimeStamp[%s].\n", paramItem, paramItem->paramName.c_str(), paramItem->modifyTimeStamp.c_str());
         return -1;
     }    
     
-    //if has loaded then: sync  m_paramStatisticsMapping
-    if(IsModifyRecordMappingLoaded == 1){
-        (*m_paramStatisticsMapping).updateStatisticsRecord(paramItem);
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    std::map<std::string, ParamModifyRing>::iterator it = m_paramModifyRecordMap.find(paramItem->paramName);
+    if (it == m_paramModifyRecordMap.end()) {
+        ParamModifyRing ring;
+
+        ring.head  = 0;
+        ring.count = 0;
+        it = m_paramModifyRecordMap.insert(pair<std::string, ParamModifyRing>(paramItem->paramName, ring)).first;
     }
-    pair<std::string, ParametersItem> modifyRecord(paramItem->paramName, *paramItem);
-    m_paramModifyRecordMap.insert(modifyRecord);
+    ret = pushModifyRecordRing(it->second, *paramItem);
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     
 /*     settingsLogVerbose( "updateModifyRecordParamMap paramItem.paramName[%s] newValue[%s] sourceModule[%s] oldValue[%s] modifyTimeStamp[%s] modifiedFile[%s].\n", 
                       (paramItem->paramName).c_str(), (paramItem->newValue).c_str(), (paramItem->sourceModule).c_str(), 
                       (paramItem->oldValue).c_str(), (paramItem->modifyTimeStamp).c_str(), (paramItem->modifiedFile).c_str()
                     );      
  */
-    return 0;
+    return ret;
 }
 
 
 /**
- *  @Func: dereplicationModifyRecordParamMap
- *         ps. :去除多余的时间戳最早的条目，去除重复
- *  @Param: 
+ *  @Func: pushModifyRecordRing
+ *         ps. :按时间先后插入 ring，ring 满时淘汰最早的记录；
+ *              正常情况下新记录的时间最晚，直接放在尾部，不需要移动
+ *  @Param: ring, type:: ParamModifyRing&
+ *          paramItem, type:: ParametersItem&
  *  @Return: int
  *  
  **/
-int MappingSettingModifyRecord::dereplicationModifyRecordParamMap()
+int MappingSettingModifyRecord::pushModifyRecordRing(ParamModifyRing& ring, ParametersItem& paramItem)
 {
-    int count = 0, i = 0;
-    int tmpSize = 0, deleteSize = 0;
-    std::string timeStamp("");
-    std::map<std::string, ParamStatistics>::iterator paramStatisticIt;
-    std::map<std::string, ParamStatistics> paramStatisticsMap = (*m_paramStatisticsMapping).getStatisticsRecordMap();
-    
-    /**
-     *  判断 m_paramStatisticsMapping 中的个数:
-     *  if 大于 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 个：
-     *      获取 m_paramStatisticsMapping 中的时间戳；
-     *      查找时间戳 m_paramModifyRecordMap对应的条目,删除条目；
-     *      计数器 -1；
-     *      更新获取最早的时间戳；
-     *  否则，直接添加；
-     **/
-    for(paramStatisticIt = paramStatisticsMap.begin(); paramStatisticIt != paramStatisticsMap.end(); ++paramStatisticIt){
-        while( (*m_paramStatisticsMapping).getStatisticsRecordCount((paramStatisticIt->second).paramName) > COUNT_OF_PARAM_IN_MODIFY_FILE_MAX ){
-            tmpSize = m_paramModifyRecordMap.size();
-            //删除最早时间戳的条目
-            timeStamp = (*m_paramStatisticsMapping).getStatisticsRecordTimeStamps((paramStatisticIt->second).paramName);
-            deleteModifyRecordByTimeStamp((paramStatisticIt->second).paramName, timeStamp);
-            
-            //更新计数器
-            deleteSize = tmpSize - m_paramModifyRecordMap.size();
-            settingsLogVerbose("name[%s] has been deleted item count[%d] .\n", (paramStatisticIt->second).paramName.c_str(), tmpSize, deleteSize);
-            (*m_paramStatisticsMapping).modifyStatisticsRecordCount((paramStatisticIt->second).paramName, STATISTAC_RECORD_COUNT_FLAG_MINUS, deleteSize);
-            
-            //更新最早时间戳
-            getModifyRecordEarliestTimeStamp((paramStatisticIt->second).paramName, timeStamp);
-            (*m_paramStatisticsMapping).modifyStatisticsRecordTimeStamps((paramStatisticIt->second).paramName, timeStamp);
+    int pos = 0, slot = 0, prev = 0;
+
+    if (ring.count == COUNT_OF_PARAM_IN_MODIFY_FILE_MAX) {
+        if (paramItem.modifyTimeMs < ring.items[ring.head].modifyTimeMs) {  //比保留的记录都早，直接丢弃
+            settingsLogVerbose("name[%s] modifyTimeStamp[%s] is too early, drop.\n", paramItem.paramName.c_str(), paramItem.modifyTimeStamp.c_str());
+            return 0;
         }
-        settingsLogVerbose("name[%s] earliestTimeStamp[%s] recordCount[%d].\n", (paramStatisticIt->second).paramName.c_str(), (paramStatisticIt->second).earliestTimeStamp.c_str(), (paramStatisticIt->second).recordCount);
+        unindexModifyRecord(&ring.items[ring.head]);
+        ring.head = (ring.head + 1) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX;
+        ring.count--;
+        m_recordCount--;
     }
-    
+
+    for (pos = ring.count; pos > 0; pos--) {
+        prev = (ring.head + pos - 1) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX;
+        if (ring.items[prev].modifyTimeMs <= paramItem.modifyTimeMs)
+            break;
+        slot = (ring.head + pos) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX;
+        unindexModifyRecord(&ring.items[prev]);
+        ring.items[slot] = ring.items[prev];
+        indexModifyRecord(&ring.items[slot]);
+    }
+    slot = (ring.head + pos) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX;
+    ring.items[slot] = paramItem;
+    indexModifyRecord(&ring.items[slot]);
+    ring.count++;
+    m_recordCount++;
+
     return 0;
 }
 
 
+/**
+ *  @Func: indexModifyRecord
+ *  @Param: item, type:: const ParametersItem*, ring 中的记录
+ *  @Return: void
+ *  
+ **/
+void MappingSettingModifyRecord::indexModifyRecord(const ParametersItem* item)
+{
+    m_timeIndex.insert(pair<int64_t, const ParametersItem*>(item->modifyTimeMs, item));
+    m_moduleIndex.insert(pair<std::pair<std::string, int64_t>, const ParametersItem*>(make_pair(item->sourceModule, item->modifyTimeMs), item));
+
+    return ;
+}
+
+
+/**
+ *  @Func: unindexModifyRecord
+ *         ps. :在 item 被覆盖之前调用，根据 item 当前的值找到并删除索引
+ *  @Param: item, type:: const ParametersItem*
+ *  @Return: void
+ *  
+ **/
+void MappingSettingModifyRecord::unindexModifyRecord(const ParametersItem* item)
+{
+    pair<ModifyRecordTimeIndex::iterator, ModifyRecordTimeIndex::iterator> timeRange;
+    pair<ModifyRecordModuleIndex::iterator, ModifyRecordModuleIndex::iterator> moduleRange;
+
+    timeRange = m_timeIndex.equal_range(item->modifyTimeMs);
+    for (; timeRange.first != timeRange.second; ++timeRange.first) {
+        if (timeRange.first->second == item) {
+            m_timeIndex.erase(timeRange.first);
+            break;
+        }
+    }
+    moduleRange = m_moduleIndex.equal_range(make_pair(item->sourceModule, item->modifyTimeMs));
+    for (; moduleRange.first != moduleRange.second; ++moduleRange.first) {
+        if (moduleRange.first->second == item) {
+            m_moduleIndex.erase(moduleRange.first);
+            break;
+        }
+    }
+
+    return ;
+}
+
+
 /**
  *  @Func: unloadModifyRecordParam
  *  @Param: 
@@ -172,7 +257,14 @@ int MappingSettingModifyRecord::unloadModifyRecordParam()
         settingsLogError("unloadModifyRecordParam:: m_paramModifyRecordMap has been empty, ERROR.\n");
         return -1;
     }
-    m_paramModifyRecordMap.erase(m_paramModifyRecordMap.begin(), m_paramModifyRecordMap.end());
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    m_timeIndex.clear();
+    m_moduleIndex.clear();
+    m_paramModifyRecordMap.clear();
+    m_recordCount = 0;
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
     settingsLogVerbose("Has unload ModifyRecord OK.\n");
 
     return 0;
@@ -187,32 +279,130 @@ int MappingSettingModifyRecord::unloadModifyRecordParam()
  *  
  **/
 int MappingSettingModifyRecord::getModifyRecordEarliestTimeStamp(std::string& name, std::string& timeStamp)
+{
+    ParamStatistics statistics;
+
+    if (getModifyRecordStatistics(name, statistics) < 0)
+        return -1;
+    timeStamp = statistics.earliestTimeStamp;
+    settingsLogVerbose("GET: name[%s] earliestTimeStamp[%s].\n", name.c_str(), timeStamp.c_str());
+    
+    return 0;
+}
+
+
+/**
+ *  @Func: getModifyRecordCount
+ *  @Param: name, type:: std::string&
+ *  @Return: int, 未找到时返回 0
+ *  
+ **/
+int MappingSettingModifyRecord::getModifyRecordCount(std::string& name)
+{
+    ParamStatistics statistics;
+
+    if (getModifyRecordStatistics(name, statistics) < 0)
+        return 0;
+
+    return statistics.recordCount;
+}
+
+
+/**
+ *  @Func: getModifyRecordStatistics
+ *         ps. :记录条数和最早时间戳直接由 ring 得到
+ *  @Param: name, type:: std::string&
+ *          statistics, type:: ParamStatistics&
+ *  @Return: int
+ *  
+ **/
+int MappingSettingModifyRecord::getModifyRecordStatistics(std::string& name, ParamStatistics& statistics)
 {
     if(name.empty()){
         settingsLogError(" paramName[%s].\n",name.c_str());
         return -1;
     }
-    std::multimap<std::string, ParametersItem>::iterator it = m_paramModifyRecordMap.find(name);
-    
-    if(it == m_paramModifyRecordMap.end()){
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    std::map<std::string, ParamModifyRing>::iterator it = m_paramModifyRecordMap.find(name);
+    if (it == m_paramModifyRecordMap.end() || (it->second).count == 0) {
+        ThreadMutexUnLock(m_mutex);
         settingsLogVerbose("Cannot find ModifyRecordParam[%s] .\n", name.c_str());
         return -1;
     }
-    timeStamp = (it->second).modifyTimeStamp;
-    it = m_paramModifyRecordMap.lower_bound(name);  
-    while(it != m_paramModifyRecordMap.upper_bound(name)) {  
-        settingsLogVerbose("modifyTimeStamp[%s], TimeStamp[%s]\n", (it->second).modifyTimeStamp.c_str(), timeStamp.c_str());
-        if(dateTimeCompare(timeStamp, (it->second).modifyTimeStamp) > 0){
-            timeStamp = (it->second).modifyTimeStamp;
-        }
-        ++it;  
-    } 
-    settingsLogVerbose("GET: name[%s] earliestTimeStamp[%s].\n", name.c_str(), timeStamp.c_str());
-    
+    const ParametersItem& earliest = (it->second).items[(it->second).head];
+    statistics.paramName         = name;
+    statistics.earliestTimeStamp = earliest.modifyTimeStamp;
+    statistics.earliestTimeMs    = earliest.modifyTimeMs;
+    statistics.recordCount       = (it->second).count;
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
     return 0;
 }
 
 
+/**
+ *  @Func: queryModifyRecordByModule
+ *         ps. :查询 sourceModule 在 [beginMs, endMs] 时间段内的修改记录，按时间先后输出
+ *  @Param: module, type:: const std::string&, e.g: "TR069"
+ *          beginMs, type:: int64_t
+ *          endMs, type:: int64_t
+ *          items, type:: std::vector<ParametersItem>&
+ *  @Return: int, 查询到的记录条数
+ *  
+ **/
+int MappingSettingModifyRecord::queryModifyRecordByModule(const std::string& module, int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items)
+{
+    ModifyRecordModuleIndex::iterator it, end;
+    int count = 0;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    it  = m_moduleIndex.lower_bound(make_pair(module, beginMs));
+    end = m_moduleIndex.upper_bound(make_pair(module, endMs));
+    for (; it != end; ++it) {
+        items.push_back(*(it->second));
+        count++;
+    }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    settingsLogVerbose("module[%s] count[%d].\n", module.c_str(), count);
+
+    return count;
+}
+
+
+/**
+ *  @Func: queryModifyRecordByTimeRange
+ *         ps. :查询 [beginMs, endMs] 时间段内的修改记录，按时间先后输出
+ *  @Param: beginMs, type:: int64_t
+ *          endMs, type:: int64_t
+ *          items, type:: std::vector<ParametersItem>&
+ *  @Return: int, 查询到的记录条数
+ *  
+ **/
+int MappingSettingModifyRecord::queryModifyRecordByTimeRange(int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items)
+{
+    ModifyRecordTimeIndex::iterator it, end;
+    int count = 0;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    it  = m_timeIndex.lower_bound(beginMs);
+    end = m_timeIndex.upper_bound(endMs);
+    for (; it != end; ++it) {
+        items.push_back(*(it->second));
+        count++;
+    }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    settingsLogVerbose("time[%lld, %lld] count[%d].\n", (long long)beginMs, (long long)endMs, count);
+
+    return count;
+}
+
+
 /**
  *  @Func: formatingParamItemOutput
  *  @Param: 
@@ -224,37 +414,42 @@ int MappingSettingModifyRecord::formatingParamItemOutput()
 {
     FILE *fp = NULL;
     std::string line("");
-    std::multimap<std::string, ParametersItem>::iterator it;
+    std::map<std::string, ParamModifyRing>::iterator it;
+    int i = 0;
 
     if (ThreadMutexLock(m_mutex))
         settingsLogWarning("thread mutex locking error.\n");
     if ((fp = fopen(m_fileName.c_str(), "wb")) == NULL) {
         settingsLogError("Open file error.(%s)\n", m_fileName.c_str());
+        ThreadMutexUnLock(m_mutex);
         return -1;
     }
 
     line = "CFversion=" + m_version + "\n";
     fwrite(line.c_str(), 1, line.length(), fp);
     for (it = m_paramModifyRecordMap.begin(); it != m_paramModifyRecordMap.end(); ++it) {
-        line  = "Parameter[ "     + it->first;
-        line += " ] @<"           + (it->second).modifyTimeStamp;
-        line += "> modified by[ " + (it->second).sourceModule;
-        if (gSensitiveParamFilter.filteringSensitiveParam(it->first))
-            line += " ]from[ *** ]to[ ***";
-        else {
-            line += " ]from[ "    + (it->second).oldValue;
-            line += " ]to[ "      + (it->second).newValue;
+        for (i = 0; i < (it->second).count; i++) {
+            const ParametersItem& item = (it->second).items[((it->second).head + i) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX];
+
+            line  = "Parameter[ "     + it->first;
+            line += " ] @<"           + item.modifyTimeStamp;
+            line += "> modified by[ " + item.sourceModule;
+            if (gSensitiveParamFilter.filteringSensitiveParam(it->first))
+                line += " ]from[ *** ]to[ ***";
+            else {
+                line += " ]from[ "    + item.oldValue;
+                line += " ]to[ "      + item.newValue;
+            }
+            line += " ]into file[ "   + item.modifiedFile;
+            line += " ].\n";
+            fwrite(line.c_str(), 1, line.length(), fp);
         }
-        line += " ]into file[ "   + (it->second).modifiedFile;
-        line += " ].\n";
-        fwrite(line.c_str(), 1, line.length(), fp);
     }
     fclose(fp);
     if (ThreadMutexUnLock(m_mutex))
         settingsLogWarning("thread mutex locking error.\n");
     settingsLogVerbose("Format Output to [%s] ok.\n", m_fileName.c_str());
 
-    //(*m_paramStatisticsMapping).statisticsRecordMapOutput();  //for test
     return 0;
 }
 
@@ -281,6 +476,7 @@ int MappingSettingModifyRecord::resetModifyRecordOutput()
     fclose(fp);
     if (ThreadMutexUnLock(m_mutex))
         settingsLogWarning("thread mutex locking error.\n");
+    (*m_journal).reset();
     settingsLogVerbose("Reset [%s] ok.\n", m_fileName.c_str());
 
     return 0;
@@ -288,68 +484,91 @@ int MappingSettingModifyRecord::resetModifyRecordOutput()
 
 
 /**
- *  @Func: deleteModifyRecordByTimeStamp
- *  @Param: name, type:: std::string&
- *          timeStamp, type:: std::string&
+ *  @Func: paramModifyRecordMapOutput
+ *  @Param: 
  *  @Return: int
  *  
  **/
-int MappingSettingModifyRecord::deleteModifyRecordByTimeStamp(std::string& name, std::string& timeStamp)
+int MappingSettingModifyRecord::paramModifyRecordMapOutput()
 {
-    std::multimap<std::string, ParametersItem>::iterator it = m_paramModifyRecordMap.find(name);
+    std::map<std::string, ParamModifyRing>::iterator it;
+    int i = 0;
     
-    settingsLogVerbose("RecordParam[%s]  modifyTimeStamp[%s] .\n", name.c_str(), timeStamp.c_str());
-    if(it == m_paramModifyRecordMap.end()){
-        settingsLogError("Cannot find ModifyRecordParam[%s] modifyTimeStamp[%s] .\n", name.c_str(), timeStamp.c_str());
-        return -1;
-    }
-#if 0
-    //delete method 1
-    it = m_paramModifyRecordMap.lower_bound(name);  
-    while(it != m_paramModifyRecordMap.upper_bound(name)) {  
-        settingsLogVerbose("earliestTimeStamp[%s].\n", (it->second).modifyTimeStamp.c_str());
-        if(dateTimeCompare((it->second).modifyTimeStamp, timeStamp) == 0){
-            m_paramModifyRecordMap.erase(it);
+    for(it = m_paramModifyRecordMap.begin(); it != m_paramModifyRecordMap.end(); ++it) {
+        for (i = 0; i < (it->second).count; i++) {
+            const ParametersItem& item = (it->second).items[((it->second).head + i) % COUNT_OF_PARAM_IN_MODIFY_FILE_MAX];
+            cout << "paramModifyRecordMapOutput:: key:"<< it->first << " paramName:" << item.paramName << " newValue:" << item.newValue << " sourceModule: " << item.sourceModule << " oldValue:" << item.oldValue << " modifyTimeStamp:" << item.modifyTimeStamp << " modifiedFile:" << item.modifiedFile  <<endl;
         }
-        ++it;  
-    } 
-#else
-    //delete method 2
-    pair<std::multimap<std::string, ParametersItem>::iterator, std::multimap<std::string, ParametersItem>::iterator> position;
-    position = m_paramModifyRecordMap.equal_range(name);
-    /**
-     *  如果键存在，函数返回2个指针，第一个指针指向键第一个匹配的元素
-     *  第二个指针指向键最后一个匹配的元素的下一位置
-     **/
-    while (position.first != position.second){
-        settingsLogVerbose(" earliestTimeStamp[%s]\n", (position.first->second).modifyTimeStamp.c_str());
-        if(dateTimeCompare(((position.first)->second).modifyTimeStamp, timeStamp) == 0){
-            m_paramModifyRecordMap.erase(position.first);
-        }
-        position.first++;
     }
-#endif
-    settingsLogVerbose("Has delete OK.\n");
     
-    //paramModifyRecordMapOutput();   //for test
-    return  0;
+    return   0;
 }
 
 
 /**
- *  @Func: paramModifyRecordMapOutput
+ *  @Func: getModifyRecordItems
+ *         ps. :按时间先后取出 m_paramModifyRecordMap 中全部记录，用于压缩日志，敏感字段的值已屏蔽
+ *  @Param: items, type:: std::vector<ParametersItem>&
+ *  @Return: int
+ *  
+ **/
+int MappingSettingModifyRecord::getModifyRecordItems(std::vector<ParametersItem>& items)
+{
+    ModifyRecordTimeIndex::iterator it;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    items.reserve(m_recordCount);
+    for (it = m_timeIndex.begin(); it != m_timeIndex.end(); ++it) {
+        items.push_back(*(it->second));
+        maskSensitiveItem(items.back());
+    }
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return items.size();
+}
+
+
+/**
+ *  @Func: appendModifyRecordJournal
+ *         ps. :每次修改只追加一条记录，不再重写整个文件；敏感字段的值以 "***" 写入
+ *  @Param: paramItem, type:: ParametersItem *
+ *  @Return: int
+ *  
+ **/
+int MappingSettingModifyRecord::appendModifyRecordJournal(ParametersItem *paramItem)
+{
+    ParametersItem item;
+
+    if ((paramItem->paramName).empty()) {
+        settingsLogError("paramItem[%p] paramName is empty.\n", paramItem);
+        return -1;
+    }
+    item = *paramItem;
+    maskSensitiveItem(item);
+
+    return (*m_journal).appendRecord(item);
+}
+
+
+/**
+ *  @Func: saveModifyRecordJournal
  *  @Param: 
  *  @Return: int
  *  
  **/
-int MappingSettingModifyRecord::paramModifyRecordMapOutput()
+int MappingSettingModifyRecord::saveModifyRecordJournal()
 {
-    std::multimap<std::string, ParametersItem>::iterator it;
-    
-    for(it = m_paramModifyRecordMap.begin(); it != m_paramModifyRecordMap.end(); ++it)
-        cout << "paramModifyRecordMapOutput:: key:"<< it->first << " paramName:" << (it->second).paramName << " newValue:" << (it->second).newValue << " sourceModule: " << (it->second).sourceModule << " oldValue:" << (it->second).oldValue << " modifyTimeStamp:" << (it->second).modifyTimeStamp << " modifiedFile:" << (it->second).modifiedFile  <<endl;
-    
-    return   0;
+    std::vector<ParametersItem> items;
+
+    if (!(*m_journal).needCompact(m_recordCount))
+        return (*m_journal).sync();
+
+    settingsLogVerbose("journal records[%d], live records[%d], compact.\n", (*m_journal).getRecordCount(), m_recordCount);
+    getModifyRecordItems(items);
+
+    return (*m_journal).compact(items);
 }
 
 
@@ -4,30 +4,54 @@
 #ifdef __cplusplus
 #include <string>
 #include <map>
+#include <vector>
 
 #include "ThreadMutex.h"
 #include "KeepingModifyUtilitys.h"
-#include "MappingSettingStatistics.h"
- 
+#include "ModifyRecordJournal.h"
+
+
+typedef struct _ParamModifyRing { /* 单个参数最近 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 次修改，按时间先后排列 */
+    ParametersItem  items[COUNT_OF_PARAM_IN_MODIFY_FILE_MAX];
+    int             head;       //最早一条记录的下标
+    int             count;      //有效记录条数
+} ParamModifyRing;
+
+typedef std::multimap<int64_t, const ParametersItem*>    ModifyRecordTimeIndex;      //modifyTimeMs -> ring 中的记录
+typedef std::multimap<std::pair<std::string, int64_t>, const ParametersItem*>    ModifyRecordModuleIndex;   //(sourceModule, modifyTimeMs) -> ring 中的记录
+
+
 class MappingSettingModifyRecord { /* 在内存中维护对记录修改的文件中参数的拷贝 */
     public:
         MappingSettingModifyRecord(std::string fileName);
-        ~MappingSettingModifyRecord(){}
-        
+        ~MappingSettingModifyRecord();
+
         int loadModifyRecordParam();        //将文件 m_fileName 中的修改信息加载到 m_paramModifyRecordMap
         int unloadModifyRecordParam();
-        int updateModifyRecordParamMap(ParametersItem *paramItem);   //在每次将修改信息写入到 m_fileName 文件后，更新内存中的文件拷贝 m_paramModifyRecordMap ，
-        int dereplicationModifyRecordParamMap();
+        int updateModifyRecordParamMap(ParametersItem *paramItem);   //添加到参数对应的 ring 中，超出 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 时淘汰最早的记录
         int getModifyRecordEarliestTimeStamp(std::string& name, std::string& timeStamp);
-        int deleteModifyRecordByTimeStamp(std::string& name, std::string& timeStamp);
-        int formatingParamItemOutput();
+        int getModifyRecordCount(std::string& name);
+        int getModifyRecordStatistics(std::string& name, ParamStatistics& statistics);
+        int queryModifyRecordByModule(const std::string& module, int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items);
+        int queryModifyRecordByTimeRange(int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items);
+        int formatingParamItemOutput();     //导出为文本格式的 m_fileName
         int resetModifyRecordOutput();
         int paramModifyRecordMapOutput();
-        
+        int appendModifyRecordJournal(ParametersItem *paramItem);   //追加一条修改记录到 m_journal
+        int saveModifyRecordJournal();      //刷新 m_journal，无效记录过多时压缩
+
     private:
+        int getModifyRecordItems(std::vector<ParametersItem>& items);
+        int pushModifyRecordRing(ParamModifyRing& ring, ParametersItem& paramItem);
+        void indexModifyRecord(const ParametersItem* item);
+        void unindexModifyRecord(const ParametersItem* item);
+
         std::string     m_fileName;         //用来保存参数记录的文件名称，即 PARAM_CHANGE_RECORD_KEEPING_FILE_PATH
-        std::multimap<std::string, ParametersItem>  m_paramModifyRecordMap;
-        MappingSettingStatistics*      m_paramStatisticsMapping;
+        std::map<std::string, ParamModifyRing>  m_paramModifyRecordMap;     //paramName -> 最近的修改记录
+        ModifyRecordTimeIndex           m_timeIndex;
+        ModifyRecordModuleIndex         m_moduleIndex;
+        int                             m_recordCount;      //所有 ring 中的记录总数
+        ModifyRecordJournal*           m_journal;          //修改记录的二进制日志，文件名为 m_fileName + ".journal"
         std::string     m_version;
         ThreadMutex_Type m_mutex;
 };
@@ -37,4 +61,3 @@ class MappingSettingModifyRecord { /* 在内存中维护对记录修改的文件
 
 
 #endif //__MAPPING_SETTING_MODIFY_RECORD_H__
-
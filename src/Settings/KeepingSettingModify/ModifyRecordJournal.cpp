@@ -0,0 +1,449 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "Log/LogC.h"
+#include "logSettings.h"
+#include "ThreadMutex.h"
+
+#include "ModifyRecordJournal.h"
+
+
+using namespace std;
+
+
+/* 记录头写入文件时不允许出现编译器填充带来的长度变化 */
+typedef char JournalFileHeaderSizeCheck[(sizeof(JournalFileHeader) == 16) ? 1 : -1];
+typedef char JournalRecordHeaderSizeCheck[(sizeof(JournalRecordHeader) == 40) ? 1 : -1];
+
+#define JOURNAL_RECORD_CRC_OFFSET   (offsetof(JournalRecordHeader, sequence))
+
+
+/* crc 表在静态初始化时生成，多个线程同时追加记录时不需要再判断是否已初始化 */
+class JournalCrcTable {
+    public:
+        JournalCrcTable()
+        {
+            uint32_t c = 0;
+            int n = 0, k = 0;
+
+            for (n = 0; n < 256; n++) {
+                c = (uint32_t)n;
+                for (k = 0; k < 8; k++)
+                    c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+                m_table[n] = c;
+            }
+        }
+
+        uint32_t m_table[256];
+};
+
+static const JournalCrcTable gJournalCrcTable;
+
+
+/**
+ *  @Func: journalCrc32
+ *         ps. :标准 crc32 (zlib/png 多项式)，crc 初值传 0
+ *  @Param: crc, type:: uint32_t
+ *          data, type:: const uint8_t*
+ *          length, type:: size_t
+ *  @Return: uint32_t
+ *
+ **/
+uint32_t journalCrc32(uint32_t crc, const uint8_t* data, size_t length)
+{
+    crc = crc ^ 0xFFFFFFFF;
+    while (length--)
+        crc = gJournalCrcTable.m_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+ModifyRecordJournal::ModifyRecordJournal(std::string fileName)
+    : m_fileName(fileName)
+    , m_fd(-1)
+    , m_sequence(0)
+    , m_recordCount(0)
+{
+    m_mutex = ThreadMutexCreate( );
+}
+
+
+ModifyRecordJournal::~ModifyRecordJournal()
+{
+    close();
+    ThreadMutexDestroy(m_mutex);
+}
+
+
+/**
+ *  @Func: isExist
+ *  @Param:
+ *  @Return: bool
+ *
+ **/
+bool ModifyRecordJournal::isExist()
+{
+    struct stat st;
+
+    return (stat(m_fileName.c_str(), &st) == 0 && st.st_size >= (off_t)sizeof(JournalFileHeader));
+}
+
+
+/**
+ *  @Func: writeFileHeader
+ *  @Param: fd, type:: int
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::writeFileHeader(int fd)
+{
+    JournalFileHeader header;
+
+    memset(&header, 0, sizeof(header));
+    header.magic            = MODIFY_RECORD_JOURNAL_MAGIC;
+    header.version          = MODIFY_RECORD_JOURNAL_VERSION;
+    header.headerSize       = sizeof(JournalFileHeader);
+    header.recordHeaderSize = sizeof(JournalRecordHeader);
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        settingsLogError("write journal header error.(%s)\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ *  @Func: open
+ *         ps. :以 O_APPEND 方式打开日志, 不存在或文件头无效时重新创建
+ *  @Param:
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::open()
+{
+    if (m_fd >= 0)
+        return 0;
+
+    m_fd = ::open(m_fileName.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (m_fd < 0) {
+        settingsLogError("Open file error.(%s) %s\n", m_fileName.c_str(), strerror(errno));
+        return -1;
+    }
+    if (lseek(m_fd, 0, SEEK_END) < (off_t)sizeof(JournalFileHeader)) {
+        if (ftruncate(m_fd, 0) < 0 || writeFileHeader(m_fd) < 0) {
+            ::close(m_fd);
+            m_fd = -1;
+            return -1;
+        }
+    }
+    settingsLogVerbose("Open journal [%s] ok.\n", m_fileName.c_str());
+
+    return 0;
+}
+
+
+void ModifyRecordJournal::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+
+/**
+ *  @Func: loadRecords
+ *         ps. :mmap 整个日志文件，逐条校验 crc 并解析到 items；
+ *              遇到不完整或校验失败的记录时截断文件，之后的追加从截断处开始
+ *  @Param: items, type:: std::vector<ParametersItem>&
+ *  @Return: int, 有效记录条数
+ *
+ **/
+int ModifyRecordJournal::loadRecords(std::vector<ParametersItem>& items)
+{
+    struct stat st;
+    const uint8_t* base = NULL;
+    size_t offset = 0, validLength = 0;
+    JournalFileHeader fileHeader;
+    JournalRecordHeader recordHeader;
+    ParametersItem item;
+    int fd = -1, count = 0;
+
+    fd = ::open(m_fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        settingsLogWarning("Open file error.(%s)\n", m_fileName.c_str());
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(JournalFileHeader)) {
+        ::close(fd);
+        return -1;
+    }
+    base = (const uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        settingsLogError("mmap [%s] error.(%s)\n", m_fileName.c_str(), strerror(errno));
+        return -1;
+    }
+    madvise((void*)base, st.st_size, MADV_SEQUENTIAL);
+
+    memcpy(&fileHeader, base, sizeof(fileHeader));
+    if (fileHeader.magic != MODIFY_RECORD_JOURNAL_MAGIC || fileHeader.version != MODIFY_RECORD_JOURNAL_VERSION
+        || fileHeader.recordHeaderSize != sizeof(JournalRecordHeader)) {
+        settingsLogWarning("The available information is not found.(%s)\n", m_fileName.c_str());
+        munmap((void*)base, st.st_size);
+        return -1;
+    }
+
+    offset = fileHeader.headerSize;
+    validLength = offset;
+    while (offset + sizeof(JournalRecordHeader) <= (size_t)st.st_size) {
+        const uint8_t* payload = NULL;
+
+        memcpy(&recordHeader, base + offset, sizeof(recordHeader));   //记录在文件中不保证对齐
+        if (recordHeader.magic != MODIFY_RECORD_RECORD_MAGIC
+            || recordHeader.payloadLength != (uint32_t)recordHeader.nameLength + recordHeader.oldLength
+                                                + recordHeader.newLength + recordHeader.sourceLength + recordHeader.fileLength
+            || offset + sizeof(JournalRecordHeader) + recordHeader.payloadLength > (size_t)st.st_size) {
+            settingsLogWarning("journal record at offset[%u] is broken.\n", (unsigned int)offset);
+            break;
+        }
+        if (journalCrc32(0, base + offset + JOURNAL_RECORD_CRC_OFFSET,
+                        sizeof(JournalRecordHeader) - JOURNAL_RECORD_CRC_OFFSET + recordHeader.payloadLength) != recordHeader.crc32) {
+            settingsLogWarning("journal record at offset[%u] crc error.\n", (unsigned int)offset);
+            break;
+        }
+
+        payload = base + offset + sizeof(JournalRecordHeader);
+        item.paramName.assign((const char*)payload, recordHeader.nameLength);
+        payload += recordHeader.nameLength;
+        item.oldValue.assign((const char*)payload, recordHeader.oldLength);
+        payload += recordHeader.oldLength;
+        item.newValue.assign((const char*)payload, recordHeader.newLength);
+        payload += recordHeader.newLength;
+        item.sourceModule.assign((const char*)payload, recordHeader.sourceLength);
+        payload += recordHeader.sourceLength;
+        item.modifiedFile.assign((const char*)payload, recordHeader.fileLength);
+        item.modifyTimeMs = recordHeader.modifyTimeMs;
+        item.modifyTimeStamp = epochMsToDateTimeString(recordHeader.modifyTimeMs);
+        items.push_back(item);
+
+        m_sequence = recordHeader.sequence + 1;
+        offset += sizeof(JournalRecordHeader) + recordHeader.payloadLength;
+        validLength = offset;
+        count++;
+    }
+    munmap((void*)base, st.st_size);
+
+    if (validLength < (size_t)st.st_size) {
+        settingsLogWarning("truncate journal [%s] from [%ld] to [%u].\n", m_fileName.c_str(), (long)st.st_size, (unsigned int)validLength);
+        if (truncate(m_fileName.c_str(), validLength) < 0)
+            settingsLogError("truncate [%s] error.(%s)\n", m_fileName.c_str(), strerror(errno));
+    }
+    m_recordCount = count;
+    settingsLogVerbose("Load %s ok, records[%d].\n", m_fileName.c_str(), count);
+
+    return count;
+}
+
+
+/**
+ *  @Func: encodeRecord
+ *  @Param: item, type:: const ParametersItem&
+ *          sequence, type:: uint32_t
+ *          buffer, type:: std::string&, 输出编码后的记录
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::encodeRecord(const ParametersItem& item, uint32_t sequence, std::string& buffer)
+{
+    JournalRecordHeader header;
+
+    if (item.paramName.size() > MODIFY_RECORD_FIELD_LENGTH_MAX || item.oldValue.size() > MODIFY_RECORD_FIELD_LENGTH_MAX
+        || item.newValue.size() > MODIFY_RECORD_FIELD_LENGTH_MAX || item.sourceModule.size() > MODIFY_RECORD_FIELD_LENGTH_MAX
+        || item.modifiedFile.size() > MODIFY_RECORD_FIELD_LENGTH_MAX) {
+        settingsLogError("paramName[%s] field too long.\n", item.paramName.c_str());
+        return -1;
+    }
+    memset(&header, 0, sizeof(header));
+    header.magic         = MODIFY_RECORD_RECORD_MAGIC;
+    header.sequence      = sequence;
+    header.modifyTimeMs  = item.modifyTimeMs;
+    header.nameLength    = item.paramName.size();
+    header.oldLength     = item.oldValue.size();
+    header.newLength     = item.newValue.size();
+    header.sourceLength  = item.sourceModule.size();
+    header.fileLength    = item.modifiedFile.size();
+    header.payloadLength = header.nameLength + header.oldLength + header.newLength + header.sourceLength + header.fileLength;
+
+    buffer.reserve(buffer.size() + sizeof(header) + header.payloadLength);
+    size_t start = buffer.size();
+    buffer.append((const char*)&header, sizeof(header));
+    buffer.append(item.paramName);
+    buffer.append(item.oldValue);
+    buffer.append(item.newValue);
+    buffer.append(item.sourceModule);
+    buffer.append(item.modifiedFile);
+
+    header.crc32 = journalCrc32(0, (const uint8_t*)buffer.data() + start + JOURNAL_RECORD_CRC_OFFSET,
+                                sizeof(header) - JOURNAL_RECORD_CRC_OFFSET + header.payloadLength);
+    buffer.replace(start + offsetof(JournalRecordHeader, crc32), sizeof(header.crc32), (const char*)&header.crc32, sizeof(header.crc32));
+
+    return 0;
+}
+
+
+/**
+ *  @Func: appendRecord
+ *         ps. :一次 write() 追加一条完整记录
+ *  @Param: item, type:: const ParametersItem&
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::appendRecord(const ParametersItem& item)
+{
+    std::string buffer("");
+    ssize_t ret = 0;
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    if (m_fd < 0 && open() < 0) {
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    if (encodeRecord(item, m_sequence, buffer) < 0) {
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    ret = write(m_fd, buffer.data(), buffer.size());
+    if (ret != (ssize_t)buffer.size()) {
+        settingsLogError("append journal error, ret[%d] size[%d].(%s)\n", (int)ret, (int)buffer.size(), strerror(errno));
+        if (ret > 0) {  //写了半条记录, 回退，避免下次加载时截断掉后续记录
+            off_t end = lseek(m_fd, 0, SEEK_END);
+            if (ftruncate(m_fd, end - ret) < 0)
+                settingsLogError("ftruncate error.(%s)\n", strerror(errno));
+        }
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    m_sequence++;
+    m_recordCount++;
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    settingsLogVerbose("append paramName[%s] to journal ok.\n", item.paramName.c_str());
+
+    return 0;
+}
+
+
+/**
+ *  @Func: sync
+ *  @Param:
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::sync()
+{
+    if (m_fd < 0)
+        return 0;
+
+    return fdatasync(m_fd);
+}
+
+
+/**
+ *  @Func: needCompact
+ *  @Param: liveRecordCount, type:: int, 内存中仍然保留的记录条数
+ *  @Return: bool
+ *
+ **/
+bool ModifyRecordJournal::needCompact(int liveRecordCount)
+{
+    if (m_recordCount < MODIFY_RECORD_JOURNAL_COMPACT_MIN_RECORDS)
+        return false;
+
+    return (m_recordCount - liveRecordCount) > liveRecordCount * MODIFY_RECORD_JOURNAL_COMPACT_RATIO;
+}
+
+
+/**
+ *  @Func: compact
+ *         ps. :将 items 写入临时文件，fsync 后 rename 覆盖原日志，保证任意时刻掉电都有一份完整的日志；
+ *              在锁内重新打开日志，避免并发的 appendRecord() 写到已关闭的 fd
+ *  @Param: items, type:: const std::vector<ParametersItem>&
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::compact(const std::vector<ParametersItem>& items)
+{
+    std::string tmpFile = m_fileName + ".tmp";
+    std::string buffer("");
+    std::vector<ParametersItem>::const_iterator it;
+    uint32_t sequence = 0;
+    int fd = -1, ret = 0;
+
+    for (it = items.begin(); it != items.end(); ++it) {
+        if (encodeRecord(*it, sequence, buffer) == 0)
+            sequence++;
+    }
+
+    if (ThreadMutexLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        settingsLogError("Open file error.(%s)\n", tmpFile.c_str());
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    if (writeFileHeader(fd) < 0
+        || (!buffer.empty() && write(fd, buffer.data(), buffer.size()) != (ssize_t)buffer.size())
+        || fsync(fd) < 0) {
+        settingsLogError("write [%s] error.(%s)\n", tmpFile.c_str(), strerror(errno));
+        ::close(fd);
+        unlink(tmpFile.c_str());
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    ::close(fd);
+    if (rename(tmpFile.c_str(), m_fileName.c_str()) < 0) {
+        settingsLogError("rename [%s] error.(%s)\n", tmpFile.c_str(), strerror(errno));
+        unlink(tmpFile.c_str());
+        ThreadMutexUnLock(m_mutex);
+        return -1;
+    }
+    close();
+    m_sequence = sequence;
+    m_recordCount = sequence;
+    ret = open();
+    if (ThreadMutexUnLock(m_mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    settingsLogVerbose("Compact [%s] ok, records[%u].\n", m_fileName.c_str(), sequence);
+
+    return ret;
+}
+
+
+/**
+ *  @Func: reset
+ *  @Param:
+ *  @Return: int
+ *
+ **/
+int ModifyRecordJournal::reset()
+{
+    std::vector<ParametersItem> items;
+
+    return compact(items);
+}
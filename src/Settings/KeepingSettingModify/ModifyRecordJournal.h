@@ -0,0 +1,96 @@
+#ifndef __MODIFY_RECORD_JOURNAL_H__
+#define __MODIFY_RECORD_JOURNAL_H__
+
+#ifdef __cplusplus
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "ThreadMutex.h"
+#include "KeepingModifyUtilitys.h"
+
+
+/**
+ *  参数修改记录的二进制日志文件(只追加写)
+ *
+ *  文件格式：
+ *      JournalFileHeader  (16 Byte)
+ *      JournalRecordHeader + payload(paramName, oldValue, newValue, sourceModule, modifiedFile)
+ *      JournalRecordHeader + payload
+ *      ...
+ *
+ *  每条记录头长度固定，crc32 校验 record header(crc字段之后) + payload；
+ *  加载时遇到 magic/crc 错误的记录（掉电导致的半条记录），截断到最后一条完整记录。
+ *  多字节字段均按小端存储（目标平台 arm/mips/x86 均为小端）。
+ **/
+#define     MODIFY_RECORD_JOURNAL_MAGIC         0x4A524D50  //"PMRJ"
+#define     MODIFY_RECORD_JOURNAL_VERSION       1
+#define     MODIFY_RECORD_RECORD_MAGIC          0x5243      //"CR"
+#define     MODIFY_RECORD_FIELD_LENGTH_MAX      0xFFFF
+
+/* 日志中无效记录数超过有效记录数的 COMPACT_RATIO 倍，且总记录数超过 COMPACT_MIN_RECORDS 时压缩 */
+#define     MODIFY_RECORD_JOURNAL_COMPACT_RATIO         2
+#define     MODIFY_RECORD_JOURNAL_COMPACT_MIN_RECORDS   64
+
+
+typedef struct _JournalFileHeader {
+    uint32_t    magic;          //MODIFY_RECORD_JOURNAL_MAGIC
+    uint16_t    version;        //MODIFY_RECORD_JOURNAL_VERSION
+    uint16_t    headerSize;     //sizeof(JournalFileHeader)
+    uint32_t    recordHeaderSize;   //sizeof(JournalRecordHeader)
+    uint32_t    reserved;
+} JournalFileHeader;
+
+typedef struct _JournalRecordHeader {
+    uint16_t    magic;          //MODIFY_RECORD_RECORD_MAGIC
+    uint16_t    flags;
+    uint32_t    crc32;          //crc32(sequence ... payload)
+    uint32_t    sequence;       //记录序号，单调递增
+    uint32_t    payloadLength;  //nameLength + oldLength + newLength + sourceLength + fileLength
+    int64_t     modifyTimeMs;   //修改时间, epoch 毫秒
+    uint16_t    nameLength;
+    uint16_t    oldLength;
+    uint16_t    newLength;
+    uint16_t    sourceLength;
+    uint16_t    fileLength;
+    uint16_t    reserved[3];
+} JournalRecordHeader;
+
+
+class ModifyRecordJournal { /* 参数修改记录的追加写日志 */
+    public:
+        ModifyRecordJournal(std::string fileName);
+        ~ModifyRecordJournal();
+
+        int open();                                             //打开(不存在则创建)日志文件
+        void close();
+        bool isExist();
+        int loadRecords(std::vector<ParametersItem>& items);    //mmap 方式读取全部有效记录
+        int appendRecord(const ParametersItem& item);           //追加一条记录，O(1)
+        int sync();
+        int compact(const std::vector<ParametersItem>& items);  //用 items 重写日志，丢弃已淘汰的记录
+        bool needCompact(int liveRecordCount);
+        int reset();
+        int getRecordCount() { return m_recordCount; }
+
+    private:
+        int writeFileHeader(int fd);
+        int encodeRecord(const ParametersItem& item, uint32_t sequence, std::string& buffer);
+
+        std::string     m_fileName;
+        int             m_fd;
+        uint32_t        m_sequence;         //下一条记录的序号
+        int             m_recordCount;      //日志中的记录条数(包括已被淘汰的记录)
+        ThreadMutex_Type m_mutex;
+};
+
+
+uint32_t journalCrc32(uint32_t crc, const uint8_t* data, size_t length);
+
+
+#endif  // __cplusplus
+
+
+
+#endif //__MODIFY_RECORD_JOURNAL_H__
@@ -1,52 +1,389 @@
 #include <iostream>
+#include <queue>
 
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 
 #include "Log/LogC.h"
 #include "logSettings.h"
 #include "ThreadMutex.h"
 #include "SensitiveParamFiltering.h"
- 
+
 using namespace std;
 
+
+/* 使用 const char* 常量初始化，保证在 gSensitiveParamFilter 构造之前可用 */
+static const char* gSensitiveListStr[] = {"ntvpasswd", "ntvAESpasswd", "defContPwd", "defAESContpwd",
+                                        "netpasswd", "syncntvpasswd", "syncntvAESpasswd", "netAESpasswd", "dhcppasswd", "ipoeAESpasswd", "wifi_password",
+                                        "authbg_md5", "bootlogo_md5",
+                                        "Device.ManagementServer.Password",
+                                        "Device.ManagementServer.ConnectionRequestPassword",
+                                        "Device.ManagementServer.STUNPassword",
+                                        "*Password"
+                                        };
+
 extern "C" {
 SensitiveParamFiltering gSensitiveParamFilter;
 }
 
-static std::string gSensitiveListStr[] = {"ntvpasswd", "ntvAESpasswd", "defContPwd", "defAESContpwd", 
-                                        "netpasswd", "syncntvpasswd", "syncntvAESpasswd", "netAESpasswd", "dhcppasswd", "ipoeAESpasswd", "wifi_password", 
-                                        "authbg_md5", "bootlogo_md5", 
-                                        "Device.ManagementServer.Password", 
-                                        "Device.ManagementServer.ConnectionRequestPassword", 
-                                        "Device.ManagementServer.STUNPassword"
-                                        };
-                                        
+#define SENSITIVE_MATCHER_STATE_MAX     0xFFFF
+#define SENSITIVE_MASK_STRING           "***"
+
+/* 字段名中允许出现的字符，用于判断日志中字段名的边界 */
+#define isNameChar(c)   (isalnum((uint8_t)(c)) || (c) == '_' || (c) == '.' || (c) == '-')
+
+
+static void sensitiveLogLineFilter(char* buf, int size, void* userData)
+{
+    if (userData == NULL)   //正在注册或取消
+        return ;
+    ((SensitiveParamFiltering*)userData)->maskSensitiveText(buf, strlen(buf));
+
+    return ;
+}
+
+
+SensitivePatternMatcher::SensitivePatternMatcher()
+    : m_classCount(1)
+{
+    memset(m_charClass, 0, sizeof(m_charClass));
+    m_transition.assign(1, 0);
+    m_output.resize(1);
+}
+
+
+/**
+ *  @Func: parseRule
+ *  @Param: rule, type:: const std::string&
+ *          parsed, type:: SensitiveRule&
+ *  @Return: int
+ *
+ **/
+int SensitivePatternMatcher::parseRule(const std::string& rule, SensitiveRule& parsed)
+{
+    bool head = (!rule.empty() && rule[0] == '*');
+    bool tail = (rule.size() > 1 && rule[rule.size() - 1] == '*');
+    std::string::size_type start = head ? 1 : 0;
+    std::string::size_type end = tail ? rule.size() - 1 : rule.size();
+
+    if (end <= start || rule.find('*', start) < end)    //只支持首尾通配
+        return -1;
+    parsed.literal = rule.substr(start, end - start);
+    if (head && tail)
+        parsed.type = SensitiveRule_Contains;
+    else if (head)
+        parsed.type = SensitiveRule_Suffix;
+    else if (tail)
+        parsed.type = SensitiveRule_Prefix;
+    else
+        parsed.type = SensitiveRule_Exact;
+
+    return 0;
+}
+
+
+/**
+ *  @Func: compile
+ *         ps. :建立 trie，再按层次遍历计算失败转移，并把失败转移合并进转移表，
+ *              匹配时每个字符只需查一次表
+ *  @Param: rules, type:: const std::vector<std::string>&
+ *  @Return: int
+ *
+ **/
+int SensitivePatternMatcher::compile(const std::vector<std::string>& rules)
+{
+    std::vector<std::string>::const_iterator it;
+    std::vector<int> trie, fail;
+    std::queue<int> states;
+    SensitiveRule parsed;
+    int state = 0, next = 0, c = 0, i = 0;
+    size_t k = 0;
+
+    memset(m_charClass, 0, sizeof(m_charClass));
+    m_classCount = 1;
+    m_rules.clear();
+    for (it = rules.begin(); it != rules.end(); ++it) {
+        if (parseRule(*it, parsed) < 0)
+            continue;
+        for (k = 0; k < parsed.literal.size(); k++) {
+            uint8_t ch = tolower((uint8_t)parsed.literal[k]);
+            if (m_charClass[ch] == 0) {
+                if (m_classCount == 256)
+                    return -1;
+                m_charClass[ch] = m_charClass[toupper(ch)] = m_classCount++;
+            }
+        }
+        m_rules.push_back(parsed);
+    }
+
+    //trie, -1 表示没有转移
+    trie.assign(m_classCount, -1);
+    m_output.assign(1, std::vector<int>());
+    for (i = 0; i < (int)m_rules.size(); i++) {
+        state = 0;
+        for (k = 0; k < m_rules[i].literal.size(); k++) {
+            c = m_charClass[(uint8_t)m_rules[i].literal[k]];
+            if (trie[state * m_classCount + c] < 0) {
+                next = m_output.size();
+                if (next >= SENSITIVE_MATCHER_STATE_MAX)
+                    return -1;
+                trie[state * m_classCount + c] = next;
+                trie.resize(trie.size() + m_classCount, -1);
+                m_output.push_back(std::vector<int>());
+            }
+            state = trie[state * m_classCount + c];
+        }
+        m_output[state].push_back(i);
+    }
+
+    m_transition.assign(trie.size(), 0);
+    fail.assign(m_output.size(), 0);
+    for (c = 0; c < m_classCount; c++) {
+        next = trie[c];
+        if (next > 0) {
+            m_transition[c] = next;
+            states.push(next);
+        }
+    }
+    while (!states.empty()) {
+        state = states.front();
+        states.pop();
+        m_output[state].insert(m_output[state].end(), m_output[fail[state]].begin(), m_output[fail[state]].end());
+        for (c = 0; c < m_classCount; c++) {
+            next = trie[state * m_classCount + c];
+            if (next > 0) {
+                fail[next] = m_transition[fail[state] * m_classCount + c];
+                m_transition[state * m_classCount + c] = next;
+                states.push(next);
+            } else {
+                m_transition[state * m_classCount + c] = m_transition[fail[state] * m_classCount + c];
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ *  @Func: isRuleMatched
+ *  @Param: rule, type:: int
+ *          start, type:: int, 匹配到的字符串在 name 中的起始位置
+ *          end, type:: int, 结束位置(不包含)
+ *          length, type:: int, name 的长度
+ *  @Return: bool
+ *
+ **/
+bool SensitivePatternMatcher::isRuleMatched(int rule, int start, int end, int length)
+{
+    switch (m_rules[rule].type) {
+    case SensitiveRule_Exact:
+        return (start == 0 && end == length);
+    case SensitiveRule_Prefix:
+        return (start == 0);
+    case SensitiveRule_Suffix:
+        return (end == length);
+    default:
+        return true;
+    }
+}
+
+
+/**
+ *  @Func: matchName
+ *  @Param: name, type:: const char*
+ *          length, type:: int
+ *  @Return: bool
+ *
+ **/
+bool SensitivePatternMatcher::matchName(const char* name, int length)
+{
+    std::vector<int>::iterator it;
+    int state = 0, i = 0;
+
+    for (i = 0; i < length; i++) {
+        state = m_transition[state * m_classCount + m_charClass[(uint8_t)name[i]]];
+        for (it = m_output[state].begin(); it != m_output[state].end(); ++it) {
+            if (isRuleMatched(*it, i + 1 - m_rules[*it].literal.size(), i + 1, length))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ *  @Func: maskRange
+ *         ps. :[start, end) 不少于 3 个字符时替换为 "***"，否则逐字符替换为 '*'
+ *  @Param: text, type:: char*
+ *          length, type:: int
+ *          start, type:: int
+ *          end, type:: int
+ *  @Return: int, 屏蔽后的 text 长度
+ *
+ **/
+int SensitivePatternMatcher::maskRange(char* text, int length, int start, int end)
+{
+    int maskLength = strlen(SENSITIVE_MASK_STRING);
+
+    if (end - start < maskLength) {
+        memset(text + start, '*', end - start);
+        return length;
+    }
+    memcpy(text + start, SENSITIVE_MASK_STRING, maskLength);
+    memmove(text + start + maskLength, text + end, length - end + 1);
+
+    return length - (end - start - maskLength);
+}
+
+
+/**
+ *  @Func: maskValue
+ *         ps. :屏蔽 position(敏感字段名之后) 开始的值，支持以下格式：
+ *              name=value, name: value, name[...] value[...] / newValue[...] / oldValue[...]
+ *  @Param: text, type:: char*
+ *          length, type:: int
+ *          position, type:: int
+ *  @Return: int, 屏蔽后的 text 长度
+ *
+ **/
+int SensitivePatternMatcher::maskValue(char* text, int length, int position)
+{
+    int start = 0, end = 0, label = 0, i = 0, newLength = 0;
+    char close = 0;
+
+    while (position < length && (text[position] == ']' || text[position] == '"' || text[position] == '\''))
+        position++;
+    while (position < length && text[position] == ' ')
+        position++;
+    if (position < length && (text[position] == '=' || text[position] == ':')) {
+        position++;
+        while (position < length && text[position] == ' ')
+            position++;
+        if (position < length && (text[position] == '"' || text[position] == '\'' || text[position] == '[')) {
+            close = (text[position] == '[') ? ']' : text[position];
+            position++;
+        }
+        start = end = position;
+        while (end < length && text[end] != close && !(close == 0 && strchr(" \t\r\n,;&)]\"'", text[end])))
+            end++;
+
+        return maskRange(text, length, start, end);
+    }
+
+    //屏蔽后面所有形如 xxxValue[...] 的字段
+    for (i = position; i < length; i++) {
+        if (text[i] != '[')
+            continue;
+        for (label = i; label > position && isNameChar(text[label - 1]); label--)
+            ;
+        if (i - label < 5 || strncasecmp(text + i - 5, "value", 5) != 0)
+            continue;
+        for (end = i + 1; end < length && text[end] != ']'; end++)
+            ;
+        newLength = maskRange(text, length, i + 1, end);
+        i = end - (length - newLength);
+        length = newLength;
+    }
+
+    return length;
+}
+
+
+/**
+ *  @Func: maskText
+ *         ps. :单次扫描 text，规则按完整的字段名(前后不是字段名字符)判断是否匹配
+ *  @Param: text, type:: char*, '\0' 结尾
+ *          length, type:: int
+ *  @Return: int, 屏蔽后的 text 长度
+ *
+ **/
+int SensitivePatternMatcher::maskText(char* text, int length)
+{
+    std::vector<int>::iterator it;
+    int state = 0, i = 0, start = 0, end = 0, literalStart = 0;
+
+    for (i = 0; i < length; i++) {
+        state = m_transition[state * m_classCount + m_charClass[(uint8_t)text[i]]];
+        for (it = m_output[state].begin(); it != m_output[state].end(); ++it) {
+            literalStart = i + 1 - m_rules[*it].literal.size();
+            for (start = literalStart; start > 0 && isNameChar(text[start - 1]); start--)
+                ;
+            for (end = i + 1; end < length && isNameChar(text[end]); end++)
+                ;
+            if (isRuleMatched(*it, literalStart - start, i + 1 - start, end - start)) {
+                length = maskValue(text, length, end);
+                i = end - 1;
+                state = 0;
+                break;
+            }
+        }
+    }
+
+    return length;
+}
+
+
 SensitiveParamFiltering::SensitiveParamFiltering()
 {
-    settingsLogVerbose("\n");
     int i = 0;
-    for(i = 0; i < 16; i++){
-        //m_sensitiveParamFilter.push_back(gSensitiveListStr[i]);
-    }    
+
+    settingsLogVerbose("\n");
+    for(i = 0; i < (int)(sizeof(gSensitiveListStr) / sizeof(gSensitiveListStr[0])); i++){
+        m_sensitiveParamFilter.push_back(gSensitiveListStr[i]);
+    }
+    m_mutex = ThreadMutexCreate( );
+    m_matcher = new SensitivePatternMatcher();
+    if ((*m_matcher).compile(m_sensitiveParamFilter) < 0)
+        settingsLogError("compile sensitive param filter ERROR.\n");
+    logLineFilterRegister(sensitiveLogLineFilter, this);
+}
+
+
+SensitiveParamFiltering::~SensitiveParamFiltering()
+{
+    logLineFilterRegister(NULL, NULL);
+    delete m_matcher;
+    m_matcher = NULL;
+    ThreadMutexDestroy(m_mutex);
 }
 
 
 /**
  *  @Func: filteringSensitiveParam
- *  @Param: param, type:: std::string
+ *  @Param: param, type:: const std::string&
  *  @Return: bool
- *  
+ *
  **/
-bool SensitiveParamFiltering::filteringSensitiveParam(std::string param)
+bool SensitiveParamFiltering::filteringSensitiveParam(const std::string& param)
 {
-    std::vector<std::string>::iterator it;
-    
-    for (it = m_sensitiveParamFilter.begin(); it != m_sensitiveParamFilter.end(); ++it) {
-        if ((*it).compare(param) == 0)
-            return true;
-    }
-    
-    return false;
+    bool ret = false;
+
+    ThreadMutexLock(m_mutex);
+    ret = (*m_matcher).matchName(param.c_str(), param.size());
+    ThreadMutexUnLock(m_mutex);
+
+    return ret;
+}
+
+
+/**
+ *  @Func: maskSensitiveText
+ *         ps. :注册为日志行过滤函数，日志中不能在持有 m_mutex 时输出
+ *  @Param: text, type:: char*, '\0' 结尾
+ *          length, type:: int
+ *  @Return: int
+ *
+ **/
+int SensitiveParamFiltering::maskSensitiveText(char* text, int length)
+{
+    ThreadMutexLock(m_mutex);
+    length = (*m_matcher).maskText(text, length);
+    ThreadMutexUnLock(m_mutex);
+
+    return length;
 }
 
 
@@ -54,46 +391,72 @@ bool SensitiveParamFiltering::filteringSensitiveParam(std::string param)
  *  @Func: addSensitiveParam
  *  @Param: param, type:: std::string
  *  @Return: bool
- *  
+ *
  **/
 bool SensitiveParamFiltering::addSensitiveParam(std::string& param)
 {
+    SensitivePatternMatcher* matcher = NULL;
+    std::vector<std::string> filter;
+    bool changed = true;
+
     if(param.empty()){
         settingsLogError("param[%s] cannot empty, ERROR.\n", param.c_str());
         return false;
-    } 
-    m_sensitiveParamFilter.push_back(param);
-    
+    }
+    while (changed) {
+        ThreadMutexLock(m_mutex);
+        filter = m_sensitiveParamFilter;
+        ThreadMutexUnLock(m_mutex);
+        filter.push_back(param);
+
+        //在锁外编译，编译成功后再替换
+        matcher = new SensitivePatternMatcher();
+        if ((*matcher).compile(filter) < 0) {
+            delete matcher;
+            settingsLogError("param[%s] compile ERROR.\n", param.c_str());
+            return false;
+        }
+        //编译期间其他线程添加了规则时重新编译，否则其规则会丢失；列表只增不减，比较长度即可
+        ThreadMutexLock(m_mutex);
+        changed = (m_sensitiveParamFilter.size() + 1 != filter.size());
+        if (!changed) {
+            m_sensitiveParamFilter.push_back(param);
+            std::swap(m_matcher, matcher);
+        }
+        ThreadMutexUnLock(m_mutex);
+        delete matcher;
+    }
+
     return true;
 }
 
 
 /**
  *  @Func: sensitiveParamFilterOutput
- *  @Param: 
+ *  @Param:
  *  @Return: int
- *  
+ *
  **/
 int SensitiveParamFiltering::sensitiveParamFilterOutput()
 {
     std::vector<std::string>::iterator it;
-    
-    for (it = m_sensitiveParamFilter.begin(); it != m_sensitiveParamFilter.end(); ++it) 
+
+    for (it = m_sensitiveParamFilter.begin(); it != m_sensitiveParamFilter.end(); ++it)
         cout << "sensitiveParamFilterOutput:: key: " << *it <<endl;
 
     return   0;
 }
 
- 
- 
- 
- 
- 
- 
- 
- 
- 
- 
+
+
+
+
+
+
+
+
+
+
 
 
 
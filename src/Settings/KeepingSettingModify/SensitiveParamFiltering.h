@@ -8,17 +8,68 @@
 #include <vector>
 #include <map>
 
+#include <stdint.h>
+
+#include "ThreadMutex.h"
+
+
+/**
+ *  敏感字段规则：
+ *      "ntvpasswd"                     完全匹配
+ *      "Device.ManagementServer.*"     前缀匹配
+ *      "*Password"                     后缀匹配
+ *      "*passwd*"                      包含匹配
+ *  匹配时不区分大小写
+ **/
+typedef enum {
+    SensitiveRule_Exact = 0,
+    SensitiveRule_Prefix,
+    SensitiveRule_Suffix,
+    SensitiveRule_Contains
+} SensitiveRuleType;
+
+typedef struct _SensitiveRule {
+    std::string         literal;    //去掉通配符后的字符串
+    SensitiveRuleType   type;
+} SensitiveRule;
+
+
+class SensitivePatternMatcher { /* 由敏感字段规则编译得到的 Aho-Corasick 自动机，编译后只读 */
+    public:
+        SensitivePatternMatcher();
+        ~SensitivePatternMatcher(){}
+
+        int compile(const std::vector<std::string>& rules);     //规则数过多(状态数超过 65535)时返回 -1
+        bool matchName(const char* name, int length);           //name 是否为敏感字段
+        int maskText(char* text, int length);                   //屏蔽 text 中敏感字段的值，返回屏蔽后的长度
+
+    private:
+        static int parseRule(const std::string& rule, SensitiveRule& parsed);
+        bool isRuleMatched(int rule, int start, int end, int length);
+        int maskValue(char* text, int length, int position);
+        int maskRange(char* text, int length, int start, int end);
+
+        uint8_t                         m_charClass[256];   //字符 -> 字符类，大小写为同一类，0 为规则中未出现的字符
+        int                             m_classCount;
+        std::vector<uint16_t>           m_transition;       //state * m_classCount + class -> 下一状态, 已合并失败转移
+        std::vector<std::vector<int> >  m_output;           //state -> 在该状态结束的规则(包含失败链上的规则)
+        std::vector<SensitiveRule>      m_rules;
+};
+
 
  class SensitiveParamFiltering { /* 敏感词过滤 */
     public:
         SensitiveParamFiltering();
-        ~SensitiveParamFiltering(){}
-        
-        bool filteringSensitiveParam(std::string param);    //在构造时初始化敏感字段，在需要时通过该方法剔除敏感字段
-        bool addSensitiveParam(std::string& param);
+        ~SensitiveParamFiltering();
+
+        bool filteringSensitiveParam(const std::string& param);    //在构造时初始化敏感字段，在需要时通过该方法剔除敏感字段
+        bool addSensitiveParam(std::string& param);                 //param 可以是通配规则，添加后重新编译匹配器
+        int  maskSensitiveText(char* text, int length);             //屏蔽日志行中敏感字段的值，原地修改，返回修改后的长度
         int  sensitiveParamFilterOutput();
     private:
         std::vector<std::string>  m_sensitiveParamFilter;   //保存需要过滤的敏感字段，在构造操作时初始化
+        SensitivePatternMatcher*  m_matcher;                //由 m_sensitiveParamFilter 编译得到
+        ThreadMutex_Type          m_mutex;                  //保护 m_matcher 的替换
 };
 
 
@@ -31,4 +82,3 @@ extern "C" SensitiveParamFiltering gSensitiveParamFilter;
 
 
 #endif //__SENSITIVE_PARAM_FILTERING_H__
-
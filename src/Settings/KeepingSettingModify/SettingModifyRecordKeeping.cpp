@@ -3,6 +3,8 @@
 #include <fstream>
 #include <sstream>
 
+#include <sys/time.h>
+
 #include "Log/LogC.h"
 #include "logSettings.h"
 #include "ThreadMutex.h"
@@ -39,6 +41,7 @@ SettingModifyRecordKeeping::SettingModifyRecordKeeping(std::string fileName)
 int SettingModifyRecordKeeping::load(void)
 {
     (*m_paramConfigFileMapping).loadConfigFileParam();
+    (*m_paramConfigFileMapping).startConfigFileWatch();     //配置文件被修改后只重新加载该文件
     (*m_paramModifyRecordMapping).loadModifyRecordParam();
     settingsLogVerbose("Has loading OK.\n");
     
@@ -61,11 +64,22 @@ int SettingModifyRecordKeeping::save(void)
     }
     // sync  m_paramConfigFileMapping && save m_paramModifyRecordMapping to file
     (*m_paramConfigFileMapping).updateConfigFileParamMap(m_paramItem.paramName, m_paramItem.newValue);
-    (*m_paramModifyRecordMapping).formatingParamItemOutput();
+    (*m_paramModifyRecordMapping).saveModifyRecordJournal();
     settingsLogVerbose("Has saved OK.\n");
     
     return 0;
 }
+/**
+ *  @Func: exportText
+ *         ps. :将内存中的修改记录导出为文本格式的 record 文件，便于查看
+ *  @Param: 
+ *  @Return: int
+ *  
+ **/
+int SettingModifyRecordKeeping::exportText(void)
+{
+    return (*m_paramModifyRecordMapping).formatingParamItemOutput();
+}
 /**
  *  @Func: reSet
  *  @Param: 
@@ -98,9 +112,10 @@ int SettingModifyRecordKeeping::set(const char* name, const char* value, int mod
 {
     initialParamItem(name, value, module, fileTag);
     
-    //save to m_paramModifyRecordMapping && dereplication
+    //save to m_paramModifyRecordMapping, 超出 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 的最早记录在 ring 中淘汰
     (*m_paramModifyRecordMapping).updateModifyRecordParamMap(&m_paramItem);
-    (*m_paramModifyRecordMapping).dereplicationModifyRecordParamMap();
+    if(gModifyRecordResetFlag == 0)
+        (*m_paramModifyRecordMapping).appendModifyRecordJournal(&m_paramItem);
 
     //sync  m_paramConfigFileMapping
     (*m_paramConfigFileMapping).updateConfigFileParamMap(m_paramItem.paramName, m_paramItem.newValue);
@@ -111,6 +126,56 @@ int SettingModifyRecordKeeping::set(const char* name, const char* value, int mod
 
 
 
+/**
+ *  @Func: subscribeConfigChanged
+ *  @Param: callback, type:: ConfigParamChangedCallback
+ *          userData, type:: void*
+ *  @Return: int
+ *  
+ **/
+int SettingModifyRecordKeeping::subscribeConfigChanged(ConfigParamChangedCallback callback, void* userData)
+{
+    return (*m_paramConfigFileMapping).subscribeConfigParamChanged(callback, userData);
+}
+/**
+ *  @Func: unsubscribeConfigChanged
+ *  @Param: callback, type:: ConfigParamChangedCallback
+ *          userData, type:: void*
+ *  @Return: int
+ *  
+ **/
+int SettingModifyRecordKeeping::unsubscribeConfigChanged(ConfigParamChangedCallback callback, void* userData)
+{
+    return (*m_paramConfigFileMapping).unsubscribeConfigParamChanged(callback, userData);
+}
+/**
+ *  @Func: queryByModule
+ *  @Param: module, type:: int, RecordChangedSource
+ *          beginMs, type:: int64_t
+ *          endMs, type:: int64_t
+ *          items, type:: std::vector<ParametersItem>&
+ *  @Return: int
+ *  
+ **/
+int SettingModifyRecordKeeping::queryByModule(int module, int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items)
+{
+    return (*m_paramModifyRecordMapping).queryModifyRecordByModule(recordChangedSourceName(module), beginMs, endMs, items);
+}
+/**
+ *  @Func: queryByTimeRange
+ *  @Param: beginMs, type:: int64_t
+ *          endMs, type:: int64_t
+ *          items, type:: std::vector<ParametersItem>&
+ *  @Return: int
+ *  
+ **/
+int SettingModifyRecordKeeping::queryByTimeRange(int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items)
+{
+    return (*m_paramModifyRecordMapping).queryModifyRecordByTimeRange(beginMs, endMs, items);
+}
+
+
+
 /**
  *  @Func: setModifyTimeStamp
  *  @Param: 
@@ -119,17 +184,11 @@ int SettingModifyRecordKeeping::set(const char* name, const char* value, int mod
  **/
 void SettingModifyRecordKeeping::setModifyTimeStamp()
 {
-    char buf[64] = {0};
-    DateTimeStamp sDTime;
-    struct timespec sTimeSpec;
-
-    getDateTimeStamp(&sDTime);
-    clock_gettime(CLOCK_MONOTONIC, &sTimeSpec);
-    snprintf(buf, 64 - 1, "%04d-%s-%02d %02d:%02d:%02d.%03d", 
-                            sDTime.mYear, gMonthStr[sDTime.mMonth].c_str(), sDTime.mDay, 
-                            sDTime.mHour, sDTime.mMinute, sDTime.mSecond, sTimeSpec.tv_nsec / 1000000);
-                            
-    m_paramItem.modifyTimeStamp = buf;
+    struct timeval sTimeVal;
+
+    gettimeofday(&sTimeVal, NULL);
+    m_paramItem.modifyTimeMs = (int64_t)sTimeVal.tv_sec * 1000 + sTimeVal.tv_usec / 1000;
+    m_paramItem.modifyTimeStamp = epochMsToDateTimeString(m_paramItem.modifyTimeMs);
     settingsLogVerbose("SET: modifyTimeStamp[%s] OK.\n", (m_paramItem.modifyTimeStamp).c_str());
 
     return ;
@@ -143,28 +202,7 @@ void SettingModifyRecordKeeping::setModifyTimeStamp()
  **/
 void SettingModifyRecordKeeping::setModifySourceModule(int module)
 {
-    std::string value("");
-    
-    switch(module) {
-    case RecordChangedSource_STBMonitor:
-        m_paramItem.sourceModule = "STBManageTool";
-        break;
-    case RecordChangedSource_tr069Manager:
-        m_paramItem.sourceModule = "TR069";
-        break;
-    case RecordChangedSource_JsLocalSetting:
-        m_paramItem.sourceModule = "JSLocal";
-        break;
-    case RecordChangedSource_JsEpgSetting:
-        m_paramItem.sourceModule = "JSEPG";
-        break;
-    case RecordChangedSource_Other:
-        m_paramItem.sourceModule = "Other";
-        break;
-    default:
-        m_paramItem.sourceModule = "";
-        break;
-    }
+    m_paramItem.sourceModule = recordChangedSourceName(module);
     settingsLogVerbose("SET: sourceModule[%s] OK.\n", (m_paramItem.sourceModule).c_str());
 
     return ;
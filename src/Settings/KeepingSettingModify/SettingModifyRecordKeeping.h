@@ -29,7 +29,12 @@ class SettingModifyRecordKeeping {
         int load(void);
         int save(void);
         int reSet(void);
+        int exportText(void);
         int set(const char* name, const char* value, int module, const char* fileTag);
+        int queryByModule(int module, int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items);
+        int queryByTimeRange(int64_t beginMs, int64_t endMs, std::vector<ParametersItem>& items);
+        int subscribeConfigChanged(ConfigParamChangedCallback callback, void* userData);
+        int unsubscribeConfigChanged(ConfigParamChangedCallback callback, void* userData);
                 
         void setModifyTimeStamp();                              //设置 m_paramItem 的modifyTimeStamp
         void setModifySourceModule(int module); //设置 m_paramItem 的sourceModule
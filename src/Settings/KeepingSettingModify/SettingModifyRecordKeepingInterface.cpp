@@ -10,6 +10,7 @@
 
 #include "SettingModifyRecordKeepingInterface.h"
 #include "SettingModifyRecordKeeping.h"
+#include "SensitiveParamFiltering.h"
 static SettingModifyRecordKeeping g_settingModifyRecordKeeping(PARAM_CHANGE_RECORD_KEEPING_FILE);
 
 #endif  // __cplusplus
@@ -43,6 +44,15 @@ void settingModifyRecordSave()
     return;
 }
 
+//导出文本格式的 config_param_modify.record
+void settingModifyRecordExport()
+{
+    settingsLogVerbose("settingModifyRecordExport.\n");
+    g_settingModifyRecordKeeping.exportText();
+
+    return;
+}
+
 //settingModifyRecordSet("syncntvAESpasswd", sysConfigs.syncntvAESpasswd, (Modify_Mode)whoModify, "system");
 void settingModifyRecordSet(const char* name, const char* value, int module, const char* file)
 {
@@ -52,6 +62,55 @@ void settingModifyRecordSet(const char* name, const char* value, int module, con
     return;
 }
 
+//敏感字段的值和文本导出一样以 "***" 交给 visitor
+static int settingModifyRecordVisit(std::vector<ParametersItem>& items, SettingModifyRecordVisitor visitor, void* userData)
+{
+    std::vector<ParametersItem>::iterator it;
+
+    if (visitor) {
+        for (it = items.begin(); it != items.end(); ++it) {
+            if (gSensitiveParamFilter.filteringSensitiveParam(it->paramName))
+                visitor(it->paramName.c_str(), "***", "***",
+                        it->modifyTimeStamp.c_str(), it->sourceModule.c_str(), it->modifiedFile.c_str(), userData);
+            else
+                visitor(it->paramName.c_str(), it->oldValue.c_str(), it->newValue.c_str(),
+                        it->modifyTimeStamp.c_str(), it->sourceModule.c_str(), it->modifiedFile.c_str(), userData);
+        }
+    }
+
+    return items.size();
+}
+
+int settingModifyRecordQueryByModule(int module, long long beginMs, long long endMs, SettingModifyRecordVisitor visitor, void* userData)
+{
+    std::vector<ParametersItem> items;
+
+    g_settingModifyRecordKeeping.queryByModule(module, beginMs, endMs, items);
+    settingsLogVerbose("settingModifyRecordQueryByModule module[%d] count[%d].\n", module, (int)items.size());
+
+    return settingModifyRecordVisit(items, visitor, userData);
+}
+
+int settingModifyRecordQueryByTime(long long beginMs, long long endMs, SettingModifyRecordVisitor visitor, void* userData)
+{
+    std::vector<ParametersItem> items;
+
+    g_settingModifyRecordKeeping.queryByTimeRange(beginMs, endMs, items);
+    settingsLogVerbose("settingModifyRecordQueryByTime count[%d].\n", (int)items.size());
+
+    return settingModifyRecordVisit(items, visitor, userData);
+}
+
+int settingConfigChangedSubscribe(SettingConfigChangedCallback callback, void* userData)
+{
+    return g_settingModifyRecordKeeping.subscribeConfigChanged(callback, userData);
+}
+
+int settingConfigChangedUnsubscribe(SettingConfigChangedCallback callback, void* userData)
+{
+    return g_settingModifyRecordKeeping.unsubscribeConfigChanged(callback, userData);
+}
+
 void settingModifyRecordReset(int module)
 {
     settingsLogVerbose("settingModifyRecordReset.\n");
@@ -10,9 +10,25 @@ extern "C" {
 
 void settingModifyRecordLoad();
 void settingModifyRecordSave();
+void settingModifyRecordExport();
 void settingModifyRecordReset(int module);
 void settingModifyRecordSet(const char* name, const char* value, int module, const char* file);
 
+/* 修改记录查询，每条记录回调一次 visitor，按修改时间先后排列；时间为 epoch 毫秒, 闭区间；敏感字段的 oldValue/newValue 为 "***" */
+typedef void (*SettingModifyRecordVisitor)(const char* name, const char* oldValue, const char* newValue,
+                                           const char* timeStamp, const char* module, const char* file, void* userData);
+int settingModifyRecordQueryByModule(int module, long long beginMs, long long endMs, SettingModifyRecordVisitor visitor, void* userData);
+int settingModifyRecordQueryByTime(long long beginMs, long long endMs, SettingModifyRecordVisitor visitor, void* userData);
+
+/**
+ * 配置文件(yx_config_*.ini)被外部修改时，只通知有变化的参数
+ *      changeType: 0 添加, 1 修改, 2 删除; 敏感字段的 value 为空
+ *      回调在监听线程中执行
+ **/
+typedef void (*SettingConfigChangedCallback)(const char* file, const char* name, const char* value, int changeType, void* userData);
+int settingConfigChangedSubscribe(SettingConfigChangedCallback callback, void* userData);
+int settingConfigChangedUnsubscribe(SettingConfigChangedCallback callback, void* userData);
+
 
 
 
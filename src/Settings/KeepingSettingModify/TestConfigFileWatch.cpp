@@ -0,0 +1,208 @@
+/**
+ *  TestConfigFileWatch.cpp文件
+ *  配置文件监听的测试：
+ *          重新加载时只通知添加、修改、删除的参数，未变化的参数不通知，敏感字段的值为空
+ *          "写临时文件 + rename" 更新配置文件后监听线程重新加载并通知
+ *          停止后立即重新开始、停止后立即析构都不会访问已经释放的对象
+ *          参数从一个文件中删除后，其他文件中仍有该参数时仍然可以读到
+ *
+ *  用法：TestConfigFileWatch.elf [工作目录，默认 /tmp]
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include "ThreadMutex.h"
+#include "MappingSettingConfigFile.h"
+
+
+#define     TEST_WATCH_TIMEOUT_MS       3000
+#define     TEST_WATCH_RESTARTS         20
+
+
+static std::string sDirectory = "/tmp";
+
+typedef struct _TestChanges {
+    ThreadMutex_Type                    mutex;
+    std::map<std::string, std::string>  changes;    //name -> "类型:值"
+} TestChanges;
+
+static void TestChanged(const char* file, const char* name, const char* value, int changeType, void* userData)
+{
+    TestChanges* changes = (TestChanges*)userData;
+    char type[8];
+
+    snprintf(type, sizeof(type), "%d:", changeType);
+    ThreadMutexLock(changes->mutex);
+    changes->changes[name] = std::string(type) + value;
+    ThreadMutexUnLock(changes->mutex);
+    (void)file;
+}
+
+static int TestWriteFile(const std::string& file, const char* content)
+{
+    std::string tmpFile = file + ".tmp";
+    FILE* fp = fopen(tmpFile.c_str(), "wb");
+
+    if (fp == NULL)
+        return -1;
+    fputs(content, fp);
+    fclose(fp);
+    return rename(tmpFile.c_str(), file.c_str());
+}
+
+static bool TestExpect(TestChanges& changes, const char* name, const char* expect)
+{
+    std::map<std::string, std::string>::iterator it;
+    bool ret;
+
+    ThreadMutexLock(changes.mutex);
+    it = changes.changes.find(name);
+    ret = expect ? (it != changes.changes.end() && it->second == expect) : (it == changes.changes.end());
+    ThreadMutexUnLock(changes.mutex);
+    return ret;
+}
+
+static int TestDiff()
+{
+    std::string file = sDirectory + "/test_watch_diff.ini";
+    MappingSettingConfigFile config;
+    TestChanges changes;
+    int failed = 0;
+
+    changes.mutex = ThreadMutexCreate();
+    if (TestWriteFile(file, "timezone=8\nntp=pool.ntp.org\nntvpasswd=abc\nhd_aspect_mode=2\n") < 0)
+        failed++;
+    config.addConfigFile(file);
+    config.subscribeConfigParamChanged(TestChanged, &changes);
+    if (config.loadConfigFileParam() < 0 || config.getConfigFileParamValue("timezone") != "8")
+        failed++;
+
+    /* timezone 修改、ntp 删除、lang 添加、hd_aspect_mode 不变、ntvpasswd 修改 */
+    if (TestWriteFile(file, "timezone=7\nntvpasswd=xyz\nhd_aspect_mode=2\nlang=en\n") < 0)
+        failed++;
+    if (config.reloadConfigFile(file) != 4)
+        failed++;
+    if (!TestExpect(changes, "timezone", "1:7") || !TestExpect(changes, "ntp", "2:") || !TestExpect(changes, "lang", "0:en")
+        || !TestExpect(changes, "ntvpasswd", "1:") || !TestExpect(changes, "hd_aspect_mode", NULL))
+        failed++;
+    if (config.getConfigFileParamValue("timezone") != "7" || config.getConfigFileParamValue("ntp") != ""
+        || config.getConfigFileParamValue("ntvpasswd") != "")
+        failed++;
+
+    /* 内容相同时不通知，敏感字段只比较 hash */
+    changes.changes.clear();
+    if (config.reloadConfigFile(file) != 0 || !changes.changes.empty())
+        failed++;
+    unlink(file.c_str());
+    ThreadMutexDestroy(changes.mutex);
+
+    printf("[diff] added, modified, removed: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestMerge()
+{
+    std::string system = sDirectory + "/test_watch_system.ini", customer = sDirectory + "/test_watch_customer.ini";
+    MappingSettingConfigFile config;
+    int failed = 0;
+
+    if (TestWriteFile(system, "timezone=8\nntp=pool.ntp.org\n") < 0 || TestWriteFile(customer, "ntp=ntp.example.com\nlang=en\n") < 0)
+        failed++;
+    config.addConfigFile(system);
+    config.addConfigFile(customer);
+    if (config.loadConfigFileParam() < 0 || config.getConfigFileParamValue("ntp") != "ntp.example.com")
+        failed++;
+
+    /* ntp 从 system 中删除，customer 中仍有 */
+    if (TestWriteFile(system, "timezone=8\n") < 0 || config.reloadConfigFile(system) != 1)
+        failed++;
+    if (config.getConfigFileParamValue("ntp") != "ntp.example.com")
+        failed++;
+
+    /* 两个文件中都删除后读不到 */
+    if (TestWriteFile(customer, "lang=en\n") < 0 || config.reloadConfigFile(customer) != 1)
+        failed++;
+    if (config.getConfigFileParamValue("ntp") != "" || config.getConfigFileParamValue("lang") != "en")
+        failed++;
+    unlink(system.c_str());
+    unlink(customer.c_str());
+
+    printf("[merge] removed from one of two files: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestWatch()
+{
+    std::string file = sDirectory + "/test_watch_notify.ini";
+    TestChanges changes;
+    int failed = 0, i, waitMs;
+
+    changes.mutex = ThreadMutexCreate();
+    if (TestWriteFile(file, "timezone=8\n") < 0)
+        failed++;
+    {
+        MappingSettingConfigFile config;
+
+        config.addConfigFile(file);
+        config.subscribeConfigParamChanged(TestChanged, &changes);
+        config.loadConfigFileParam();
+        if (config.startConfigFileWatch() < 0)
+            failed++;
+        if (TestWriteFile(file, "timezone=9\n") < 0)
+            failed++;
+        for (waitMs = 0; waitMs < TEST_WATCH_TIMEOUT_MS && !TestExpect(changes, "timezone", "1:9"); waitMs += 10)
+            usleep(10000);
+        if (!TestExpect(changes, "timezone", "1:9"))
+            failed++;
+
+        /* 停止后立即重新开始 */
+        for (i = 0; i < TEST_WATCH_RESTARTS; i++) {
+            if (config.stopConfigFileWatch() < 0 || config.startConfigFileWatch() < 0)
+                failed++;
+        }
+        if (TestWriteFile(file, "timezone=10\n") < 0)
+            failed++;
+        for (waitMs = 0; waitMs < TEST_WATCH_TIMEOUT_MS && !TestExpect(changes, "timezone", "1:10"); waitMs += 10)
+            usleep(10000);
+        if (!TestExpect(changes, "timezone", "1:10"))
+            failed++;
+    }
+
+    /* 监听中直接析构 */
+    for (i = 0; i < TEST_WATCH_RESTARTS; i++) {
+        MappingSettingConfigFile* config = new MappingSettingConfigFile();
+
+        config->addConfigFile(file);
+        if (config->startConfigFileWatch() < 0)
+            failed++;
+        TestWriteFile(file, i % 2 ? "timezone=1\n" : "timezone=2\n");
+        delete config;
+    }
+    unlink(file.c_str());
+    ThreadMutexDestroy(changes.mutex);
+
+    printf("[watch] notify, restart, destroy: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+
+    if (argc > 1)
+        sDirectory = argv[1];
+
+    failed += TestDiff();
+    failed += TestMerge();
+    failed += TestWatch();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+/**
+ *  TestModifyRecordJournal.cpp文件
+ *  参数修改记录日志的测试：
+ *          追加、重新加载后记录相同；某条记录 crc 错误时从该条截断，之后可以继续追加
+ *          文件尾部的半条记录被截断；压缩后重新加载得到压缩时的记录
+ *          敏感字段的值不以明文写入日志，旧日志中的明文在加载时被重写
+ *
+ *  用法：TestModifyRecordJournal.elf [工作目录，默认 /tmp]
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "ModifyRecordJournal.h"
+#include "MappingSettingModifyRecord.h"
+
+
+#define     TEST_JOURNAL_RECORDS        100
+#define     TEST_JOURNAL_BROKEN         37      //改坏这一条记录
+
+
+static std::string sDirectory = "/tmp";
+
+static ParametersItem TestItem(int index)
+{
+    ParametersItem item;
+    char buffer[64];
+
+    snprintf(buffer, sizeof(buffer), "param_%d", index % 13);
+    item.paramName = buffer;
+    snprintf(buffer, sizeof(buffer), "old_%d", index);
+    item.oldValue = buffer;
+    snprintf(buffer, sizeof(buffer), "new_%d", index);
+    item.newValue = buffer;
+    item.sourceModule = recordChangedSourceName(index % RecordChangedSource_Unknow);
+    item.modifiedFile = "/root/yx_config_system.ini";
+    item.modifyTimeMs = 1325376000000LL + index * 1000;
+    item.modifyTimeStamp = epochMsToDateTimeString(item.modifyTimeMs);
+    return item;
+}
+
+static bool TestSameItem(const ParametersItem& a, const ParametersItem& b)
+{
+    return a.paramName == b.paramName && a.oldValue == b.oldValue && a.newValue == b.newValue
+        && a.sourceModule == b.sourceModule && a.modifiedFile == b.modifiedFile && a.modifyTimeMs == b.modifyTimeMs;
+}
+
+static long TestFileSize(const std::string& fileName)
+{
+    struct stat st;
+
+    if (stat(fileName.c_str(), &st) < 0)
+        return -1;
+    return (long)st.st_size;
+}
+
+static bool TestFileContains(const std::string& fileName, const char* text)
+{
+    std::string content;
+    char buffer[4096];
+    size_t length;
+    FILE* fp = fopen(fileName.c_str(), "rb");
+
+    if (fp == NULL)
+        return false;
+    while ((length = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        content.append(buffer, length);
+    fclose(fp);
+    return content.find(text) != std::string::npos;
+}
+
+/* 追加 count 条记录，返回每条记录结束时的文件长度 */
+static int TestWriteJournal(const std::string& fileName, int count, std::vector<long>& ends)
+{
+    ModifyRecordJournal journal(fileName);
+    int i;
+
+    unlink(fileName.c_str());
+    if (journal.open() < 0)
+        return -1;
+    for (i = 0; i < count; i++) {
+        if (journal.appendRecord(TestItem(i)) < 0)
+            return -1;
+        ends.push_back(TestFileSize(fileName));
+    }
+    return 0;
+}
+
+static int TestRoundTrip()
+{
+    std::string fileName = sDirectory + "/test_journal_roundtrip.journal";
+    std::vector<ParametersItem> items;
+    std::vector<long> ends;
+    int failed = 0, i;
+
+    if (TestWriteJournal(fileName, TEST_JOURNAL_RECORDS, ends) < 0)
+        failed++;
+    ModifyRecordJournal journal(fileName);
+    if (journal.loadRecords(items) != TEST_JOURNAL_RECORDS || (int)items.size() != TEST_JOURNAL_RECORDS)
+        failed++;
+    for (i = 0; i < (int)items.size() && i < TEST_JOURNAL_RECORDS; i++) {
+        if (!TestSameItem(items[i], TestItem(i)))
+            failed++;
+    }
+    unlink(fileName.c_str());
+
+    printf("[roundtrip] %d records: %s\n", (int)items.size(), failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestCrcTruncate()
+{
+    std::string fileName = sDirectory + "/test_journal_crc.journal";
+    std::vector<ParametersItem> items;
+    std::vector<long> ends;
+    int failed = 0, fd;
+    char value;
+
+    if (TestWriteJournal(fileName, TEST_JOURNAL_RECORDS, ends) < 0)
+        failed++;
+
+    /* 改坏一条记录 payload 的最后一个字节，记录头仍然合法，只有 crc 能发现 */
+    fd = ::open(fileName.c_str(), O_RDWR);
+    if (fd < 0 || pread(fd, &value, 1, ends[TEST_JOURNAL_BROKEN] - 1) != 1)
+        failed++;
+    value ^= 0x20;
+    if (fd < 0 || pwrite(fd, &value, 1, ends[TEST_JOURNAL_BROKEN] - 1) != 1)
+        failed++;
+    if (fd >= 0)
+        ::close(fd);
+
+    {
+        ModifyRecordJournal journal(fileName);
+
+        if (journal.loadRecords(items) != TEST_JOURNAL_BROKEN)
+            failed++;
+        if (TestFileSize(fileName) != ends[TEST_JOURNAL_BROKEN - 1])
+            failed++;
+        /* 截断后继续追加，序号接着最后一条完整记录 */
+        if (journal.open() < 0 || journal.appendRecord(TestItem(1000)) < 0)
+            failed++;
+    }
+    items.clear();
+    {
+        ModifyRecordJournal journal(fileName);
+
+        if (journal.loadRecords(items) != TEST_JOURNAL_BROKEN + 1 || !TestSameItem(items.back(), TestItem(1000)))
+            failed++;
+    }
+    unlink(fileName.c_str());
+
+    printf("[crc] broken record %d truncated: %s\n", TEST_JOURNAL_BROKEN, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestTornTail()
+{
+    std::string fileName = sDirectory + "/test_journal_torn.journal";
+    std::vector<ParametersItem> items;
+    std::vector<long> ends;
+    int failed = 0;
+
+    if (TestWriteJournal(fileName, TEST_JOURNAL_RECORDS, ends) < 0)
+        failed++;
+    /* 掉电时最后一条记录只写了一半 */
+    if (truncate(fileName.c_str(), ends[TEST_JOURNAL_RECORDS - 1] - 5) < 0)
+        failed++;
+
+    ModifyRecordJournal journal(fileName);
+    if (journal.loadRecords(items) != TEST_JOURNAL_RECORDS - 1)
+        failed++;
+    if (TestFileSize(fileName) != ends[TEST_JOURNAL_RECORDS - 2])
+        failed++;
+    unlink(fileName.c_str());
+
+    printf("[torn] half record at tail truncated: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestCompact()
+{
+    std::string fileName = sDirectory + "/test_journal_compact.journal";
+    std::vector<ParametersItem> live, items;
+    std::vector<long> ends;
+    int failed = 0, i;
+
+    if (TestWriteJournal(fileName, TEST_JOURNAL_RECORDS, ends) < 0)
+        failed++;
+    for (i = 0; i < TEST_JOURNAL_RECORDS; i += 4)
+        live.push_back(TestItem(i));
+
+    {
+        ModifyRecordJournal journal(fileName);
+
+        if (journal.loadRecords(items) != TEST_JOURNAL_RECORDS || !journal.needCompact(live.size()))
+            failed++;
+        if (journal.compact(live) < 0 || journal.getRecordCount() != (int)live.size())
+            failed++;
+        /* 压缩之后日志仍然打开，可以直接追加 */
+        if (journal.appendRecord(TestItem(2000)) < 0)
+            failed++;
+    }
+    live.push_back(TestItem(2000));
+    items.clear();
+    {
+        ModifyRecordJournal journal(fileName);
+
+        if (journal.loadRecords(items) != (int)live.size())
+            failed++;
+        for (i = 0; i < (int)items.size() && i < (int)live.size(); i++) {
+            if (!TestSameItem(items[i], live[i]))
+                failed++;
+        }
+    }
+    unlink(fileName.c_str());
+    unlink((fileName + ".tmp").c_str());
+
+    printf("[compact] %d live records: %s\n", (int)live.size(), failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestSensitiveMask()
+{
+    std::string fileName = sDirectory + "/test_journal_mask.record";
+    std::string journalName = fileName + ".journal";
+    std::vector<ParametersItem> items;
+    ParametersItem item = TestItem(0);
+    int failed = 0;
+
+    unlink(fileName.c_str());
+    unlink(journalName.c_str());
+
+    /* 旧版本写入的明文 */
+    item.paramName = "ntvpasswd";
+    item.oldValue = "plainOld123";
+    item.newValue = "plainNew456";
+    {
+        ModifyRecordJournal journal(journalName);
+
+        if (journal.open() < 0 || journal.appendRecord(item) < 0)
+            failed++;
+    }
+    {
+        MappingSettingModifyRecord record(fileName);
+        ParametersItem secret = TestItem(1);
+
+        record.loadModifyRecordParam();
+        if (TestFileContains(journalName, "plainOld123") || TestFileContains(journalName, "plainNew456"))
+            failed++;
+
+        secret.paramName = "Device.ManagementServer.Password";
+        secret.oldValue = "secretOld789";
+        secret.newValue = "secretNew012";
+        record.updateModifyRecordParamMap(&secret);
+        if (record.appendModifyRecordJournal(&secret) < 0)
+            failed++;
+        if (TestFileContains(journalName, "secretOld789") || TestFileContains(journalName, "secretNew012"))
+            failed++;
+        if (!TestFileContains(journalName, "Device.ManagementServer.Password"))
+            failed++;
+    }
+    {
+        ModifyRecordJournal journal(journalName);
+        unsigned int i;
+
+        if (journal.loadRecords(items) != 2)
+            failed++;
+        for (i = 0; i < items.size(); i++) {
+            if (items[i].oldValue != "***" || items[i].newValue != "***")
+                failed++;
+        }
+    }
+    unlink(fileName.c_str());
+    unlink(journalName.c_str());
+    unlink((journalName + ".tmp").c_str());
+
+    printf("[mask] sensitive values not in journal: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+
+    if (argc > 1)
+        sDirectory = argv[1];
+
+    failed += TestRoundTrip();
+    failed += TestCrcTruncate();
+    failed += TestTornTail();
+    failed += TestCompact();
+    failed += TestSensitiveMask();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
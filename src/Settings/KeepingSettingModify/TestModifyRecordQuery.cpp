@@ -0,0 +1,203 @@
+/**
+ *  TestModifyRecordQuery.cpp文件
+ *  参数修改记录查询的测试：
+ *          乱序插入多个参数的修改记录，每个参数只保留最近 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 条，
+ *          条数、最早时间以及按时间段、按模块的查询结果与逐条比较的结果相同
+ *          查询接口交给 visitor 的敏感字段的值为 "***"
+ *
+ *  用法：TestModifyRecordQuery.elf [工作目录，默认 /tmp]
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "MappingSettingModifyRecord.h"
+#include "SettingModifyRecordKeepingInterface.h"
+
+
+#define     TEST_QUERY_PARAMS           7
+#define     TEST_QUERY_RECORDS          500
+#define     TEST_QUERY_PROBES           300
+#define     TEST_QUERY_BASE_MS          1325376000000LL
+
+
+static std::string sDirectory = "/tmp";
+static uint32_t sRandom = 12345;
+
+static uint32_t TestRandom()
+{
+    sRandom = sRandom * 1103515245 + 12345;
+    return (sRandom >> 8) & 0xFFFFFF;
+}
+
+static bool TestEarlier(const ParametersItem& a, const ParametersItem& b)
+{
+    return a.modifyTimeMs < b.modifyTimeMs;
+}
+
+static bool TestSameItems(const std::vector<ParametersItem>& a, const std::vector<ParametersItem>& b)
+{
+    unsigned int i;
+
+    if (a.size() != b.size())
+        return false;
+    for (i = 0; i < a.size(); i++) {
+        if (a[i].paramName != b[i].paramName || a[i].modifyTimeMs != b[i].modifyTimeMs || a[i].newValue != b[i].newValue)
+            return false;
+    }
+    return true;
+}
+
+static int TestRing()
+{
+    std::vector<ParametersItem> all, kept, expect, items;
+    std::vector<int> order;
+    MappingSettingModifyRecord record(sDirectory + "/test_query.record");
+    std::string name, module;
+    int64_t beginMs, endMs;
+    int failed = 0, i, j, count;
+    char buffer[32];
+
+    /* 时间各不相同，插入顺序打乱 */
+    for (i = 0; i < TEST_QUERY_RECORDS; i++) {
+        ParametersItem item;
+
+        snprintf(buffer, sizeof(buffer), "param_%d", (int)(TestRandom() % TEST_QUERY_PARAMS));
+        item.paramName = buffer;
+        snprintf(buffer, sizeof(buffer), "%d", i);
+        item.newValue = buffer;
+        item.sourceModule = recordChangedSourceName(1 + TestRandom() % (RecordChangedSource_Unknow - 1));
+        item.modifiedFile = "/root/yx_config_system.ini";
+        item.modifyTimeMs = TEST_QUERY_BASE_MS + i * 1000;
+        item.modifyTimeStamp = epochMsToDateTimeString(item.modifyTimeMs);
+        all.push_back(item);
+        order.push_back(i);
+    }
+    for (i = TEST_QUERY_RECORDS - 1; i > 0; i--)
+        std::swap(order[i], order[TestRandom() % (i + 1)]);
+    for (i = 0; i < TEST_QUERY_RECORDS; i++)
+        record.updateModifyRecordParamMap(&all[order[i]]);
+
+    /* 每个参数保留时间最晚的 COUNT_OF_PARAM_IN_MODIFY_FILE_MAX 条 */
+    for (i = 0; i < TEST_QUERY_PARAMS; i++) {
+        snprintf(buffer, sizeof(buffer), "param_%d", i);
+        name = buffer;
+        expect.clear();
+        for (j = 0; j < TEST_QUERY_RECORDS; j++) {
+            if (all[j].paramName == name)
+                expect.push_back(all[j]);
+        }
+        if (expect.size() > COUNT_OF_PARAM_IN_MODIFY_FILE_MAX)
+            expect.erase(expect.begin(), expect.end() - COUNT_OF_PARAM_IN_MODIFY_FILE_MAX);
+        if (record.getModifyRecordCount(name) != (int)expect.size())
+            failed++;
+
+        ParamStatistics statistics;
+        if (record.getModifyRecordStatistics(name, statistics) < 0 || statistics.earliestTimeMs != expect[0].modifyTimeMs)
+            failed++;
+        kept.insert(kept.end(), expect.begin(), expect.end());
+    }
+    std::sort(kept.begin(), kept.end(), TestEarlier);
+
+    for (i = 0; i < TEST_QUERY_PROBES; i++) {
+        beginMs = TEST_QUERY_BASE_MS + (int64_t)(TestRandom() % (TEST_QUERY_RECORDS + 20)) * 1000 - 10000;
+        endMs = beginMs + (int64_t)(TestRandom() % (TEST_QUERY_RECORDS / 2)) * 1000;
+        module = recordChangedSourceName(1 + TestRandom() % (RecordChangedSource_Unknow - 1));
+
+        expect.clear();
+        for (j = 0; j < (int)kept.size(); j++) {
+            if (kept[j].modifyTimeMs >= beginMs && kept[j].modifyTimeMs <= endMs)
+                expect.push_back(kept[j]);
+        }
+        items.clear();
+        count = record.queryModifyRecordByTimeRange(beginMs, endMs, items);
+        if (count != (int)items.size() || !TestSameItems(items, expect))
+            failed++;
+
+        expect.clear();
+        for (j = 0; j < (int)kept.size(); j++) {
+            if (kept[j].sourceModule == module && kept[j].modifyTimeMs >= beginMs && kept[j].modifyTimeMs <= endMs)
+                expect.push_back(kept[j]);
+        }
+        items.clear();
+        count = record.queryModifyRecordByModule(module, beginMs, endMs, items);
+        if (count != (int)items.size() || !TestSameItems(items, expect))
+            failed++;
+    }
+
+    printf("[ring] %d of %d records kept, %d probes: %s\n", (int)kept.size(), TEST_QUERY_RECORDS, TEST_QUERY_PROBES, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+typedef struct _TestVisited {
+    int         count;
+    int         masked;
+    int         plain;
+} TestVisited;
+
+static void TestVisitor(const char* name, const char* oldValue, const char* newValue,
+                        const char* timeStamp, const char* module, const char* file, void* userData)
+{
+    TestVisited* visited = (TestVisited*)userData;
+
+    visited->count++;
+    if (strcmp(name, "ntvpasswd") == 0 && strcmp(oldValue, "***") == 0 && strcmp(newValue, "***") == 0)
+        visited->masked++;
+    if (strcmp(name, "timezone") == 0 && strcmp(newValue, "7") == 0)
+        visited->plain++;
+    if (strstr(oldValue, "secret") || strstr(newValue, "secret"))
+        visited->masked = -1000;
+    (void)timeStamp;
+    (void)module;
+    (void)file;
+}
+
+static int TestVisitMask()
+{
+    TestVisited visited;
+    int failed = 0;
+
+    /* 接口使用当前目录下的 config_param_modify.record */
+    if (chdir(sDirectory.c_str()) < 0)
+        failed++;
+    unlink("config_param_modify.record.journal");
+
+    memset(&visited, 0, sizeof(visited));
+    settingModifyRecordSet("ntvpasswd", "secret1", RecordChangedSource_tr069Manager, "system");
+    settingModifyRecordSet("ntvpasswd", "secret2", RecordChangedSource_tr069Manager, "system");
+    settingModifyRecordSet("timezone", "7", RecordChangedSource_tr069Manager, "system");
+    settingModifyRecordQueryByTime(0, 0x7FFFFFFFFFFFFFFFLL, TestVisitor, &visited);
+    if (visited.count != 3 || visited.masked != 2 || visited.plain != 1)
+        failed++;
+
+    memset(&visited, 0, sizeof(visited));
+    settingModifyRecordQueryByModule(RecordChangedSource_tr069Manager, 0, 0x7FFFFFFFFFFFFFFFLL, TestVisitor, &visited);
+    if (visited.count != 3 || visited.masked != 2 || visited.plain != 1)
+        failed++;
+    unlink("config_param_modify.record");
+    unlink("config_param_modify.record.journal");
+
+    printf("[visit] sensitive values masked: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+
+    if (argc > 1)
+        sDirectory = argv[1];
+
+    failed += TestRing();
+    failed += TestVisitMask();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
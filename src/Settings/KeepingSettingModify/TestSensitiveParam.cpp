@@ -0,0 +1,196 @@
+/**
+ *  TestSensitiveParam.cpp文件
+ *  敏感字段过滤的测试：
+ *          完全、前缀、后缀、包含四种规则，不区分大小写；随机字段名的匹配结果与逐条规则比较的结果相同
+ *          日志行中 name=value、name: value、name[...] value[...] 形式的值被屏蔽，字段名的边界正确
+ *          addSensitiveParam 之后新规则生效；多个线程同时添加时每条规则都生效
+ *
+ *  用法：TestSensitiveParam.elf
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include "SensitiveParamFiltering.h"
+
+
+#define     TEST_SENSITIVE_NAMES        20000
+#define     TEST_SENSITIVE_THREADS      8
+#define     TEST_SENSITIVE_ADDS         20      //每个线程添加的规则数
+
+
+static uint32_t sRandom = 12345;
+
+static uint32_t TestRandom()
+{
+    sRandom = sRandom * 1103515245 + 12345;
+    return (sRandom >> 8) & 0xFFFFFF;
+}
+
+static std::string TestLower(const std::string& text)
+{
+    std::string result(text);
+    unsigned int i;
+
+    for (i = 0; i < result.size(); i++)
+        result[i] = tolower((unsigned char)result[i]);
+    return result;
+}
+
+/* 逐条规则比较 */
+static bool TestReferenceMatch(const std::vector<std::string>& rules, const std::string& name)
+{
+    std::string lower = TestLower(name), literal;
+    unsigned int i;
+    bool head, tail;
+
+    for (i = 0; i < rules.size(); i++) {
+        head = rules[i][0] == '*';
+        tail = rules[i].size() > 1 && rules[i][rules[i].size() - 1] == '*';
+        literal = TestLower(rules[i].substr(head ? 1 : 0, rules[i].size() - (head ? 1 : 0) - (tail ? 1 : 0)));
+        if (head && tail) {
+            if (lower.find(literal) != std::string::npos)
+                return true;
+        } else if (head) {
+            if (lower.size() >= literal.size() && lower.compare(lower.size() - literal.size(), literal.size(), literal) == 0)
+                return true;
+        } else if (tail) {
+            if (lower.compare(0, literal.size(), literal) == 0)
+                return true;
+        } else if (lower == literal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int TestMatcher()
+{
+    static const char* rules[] = {"ntvpasswd", "Device.ManagementServer.*", "*Password", "*passwd*", "*key", "wifi_ssid", "abab*"};
+    static const char* fragments[] = {"ntv", "passwd", "Pass", "word", "Device.", "ManagementServer.", "key", "KEY", "wifi_", "ssid",
+                                      "ab", "a", "b", "x", ".", "_", "NTVPASSWD", "Password", "Device.ManagementServer."};
+    std::vector<std::string> ruleList(rules, rules + sizeof(rules) / sizeof(rules[0]));
+    SensitivePatternMatcher matcher;
+    std::string name;
+    int failed = 0, matched = 0, i, j, count;
+
+    if (matcher.compile(ruleList) < 0)
+        failed++;
+    for (i = 0; i < TEST_SENSITIVE_NAMES; i++) {
+        name.clear();
+        count = 1 + TestRandom() % 4;
+        for (j = 0; j < count; j++)
+            name += fragments[TestRandom() % (sizeof(fragments) / sizeof(fragments[0]))];
+        if (matcher.matchName(name.c_str(), name.size()) != TestReferenceMatch(ruleList, name)) {
+            if (failed < 5)
+                printf("    name [%s] mismatch\n", name.c_str());
+            failed++;
+        }
+        if (TestReferenceMatch(ruleList, name))
+            matched++;
+    }
+    /* 不支持中间的通配，规则被忽略 */
+    ruleList.push_back("mid*dle");
+    if (matcher.compile(ruleList) < 0 || matcher.matchName("middle", 6))
+        failed++;
+
+    printf("[matcher] %d names, %d sensitive: %s\n", TEST_SENSITIVE_NAMES, matched, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestMaskLine(const char* line, const char* expect)
+{
+    char buffer[512];
+    int length;
+
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    length = gSensitiveParamFilter.maskSensitiveText(buffer, strlen(buffer));
+    if (strcmp(buffer, expect) != 0 || length != (int)strlen(expect)) {
+        printf("    [%s] -> [%s], expect [%s]\n", line, buffer, expect);
+        return 1;
+    }
+    return 0;
+}
+
+static int TestMask()
+{
+    std::string rule("*secretToken");
+    int failed = 0;
+
+    failed += TestMaskLine("set ntvpasswd=abc123 timezone=8", "set ntvpasswd=*** timezone=8");
+    failed += TestMaskLine("NTVPASSWD: 'abc123', ok", "NTVPASSWD: '***', ok");
+    failed += TestMaskLine("Device.ManagementServer.Password=\"top secret\"", "Device.ManagementServer.Password=\"***\"");
+    failed += TestMaskLine("Device.ManagementServer.STUNPassword = [xy]", "Device.ManagementServer.STUNPassword = [**]");
+    failed += TestMaskLine("paramName[netAESpasswd] oldValue[old1] newValue[new22] file[system]",
+                           "paramName[netAESpasswd] oldValue[***] newValue[***] file[system]");
+    failed += TestMaskLine("Set item[wifi_password] value[hunter2] OK.", "Set item[wifi_password] value[***] OK.");
+    /* 字段名只是敏感字段名的一部分时不屏蔽 */
+    failed += TestMaskLine("myntvpasswdX=abc123 ntvpasswd2=abc", "myntvpasswdX=abc123 ntvpasswd2=abc");
+    failed += TestMaskLine("timezone=8 hd_aspect_mode=2", "timezone=8 hd_aspect_mode=2");
+
+    if (gSensitiveParamFilter.filteringSensitiveParam("my.secretToken") || !gSensitiveParamFilter.filteringSensitiveParam("ntvAESpasswd"))
+        failed++;
+    if (!gSensitiveParamFilter.addSensitiveParam(rule) || !gSensitiveParamFilter.filteringSensitiveParam("my.SECRETTOKEN"))
+        failed++;
+    failed += TestMaskLine("my.secretToken=0123456789", "my.secretToken=***");
+
+    printf("[mask] log line masking: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static void* TestAddThread(void* arg)
+{
+    char buffer[32];
+    int i;
+
+    for (i = 0; i < TEST_SENSITIVE_ADDS; i++) {
+        snprintf(buffer, sizeof(buffer), "*concurrent%d_%d", (int)(long)arg, i);
+        std::string rule(buffer);
+        gSensitiveParamFilter.addSensitiveParam(rule);
+    }
+    return NULL;
+}
+
+static int TestConcurrentAdd()
+{
+    pthread_t threads[TEST_SENSITIVE_THREADS];
+    char buffer[32];
+    int failed = 0, i, j;
+
+    for (i = 0; i < TEST_SENSITIVE_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, TestAddThread, (void*)(long)i) != 0)
+            failed++;
+    }
+    for (i = 0; i < TEST_SENSITIVE_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    for (i = 0; i < TEST_SENSITIVE_THREADS; i++) {
+        for (j = 0; j < TEST_SENSITIVE_ADDS; j++) {
+            snprintf(buffer, sizeof(buffer), "my.concurrent%d_%d", i, j);
+            if (!gSensitiveParamFilter.filteringSensitiveParam(buffer))
+                failed++;
+        }
+    }
+
+    printf("[concurrent] %d threads adding rules: %s\n", TEST_SENSITIVE_THREADS, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main()
+{
+    int failed = 0;
+
+    failed += TestMatcher();
+    failed += TestMask();
+    failed += TestConcurrentAdd();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -21,6 +21,8 @@
 #include "sqlite/sqlite3.h"
 #include "SettingsInterface.h"
 #include "SettingsUtilitySqlite3.h"
+#include "SettingsUtilityIniText.h"
+#include "SettingsRegistry.h"
 #include "KeepingSettingModify/SettingModifyRecordKeepingInterface.h"
 
 
@@ -59,6 +61,8 @@ int InitSettings(void)
 
     SqliteConnectDB(SQLITE_DATABASE_PATH);
     SqliteRecordLoading();
+    IniTextLoad(INI_TEXT_FILE_PATH);
+    SettingsRegistryLoad();
     //settingModifyRecordLoad();
 
     
@@ -70,48 +74,56 @@ int InitSettings(void)
 
 int SettingsOptionsGetInt(char* name, int value)
 {
-    char timestamp[32];  //YYYY-MM-DD HH:MM:SS
+    int id = SettingsIDByName(name);
     
-    settingsLogDebug("SettingsOptionsGetInt. \n");
-    SqliteRecordInquiry(name, &value, DATATYPE_INTEGER, timestamp);
+    if (id >= 0 && gSettingsDescriptors[id].type == SettingsType_Int)
+        return gSettingsIntValues[id];
     
-    return 0;
+    settingsLogDebug("SettingsOptionsGetInt [%s] not in schema. \n", name);
+    SqliteRecordInquiry(name, &value, DATATYPE_INTEGER, NULL);
+    
+    return value;
 }
 
 
 extern void settingModifyRecordSet(const char* name, const char* value, int module, const char* file);
 int SettingsOptionsSetInt(char* name, int value)
 {
+    int id = SettingsIDByName(name);
+    
     settingsLogDebug("SettingsOptionsSetInt. \n");
-    SqliteRecordModify(name, value, DATATYPE_INTEGER);
+    if (id >= 0)
+        return SettingsSetIntByID(id, value);
+    return SqliteRecordModify(name, &value, DATATYPE_INTEGER);
     //RecordChangedSource module;
     //char file[] = "system";
     //settingModifyRecordSet((const char*)name, (const char*)value, 2, (const char*)file);
-    
-    return 0;
 }
 
 
+//value 至少 SETTINGS_STRING_LENGTH_MAX 字节
 int SettingsOptionsGetString(char* name, char* value)
 {
-    char timestamp[32];  //YYYY-MM-DD HH:MM:SS
+    int id = SettingsIDByName(name);
     
     settingsLogDebug("SettingsOptionsGetString. \n");
-    SqliteRecordInquiry(name, value, DATATYPE_VARCHAR, timestamp);
-    
-    return 0;
+    if (id >= 0)
+        return SettingsGetStringByID(id, value, SETTINGS_STRING_LENGTH_MAX);
+    return SqliteRecordInquiry(name, value, DATATYPE_VARCHAR, NULL);
 }
 
 
 int SettingsOptionsSetString(char* name, char* value)
 {
+    int id = SettingsIDByName(name);
+    
     settingsLogDebug("SettingsOptionsSetString.\n");
-    SqliteRecordModify(name, value, DATATYPE_VARCHAR);
+    if (id >= 0)
+        return SettingsSetStringByID(id, value);
+    return SqliteRecordModify(name, value, DATATYPE_VARCHAR);
     //RecordChangedSource module;
     //char file[] = "system";
     //settingModifyRecordSet((const char*)name, (const char*)value, 2, (const char*)file);
-    
-    return 0;
 }
 
 
@@ -127,10 +139,17 @@ int SettingsOptionsSave(char* name, char* value)
 extern void settingModifyRecordReset(int module);
 int SettingsOptionsReset(char* name, char* value)
 {
+    int id;
+
     settingsLogDebug("SettingsOptionsReset.\n");
     //settingModifyRecordReset(2);  //RecordChangedSource module
 
-    return 0;
+    if (name == NULL)
+        return SettingsRegistryReset();
+    id = SettingsIDByName(name);
+    if (id < 0)     //不在 schema 中的名称与以前一样不处理
+        return 0;
+    return SettingsResetByID(id);
 }
 
 
@@ -4,12 +4,14 @@
  
 #define     SQLITE_DATABASE_PATH        "./sqlite_settings.db"
 #define     TABLE_NAME_LENGTH           64
+#define     INI_TEXT_FILE_PATH          "./yx_config_settings.ini"
 
  
 
 int InitSettings(void);
 
-int SettingsOptionsGetInt(char* name, int value);
+/* 按名称访问的兼容接口，schema 中的设置项转到 SettingsRegistry，新代码直接使用 SETTINGS_GET_INT 等宏 */
+int SettingsOptionsGetInt(char* name, int value);   //返回读到的值，没有该设置项时返回 value
 
 int SettingsOptionsSetInt(char* name, int value);
 
@@ -19,7 +21,7 @@ int SettingsOptionsSetString(char* name, char* value);
 
 int SettingsOptionsSave(char* name, char* value);
 
-int SettingsOptionsReset(char* name, char* value);
+int SettingsOptionsReset(char* name, char* value);  //name 为 NULL 时全部恢复默认值
 
 
 
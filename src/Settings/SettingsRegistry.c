@@ -0,0 +1,293 @@
+/**
+ *  SettingsRegistry.c文件
+ *  由 SettingsSchema.def 生成的设置项注册表；
+ *  主要有以下部分：
+ *          设置项描述表，按 SettingsID 下标访问
+ *          启动时从 sqlite / ini 加载
+ *          按 ID 读写，写入时校验范围并保存到对应的存储
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Log/LogC.h"
+#include "logSettings.h"
+#include "ThreadMutex.h"
+
+#include "SettingsRegistry.h"
+#include "SettingsUtilitySqlite3.h"
+#include "SettingsUtilityIniText.h"
+
+
+/* 编译期检查 schema：默认值在范围内，字符串长度不超过 SETTINGS_STRING_LENGTH_MAX */
+#define SETTINGS_ITEM_INT(id, name, def, min, max, storage) \
+    typedef char SettingsSchemaCheck_##id[((min) <= (def) && (def) <= (max)) ? 1 : -1];
+#define SETTINGS_ITEM_STRING(id, name, def, len, storage) \
+    typedef char SettingsSchemaCheck_##id[(sizeof(def) <= (len) && (len) <= SETTINGS_STRING_LENGTH_MAX) ? 1 : -1];
+#include SETTINGS_SCHEMA_FILE
+#undef SETTINGS_ITEM_INT
+#undef SETTINGS_ITEM_STRING
+
+
+const SettingsDescriptor gSettingsDescriptors[SettingsID_Max] = {
+    { "", SettingsType_Int, SettingsStorage_Volatile, 0, 0, 0, NULL, 0 },      //SettingsID_None
+#define SETTINGS_ITEM_INT(id, name, def, min, max, storage)     { name, SettingsType_Int, storage, def, min, max, NULL, 0 },
+#define SETTINGS_ITEM_STRING(id, name, def, len, storage)       { name, SettingsType_String, storage, 0, 0, 0, def, len },
+#include SETTINGS_SCHEMA_FILE
+#undef SETTINGS_ITEM_INT
+#undef SETTINGS_ITEM_STRING
+};
+
+int gSettingsIntValues[SettingsID_Max] = {
+    0,
+#define SETTINGS_ITEM_INT(id, name, def, min, max, storage)     def,
+#define SETTINGS_ITEM_STRING(id, name, def, len, storage)       0,
+#include SETTINGS_SCHEMA_FILE
+#undef SETTINGS_ITEM_INT
+#undef SETTINGS_ITEM_STRING
+};
+
+static char gSettingsStringValues[SettingsID_Max][SETTINGS_STRING_LENGTH_MAX];
+static int  gSettingsNameIndex[SettingsID_Max];         //按名称排序的 ID，用于 SettingsIDByName，不含 SettingsID_None
+static ThreadMutex_Type gSettingsRegistryMutex = NULL;  //保护写入和字符串读取
+static pthread_once_t gSettingsRegistryOnce = PTHREAD_ONCE_INIT;
+
+
+static int SettingsNameCompare(const void* a, const void* b)
+{
+    return strcmp(gSettingsDescriptors[*(const int*)a].name, gSettingsDescriptors[*(const int*)b].name);
+}
+
+
+/* 创建锁、排序名称索引、填入字符串默认值；任何接口第一次调用时执行一次 */
+static void SettingsRegistryInit(void)
+{
+    int id;
+
+    gSettingsRegistryMutex = ThreadMutexCreate();
+
+    for (id = 1; id < SettingsID_Max; id++) {
+        gSettingsNameIndex[id - 1] = id;
+        if (gSettingsDescriptors[id].type == SettingsType_String)
+            strcpy(gSettingsStringValues[id], gSettingsDescriptors[id].defaultString);
+    }
+    qsort(gSettingsNameIndex, SettingsID_Max - 1, sizeof(int), SettingsNameCompare);
+    for (id = 1; id < SettingsID_Max - 1; id++) {
+        if (SettingsNameCompare(&gSettingsNameIndex[id - 1], &gSettingsNameIndex[id]) == 0)
+            settingsLogError("duplicate settings name [%s] in schema.\n", gSettingsDescriptors[gSettingsNameIndex[id]].name);
+    }
+}
+
+
+static int SettingsPersist(int id)
+{
+    const SettingsDescriptor* desc = &gSettingsDescriptors[id];
+    int valueType = (desc->type == SettingsType_Int) ? DATATYPE_INTEGER : DATATYPE_VARCHAR;
+    void* value = (desc->type == SettingsType_Int) ? (void*)&gSettingsIntValues[id] : (void*)gSettingsStringValues[id];
+
+    switch(desc->storage) {
+    case SettingsStorage_Sqlite:
+        return SqliteRecordModify((char*)desc->name, value, valueType);
+    case SettingsStorage_IniText:
+        return IniTextRecordModify(desc->name, value, valueType);
+    default:
+        return 0;
+    }
+}
+
+
+static int SettingsRestore(int id)
+{
+    const SettingsDescriptor* desc = &gSettingsDescriptors[id];
+    char buffer[SETTINGS_STRING_LENGTH_MAX] = {0};
+    int intValue = 0;
+    int result = -1;
+
+    if (desc->type == SettingsType_Int) {
+        if (desc->storage == SettingsStorage_Sqlite)
+            result = SqliteRecordInquiry((char*)desc->name, &intValue, DATATYPE_INTEGER, NULL);
+        else if (desc->storage == SettingsStorage_IniText)
+            result = IniTextRecordInquiry(desc->name, &intValue, DATATYPE_INTEGER);
+
+        if (result == 0 && (intValue < desc->minValue || intValue > desc->maxValue)) {
+            settingsLogWarning("%s value[%d] out of range [%d, %d], use default.\n", desc->name, intValue, desc->minValue, desc->maxValue);
+            result = -1;
+        }
+        gSettingsIntValues[id] = (result == 0) ? intValue : desc->defaultInt;
+    } else {
+        if (desc->storage == SettingsStorage_Sqlite)
+            result = SqliteRecordInquiry((char*)desc->name, buffer, DATATYPE_VARCHAR, NULL);
+        else if (desc->storage == SettingsStorage_IniText)
+            result = IniTextRecordInquiry(desc->name, buffer, DATATYPE_VARCHAR);
+
+        if (result == 0 && (int)strlen(buffer) >= desc->maxLength) {
+            settingsLogWarning("%s value too long, use default.\n", desc->name);
+            result = -1;
+        }
+        strcpy(gSettingsStringValues[id], (result == 0) ? buffer : desc->defaultString);
+    }
+
+    return result;
+}
+
+
+int SettingsRegistryLoad(void)
+{
+    int id;
+    int loaded = 0;
+
+    settingsLogDebug("SettingsRegistryLoad. \n");
+    pthread_once(&gSettingsRegistryOnce, SettingsRegistryInit);
+
+    if (ThreadMutexLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    for (id = 1; id < SettingsID_Max; id++) {
+        if (SettingsRestore(id) == 0)
+            loaded++;
+    }
+    if (ThreadMutexUnLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    settingsLogInfo("settings registry loaded [%d/%d]. \n", loaded, SettingsID_Max - 1);
+    return 0;
+}
+
+
+int SettingsRegistryReset(void)
+{
+    int id;
+
+    for (id = 1; id < SettingsID_Max; id++)
+        SettingsResetByID(id);
+    return 0;
+}
+
+
+int SettingsIDByName(const char* name)
+{
+    int low = 0;
+    int high = SettingsID_Max - 2;
+
+    if (name == NULL)
+        return -1;
+    pthread_once(&gSettingsRegistryOnce, SettingsRegistryInit);
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int result = strcmp(name, gSettingsDescriptors[gSettingsNameIndex[middle]].name);
+        if (result == 0)
+            return gSettingsNameIndex[middle];
+        if (result < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+    return -1;
+}
+
+
+const SettingsDescriptor* SettingsDescriptorGet(int id)
+{
+    if (id <= SettingsID_None || id >= SettingsID_Max)
+        return NULL;
+    return &gSettingsDescriptors[id];
+}
+
+
+int SettingsGetIntByID(int id)
+{
+    if (id <= SettingsID_None || id >= SettingsID_Max || gSettingsDescriptors[id].type != SettingsType_Int) {
+        settingsLogError("invalid int settings id[%d].\n", id);
+        return 0;
+    }
+    return gSettingsIntValues[id];
+}
+
+
+int SettingsSetIntByID(int id, int value)
+{
+    const SettingsDescriptor* desc = SettingsDescriptorGet(id);
+
+    if (desc == NULL || desc->type != SettingsType_Int) {
+        settingsLogError("invalid int settings id[%d].\n", id);
+        return -1;
+    }
+    if (value < desc->minValue || value > desc->maxValue) {
+        settingsLogWarning("%s value[%d] out of range [%d, %d].\n", desc->name, value, desc->minValue, desc->maxValue);
+        return -1;
+    }
+
+    pthread_once(&gSettingsRegistryOnce, SettingsRegistryInit);
+    if (ThreadMutexLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    if (gSettingsIntValues[id] != value) {
+        gSettingsIntValues[id] = value;
+        SettingsPersist(id);
+    }
+    if (ThreadMutexUnLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return 0;
+}
+
+
+int SettingsGetStringByID(int id, char* value, int size)
+{
+    const SettingsDescriptor* desc = SettingsDescriptorGet(id);
+
+    if (desc == NULL || desc->type != SettingsType_String || value == NULL || size <= 0) {
+        settingsLogError("invalid string settings id[%d].\n", id);
+        return -1;
+    }
+
+    pthread_once(&gSettingsRegistryOnce, SettingsRegistryInit);
+    if (ThreadMutexLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    strncpy(value, gSettingsStringValues[id], size - 1);
+    value[size - 1] = '\0';
+    if (ThreadMutexUnLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return 0;
+}
+
+
+int SettingsSetStringByID(int id, const char* value)
+{
+    const SettingsDescriptor* desc = SettingsDescriptorGet(id);
+
+    if (desc == NULL || desc->type != SettingsType_String || value == NULL) {
+        settingsLogError("invalid string settings id[%d].\n", id);
+        return -1;
+    }
+    if ((int)strlen(value) >= desc->maxLength) {
+        settingsLogWarning("%s value too long, max length[%d].\n", desc->name, desc->maxLength - 1);
+        return -1;
+    }
+
+    pthread_once(&gSettingsRegistryOnce, SettingsRegistryInit);
+    if (ThreadMutexLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    if (strcmp(gSettingsStringValues[id], value) != 0) {
+        strcpy(gSettingsStringValues[id], value);
+        SettingsPersist(id);
+    }
+    if (ThreadMutexUnLock(gSettingsRegistryMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    return 0;
+}
+
+
+int SettingsResetByID(int id)
+{
+    const SettingsDescriptor* desc = SettingsDescriptorGet(id);
+
+    if (desc == NULL)
+        return -1;
+    if (desc->type == SettingsType_Int)
+        return SettingsSetIntByID(id, desc->defaultInt);
+    return SettingsSetStringByID(id, desc->defaultString);
+}
@@ -0,0 +1,119 @@
+#ifndef __SETTINGS_REGISTRY_H__
+#define __SETTINGS_REGISTRY_H__
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define     SETTINGS_STRING_LENGTH_MAX      128     //与 sqlite 表中 VARCHAR(128) 一致
+
+
+typedef enum {
+    SettingsType_Int = 0,
+    SettingsType_String
+} SettingsType;
+
+typedef enum {
+    SettingsStorage_Sqlite = 0,
+    SettingsStorage_IniText,
+    SettingsStorage_Volatile
+} SettingsStorage;
+
+
+/* 测试程序可以在包含本文件之前定义为自己的 schema */
+#ifndef SETTINGS_SCHEMA_FILE
+#define SETTINGS_SCHEMA_FILE            "SettingsSchema.def"
+#endif
+
+
+/* 由 SettingsSchema.def 生成设置项 ID，名称写错时编译失败；0 保留不用，schema 为空时数组也不为空 */
+typedef enum {
+    SettingsID_None = 0,
+#define SETTINGS_ITEM_INT(id, name, def, min, max, storage)     SettingsID_##id,
+#define SETTINGS_ITEM_STRING(id, name, def, len, storage)       SettingsID_##id,
+#include SETTINGS_SCHEMA_FILE
+#undef SETTINGS_ITEM_INT
+#undef SETTINGS_ITEM_STRING
+    SettingsID_Max
+} SettingsID;
+
+/* 每个 ID 的值类型，供 SETTINGS_GET_INT 等宏在编译期检查 */
+enum {
+#define SETTINGS_ITEM_INT(id, name, def, min, max, storage)     SettingsTypeOf_##id = SettingsType_Int,
+#define SETTINGS_ITEM_STRING(id, name, def, len, storage)       SettingsTypeOf_##id = SettingsType_String,
+#include SETTINGS_SCHEMA_FILE
+#undef SETTINGS_ITEM_INT
+#undef SETTINGS_ITEM_STRING
+    SettingsTypeOf_Max
+};
+
+
+typedef struct _SettingsDescriptor {
+    const char*     name;           //持久化时使用的键名
+    int             type;           //SettingsType
+    int             storage;        //SettingsStorage
+    int             defaultInt;
+    int             minValue;
+    int             maxValue;
+    const char*     defaultString;
+    int             maxLength;      //字符串最大长度，含 '\0'
+} SettingsDescriptor;
+
+
+extern const SettingsDescriptor gSettingsDescriptors[SettingsID_Max];
+extern int gSettingsIntValues[SettingsID_Max];       //只在 SettingsRegistry.c 中修改，读取不加锁
+
+
+#define SETTINGS_TYPE_CHECK(id, type)   ((void)sizeof(char[((int)SettingsTypeOf_##id == (int)(type)) ? 1 : -1]))
+
+/* 按 ID 读写，例如 SETTINGS_GET_INT(PlayerVolume)；ID 不存在或类型不对时编译失败 */
+#define SETTINGS_GET_INT(id)                    (SETTINGS_TYPE_CHECK(id, SettingsType_Int), gSettingsIntValues[SettingsID_##id])
+#define SETTINGS_SET_INT(id, value)             (SETTINGS_TYPE_CHECK(id, SettingsType_Int), SettingsSetIntByID(SettingsID_##id, (value)))
+#define SETTINGS_GET_STRING(id, value, size)    (SETTINGS_TYPE_CHECK(id, SettingsType_String), SettingsGetStringByID(SettingsID_##id, (value), (size)))
+#define SETTINGS_SET_STRING(id, value)          (SETTINGS_TYPE_CHECK(id, SettingsType_String), SettingsSetStringByID(SettingsID_##id, (value)))
+
+
+/**
+ *  @Func: SettingsRegistryLoad
+ *         ps. :从 sqlite / ini 中读取各设置项，没有记录或超出范围时使用默认值；
+ *              需在 SqliteConnectDB、IniTextLoad 之后调用
+ *  @Return: int
+ *
+ **/
+int SettingsRegistryLoad(void);
+
+/**
+ *  @Func: SettingsRegistryReset
+ *         ps. :所有设置项恢复默认值并保存
+ *  @Return: int
+ *
+ **/
+int SettingsRegistryReset(void);
+
+/**
+ *  @Func: SettingsIDByName
+ *         ps. :兼容按名称访问的接口，二分查找；在 SettingsRegistryLoad 之前调用也可以
+ *  @Param: name, type:: const char*
+ *  @Return: int, SettingsID，找不到时返回 -1
+ *
+ **/
+int SettingsIDByName(const char* name);
+
+const SettingsDescriptor* SettingsDescriptorGet(int id);
+
+/* 在 SettingsRegistryLoad 之前调用时读到的是默认值 */
+int SettingsGetIntByID(int id);
+int SettingsSetIntByID(int id, int value);                          //超出范围或类型不对时返回 -1
+int SettingsGetStringByID(int id, char* value, int size);
+int SettingsSetStringByID(int id, const char* value);               //超出长度时返回 -1
+int SettingsResetByID(int id);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__SETTINGS_REGISTRY_H__
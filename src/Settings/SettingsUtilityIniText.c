@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "Log/LogC.h"
 #include "logSettings.h"
@@ -22,29 +23,248 @@
 
 ThreadMutex_Type     gSettingsIniTextMutex = NULL;
 
+static char  gIniTextPath[256] = {0};
+static char** gIniTextLines = NULL;     //文件中的每一行，不含换行符
+static int   gIniTextLineCount = 0;
+static int   gIniTextLineCapacity = 0;
+
 
 /**
- *  创建数据表
- *  清空数据表
- *  添加记录
- *  删除记录
- *  修改记录
- *  查询记录
- *  
- *  根据所存储的数据类型，创建2张表；
- *      INT （或INTEGER）数据类型，存储从-2的31次方 （-2 ，147 ，483 ，648） 到2的31次方-1 （2 ，147 ，483，647） 之间的所有正负整数。
- *                  每个INT 类型的数据按4 个字节存储，其中1 位表示整数值的正负号，其它31 位表示整数值的长度和大小。
- *      VARCHAR数据类型，定义形式为VARCHAR [ （n） ]。 它与CHAR 类型相似，n 的取值也为1 到8000， 
- *                  若输入的数据过长，将会截掉其超出部分。不同的是，VARCHAR数据类型具有变动长度的特性，因为VARCHAR数据类型的存储长度为实际数值长度，
- *                  若输入数据的字符数小于n ，则系统不会在其后添加空格来填满设定好的空间。
- *                  一般情况下，由于CHAR 数据类型长度固定，因此它比VARCHAR 类型的处理速度快。
+ *  文本格式：
+ *      # 注释
+ *      name=value
  *  
- *  表的格式：
- *  ID----Name----Value(int/varchar)----MDate
+ *  name 两端的空白会被忽略，value 保留到行尾(去掉行尾空白)
  *  
  **/
 
 
+static int IniTextAppendLine(const char* line)
+{
+    char* copy;
+
+    if (gIniTextLineCount == gIniTextLineCapacity) {
+        int capacity = gIniTextLineCapacity ? gIniTextLineCapacity * 2 : 32;
+        char** lines = (char**)realloc(gIniTextLines, capacity * sizeof(char*));
+        if (lines == NULL)
+            return -1;
+        gIniTextLines = lines;
+        gIniTextLineCapacity = capacity;
+    }
+    copy = strdup(line);
+    if (copy == NULL)
+        return -1;
+    gIniTextLines[gIniTextLineCount++] = copy;
+    return 0;
+}
+
+
+//返回 name 所在的行号，valueStart 指向该行中 value 的开始
+static int IniTextFindLine(const char* name, const char** valueStart)
+{
+    int nameLength = strlen(name);
+    int i;
+
+    for (i = 0; i < gIniTextLineCount; i++) {
+        const char* p = gIniTextLines[i];
+        const char* end;
+
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '#' || *p == ';' || *p == '[' || *p == '\0')
+            continue;
+        end = strchr(p, '=');
+        if (end == NULL)
+            continue;
+        while (end > p && (end[-1] == ' ' || end[-1] == '\t'))
+            end--;
+        if (end - p == nameLength && strncmp(p, name, nameLength) == 0) {
+            if (valueStart != NULL) {
+                p = strchr(p, '=') + 1;
+                while (*p == ' ' || *p == '\t')
+                    p++;
+                *valueStart = p;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+static int IniTextSave()
+{
+    char tmpPath[sizeof(gIniTextPath) + 8];
+    FILE* fp;
+    int i;
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", gIniTextPath);
+    fp = fopen(tmpPath, "w");
+    if (fp == NULL) {
+        settingsLogError("open %s error.\n", tmpPath);
+        return -1;
+    }
+    for (i = 0; i < gIniTextLineCount; i++)
+        fprintf(fp, "%s\n", gIniTextLines[i]);
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose(fp);
+
+    if (rename(tmpPath, gIniTextPath) != 0) {
+        settingsLogError("rename %s error.\n", tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+
+//读取文件
+int IniTextLoad(const char* path)
+{
+    char line[INI_TEXT_LINE_LENGTH_MAX];
+    FILE* fp;
+
+    settingsLogDebug("IniTextLoad. \n");
+    if (path == NULL)
+        return -1;
+    if (gSettingsIniTextMutex == NULL)
+        gSettingsIniTextMutex = ThreadMutexCreate();
+
+    IniTextClose();
+    if (ThreadMutexLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+
+    strncpy(gIniTextPath, path, sizeof(gIniTextPath) - 1);
+    fp = fopen(path, "r");
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            int length = strlen(line);
+            while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t'))
+                line[--length] = '\0';
+            if (IniTextAppendLine(line) != 0) {
+                settingsLogError("out of memory.\n");
+                break;
+            }
+        }
+        fclose(fp);
+    } else {
+        settingsLogInfo("%s not exist, create when modified.\n", path);
+    }
+
+    if (ThreadMutexUnLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    settingsLogDebug("IniTextLoad END, lines[%d]. \n", gIniTextLineCount);
+    return 0;
+}
+
+
+//释放内存中的拷贝
+int IniTextClose()
+{
+    int i;
+
+    if (ThreadMutexLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    for (i = 0; i < gIniTextLineCount; i++)
+        free(gIniTextLines[i]);
+    free(gIniTextLines);
+    gIniTextLines = NULL;
+    gIniTextLineCount = 0;
+    gIniTextLineCapacity = 0;
+
+    if (ThreadMutexUnLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    return 0;
+}
+
+
+//查询记录
+int IniTextRecordInquiry(const char* name, void* value, int valueType)
+{
+    const char* valueStart = NULL;
+    int result = -1;
+
+    if (name == NULL || value == NULL)
+        return -1;
+
+    if (ThreadMutexLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    if (IniTextFindLine(name, &valueStart) >= 0) {
+        switch(valueType){
+        case DATATYPE_INTEGER:
+            *(int*)value = atoi(valueStart);
+            result = 0;
+            break;
+        case DATATYPE_VARCHAR:
+            strncpy((char*)value, valueStart, SQLITE_VARCHAR_LENGTH_MAX - 1);
+            ((char*)value)[SQLITE_VARCHAR_LENGTH_MAX - 1] = '\0';
+            result = 0;
+            break;
+        default:
+            settingsLogWarning("valueType is [%d] error.\n", valueType);
+            break;
+        }
+    }
+
+    if (ThreadMutexUnLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    return result;
+}
+
+
+//修改记录，没有该记录时追加到文件末尾
+int IniTextRecordModify(const char* name, void* value, int valueType)
+{
+    char line[INI_TEXT_LINE_LENGTH_MAX];
+    char* copy;
+    int index;
+    int result;
+
+    if (name == NULL || value == NULL)
+        return -1;
+    switch(valueType){
+    case DATATYPE_INTEGER:
+        snprintf(line, sizeof(line), "%s=%d", name, *(int*)value);
+        break;
+    case DATATYPE_VARCHAR:
+        snprintf(line, sizeof(line), "%s=%s", name, (char*)value);
+        break;
+    default:
+        settingsLogWarning("valueType is [%d] error.\n", valueType);
+        return -1;
+    }
+
+    if (ThreadMutexLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    index = IniTextFindLine(name, NULL);
+    if (index >= 0) {
+        copy = strdup(line);
+        if (copy != NULL) {
+            free(gIniTextLines[index]);
+            gIniTextLines[index] = copy;
+            result = 0;
+        } else {
+            result = -1;
+        }
+    } else {
+        result = IniTextAppendLine(line);
+    }
+    if (result == 0)
+        result = IniTextSave();
+
+    if (ThreadMutexUnLock(gSettingsIniTextMutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    return result;
+}
+
+
+
+
+
 
 
 
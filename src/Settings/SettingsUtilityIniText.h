@@ -3,38 +3,25 @@
 
 
 
+#include "SettingsUtilitySqlite3.h"      //DATATYPE_INTEGER / DATATYPE_VARCHAR
+
+
+#define INI_TEXT_LINE_LENGTH_MAX        512
+
+
 /**
- *  创建数据表
- *  清空数据表
- *  添加记录
- *  删除记录
- *  修改记录
- *  查询记录
- *  
- *  根据所存储的数据类型，创建2张表；
- *      INT （或INTEGER）数据类型，存储从-2的31次方 （-2 ，147 ，483 ，648） 到2的31次方-1 （2 ，147 ，483，647） 之间的所有正负整数。
- *                  每个INT 类型的数据按4 个字节存储，其中1 位表示整数值的正负号，其它31 位表示整数值的长度和大小。
- *      VARCHAR数据类型，定义形式为VARCHAR [ （n） ]。 它与CHAR 类型相似，n 的取值也为1 到8000， 
- *                  若输入的数据过长，将会截掉其超出部分。不同的是，VARCHAR数据类型具有变动长度的特性，因为VARCHAR数据类型的存储长度为实际数值长度，
- *                  若输入数据的字符数小于n ，则系统不会在其后添加空格来填满设定好的空间。
- *                  一般情况下，由于CHAR 数据类型长度固定，因此它比VARCHAR 类型的处理速度快。
- *  
- *  表的格式：
- *  ID----Name----Value(int/varchar)----ModifyDate
+ *  文本格式的设置项存储，每行一个 "name=value"；
+ *  以 '#' 或 ';' 开头的行和 [section] 行原样保留，修改时只替换对应的行；
+ *  保存时先写临时文件再 rename，避免掉电后文件损坏。
  *  
  **/
 
 
-int SqliteConnectDB(const char* dbPath);
-int SqliteTableClose();
-int SqliteTableCreate(int flag);
-int SqliteTableClear(int flag);
+int IniTextLoad(const char* path);
+int IniTextClose();
 
-int SqliteRecordAdd(char* name, void* value, int valueType);
-int SqliteRecordDelete(char* name, void* value, int valueType);
-int SqliteRecordModify(char* name, void* value, int valueType);
-int SqliteRecordInquiry(char* name, void* value, int valueType, char* timestamp);
-int SqliteRecordLoading();
+int IniTextRecordInquiry(const char* name, void* value, int valueType);    //DATATYPE_VARCHAR 时 value 至少 SQLITE_VARCHAR_LENGTH_MAX 字节，没有该记录时返回 -1
+int IniTextRecordModify(const char* name, void* value, int valueType);     //修改后立即写回文件
  
 
 
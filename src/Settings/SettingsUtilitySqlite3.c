@@ -76,6 +76,9 @@ int SqliteConnectDB(const char* dbPath)
     sprintf(sqlBuf, "SELECT * FROM %s ;", SQLITE_DB_TABLE_NAME_INT);
     sqlite3_get_table(gSettingsDB, sqlBuf, &ret, &row, &column, &errmsg);
     settingsLogInfo("row[%d], column[%d]. \n", row, column);
+    sqlite3_free_table(ret);
+    sqlite3_free(errmsg);
+    errmsg = NULL;
     if(column != 4){
         flag = flag | TABLE_EXIST_FLAG_INTEGER;
     }
@@ -83,6 +86,9 @@ int SqliteConnectDB(const char* dbPath)
     sprintf(sqlBuf, "SELECT * FROM %s ;", SQLITE_DB_TABLE_NAME_CHAR);
     sqlite3_get_table(gSettingsDB, sqlBuf, &ret, &row, &column, &errmsg);
     settingsLogInfo("row[%d], column[%d]. \n", row, column);
+    sqlite3_free_table(ret);
+    sqlite3_free(errmsg);
+    errmsg = NULL;
     if(column != 4)
         flag = flag | TABLE_EXIST_FLAG_VAECHAR;
     
@@ -141,6 +147,8 @@ int SqliteTableCreate(int flag)
         result = sqlite3_exec( gSettingsDB, sqlBuf, NULL, NULL, &errmsg );
         if (result != SQLITE_OK ) {
             settingsLogWarning( "创建表失败，错误码:%d，错误原因:%s\n", result, errmsg );
+            sqlite3_free(errmsg);
+            errmsg = NULL;
         }
     }
     
@@ -151,10 +159,12 @@ int SqliteTableCreate(int flag)
                         %s %s NOT NULL, \
                         %s %s NOT NULL, \
                         %s %s NOT NULL DEFAULT (datetime('now', 'localtime')));", SQLITE_DB_TABLE_NAME_CHAR, 
-                COLUM_1_NAME, COLUM_1_TYPE, COLUM_2_NAME, COLUM_2_TYPE, COLUM_3_NAME, COLUM_3_TYPE_1, COLUM_4_NAME, COLUM_4_TYPE);
+                COLUM_1_NAME, COLUM_1_TYPE, COLUM_2_NAME, COLUM_2_TYPE, COLUM_3_NAME, COLUM_3_TYPE_2, COLUM_4_NAME, COLUM_4_TYPE);
         result = sqlite3_exec( gSettingsDB, sqlBuf, NULL, NULL, &errmsg );
         if (result != SQLITE_OK ) {
             settingsLogWarning( "创建表失败，错误码:%d，错误原因:%s\n", result, errmsg );
+            sqlite3_free(errmsg);
+            errmsg = NULL;
         }
     }
     if (ThreadMutexUnLock(gSettingsSqlite3Mutex))
@@ -180,6 +190,8 @@ int SqliteTableClear(int flag)
         result = sqlite3_exec( gSettingsDB, sqlBuf, NULL, NULL, &errmsg );
         if (result != SQLITE_OK ) {
             settingsLogWarning( "创建表失败，错误码:%d，错误原因:%s\n", result, errmsg );
+            sqlite3_free(errmsg);
+            errmsg = NULL;
         }
     }
 
@@ -188,6 +200,8 @@ int SqliteTableClear(int flag)
         result = sqlite3_exec( gSettingsDB, sqlBuf, NULL, NULL, &errmsg );
         if (result != SQLITE_OK ) {
             settingsLogWarning( "创建表失败，错误码:%d，错误原因:%s\n", result, errmsg );
+            sqlite3_free(errmsg);
+            errmsg = NULL;
         }
     }
     if (ThreadMutexUnLock(gSettingsSqlite3Mutex))
@@ -283,30 +297,35 @@ int SqliteRecordDelete(char* name, void* value, int valueType)
 }
  
 //修改记录
-    //update table1 set field1=value1 where 范围
+    //update table1 set field1=value1 where 范围，没有该记录时插入
 int SqliteRecordModify(char* name, void* value, int valueType)
 {
     int result;
     char *errmsg = NULL;
-    char sqlBuf[128] = {0};
+    char *sqlUpdate = NULL;
+    char *sqlInsert = NULL;
     
     settingsLogDebug("SqliteRecordModify. \n");
+    if(name == NULL || value == NULL)
+        return -1;
     
     switch(valueType){
     case DATATYPE_INTEGER:{
         settingsLogDebug("DATATYPE_INTEGER. \n");
         int* tmpValue = (int*)value;
-        sprintf(sqlBuf, "UPDATE %s SET Value=%d WHERE Name=%s;", SQLITE_DB_TABLE_NAME_INT, *tmpValue, name);
+        sqlUpdate = sqlite3_mprintf("UPDATE %s SET Value=%d, MDATE=datetime('now', 'localtime') WHERE Name=%Q;", SQLITE_DB_TABLE_NAME_INT, *tmpValue, name);
+        sqlInsert = sqlite3_mprintf("INSERT INTO %s( NAME, VALUE ) VALUES(%Q, %d);", SQLITE_DB_TABLE_NAME_INT, name, *tmpValue);
         break;
         }
     case DATATYPE_VARCHAR:{
         settingsLogDebug("DATATYPE_VARCHAR. \n");
-        sprintf(sqlBuf, "UPDATE %s SET Value=%s WHERE Name=%s;", SQLITE_DB_TABLE_NAME_CHAR, value, name);
+        sqlUpdate = sqlite3_mprintf("UPDATE %s SET Value=%Q, MDATE=datetime('now', 'localtime') WHERE Name=%Q;", SQLITE_DB_TABLE_NAME_CHAR, (char*)value, name);
+        sqlInsert = sqlite3_mprintf("INSERT INTO %s( NAME, VALUE ) VALUES(%Q, %Q);", SQLITE_DB_TABLE_NAME_CHAR, name, (char*)value);
         break;
         }
     default:{
         settingsLogWarning("valueType is [%d] error.\n", valueType);
-        break;   
+        return -1;
         }    
     }
     
@@ -314,75 +333,89 @@ int SqliteRecordModify(char* name, void* value, int valueType)
     if (ThreadMutexLock(gSettingsSqlite3Mutex))
         settingsLogWarning("thread mutex locking error.\n");
     
-    result = sqlite3_exec( gSettingsDB, sqlBuf, NULL, NULL, &errmsg );
+    result = sqlite3_exec( gSettingsDB, sqlUpdate, NULL, NULL, &errmsg );
+    if (result == SQLITE_OK && sqlite3_changes(gSettingsDB) == 0) {
+        result = sqlite3_exec( gSettingsDB, sqlInsert, NULL, NULL, &errmsg );
+    }
     if (result != SQLITE_OK ) {
         settingsLogWarning( "更新记录失败，错误码:%d，错误原因:%s \n", result, errmsg );
+        sqlite3_free(errmsg);
     }
     
     
     if (ThreadMutexUnLock(gSettingsSqlite3Mutex))
         settingsLogWarning("thread mutex locking error.\n");
     
-    return 0;
+    sqlite3_free(sqlUpdate);
+    sqlite3_free(sqlInsert);
+    return (result == SQLITE_OK) ? 0 : -1;
 }
  
 //查询记录
 //查询语句：select * from 表名 where 条件子句 group by 分组字句 having ... order by 排序子句
+//value: DATATYPE_INTEGER 时为 int*，DATATYPE_VARCHAR 时至少 SQLITE_VARCHAR_LENGTH_MAX 字节；timestamp 至少 32 字节，可为 NULL
+//没有该记录时返回 -1，value 不变
 int SqliteRecordInquiry(char* name, void* value, int valueType, char* timestamp)
 {
     int result;
     char *errmsg = NULL;
-    char sqlBuf[128] = {0};
-    char **ret;//二维数组用于存放结果
-    int row, column;
-    int i = 0;
+    char *sqlBuf = NULL;
+    char **ret = NULL;//二维数组用于存放结果
+    int row = 0, column = 0;
     
     settingsLogDebug("SqliteRecordInquiry. \n");
-    //value = (void*)malloc(sizeof(int));
+    if(name == NULL)
+        return -1;
     
     //int sqlite3_get_table(sqlite3 *,const char *sql,char ***result,int *nrow,int *ncolumn,char **errmsg);
     //ret：以数组的形式存放所要查询的数据，首先是表名，然后才是数据;nrow和ncolumn分别用于记录查询语句返回的结果的行数和列数，没有查到结果是返回0
 
     //ID NAME  VALUE  MDATE
     switch(valueType){
-    case DATATYPE_INTEGER:{
-        settingsLogDebug("DATATYPE_INTEGER. \n");
-        sprintf(sqlBuf, "SELECT * FROM %s WHERE Name=%s;", SQLITE_DB_TABLE_NAME_INT, name);
-        sqlite3_get_table(gSettingsDB, sqlBuf, &ret, &row, &column, &errmsg);
-        
-        if(value != NULL)
-            ;//(int)*value = atoi(ret[2]);
-        
-        if(timestamp != NULL)
-            timestamp = ret[3];
-        
+    case DATATYPE_INTEGER:
+        sqlBuf = sqlite3_mprintf("SELECT * FROM %s WHERE Name=%Q;", SQLITE_DB_TABLE_NAME_INT, name);
         break;
-        }
-    case DATATYPE_VARCHAR:{
-        settingsLogDebug("DATATYPE_VARCHAR. \n");
-        sprintf(sqlBuf, "SELECT * FROM %s WHERE Name=%s;", SQLITE_DB_TABLE_NAME_CHAR, name);
-        sqlite3_get_table(gSettingsDB, sqlBuf, &ret, &row, &column, &errmsg);
-        
-        if(value != NULL)
-            value = (void*)ret[2];
-        
-        if(timestamp != NULL)
-            timestamp = ret[3];
-        
+    case DATATYPE_VARCHAR:
+        sqlBuf = sqlite3_mprintf("SELECT * FROM %s WHERE Name=%Q;", SQLITE_DB_TABLE_NAME_CHAR, name);
         break;
-        }
     default:{
         settingsLogWarning("valueType is [%d] error.\n", valueType);
-        break;   
+        return -1;
         }    
     }
     
-    //输出查询的数据
-    for(i = 0; i < (row + 1) * column; i++)
-        printf("result[%d]=%s\n", i, ret[i]);
-        
-
-    return 0;
+    if (ThreadMutexLock(gSettingsSqlite3Mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    result = sqlite3_get_table(gSettingsDB, sqlBuf, &ret, &row, &column, &errmsg);
+    if (result != SQLITE_OK) {
+        settingsLogWarning( "查询记录失败，错误码:%d，错误原因:%s \n", result, errmsg );
+        sqlite3_free(errmsg);
+    } else if (row >= 1 && column == 4 && ret[column + 2] != NULL) {
+        //第 0 行为字段名，取最后一行(最新插入的)记录
+        char** record = ret + row * column;
+        if(value != NULL) {
+            if(valueType == DATATYPE_INTEGER) {
+                *(int*)value = atoi(record[2]);
+            } else {
+                strncpy((char*)value, record[2], SQLITE_VARCHAR_LENGTH_MAX - 1);
+                ((char*)value)[SQLITE_VARCHAR_LENGTH_MAX - 1] = '\0';
+            }
+        }
+        if(timestamp != NULL && record[3] != NULL) {
+            strncpy(timestamp, record[3], 31);
+            timestamp[31] = '\0';
+        }
+    } else {
+        result = -1;
+    }
+    sqlite3_free_table(ret);
+    
+    if (ThreadMutexUnLock(gSettingsSqlite3Mutex))
+        settingsLogWarning("thread mutex locking error.\n");
+    
+    sqlite3_free(sqlBuf);
+    return (result == SQLITE_OK) ? 0 : -1;
 }
 
 
@@ -15,6 +15,7 @@
 #define COLUM_3_NAME                "Value"
 #define COLUM_3_TYPE_1              "INTEGER"
 #define COLUM_3_TYPE_2              "VARCHAR(128)"
+#define SQLITE_VARCHAR_LENGTH_MAX   128
 
 #define COLUM_4_NAME                "MDATE"
 #define COLUM_4_TYPE                "TimeStamp"
@@ -0,0 +1,189 @@
+/**
+ *  TestSettingsRegistry.c文件
+ *  设置项注册表的测试，使用 TestSettingsSchema.def 中的设置项：
+ *          SettingsRegistryLoad 之前按名称查找、读取默认值
+ *          写入超出范围、超出长度、类型不对时返回 -1 且值不变
+ *          ini / sqlite 中保存的值重新加载后相同，超出范围的值加载时恢复默认值
+ *
+ *  用法：TestSettingsRegistry.elf [工作目录，默认 /tmp]
+ *
+ **/
+
+#define SETTINGS_SCHEMA_FILE    "TestSettingsSchema.def"
+#include "SettingsRegistry.c"
+
+#include <unistd.h>
+
+
+extern ThreadMutex_Type gSettingsSqlite3Mutex;
+
+static char sIniPath[256];
+static char sDbPath[256];
+
+static int TestFileContains(const char* fileName, const char* text)
+{
+    char line[INI_TEXT_LINE_LENGTH_MAX];
+    int found = 0;
+    FILE* fp = fopen(fileName, "r");
+
+    if (fp == NULL)
+        return 0;
+    while (!found && fgets(line, sizeof(line), fp) != NULL)
+        found = (strstr(line, text) != NULL);
+    fclose(fp);
+    return found;
+}
+
+static int TestLookup(void)
+{
+    char value[SETTINGS_STRING_LENGTH_MAX];
+    int failed = 0, id;
+
+    /* 还没有调用 SettingsRegistryLoad */
+    for (id = 1; id < SettingsID_Max; id++) {
+        if (SettingsIDByName(gSettingsDescriptors[id].name) != id)
+            failed++;
+    }
+    if (SettingsIDByName("test.unknown") != -1 || SettingsIDByName("") != -1 || SettingsIDByName(NULL) != -1)
+        failed++;
+    if (SETTINGS_GET_INT(TestVolume) != 50 || SettingsGetIntByID(SettingsID_TestBufferMs) != 200)
+        failed++;
+    if (SETTINGS_GET_STRING(TestTimeZone, value, sizeof(value)) != 0 || strcmp(value, "+08:00") != 0)
+        failed++;
+    if (SettingsDescriptorGet(SettingsID_None) != NULL || SettingsDescriptorGet(SettingsID_Max) != NULL)
+        failed++;
+
+    printf("[lookup] %d items before load: %s\n", SettingsID_Max - 1, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestRange(void)
+{
+    char value[SETTINGS_STRING_LENGTH_MAX];
+    int failed = 0;
+
+    if (SETTINGS_SET_INT(TestLogLevel, 7) != -1 || SETTINGS_SET_INT(TestLogLevel, -1) != -1 || SETTINGS_GET_INT(TestLogLevel) != 5)
+        failed++;
+    if (SETTINGS_SET_INT(TestLogLevel, 0) != 0 || SETTINGS_GET_INT(TestLogLevel) != 0)
+        failed++;
+    if (SETTINGS_SET_INT(TestLogLevel, 6) != 0 || SETTINGS_GET_INT(TestLogLevel) != 6)
+        failed++;
+
+    /* 最大长度含 '\0' */
+    if (SETTINGS_SET_STRING(TestTimeZone, "+08:00:00+08:00x") != -1)
+        failed++;
+    if (SETTINGS_SET_STRING(TestTimeZone, "+08:00:00+08:00") != 0)
+        failed++;
+    if (SETTINGS_GET_STRING(TestTimeZone, value, 4) != 0 || strcmp(value, "+08") != 0)
+        failed++;
+
+    /* 类型不对 */
+    if (SettingsSetIntByID(SettingsID_TestLanguage, 1) != -1 || SettingsSetStringByID(SettingsID_TestVolume, "1") != -1
+        || SettingsSetIntByID(SettingsID_None, 0) != -1 || SettingsSetIntByID(-1, 0) != -1)
+        failed++;
+
+    printf("[range] out of range values rejected: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestIniText(void)
+{
+    char value[SETTINGS_STRING_LENGTH_MAX];
+    FILE* fp;
+    int failed = 0;
+
+    /* test.aspect 超出范围，其他行原样保留 */
+    fp = fopen(sIniPath, "w");
+    if (fp == NULL)
+        return 1;
+    fputs("# settings\ntest.bufferMs=800\ntest.aspect=9\ntest.timeZone=+07:00\nother=1\n", fp);
+    fclose(fp);
+
+    IniTextLoad(sIniPath);
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestBufferMs) != 800 || SETTINGS_GET_INT(TestAspect) != 0)
+        failed++;
+    if (SETTINGS_GET_STRING(TestTimeZone, value, sizeof(value)) != 0 || strcmp(value, "+07:00") != 0)
+        failed++;
+    /* 只在内存中的设置项加载后为默认值 */
+    if (SETTINGS_GET_INT(TestLogLevel) != 5)
+        failed++;
+
+    if (SETTINGS_SET_INT(TestBufferMs, 3000) != -1 || SETTINGS_SET_INT(TestBufferMs, 1500) != 0 || SETTINGS_SET_INT(TestAspect, 2) != 0)
+        failed++;
+    if (!TestFileContains(sIniPath, "test.bufferMs=1500") || !TestFileContains(sIniPath, "# settings") || !TestFileContains(sIniPath, "other=1"))
+        failed++;
+
+    IniTextClose();
+    IniTextLoad(sIniPath);
+    SETTINGS_SET_INT(TestBufferMs, 20);
+    SETTINGS_SET_INT(TestAspect, 3);
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestBufferMs) != 20 || SETTINGS_GET_INT(TestAspect) != 3)
+        failed++;
+    IniTextClose();
+    unlink(sIniPath);
+
+    printf("[ini] persisted and reloaded: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+static int TestSqlite(void)
+{
+    char value[SETTINGS_STRING_LENGTH_MAX];
+    int intValue = 101;
+    int failed = 0;
+
+    unlink(sDbPath);
+    if (SqliteConnectDB(sDbPath) != 0)
+        failed++;
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestVolume) != 50)
+        failed++;
+    if (SETTINGS_SET_INT(TestVolume, 101) != -1 || SETTINGS_SET_INT(TestVolume, 80) != 0 || SETTINGS_SET_STRING(TestLanguage, "eng") != 0)
+        failed++;
+    SqliteTableClose();
+
+    if (SqliteConnectDB(sDbPath) != 0)
+        failed++;
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestVolume) != 80)
+        failed++;
+    if (SETTINGS_GET_STRING(TestLanguage, value, sizeof(value)) != 0 || strcmp(value, "eng") != 0)
+        failed++;
+
+    /* 绕过注册表写入超出范围的值 */
+    if (SqliteRecordModify("test.volume", &intValue, DATATYPE_INTEGER) != 0)
+        failed++;
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestVolume) != 50)
+        failed++;
+
+    SettingsRegistryReset();
+    SettingsRegistryLoad();
+    if (SETTINGS_GET_INT(TestVolume) != 50 || SETTINGS_GET_STRING(TestLanguage, value, sizeof(value)) != 0 || strcmp(value, "chi") != 0)
+        failed++;
+    SqliteTableClose();
+    unlink(sDbPath);
+
+    printf("[sqlite] persisted and reloaded: %s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    const char* directory = (argc > 1) ? argv[1] : "/tmp";
+    int failed = 0;
+
+    gSettingsSqlite3Mutex = ThreadMutexCreate();     //与 InitSettings 相同
+    snprintf(sIniPath, sizeof(sIniPath), "%s/test_registry.ini", directory);
+    snprintf(sDbPath, sizeof(sDbPath), "%s/test_registry.db", directory);
+
+    failed += TestLookup();
+    failed += TestRange();
+    failed += TestIniText();
+    failed += TestSqlite();
+
+    printf("%s\n", failed ? "FAILED" : "ALL OK");
+    return failed ? 1 : 0;
+}
@@ -34,6 +34,15 @@ ThreadMutex_Type ThreadMutexCreate(void)
 }
 
 
+void ThreadMutexDestroy(ThreadMutex_Type mutex)
+{
+    if (mutex == NULL)
+        return;
+    pthread_mutex_destroy(&mutex->id);
+    free(mutex);
+}
+
+
 int ThreadMutexLocking(ThreadMutex_Type mutex, const char *file, const char *func, int line)
 {
     if (mutex == NULL) {
@@ -8,6 +8,7 @@ extern "C" {
 typedef struct ThreadMutex* ThreadMutex_Type;
 
 ThreadMutex_Type ThreadMutexCreate(void);
+void ThreadMutexDestroy(ThreadMutex_Type mutex);
 
 int ThreadMutexLocking(ThreadMutex_Type mutex, const char* file, const char* func, int line);
 int ThreadMutexUnLocking(ThreadMutex_Type mutex, const char* file, const char* func, int line);